@@ -1,7 +1,8 @@
 // ConfigManager.cpp - ļʵ
 #include "pch.h"
 #include "ConfigManager.h"
-#include <fstream>
+#include "ConfigParser.h"
+#include "FileUtil.h"
 
 const LPCTSTR CConfigManager::DEFAULT_CONFIG_FILE = _T("config.ini");
 
@@ -40,8 +41,26 @@ BOOL CConfigManager::LoadConfig(LPCTSTR lpszConfigPath)
     }
 
     // ȡ
-    m_strStudentID = ReadINIValue(_T("User"), _T("StudentID"), _T(""), strConfigPath);
-    m_strSecretKey = ReadINIValue(_T("Security"), _T("SecretKey"), _T(""), strConfigPath);
+    std::string strText;
+    if (!ReadINIText(strConfigPath, strText))
+    {
+        CString strMsg;
+        strMsg.Format(_T("޷ȡļ%s"), strConfigPath.GetString());
+        ReportError(strMsg);
+        return FALSE;
+    }
+    m_strStudentID = ReadINIValue(strText, "User", "StudentID");
+    m_strSecretKey = ReadINIValue(strText, "Security", "SecretKey");
+    m_strNotesDirectory = ReadINIValue(strText, "Search", "NotesDirectory");
+    if (!m_strNotesDirectory.IsEmpty())
+    {
+        TCHAR szFullPath[MAX_PATH];
+        if (GetFullPathName(m_strNotesDirectory, MAX_PATH, szFullPath, NULL) != 0)
+        {
+            m_strNotesDirectory = szFullPath;
+        }
+        m_strNotesDirectory.TrimRight(_T("\\/"));
+    }
 
     // ֤
     if (m_strStudentID.IsEmpty())
@@ -65,16 +84,29 @@ BOOL CConfigManager::LoadConfig(LPCTSTR lpszConfigPath)
     return TRUE;
 }
 
-CString CConfigManager::ReadINIValue(const CString& strSection, const CString& strKey,
-    const CString& strDefault, const CString& strFilePath)
+BOOL CConfigManager::ReadINIText(const CString& strFilePath, std::string& strText)
 {
-    TCHAR szBuffer[1024] = { 0 };
-    GetPrivateProfileString(strSection, strKey, strDefault,
-        szBuffer, 1024, strFilePath);
+    std::vector<uint8_t> data;
+    if (!FileUtil::ReadAll(std::string(CT2A(strFilePath, CP_UTF8)), data))
+        return FALSE;
 
-    CString strValue = szBuffer;
-    strValue.Trim();  // ȥβո
-    return strValue;
+    //  BOM Ϸ UTF-8 ֱӽ ANSI ҳת
+    const uint8_t* pData = data.empty() ? nullptr : data.data();
+    if (!TestableLogic::DecodeIniText(pData, data.size(), strText))
+    {
+        std::string strAnsi(data.begin(), data.end());
+        CStringW strWide(CA2W(strAnsi.c_str(), CP_ACP));
+        strText = CW2A(strWide, CP_UTF8);
+    }
+    return TRUE;
+}
+
+CString CConfigManager::ReadINIValue(const std::string& strText, const char* pszSection, const char* pszKey)
+{
+    std::string value;
+    if (!TestableLogic::FindIniValue(strText, pszSection, pszKey, value))
+        return CString();
+    return CString(CA2T(value.c_str(), CP_UTF8));
 }
 
 void CConfigManager::ReportError(const CString& strError)
@@ -93,29 +125,18 @@ void CConfigManager::ReportError(const CString& strError)
 
 BOOL CConfigManager::ValidateStudentID()
 {
-    // ֤
-    if (m_strStudentID.GetLength() < 5)
+    switch (TestableLogic::ValidateStudentId(std::string(CT2A(m_strStudentID, CP_UTF8))))
     {
+    case TestableLogic::StudentIdError::TooShort:
         ReportError(_T("ôStudentID Ȳ5ַ"));
         return FALSE;
-    }
-
-    if (m_strStudentID.GetLength() > 20)
-    {
+    case TestableLogic::StudentIdError::TooLong:
         ReportError(_T("ôStudentID Ȳܳ20ַ"));
         return FALSE;
+    case TestableLogic::StudentIdError::InvalidChar:
+        ReportError(_T("ôStudentID ֻܰĸ"));
+        return FALSE;
+    default:
+        return TRUE;
     }
-
-    // ַֻ֤ĸ֣
-    for (int i = 0; i < m_strStudentID.GetLength(); i++)
-    {
-        TCHAR ch = m_strStudentID.GetAt(i);
-        if (!_istalnum(ch))
-        {
-            ReportError(_T("ôStudentID ֻܰĸ"));
-            return FALSE;
-        }
-    }
-
-    return TRUE;
 }
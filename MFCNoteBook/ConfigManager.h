@@ -26,6 +26,8 @@ public:
     // 获取配置值
     CString GetStudentID() const { return m_strStudentID; }
     CString GetSecretKey() const { return m_strSecretKey; }
+    // 笔记目录（绝对路径，不带末尾的反斜杠），未配置时为空，此时不建立搜索索引
+    CString GetNotesDirectory() const { return m_strNotesDirectory; }
     CString GetLastError() const { return m_strLastError; }
 
     // 测试用的 Set 方法
@@ -39,6 +41,11 @@ public:
         m_strSecretKey = strSecretKey;
     }
 
+    void SetNotesDirectory(const CString& strNotesDirectory)
+    {
+        m_strNotesDirectory = strNotesDirectory;
+    }
+
     // 设置错误回调（用于测试）
     void SetErrorCallback(ErrorCallback callback)
     {
@@ -62,9 +69,11 @@ private:
     CConfigManager(const CConfigManager&) = delete;
     CConfigManager& operator=(const CConfigManager&) = delete;
 
-    // 读取 INI 值
-    CString ReadINIValue(const CString& strSection, const CString& strKey,
-        const CString& strDefault, const CString& strFilePath);
+    // 读取配置文件并转为 UTF-8 文本
+    static BOOL ReadINIText(const CString& strFilePath, std::string& strText);
+
+    // 读取 INI 值（去除首尾空格），不存在时为空
+    static CString ReadINIValue(const std::string& strText, const char* pszSection, const char* pszKey);
 
     // 报告错误
     void ReportError(const CString& strError);
@@ -75,6 +84,7 @@ private:
     // 配置数据
     CString m_strStudentID;
     CString m_strSecretKey;
+    CString m_strNotesDirectory;
     CString m_strLastError;
 
     // 错误回调
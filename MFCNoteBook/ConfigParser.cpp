@@ -0,0 +1,140 @@
+﻿// ConfigParser.cpp - config.ini 解析实现
+#include "ConfigParser.h"
+#include "TextCodec.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        inline bool IsIniSpace(char ch)
+        {
+            return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+        }
+
+        inline char ToLowerAscii(char ch)
+        {
+            return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+        }
+
+        // 取 [begin, end) 去掉首尾空白后的部分
+        void Trim(const char*& begin, const char*& end)
+        {
+            while (begin < end && IsIniSpace(*begin))
+                begin++;
+            while (end > begin && IsIniSpace(end[-1]))
+                end--;
+        }
+
+        bool EqualsNoCase(const char* begin, const char* end, const char* name)
+        {
+            size_t len = strlen(name);
+            if (static_cast<size_t>(end - begin) != len)
+                return false;
+            for (size_t i = 0; i < len; i++)
+            {
+                if (ToLowerAscii(begin[i]) != ToLowerAscii(name[i]))
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    bool DecodeIniText(const uint8_t* pData, size_t len, std::string& utf8)
+    {
+        utf8.clear();
+        if (len >= 3 && pData[0] == 0xEF && pData[1] == 0xBB && pData[2] == 0xBF)
+        {
+            utf8.assign(reinterpret_cast<const char*>(pData) + 3, len - 3);
+            return true;
+        }
+        if (len >= 2 && ((pData[0] == 0xFF && pData[1] == 0xFE) || (pData[0] == 0xFE && pData[1] == 0xFF)))
+        {
+            std::u16string text = Utf16BytesToString(pData + 2, len - 2, pData[0] == 0xFE);
+            utf8 = Utf16ToUtf8String(text.data(), text.size());
+            return true;
+        }
+        if (!ValidateUtf8(pData, len).bValid)
+            return false;
+        utf8.assign(reinterpret_cast<const char*>(pData), len);
+        return true;
+    }
+
+    bool FindIniValue(const std::string& text, const char* section, const char* key, std::string& value)
+    {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        bool bInSection = false;
+        while (p < end)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (!lineEnd)
+                lineEnd = end;
+            const char* begin = p;
+            const char* last = lineEnd;
+            p = lineEnd + (lineEnd < end ? 1 : 0);
+            Trim(begin, last);
+            if (begin == last || *begin == ';')
+                continue;
+
+            if (*begin == '[')
+            {
+                const char* close = static_cast<const char*>(memchr(begin, ']', last - begin));
+                if (!close)
+                    continue;
+                const char* nameBegin = begin + 1;
+                const char* nameEnd = close;
+                Trim(nameBegin, nameEnd);
+                bInSection = EqualsNoCase(nameBegin, nameEnd, section);
+                continue;
+            }
+            if (!bInSection)
+                continue;
+
+            const char* eq = static_cast<const char*>(memchr(begin, '=', last - begin));
+            if (!eq)
+                continue;
+            const char* keyEnd = eq;
+            Trim(begin, keyEnd);
+            if (!EqualsNoCase(begin, keyEnd, key))
+                continue;
+
+            const char* valueBegin = eq + 1;
+            const char* valueEnd = last;
+            Trim(valueBegin, valueEnd);
+            if (valueEnd - valueBegin >= 2 && (*valueBegin == '"' || *valueBegin == '\'') && valueEnd[-1] == *valueBegin)
+            {
+                valueBegin++;
+                valueEnd--;
+            }
+            value.assign(valueBegin, valueEnd);
+            return true;
+        }
+        return false;
+    }
+
+    StudentIdError ValidateStudentId(const std::string& studentId)
+    {
+        // 按 UTF-8 首字节计字符数，与界面上看到的长度一致
+        size_t chars = 0;
+        bool bAlnum = true;
+        for (char ch : studentId)
+        {
+            if ((static_cast<uint8_t>(ch) & 0xC0) != 0x80)
+                chars++;
+            bool bDigit = ch >= '0' && ch <= '9';
+            bool bAlpha = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+            if (!bDigit && !bAlpha)
+                bAlnum = false;
+        }
+
+        if (chars < CONFIG_STUDENTID_MIN_LENGTH)
+            return StudentIdError::TooShort;
+        if (chars > CONFIG_STUDENTID_MAX_LENGTH)
+            return StudentIdError::TooLong;
+        if (!bAlnum)
+            return StudentIdError::InvalidChar;
+        return StudentIdError::None;
+    }
+}
@@ -0,0 +1,34 @@
+﻿// ConfigParser.h - config.ini 的解析和学号校验（不依赖MFC）
+//
+// 规则与 GetPrivateProfileString 一致：节名和键名不区分大小写，取第一次出现的值，
+// 去掉键和值首尾的空白以及值两端成对的引号；以 ; 开头或不含 = 的行被忽略。
+// 文件内容先由 DecodeIniText 转为 UTF-8：识别 UTF-8/UTF-16 的 BOM，无 BOM 的合法 UTF-8 直接使用。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 学号长度范围（字符数）
+#define CONFIG_STUDENTID_MIN_LENGTH     5
+#define CONFIG_STUDENTID_MAX_LENGTH     20
+
+namespace TestableLogic
+{
+    // 把文件字节转为 UTF-8；既没有 BOM 又不是合法 UTF-8 时返回 false，由调用方按本地代码页解码
+    bool DecodeIniText(const uint8_t* pData, size_t len, std::string& utf8);
+
+    // 在 UTF-8 的 INI 文本中查找 [section] 下的 key，找到时写入 value 并返回 true
+    bool FindIniValue(const std::string& text, const char* section, const char* key, std::string& value);
+
+    enum class StudentIdError
+    {
+        None,
+        TooShort,
+        TooLong,
+        InvalidChar     // 只允许 ASCII 字母和数字
+    };
+
+    // 校验学号格式（UTF-8），长度按字符计
+    StudentIdError ValidateStudentId(const std::string& studentId);
+}
@@ -0,0 +1,575 @@
+﻿// CryptoUtil.cpp - 跨平台加密辅助函数实现
+#include "CryptoUtil.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincrypt.h>
+
+#pragma comment(lib, "Crypt32.lib")
+#pragma comment(lib, "Advapi32.lib")
+#endif
+
+namespace CryptoUtil
+{
+#ifdef _WIN32
+    namespace
+    {
+        // 按创建的逆序释放 CryptoAPI 句柄
+        struct CryptHandles
+        {
+            HCRYPTPROV hProv = 0;
+            HCRYPTHASH hHash = 0;
+            HCRYPTKEY hKey = 0;
+
+            ~CryptHandles()
+            {
+                if (hKey)
+                    CryptDestroyKey(hKey);
+                if (hHash)
+                    CryptDestroyHash(hHash);
+                if (hProv)
+                    CryptReleaseContext(hProv, 0);
+            }
+        };
+
+        bool ComputeHash(ALG_ID algId, const void* pData, size_t len, uint8_t* pHash, DWORD dwHashLen)
+        {
+            if (len > MAXDWORD)
+                return false;
+
+            CryptHandles handles;
+            if (!CryptAcquireContext(&handles.hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
+                return false;
+            if (!CryptCreateHash(handles.hProv, algId, 0, 0, &handles.hHash))
+                return false;
+            if (!CryptHashData(handles.hHash, static_cast<const BYTE*>(pData), static_cast<DWORD>(len), 0))
+                return false;
+            return CryptGetHashParam(handles.hHash, HP_HASHVAL, pHash, &dwHashLen, 0) != FALSE;
+        }
+
+        bool DeriveAesKey(CryptHandles& handles, const void* pSecret, size_t secretLen, const uint8_t* pIV)
+        {
+            if (secretLen > MAXDWORD)
+                return false;
+            if (!CryptAcquireContext(&handles.hProv, NULL, MS_ENH_RSA_AES_PROV, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
+                return false;
+            if (!CryptCreateHash(handles.hProv, CALG_SHA_256, 0, 0, &handles.hHash))
+                return false;
+            if (!CryptHashData(handles.hHash, static_cast<const BYTE*>(pSecret), static_cast<DWORD>(secretLen), 0))
+                return false;
+            if (!CryptDeriveKey(handles.hProv, CALG_AES_128, handles.hHash, 0, &handles.hKey))
+                return false;
+
+            DWORD dwMode = CRYPT_MODE_CBC;
+            return CryptSetKeyParam(handles.hKey, KP_MODE, reinterpret_cast<const BYTE*>(&dwMode), 0)
+                && CryptSetKeyParam(handles.hKey, KP_IV, pIV, 0);
+        }
+    }
+
+    bool Sha1(const void* pData, size_t len, uint8_t* pHash)
+    {
+        return ComputeHash(CALG_SHA1, pData, len, pHash, CRYPTO_SHA1_SIZE);
+    }
+
+    bool Sha256(const void* pData, size_t len, uint8_t* pHash)
+    {
+        return ComputeHash(CALG_SHA_256, pData, len, pHash, CRYPTO_SHA256_SIZE);
+    }
+
+    bool AesEncrypt(const void* pSecret, size_t secretLen, const uint8_t* pIV,
+        const void* pSrc, size_t len, uint8_t* pDst, size_t& outLen)
+    {
+        if (len > MAXDWORD - CRYPTO_AES_BLOCK_SIZE)
+            return false;
+
+        CryptHandles handles;
+        if (!DeriveAesKey(handles, pSecret, secretLen, pIV))
+            return false;
+
+        if (len > 0)
+            memmove(pDst, pSrc, len);
+        DWORD dwLen = static_cast<DWORD>(len);
+        if (!CryptEncrypt(handles.hKey, 0, TRUE, 0, pDst, &dwLen, static_cast<DWORD>(len + CRYPTO_AES_BLOCK_SIZE)))
+            return false;
+        outLen = dwLen;
+        return true;
+    }
+
+    bool AesDecrypt(const void* pSecret, size_t secretLen, const uint8_t* pIV,
+        const void* pSrc, size_t len, uint8_t* pDst, size_t& outLen)
+    {
+        if (len == 0 || len % CRYPTO_AES_BLOCK_SIZE != 0 || len > MAXDWORD)
+            return false;
+
+        CryptHandles handles;
+        if (!DeriveAesKey(handles, pSecret, secretLen, pIV))
+            return false;
+
+        memmove(pDst, pSrc, len);
+        DWORD dwLen = static_cast<DWORD>(len);
+        if (!CryptDecrypt(handles.hKey, 0, TRUE, 0, pDst, &dwLen))
+            return false;
+        outLen = dwLen;
+        return true;
+    }
+
+    bool Random(void* pDst, size_t len)
+    {
+        if (len > MAXDWORD)
+            return false;
+
+        CryptHandles handles;
+        if (!CryptAcquireContext(&handles.hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
+            return false;
+        return CryptGenRandom(handles.hProv, static_cast<DWORD>(len), static_cast<BYTE*>(pDst)) != FALSE;
+    }
+#else
+    namespace
+    {
+        inline uint32_t Rotl(uint32_t x, int n)
+        {
+            return (x << n) | (x >> (32 - n));
+        }
+
+        inline uint32_t Rotr(uint32_t x, int n)
+        {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        inline uint32_t LoadBe32(const uint8_t* p)
+        {
+            return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+                | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+        }
+
+        inline void StoreBe32(uint8_t* p, uint32_t v)
+        {
+            p[0] = static_cast<uint8_t>(v >> 24);
+            p[1] = static_cast<uint8_t>(v >> 16);
+            p[2] = static_cast<uint8_t>(v >> 8);
+            p[3] = static_cast<uint8_t>(v);
+        }
+
+        // SHA-1/SHA-256 共用的 64 字节分块和填充：末尾补 0x80、若干 0 和 64 位大端的位长
+        template <typename Compress>
+        void HashBlocks(const uint8_t* pData, size_t len, Compress compress)
+        {
+            size_t full = len - len % 64;
+            for (size_t i = 0; i < full; i += 64)
+                compress(pData + i);
+
+            uint8_t tail[128] = { 0 };
+            size_t rest = len - full;
+            if (rest > 0)
+                memcpy(tail, pData + full, rest);
+            tail[rest] = 0x80;
+            size_t tailLen = (rest + 1 + 8 <= 64) ? 64 : 128;
+            uint64_t bits = static_cast<uint64_t>(len) * 8;
+            for (int i = 0; i < 8; i++)
+                tail[tailLen - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+
+            compress(tail);
+            if (tailLen == 128)
+                compress(tail + 64);
+        }
+
+        const uint32_t SHA256_K[64] =
+        {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        // ============ AES-128 ============
+
+        inline uint8_t Xtime(uint8_t x)
+        {
+            return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+        }
+
+        inline uint8_t Rotl8(uint8_t x, int n)
+        {
+            return static_cast<uint8_t>((x << n) | (x >> (8 - n)));
+        }
+
+        // S 盒在第一次使用时生成：p 逐次乘 3 遍历 GF(2^8) 的非零元素，q 同步除以 3 即为 p 的逆元
+        struct AesTables
+        {
+            uint8_t sbox[256];
+            uint8_t invSbox[256];
+
+            AesTables()
+            {
+                uint8_t p = 1;
+                uint8_t q = 1;
+                do
+                {
+                    p = static_cast<uint8_t>(p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0));
+                    q = static_cast<uint8_t>(q ^ (q << 1));
+                    q = static_cast<uint8_t>(q ^ (q << 2));
+                    q = static_cast<uint8_t>(q ^ (q << 4));
+                    if (q & 0x80)
+                        q ^= 0x09;
+                    uint8_t x = static_cast<uint8_t>(q ^ Rotl8(q, 1) ^ Rotl8(q, 2) ^ Rotl8(q, 3) ^ Rotl8(q, 4));
+                    sbox[p] = static_cast<uint8_t>(x ^ 0x63);
+                } while (p != 1);
+                sbox[0] = 0x63;
+
+                for (int i = 0; i < 256; i++)
+                    invSbox[sbox[i]] = static_cast<uint8_t>(i);
+            }
+        };
+
+        const AesTables& GetAesTables()
+        {
+            static const AesTables tables;
+            return tables;
+        }
+
+        class Aes128
+        {
+        public:
+            explicit Aes128(const uint8_t* pKey)
+                : m_tables(GetAesTables())
+            {
+                memcpy(m_roundKeys, pKey, CRYPTO_AES_KEY_SIZE);
+                uint8_t rcon = 1;
+                for (int i = 16; i < 176; i += 4)
+                {
+                    uint8_t t[4] = { m_roundKeys[i - 4], m_roundKeys[i - 3], m_roundKeys[i - 2], m_roundKeys[i - 1] };
+                    if (i % 16 == 0)
+                    {
+                        uint8_t first = t[0];
+                        t[0] = static_cast<uint8_t>(m_tables.sbox[t[1]] ^ rcon);
+                        t[1] = m_tables.sbox[t[2]];
+                        t[2] = m_tables.sbox[t[3]];
+                        t[3] = m_tables.sbox[first];
+                        rcon = Xtime(rcon);
+                    }
+                    for (int j = 0; j < 4; j++)
+                        m_roundKeys[i + j] = static_cast<uint8_t>(m_roundKeys[i - 16 + j] ^ t[j]);
+                }
+            }
+
+            ~Aes128()
+            {
+                volatile uint8_t* p = m_roundKeys;
+                for (size_t i = 0; i < sizeof(m_roundKeys); i++)
+                    p[i] = 0;
+            }
+
+            void EncryptBlock(uint8_t* s) const
+            {
+                AddRoundKey(s, 0);
+                for (int round = 1; round <= 10; round++)
+                {
+                    for (int i = 0; i < 16; i++)
+                        s[i] = m_tables.sbox[s[i]];
+                    ShiftRows(s, false);
+                    if (round < 10)
+                        MixColumns(s);
+                    AddRoundKey(s, round);
+                }
+            }
+
+            void DecryptBlock(uint8_t* s) const
+            {
+                AddRoundKey(s, 10);
+                for (int round = 9; round >= 0; round--)
+                {
+                    ShiftRows(s, true);
+                    for (int i = 0; i < 16; i++)
+                        s[i] = m_tables.invSbox[s[i]];
+                    AddRoundKey(s, round);
+                    if (round > 0)
+                        InvMixColumns(s);
+                }
+            }
+
+        private:
+            void AddRoundKey(uint8_t* s, int round) const
+            {
+                for (int i = 0; i < 16; i++)
+                    s[i] ^= m_roundKeys[round * 16 + i];
+            }
+
+            // 状态按列存放：s[r + 4c]，第 r 行循环左移（解密时右移）r 个字节
+            static void ShiftRows(uint8_t* s, bool bInverse)
+            {
+                uint8_t t[16];
+                memcpy(t, s, 16);
+                for (int r = 1; r < 4; r++)
+                {
+                    for (int c = 0; c < 4; c++)
+                    {
+                        int from = bInverse ? (c - r + 4) % 4 : (c + r) % 4;
+                        s[r + 4 * c] = t[r + 4 * from];
+                    }
+                }
+            }
+
+            static void MixColumns(uint8_t* s)
+            {
+                for (int c = 0; c < 16; c += 4)
+                {
+                    uint8_t a0 = s[c], a1 = s[c + 1], a2 = s[c + 2], a3 = s[c + 3];
+                    uint8_t t = static_cast<uint8_t>(a0 ^ a1 ^ a2 ^ a3);
+                    s[c] = static_cast<uint8_t>(a0 ^ t ^ Xtime(static_cast<uint8_t>(a0 ^ a1)));
+                    s[c + 1] = static_cast<uint8_t>(a1 ^ t ^ Xtime(static_cast<uint8_t>(a1 ^ a2)));
+                    s[c + 2] = static_cast<uint8_t>(a2 ^ t ^ Xtime(static_cast<uint8_t>(a2 ^ a3)));
+                    s[c + 3] = static_cast<uint8_t>(a3 ^ t ^ Xtime(static_cast<uint8_t>(a3 ^ a0)));
+                }
+            }
+
+            // 逆列混合 = 先乘 {04}(x^2 + 1) 的预处理，再做一次列混合
+            static void InvMixColumns(uint8_t* s)
+            {
+                for (int c = 0; c < 16; c += 4)
+                {
+                    uint8_t u = Xtime(Xtime(static_cast<uint8_t>(s[c] ^ s[c + 2])));
+                    uint8_t v = Xtime(Xtime(static_cast<uint8_t>(s[c + 1] ^ s[c + 3])));
+                    s[c] ^= u;
+                    s[c + 1] ^= v;
+                    s[c + 2] ^= u;
+                    s[c + 3] ^= v;
+                }
+                MixColumns(s);
+            }
+
+            const AesTables& m_tables;
+            uint8_t m_roundKeys[176];
+        };
+
+        void DeriveAesKey(const void* pSecret, size_t secretLen, uint8_t* pKey)
+        {
+            uint8_t hash[CRYPTO_SHA256_SIZE];
+            Sha256(pSecret, secretLen, hash);
+            memcpy(pKey, hash, CRYPTO_AES_KEY_SIZE);
+        }
+    }
+
+    bool Sha1(const void* pData, size_t len, uint8_t* pHash)
+    {
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        HashBlocks(static_cast<const uint8_t*>(pData), len, [&h](const uint8_t* block)
+        {
+            uint32_t w[80];
+            for (int i = 0; i < 16; i++)
+                w[i] = LoadBe32(block + 4 * i);
+            for (int i = 16; i < 80; i++)
+                w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; i++)
+            {
+                uint32_t f, k;
+                if (i < 20)
+                {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                }
+                else if (i < 40)
+                {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                }
+                else if (i < 60)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                uint32_t temp = Rotl(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = Rotl(b, 30);
+                b = a;
+                a = temp;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        });
+
+        for (int i = 0; i < 5; i++)
+            StoreBe32(pHash + 4 * i, h[i]);
+        return true;
+    }
+
+    bool Sha256(const void* pData, size_t len, uint8_t* pHash)
+    {
+        uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        HashBlocks(static_cast<const uint8_t*>(pData), len, [&h](const uint8_t* block)
+        {
+            uint32_t w[64];
+            for (int i = 0; i < 16; i++)
+                w[i] = LoadBe32(block + 4 * i);
+            for (int i = 16; i < 64; i++)
+            {
+                uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+            for (int i = 0; i < 64; i++)
+            {
+                uint32_t t1 = hh + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+                uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                hh = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+            h[5] += f;
+            h[6] += g;
+            h[7] += hh;
+        });
+
+        for (int i = 0; i < 8; i++)
+            StoreBe32(pHash + 4 * i, h[i]);
+        return true;
+    }
+
+    bool AesEncrypt(const void* pSecret, size_t secretLen, const uint8_t* pIV,
+        const void* pSrc, size_t len, uint8_t* pDst, size_t& outLen)
+    {
+        uint8_t key[CRYPTO_AES_KEY_SIZE];
+        DeriveAesKey(pSecret, secretLen, key);
+        Aes128 aes(key);
+
+        // PKCS#7：补 1~16 个值等于补齐长度的字节，整块时补一整块
+        const uint8_t* src = static_cast<const uint8_t*>(pSrc);
+        size_t padding = CRYPTO_AES_BLOCK_SIZE - len % CRYPTO_AES_BLOCK_SIZE;
+        size_t total = len + padding;
+        uint8_t chain[CRYPTO_AES_BLOCK_SIZE];
+        memcpy(chain, pIV, CRYPTO_AES_BLOCK_SIZE);
+        for (size_t offset = 0; offset < total; offset += CRYPTO_AES_BLOCK_SIZE)
+        {
+            for (size_t i = 0; i < CRYPTO_AES_BLOCK_SIZE; i++)
+            {
+                size_t pos = offset + i;
+                uint8_t value = pos < len ? src[pos] : static_cast<uint8_t>(padding);
+                chain[i] ^= value;
+            }
+            aes.EncryptBlock(chain);
+            memcpy(pDst + offset, chain, CRYPTO_AES_BLOCK_SIZE);
+        }
+        outLen = total;
+        return true;
+    }
+
+    bool AesDecrypt(const void* pSecret, size_t secretLen, const uint8_t* pIV,
+        const void* pSrc, size_t len, uint8_t* pDst, size_t& outLen)
+    {
+        if (len == 0 || len % CRYPTO_AES_BLOCK_SIZE != 0)
+            return false;
+
+        uint8_t key[CRYPTO_AES_KEY_SIZE];
+        DeriveAesKey(pSecret, secretLen, key);
+        Aes128 aes(key);
+
+        // 先取出本块密文再写明文，pSrc 与 pDst 相同时也能原地解密
+        const uint8_t* src = static_cast<const uint8_t*>(pSrc);
+        uint8_t chain[CRYPTO_AES_BLOCK_SIZE];
+        memcpy(chain, pIV, CRYPTO_AES_BLOCK_SIZE);
+        for (size_t offset = 0; offset < len; offset += CRYPTO_AES_BLOCK_SIZE)
+        {
+            uint8_t block[CRYPTO_AES_BLOCK_SIZE];
+            uint8_t cipher[CRYPTO_AES_BLOCK_SIZE];
+            memcpy(cipher, src + offset, CRYPTO_AES_BLOCK_SIZE);
+            memcpy(block, cipher, CRYPTO_AES_BLOCK_SIZE);
+            aes.DecryptBlock(block);
+            for (size_t i = 0; i < CRYPTO_AES_BLOCK_SIZE; i++)
+                pDst[offset + i] = static_cast<uint8_t>(block[i] ^ chain[i]);
+            memcpy(chain, cipher, CRYPTO_AES_BLOCK_SIZE);
+        }
+
+        size_t padding = pDst[len - 1];
+        if (padding == 0 || padding > CRYPTO_AES_BLOCK_SIZE)
+            return false;
+        for (size_t i = len - padding; i < len; i++)
+        {
+            if (pDst[i] != padding)
+                return false;
+        }
+        outLen = len - padding;
+        return true;
+    }
+
+    bool Random(void* pDst, size_t len)
+    {
+        FILE* fp = fopen("/dev/urandom", "rb");
+        if (!fp)
+            return false;
+        bool bOk = fread(pDst, 1, len, fp) == len;
+        fclose(fp);
+        return bOk;
+    }
+#endif
+
+    // ============ 与平台无关的部分 ============
+
+    bool HmacSha256(const void* pKey, size_t keyLen, const void* pData, size_t len, uint8_t* pMac)
+    {
+        // RFC 2104：长于块大小的密钥先做摘要
+        const size_t BLOCK_SIZE = 64;
+        uint8_t key[BLOCK_SIZE] = { 0 };
+        if (keyLen > BLOCK_SIZE)
+        {
+            if (!Sha256(pKey, keyLen, key))
+                return false;
+        }
+        else if (keyLen > 0)
+        {
+            memcpy(key, pKey, keyLen);
+        }
+
+        std::vector<uint8_t> inner(BLOCK_SIZE + len);
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+            inner[i] = key[i] ^ 0x36;
+        if (len > 0)
+            memcpy(inner.data() + BLOCK_SIZE, pData, len);
+
+        uint8_t outer[BLOCK_SIZE + CRYPTO_SHA256_SIZE];
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+            outer[i] = key[i] ^ 0x5C;
+        if (!Sha256(inner.data(), inner.size(), outer + BLOCK_SIZE))
+            return false;
+        return Sha256(outer, sizeof(outer), pMac);
+    }
+
+    bool ConstantTimeEqual(const void* pA, const void* pB, size_t len)
+    {
+        const uint8_t* a = static_cast<const uint8_t*>(pA);
+        const uint8_t* b = static_cast<const uint8_t*>(pB);
+        uint8_t diff = 0;
+        for (size_t i = 0; i < len; i++)
+            diff |= a[i] ^ b[i];
+        return diff == 0;
+    }
+}
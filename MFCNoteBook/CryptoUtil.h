@@ -0,0 +1,40 @@
+﻿// CryptoUtil.h - 跨平台加密辅助函数（不依赖MFC）
+//
+// .mynote 文件用到的摘要、加密和随机数。Windows 下走 CryptoAPI；其他平台用内置的 SHA-1/SHA-256/AES-128
+// 实现，两边对同样的输入得到同样的字节：AES 密钥为口令 SHA-256 摘要的前 16 字节
+// （即 CryptDeriveKey(CALG_AES_128) 对 SHA-2 摘要的派生方式），CBC 模式，PKCS#7 填充。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define CRYPTO_SHA1_SIZE        20
+#define CRYPTO_SHA256_SIZE      32
+#define CRYPTO_AES_BLOCK_SIZE   16
+#define CRYPTO_AES_KEY_SIZE     16
+
+namespace CryptoUtil
+{
+    // 计算 SHA-1 摘要，pHash 至少 CRYPTO_SHA1_SIZE 字节
+    bool Sha1(const void* pData, size_t len, uint8_t* pHash);
+
+    // 计算 SHA-256 摘要，pHash 至少 CRYPTO_SHA256_SIZE 字节
+    bool Sha256(const void* pData, size_t len, uint8_t* pHash);
+
+    // 用口令派生的密钥做 AES-128-CBC 加密；pDst 至少 len + CRYPTO_AES_BLOCK_SIZE 字节，outLen 为密文长度
+    bool AesEncrypt(const void* pSecret, size_t secretLen, const uint8_t* pIV,
+        const void* pSrc, size_t len, uint8_t* pDst, size_t& outLen);
+
+    // 解密并去掉填充；长度不是块大小的整数倍或填充不正确时返回 false。pDst 至少 len 字节
+    bool AesDecrypt(const void* pSecret, size_t secretLen, const uint8_t* pIV,
+        const void* pSrc, size_t len, uint8_t* pDst, size_t& outLen);
+
+    // 填充密码学安全的随机字节
+    bool Random(void* pDst, size_t len);
+
+    // HMAC-SHA256，pMac 至少 CRYPTO_SHA256_SIZE 字节
+    bool HmacSha256(const void* pKey, size_t keyLen, const void* pData, size_t len, uint8_t* pMac);
+
+    // 比较两段字节，耗时与内容无关（校验 MAC 用）
+    bool ConstantTimeEqual(const void* pA, const void* pB, size_t len);
+}
@@ -0,0 +1,335 @@
+﻿// EncodingDetector.cpp - 文本编码检测实现
+#include "EncodingDetector.h"
+#include "SimdSupport.h"
+#include "TextCodec.h"
+
+#include <algorithm>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        struct SampleWindow
+        {
+            const uint8_t* pData;
+            size_t nLen;
+            bool bHead;         // 文件头窗口从序列边界开始，无需重新同步
+        };
+
+        // 小文件整体作为一个窗口；大文件取文件头和均匀分布的若干窗口（起点按 2 字节对齐）
+        size_t CollectWindows(const uint8_t* data, size_t len, SampleWindow* windows)
+        {
+            const size_t sampleTotal = ENCODING_SAMPLE_HEAD_SIZE + ENCODING_SAMPLE_WINDOW_COUNT * ENCODING_SAMPLE_WINDOW_SIZE;
+            if (len <= sampleTotal)
+            {
+                windows[0] = { data, len, true };
+                return 1;
+            }
+
+            windows[0] = { data, ENCODING_SAMPLE_HEAD_SIZE, true };
+            size_t stride = (len - ENCODING_SAMPLE_HEAD_SIZE) / ENCODING_SAMPLE_WINDOW_COUNT;
+            for (size_t i = 0; i < ENCODING_SAMPLE_WINDOW_COUNT; i++)
+            {
+                size_t start = ENCODING_SAMPLE_HEAD_SIZE + i * stride + (stride - ENCODING_SAMPLE_WINDOW_SIZE) / 2;
+                start &= ~static_cast<size_t>(1);
+                windows[i + 1] = { data + start, ENCODING_SAMPLE_WINDOW_SIZE, false };
+            }
+            return ENCODING_SAMPLE_WINDOW_COUNT + 1;
+        }
+
+        // ============ 字节分布 ============
+
+        struct ByteStats
+        {
+            size_t total;
+            size_t nulEven;     // 偶数偏移上的 0 字节（UTF-16BE 的 ASCII 高字节）
+            size_t nulOdd;      // 奇数偏移上的 0 字节（UTF-16LE 的 ASCII 高字节）
+            size_t high;        // >= 0x80 的字节
+        };
+
+        void CountBytesScalar(const uint8_t* p, size_t len, ByteStats& stats)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                if (p[i] == 0)
+                {
+                    if (i & 1)
+                        stats.nulOdd++;
+                    else
+                        stats.nulEven++;
+                }
+                else if (p[i] >= 0x80)
+                {
+                    stats.high++;
+                }
+            }
+        }
+
+        void CountBytes(const uint8_t* p, size_t len, ByteStats& stats)
+        {
+            stats.total += len;
+            size_t i = 0;
+#if SIMD_X86
+            if (GetSimdLevel() >= SimdLevel::SSE2)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 16 <= len; i += 16)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                    uint32_t nul = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+                    stats.nulEven += PopCount32(nul & 0x5555u);
+                    stats.nulOdd += PopCount32(nul & 0xAAAAu);
+                    stats.high += PopCount32(static_cast<uint32_t>(_mm_movemask_epi8(v)));
+                }
+            }
+#endif
+            // i 总是偶数，余下部分的奇偶性不变
+            CountBytesScalar(p + i, len - i, stats);
+        }
+
+        // ============ UTF-8 ============
+
+        // 去掉窗口首部的后续字节和尾部被截断的序列，再做 SIMD 校验
+        bool IsWindowUtf8(const SampleWindow& window)
+        {
+            const uint8_t* p = window.pData;
+            size_t n = window.nLen;
+            if (!window.bHead)
+            {
+                for (int k = 0; k < 3 && n > 0 && (*p & 0xC0) == 0x80; k++)
+                {
+                    p++;
+                    n--;
+                }
+            }
+            for (size_t k = 1; k <= 3 && k <= n; k++)
+            {
+                uint8_t b = p[n - k];
+                if (b < 0x80)
+                    break;
+                if (b >= 0xC0)
+                {
+                    size_t seqLen = (b >= 0xF0) ? 4 : (b >= 0xE0 ? 3 : 2);
+                    if (seqLen > k)
+                        n -= k;
+                    break;
+                }
+            }
+            return ValidateUtf8(p, n).bValid;
+        }
+
+        // ============ GB18030 ============
+
+        struct GbStats
+        {
+            size_t doubleByte;      // 双字节字符
+            size_t fourByte;        // 四字节字符
+            size_t invalid;
+            size_t common;          // GB2312 常用汉字区和全角标点区的字符
+            size_t inWord;          // 夹在两个 ASCII 字母之间的双字节字符（西文 ANSI 文本的特征）
+        };
+
+        inline bool IsAsciiLetter(uint8_t b)
+        {
+            return (b >= 'A' && b <= 'Z') || (b >= 'a' && b <= 'z');
+        }
+
+        void ScanGb18030(const SampleWindow& window, GbStats& stats)
+        {
+            const uint8_t* p = window.pData;
+            size_t n = window.nLen;
+            size_t i = 0;
+
+            // 窗口可能从双字节字符中间开始：跳到第一个不可能是尾字节的字节（< 0x40）之后
+            if (!window.bHead)
+            {
+                while (i < n && i < 256 && p[i] >= 0x40)
+                    i++;
+                if (i < n)
+                    i++;
+            }
+
+            while (i < n)
+            {
+                uint8_t b = p[i];
+                if (b < 0x80)
+                {
+                    i++;
+                    continue;
+                }
+                if (b == 0x80 || b == 0xFF)
+                {
+                    stats.invalid++;
+                    i++;
+                    continue;
+                }
+                if (i + 1 >= n)
+                    break;      // 被窗口截断
+
+                uint8_t b2 = p[i + 1];
+                if (b2 >= 0x30 && b2 <= 0x39)
+                {
+                    if (i + 3 >= n)
+                        break;
+                    if (p[i + 2] >= 0x81 && p[i + 2] <= 0xFE && p[i + 3] >= 0x30 && p[i + 3] <= 0x39)
+                    {
+                        stats.fourByte++;
+                        i += 4;
+                    }
+                    else
+                    {
+                        stats.invalid++;
+                        i++;
+                    }
+                }
+                else if ((b2 >= 0x40 && b2 <= 0x7E) || (b2 >= 0x80 && b2 <= 0xFE))
+                {
+                    stats.doubleByte++;
+                    if (b2 >= 0xA1 && ((b >= 0xB0 && b <= 0xF7) || (b >= 0xA1 && b <= 0xA9)))
+                        stats.common++;
+                    if (i > 0 && i + 2 < n && IsAsciiLetter(p[i - 1]) && IsAsciiLetter(p[i + 2]))
+                        stats.inWord++;
+                    i += 2;
+                }
+                else
+                {
+                    stats.invalid++;
+                    i++;
+                }
+            }
+        }
+
+        // ============ UTF-16 ============
+
+        inline bool IsPlausibleUnit(uint32_t u)
+        {
+            return (u >= 0x20 && u < 0x7F) || u == 0x09 || u == 0x0A || u == 0x0D
+                || (u >= 0xA0 && u < 0x250)         // 拉丁字母
+                || (u >= 0x370 && u < 0x530)        // 希腊、西里尔字母
+                || (u >= 0x2000 && u < 0x2070)      // 通用标点
+                || (u >= 0x3000 && u < 0x3100)      // CJK 标点、假名
+                || (u >= 0x4E00 && u < 0xA000)      // CJK 统一汉字
+                || (u >= 0xAC00 && u < 0xD7A4)      // 韩文音节
+                || (u >= 0xFF00 && u < 0xFFF0);     // 全角字符
+        }
+
+        void ScanUtf16(const SampleWindow& window, size_t& units, size_t& plausibleLE, size_t& plausibleBE)
+        {
+            const uint8_t* p = window.pData;
+            for (size_t i = 0; i + 1 < window.nLen; i += 2)
+            {
+                units++;
+                plausibleLE += IsPlausibleUnit(p[i] | (p[i + 1] << 8));
+                plausibleBE += IsPlausibleUnit((p[i] << 8) | p[i + 1]);
+            }
+        }
+
+        EncodingDetectResult MakeResult(TextEncoding encoding, size_t bomLength, int confidence)
+        {
+            EncodingDetectResult result;
+            result.encoding = encoding;
+            result.bomLength = bomLength;
+            result.confidence = confidence;
+            return result;
+        }
+
+        EncodingDetectResult DecideUtf16(const SampleWindow* windows, size_t count, bool bHasNul)
+        {
+            size_t units = 0, le = 0, be = 0;
+            for (size_t i = 0; i < count; i++)
+                ScanUtf16(windows[i], units, le, be);
+            if (units > 0)
+            {
+                // 含 NUL 时已排除 8 位编码，门槛可以放低
+                double leRatio = static_cast<double>(le) / units;
+                double beRatio = static_cast<double>(be) / units;
+                double minRatio = bHasNul ? 0.8 : 0.95;
+                double maxOther = bHasNul ? 1.0 : 0.7;
+                if (leRatio >= minRatio && leRatio > beRatio && beRatio < maxOther)
+                    return MakeResult(TextEncoding::Utf16LE, 0, static_cast<int>(leRatio * (bHasNul ? 90 : 60)));
+                if (beRatio >= minRatio && beRatio > leRatio && leRatio < maxOther)
+                    return MakeResult(TextEncoding::Utf16BE, 0, static_cast<int>(beRatio * (bHasNul ? 90 : 60)));
+            }
+            return MakeResult(TextEncoding::Ansi, 0, 0);
+        }
+    }
+
+    EncodingDetectResult DetectTextEncoding(const void* data, size_t len)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        if (!p || len == 0)
+            return MakeResult(TextEncoding::Ascii, 0, 100);
+
+        // ============ BOM ============
+        if (len >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+            return MakeResult(TextEncoding::Utf8, 3, 100);
+        if (len >= 2 && p[0] == 0xFF && p[1] == 0xFE)
+            return MakeResult(TextEncoding::Utf16LE, 2, 100);
+        if (len >= 2 && p[0] == 0xFE && p[1] == 0xFF)
+            return MakeResult(TextEncoding::Utf16BE, 2, 100);
+        if (len >= 4 && p[0] == 0x84 && p[1] == 0x31 && p[2] == 0x95 && p[3] == 0x33)
+            return MakeResult(TextEncoding::Gb18030, 4, 100);
+
+        SampleWindow windows[ENCODING_SAMPLE_WINDOW_COUNT + 1];
+        size_t count = CollectWindows(p, len, windows);
+
+        ByteStats bytes = {};
+        for (size_t i = 0; i < count; i++)
+            CountBytes(windows[i].pData, windows[i].nLen, bytes);
+
+        // ============ NUL 字节：只可能是 UTF-16（或二进制） ============
+        size_t nul = bytes.nulEven + bytes.nulOdd;
+        if (nul > 0)
+        {
+            if (bytes.nulOdd > bytes.nulEven * 4)
+                return MakeResult(TextEncoding::Utf16LE, 0, (std::min)(95, 60 + static_cast<int>(bytes.nulOdd * 70 / bytes.total)));
+            if (bytes.nulEven > bytes.nulOdd * 4)
+                return MakeResult(TextEncoding::Utf16BE, 0, (std::min)(95, 60 + static_cast<int>(bytes.nulEven * 70 / bytes.total)));
+            return DecideUtf16(windows, count, true);
+        }
+
+        // ============ UTF-8 ============
+        if (bytes.high == 0)
+            return MakeResult(TextEncoding::Ascii, 0, 100);
+
+        bool bUtf8 = true;
+        for (size_t i = 0; i < count && bUtf8; i++)
+            bUtf8 = IsWindowUtf8(windows[i]);
+        if (bUtf8)
+        {
+            // 非 ASCII 字节越多，偶然通过 UTF-8 校验的可能越小
+            return MakeResult(TextEncoding::Utf8, 0, bytes.high >= 16 ? 95 : 70);
+        }
+
+        // ============ GB18030 ============
+        GbStats gb = {};
+        for (size_t i = 0; i < count; i++)
+            ScanGb18030(windows[i], gb);
+        size_t chars = gb.doubleByte + gb.fourByte;
+        if (chars > 0 && gb.invalid * 50 <= chars && gb.inWord * 3 < chars && gb.common * 2 >= gb.doubleByte)
+        {
+            int confidence = 50 + static_cast<int>(gb.common * 45 / (gb.doubleByte ? gb.doubleByte : 1));
+            return MakeResult(TextEncoding::Gb18030, 0, (std::min)(95, confidence));
+        }
+
+        // ============ 不含 NUL 的 UTF-16（如纯中文） ============
+        EncodingDetectResult utf16 = DecideUtf16(windows, count, false);
+        if (utf16.encoding != TextEncoding::Ansi)
+            return utf16;
+
+        return MakeResult(TextEncoding::Ansi, 0, 30);
+    }
+
+    const char* GetTextEncodingName(TextEncoding encoding)
+    {
+        switch (encoding)
+        {
+        case TextEncoding::Ascii:   return "ASCII";
+        case TextEncoding::Utf8:    return "UTF-8";
+        case TextEncoding::Utf16LE: return "UTF-16LE";
+        case TextEncoding::Utf16BE: return "UTF-16BE";
+        case TextEncoding::Gb18030: return "GB18030";
+        default:                    return "ANSI";
+        }
+    }
+}
@@ -0,0 +1,42 @@
+﻿// EncodingDetector.h - 文本编码检测（BOM + 无 BOM 时的统计判断，不依赖MFC）
+//
+// 只对采样窗口做判断：文件头 64 KB，加上均匀分布在其余部分的若干个 4 KB 窗口，
+// 因此对多 GB 的内存映射文件也只会触及少量页面。
+// 判断顺序：BOM → NUL 字节奇偶分布（UTF-16）→ SIMD UTF-8 校验 →
+// GB18030 结构校验与字频特征 → UTF-16 码位合理性 → 系统 ANSI 代码页。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ============ 采样参数 ============
+#define ENCODING_SAMPLE_HEAD_SIZE       (64 * 1024)
+#define ENCODING_SAMPLE_WINDOW_SIZE     (4 * 1024)
+#define ENCODING_SAMPLE_WINDOW_COUNT    8
+
+// GB18030 对应的 Windows 代码页
+#define CODEPAGE_GB18030                54936
+
+namespace TestableLogic
+{
+    enum class TextEncoding
+    {
+        Ascii,          // 纯 ASCII（可按 UTF-8 解码）
+        Utf8,
+        Utf16LE,
+        Utf16BE,
+        Gb18030,        // GBK/GB2312 的超集
+        Ansi            // 无法判断，使用系统 ANSI 代码页
+    };
+
+    struct EncodingDetectResult
+    {
+        TextEncoding encoding;
+        size_t bomLength;       // 需要跳过的 BOM 字节数
+        int confidence;         // 0-100，BOM 为 100
+    };
+
+    EncodingDetectResult DetectTextEncoding(const void* data, size_t len);
+
+    const char* GetTextEncodingName(TextEncoding encoding);
+}
@@ -0,0 +1,107 @@
+﻿// FileUtil.cpp - 跨平台文件辅助函数实现
+#include "FileUtil.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FileUtil
+{
+#ifdef _WIN32
+    static std::wstring ToWide(const std::string& utf8)
+    {
+        int nWideLen = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, NULL, 0);
+        if (nWideLen <= 0)
+            return std::wstring();
+        std::wstring result(nWideLen, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, &result[0], nWideLen);
+        result.pop_back();
+        return result;
+    }
+#endif
+
+    FILE* Open(const std::string& utf8Path, const char* mode)
+    {
+#ifdef _WIN32
+        std::wstring wideMode(mode, mode + strlen(mode));
+        FILE* fp = nullptr;
+        if (_wfopen_s(&fp, ToWide(utf8Path).c_str(), wideMode.c_str()) != 0)
+            return nullptr;
+        return fp;
+#else
+        return fopen(utf8Path.c_str(), mode);
+#endif
+    }
+
+    bool Replace(const std::string& srcPath, const std::string& dstPath)
+    {
+#ifdef _WIN32
+        return MoveFileExW(ToWide(srcPath).c_str(), ToWide(dstPath).c_str(),
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+        return ::rename(srcPath.c_str(), dstPath.c_str()) == 0;
+#endif
+    }
+
+    bool Remove(const std::string& utf8Path)
+    {
+        if (!Exists(utf8Path))
+            return true;
+#ifdef _WIN32
+        return DeleteFileW(ToWide(utf8Path).c_str()) != FALSE;
+#else
+        return ::unlink(utf8Path.c_str()) == 0;
+#endif
+    }
+
+    bool Exists(const std::string& utf8Path)
+    {
+#ifdef _WIN32
+        return GetFileAttributesW(ToWide(utf8Path).c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+        struct stat st;
+        return ::stat(utf8Path.c_str(), &st) == 0;
+#endif
+    }
+
+    bool ReadAll(const std::string& utf8Path, std::vector<uint8_t>& data)
+    {
+        data.clear();
+        FILE* fp = Open(utf8Path, "rb");
+        if (!fp)
+            return false;
+
+        uint8_t chunk[64 * 1024];
+        size_t nRead;
+        while ((nRead = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+            data.insert(data.end(), chunk, chunk + nRead);
+
+        bool bOk = ferror(fp) == 0;
+        fclose(fp);
+        return bOk;
+    }
+
+    bool WriteAllAtomic(const std::string& utf8Path, const void* pData, size_t len)
+    {
+        std::string tmpPath = utf8Path + ".tmp";
+        FILE* fp = Open(tmpPath, "wb");
+        if (!fp)
+            return false;
+
+        bool bOk = (len == 0) || fwrite(pData, 1, len, fp) == len;
+        bOk = (fflush(fp) == 0) && bOk;
+        fclose(fp);
+
+        if (!bOk || !Replace(tmpPath, utf8Path))
+        {
+            Remove(tmpPath);
+            return false;
+        }
+        return true;
+    }
+}
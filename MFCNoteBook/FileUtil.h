@@ -0,0 +1,28 @@
+﻿// FileUtil.h - 跨平台文件辅助函数（路径统一为 UTF-8）
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace FileUtil
+{
+    // 以 UTF-8 路径打开文件（Windows 下转为宽字符路径）
+    FILE* Open(const std::string& utf8Path, const char* mode);
+
+    // 用 src 原子替换 dst（dst 已存在时覆盖）
+    bool Replace(const std::string& srcPath, const std::string& dstPath);
+
+    // 删除文件，文件不存在也视为成功
+    bool Remove(const std::string& utf8Path);
+
+    // 文件是否存在
+    bool Exists(const std::string& utf8Path);
+
+    // 读取整个文件
+    bool ReadAll(const std::string& utf8Path, std::vector<uint8_t>& data);
+
+    // 写入整个文件（先写临时文件再替换，避免写一半的文件）
+    bool WriteAllAtomic(const std::string& utf8Path, const void* pData, size_t len);
+}
@@ -0,0 +1,99 @@
+﻿// FindInNotesDlg.cpp - 在笔记目录中查找的对话框实现
+#include "pch.h"
+#include "framework.h"
+#include "MFCNoteBook.h"
+#include "FindInNotesDlg.h"
+#include "Resource.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+IMPLEMENT_DYNAMIC(CFindInNotesDlg, CDialogEx)
+
+CFindInNotesDlg::CFindInNotesDlg(CWnd* pParent /*=nullptr*/)
+    : CDialogEx(IDD_FIND_IN_NOTES, pParent)
+{
+}
+
+CFindInNotesDlg::~CFindInNotesDlg()
+{
+}
+
+void CFindInNotesDlg::DoDataExchange(CDataExchange* pDX)
+{
+    CDialogEx::DoDataExchange(pDX);
+    DDX_Control(pDX, IDC_EDIT_NOTES_FIND, m_editFind);
+    DDX_Control(pDX, IDC_CHECK_NOTES_CASE, m_chkCase);
+    DDX_Control(pDX, IDC_LIST_NOTES_RESULTS, m_listResults);
+    DDX_Control(pDX, IDC_STATIC_NOTES_STATUS, m_staticStatus);
+}
+
+BEGIN_MESSAGE_MAP(CFindInNotesDlg, CDialogEx)
+    ON_LBN_DBLCLK(IDC_LIST_NOTES_RESULTS, &CFindInNotesDlg::OnDblclkListResults)
+END_MESSAGE_MAP()
+
+BOOL CFindInNotesDlg::OnInitDialog()
+{
+    CDialogEx::OnInitDialog();
+
+    CString strStatus;
+    strStatus.Format(_T("笔记目录: %s"), theApp.GetSearchIndex().GetNotesDirectory().GetString());
+    m_staticStatus.SetWindowText(strStatus);
+
+    m_editFind.SetFocus();
+    return FALSE;  // 已设置焦点
+}
+
+// “查找”为默认按钮；焦点在结果列表上时回车打开选中的文件
+void CFindInNotesDlg::OnOK()
+{
+    if (GetFocus() == &m_listResults)
+    {
+        OpenSelectedResult();
+        return;
+    }
+
+    CString strFind;
+    m_editFind.GetWindowText(strFind);
+    if (strFind.IsEmpty())
+    {
+        m_staticStatus.SetWindowText(_T("请输入查找内容"));
+        return;
+    }
+
+    CWaitCursor wait;
+    CSearchIndexManager::FindResult result;
+    if (!theApp.GetSearchIndex().Find(strFind, m_chkCase.GetCheck() == BST_CHECKED, result))
+    {
+        m_staticStatus.SetWindowText(_T("搜索索引不可用"));
+        return;
+    }
+
+    m_listResults.ResetContent();
+    for (const CString& strPath : result.matches)
+    {
+        m_listResults.AddString(strPath);
+    }
+
+    CString strStatus;
+    strStatus.Format(_T("%Iu 篇笔记中有 %Iu 篇包含查找内容（检查了 %Iu 篇）"),
+        result.total, result.matches.size(), result.candidates);
+    m_staticStatus.SetWindowText(strStatus);
+}
+
+void CFindInNotesDlg::OnDblclkListResults()
+{
+    OpenSelectedResult();
+}
+
+void CFindInNotesDlg::OpenSelectedResult()
+{
+    int nSel = m_listResults.GetCurSel();
+    if (nSel == LB_ERR)
+        return;
+
+    CString strPath;
+    m_listResults.GetText(nSel, strPath);
+    AfxGetApp()->OpenDocumentFile(strPath);
+}
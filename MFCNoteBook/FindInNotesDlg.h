@@ -0,0 +1,35 @@
+﻿// FindInNotesDlg.h - 在笔记目录中查找的对话框
+#pragma once
+
+// 在笔记中查找对话框类：结果列表双击打开文件
+class CFindInNotesDlg : public CDialogEx
+{
+    DECLARE_DYNAMIC(CFindInNotesDlg)
+
+public:
+    CFindInNotesDlg(CWnd* pParent = nullptr);
+    virtual ~CFindInNotesDlg();
+
+    // 对话框数据
+    enum { IDD = IDD_FIND_IN_NOTES };
+
+protected:
+    virtual void DoDataExchange(CDataExchange* pDX);
+    virtual BOOL OnInitDialog();
+    virtual void OnOK();
+
+    DECLARE_MESSAGE_MAP()
+
+public:
+    // 控件变量
+    CEdit m_editFind;
+    CButton m_chkCase;
+    CListBox m_listResults;
+    CStatic m_staticStatus;
+
+    // 消息处理
+    afx_msg void OnDblclkListResults();
+
+private:
+    void OpenSelectedResult();
+};
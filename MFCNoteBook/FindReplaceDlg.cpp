@@ -115,6 +115,10 @@ BOOL CFindReplaceDlg::FindNext(BOOL bShowNotFound /*= TRUE*/)
         return FALSE;
     }
 
+    // ļ򺬳еļԻ༭ʾֱƬαв
+    if (m_pView->IsLargeFileMode())
+        return FindNextInLargeFile(bShowNotFound);
+
     // ȡ༭ؼı
     CEdit& edit = m_pView->GetEditCtrl();
     CString strText;
@@ -288,10 +292,43 @@ BOOL CFindReplaceDlg::DoNormalFind(const CString& strText, const CString& strFin
 }
 
 // ========== 滻 ==========
+// Ի༭ֽڻвңҵɱ༭ֿλƥ䴦
+BOOL CFindReplaceDlg::FindNextInLargeFile(BOOL bShowNotFound)
+{
+    if (m_Options.bUseRegex)
+    {
+        SetStatusText(_T("ļ֧ʽ"), TRUE);
+        return FALSE;
+    }
+
+    CT2A utf8Find(m_Options.strFind, CP_UTF8);
+    CTextEditorCtrl& editor = m_pView->GetTextEditor();
+    bool bWrapped = false;
+    if (editor.FindNext(std::string(utf8Find), m_Options.bMatchCase != FALSE,
+        m_Options.bWholeWord != FALSE, &bWrapped))
+    {
+        editor.SetFocus();
+        SetStatusText(bWrapped ? _T("Ѵͷʼ") : _T("ҵ"));
+        return TRUE;
+    }
+
+    if (bShowNotFound)
+    {
+        SetStatusText(_T("Ҳָ"), TRUE);
+        MessageBeep(MB_ICONEXCLAMATION);
+    }
+    return FALSE;
+}
+
 void CFindReplaceDlg::OnBtnReplace()
 {
     if (!m_pView || !m_pView->GetEditCtrl().GetSafeHwnd())
         return;
+    if (m_pView->IsLargeFileMode())
+    {
+        SetStatusText(_T("ļݲ֧滻"), TRUE);
+        return;
+    }
 
     UpdateOptions();
 
@@ -304,9 +341,8 @@ void CFindReplaceDlg::OnBtnReplace()
     // ѡݣ滻
     if (nStart != nEnd)
     {
-        CString strSelected;
-        edit.GetWindowText(strSelected);
-        strSelected = strSelected.Mid(nStart, nEnd - nStart);
+        // ֻȡѡеһΣȫ
+        CString strSelected = m_pView->GetTextRange(nStart, nEnd);
 
         // ֤ѡǷƥ
         BOOL bMatch = FALSE;
@@ -383,6 +419,11 @@ void CFindReplaceDlg::OnBtnReplaceAll()
 {
     if (!m_pView || !m_pView->GetEditCtrl().GetSafeHwnd())
         return;
+    if (m_pView->IsLargeFileMode())
+    {
+        SetStatusText(_T("ļݲ֧滻"), TRUE);
+        return;
+    }
 
     UpdateOptions();
 
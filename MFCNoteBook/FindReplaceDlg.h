@@ -77,6 +77,7 @@ private:
 
     // 
     BOOL FindNext(BOOL bShowNotFound = TRUE);
+    BOOL FindNextInLargeFile(BOOL bShowNotFound);
     BOOL DoRegexFind(const CString& strText, const CString& strPattern,
         int nStartPos, int& nFoundStart, int& nFoundEnd);
     BOOL DoNormalFind(const CString& strText, const CString& strFind,
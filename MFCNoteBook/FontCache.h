@@ -0,0 +1,80 @@
+﻿// FontCache.h - 按字体名和字号缓存字体及其度量（不依赖MFC）
+//
+// 所有视图共用同一份字体：同一字体名和字号只创建、测量一次，
+// 缩放时切换到另一项，输入时直接使用缓存的字符宽度和行高，不再调用 GDI 测量。
+// TFont 是实际的字体对象（应用中为 CFont），创建和测量由调用方提供的函数完成。
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace TestableLogic
+{
+    struct FontKey
+    {
+        std::wstring face;
+        int pointSize;
+
+        bool operator<(const FontKey& other) const
+        {
+            if (pointSize != other.pointSize)
+                return pointSize < other.pointSize;
+            return face < other.face;
+        }
+    };
+
+    struct FontMetrics
+    {
+        int aveCharWidth;   // 编辑区按平均字符宽度排列
+        int digitWidth;     // 行号区按数字宽度排列
+        int lineHeight;
+    };
+
+    template <class TFont>
+    class FontCache
+    {
+    public:
+        struct Entry
+        {
+            TFont font;
+            FontMetrics metrics;
+        };
+
+        FontCache() : m_nCreated(0), m_nHits(0) {}
+
+        // 查找缓存项，不存在时调用 create(key, entry) 创建字体并填写度量；
+        // 返回的引用在 Clear() 之前一直有效
+        template <class CreateFunc>
+        const Entry& Get(const FontKey& key, CreateFunc create)
+        {
+            auto it = m_entries.find(key);
+            if (it != m_entries.end())
+            {
+                m_nHits++;
+                return *it->second;
+            }
+
+            std::unique_ptr<Entry> entry(new Entry());
+            entry->metrics = { 1, 1, 1 };
+            create(key, *entry);
+            m_nCreated++;
+            const Entry& result = *entry;
+            m_entries[key] = std::move(entry);
+            return result;
+        }
+
+        // 释放全部字体；调用方需要重新获取
+        void Clear() { m_entries.clear(); }
+
+        size_t GetSize() const { return m_entries.size(); }
+        uint64_t GetCreateCount() const { return m_nCreated; }
+        uint64_t GetHitCount() const { return m_nHits; }
+
+    private:
+        std::map<FontKey, std::unique_ptr<Entry>> m_entries;
+        uint64_t m_nCreated;
+        uint64_t m_nHits;
+    };
+}
@@ -0,0 +1,55 @@
+﻿// FrameScheduler.cpp - 合并编辑和滚动通知的实现
+#include "FrameScheduler.h"
+
+namespace TestableLogic
+{
+    FrameScheduler::FrameScheduler(uint32_t intervalMs)
+        : m_intervalMs(intervalMs)
+        , m_pending(0)
+        , m_lastFlushMs(0)
+        , m_bFlushed(false)
+        , m_nPosted(0)
+        , m_nCoalesced(0)
+        , m_nExecuted(0)
+    {
+    }
+
+    bool FrameScheduler::Post(unsigned work)
+    {
+        m_nPosted++;
+        bool bFirst = (m_pending == 0);
+        if (!bFirst)
+            m_nCoalesced++;
+        m_pending |= work;
+        return bFirst;
+    }
+
+    uint32_t FrameScheduler::GetDelay(uint64_t nowMs) const
+    {
+        if (!m_bFlushed || nowMs < m_lastFlushMs)
+            return 0;
+
+        uint64_t elapsed = nowMs - m_lastFlushMs;
+        return elapsed >= m_intervalMs ? 0 : static_cast<uint32_t>(m_intervalMs - elapsed);
+    }
+
+    unsigned FrameScheduler::TakePending(uint64_t nowMs)
+    {
+        unsigned work = m_pending;
+        m_pending = 0;
+        if (work)
+        {
+            m_nExecuted++;
+            m_lastFlushMs = nowMs;
+            m_bFlushed = true;
+        }
+        return work;
+    }
+
+    void FrameScheduler::ResetCounters()
+    {
+        m_nPosted = 0;
+        m_nCoalesced = 0;
+        m_nExecuted = 0;
+    }
+}
@@ -0,0 +1,54 @@
+﻿// FrameScheduler.h - 合并编辑和滚动通知，每帧处理一次（不依赖MFC）
+//
+// 连续输入、按住按键自动重复或粘贴时，编辑控件每个字符都会发一次 EN_CHANGE / EN_VSCROLL。
+// 通知到来时只记下需要做的工作（脏标记），第一次记录时安排一次刷新；
+// 到了下一帧再一次性同步文档、记录撤销、重画行号区。两次刷新之间至少间隔一帧。
+#pragma once
+
+#include <cstdint>
+
+// 一帧的时长（毫秒）
+#define FRAME_INTERVAL_MS       16
+
+// 待处理的工作
+#define FRAME_WORK_CONTENT      0x01    // 编辑控件内容变化：同步文档、记录撤销、更新行数
+#define FRAME_WORK_LARGE_TEXT   0x02    // 自绘编辑器内容变化：更新行数
+#define FRAME_WORK_SCROLL       0x04    // 滚动：重画行号区
+
+namespace TestableLogic
+{
+    class FrameScheduler
+    {
+    public:
+        explicit FrameScheduler(uint32_t intervalMs = FRAME_INTERVAL_MS);
+
+        // 记录工作；返回 true 表示此前没有待处理的工作，调用方需要安排一次刷新
+        bool Post(unsigned work);
+
+        bool HasPending() const { return m_pending != 0; }
+        unsigned GetPending() const { return m_pending; }
+
+        // 距离下次允许刷新还有多少毫秒（上次刷新后不足一帧时推迟到下一帧）
+        uint32_t GetDelay(uint64_t nowMs) const;
+
+        // 取出并清空全部待处理的工作，记为执行了一次
+        unsigned TakePending(uint64_t nowMs);
+
+        // 丢弃待处理的工作（如重新加载文档之后）
+        void Cancel() { m_pending = 0; }
+
+        uint64_t GetPostedCount() const { return m_nPosted; }
+        uint64_t GetCoalescedCount() const { return m_nCoalesced; }
+        uint64_t GetExecutedCount() const { return m_nExecuted; }
+        void ResetCounters();
+
+    private:
+        uint32_t m_intervalMs;
+        unsigned m_pending;
+        uint64_t m_lastFlushMs;
+        bool m_bFlushed;            // 是否刷新过（第一次不需要等待）
+        uint64_t m_nPosted;
+        uint64_t m_nCoalesced;      // 合并进已安排刷新的通知数
+        uint64_t m_nExecuted;       // 实际执行的刷新次数
+    };
+}
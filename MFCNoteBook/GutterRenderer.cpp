@@ -0,0 +1,279 @@
+﻿// GutterRenderer.cpp - 双缓冲的行号区绘制实现
+
+#include "pch.h"
+#include "framework.h"
+#include "GutterRenderer.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+using namespace TestableLogic;
+
+// 行号右侧留白（与原先 DrawText 的矩形一致）
+#define GUTTER_RIGHT_MARGIN     8
+
+CGutterRenderer::CGutterRenderer()
+    : m_pFont(nullptr)
+    , m_clrBg(RGB(240, 240, 240))
+    , m_clrText(RGB(128, 128, 128))
+    , m_clrBorder(RGB(200, 200, 200))
+    , m_pOldBitmap(nullptr)
+    , m_bitmapSize(0, 0)
+    , m_pOldGlyphBitmap(nullptr)
+    , m_nCharWidth(8)
+    , m_nLineHeight(16)
+    , m_bLabelFrame(false)
+    , m_labelFirstRow(0)
+    , m_bFrameValid(false)
+{
+    m_frame = { 0, 0, 0, 0, 0 };
+}
+
+CGutterRenderer::~CGutterRenderer()
+{
+    ReleaseGlyphs();
+    ReleaseBitmap();
+}
+
+void CGutterRenderer::SetFont(CFont* pFont, int nDigitWidth, int nLineHeight)
+{
+    m_pFont = pFont;
+    m_nCharWidth = max(1, nDigitWidth);
+    m_nLineHeight = max(1, nLineHeight);
+    ReleaseGlyphs();
+    m_bFrameValid = false;
+}
+
+void CGutterRenderer::SetColors(COLORREF clrBg, COLORREF clrText, COLORREF clrBorder)
+{
+    m_clrBg = clrBg;
+    m_clrText = clrText;
+    m_clrBorder = clrBorder;
+    ReleaseGlyphs();
+    m_bFrameValid = false;
+}
+
+void CGutterRenderer::ReleaseBitmap()
+{
+    if (m_memDC.GetSafeHdc())
+    {
+        m_memDC.SelectObject(m_pOldBitmap);
+        m_memDC.DeleteDC();
+    }
+    if (m_bitmap.GetSafeHandle())
+        m_bitmap.DeleteObject();
+    m_pOldBitmap = nullptr;
+    m_bitmapSize = CSize(0, 0);
+}
+
+void CGutterRenderer::ReleaseGlyphs()
+{
+    if (m_glyphDC.GetSafeHdc())
+    {
+        m_glyphDC.SelectObject(m_pOldGlyphBitmap);
+        m_glyphDC.DeleteDC();
+    }
+    if (m_glyphBitmap.GetSafeHandle())
+        m_glyphBitmap.DeleteObject();
+    m_pOldGlyphBitmap = nullptr;
+}
+
+void CGutterRenderer::EnsureBitmap(CDC* pDC, int cx, int cy)
+{
+    if (m_memDC.GetSafeHdc() && m_bitmapSize == CSize(cx, cy))
+        return;
+
+    ReleaseBitmap();
+    m_memDC.CreateCompatibleDC(pDC);
+    m_bitmap.CreateCompatibleBitmap(pDC, cx, cy);
+    m_pOldBitmap = m_memDC.SelectObject(&m_bitmap);
+    m_bitmapSize = CSize(cx, cy);
+    m_bFrameValid = false;
+}
+
+// 数字字形只在字体或颜色变化后渲染一次
+void CGutterRenderer::EnsureGlyphs(CDC* pDC)
+{
+    if (m_glyphDC.GetSafeHdc())
+        return;
+
+    m_glyphDC.CreateCompatibleDC(pDC);
+    CFont* pOldFont = m_pFont ? m_glyphDC.SelectObject(m_pFont) : nullptr;
+
+    m_glyphBitmap.CreateCompatibleBitmap(pDC, m_nCharWidth * 10, m_nLineHeight);
+    m_pOldGlyphBitmap = m_glyphDC.SelectObject(&m_glyphBitmap);
+    m_glyphDC.FillSolidRect(0, 0, m_nCharWidth * 10, m_nLineHeight, m_clrBg);
+    m_glyphDC.SetBkMode(TRANSPARENT);
+    m_glyphDC.SetTextColor(m_clrText);
+    for (int d = 0; d < 10; d++)
+    {
+        TCHAR ch = static_cast<TCHAR>(_T('0') + d);
+        m_glyphDC.TextOut(d * m_nCharWidth, 0, &ch, 1);
+    }
+
+    if (pOldFont)
+        m_glyphDC.SelectObject(pOldFont);
+    m_bFrameValid = false;
+}
+
+void CGutterRenderer::DrawNumber(size_t row, uint64_t lineNum)
+{
+    char digits[20];
+    size_t nDigits = FormatDecimal(lineNum, digits);
+    int x = m_bitmapSize.cx - GUTTER_RIGHT_MARGIN - static_cast<int>(nDigits) * m_nCharWidth;
+    int y = static_cast<int>(row) * m_nLineHeight;
+    for (size_t i = 0; i < nDigits; i++, x += m_nCharWidth)
+    {
+        m_memDC.BitBlt(x, y, m_nCharWidth, m_nLineHeight,
+            &m_glyphDC, (digits[i] - '0') * m_nCharWidth, 0, SRCCOPY);
+    }
+}
+
+// 按当前帧（m_frame 或 m_labels）绘制 [beginRow, endRow) 行
+void CGutterRenderer::DrawRows(size_t beginRow, size_t endRow)
+{
+    int width = m_bitmapSize.cx;
+    int top = static_cast<int>(beginRow) * m_nLineHeight;
+    int bottom = min(m_bitmapSize.cy, static_cast<int>(endRow) * m_nLineHeight);
+    if (top >= bottom)
+        return;
+
+    m_memDC.FillSolidRect(0, top, width - 1, bottom - top, m_clrBg);
+
+    for (size_t row = beginRow; row < endRow; row++)
+    {
+        if (m_bLabelFrame)
+        {
+            // 续行不显示行号
+            if (m_labels[row] != 0)
+                DrawNumber(row, m_labels[row]);
+            continue;
+        }
+
+        uint64_t lineNum = m_frame.firstLine + row + 1;
+        if (lineNum > m_frame.lineCount)
+            break;
+        DrawNumber(row, lineNum);
+    }
+
+    // 分隔线
+    m_memDC.FillSolidRect(width - 1, top, 1, bottom - top, m_clrBorder);
+}
+
+void CGutterRenderer::Paint(CDC* pDC, const CRect& rcGutter, uint64_t firstLine, uint64_t lineCount)
+{
+    Render(pDC, rcGutter, firstLine, lineCount, true);
+}
+
+void CGutterRenderer::Update(CDC* pDC, const CRect& rcGutter, uint64_t firstLine, uint64_t lineCount)
+{
+    Render(pDC, rcGutter, firstLine, lineCount, false);
+}
+
+void CGutterRenderer::PaintLabels(CDC* pDC, const CRect& rcGutter, uint64_t firstRow, const std::vector<uint64_t>& labels)
+{
+    RenderLabels(pDC, rcGutter, firstRow, labels, true);
+}
+
+void CGutterRenderer::UpdateLabels(CDC* pDC, const CRect& rcGutter, uint64_t firstRow, const std::vector<uint64_t>& labels)
+{
+    RenderLabels(pDC, rcGutter, firstRow, labels, false);
+}
+
+bool CGutterRenderer::BeginFrame(CDC* pDC, const CRect& rcGutter)
+{
+    if (rcGutter.Width() <= 0 || rcGutter.Height() <= 0)
+        return false;
+
+    EnsureGlyphs(pDC);
+    EnsureBitmap(pDC, rcGutter.Width(), rcGutter.Height());
+    return true;
+}
+
+void CGutterRenderer::ApplyUpdate(const GutterUpdate& update)
+{
+    if (!update.bFullRedraw && update.shiftRows != 0)
+    {
+        CRect rcScroll(0, 0, m_bitmapSize.cx, m_bitmapSize.cy);
+        m_memDC.ScrollDC(0, static_cast<int>(-update.shiftRows) * m_nLineHeight,
+            &rcScroll, &rcScroll, NULL, NULL);
+    }
+    DrawRows(update.dirtyBegin, update.dirtyEnd);
+    m_bFrameValid = true;
+}
+
+void CGutterRenderer::Render(CDC* pDC, const CRect& rcGutter, uint64_t firstLine, uint64_t lineCount, bool bBlitAll)
+{
+    LARGE_INTEGER start;
+    ::QueryPerformanceCounter(&start);
+    if (!BeginFrame(pDC, rcGutter))
+        return;
+
+    GutterFrame next;
+    next.firstLine = firstLine;
+    next.lineCount = lineCount;
+    next.rows = static_cast<size_t>((rcGutter.Height() + m_nLineHeight - 1) / m_nLineHeight);
+    next.width = rcGutter.Width();
+    next.lineHeight = m_nLineHeight;
+
+    GutterUpdate update = PlanGutterUpdate(m_frame, m_bFrameValid && !m_bLabelFrame, next);
+    bool bIdle = !update.bFullRedraw && update.shiftRows == 0 && update.dirtyBegin == update.dirtyEnd;
+    if (bIdle && !bBlitAll)
+        return;
+
+    m_frame = next;
+    m_bLabelFrame = false;
+    ApplyUpdate(update);
+    EndFrame(pDC, rcGutter, update, bBlitAll, start);
+}
+
+void CGutterRenderer::RenderLabels(CDC* pDC, const CRect& rcGutter, uint64_t firstRow,
+    const std::vector<uint64_t>& labels, bool bBlitAll)
+{
+    LARGE_INTEGER start;
+    ::QueryPerformanceCounter(&start);
+    if (!BeginFrame(pDC, rcGutter))
+        return;
+
+    // 可视行数由高度决定，调用方给出的行号不足时补 0
+    size_t rows = static_cast<size_t>((rcGutter.Height() + m_nLineHeight - 1) / m_nLineHeight);
+    std::vector<uint64_t> next(labels.begin(), labels.begin() + min(rows, labels.size()));
+    next.resize(rows, 0);
+
+    long long shift = static_cast<long long>(firstRow) - static_cast<long long>(m_labelFirstRow);
+    GutterUpdate update = PlanGutterLabelUpdate(m_labels, m_bFrameValid && m_bLabelFrame, next, shift);
+    bool bIdle = !update.bFullRedraw && update.shiftRows == 0 && update.dirtyBegin == update.dirtyEnd;
+    if (bIdle && !bBlitAll)
+        return;
+
+    m_labels.swap(next);
+    m_labelFirstRow = firstRow;
+    m_bLabelFrame = true;
+    ApplyUpdate(update);
+    EndFrame(pDC, rcGutter, update, bBlitAll, start);
+}
+
+void CGutterRenderer::EndFrame(CDC* pDC, const CRect& rcGutter, const GutterUpdate& update, bool bBlitAll,
+    const LARGE_INTEGER& start)
+{
+    if (bBlitAll || update.bFullRedraw || update.shiftRows != 0)
+    {
+        pDC->BitBlt(rcGutter.left, rcGutter.top, rcGutter.Width(), rcGutter.Height(), &m_memDC, 0, 0, SRCCOPY);
+    }
+    else
+    {
+        int top = static_cast<int>(update.dirtyBegin) * m_nLineHeight;
+        int bottom = min(rcGutter.Height(), static_cast<int>(update.dirtyEnd) * m_nLineHeight);
+        pDC->BitBlt(rcGutter.left, rcGutter.top + top, rcGutter.Width(), bottom - top, &m_memDC, 0, top, SRCCOPY);
+    }
+
+    LARGE_INTEGER freq, end;
+    ::QueryPerformanceFrequency(&freq);
+    ::QueryPerformanceCounter(&end);
+    double micros = static_cast<double>(end.QuadPart - start.QuadPart) * 1000000.0 / static_cast<double>(freq.QuadPart);
+    m_stats.AddFrame(micros, update.bFullRedraw);
+    TRACE(_T("行号区绘制: %.1f us（%s，平移 %I64d 行，重画 %Iu 行）平均 %.1f us / %I64u 帧\n"),
+        micros, update.bFullRedraw ? _T("全量") : _T("增量"), update.shiftRows,
+        update.dirtyEnd - update.dirtyBegin, m_stats.GetAverageMicros(), m_stats.frames);
+}
@@ -0,0 +1,78 @@
+﻿// GutterRenderer.h - 双缓冲的行号区绘制
+//
+// 行号区画在一张离屏位图上，数字 0-9 预先渲染到一条字形位图中，
+// 每个行号只是几次 BitBlt，不再逐行 Format + DrawText。滚动时平移离屏位图，
+// 只补画新露出的行，再一次性复制到屏幕。
+#pragma once
+
+#include "LineNumberGutter.h"
+
+#include <vector>
+
+class CGutterRenderer
+{
+public:
+    CGutterRenderer();
+    ~CGutterRenderer();
+
+    // 字体或颜色变化时字形缓存和离屏位图都需要重建；度量来自字体缓存，这里不再测量
+    void SetFont(CFont* pFont, int nDigitWidth, int nLineHeight);
+    void SetColors(COLORREF clrBg, COLORREF clrText, COLORREF clrBorder);
+
+    // 下次绘制时全量重画
+    void Invalidate() { m_bFrameValid = false; }
+
+    // 在 rcGutter 中绘制从 firstLine 开始的行号（行号从 1 显示），整个行号区复制到屏幕
+    void Paint(CDC* pDC, const CRect& rcGutter, uint64_t firstLine, uint64_t lineCount);
+
+    // 编辑或滚动之后直接更新窗口：没有滚动时只把重画的行复制到屏幕，什么都没变时不绘制
+    void Update(CDC* pDC, const CRect& rcGutter, uint64_t firstLine, uint64_t lineCount);
+
+    // 自动换行：labels[i] 为第 i 个可视行的行号（0 为续行，不显示），firstRow 为第一可见的可视行
+    void PaintLabels(CDC* pDC, const CRect& rcGutter, uint64_t firstRow, const std::vector<uint64_t>& labels);
+    void UpdateLabels(CDC* pDC, const CRect& rcGutter, uint64_t firstRow, const std::vector<uint64_t>& labels);
+
+    int GetLineHeight() const { return m_nLineHeight; }
+    const TestableLogic::PaintStats& GetStats() const { return m_stats; }
+    void ResetStats() { m_stats.Reset(); }
+
+private:
+    void EnsureBitmap(CDC* pDC, int cx, int cy);
+    void EnsureGlyphs(CDC* pDC);
+    void Render(CDC* pDC, const CRect& rcGutter, uint64_t firstLine, uint64_t lineCount, bool bBlitAll);
+    void RenderLabels(CDC* pDC, const CRect& rcGutter, uint64_t firstRow, const std::vector<uint64_t>& labels,
+        bool bBlitAll);
+    bool BeginFrame(CDC* pDC, const CRect& rcGutter);
+    void ApplyUpdate(const TestableLogic::GutterUpdate& update);
+    void EndFrame(CDC* pDC, const CRect& rcGutter, const TestableLogic::GutterUpdate& update, bool bBlitAll,
+        const LARGE_INTEGER& start);
+    void DrawRows(size_t beginRow, size_t endRow);
+    void DrawNumber(size_t row, uint64_t lineNum);
+    void ReleaseBitmap();
+    void ReleaseGlyphs();
+
+    CFont* m_pFont;
+    COLORREF m_clrBg;
+    COLORREF m_clrText;
+    COLORREF m_clrBorder;
+
+    // 离屏位图
+    CDC m_memDC;
+    CBitmap m_bitmap;
+    CBitmap* m_pOldBitmap;
+    CSize m_bitmapSize;
+
+    // 数字字形条：第 d 个数字位于 x = d * m_nCharWidth
+    CDC m_glyphDC;
+    CBitmap m_glyphBitmap;
+    CBitmap* m_pOldGlyphBitmap;
+    int m_nCharWidth;
+    int m_nLineHeight;
+
+    TestableLogic::GutterFrame m_frame;
+    bool m_bLabelFrame;                 // 上一帧是按可视行绘制的
+    uint64_t m_labelFirstRow;
+    std::vector<uint64_t> m_labels;
+    bool m_bFrameValid;
+    TestableLogic::PaintStats m_stats;
+};
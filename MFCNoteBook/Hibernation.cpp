@@ -0,0 +1,257 @@
+﻿// Hibernation.cpp - 文档休眠实现
+#include "Hibernation.h"
+#include "FileUtil.h"
+#include "LzCodec.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        uint32_t Fnv1a(const void* pData, size_t len)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(pData);
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < len; i++)
+            {
+                h ^= p[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+    }
+
+    HibernatedText::HibernatedText()
+        : m_length(0)
+        , m_bPacked(false)
+        , m_bStored(false)
+    {
+    }
+
+    HibernatedText::~HibernatedText()
+    {
+        Clear();
+    }
+
+    void HibernatedText::Clear()
+    {
+        if (!m_spillPath.empty())
+        {
+            FileUtil::Remove(m_spillPath);
+            m_spillPath.clear();
+        }
+        std::vector<uint8_t>().swap(m_data);
+        m_length = 0;
+        m_bPacked = false;
+        m_bStored = false;
+    }
+
+    // 只在本进程内取回，按本机字节序保存
+    void HibernatedText::Store(const char16_t* text, size_t len)
+    {
+        Clear();
+        const uint8_t* pRaw = reinterpret_cast<const uint8_t*>(text);
+        size_t nRaw = len * sizeof(char16_t);
+
+        std::vector<uint8_t> packed;
+        LzCompress(pRaw, nRaw, packed);
+        m_bPacked = packed.size() * 4 <= nRaw * 3;
+        if (m_bPacked)
+        {
+            packed.shrink_to_fit();
+            m_data.swap(packed);
+        }
+        else
+        {
+            m_data.assign(pRaw, pRaw + nRaw);
+        }
+        m_length = len;
+        m_bStored = true;
+    }
+
+    bool HibernatedText::Spill(const std::string& path, const UndoJournalCipher& cipher)
+    {
+        if (!m_bStored || IsSpilled() || !cipher.encrypt)
+            return false;
+
+        std::vector<uint8_t> payload;
+        if (!cipher.encrypt(m_data, payload))
+            return false;
+
+        HibernationFileHeader header = {};
+        memcpy(header.magic, HIBERNATE_FILE_MAGIC, HIBERNATE_FILE_MAGIC_SIZE);
+        header.version = HIBERNATE_FILE_VERSION;
+        header.packed = m_bPacked ? 1 : 0;
+        header.keyCheck = cipher.keyCheck;
+        header.length = m_length;
+        header.payloadLength = static_cast<uint32_t>(payload.size());
+        header.checksum = Fnv1a(payload.data(), payload.size());
+
+        FILE* fp = FileUtil::Open(path, "wb");
+        if (!fp)
+            return false;
+        bool bOk = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+            (payload.empty() || fwrite(payload.data(), payload.size(), 1, fp) == 1);
+        bOk = (fclose(fp) == 0) && bOk;
+        if (!bOk)
+        {
+            FileUtil::Remove(path);
+            return false;
+        }
+
+        m_spillPath = path;
+        std::vector<uint8_t>().swap(m_data);
+        return true;
+    }
+
+    bool HibernatedText::Load(const UndoJournalCipher* pCipher, std::u16string& text)
+    {
+        if (!m_bStored)
+            return false;
+
+        std::vector<uint8_t> spilled;
+        const std::vector<uint8_t>* pData = &m_data;
+        if (IsSpilled())
+        {
+            std::vector<uint8_t> file;
+            HibernationFileHeader header;
+            if (!pCipher || !pCipher->decrypt || !FileUtil::ReadAll(m_spillPath, file) || file.size() < sizeof(header))
+                return false;
+            memcpy(&header, file.data(), sizeof(header));
+            if (memcmp(header.magic, HIBERNATE_FILE_MAGIC, HIBERNATE_FILE_MAGIC_SIZE) != 0 ||
+                header.version != HIBERNATE_FILE_VERSION || header.keyCheck != pCipher->keyCheck ||
+                header.length != m_length || (header.packed != 0) != m_bPacked ||
+                header.payloadLength != file.size() - sizeof(header) ||
+                Fnv1a(file.data() + sizeof(header), header.payloadLength) != header.checksum)
+                return false;
+
+            std::vector<uint8_t> payload(file.begin() + sizeof(header), file.end());
+            if (!pCipher->decrypt(payload, spilled))
+                return false;
+            pData = &spilled;
+        }
+
+        size_t nRaw = m_length * sizeof(char16_t);
+        std::vector<uint8_t> raw;
+        if (m_bPacked)
+        {
+            if (!LzDecompress(pData->data(), pData->size(), nRaw, raw))
+                return false;
+            pData = &raw;
+        }
+        if (pData->size() != nRaw)
+            return false;
+
+        text.resize(m_length);
+        if (nRaw > 0)
+            memcpy(&text[0], pData->data(), nRaw);
+        Clear();
+        return true;
+    }
+
+    std::vector<uint32_t> SelectForHibernation(const std::vector<HibernationCandidate>& docs,
+        uint64_t idleMs, uint64_t budget)
+    {
+        std::vector<uint32_t> selected;
+        std::vector<const HibernationCandidate*> remaining;
+        uint64_t resident = 0;
+        for (const HibernationCandidate& doc : docs)
+        {
+            if (doc.bEligible && idleMs != 0 && doc.idleMs >= idleMs)
+            {
+                selected.push_back(doc.id);
+                continue;
+            }
+            resident += doc.residentBytes;
+            if (doc.bEligible)
+                remaining.push_back(&doc);
+        }
+        if (budget == 0 || resident <= budget)
+            return selected;
+
+        // 超出预算：空闲最久的先休眠
+        std::stable_sort(remaining.begin(), remaining.end(),
+            [](const HibernationCandidate* a, const HibernationCandidate* b) { return a->idleMs > b->idleMs; });
+        for (const HibernationCandidate* pDoc : remaining)
+        {
+            if (resident <= budget)
+                break;
+            selected.push_back(pDoc->id);
+            resident -= pDoc->residentBytes;
+        }
+        return selected;
+    }
+
+    std::vector<uint32_t> SelectForSpill(const std::vector<HibernatedEntry>& hibernated,
+        uint64_t residentBytes, uint64_t budget)
+    {
+        std::vector<uint32_t> selected;
+        uint64_t total = residentBytes;
+        std::vector<const HibernatedEntry*> inMemory;
+        for (const HibernatedEntry& entry : hibernated)
+        {
+            if (entry.memoryBytes == 0)
+                continue;
+            total += entry.memoryBytes;
+            inMemory.push_back(&entry);
+        }
+        if (budget == 0 || total <= budget)
+            return selected;
+
+        std::stable_sort(inMemory.begin(), inMemory.end(),
+            [](const HibernatedEntry* a, const HibernatedEntry* b) { return a->memoryBytes > b->memoryBytes; });
+        for (const HibernatedEntry* pEntry : inMemory)
+        {
+            if (total <= budget)
+                break;
+            selected.push_back(pEntry->id);
+            total -= pEntry->memoryBytes;
+        }
+        return selected;
+    }
+
+    std::string MakeSpillFileName(uint32_t processId, uint32_t docId)
+    {
+        char szName[64];
+        snprintf(szName, sizeof(szName), HIBERNATE_FILE_PREFIX "%08x-%u" HIBERNATE_FILE_EXT,
+            static_cast<unsigned>(processId), static_cast<unsigned>(docId));
+        return szName;
+    }
+
+    bool ParseSpillFileName(const std::string& name, uint32_t& processId)
+    {
+        const size_t nPrefix = sizeof(HIBERNATE_FILE_PREFIX) - 1;
+        const size_t nExt = sizeof(HIBERNATE_FILE_EXT) - 1;
+        if (name.size() < nPrefix + 8 + 2 + nExt ||
+            name.compare(0, nPrefix, HIBERNATE_FILE_PREFIX) != 0 ||
+            name.compare(name.size() - nExt, nExt, HIBERNATE_FILE_EXT) != 0 ||
+            name[nPrefix + 8] != '-')
+            return false;
+
+        uint32_t pid = 0;
+        for (size_t i = nPrefix; i < nPrefix + 8; i++)
+        {
+            char c = name[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9')
+                digit = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                digit = c - 'A' + 10;
+            else
+                return false;
+            pid = (pid << 4) | digit;
+        }
+        for (size_t i = nPrefix + 9; i < name.size() - nExt; i++)
+        {
+            if (name[i] < '0' || name[i] > '9')
+                return false;
+        }
+        processId = pid;
+        return true;
+    }
+}
@@ -0,0 +1,113 @@
+﻿// Hibernation.h - 长时间未使用的文档休眠（不依赖MFC）
+//
+// 打开很多文档时，每个文档的全文在文档、编辑控件和视图中各有一份。不活动的文档空闲一段时间后
+// 把全文压缩后留在内存中，释放这几份副本；内存仍超出预算时再把压缩的数据加密写入临时文件。
+// 文档重新激活时取回全文。休眠和写出的选择只看各文档的空闲时间和占用，由界面定时调用。
+#pragma once
+
+#include "UndoJournal.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============ 默认设置 ============
+// 不活动的文档空闲这么久（毫秒）后休眠
+#define HIBERNATE_DEFAULT_IDLE_MS       (5 * 60 * 1000)
+// 全部文档常驻内存的预算（字节），超出时提前休眠空闲最久的文档
+#define HIBERNATE_DEFAULT_BUDGET        (512ULL * 1024 * 1024)
+
+// ============ 临时文件格式常量 ============
+#define HIBERNATE_FILE_MAGIC            "MNHIBR01"
+#define HIBERNATE_FILE_MAGIC_SIZE       8
+#define HIBERNATE_FILE_VERSION          1
+// 临时文件名为 MFCNoteBook-<进程号（8 位十六进制）>-<文档编号>.hib
+#define HIBERNATE_FILE_PREFIX           "MFCNoteBook-"
+#define HIBERNATE_FILE_EXT              ".hib"
+
+namespace TestableLogic
+{
+    // ============ 磁盘布局（小端） ============
+    // [Header][加密后的负载]，负载为内存中保存的（可能压缩的）UTF-16 文本
+#pragma pack(push, 4)
+    struct HibernationFileHeader
+    {
+        char magic[HIBERNATE_FILE_MAGIC_SIZE];
+        uint32_t version;
+        uint32_t packed;                // 1 表示负载解密后还需要解压
+        uint64_t keyCheck;              // 加密密钥的校验值，密钥不同时不解密
+        uint64_t length;                // 文本长度（UTF-16 单元）
+        uint32_t payloadLength;
+        uint32_t checksum;              // 对加密后负载的 FNV-1a，只检查写入是否完整；负载由加密函数的 MAC 认证
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(HibernationFileHeader) == 40, "HibernationFileHeader layout changed");
+
+    // 一个休眠文档的全文：压缩后留在内存中，或写入临时文件
+    class HibernatedText
+    {
+    public:
+        HibernatedText();
+        ~HibernatedText();
+
+        HibernatedText(const HibernatedText&) = delete;
+        HibernatedText& operator=(const HibernatedText&) = delete;
+
+        // 保存 text（压缩不到原来的 3/4 时保存原样），之前保存的内容被替换
+        void Store(const char16_t* text, size_t len);
+        // 把内存中的数据加密写入 path 并释放；失败时数据仍留在内存中
+        bool Spill(const std::string& path, const UndoJournalCipher& cipher);
+        // 取回文本，成功后不再持有数据（临时文件随之删除）；失败时保持原状
+        bool Load(const UndoJournalCipher* pCipher, std::u16string& text);
+        void Clear();
+
+        bool IsStored() const { return m_bStored; }
+        bool IsSpilled() const { return !m_spillPath.empty(); }
+        // 原文本的字节数
+        size_t GetTextBytes() const { return m_length * sizeof(char16_t); }
+        // 在内存中占用的字节数（写入临时文件后为 0）
+        size_t GetMemoryBytes() const { return m_data.size(); }
+
+    private:
+        std::vector<uint8_t> m_data;
+        size_t m_length;
+        bool m_bPacked;
+        bool m_bStored;
+        std::string m_spillPath;
+    };
+
+    // ============ 休眠的选择 ============
+
+    struct HibernationCandidate
+    {
+        uint32_t id;
+        uint64_t idleMs;                // 距上次使用的时间
+        uint64_t residentBytes;         // 常驻内存（全文的各份副本和撤销历史）
+        bool bEligible;                 // 可以休眠：不是活动文档，也不是超大文件或正在载入的文档
+    };
+
+    // 空闲超过 idleMs 的可休眠文档全部选出；其余文档的常驻总量仍超出 budget 时，
+    // 再按空闲时间从长到短选出，直到不超出。idleMs 或 budget 为 0 时不按该条件选择
+    std::vector<uint32_t> SelectForHibernation(const std::vector<HibernationCandidate>& docs,
+        uint64_t idleMs, uint64_t budget);
+
+    struct HibernatedEntry
+    {
+        uint32_t id;
+        uint64_t memoryBytes;           // 压缩数据在内存中的占用，已写入临时文件的为 0
+    };
+
+    // 常驻内存加上休眠数据的总量超出 budget 时，选出写入临时文件的休眠文档（占用大的先写）
+    std::vector<uint32_t> SelectForSpill(const std::vector<HibernatedEntry>& hibernated,
+        uint64_t residentBytes, uint64_t budget);
+
+    // ============ 临时文件名 ============
+
+    // 进程 processId 中文档 docId 的临时文件名（不含目录）
+    std::string MakeSpillFileName(uint32_t processId, uint32_t docId);
+    // 从临时文件名中取出写入它的进程号；不是休眠临时文件的名字时返回 false。
+    // 进程崩溃后留下的临时文件由下次启动时按进程号找出并删除
+    bool ParseSpillFileName(const std::string& name, uint32_t& processId);
+}
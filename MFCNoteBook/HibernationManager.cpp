@@ -0,0 +1,165 @@
+﻿// HibernationManager.cpp - 文档休眠的定时检查实现
+
+#include "pch.h"
+#include "framework.h"
+#include "MFCNoteBook.h"
+#include "HibernationManager.h"
+#include "MFCNoteBookDoc.h"
+
+#include <string>
+#include <vector>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+CHibernationManager::CHibernationManager()
+    : m_idleMs(HIBERNATE_DEFAULT_IDLE_MS)
+    , m_budget(HIBERNATE_DEFAULT_BUDGET)
+{
+}
+
+void CHibernationManager::LoadSettings()
+{
+    m_idleMs = static_cast<uint64_t>(theApp.GetProfileInt(_T("Settings"), _T("HibernateIdleSeconds"),
+        HIBERNATE_DEFAULT_IDLE_MS / 1000)) * 1000;
+    m_budget = static_cast<uint64_t>(theApp.GetProfileInt(_T("Settings"), _T("HibernateBudgetMB"),
+        static_cast<int>(HIBERNATE_DEFAULT_BUDGET >> 20))) << 20;
+}
+
+// 进程号可能已被其他程序重用，只有同一个程序的进程仍在运行时才保留它的临时文件
+bool CHibernationManager::IsOwnerRunning(DWORD dwProcessId)
+{
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, dwProcessId);
+    if (hProcess == NULL)
+    {
+        // 没有权限查询的进程存在但无法判断，保留
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+
+    bool bRunning = false;
+    DWORD dwExitCode = 0;
+    if (GetExitCodeProcess(hProcess, &dwExitCode) && dwExitCode == STILL_ACTIVE)
+    {
+        TCHAR szOwner[MAX_PATH];
+        TCHAR szSelf[MAX_PATH];
+        DWORD nOwner = MAX_PATH;
+        if (!QueryFullProcessImageName(hProcess, 0, szOwner, &nOwner) ||
+            GetModuleFileName(NULL, szSelf, MAX_PATH) == 0)
+        {
+            bRunning = true;
+        }
+        else
+        {
+            CString strOwner(szOwner), strSelf(szSelf);
+            bRunning = strOwner.Mid(strOwner.ReverseFind(_T('\\')) + 1).CompareNoCase(
+                strSelf.Mid(strSelf.ReverseFind(_T('\\')) + 1)) == 0;
+        }
+    }
+    CloseHandle(hProcess);
+    return bRunning;
+}
+
+void CHibernationManager::SweepStaleFiles()
+{
+    TCHAR szTemp[MAX_PATH];
+    if (GetTempPath(MAX_PATH, szTemp) == 0)
+        return;
+
+    CString strPattern(szTemp);
+    strPattern += _T(HIBERNATE_FILE_PREFIX) _T("*") _T(HIBERNATE_FILE_EXT);
+    DWORD dwSelf = GetCurrentProcessId();
+    CFileFind finder;
+    BOOL bFound = finder.FindFile(strPattern);
+    while (bFound)
+    {
+        bFound = finder.FindNextFile();
+        if (finder.IsDirectory())
+            continue;
+
+        uint32_t processId = 0;
+        if (!TestableLogic::ParseSpillFileName(std::string(CT2A(finder.GetFileName())), processId) ||
+            processId == dwSelf || IsOwnerRunning(processId))
+            continue;
+
+        if (DeleteFile(finder.GetFilePath()))
+        {
+            TRACE(_T("删除残留的休眠临时文件: %s\n"), finder.GetFilePath().GetString());
+        }
+    }
+    finder.Close();
+}
+
+CString CHibernationManager::FormatBytes(uint64_t nBytes)
+{
+    CString strBytes;
+    strBytes.Format(_T("%.1f MB"), static_cast<double>(nBytes) / (1024.0 * 1024.0));
+    return strBytes;
+}
+
+void CHibernationManager::Check(CMDIFrameWnd* pMainFrame)
+{
+    CMDIChildWnd* pActiveChild = pMainFrame ? pMainFrame->MDIGetActive() : NULL;
+    CDocument* pActiveDoc = pActiveChild ? pActiveChild->GetActiveDocument() : NULL;
+
+    // 候选的编号就是在 docs 中的下标
+    std::vector<CMFCNoteBookDoc*> docs;
+    std::vector<TestableLogic::HibernationCandidate> candidates;
+    DWORD dwNow = GetTickCount();
+    POSITION posTemplate = theApp.GetFirstDocTemplatePosition();
+    while (posTemplate)
+    {
+        CDocTemplate* pTemplate = theApp.GetNextDocTemplate(posTemplate);
+        POSITION posDoc = pTemplate->GetFirstDocPosition();
+        while (posDoc)
+        {
+            CMFCNoteBookDoc* pDoc = DYNAMIC_DOWNCAST(CMFCNoteBookDoc, pTemplate->GetNextDoc(posDoc));
+            if (!pDoc)
+                continue;
+
+            TestableLogic::HibernationCandidate candidate;
+            candidate.id = static_cast<uint32_t>(docs.size());
+            candidate.idleMs = dwNow - pDoc->GetLastActivity();
+            candidate.residentBytes = pDoc->IsHibernated() ? 0 : pDoc->GetResidentBytes();
+            candidate.bEligible = pDoc != pActiveDoc && pDoc->CanHibernate();
+            docs.push_back(pDoc);
+            candidates.push_back(candidate);
+        }
+    }
+
+    for (uint32_t id : TestableLogic::SelectForHibernation(candidates, m_idleMs, m_budget))
+    {
+        docs[id]->Hibernate();
+    }
+
+    // 休眠后重新统计；压缩数据加上常驻内存仍超出预算时写入临时文件
+    uint64_t resident = 0;
+    std::vector<TestableLogic::HibernatedEntry> hibernated;
+    for (size_t i = 0; i < docs.size(); i++)
+    {
+        if (docs[i]->IsHibernated())
+        {
+            TestableLogic::HibernatedEntry entry = { static_cast<uint32_t>(i), docs[i]->GetHibernatedText().GetMemoryBytes() };
+            hibernated.push_back(entry);
+        }
+        else
+        {
+            resident += docs[i]->GetResidentBytes();
+        }
+    }
+    for (uint32_t id : TestableLogic::SelectForSpill(hibernated, resident, m_budget))
+    {
+        if (!docs[id]->SpillHibernated())
+            TRACE(_T("休眠文档写入临时文件失败: %s\n"), docs[id]->GetTitle().GetString());
+    }
+
+    uint64_t textBytes = 0, memoryBytes = 0;
+    for (const TestableLogic::HibernatedEntry& entry : hibernated)
+    {
+        const TestableLogic::HibernatedText& text = docs[entry.id]->GetHibernatedText();
+        textBytes += text.GetTextBytes();
+        memoryBytes += text.GetMemoryBytes();
+    }
+    m_strStatus.Format(_T("常驻 %s | 休眠 %d 个 %s（内存 %s）"), FormatBytes(resident).GetString(),
+        static_cast<int>(hibernated.size()), FormatBytes(textBytes).GetString(), FormatBytes(memoryBytes).GetString());
+}
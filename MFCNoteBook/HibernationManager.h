@@ -0,0 +1,30 @@
+﻿// HibernationManager.h - 定时让空闲的文档休眠，统计常驻和休眠的内存
+//
+// 主窗口定时调用 Check：不活动且空闲超过设定时间的文档休眠，全部文档的常驻内存超出预算时
+// 提前休眠空闲最久的文档，仍超出时把休眠的数据加密写入临时文件。
+// 设置保存在注册表 Settings 下（HibernateIdleSeconds、HibernateBudgetMB，为 0 时关闭该条件）。
+#pragma once
+
+#include "Hibernation.h"
+
+class CHibernationManager
+{
+public:
+    CHibernationManager();
+
+    void LoadSettings();
+    // 删除写入它的进程已经结束（通常是崩溃）而留在 %TEMP% 下的休眠临时文件，启动时调用
+    static void SweepStaleFiles();
+    // 选择并休眠文档，更新状态栏的统计
+    void Check(CMDIFrameWnd* pMainFrame);
+    // 状态栏显示的常驻/休眠字节数
+    const CString& GetStatusText() const { return m_strStatus; }
+
+private:
+    static CString FormatBytes(uint64_t nBytes);
+    static bool IsOwnerRunning(DWORD dwProcessId);
+
+    uint64_t m_idleMs;
+    uint64_t m_budget;
+    CString m_strStatus;
+};
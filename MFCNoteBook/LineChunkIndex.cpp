@@ -0,0 +1,141 @@
+﻿// LineChunkIndex.cpp - 超长行分块排版索引实现
+#include "LineChunkIndex.h"
+
+#include <algorithm>
+
+namespace TestableLogic
+{
+    LineChunkIndex::LineChunkIndex()
+        : m_wrapColumns(0)
+    {
+    }
+
+    void LineChunkIndex::Clear()
+    {
+        m_chunks.clear();
+    }
+
+    size_t LineChunkIndex::GetChunkColumns(const ChunkInfo& chunk, size_t startColumn)
+    {
+        if (!chunk.bTab)
+            return chunk.headColumns;
+
+        // 第一个制表符从所在列跳到下一个制表位
+        size_t tabColumn = startColumn + chunk.headColumns;
+        size_t tabStop = (tabColumn / TEXTLAYOUT_TAB_SIZE + 1) * TEXTLAYOUT_TAB_SIZE;
+        return tabStop - startColumn + chunk.tailColumns;
+    }
+
+    void LineChunkIndex::Split(const char* data, size_t len, std::vector<size_t>& ends)
+    {
+        ends.clear();
+        size_t pos = 0;
+        while (pos < len)
+        {
+            if (len - pos <= LINE_CHUNK_BYTES)
+            {
+                ends.push_back(len);
+                break;
+            }
+
+            // 退到字符开头（续字节之前），保证块边界也是 DecodeLine 的字符边界
+            size_t end = pos + LINE_CHUNK_BYTES;
+            while (end > pos && (static_cast<unsigned char>(data[end]) & 0xC0) == 0x80)
+                end--;
+            if (end == pos)
+                end = pos + LINE_CHUNK_BYTES;
+
+            // 优先在空白之后断开：自动换行时块边界就是一个可视行的结尾
+            size_t limit = (end - pos > LINE_CHUNK_BREAK_SEARCH) ? end - LINE_CHUNK_BREAK_SEARCH : pos + 1;
+            for (size_t k = end; k > limit; k--)
+            {
+                if (data[k - 1] == ' ' || data[k - 1] == '\t')
+                {
+                    end = k;
+                    break;
+                }
+            }
+
+            ends.push_back(end);
+            pos = end;
+        }
+    }
+
+    void LineChunkIndex::ReplaceChunks(size_t first, size_t count, const std::vector<ChunkInfo>& chunks)
+    {
+        first = (std::min)(first, m_chunks.size());
+        count = (std::min)(count, m_chunks.size() - first);
+
+        Entry base = {};
+        if (first > 0)
+            base = m_chunks[first - 1];
+        Entry oldEnd = (count > 0) ? m_chunks[first + count - 1] : base;
+
+        std::vector<Entry> entries(chunks.size());
+        Entry sum = base;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            sum.info = chunks[i];
+            sum.byteEnd += chunks[i].bytes;
+            sum.unitEnd += chunks[i].units;
+            sum.columnEnd += GetChunkColumns(chunks[i], sum.columnEnd);
+            sum.rowEnd += chunks[i].rows;
+            entries[i] = sum;
+        }
+
+        // 其后各块的字节、单元、可视行整体平移（无符号回绕的加法对缩短同样成立）；
+        // 列宽与起始列有关，含制表符的块要按新的起始列重新计算，一直累加到行尾
+        size_t column = sum.columnEnd;
+        for (size_t i = first + count; i < m_chunks.size(); i++)
+        {
+            m_chunks[i].byteEnd += sum.byteEnd - oldEnd.byteEnd;
+            m_chunks[i].unitEnd += sum.unitEnd - oldEnd.unitEnd;
+            m_chunks[i].rowEnd += sum.rowEnd - oldEnd.rowEnd;
+            column += GetChunkColumns(m_chunks[i].info, column);
+            m_chunks[i].columnEnd = column;
+        }
+
+        m_chunks.erase(m_chunks.begin() + first, m_chunks.begin() + first + count);
+        m_chunks.insert(m_chunks.begin() + first, entries.begin(), entries.end());
+    }
+
+    void LineChunkIndex::GetEditRange(size_t start, size_t oldLen, size_t& first, size_t& count) const
+    {
+        if (m_chunks.empty())
+        {
+            first = 0;
+            count = 0;
+            return;
+        }
+        first = FindChunkByByte(start > 0 ? start - 1 : 0);
+        size_t last = FindChunkByByte(start + oldLen);
+        count = last - first + 1;
+    }
+
+    size_t LineChunkIndex::FindChunkByByte(size_t offset) const
+    {
+        if (m_chunks.empty())
+            return 0;
+        auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), offset,
+            [](size_t value, const Entry& e) { return value < e.byteEnd; });
+        return (std::min)(static_cast<size_t>(it - m_chunks.begin()), m_chunks.size() - 1);
+    }
+
+    size_t LineChunkIndex::FindChunkByColumn(size_t column) const
+    {
+        if (m_chunks.empty())
+            return 0;
+        auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), column,
+            [](size_t value, const Entry& e) { return value < e.columnEnd; });
+        return (std::min)(static_cast<size_t>(it - m_chunks.begin()), m_chunks.size() - 1);
+    }
+
+    size_t LineChunkIndex::FindChunkByRow(size_t row) const
+    {
+        if (m_chunks.empty())
+            return 0;
+        auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), row,
+            [](size_t value, const Entry& e) { return value < e.rowEnd; });
+        return (std::min)(static_cast<size_t>(it - m_chunks.begin()), m_chunks.size() - 1);
+    }
+}
@@ -0,0 +1,96 @@
+﻿// LineChunkIndex.h - 超长行的分块排版索引（不依赖MFC）
+//
+// 单行几十 MB 的文件（压缩过的 JSON、日志、数据导出）如果每次都解码整行再逐字符累加列宽，
+// 移动光标、滚动、绘制都是 O(行长)。超长行按不超过 LINE_CHUNK_BYTES 的块切开，
+// 每块记录字节数、UTF-16 单元数、列宽和自动换行时的可视行数，并保存前缀和，
+// 偏移、列、可视行互相换算只需二分查找到块，再解码这一块。
+// 块的列宽随起始列变化（制表位对齐到整行的网格），因此按第一个制表符分成前后两段记录：
+// 前段的列数与起始列无关，第一个制表符之后从制表位开始，后段的列数也与起始列无关。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TextLayout.h"
+
+// 达到这个字节数的行按块排版
+#define LONG_LINE_BYTES         (64 * 1024)
+// 每块的最大字节数；切分时优先在空白之后断开，向前最多找 LINE_CHUNK_BREAK_SEARCH 字节
+#define LINE_CHUNK_BYTES        4096
+#define LINE_CHUNK_BREAK_SEARCH 256
+
+namespace TestableLogic
+{
+    class LineChunkIndex
+    {
+    public:
+        // 一块的度量（由调用方解码后给出）
+        struct ChunkInfo
+        {
+            size_t bytes;
+            size_t units;
+            size_t headColumns;     // 第一个制表符之前的列数（没有制表符时为整块）
+            size_t tailColumns;     // 第一个制表符之后的列数（从制表位算起）
+            bool bTab;              // 是否含有制表符
+            size_t rows;            // 自动换行时的可视行数，不换行时为 1
+        };
+
+        // 从 startColumn 开始时这一块占的列数
+        static size_t GetChunkColumns(const ChunkInfo& chunk, size_t startColumn);
+
+        LineChunkIndex();
+
+        void Clear();
+
+        // 把 data[0, len) 切成块：不拆开 UTF-8 序列，尽量在空白之后断开；返回每块的结束位置
+        static void Split(const char* data, size_t len, std::vector<size_t>& ends);
+
+        // 用 chunks 替换 [first, first + count) 块，其后各块的前缀和随之平移（列按新的起始列重新累加）
+        void ReplaceChunks(size_t first, size_t count, const std::vector<ChunkInfo>& chunks);
+
+        // 行内编辑：[start, start + oldLen) 涉及的块范围，在块边界上的编辑包含前一块以便合并
+        void GetEditRange(size_t start, size_t oldLen, size_t& first, size_t& count) const;
+
+        // 度量时使用的折行宽度（0 表示不换行），宽度变化时调用方整体重建
+        size_t GetWrapColumns() const { return m_wrapColumns; }
+        void SetWrapColumns(size_t wrapColumns) { m_wrapColumns = wrapColumns; }
+
+        size_t GetChunkCount() const { return m_chunks.size(); }
+        bool IsEmpty() const { return m_chunks.empty(); }
+
+        size_t GetByteLength() const { return m_chunks.empty() ? 0 : m_chunks.back().byteEnd; }
+        size_t GetUnitCount() const { return m_chunks.empty() ? 0 : m_chunks.back().unitEnd; }
+        size_t GetColumns() const { return m_chunks.empty() ? 0 : m_chunks.back().columnEnd; }
+        size_t GetRows() const { return m_chunks.empty() ? 1 : m_chunks.back().rowEnd; }
+
+        // 块的起止（行内字节偏移、UTF-16 单元、列、可视行）
+        size_t GetByteStart(size_t chunk) const { return chunk ? m_chunks[chunk - 1].byteEnd : 0; }
+        size_t GetByteEnd(size_t chunk) const { return m_chunks[chunk].byteEnd; }
+        size_t GetUnitStart(size_t chunk) const { return chunk ? m_chunks[chunk - 1].unitEnd : 0; }
+        size_t GetUnitEnd(size_t chunk) const { return m_chunks[chunk].unitEnd; }
+        size_t GetColumnStart(size_t chunk) const { return chunk ? m_chunks[chunk - 1].columnEnd : 0; }
+        size_t GetColumnEnd(size_t chunk) const { return m_chunks[chunk].columnEnd; }
+        size_t GetRowStart(size_t chunk) const { return chunk ? m_chunks[chunk - 1].rowEnd : 0; }
+        size_t GetRowEnd(size_t chunk) const { return m_chunks[chunk].rowEnd; }
+
+        // 所在的块（二分查找），越过末尾时返回最后一块
+        size_t FindChunkByByte(size_t offset) const;
+        size_t FindChunkByColumn(size_t column) const;
+        size_t FindChunkByRow(size_t row) const;
+
+    private:
+        // 块的度量和第 i 块结束处的累计值
+        struct Entry
+        {
+            ChunkInfo info;
+            size_t byteEnd;
+            size_t unitEnd;
+            size_t columnEnd;
+            size_t rowEnd;
+        };
+
+        size_t m_wrapColumns;
+        std::vector<Entry> m_chunks;
+    };
+}
@@ -0,0 +1,322 @@
+﻿// LineEnding.cpp - 换行符检测与转换实现
+#include "LineEnding.h"
+#include "SimdSupport.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        const char16_t CH_CR = u'\r';
+        const char16_t CH_LF = u'\n';
+
+        // 扫描过程中的累计量：CRLF 在最后统一从 CR/LF 的总数中扣除
+        struct CountState
+        {
+            size_t lf;
+            size_t cr;
+            size_t pairs;
+            bool bPrevCr;       // 上一个单元是 CR（跨块的 CRLF）
+        };
+
+        void CountScalar(const char16_t* p, const char16_t* end, CountState& state)
+        {
+            for (; p < end; p++)
+            {
+                if (*p == CH_LF)
+                {
+                    state.lf++;
+                    if (state.bPrevCr)
+                        state.pairs++;
+                    state.bPrevCr = false;
+                }
+                else
+                {
+                    state.bPrevCr = (*p == CH_CR);
+                    if (state.bPrevCr)
+                        state.cr++;
+                }
+            }
+        }
+
+        // 单个换行在源中的长度：CRLF 为 2，CR/LF 为 1
+        inline size_t BreakLength(const char16_t* p, const char16_t* end)
+        {
+            return (p[0] == CH_CR && p + 1 < end && p[1] == CH_LF) ? 2 : 1;
+        }
+
+        inline size_t TargetWidth(LineEnding target)
+        {
+            return (target == LineEnding::CrLf) ? 2 : 1;
+        }
+
+        inline void WriteBreak(char16_t*& out, LineEnding target)
+        {
+            switch (target)
+            {
+            case LineEnding::CrLf:
+                *out++ = CH_CR;
+                *out++ = CH_LF;
+                break;
+            case LineEnding::Lf:
+                *out++ = CH_LF;
+                break;
+            default:
+                *out++ = CH_CR;
+                break;
+            }
+        }
+
+        // 转换一个换行，dst 放不下时返回 false
+        inline bool ConvertBreak(const char16_t*& p, const char16_t* end, char16_t*& out,
+            const char16_t* outEnd, LineEnding target)
+        {
+            if (static_cast<size_t>(outEnd - out) < TargetWidth(target))
+                return false;
+            p += BreakLength(p, end);
+            WriteBreak(out, target);
+            return true;
+        }
+
+        void ConvertScalar(const char16_t*& p, const char16_t* end, char16_t*& out,
+            const char16_t* outEnd, LineEnding target)
+        {
+            while (p < end)
+            {
+                if (*p == CH_CR || *p == CH_LF)
+                {
+                    if (!ConvertBreak(p, end, out, outEnd, target))
+                        return;
+                }
+                else
+                {
+                    if (out == outEnd)
+                        return;
+                    *out++ = *p++;
+                }
+            }
+        }
+
+#if SIMD_X86
+        // ============ SSE2 ============
+
+        // 计数在 16 位通道里累加，每个通道每次至多加 1，溢出前归约到总数
+        const size_t COUNT_FLUSH_BLOCKS = 32768;
+
+        template <class V, int N>
+        inline size_t SumLanes16(const V& acc)
+        {
+            uint16_t lanes[N];
+            memcpy(lanes, &acc, sizeof(lanes));
+            size_t sum = 0;
+            for (int i = 0; i < N; i++)
+                sum += lanes[i];
+            return sum;
+        }
+
+        // 全向量计数：CRLF 通过再读一次错开一个单元的数据来判断，不需要逐块提取掩码
+        void CountSSE2(const char16_t* src, size_t len, CountState& state)
+        {
+            const __m128i lf = _mm_set1_epi16(CH_LF);
+            const __m128i cr = _mm_set1_epi16(CH_CR);
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            while (end - p > 8)
+            {
+                __m128i lfAcc = _mm_setzero_si128();
+                __m128i crAcc = _mm_setzero_si128();
+                __m128i pairAcc = _mm_setzero_si128();
+                for (size_t n = 0; n < COUNT_FLUSH_BLOCKS && end - p > 8; n++, p += 8)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+                    __m128i isCr = _mm_cmpeq_epi16(v, cr);
+                    lfAcc = _mm_sub_epi16(lfAcc, _mm_cmpeq_epi16(v, lf));
+                    crAcc = _mm_sub_epi16(crAcc, isCr);
+                    pairAcc = _mm_sub_epi16(pairAcc, _mm_and_si128(isCr, _mm_cmpeq_epi16(next, lf)));
+                }
+                state.lf += SumLanes16<__m128i, 8>(lfAcc);
+                state.cr += SumLanes16<__m128i, 8>(crAcc);
+                state.pairs += SumLanes16<__m128i, 8>(pairAcc);
+            }
+            // 向量部分已统计到 p 之前的 CR 与 p 处 LF 组成的 CRLF
+            state.bPrevCr = false;
+            CountScalar(p, end, state);
+        }
+
+        void ConvertSSE2(const char16_t*& p, const char16_t* end, char16_t*& out,
+            const char16_t* outEnd, LineEnding target)
+        {
+            const __m128i lf = _mm_set1_epi16(CH_LF);
+            const __m128i cr = _mm_set1_epi16(CH_CR);
+            // 整块写出后只前进到第一个换行处，因此要求源和目标都至少剩一个块
+            while (end - p >= 8 && outEnd - out >= 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi16(v, lf), _mm_cmpeq_epi16(v, cr))));
+                if (mask == 0)
+                {
+                    p += 8;
+                    out += 8;
+                    continue;
+                }
+                size_t k = static_cast<size_t>(CountTrailingZeros(mask)) / 2;
+                p += k;
+                out += k;
+                if (!ConvertBreak(p, end, out, outEnd, target))
+                    return;
+            }
+            ConvertScalar(p, end, out, outEnd, target);
+        }
+
+        // ============ AVX2 ============
+
+        SIMD_TARGET_AVX2 void CountAVX2(const char16_t* src, size_t len, CountState& state)
+        {
+            const __m256i lf = _mm256_set1_epi16(CH_LF);
+            const __m256i cr = _mm256_set1_epi16(CH_CR);
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            while (end - p > 16)
+            {
+                __m256i lfAcc = _mm256_setzero_si256();
+                __m256i crAcc = _mm256_setzero_si256();
+                __m256i pairAcc = _mm256_setzero_si256();
+                for (size_t n = 0; n < COUNT_FLUSH_BLOCKS && end - p > 16; n++, p += 16)
+                {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+                    __m256i isCr = _mm256_cmpeq_epi16(v, cr);
+                    lfAcc = _mm256_sub_epi16(lfAcc, _mm256_cmpeq_epi16(v, lf));
+                    crAcc = _mm256_sub_epi16(crAcc, isCr);
+                    pairAcc = _mm256_sub_epi16(pairAcc, _mm256_and_si256(isCr, _mm256_cmpeq_epi16(next, lf)));
+                }
+                state.lf += SumLanes16<__m256i, 16>(lfAcc);
+                state.cr += SumLanes16<__m256i, 16>(crAcc);
+                state.pairs += SumLanes16<__m256i, 16>(pairAcc);
+            }
+            state.bPrevCr = false;
+            CountScalar(p, end, state);
+        }
+
+        SIMD_TARGET_AVX2 void ConvertAVX2(const char16_t*& p, const char16_t* end, char16_t*& out,
+            const char16_t* outEnd, LineEnding target)
+        {
+            const __m256i lf = _mm256_set1_epi16(CH_LF);
+            const __m256i cr = _mm256_set1_epi16(CH_CR);
+            while (end - p >= 16 && outEnd - out >= 16)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                    _mm256_or_si256(_mm256_cmpeq_epi16(v, lf), _mm256_cmpeq_epi16(v, cr))));
+                if (mask == 0)
+                {
+                    p += 16;
+                    out += 16;
+                    continue;
+                }
+                size_t k = static_cast<size_t>(CountTrailingZeros(mask)) / 2;
+                p += k;
+                out += k;
+                if (!ConvertBreak(p, end, out, outEnd, target))
+                    return;
+            }
+            ConvertSSE2(p, end, out, outEnd, target);
+        }
+#endif
+    }
+
+    // ============ 检测 ============
+
+    LineEndingStats CountLineEndings(const char16_t* src, size_t len)
+    {
+        CountState state = { 0, 0, 0, false };
+        if (src && len > 0)
+        {
+#if SIMD_X86
+            SimdLevel level = GetSimdLevel();
+            if (level == SimdLevel::AVX2)
+                CountAVX2(src, len, state);
+            else if (level != SimdLevel::Scalar)
+                CountSSE2(src, len, state);
+            else
+#endif
+                CountScalar(src, src + len, state);
+        }
+
+        LineEndingStats stats;
+        stats.crlf = state.pairs;
+        stats.lf = state.lf - state.pairs;
+        stats.cr = state.cr - state.pairs;
+        return stats;
+    }
+
+    LineEnding GetDominantLineEnding(const LineEndingStats& stats)
+    {
+        if (stats.crlf >= stats.lf && stats.crlf >= stats.cr)
+            return LineEnding::CrLf;
+        return (stats.lf >= stats.cr) ? LineEnding::Lf : LineEnding::Cr;
+    }
+
+    bool IsMixedLineEndings(const LineEndingStats& stats)
+    {
+        int kinds = (stats.crlf > 0 ? 1 : 0) + (stats.lf > 0 ? 1 : 0) + (stats.cr > 0 ? 1 : 0);
+        return kinds > 1;
+    }
+
+    const char* GetLineEndingName(LineEnding ending)
+    {
+        switch (ending)
+        {
+        case LineEnding::CrLf:  return "CRLF";
+        case LineEnding::Lf:    return "LF";
+        case LineEnding::Cr:    return "CR";
+        }
+        return "Unknown";
+    }
+
+    // ============ 转换 ============
+
+    size_t GetConvertedLength(const LineEndingStats& stats, size_t len, LineEnding target)
+    {
+        size_t breakUnits = stats.crlf * 2 + stats.lf + stats.cr;
+        return len - breakUnits + GetLineBreakCount(stats) * TargetWidth(target);
+    }
+
+    LineEndingConvertResult ConvertLineEndings(const char16_t* src, size_t len, LineEnding target,
+        char16_t* dst, size_t dstCapacity)
+    {
+        if (!src || !dst || len == 0 || dstCapacity == 0)
+            return { 0, 0 };
+
+        const char16_t* p = src;
+        char16_t* out = dst;
+#if SIMD_X86
+        SimdLevel level = GetSimdLevel();
+        if (level == SimdLevel::AVX2)
+            ConvertAVX2(p, src + len, out, dst + dstCapacity, target);
+        else if (level != SimdLevel::Scalar)
+            ConvertSSE2(p, src + len, out, dst + dstCapacity, target);
+        else
+#endif
+            ConvertScalar(p, src + len, out, dst + dstCapacity, target);
+
+        LineEndingConvertResult result;
+        result.consumed = static_cast<size_t>(p - src);
+        result.outputLength = static_cast<size_t>(out - dst);
+        return result;
+    }
+
+    std::u16string ConvertLineEndingsString(const char16_t* src, size_t len, LineEnding target)
+    {
+        LineEndingStats stats = CountLineEndings(src, len);
+        std::u16string text(GetConvertedLength(stats, len, target), u'\0');
+        if (!text.empty())
+            ConvertLineEndings(src, len, target, &text[0], text.size());
+        return text;
+    }
+}
@@ -0,0 +1,75 @@
+﻿// LineEnding.h - 换行符检测与转换（SIMD 扫描，不依赖MFC）
+//
+// 编辑控件内部只认 CRLF：载入时把 LF/CR/混合换行统一转换为 CRLF，
+// 保存时再按文件原来的换行约定分块写回。
+// 扫描用 SSE2/AVX2 一次比较 8/16 个单元，块内没有 CR/LF 时整块复制。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace TestableLogic
+{
+    enum class LineEnding
+    {
+        CrLf,       // Windows（默认）
+        Lf,         // Unix
+        Cr          // 经典 Mac OS
+    };
+
+    // 三种换行各自出现的次数（CRLF 只计一次，不再计入 CR/LF）
+    struct LineEndingStats
+    {
+        size_t crlf;
+        size_t lf;
+        size_t cr;
+    };
+
+    LineEndingStats CountLineEndings(const char16_t* src, size_t len);
+
+    inline size_t GetLineBreakCount(const LineEndingStats& stats)
+    {
+        return stats.crlf + stats.lf + stats.cr;
+    }
+
+    // 出现次数最多的换行约定；没有换行或并列时优先 CRLF，其次 LF
+    LineEnding GetDominantLineEnding(const LineEndingStats& stats);
+
+    // 是否混用了多于一种换行
+    bool IsMixedLineEndings(const LineEndingStats& stats);
+
+    const char* GetLineEndingName(LineEnding ending);
+
+    // ============ 转换 ============
+
+    struct LineEndingConvertResult
+    {
+        size_t consumed;            // 已消耗的源单元数
+        size_t outputLength;        // 写出的单元数
+    };
+
+    // 全部换行转换为 target 后的精确长度
+    size_t GetConvertedLength(const LineEndingStats& stats, size_t len, LineEnding target);
+
+    // 把 CRLF/LF/CR 统一转换为 target，写到 dst，直到源数据耗尽或 dst 放不下下一个换行为止；
+    // 未耗尽时从 src + consumed 继续调用即可，CRLF 不会被拆开；分块时 dstCapacity 至少为 2
+    LineEndingConvertResult ConvertLineEndings(const char16_t* src, size_t len, LineEnding target,
+        char16_t* dst, size_t dstCapacity);
+
+    std::u16string ConvertLineEndingsString(const char16_t* src, size_t len, LineEnding target);
+
+#ifdef _WIN32
+    inline LineEndingStats CountLineEndings(const wchar_t* src, size_t len)
+    {
+        return CountLineEndings(reinterpret_cast<const char16_t*>(src), len);
+    }
+
+    inline LineEndingConvertResult ConvertLineEndings(const wchar_t* src, size_t len, LineEnding target,
+        wchar_t* dst, size_t dstCapacity)
+    {
+        return ConvertLineEndings(reinterpret_cast<const char16_t*>(src), len, target,
+            reinterpret_cast<char16_t*>(dst), dstCapacity);
+    }
+#endif
+}
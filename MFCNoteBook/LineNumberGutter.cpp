@@ -0,0 +1,253 @@
+﻿// LineNumberGutter.cpp - 行号区增量绘制的计算部分实现
+#include "LineNumberGutter.h"
+
+#include <algorithm>
+#include <cwchar>
+
+namespace TestableLogic
+{
+    GutterUpdate PlanGutterUpdate(const GutterFrame& prev, bool bPrevValid, const GutterFrame& next)
+    {
+        GutterUpdate update = { true, 0, 0, next.rows };
+        if (!bPrevValid || prev.width != next.width || prev.lineHeight != next.lineHeight ||
+            prev.rows != next.rows)
+            return update;
+
+        long long delta = static_cast<long long>(next.firstLine) - static_cast<long long>(prev.firstLine);
+        long long rows = static_cast<long long>(next.rows);
+        if (delta >= rows || -delta >= rows)
+            return update;
+
+        update.bFullRedraw = false;
+        update.shiftRows = delta;
+
+        // 新露出的行
+        size_t begin = next.rows;
+        size_t end = 0;
+        if (delta > 0)
+        {
+            begin = static_cast<size_t>(rows - delta);
+            end = next.rows;
+        }
+        else if (delta < 0)
+        {
+            begin = 0;
+            end = static_cast<size_t>(-delta);
+        }
+
+        // 行数变化：第 [较小行数, 较大行数) 行的行号出现或消失
+        if (prev.lineCount != next.lineCount)
+        {
+            uint64_t lo = (std::min)(prev.lineCount, next.lineCount);
+            uint64_t hi = (std::max)(prev.lineCount, next.lineCount);
+            uint64_t last = next.firstLine + next.rows;
+            if (hi > next.firstLine && lo < last)
+            {
+                size_t rowLo = static_cast<size_t>((std::max)(lo, next.firstLine) - next.firstLine);
+                size_t rowHi = static_cast<size_t>((std::min)(hi, last) - next.firstLine);
+                begin = (std::min)(begin, rowLo);
+                end = (std::max)(end, rowHi);
+            }
+        }
+
+        if (begin < end)
+        {
+            update.dirtyBegin = begin;
+            update.dirtyEnd = end;
+        }
+        else
+        {
+            update.dirtyBegin = 0;
+            update.dirtyEnd = 0;
+        }
+        return update;
+    }
+
+    GutterUpdate PlanGutterLabelUpdate(const std::vector<uint64_t>& prev, bool bPrevValid,
+        const std::vector<uint64_t>& next, long long shiftHint)
+    {
+        GutterUpdate update = { true, 0, 0, next.size() };
+        long long rows = static_cast<long long>(next.size());
+        if (!bPrevValid || prev.size() != next.size() || shiftHint >= rows || -shiftHint >= rows)
+            return update;
+
+        update.bFullRedraw = false;
+        update.shiftRows = shiftHint;
+
+        size_t begin = next.size();
+        size_t end = 0;
+        for (long long row = 0; row < rows; row++)
+        {
+            long long src = row + shiftHint;
+            if (src >= 0 && src < rows && prev[static_cast<size_t>(src)] == next[static_cast<size_t>(row)])
+                continue;
+            begin = (std::min)(begin, static_cast<size_t>(row));
+            end = static_cast<size_t>(row) + 1;
+        }
+
+        update.dirtyBegin = begin < end ? begin : 0;
+        update.dirtyEnd = begin < end ? end : 0;
+        return update;
+    }
+
+    size_t GetDecimalDigitCount(uint64_t value)
+    {
+        size_t digits = 1;
+        while (value >= 10)
+        {
+            value /= 10;
+            digits++;
+        }
+        return digits;
+    }
+
+    size_t FormatDecimal(uint64_t value, char* out)
+    {
+        size_t digits = GetDecimalDigitCount(value);
+        for (size_t i = digits; i > 0; i--)
+        {
+            out[i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        return digits;
+    }
+
+    size_t GetGutterDigits(uint64_t lineCount)
+    {
+        return (std::max)(GetDecimalDigitCount(lineCount), static_cast<size_t>(GUTTER_MIN_DIGITS));
+    }
+
+    // ============ 编辑引起的行数变化 ============
+
+    namespace
+    {
+        uint64_t CountLineFeeds(const wchar_t* text, size_t len)
+        {
+            uint64_t count = 0;
+            for (size_t i = 0; i < len; i++)
+            {
+                if (text[i] == L'\n')
+                    count++;
+            }
+            return count;
+        }
+
+        bool SameRange(const wchar_t* a, const wchar_t* b, size_t len)
+        {
+            return len == 0 || wmemcmp(a, b, len) == 0;
+        }
+    }
+
+    EditLineDelta CountEditLineDelta(const wchar_t* before, size_t beforeLen,
+        const wchar_t* after, size_t afterLen, size_t caret)
+    {
+        EditLineDelta delta = { 0, 0 };
+        caret = (std::min)(caret, afterLen);
+
+        // 插入：after = before[0, start) + 插入内容 + before[start, ...)，光标在插入内容之后
+        if (afterLen >= beforeLen && caret >= afterLen - beforeLen)
+        {
+            size_t start = caret - (afterLen - beforeLen);
+            if (SameRange(before, after, start) &&
+                SameRange(before + start, after + caret, beforeLen - start))
+            {
+                delta.insertedLines = CountLineFeeds(after + start, caret - start);
+                return delta;
+            }
+        }
+
+        // 删除：after = before[0, caret) + before[caret + 删除长度, ...)
+        if (afterLen < beforeLen)
+        {
+            size_t removed = beforeLen - afterLen;
+            if (SameRange(before, after, caret) &&
+                SameRange(before + caret + removed, after + caret, afterLen - caret))
+            {
+                delta.removedLines = CountLineFeeds(before + caret, removed);
+                return delta;
+            }
+        }
+
+        // 一般情况：去掉公共前缀和后缀，剩下的就是被替换的区间
+        size_t prefix = 0;
+        size_t maxPrefix = (std::min)(beforeLen, afterLen);
+        while (prefix < maxPrefix && before[prefix] == after[prefix])
+            prefix++;
+        size_t suffix = 0;
+        while (suffix < maxPrefix - prefix &&
+            before[beforeLen - 1 - suffix] == after[afterLen - 1 - suffix])
+            suffix++;
+
+        delta.removedLines = CountLineFeeds(before + prefix, beforeLen - prefix - suffix);
+        delta.insertedLines = CountLineFeeds(after + prefix, afterLen - prefix - suffix);
+        return delta;
+    }
+
+    EditLineDelta CountDeltaLines(const TextDelta& delta)
+    {
+        EditLineDelta lines = { 0, 0 };
+        lines.removedLines = static_cast<uint64_t>(std::count(delta.removed.begin(), delta.removed.end(), u'\n'));
+        lines.insertedLines = static_cast<uint64_t>(std::count(delta.inserted.begin(), delta.inserted.end(), u'\n'));
+        return lines;
+    }
+
+    GutterLineTracker::GutterLineTracker()
+        : m_lineCount(1)
+        , m_digits(GUTTER_MIN_DIGITS)
+        , m_nEdits(0)
+        , m_nWidthChanges(0)
+    {
+    }
+
+    void GutterLineTracker::Reset(uint64_t lineCount)
+    {
+        m_lineCount = lineCount;
+        m_digits = GetGutterDigits(lineCount);
+    }
+
+    bool GutterLineTracker::ApplyEdit(const EditLineDelta& delta)
+    {
+        uint64_t lineCount = m_lineCount + delta.insertedLines;
+        lineCount = lineCount > delta.removedLines ? lineCount - delta.removedLines : 1;
+        return SetLineCount(lineCount);
+    }
+
+    bool GutterLineTracker::SetLineCount(uint64_t lineCount)
+    {
+        m_nEdits++;
+        m_lineCount = lineCount;
+        size_t digits = GetGutterDigits(lineCount);
+        if (digits == m_digits)
+            return false;
+
+        m_digits = digits;
+        m_nWidthChanges++;
+        return true;
+    }
+
+    // ============ 绘制耗时统计 ============
+
+    void PaintStats::Reset()
+    {
+        frames = 0;
+        fullFrames = 0;
+        lastMicros = 0;
+        maxMicros = 0;
+        totalMicros = 0;
+    }
+
+    void PaintStats::AddFrame(double micros, bool bFull)
+    {
+        frames++;
+        if (bFull)
+            fullFrames++;
+        lastMicros = micros;
+        maxMicros = (std::max)(maxMicros, micros);
+        totalMicros += micros;
+    }
+
+    double PaintStats::GetAverageMicros() const
+    {
+        return frames ? totalMicros / static_cast<double>(frames) : 0.0;
+    }
+}
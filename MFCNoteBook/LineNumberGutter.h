@@ -0,0 +1,110 @@
+﻿// LineNumberGutter.h - 行号区增量绘制的计算部分（不依赖MFC）
+//
+// 行号区保留一张离屏位图：滚动时把位图整体平移，只重画新露出的行；
+// 行数变化时只重画行号出现或消失的那几行。这里只负责比较前后两帧，决定要重画哪些行。
+#pragma once
+
+#include "TextDelta.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 行号至少按 4 位计算宽度（与 "%4d" 的旧行为一致）
+#define GUTTER_MIN_DIGITS       4
+
+namespace TestableLogic
+{
+    // 一帧行号区的状态
+    struct GutterFrame
+    {
+        uint64_t firstLine;     // 第一可见行（从 0 开始）
+        uint64_t lineCount;
+        size_t rows;            // 可见行数（含最后露出一部分的行）
+        int width;              // 像素宽度
+        int lineHeight;
+    };
+
+    struct GutterUpdate
+    {
+        bool bFullRedraw;
+        long long shiftRows;    // 位图上移的行数（负数为下移）
+        size_t dirtyBegin;      // 平移之后需要重画的行 [dirtyBegin, dirtyEnd)
+        size_t dirtyEnd;
+    };
+
+    // 尺寸或行高变化、上一帧无效或滚动超过一屏时全量重画；
+    // 否则平移位图，并重画新露出的行以及行数变化影响到的行
+    GutterUpdate PlanGutterUpdate(const GutterFrame& prev, bool bPrevValid, const GutterFrame& next);
+
+    // 自动换行时行号区按可视行绘制：labels[i] 为第 i 个可视行显示的行号，0 表示续行（不显示）。
+    // 可视行编号会随后台折行变化，shiftHint（第一可见行的变化量）只用来决定平移多少，
+    // 平移之后仍逐行比较，行号不同的行都会重画
+    GutterUpdate PlanGutterLabelUpdate(const std::vector<uint64_t>& prev, bool bPrevValid,
+        const std::vector<uint64_t>& next, long long shiftHint);
+
+    size_t GetDecimalDigitCount(uint64_t value);
+
+    // 十进制数字写入 out（不加结尾 0），返回位数；out 至少 20 字节
+    size_t FormatDecimal(uint64_t value, char* out);
+
+    // 行号区宽度按多少位数字计算
+    size_t GetGutterDigits(uint64_t lineCount);
+
+    // ============ 编辑引起的行数变化 ============
+
+    // 一次编辑删除和插入的换行数
+    struct EditLineDelta
+    {
+        uint64_t removedLines;
+        uint64_t insertedLines;
+    };
+
+    // 比较编辑前后的文本，找出被替换的区间，只统计区间内的换行。
+    // caret 为编辑后的光标位置：输入、粘贴后光标在插入内容之后，删除后光标在删除处，
+    // 先按这两种情况整块比较验证，不符合时（如覆盖选区）再逐字比较前后缀
+    EditLineDelta CountEditLineDelta(const wchar_t* before, size_t beforeLen,
+        const wchar_t* after, size_t afterLen, size_t caret);
+
+    // 已经由 MakeTextDelta 得到替换区间时，直接统计区间内的换行，不必再比较一遍全文
+    EditLineDelta CountDeltaLines(const TextDelta& delta);
+
+    // 按每次编辑的行数增减维护行数，位数变化时才需要调整行号区宽度
+    class GutterLineTracker
+    {
+    public:
+        GutterLineTracker();
+
+        void Reset(uint64_t lineCount);
+
+        // 返回 true 表示位数变化
+        bool ApplyEdit(const EditLineDelta& delta);
+        bool SetLineCount(uint64_t lineCount);
+
+        uint64_t GetLineCount() const { return m_lineCount; }
+        size_t GetDigits() const { return m_digits; }
+        uint64_t GetEditCount() const { return m_nEdits; }
+        uint64_t GetWidthChangeCount() const { return m_nWidthChanges; }
+
+    private:
+        uint64_t m_lineCount;
+        size_t m_digits;
+        uint64_t m_nEdits;
+        uint64_t m_nWidthChanges;
+    };
+
+    // 每帧绘制耗时统计（快速滚动时观察局部重画的效果）
+    struct PaintStats
+    {
+        uint64_t frames;
+        uint64_t fullFrames;
+        double lastMicros;
+        double maxMicros;
+        double totalMicros;
+
+        PaintStats() { Reset(); }
+        void Reset();
+        void AddFrame(double micros, bool bFull);
+        double GetAverageMicros() const;
+    };
+}
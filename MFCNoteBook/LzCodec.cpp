@@ -0,0 +1,155 @@
+﻿// LzCodec.cpp - 快速 LZ77 压缩实现
+#include "LzCodec.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        const size_t kHashSize = static_cast<size_t>(1) << LZ_HASH_BITS;
+        const size_t kMaxOffset = 0xFFFF;
+        // 末尾这么多字节只作字面量，匹配时一次比较 4 字节不会越界
+        const size_t kLastLiterals = 5;
+
+        uint32_t Read32(const uint8_t* p)
+        {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+
+        size_t Hash(uint32_t v)
+        {
+            return static_cast<size_t>((v * 2654435761u) >> (32 - LZ_HASH_BITS));
+        }
+
+        void AppendLength(std::vector<uint8_t>& out, size_t len)
+        {
+            while (len >= 255)
+            {
+                out.push_back(255);
+                len -= 255;
+            }
+            out.push_back(static_cast<uint8_t>(len));
+        }
+
+        void AppendSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLen,
+            size_t offset, size_t matchLen)
+        {
+            size_t matchCode = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+            uint8_t token = static_cast<uint8_t>(((literalLen < 15 ? literalLen : 15) << 4)
+                | (matchCode < 15 ? matchCode : 15));
+            out.push_back(token);
+            if (literalLen >= 15)
+                AppendLength(out, literalLen - 15);
+            out.insert(out.end(), literals, literals + literalLen);
+
+            if (matchLen == 0)
+                return;
+            out.push_back(static_cast<uint8_t>(offset & 0xFF));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (matchCode >= 15)
+                AppendLength(out, matchCode - 15);
+        }
+
+        bool ReadLength(const uint8_t* data, size_t len, size_t& pos, size_t& value)
+        {
+            uint8_t b;
+            do
+            {
+                if (pos >= len)
+                    return false;
+                b = data[pos++];
+                value += b;
+            } while (b == 255);
+            return true;
+        }
+    }
+
+    size_t LzCompress(const uint8_t* data, size_t len, std::vector<uint8_t>& out)
+    {
+        size_t start = out.size();
+        size_t anchor = 0;
+
+        if (len > LZ_MIN_MATCH + kLastLiterals)
+        {
+            // 记录每个 4 字节序列最近出现的位置（+1，0 表示没有）
+            uint32_t table[kHashSize];
+            memset(table, 0, sizeof(table));
+
+            size_t limit = len - kLastLiterals;
+            size_t pos = 0;
+            while (pos + LZ_MIN_MATCH <= limit)
+            {
+                uint32_t seq = Read32(data + pos);
+                size_t h = Hash(seq);
+                size_t candidate = table[h];
+                table[h] = static_cast<uint32_t>(pos + 1);
+
+                if (candidate == 0 || pos - (candidate - 1) > kMaxOffset
+                    || Read32(data + candidate - 1) != seq)
+                {
+                    pos++;
+                    continue;
+                }
+
+                size_t ref = candidate - 1;
+                size_t matchLen = LZ_MIN_MATCH;
+                while (pos + matchLen < limit && data[ref + matchLen] == data[pos + matchLen])
+                    matchLen++;
+
+                AppendSequence(out, data + anchor, pos - anchor, pos - ref, matchLen);
+                pos += matchLen;
+                anchor = pos;
+            }
+        }
+
+        AppendSequence(out, data + anchor, len - anchor, 0, 0);
+        return out.size() - start;
+    }
+
+    bool LzDecompress(const uint8_t* data, size_t len, size_t rawLen, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        out.reserve(rawLen);
+
+        size_t pos = 0;
+        while (pos < len)
+        {
+            uint8_t token = data[pos++];
+
+            size_t literalLen = token >> 4;
+            if (literalLen == 15 && !ReadLength(data, len, pos, literalLen))
+                return false;
+            if (len - pos < literalLen || rawLen - out.size() < literalLen)
+                return false;
+            out.insert(out.end(), data + pos, data + pos + literalLen);
+            pos += literalLen;
+
+            // 最后一段没有匹配
+            if (pos == len)
+                break;
+
+            if (len - pos < 2)
+                return false;
+            size_t offset = data[pos] | (static_cast<size_t>(data[pos + 1]) << 8);
+            pos += 2;
+            size_t matchLen = token & 0x0F;
+            if (matchLen == 15 && !ReadLength(data, len, pos, matchLen))
+                return false;
+            matchLen += LZ_MIN_MATCH;
+
+            if (offset == 0 || offset > out.size() || rawLen - out.size() < matchLen)
+                return false;
+            // 匹配可以与自身重叠（offset < matchLen），逐字节向前拷贝
+            size_t to = out.size();
+            out.resize(to + matchLen);
+            uint8_t* p = out.data() + to;
+            const uint8_t* src = p - offset;
+            for (size_t i = 0; i < matchLen; i++)
+                p[i] = src[i];
+        }
+        return out.size() == rawLen;
+    }
+}
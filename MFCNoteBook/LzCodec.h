@@ -0,0 +1,27 @@
+﻿// LzCodec.h - 快速 LZ77 压缩（不依赖MFC）
+//
+// 用于撤销历史中较早的增量：压缩只做一次哈希查找、不回溯，解压只有逐字节的拷贝，
+// 都是线性时间。格式与 LZ4 的块格式相同的思路：
+//   令牌  高 4 位为字面量长度，低 4 位为匹配长度 - 4，取 15 时后跟若干个累加的字节（255 表示继续）
+//   字面量
+//   偏移  2 字节小端，1..65535（最后一段只有字面量，没有偏移和匹配）
+// 压缩结果不含原始长度，由调用方另行保存。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 最短匹配长度
+#define LZ_MIN_MATCH        4
+// 哈希表大小（2 的幂），压缩时在栈上
+#define LZ_HASH_BITS        12
+
+namespace TestableLogic
+{
+    // 压缩 [data, data + len)，结果追加到 out；返回追加的字节数（不可压缩的数据最多膨胀约 1/255）
+    size_t LzCompress(const uint8_t* data, size_t len, std::vector<uint8_t>& out);
+
+    // 解压到 out（覆盖），rawLen 为原始长度；数据损坏或长度不符时返回 false
+    bool LzDecompress(const uint8_t* data, size_t len, size_t rawLen, std::vector<uint8_t>& out);
+}
@@ -12,10 +12,23 @@
 #include "MFCNoteBookDoc.h"
 #include "MFCNoteBookView.h"
 #include "ConfigManager.h"
+#include "FindInNotesDlg.h"
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <shlobj.h>
+
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+// 崩溃恢复快照所在的目录（%LOCALAPPDATA% 下）和每次运行的锁文件扩展名
+#define RECOVERY_DIR _T("MFCNoteBook\\Recovery")
+#define RECOVERY_LOCK_EXT _T(".lock")
+// 恢复提示中最多列出的文档数
+#define RECOVERY_PROMPT_MAX 10
+
 
 // CMFCNoteBookApp
 
@@ -32,30 +45,27 @@ BEGIN_MESSAGE_MAP(CMFCNoteBookApp, CWinApp)
 	ON_COMMAND(ID_VIEW_THEME_DARK, &CMFCNoteBookApp::OnViewThemeDark)
 	ON_UPDATE_COMMAND_UI(ID_VIEW_THEME_LIGHT, &CMFCNoteBookApp::OnUpdateViewThemeLight)
 	ON_UPDATE_COMMAND_UI(ID_VIEW_THEME_DARK, &CMFCNoteBookApp::OnUpdateViewThemeDark)
+	ON_COMMAND_RANGE(ID_VIEW_THEME_USER_FIRST, ID_VIEW_THEME_USER_LAST, &CMFCNoteBookApp::OnViewThemeUser)
+	ON_UPDATE_COMMAND_UI_RANGE(ID_VIEW_THEME_USER_FIRST, ID_VIEW_THEME_USER_LAST, &CMFCNoteBookApp::OnUpdateViewThemeUser)
 	// ====================================
+
+	ON_COMMAND(ID_VIEW_WORD_WRAP, &CMFCNoteBookApp::OnViewWordWrap)
+	ON_UPDATE_COMMAND_UI(ID_VIEW_WORD_WRAP, &CMFCNoteBookApp::OnUpdateViewWordWrap)
+
+	ON_COMMAND(ID_EDIT_FIND_IN_NOTES, &CMFCNoteBookApp::OnEditFindInNotes)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_FIND_IN_NOTES, &CMFCNoteBookApp::OnUpdateEditFindInNotes)
 END_MESSAGE_MAP()
 
 
 // CMFCNoteBookApp 构造
 
 CMFCNoteBookApp::CMFCNoteBookApp() noexcept
-	: m_currentTheme(AppTheme::Light)  // 默认亮色主题
+	: m_nTheme((int)AppTheme::Light)  // 默认亮色主题
+	, m_bWordWrap(false)
+	, m_hRecoveryLock(INVALID_HANDLE_VALUE)
 {
-	// ========== 新增：初始化主题颜色 ==========
-	// 亮色主题
-	m_lightTheme.clrEditBg = RGB(255, 255, 255);        // 白色背景
-	m_lightTheme.clrEditText = RGB(0, 0, 0);            // 黑色文字
-	m_lightTheme.clrLineNumBg = RGB(240, 240, 240);     // 浅灰背景
-	m_lightTheme.clrLineNumText = RGB(128, 128, 128);   // 灰色行号
-	m_lightTheme.clrLineNumBorder = RGB(200, 200, 200); // 分隔线
-
-	// 暗色主题
-	m_darkTheme.clrEditBg = RGB(30, 30, 30);            // 深灰背景
-	m_darkTheme.clrEditText = RGB(220, 220, 220);       // 浅色文字
-	m_darkTheme.clrLineNumBg = RGB(45, 45, 45);         // 稍浅的背景
-	m_darkTheme.clrLineNumText = RGB(140, 140, 140);    // 灰色行号
-	m_darkTheme.clrLineNumBorder = RGB(60, 60, 60);     // 分隔线
-	// ==========================================
+	// 内置主题的配色在 ThemeRegistry 中，用户主题在 InitInstance 中载入
+	BuildThemeColors();
 
 	// 支持重新启动管理器
 	m_dwRestartManagerSupportFlags = AFX_RESTART_MANAGER_SUPPORT_ALL_ASPECTS;
@@ -75,6 +85,9 @@ CMFCNoteBookApp theApp;
 
 BOOL CMFCNoteBookApp::InitInstance()
 {
+	// 会话恢复统计可以交互的时间从这里算起
+	DWORD dwStartTick = GetTickCount();
+
 	INITCOMMONCONTROLSEX InitCtrls;
 	InitCtrls.dwSize = sizeof(InitCtrls);
 	InitCtrls.dwICC = ICC_WIN95_CLASSES;
@@ -106,9 +119,13 @@ BOOL CMFCNoteBookApp::InitInstance()
 	}
 	// ========================================
 
-	// ========== 加载保存的主题设置 ==========
+	// ========== 加载用户主题和保存的主题设置 ==========
+	LoadThemes();
 	LoadThemeFromRegistry();
 	// ========================================
+	m_bWordWrap = GetProfileInt(_T("Settings"), _T("WordWrap"), 0) != 0;
+	m_hibernation.LoadSettings();
+	CHibernationManager::SweepStaleFiles();
 
 	CMultiDocTemplate* pDocTemplate;
 	pDocTemplate = new CMultiDocTemplate(IDR_MFCNoteBookTYPE,
@@ -118,6 +135,7 @@ BOOL CMFCNoteBookApp::InitInstance()
 	if (!pDocTemplate)
 		return FALSE;
 	AddDocTemplate(pDocTemplate);
+	AddUserThemeMenuItems(pDocTemplate->m_hMenuShared);
 
 	CMainFrame* pMainFrame = new CMainFrame;
 	if (!pMainFrame || !pMainFrame->LoadFrame(IDR_MAINFRAME))
@@ -132,6 +150,12 @@ BOOL CMFCNoteBookApp::InitInstance()
 	CCommandLineInfo cmdInfo;
 	ParseCommandLine(cmdInfo);
 
+	// ========== 会话恢复：有上次的会话时不再新建空文档 ==========
+	bool bRestoreSession = (cmdInfo.m_nShellCommand == CCommandLineInfo::FileNew ||
+		cmdInfo.m_nShellCommand == CCommandLineInfo::FileOpen) && m_sessionManager.Load();
+	if (bRestoreSession && cmdInfo.m_nShellCommand == CCommandLineInfo::FileNew)
+		cmdInfo.m_nShellCommand = CCommandLineInfo::FileNothing;
+
 	EnableShellOpen();
 	RegisterShellFileTypes(TRUE);
 
@@ -141,6 +165,18 @@ BOOL CMFCNoteBookApp::InitInstance()
 	pMainFrame->ShowWindow(m_nCmdShow);
 	pMainFrame->UpdateWindow();
 
+	// ========== 崩溃恢复：先找回上次异常退出时的快照，再开始本次的自动保存 ==========
+	if (StartRecovery())
+	{
+		RestoreRecoveredDocuments(pDocTemplate);
+	}
+
+	// 上次的文档先以占位内容显示，内容在后台载入
+	if (bRestoreSession)
+	{
+		m_sessionManager.Restore(pDocTemplate, pMainFrame, dwStartTick);
+	}
+
 	return TRUE;
 }
 
@@ -149,6 +185,21 @@ int CMFCNoteBookApp::ExitInstance()
 	// ========== 新增：退出时保存主题设置 ==========
 	SaveThemeToRegistry();
 	// =============================================
+	WriteProfileInt(_T("Settings"), _T("WordWrap"), m_bWordWrap ? 1 : 0);
+
+	m_fontCache.Clear();
+	m_themeResources.Clear();
+
+	// 尚未开始的会话载入不再进行
+	m_sessionManager.Shutdown();
+
+	// 写完排队的快照工作（关闭文档时的删除）再结束
+	m_recovery.Stop();
+	if (m_hRecoveryLock != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hRecoveryLock);
+		m_hRecoveryLock = INVALID_HANDLE_VALUE;
+	}
 
 	AfxOleTerm(FALSE);
 	return CWinApp::ExitInstance();
@@ -156,19 +207,92 @@ int CMFCNoteBookApp::ExitInstance()
 
 // ========== 新增：主题相关实现 ==========
 
-const ThemeColors& CMFCNoteBookApp::GetThemeColors() const
+// 每个用户主题占一个菜单命令 ID
+static_assert(ID_VIEW_THEME_USER_LAST - ID_VIEW_THEME_USER_FIRST + 1 == THEME_MAX_COUNT - THEME_BUILTIN_COUNT,
+	"用户主题的命令 ID 范围与 THEME_MAX_COUNT 不一致");
+
+// 载入程序目录下的主题文件；文件不存在时只有内置主题。
+// 每个主题只在这里校验一次并转换成 ThemeColors，之后取配色只是一次下标访问
+void CMFCNoteBookApp::LoadThemes()
+{
+	m_themeRegistry.Reset();
+
+	TCHAR szModulePath[MAX_PATH];
+	GetModuleFileName(NULL, szModulePath, MAX_PATH);
+	CString strPath = szModulePath;
+	int nPos = strPath.ReverseFind(_T('\\'));
+	if (nPos > 0)
+		strPath = strPath.Left(nPos);
+	strPath += _T("\\");
+	strPath += THEME_FILE_NAME;
+
+	std::ifstream file(strPath.GetString(), std::ios::binary);
+	if (file)
+	{
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		m_themeRegistry.LoadUserThemes(data.data(), data.size());
+		for (const TestableLogic::ThemeLoadError& error : m_themeRegistry.GetErrors())
+			TRACE(_T("主题文件第 %u 行被忽略（原因 %d）\n"), (UINT)error.line, (int)error.status);
+	}
+
+	BuildThemeColors();
+}
+
+void CMFCNoteBookApp::BuildThemeColors()
 {
-	return (m_currentTheme == AppTheme::Dark) ? m_darkTheme : m_lightTheme;
+	m_themeColors.resize(m_themeRegistry.GetCount());
+	for (size_t i = 0; i < m_themeColors.size(); i++)
+	{
+		const TestableLogic::ThemePalette& palette = m_themeRegistry.Get(i).palette;
+		m_themeColors[i].clrEditBg = palette.editBg;
+		m_themeColors[i].clrEditText = palette.editText;
+		m_themeColors[i].clrLineNumBg = palette.lineNumBg;
+		m_themeColors[i].clrLineNumText = palette.lineNumText;
+		m_themeColors[i].clrLineNumBorder = palette.lineNumBorder;
+	}
+
+	if (m_nTheme >= (int)m_themeColors.size())
+		m_nTheme = (int)AppTheme::Light;
+}
+
+// 用户主题接在“暗色主题”菜单项之后
+void CMFCNoteBookApp::AddUserThemeMenuItems(HMENU hMenu)
+{
+	CMenu* pMenu = CMenu::FromHandle(hMenu);
+	if (!pMenu)
+		return;
+
+	for (UINT nTop = 0; nTop < (UINT)pMenu->GetMenuItemCount(); nTop++)
+	{
+		CMenu* pPopup = pMenu->GetSubMenu(nTop);
+		if (!pPopup)
+			continue;
+
+		for (UINT nItem = 0; nItem < (UINT)pPopup->GetMenuItemCount(); nItem++)
+		{
+			if (pPopup->GetMenuItemID(nItem) != ID_VIEW_THEME_DARK)
+				continue;
+
+			for (size_t i = THEME_BUILTIN_COUNT; i < m_themeRegistry.GetCount(); i++)
+			{
+				CString strName(CA2W(m_themeRegistry.Get(i).name.c_str(), CP_UTF8));
+				UINT nID = ID_VIEW_THEME_USER_FIRST + (UINT)(i - THEME_BUILTIN_COUNT);
+				pPopup->InsertMenu(++nItem, MF_BYPOSITION | MF_STRING, nID, strName);
+			}
+			return;
+		}
+	}
 }
 
-void CMFCNoteBookApp::SetTheme(AppTheme theme)
+void CMFCNoteBookApp::SetTheme(int nTheme)
 {
-	if (m_currentTheme == theme)
+	if (nTheme < 0 || nTheme >= (int)m_themeColors.size() || m_nTheme == nTheme)
 		return;
 
-	m_currentTheme = theme;
+	m_nTheme = nTheme;
 
-	// 通知所有视图更新
+	// 各视图只换用新主题的颜色和共用画刷，不各自重绘；
+	// 最后对主窗口统一失效一次，由系统在下一轮 WM_PAINT 中只重绘可见的窗口
 	POSITION posTemplate = GetFirstDocTemplatePosition();
 	while (posTemplate)
 	{
@@ -190,40 +314,287 @@ void CMFCNoteBookApp::SetTheme(AppTheme theme)
 			}
 		}
 	}
+
+	if (m_pMainWnd && m_pMainWnd->GetSafeHwnd())
+		m_pMainWnd->RedrawWindow(NULL, NULL, RDW_INVALIDATE | RDW_ERASE | RDW_ALLCHILDREN);
 }
 
+const ThemeResources& CMFCNoteBookApp::GetThemeResources()
+{
+	const ThemeColors& colors = GetThemeColors();
+	return m_themeResources.Get(m_nTheme, [&colors](int theme, ThemeResources& res)
+	{
+		res.brEditBg.CreateSolidBrush(colors.clrEditBg);
+		TRACE(_T("主题资源: 创建主题 %d 的画刷\n"), theme);
+	});
+}
+
+// 用户主题的 ID 随主题文件的内容变化，因此同时保存名称，载入时优先按名称查找
 void CMFCNoteBookApp::SaveThemeToRegistry()
 {
-	WriteProfileInt(_T("Settings"), _T("Theme"), (int)m_currentTheme);
+	WriteProfileInt(_T("Settings"), _T("Theme"), m_nTheme);
+	CString strName(CA2W(m_themeRegistry.Get(m_nTheme).name.c_str(), CP_UTF8));
+	WriteProfileString(_T("Settings"), _T("ThemeName"), strName);
 }
 
 void CMFCNoteBookApp::LoadThemeFromRegistry()
 {
-	int nTheme = GetProfileInt(_T("Settings"), _T("Theme"), 0);
-	m_currentTheme = (nTheme == 1) ? AppTheme::Dark : AppTheme::Light;
+	CString strName = GetProfileString(_T("Settings"), _T("ThemeName"), _T(""));
+	int nTheme = strName.IsEmpty() ? -1 : m_themeRegistry.FindByName(std::string(CW2A(strName, CP_UTF8)));
+	if (nTheme < 0)
+	{
+		nTheme = GetProfileInt(_T("Settings"), _T("Theme"), 0);
+		if (nTheme < 0 || nTheme >= THEME_BUILTIN_COUNT)
+			nTheme = (int)AppTheme::Light;
+	}
+	m_nTheme = nTheme;
 }
 
 void CMFCNoteBookApp::OnViewThemeLight()
 {
-	SetTheme(AppTheme::Light);
+	SetTheme((int)AppTheme::Light);
 }
 
 void CMFCNoteBookApp::OnViewThemeDark()
 {
-	SetTheme(AppTheme::Dark);
+	SetTheme((int)AppTheme::Dark);
 }
 
 void CMFCNoteBookApp::OnUpdateViewThemeLight(CCmdUI* pCmdUI)
 {
-	pCmdUI->SetCheck(m_currentTheme == AppTheme::Light);
+	pCmdUI->SetCheck(m_nTheme == (int)AppTheme::Light);
 }
 
 void CMFCNoteBookApp::OnUpdateViewThemeDark(CCmdUI* pCmdUI)
 {
-	pCmdUI->SetCheck(m_currentTheme == AppTheme::Dark);
+	pCmdUI->SetCheck(m_nTheme == (int)AppTheme::Dark);
+}
+
+void CMFCNoteBookApp::OnViewThemeUser(UINT nID)
+{
+	SetTheme(THEME_BUILTIN_COUNT + (int)(nID - ID_VIEW_THEME_USER_FIRST));
+}
+
+void CMFCNoteBookApp::OnUpdateViewThemeUser(CCmdUI* pCmdUI)
+{
+	pCmdUI->SetCheck(m_nTheme == THEME_BUILTIN_COUNT + (int)(pCmdUI->m_nID - ID_VIEW_THEME_USER_FIRST));
 }
 // ========================================
 
+// ========== 自动换行 ==========
+
+void CMFCNoteBookApp::SetWordWrap(bool bWrap)
+{
+	if (m_bWordWrap == bWrap)
+		return;
+
+	m_bWordWrap = bWrap;
+
+	// 与主题一样对所有视图生效
+	POSITION posTemplate = GetFirstDocTemplatePosition();
+	while (posTemplate)
+	{
+		CDocTemplate* pTemplate = GetNextDocTemplate(posTemplate);
+		POSITION posDoc = pTemplate->GetFirstDocPosition();
+		while (posDoc)
+		{
+			CDocument* pDoc = pTemplate->GetNextDoc(posDoc);
+			POSITION posView = pDoc->GetFirstViewPosition();
+			while (posView)
+			{
+				CView* pView = pDoc->GetNextView(posView);
+				if (pView && pView->IsKindOf(RUNTIME_CLASS(CMFCNoteBookView)))
+				{
+					((CMFCNoteBookView*)pView)->SetWordWrap(bWrap);
+				}
+			}
+		}
+	}
+}
+
+void CMFCNoteBookApp::OnViewWordWrap()
+{
+	SetWordWrap(!m_bWordWrap);
+}
+
+void CMFCNoteBookApp::OnUpdateViewWordWrap(CCmdUI* pCmdUI)
+{
+	pCmdUI->SetCheck(m_bWordWrap);
+}
+
+// ========== 在笔记中查找 ==========
+
+void CMFCNoteBookApp::OnEditFindInNotes()
+{
+	CFindInNotesDlg dlg(m_pMainWnd);
+	dlg.DoModal();
+}
+
+// 未配置笔记目录（config.ini 的 [Search] NotesDirectory）时不可用
+void CMFCNoteBookApp::OnUpdateEditFindInNotes(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable(m_searchIndex.IsAvailable());
+}
+
+// ========== 字体缓存 ==========
+
+const AppFontCache::Entry& CMFCNoteBookApp::GetFont(LPCTSTR lpszFace, int nPointSize)
+{
+	TestableLogic::FontKey key = { lpszFace, nPointSize };
+	return m_fontCache.Get(key, [](const TestableLogic::FontKey& fontKey, AppFontCache::Entry& entry)
+	{
+		entry.font.CreatePointFont(fontKey.pointSize * 10, fontKey.face.c_str());
+
+		// 只在第一次使用这个字号时测量
+		CWindowDC dc(NULL);
+		CFont* pOldFont = dc.SelectObject(&entry.font);
+		TEXTMETRIC tm;
+		dc.GetTextMetrics(&tm);
+		CSize digitSize = dc.GetTextExtent(_T("0"), 1);
+		dc.SelectObject(pOldFont);
+
+		entry.metrics.aveCharWidth = max(1, (int)tm.tmAveCharWidth);
+		entry.metrics.digitWidth = max(1, (int)digitSize.cx);
+		entry.metrics.lineHeight = max(1, (int)tm.tmHeight);
+		TRACE(_T("字体缓存: 创建 %s %d 号\n"), fontKey.face.c_str(), fontKey.pointSize);
+	});
+}
+// ==============================
+
+// ========== 崩溃恢复 ==========
+
+// 创建快照目录和本次运行的锁文件，启动后台写快照的线程
+bool CMFCNoteBookApp::StartRecovery()
+{
+	TCHAR szAppData[MAX_PATH];
+	if (FAILED(SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA | CSIDL_FLAG_CREATE, NULL, 0, szAppData)))
+		return false;
+
+	m_strRecoveryDir = szAppData;
+	m_strRecoveryDir += _T("\\") RECOVERY_DIR;
+	int nResult = SHCreateDirectoryEx(NULL, m_strRecoveryDir, NULL);
+	if (nResult != ERROR_SUCCESS && nResult != ERROR_ALREADY_EXISTS)
+		return false;
+
+	// 会话标识区分同时运行的多个实例；锁文件不共享打开，其他实例无法删除它
+	m_strSessionId.Format(_T("%08lx%08lx"), GetCurrentProcessId(), GetTickCount());
+	m_hRecoveryLock = CreateFile(m_strRecoveryDir + _T("\\") + m_strSessionId + RECOVERY_LOCK_EXT,
+		GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (m_hRecoveryLock == INVALID_HANDLE_VALUE)
+	{
+		TRACE(_T("无法创建自动保存的锁文件，不启用自动保存\n"));
+		return false;
+	}
+
+	m_recovery.Start(std::string(CT2A(m_strRecoveryDir, CP_UTF8)), std::string(CT2A(m_strSessionId, CP_UTF8)));
+	return true;
+}
+
+// 找出已结束的会话（锁文件不在或可以删除）留下的快照，询问是否恢复
+void CMFCNoteBookApp::RestoreRecoveredDocuments(CDocTemplate* pDocTemplate)
+{
+	std::vector<CString> files;
+	std::map<CString, bool> sessions;   // 会话 → 是否已结束
+	CFileFind finder;
+	BOOL bFound = finder.FindFile(m_strRecoveryDir + _T("\\*") + CString(RECOVERY_FILE_EXT));
+	while (bFound)
+	{
+		bFound = finder.FindNextFile();
+
+		// 文件名为 <会话>-<文档编号>.recover
+		CString strName = finder.GetFileTitle();
+		int nDash = strName.ReverseFind(_T('-'));
+		if (nDash <= 0)
+			continue;
+		CString strSession = strName.Left(nDash);
+		if (strSession == m_strSessionId)
+			continue;
+
+		std::map<CString, bool>::iterator it = sessions.find(strSession);
+		if (it == sessions.end())
+		{
+			// 仍在运行的实例不共享地打开着锁文件，删除会失败
+			CString strLock = m_strRecoveryDir + _T("\\") + strSession + RECOVERY_LOCK_EXT;
+			bool bEnded = DeleteFile(strLock) || GetLastError() == ERROR_FILE_NOT_FOUND;
+			it = sessions.insert(std::make_pair(strSession, bEnded)).first;
+		}
+		if (it->second)
+			files.push_back(finder.GetFilePath());
+	}
+	finder.Close();
+	if (files.empty())
+		return;
+
+	// 加密文档的快照用当前的密钥解密，密钥已更换的快照留在原处
+	TestableLogic::UndoJournalCipher cipher;
+	CMFCNoteBookDoc::MakeUndoJournalCipher(cipher);
+
+	std::vector<TestableLogic::RecoveredDocument> recovered;
+	std::vector<CString> recoveredFiles;
+	CString strList;
+	for (const CString& strFile : files)
+	{
+		TestableLogic::RecoveredDocument doc;
+		if (!TestableLogic::LoadRecoveryFile(std::string(CT2A(strFile, CP_UTF8)), &cipher, doc))
+		{
+			TRACE(_T("无法读取自动保存的快照: %s\n"), strFile.GetString());
+			continue;
+		}
+
+		if (recovered.size() < RECOVERY_PROMPT_MAX)
+		{
+			CString strPath(CA2T(doc.docPath.c_str(), CP_UTF8));
+			strList += _T("    ");
+			strList += strPath.IsEmpty() ? CString(_T("无标题")) : strPath.Mid(strPath.ReverseFind(_T('\\')) + 1);
+			strList += _T("\n");
+		}
+		else if (recovered.size() == RECOVERY_PROMPT_MAX)
+		{
+			strList += _T("    ……\n");
+		}
+		recovered.push_back(std::move(doc));
+		recoveredFiles.push_back(strFile);
+	}
+	if (recovered.empty())
+		return;
+
+	CString strPrompt;
+	strPrompt.Format(_T("上次程序没有正常退出，找到 %d 个文档未保存的编辑：\n\n%s\n是否恢复？\n\n")
+		_T("选择“否”将丢弃这些编辑，选择“取消”则下次启动时再询问。"),
+		static_cast<int>(recovered.size()), strList.GetString());
+	int nChoice = AfxMessageBox(strPrompt, MB_YESNOCANCEL | MB_ICONQUESTION);
+	if (nChoice == IDCANCEL)
+		return;
+
+	// 恢复出的文档是已修改的状态，之后由本次运行重新写快照；恢复失败的快照保留
+	for (size_t i = 0; i < recovered.size(); i++)
+	{
+		if (nChoice == IDYES && !RestoreRecoveredDocument(pDocTemplate, recovered[i]))
+			continue;
+		DeleteFile(recoveredFiles[i]);
+	}
+}
+
+// 原文件还在时打开它再换上快照中的文本（可以撤销回磁盘上的内容），否则新建文档
+bool CMFCNoteBookApp::RestoreRecoveredDocument(CDocTemplate* pDocTemplate,
+	const TestableLogic::RecoveredDocument& recovered)
+{
+	CString strPath(CA2T(recovered.docPath.c_str(), CP_UTF8));
+	CDocument* pDoc = NULL;
+	if (!strPath.IsEmpty() && GetFileAttributes(strPath) != INVALID_FILE_ATTRIBUTES)
+		pDoc = OpenDocumentFile(strPath);
+	if (!pDoc)
+		pDoc = pDocTemplate->OpenDocumentFile(NULL);
+	if (!pDoc)
+		return false;
+
+	POSITION pos = pDoc->GetFirstViewPosition();
+	CMFCNoteBookView* pView = pos ? DYNAMIC_DOWNCAST(CMFCNoteBookView, pDoc->GetNextView(pos)) : NULL;
+	CString strText(reinterpret_cast<LPCWSTR>(recovered.text.data()), static_cast<int>(recovered.text.size()));
+	return pView && pView->RestoreRecoveredText(strText);
+}
+// ==============================
+
 
 // CAboutDlg 对话框（保持不变）
 
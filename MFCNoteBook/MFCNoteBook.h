@@ -7,15 +7,25 @@
 #endif
 
 #include "resource.h"       // 主符号
+#include "FontCache.h"
+#include "ThemeResourceCache.h"
+#include "ThemeRegistry.h"
+#include "RecoveryService.h"
+#include "SessionManager.h"
+#include "HibernationManager.h"
+#include "SearchIndexManager.h"
+
+#include <vector>
 
 // ========== 新增：主题枚举 ==========
+// 内置主题的 ID；用户主题的 ID 从 THEME_BUILTIN_COUNT 开始，见 ThemeRegistry
 enum class AppTheme
 {
-	Light,
-	Dark
+	Light = 0,
+	Dark = 1
 };
 
-// 主题颜色结构
+// 主题颜色结构（由 ThemeRegistry 的配色转换而来）
 struct ThemeColors
 {
 	COLORREF clrEditBg;         // 编辑区背景
@@ -26,6 +36,16 @@ struct ThemeColors
 };
 // ====================================
 
+// 全部视图共用的字体缓存
+typedef TestableLogic::FontCache<CFont> AppFontCache;
+
+// 全部视图共用的主题画刷（每个主题创建一次）
+struct ThemeResources
+{
+	CBrush brEditBg;            // 编辑控件背景（WM_CTLCOLOREDIT 返回）
+};
+typedef TestableLogic::ThemeResourceCache<ThemeResources> AppThemeResourceCache;
+
 // CMFCNoteBookApp:
 // 有关此类的实现，请参阅 MFCNoteBook.cpp
 //
@@ -37,18 +57,83 @@ public:
 
 	// ========== 新增：主题相关 ==========
 private:
-	AppTheme m_currentTheme;
-	ThemeColors m_lightTheme;
-	ThemeColors m_darkTheme;
+	int m_nTheme;                               // 当前主题 ID
+	TestableLogic::ThemeRegistry m_themeRegistry;
+	std::vector<ThemeColors> m_themeColors;     // 按主题 ID 排列，载入时一次转换好
+	AppThemeResourceCache m_themeResources;
+
+	void LoadThemes();
+	void BuildThemeColors();
+	void AddUserThemeMenuItems(HMENU hMenu);
 
 public:
-	AppTheme GetCurrentTheme() const { return m_currentTheme; }
-	void SetTheme(AppTheme theme);
-	const ThemeColors& GetThemeColors() const;
+	int GetCurrentTheme() const { return m_nTheme; }
+	void SetTheme(int nTheme);
+	const ThemeColors& GetThemeColors() const { return m_themeColors[m_nTheme]; }
+	// 当前主题的画刷，返回的引用在程序退出前一直有效
+	const ThemeResources& GetThemeResources();
 	void SaveThemeToRegistry();
 	void LoadThemeFromRegistry();
 	// ====================================
 
+	// ========== 自动换行 ==========
+private:
+	bool m_bWordWrap;
+
+public:
+	bool GetWordWrap() const { return m_bWordWrap; }
+	void SetWordWrap(bool bWrap);
+	// ==============================
+
+	// ========== 字体缓存 ==========
+private:
+	AppFontCache m_fontCache;
+
+public:
+	// 同一字体名和字号只创建和测量一次，返回的字体在程序退出前一直有效
+	const AppFontCache::Entry& GetFont(LPCTSTR lpszFace, int nPointSize);
+	const AppFontCache& GetFontCache() const { return m_fontCache; }
+	// ==============================
+
+	// ========== 崩溃恢复 ==========
+private:
+	TestableLogic::RecoveryService m_recovery;  // 后台线程写未保存文档的快照
+	CString m_strRecoveryDir;
+	CString m_strSessionId;
+	HANDLE m_hRecoveryLock;     // 本次运行的锁文件，进程结束（包括崩溃）时由系统删除
+
+	bool StartRecovery();
+	void RestoreRecoveredDocuments(CDocTemplate* pDocTemplate);
+	bool RestoreRecoveredDocument(CDocTemplate* pDocTemplate, const TestableLogic::RecoveredDocument& recovered);
+
+public:
+	TestableLogic::RecoveryService& GetRecovery() { return m_recovery; }
+	// ==============================
+
+	// ========== 会话恢复 ==========
+private:
+	CSessionManager m_sessionManager;
+
+public:
+	CSessionManager& GetSessionManager() { return m_sessionManager; }
+	// ==============================
+
+	// ========== 文档休眠 ==========
+private:
+	CHibernationManager m_hibernation;
+
+public:
+	CHibernationManager& GetHibernation() { return m_hibernation; }
+	// ==============================
+
+	// ========== 笔记搜索索引 ==========
+private:
+	CSearchIndexManager m_searchIndex;
+
+public:
+	CSearchIndexManager& GetSearchIndex() { return m_searchIndex; }
+	// ==============================
+
 	// 重写
 public:
 	virtual BOOL InitInstance();
@@ -62,8 +147,16 @@ public:
 	afx_msg void OnViewThemeDark();
 	afx_msg void OnUpdateViewThemeLight(CCmdUI* pCmdUI);
 	afx_msg void OnUpdateViewThemeDark(CCmdUI* pCmdUI);
+	afx_msg void OnViewThemeUser(UINT nID);
+	afx_msg void OnUpdateViewThemeUser(CCmdUI* pCmdUI);
 	// ========================================
 
+	afx_msg void OnViewWordWrap();
+	afx_msg void OnUpdateViewWordWrap(CCmdUI* pCmdUI);
+
+	afx_msg void OnEditFindInNotes();
+	afx_msg void OnUpdateEditFindInNotes(CCmdUI* pCmdUI);
+
 	DECLARE_MESSAGE_MAP()
 };
 
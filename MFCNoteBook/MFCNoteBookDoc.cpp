@@ -15,15 +15,27 @@
 #include "CryptoHelper.h"
 #include "RAIIWrappers.h"  // 新增：RAII包装器
 #include "ConfigManager.h"  // 新增
+#include "TextCodec.h"
+#include "EncodingDetector.h"
+#include "FileUtil.h"
 
 #include <propkey.h>
+#include <shlobj.h>
+
+#include <algorithm>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+// 纯文本分块编码写入的缓冲区大小
+#define SAVE_CHUNK_SIZE (64 * 1024)
+// 撤销日志所在的目录（%LOCALAPPDATA% 下）
+#define UNDO_JOURNAL_DIR _T("MFCNoteBook\\Undo")
+
 // 静态成员初始化
 int CMFCNoteBookDoc::s_nUntitledCount = 0;
+UINT CMFCNoteBookDoc::s_nRecoveryCount = 0;
 
 // CMFCNoteBookDoc
 
@@ -38,6 +50,12 @@ END_MESSAGE_MAP()
 CMFCNoteBookDoc::CMFCNoteBookDoc() noexcept
     : m_nUntitledNumber(0)
     , m_fileFormat(FileFormat::PlainText)
+    , m_lineEnding(TestableLogic::LineEnding::CrLf)
+    , m_bMixedLineEndings(false)
+    , m_bLargeFile(false)
+    , m_nRecoveryId(++s_nRecoveryCount)
+    , m_bLoading(false)
+    , m_dwLastActivity(GetTickCount())
 {
 }
 
@@ -50,8 +68,11 @@ BOOL CMFCNoteBookDoc::OnNewDocument()
     if (!CDocument::OnNewDocument())
         return FALSE;
 
+    ReleaseLargeFile();
     m_strContent.Empty();
     m_fileFormat = FileFormat::PlainText;
+    m_lineEnding = TestableLogic::LineEnding::CrLf;
+    m_bMixedLineEndings = false;
     m_nUntitledNumber = ++s_nUntitledCount;
     UpdateDocumentTitle();
 
@@ -104,13 +125,44 @@ BOOL CMFCNoteBookDoc::SaveAsPlainText(LPCTSTR lpszPathName)
             BYTE bom[3] = { 0xEF, 0xBB, 0xBF };
             file.Write(bom, 3);
 
-            // 转换为 UTF-8
-            int nLen = WideCharToMultiByte(CP_UTF8, 0, m_strContent, -1, NULL, 0, NULL, NULL);
-            if (nLen > 1)
+            // 分块写入，不分配整篇文档大小的中间缓冲区：
+            // 先把一块内容的 CRLF 转回文件原来的换行约定，再把这一块转换为 UTF-8
+            std::vector<wchar_t> lineChunk(SAVE_CHUNK_SIZE);
+            std::vector<char> chunk(SAVE_CHUNK_SIZE);
+            const wchar_t* pSrc = m_strContent.GetString();
+            size_t nRemain = static_cast<size_t>(m_strContent.GetLength());
+            while (nRemain > 0)
             {
-                std::vector<char> utf8Buffer(nLen);
-                WideCharToMultiByte(CP_UTF8, 0, m_strContent, -1, utf8Buffer.data(), nLen, NULL, NULL);
-                file.Write(utf8Buffer.data(), nLen - 1);
+                const wchar_t* pBlock = pSrc;
+                size_t nBlockLen = nRemain;
+                size_t nConsumed = nRemain;
+                if (m_lineEnding != TestableLogic::LineEnding::CrLf)
+                {
+                    // 传入剩余全部内容，保证块尾的 CRLF 不被拆开
+                    TestableLogic::LineEndingConvertResult converted = TestableLogic::ConvertLineEndings(
+                        pSrc, nRemain, m_lineEnding, lineChunk.data(), lineChunk.size());
+                    pBlock = lineChunk.data();
+                    nBlockLen = converted.outputLength;
+                    nConsumed = converted.consumed;
+
+                    // 代理对不跨块：块尾是高代理项时留到下一块
+                    if (nConsumed < nRemain && nBlockLen > 1 && IS_HIGH_SURROGATE(pBlock[nBlockLen - 1]))
+                    {
+                        nBlockLen--;
+                        nConsumed--;
+                    }
+                }
+
+                while (nBlockLen > 0)
+                {
+                    TestableLogic::Utf16EncodeResult result =
+                        TestableLogic::Utf16ToUtf8(pBlock, nBlockLen, chunk.data(), chunk.size());
+                    file.Write(chunk.data(), (UINT)result.outputLength);
+                    pBlock += result.consumed;
+                    nBlockLen -= result.consumed;
+                }
+                pSrc += nConsumed;
+                nRemain -= nConsumed;
             }
 
             // 文件在此自动关闭（RAII）
@@ -150,18 +202,15 @@ BOOL CMFCNoteBookDoc::SaveAsMyNote(LPCTSTR lpszPathName)
             strncpy_s(studentId, asciiStudentID, _TRUNCATE);
             file.Write(studentId, MYNOTE_STUDENTID_SIZE);
 
-            // === 2. 转换内容为 UTF-8 ===
-            std::vector<char> utf8Content;
-            int nLen = WideCharToMultiByte(CP_UTF8, 0, m_strContent, -1, NULL, 0, NULL, NULL);
-            if (nLen > 1)
-            {
-                utf8Content.resize(nLen);
-                WideCharToMultiByte(CP_UTF8, 0, m_strContent, -1, utf8Content.data(), nLen, NULL, NULL);
-                nLen--;
-            }
-            else
+            // === 2. 转换内容为 UTF-8（先算精确长度，一次分配） ===
+            CString strContent = GetContentForSave();
+            const wchar_t* pSrc = strContent.GetString();
+            size_t nSrcLen = static_cast<size_t>(strContent.GetLength());
+            std::vector<char> utf8Content(TestableLogic::Utf16ToUtf8Length(pSrc, nSrcLen));
+            int nLen = (int)utf8Content.size();
+            if (nLen > 0)
             {
-                nLen = 0;
+                TestableLogic::Utf16ToUtf8(pSrc, nSrcLen, utf8Content.data(), utf8Content.size());
             }
 
             UINT32 contentLen = (UINT32)nLen;
@@ -244,61 +293,309 @@ BOOL CMFCNoteBookDoc::LoadPlainText(LPCTSTR lpszPathName)
 {
     return CErrorHandler::SafeFileOperation([&]()
         {
-            // RAII: 文件会在作用域结束时自动关闭
-            CFileWrapper file(lpszPathName, CFile::modeRead | CFile::shareDenyNone);
-            ULONGLONG nFileLen = file.GetLength();
+            ReadPlainTextFile(lpszPathName, m_strContent);
+        }, _T("加载文本文件"));
+}
 
-            if (nFileLen == 0)
-            {
-                m_strContent.Empty();
-                return;  // 文件自动关闭
-            }
+// 读入并解码纯文本文件：不弹出对话框，也不修改文档，会话恢复时在后台线程中调用
+void CMFCNoteBookDoc::ReadPlainTextFile(LPCTSTR lpszPathName, CString& strContent)
+{
+    // RAII: 文件会在作用域结束时自动关闭
+    CFileWrapper file(lpszPathName, CFile::modeRead | CFile::shareDenyNone);
+    ULONGLONG nFileLen = file.GetLength();
 
-            // 防止文件过大
-            if (nFileLen > 100 * 1024 * 1024)  // 100MB 限制
-            {
-                throw std::runtime_error("文件过大，超过100MB限制");
-            }
+    if (nFileLen == 0)
+    {
+        strContent.Empty();
+        return;  // 文件自动关闭
+    }
+
+    // 防止文件过大
+    if (nFileLen > 100 * 1024 * 1024)  // 100MB 限制
+    {
+        throw std::runtime_error("文件过大，超过100MB限制");
+    }
+
+    // 读缓冲区直接使用 CString 的存储：UTF-16 文件原地转换后由 strContent 共享（引用计数），
+    // 不再复制；其他编码从这里解码到 strContent
+    size_t nBytes = static_cast<size_t>(nFileLen);
+    CString strBuffer;
+    LPWSTR pBuffer = strBuffer.GetBufferSetLength(
+        static_cast<int>(TestableLogic::Utf16BytesToUnitsLength(nBytes)));
+    file.Read(pBuffer, (UINT)nBytes);
+
+    // 检测编码：有 BOM 时按 BOM，否则对采样窗口做统计判断
+    TestableLogic::EncodingDetectResult detected = TestableLogic::DetectTextEncoding(pBuffer, nBytes);
+    const char* pText = reinterpret_cast<const char*>(pBuffer) + detected.bomLength;
+    size_t nTextLen = nBytes - detected.bomLength;
+
+    TRACE(_T("检测到编码: %S（置信度 %d）\n"),
+        TestableLogic::GetTextEncodingName(detected.encoding), detected.confidence);
+
+    switch (detected.encoding)
+    {
+    case TestableLogic::TextEncoding::Ascii:
+    case TestableLogic::TextEncoding::Utf8:
+        // 直接转码到文档缓冲区，不经过中间数组
+        DecodeUTF8Content(pText, nTextLen, strContent);
+        break;
+    case TestableLogic::TextEncoding::Utf16LE:
+    case TestableLogic::TextEncoding::Utf16BE:
+        AdoptUTF16Buffer(strBuffer, detected.bomLength, nTextLen,
+            detected.encoding == TestableLogic::TextEncoding::Utf16BE, strContent);
+        break;
+    case TestableLogic::TextEncoding::Gb18030:
+        DecodeMultiByteContent(CODEPAGE_GB18030, pText, nTextLen, strContent);
+        break;
+    default:
+        DecodeMultiByteContent(CP_ACP, pText, nTextLen, strContent);
+        break;
+    }
+
+    // 文件在此自动关闭（RAII）
+}
+
+// UTF-8 转码：按最大长度预留 CString 缓冲区，转码后按实际长度释放
+void CMFCNoteBookDoc::DecodeUTF8Content(const char* pData, size_t nLen, CString& strContent)
+{
+    if (nLen == 0)
+    {
+        strContent.Empty();
+        return;
+    }
+
+    LPWSTR pBuffer = strContent.GetBufferSetLength(static_cast<int>(TestableLogic::Utf8ToUtf16MaxLength(nLen)));
+    TestableLogic::Utf8DecodeResult result = TestableLogic::Utf8ToUtf16(pData, nLen, pBuffer);
+    strContent.ReleaseBufferSetLength(static_cast<int>(result.outputLength));
+
+    if (result.invalidCount > 0)
+    {
+        TRACE(_T("警告：UTF-8 内容含 %u 个非法序列，首个位于字节偏移 %u，已替换为 U+FFFD\n"),
+            (UINT)result.invalidCount, (UINT)result.firstErrorOffset);
+    }
+}
+
+// UTF-16 内容：strBuffer 中是刚读入的原始字节，BOM 之后的 nLen 字节原地转换为本机字节序
+// （BE 用 SIMD 交换，LE 只需前移 BOM 的两个字节），再作为文档内容共享同一块存储。
+// 嵌入的 NUL 按显式长度保留，奇数长度时末尾的孤立字节记为 U+FFFD
+void CMFCNoteBookDoc::AdoptUTF16Buffer(CString& strBuffer, size_t nOffset, size_t nLen, bool bBigEndian,
+    CString& strContent)
+{
+    LPWSTR pBuffer = strBuffer.GetBuffer();
+    const BYTE* pSrc = reinterpret_cast<const BYTE*>(pBuffer) + nOffset;
+    size_t nUnits = TestableLogic::Utf16BytesToUnits(pSrc, nLen, bBigEndian, pBuffer);
+    strBuffer.ReleaseBufferSetLength(static_cast<int>(nUnits));
+    strContent = strBuffer;
+}
+
+// 检测换行约定：纯 CRLF（或没有换行）时不做任何复制，否则按精确长度一次转换为 CRLF
+void CMFCNoteBookDoc::NormalizeLineEndingsForEdit()
+{
+    NormalizeLineEndings(m_strContent, m_lineEnding, m_bMixedLineEndings);
+}
+
+void CMFCNoteBookDoc::NormalizeLineEndings(CString& strContent, TestableLogic::LineEnding& lineEnding,
+    bool& bMixed)
+{
+    size_t nLen = static_cast<size_t>(strContent.GetLength());
+    TestableLogic::LineEndingStats stats = TestableLogic::CountLineEndings(strContent.GetString(), nLen);
+    lineEnding = TestableLogic::GetDominantLineEnding(stats);
+    bMixed = TestableLogic::IsMixedLineEndings(stats);
+
+    TRACE(_T("换行约定: %S%s\n"), TestableLogic::GetLineEndingName(lineEnding),
+        bMixed ? _T("（混合）") : _T(""));
+
+    if (stats.lf == 0 && stats.cr == 0)
+        return;
+
+    size_t nNewLen = TestableLogic::GetConvertedLength(stats, nLen, TestableLogic::LineEnding::CrLf);
+    CString strConverted;
+    LPWSTR pBuffer = strConverted.GetBufferSetLength(static_cast<int>(nNewLen));
+    TestableLogic::ConvertLineEndings(strContent.GetString(), nLen, TestableLogic::LineEnding::CrLf,
+        pBuffer, nNewLen);
+    strConverted.ReleaseBufferSetLength(static_cast<int>(nNewLen));
+    strContent = strConverted;
+}
+
+CString CMFCNoteBookDoc::GetContentForSave() const
+{
+    if (m_lineEnding == TestableLogic::LineEnding::CrLf)
+        return m_strContent;
+
+    size_t nLen = static_cast<size_t>(m_strContent.GetLength());
+    TestableLogic::LineEndingStats stats = TestableLogic::CountLineEndings(m_strContent.GetString(), nLen);
+    size_t nNewLen = TestableLogic::GetConvertedLength(stats, nLen, m_lineEnding);
+
+    CString strConverted;
+    LPWSTR pBuffer = strConverted.GetBufferSetLength(static_cast<int>(nNewLen));
+    TestableLogic::ConvertLineEndings(m_strContent.GetString(), nLen, m_lineEnding, pBuffer, nNewLen);
+    strConverted.ReleaseBufferSetLength(static_cast<int>(nNewLen));
+    return strConverted;
+}
+
+CString CMFCNoteBookDoc::GetTextRange(size_t nStart, size_t nEnd) const
+{
+    if (m_bLargeFile)
+    {
+        nEnd = (std::min)(nEnd, m_textBuffer.GetLength());
+        if (nStart >= nEnd)
+            return CString();
+        std::string bytes = m_textBuffer.GetText(nStart, nEnd);
+        std::u16string text = TestableLogic::Utf8ToUtf16String(bytes.data(), bytes.size());
+        return CString(reinterpret_cast<LPCWSTR>(text.data()), static_cast<int>(text.size()));
+    }
+
+    size_t nLen = static_cast<size_t>(m_strContent.GetLength());
+    nEnd = (std::min)(nEnd, nLen);
+    if (nStart >= nEnd)
+        return CString();
+    return CString(m_strContent.GetString() + nStart, static_cast<int>(nEnd - nStart));
+}
+
+// 超大文件：达到阈值的 UTF-8/ASCII 文件直接映射，作为片段表的原始内容，
+// 额外内存只有稀疏行索引；含有超长行的文件同样处理（自绘编辑器按块排版超长行）。
+// 其他编码或较小的文件返回 FALSE，走普通加载流程
+BOOL CMFCNoteBookDoc::TryLoadLargeText(LPCTSTR lpszPathName)
+{
+    CT2A utf8Path(lpszPathName, CP_UTF8);
+    return MapLargeText(std::string(utf8Path), LARGE_FILE_THRESHOLD, LONG_LINE_FILE_THRESHOLD) ? TRUE : FALSE;
+}
+
+bool CMFCNoteBookDoc::MapLargeText(const std::string& utf8Path, size_t nMinSize, size_t nMinLineLength)
+{
+    size_t nMinMapped = (nMinLineLength != 0) ? (std::min)(nMinSize, nMinLineLength) : nMinSize;
+    if (!m_mappedFile.Open(utf8Path) || m_mappedFile.Size() < nMinMapped)
+    {
+        m_mappedFile.Close();
+        return false;
+    }
 
-            std::vector<char> buffer(static_cast<size_t>(nFileLen + 1));
-            file.Read(buffer.data(), (UINT)nFileLen);
-            buffer[static_cast<size_t>(nFileLen)] = '\0';
+    TestableLogic::EncodingDetectResult detected =
+        TestableLogic::DetectTextEncoding(m_mappedFile.Data(), m_mappedFile.Size());
+    if (detected.encoding != TestableLogic::TextEncoding::Ascii &&
+        detected.encoding != TestableLogic::TextEncoding::Utf8)
+    {
+        m_mappedFile.Close();
+        return false;
+    }
 
-            char* pText = buffer.data();
-            int nCodePage = CP_ACP;
+    const char* pText = reinterpret_cast<const char*>(m_mappedFile.Data()) + detected.bomLength;
+    size_t nTextLen = m_mappedFile.Size() - detected.bomLength;
+    if (m_mappedFile.Size() < nMinSize && TestableLogic::GetLongestLineLength(pText, nTextLen) < nMinLineLength)
+    {
+        m_mappedFile.Close();
+        return false;
+    }
+    m_textBuffer.AttachOriginal(pText, nTextLen);
+
+    // 换行原样保留，只按第一个换行决定回车时插入的换行
+    const char* pLf = static_cast<const char*>(memchr(pText, '\n', nTextLen));
+    m_lineEnding = (pLf && (pLf == pText || pLf[-1] != '\r')) ?
+        TestableLogic::LineEnding::Lf : TestableLogic::LineEnding::CrLf;
+    m_bMixedLineEndings = false;
+    m_strContent.Empty();
+    m_bLargeFile = true;
+
+    TRACE(_T("超大文件已映射: %Iu 字节，%Iu 行\n"), nTextLen, m_textBuffer.GetLineCount());
+    return true;
+}
+
+bool CMFCNoteBookDoc::RemapSavedText(const std::string& utf8Path)
+{
+    if (!m_mappedFile.Open(utf8Path))
+        return false;
+
+    // 保存时写入了 UTF-8 BOM
+    TestableLogic::EncodingDetectResult detected =
+        TestableLogic::DetectTextEncoding(m_mappedFile.Data(), m_mappedFile.Size());
+    const char* pText = reinterpret_cast<const char*>(m_mappedFile.Data()) + detected.bomLength;
+    if (!m_textBuffer.ReplaceOriginal(pText, m_mappedFile.Size() - detected.bomLength))
+    {
+        m_mappedFile.Close();
+        return false;
+    }
+    return true;
+}
+
+void CMFCNoteBookDoc::ReleaseLargeFile()
+{
+    m_textBuffer.Clear();
+    m_mappedFile.Close();
+    m_bLargeFile = false;
+}
+
+// 超大文件保存：原文件仍被映射时不能覆盖，所以先把片段依次写入临时文件，
+// 解除映射后替换目标文件，再映射新文件（内容相同，视图重新绑定片段）
+BOOL CMFCNoteBookDoc::SaveLargeText(LPCTSTR lpszPathName)
+{
+    CT2A utf8Path(lpszPathName, CP_UTF8);
+    std::string strPath(utf8Path);
+    std::string strTmpPath = strPath + ".tmp";
 
-            // 检测 BOM
-            if (nFileLen >= 3 &&
-                (BYTE)buffer[0] == 0xEF &&
-                (BYTE)buffer[1] == 0xBB &&
-                (BYTE)buffer[2] == 0xBF)
+    BOOL bWritten = CErrorHandler::SafeFileOperation([&]()
+        {
+            FILE* fp = FileUtil::Open(strTmpPath, "wb");
+            if (!fp)
             {
-                // UTF-8 BOM
-                pText = buffer.data() + 3;
-                nCodePage = CP_UTF8;
+                throw std::runtime_error("无法创建临时文件");
             }
-            else if (nFileLen >= 2 &&
-                (BYTE)buffer[0] == 0xFF &&
-                (BYTE)buffer[1] == 0xFE)
+
+            // 与 SaveAsPlainText 一致，写入 UTF-8 BOM
+            static const unsigned char bom[3] = { 0xEF, 0xBB, 0xBF };
+            bool bOk = fwrite(bom, 1, sizeof(bom), fp) == sizeof(bom);
+            for (const TestableLogic::TextBuffer::Piece& piece : m_textBuffer.GetPieces())
             {
-                // UTF-16 LE BOM
-                pText = buffer.data() + 2;
-                m_strContent = (wchar_t*)pText;
-                return;  // 文件自动关闭
+                if (!bOk)
+                    break;
+                bOk = fwrite(m_textBuffer.GetPieceData(piece), 1, piece.length, fp) == piece.length;
             }
+            bOk = (fclose(fp) == 0) && bOk;
 
-            // 转换为 Unicode
-            int nWideLen = MultiByteToWideChar(nCodePage, 0, pText, -1, NULL, 0);
-            if (nWideLen > 0)
+            if (!bOk)
             {
-                std::vector<wchar_t> wideBuffer(nWideLen);
-                MultiByteToWideChar(nCodePage, 0, pText, -1, wideBuffer.data(), nWideLen);
-                m_strContent = wideBuffer.data();
+                FileUtil::Remove(strTmpPath);
+                throw std::runtime_error("写入临时文件失败");
             }
+        }, _T("保存超大文本文件"));
 
-            // 文件在此自动关闭（RAII）
+    if (!bWritten)
+        return FALSE;
 
-        }, _T("加载文本文件"));
+    // 解除映射前先让视图把撤销快照改写到保存后的内容上，旧文件中只被快照引用的部分
+    // 复制进添加缓冲区；重新映射时保留添加缓冲区，撤销记录仍然有效。
+    // 替换失败时改为映射临时文件（内容就是当前的编辑结果），编辑不会丢失
+    UpdateAllViews(NULL, HINT_LARGE_FILE_SAVING);
+    m_mappedFile.Close();
+    bool bReplaced = FileUtil::Replace(strTmpPath, strPath);
+    if (!RemapSavedText(bReplaced ? strPath : strTmpPath))
+    {
+        ReleaseLargeFile();
+        AfxMessageBox(_T("保存后无法重新打开文件"), MB_ICONERROR);
+        return FALSE;
+    }
+    UpdateAllViews(NULL, HINT_LARGE_FILE_RELOADED);
+
+    if (!bReplaced)
+    {
+        AfxMessageBox(_T("保存失败：无法替换目标文件"), MB_ICONERROR);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// 按代码页转换（GB18030 或系统 ANSI 代码页）
+void CMFCNoteBookDoc::DecodeMultiByteContent(UINT nCodePage, const char* pData, size_t nLen, CString& strContent)
+{
+    int nWideLen = (nLen > 0) ? MultiByteToWideChar(nCodePage, 0, pData, (int)nLen, NULL, 0) : 0;
+    if (nWideLen <= 0)
+    {
+        strContent.Empty();
+        return;
+    }
+
+    LPWSTR pBuffer = strContent.GetBufferSetLength(nWideLen);
+    MultiByteToWideChar(nCodePage, 0, pData, (int)nLen, pBuffer, nWideLen);
+    strContent.ReleaseBufferSetLength(nWideLen);
 }
 
 // 加载 MyNote 格式（使用RAII）
@@ -306,173 +603,278 @@ BOOL CMFCNoteBookDoc::LoadMyNote(LPCTSTR lpszPathName)
 {
     return CErrorHandler::SafeFileOperation([&]()
         {
-            // ========== 从配置读取学号和密钥 ==========
-            CConfigManager& config = CConfigManager::GetInstance();
-            if (!config.IsConfigValid())
-            {
-                throw std::runtime_error("配置未加载或无效");
-            }
+            LoadedText loaded;
+            ReadMyNoteFile(lpszPathName, loaded);
+            ConfirmMyNote(loaded);
+            m_strContent = loaded.strContent;
+        }, _T("加载 MyNote 文件"));
+}
 
-            CString strStudentID = config.GetStudentID();
-            CString strSecretKey = config.GetSecretKey();
+// 读入、校验并解码 MyNote 文件：学号和摘要的检查结果记在 loaded 中，由 ConfirmMyNote 提示用户
+void CMFCNoteBookDoc::ReadMyNoteFile(LPCTSTR lpszPathName, LoadedText& loaded)
+{
+    // ========== 从配置读取学号和密钥 ==========
+    CConfigManager& config = CConfigManager::GetInstance();
+    if (!config.IsConfigValid())
+    {
+        throw std::runtime_error("配置未加载或无效");
+    }
 
-            // ✅ 添加调试输出
-            TRACE(_T("=== 开始加载 MyNote 文件 ===\n"));
-            TRACE(_T("当前学号: %s\n"), strStudentID.GetString());
-            // ==========================================
+    CString strStudentID = config.GetStudentID();
+    CString strSecretKey = config.GetSecretKey();
 
-            CFileWrapper file(lpszPathName, CFile::modeRead | CFile::shareDenyNone);
-            ULONGLONG nFileLen = file.GetLength();
+    // ✅ 添加调试输出
+    TRACE(_T("=== 开始加载 MyNote 文件 ===\n"));
+    TRACE(_T("当前学号: %s\n"), strStudentID.GetString());
+    // ==========================================
 
-            UINT minLen = MYNOTE_MAGIC_SIZE + MYNOTE_STUDENTID_SIZE +
-                sizeof(UINT32) + MYNOTE_IV_SIZE + MYNOTE_ENCRYPTED_SIZE;
-            if (nFileLen < minLen)
-            {
-                throw std::runtime_error("无效的 MyNote 文件格式：文件过小");
-            }
+    CFileWrapper file(lpszPathName, CFile::modeRead | CFile::shareDenyNone);
+    ULONGLONG nFileLen = file.GetLength();
 
-            // === 1. 读取并验证 Magic ===
-            char magic[MYNOTE_MAGIC_SIZE + 1] = { 0 };
-            file.Read(magic, MYNOTE_MAGIC_SIZE);
-            if (memcmp(magic, MYNOTE_MAGIC, MYNOTE_MAGIC_SIZE) != 0)
-            {
-                throw std::runtime_error("无效的 MyNote 文件头");
-            }
+    UINT minLen = MYNOTE_MAGIC_SIZE + MYNOTE_STUDENTID_SIZE +
+        sizeof(UINT32) + MYNOTE_IV_SIZE + MYNOTE_ENCRYPTED_SIZE;
+    if (nFileLen < minLen)
+    {
+        throw std::runtime_error("无效的 MyNote 文件格式：文件过小");
+    }
 
-            // === 2. 读取学号 ===
-            char studentId[MYNOTE_STUDENTID_SIZE + 1] = { 0 };
-            file.Read(studentId, MYNOTE_STUDENTID_SIZE);
+    // === 1. 读取并验证 Magic ===
+    char magic[MYNOTE_MAGIC_SIZE + 1] = { 0 };
+    file.Read(magic, MYNOTE_MAGIC_SIZE);
+    if (memcmp(magic, MYNOTE_MAGIC, MYNOTE_MAGIC_SIZE) != 0)
+    {
+        throw std::runtime_error("无效的 MyNote 文件头");
+    }
 
-            // ✅ 添加调试输出
-            TRACE(_T("文件中的学号: %S\n"), studentId);
+    // === 2. 读取学号 ===
+    char studentId[MYNOTE_STUDENTID_SIZE + 1] = { 0 };
+    file.Read(studentId, MYNOTE_STUDENTID_SIZE);
 
-            CT2A asciiStudentID(strStudentID, CP_UTF8);
-            if (strcmp(studentId, asciiStudentID) != 0)
-            {
-                TRACE(_T("警告：学号不匹配！\n"));
-                CString strMsg;
-                strMsg.Format(_T("文件学号 [%S] 与当前学号 [%s] 不匹配，继续打开？"),
-                    studentId, strStudentID.GetString());
-                if (AfxMessageBox(strMsg, MB_YESNO | MB_ICONWARNING) != IDYES)
-                {
-                    throw std::runtime_error("用户取消打开文件");
-                }
-            }
+    // ✅ 添加调试输出
+    TRACE(_T("文件中的学号: %S\n"), studentId);
 
-            // === 3. 读取内容长度 ===
-            UINT32 contentLen = 0;
-            file.Read(&contentLen, sizeof(UINT32));
+    // 学号不符时由 ConfirmMyNote 询问是否继续打开
+    CT2A asciiStudentID(strStudentID, CP_UTF8);
+    loaded.strFileStudentID = CString(studentId);
+    loaded.bStudentIDMatches = strcmp(studentId, asciiStudentID) == 0;
+    if (!loaded.bStudentIDMatches)
+    {
+        TRACE(_T("警告：学号不匹配！\n"));
+    }
 
-            // ✅ 添加调试输出
-            TRACE(_T("内容长度: %d 字节\n"), contentLen);
+    // === 3. 读取内容长度 ===
+    UINT32 contentLen = 0;
+    file.Read(&contentLen, sizeof(UINT32));
 
-            if (contentLen > 100 * 1024 * 1024)
-            {
-                throw std::runtime_error("文件内容过大，超过100MB限制");
-            }
+    // ✅ 添加调试输出
+    TRACE(_T("内容长度: %d 字节\n"), contentLen);
 
-            // === 4. 读取内容 ===
-            std::vector<char> content(contentLen + 1);
-            if (contentLen > 0)
-            {
-                file.Read(content.data(), contentLen);
-            }
-            content[contentLen] = '\0';
+    if (contentLen > 100 * 1024 * 1024)
+    {
+        throw std::runtime_error("文件内容过大，超过100MB限制");
+    }
 
-            // === 5. 读取 IV 和加密摘要 ===
-            BYTE iv[MYNOTE_IV_SIZE];
-            BYTE encryptedHash[MYNOTE_ENCRYPTED_SIZE];
-            file.Read(iv, MYNOTE_IV_SIZE);
-            file.Read(encryptedHash, MYNOTE_ENCRYPTED_SIZE);
+    // === 4. 读取内容 ===
+    std::vector<char> content(contentLen + 1);
+    if (contentLen > 0)
+    {
+        file.Read(content.data(), contentLen);
+    }
+    content[contentLen] = '\0';
 
-            // ✅ 添加调试输出：显示读取的 IV
-            CString strIV;
-            for (int i = 0; i < MYNOTE_IV_SIZE; i++)
-            {
-                CString strByte;
-                strByte.Format(_T("%02X"), iv[i]);
-                strIV += strByte;
-            }
-            TRACE(_T("读取的 IV: %s\n"), strIV.GetString());
+    // === 5. 读取 IV 和加密摘要 ===
+    BYTE iv[MYNOTE_IV_SIZE];
+    BYTE encryptedHash[MYNOTE_ENCRYPTED_SIZE];
+    file.Read(iv, MYNOTE_IV_SIZE);
+    file.Read(encryptedHash, MYNOTE_ENCRYPTED_SIZE);
 
-            // === 6. 验证摘要 ===
-            BYTE computedHash[MYNOTE_HASH_SIZE] = { 0 };
-            if (contentLen > 0)
-            {
-                CCryptoHelper::ComputeSHA1((const BYTE*)content.data(), contentLen,
-                    computedHash, MYNOTE_HASH_SIZE);
-            }
-            else
-            {
-                CCryptoHelper::ComputeSHA1((const BYTE*)"", 0, computedHash, MYNOTE_HASH_SIZE);
-            }
+    // ✅ 添加调试输出：显示读取的 IV
+    CString strIV;
+    for (int i = 0; i < MYNOTE_IV_SIZE; i++)
+    {
+        CString strByte;
+        strByte.Format(_T("%02X"), iv[i]);
+        strIV += strByte;
+    }
+    TRACE(_T("读取的 IV: %s\n"), strIV.GetString());
 
-            // ✅ 添加调试输出：显示计算的 SHA-1
-            CString strComputedSHA1;
-            for (int i = 0; i < MYNOTE_HASH_SIZE; i++)
-            {
-                CString strByte;
-                strByte.Format(_T("%02X"), computedHash[i]);
-                strComputedSHA1 += strByte;
-            }
-            TRACE(_T("计算的 SHA-1: %s\n"), strComputedSHA1.GetString());
+    // === 6. 验证摘要 ===
+    BYTE computedHash[MYNOTE_HASH_SIZE] = { 0 };
+    if (contentLen > 0)
+    {
+        CCryptoHelper::ComputeSHA1((const BYTE*)content.data(), contentLen,
+            computedHash, MYNOTE_HASH_SIZE);
+    }
+    else
+    {
+        CCryptoHelper::ComputeSHA1((const BYTE*)"", 0, computedHash, MYNOTE_HASH_SIZE);
+    }
 
-            BYTE decryptedHash[MYNOTE_ENCRYPTED_SIZE] = { 0 };
-            DWORD dwDecryptedLen = MYNOTE_ENCRYPTED_SIZE;
+    // ✅ 添加调试输出：显示计算的 SHA-1
+    CString strComputedSHA1;
+    for (int i = 0; i < MYNOTE_HASH_SIZE; i++)
+    {
+        CString strByte;
+        strByte.Format(_T("%02X"), computedHash[i]);
+        strComputedSHA1 += strByte;
+    }
+    TRACE(_T("计算的 SHA-1: %s\n"), strComputedSHA1.GetString());
 
-            CT2A asciiSecretKey(strSecretKey, CP_UTF8);
-            if (CCryptoHelper::AESDecrypt(encryptedHash, MYNOTE_ENCRYPTED_SIZE,
-                (const BYTE*)(const char*)asciiSecretKey, (DWORD)strlen(asciiSecretKey),
-                iv,
-                decryptedHash, dwDecryptedLen))
-            {
-                // ✅ 添加调试输出：显示解密的 SHA-1
-                CString strDecryptedSHA1;
-                for (int i = 0; i < MYNOTE_HASH_SIZE; i++)
-                {
-                    CString strByte;
-                    strByte.Format(_T("%02X"), decryptedHash[i]);
-                    strDecryptedSHA1 += strByte;
-                }
-                TRACE(_T("解密的 SHA-1: %s\n"), strDecryptedSHA1.GetString());
+    BYTE decryptedHash[MYNOTE_ENCRYPTED_SIZE] = { 0 };
+    DWORD dwDecryptedLen = MYNOTE_ENCRYPTED_SIZE;
 
-                if (memcmp(computedHash, decryptedHash, MYNOTE_HASH_SIZE) != 0)
-                {
-                    TRACE(_T("错误：摘要不匹配！文件可能被篡改\n"));
-                    AfxMessageBox(_T("警告：文件完整性校验失败，内容可能已被篡改！"),
-                        MB_ICONWARNING);
-                }
-                else
-                {
-                    TRACE(_T("成功：摘要验证通过\n"));
-                }
-            }
-            else
-            {
-                TRACE(_T("错误：解密失败\n"));
-                AfxMessageBox(_T("警告：无法解密文件摘要，可能密钥不匹配"), MB_ICONWARNING);
-            }
+    CT2A asciiSecretKey(strSecretKey, CP_UTF8);
+    if (CCryptoHelper::AESDecrypt(encryptedHash, MYNOTE_ENCRYPTED_SIZE,
+        (const BYTE*)(const char*)asciiSecretKey, (DWORD)strlen(asciiSecretKey),
+        iv,
+        decryptedHash, dwDecryptedLen))
+    {
+        // ✅ 添加调试输出：显示解密的 SHA-1
+        CString strDecryptedSHA1;
+        for (int i = 0; i < MYNOTE_HASH_SIZE; i++)
+        {
+            CString strByte;
+            strByte.Format(_T("%02X"), decryptedHash[i]);
+            strDecryptedSHA1 += strByte;
+        }
+        TRACE(_T("解密的 SHA-1: %s\n"), strDecryptedSHA1.GetString());
+
+        if (memcmp(computedHash, decryptedHash, MYNOTE_HASH_SIZE) != 0)
+        {
+            TRACE(_T("错误：摘要不匹配！文件可能被篡改\n"));
+            loaded.digest = MyNoteDigest::Mismatch;
+        }
+        else
+        {
+            TRACE(_T("成功：摘要验证通过\n"));
+            loaded.digest = MyNoteDigest::Ok;
+        }
+    }
+    else
+    {
+        TRACE(_T("错误：解密失败\n"));
+        loaded.digest = MyNoteDigest::DecryptFailed;
+    }
+
+    TRACE(_T("=== 加载完成 ===\n\n"));
+
+    // === 7. 转换内容为 Unicode ===
+    if (contentLen > 0)
+    {
+        DecodeUTF8Content(content.data(), contentLen, loaded.strContent);
+    }
+    else
+    {
+        loaded.strContent.Empty();
+    }
+}
+
+// 学号不符时询问是否继续（选否时抛出异常），摘要校验失败时给出警告
+void CMFCNoteBookDoc::ConfirmMyNote(const LoadedText& loaded)
+{
+    if (!loaded.bStudentIDMatches)
+    {
+        CString strMsg;
+        strMsg.Format(_T("文件学号 [%s] 与当前学号 [%s] 不匹配，继续打开？"),
+            loaded.strFileStudentID.GetString(), CConfigManager::GetInstance().GetStudentID().GetString());
+        if (AfxMessageBox(strMsg, MB_YESNO | MB_ICONWARNING) != IDYES)
+        {
+            throw std::runtime_error("用户取消打开文件");
+        }
+    }
+
+    if (loaded.digest == MyNoteDigest::Mismatch)
+    {
+        AfxMessageBox(_T("警告：文件完整性校验失败，内容可能已被篡改！"), MB_ICONWARNING);
+    }
+    else if (loaded.digest == MyNoteDigest::DecryptFailed)
+    {
+        AfxMessageBox(_T("警告：无法解密文件摘要，可能密钥不匹配"), MB_ICONWARNING);
+    }
+}
+
+bool CMFCNoteBookDoc::ReadDocumentFile(LPCTSTR lpszPathName, LoadedText& loaded, CString& strError)
+{
+    try
+    {
+        loaded.format = DetectFileFormat(lpszPathName);
+        if (loaded.format == FileFormat::MyNote)
+        {
+            ReadMyNoteFile(lpszPathName, loaded);
+        }
+        else
+        {
+            ReadPlainTextFile(lpszPathName, loaded.strContent);
+        }
+        NormalizeLineEndings(loaded.strContent, loaded.lineEnding, loaded.bMixedLineEndings);
+        return true;
+    }
+    catch (const CFileOperationException& ex)
+    {
+        strError = ex.GetFullMessage();
+    }
+    catch (const std::exception& ex)
+    {
+        strError = CString(CA2T(ex.what(), CP_UTF8));
+    }
+    catch (CException* pEx)
+    {
+        TCHAR szError[1024];
+        pEx->GetErrorMessage(szError, 1024);
+        pEx->Delete();
+        strError = szError;
+    }
+    return false;
+}
 
-            TRACE(_T("=== 加载完成 ===\n\n"));
+void CMFCNoteBookDoc::BeginPendingLoad(LPCTSTR lpszPathName)
+{
+    ReleaseLargeFile();
+    m_strContent.Empty();
+    m_bLoading = true;
+    // 先占用路径和标题，窗口在内容载入前就能显示文件名
+    m_strPathName = lpszPathName;
+    SetModifiedFlag(FALSE);
+    UpdateDocumentTitle();
+}
 
-            // === 7. 转换内容为 Unicode ===
-            if (contentLen > 0)
+BOOL CMFCNoteBookDoc::CompletePendingLoad(LPCTSTR lpszPathName, LoadedText* pLoaded)
+{
+    BOOL bResult = FALSE;
+    if (pLoaded == NULL)
+    {
+        // 超大文件等不在后台载入的文档按原来的流程打开
+        bResult = OnOpenDocument(lpszPathName);
+    }
+    else
+    {
+        ReleaseLargeFile();
+        bResult = CErrorHandler::SafeFileOperation([&]()
             {
-                int nWideLen = MultiByteToWideChar(CP_UTF8, 0, content.data(), -1, NULL, 0);
-                if (nWideLen > 0)
+                if (pLoaded->format == FileFormat::MyNote)
                 {
-                    std::vector<wchar_t> wideBuffer(nWideLen);
-                    MultiByteToWideChar(CP_UTF8, 0, content.data(), -1,
-                        wideBuffer.data(), nWideLen);
-                    m_strContent = wideBuffer.data();
+                    ConfirmMyNote(*pLoaded);
                 }
-            }
-            else
-            {
-                m_strContent.Empty();
-            }
+            }, _T("加载 MyNote 文件"));
 
-        }, _T("加载 MyNote 文件"));
+        if (bResult)
+        {
+            m_fileFormat = pLoaded->format;
+            m_strContent = pLoaded->strContent;
+            m_lineEnding = pLoaded->lineEnding;
+            m_bMixedLineEndings = pLoaded->bMixedLineEndings;
+            SetModifiedFlag(FALSE);
+            m_strPathName = lpszPathName;
+            UpdateDocumentTitle();
+        }
+    }
+
+    m_bLoading = false;
+    if (bResult)
+    {
+        UpdateAllViews(NULL, HINT_DOCUMENT_LOADED);
+    }
+    return bResult;
 }
 
 BOOL CMFCNoteBookDoc::OnOpenDocument(LPCTSTR lpszPathName)
@@ -481,11 +883,16 @@ BOOL CMFCNoteBookDoc::OnOpenDocument(LPCTSTR lpszPathName)
     m_fileFormat = DetectFileFormat(lpszPathName);
 
     BOOL bResult = FALSE;
+    ReleaseLargeFile();
 
     if (m_fileFormat == FileFormat::MyNote)
     {
         bResult = LoadMyNote(lpszPathName);
     }
+    else if (TryLoadLargeText(lpszPathName))
+    {
+        bResult = TRUE;
+    }
     else
     {
         bResult = LoadPlainText(lpszPathName);
@@ -493,6 +900,10 @@ BOOL CMFCNoteBookDoc::OnOpenDocument(LPCTSTR lpszPathName)
 
     if (bResult)
     {
+        if (!m_bLargeFile)
+        {
+            NormalizeLineEndingsForEdit();
+        }
         SetModifiedFlag(FALSE);
 
         // 调用基类设置路径（这会自动调用SetPathName）
@@ -509,6 +920,14 @@ BOOL CMFCNoteBookDoc::OnOpenDocument(LPCTSTR lpszPathName)
 
 BOOL CMFCNoteBookDoc::OnSaveDocument(LPCTSTR lpszPathName)
 {
+    if (m_bLoading)
+    {
+        AfxMessageBox(_T("文档仍在载入，请稍后再保存"), MB_ICONINFORMATION);
+        return FALSE;
+    }
+    if (!Rehydrate())
+        return FALSE;
+
     // 保存前，先从 View 同步数据
     POSITION pos = GetFirstViewPosition();
     while (pos != NULL)
@@ -529,9 +948,19 @@ BOOL CMFCNoteBookDoc::OnSaveDocument(LPCTSTR lpszPathName)
 
     if (strPath.Right(7) == _T(".mynote"))
     {
+        if (m_bLargeFile)
+        {
+            AfxMessageBox(_T("超大文件不支持保存为 MyNote 格式，请保存为文本文件"), MB_ICONERROR);
+            return FALSE;
+        }
         m_fileFormat = FileFormat::MyNote;
         bResult = SaveAsMyNote(lpszPathName);
     }
+    else if (m_bLargeFile)
+    {
+        m_fileFormat = FileFormat::PlainText;
+        bResult = SaveLargeText(lpszPathName);
+    }
     else
     {
         m_fileFormat = FileFormat::PlainText;
@@ -542,11 +971,170 @@ BOOL CMFCNoteBookDoc::OnSaveDocument(LPCTSTR lpszPathName)
     {
         SetModifiedFlag(FALSE);
         UpdateDocumentTitle();
+
+#ifndef SHARED_HANDLERS
+        // 笔记目录中的文件追加到搜索索引；超大文件不建立索引（索引需要整篇文本）
+        if (!m_bLargeFile)
+        {
+            theApp.GetSearchIndex().UpdateFile(lpszPathName, m_strContent, m_fileFormat == FileFormat::MyNote);
+        }
+#endif
+
+        // 撤销日志记下保存时的状态（另存为时移到新文件对应的日志）
+        pos = GetFirstViewPosition();
+        while (pos != NULL)
+        {
+            CMFCNoteBookView* pNoteView = DYNAMIC_DOWNCAST(CMFCNoteBookView, GetNextView(pos));
+            if (pNoteView)
+            {
+                pNoteView->OnDocumentSaved(lpszPathName);
+            }
+        }
+
+#ifndef SHARED_HANDLERS
+        // 已经保存，不再需要崩溃恢复快照
+        theApp.GetRecovery().Discard(m_nRecoveryId);
+#endif
     }
 
     return bResult;
 }
 
+void CMFCNoteBookDoc::OnCloseDocument()
+{
+#ifndef SHARED_HANDLERS
+    // 关闭时（包括选择不保存）删除崩溃恢复快照；仍在后台载入时不再交回内容
+    theApp.GetRecovery().Discard(m_nRecoveryId);
+    theApp.GetSessionManager().Cancel(this);
+#endif
+
+    CDocument::OnCloseDocument();
+}
+
+// 休眠：视图先把未处理的编辑同步到 m_strContent，全文压缩后文档和视图都释放自己的副本
+bool CMFCNoteBookDoc::Hibernate()
+{
+    if (!CanHibernate())
+        return false;
+
+    POSITION pos = GetFirstViewPosition();
+    while (pos != NULL)
+    {
+        CMFCNoteBookView* pNoteView = DYNAMIC_DOWNCAST(CMFCNoteBookView, GetNextView(pos));
+        if (pNoteView)
+        {
+            pNoteView->SyncToDocument();
+        }
+    }
+
+    // 视图先写一次崩溃恢复快照再换成占位内容，之后才由文档接管全文
+    UpdateAllViews(NULL, HINT_DOCUMENT_HIBERNATED);
+    size_t nBytes = static_cast<size_t>(m_strContent.GetLength()) * sizeof(TCHAR);
+    m_hibernated.Store(reinterpret_cast<const char16_t*>(m_strContent.GetString()),
+        static_cast<size_t>(m_strContent.GetLength()));
+    m_strContent.Empty();
+
+    TRACE(_T("文档休眠: %s，%Iu 字节压缩为 %Iu 字节\n"), GetTitle().GetString(), nBytes,
+        m_hibernated.GetMemoryBytes());
+    return true;
+}
+
+// 临时文件（%TEMP% 下）用与撤销日志相同的密钥加密，文件名带进程号，崩溃后留下的由下次启动时删除
+bool CMFCNoteBookDoc::SpillHibernated()
+{
+    if (!m_hibernated.IsStored() || m_hibernated.IsSpilled())
+        return false;
+
+    TCHAR szTemp[MAX_PATH];
+    if (GetTempPath(MAX_PATH, szTemp) == 0)
+        return false;
+    CString strPath(szTemp);
+    strPath += CString(TestableLogic::MakeSpillFileName(GetCurrentProcessId(), m_nRecoveryId).c_str());
+
+    TestableLogic::UndoJournalCipher cipher;
+    MakeUndoJournalCipher(cipher);
+    return m_hibernated.Spill(std::string(CT2A(strPath, CP_UTF8)), cipher);
+}
+
+bool CMFCNoteBookDoc::Rehydrate()
+{
+    if (!m_hibernated.IsStored())
+        return true;
+
+    TestableLogic::UndoJournalCipher cipher;
+    if (m_hibernated.IsSpilled())
+    {
+        MakeUndoJournalCipher(cipher);
+    }
+
+    std::u16string text;
+    if (!m_hibernated.Load(&cipher, text))
+    {
+        AfxMessageBox(_T("无法取回休眠文档的内容（临时文件丢失或已损坏）"), MB_ICONERROR);
+        return false;
+    }
+    m_strContent.SetString(reinterpret_cast<LPCWSTR>(text.data()), static_cast<int>(text.size()));
+    UpdateAllViews(NULL, HINT_DOCUMENT_REHYDRATED);
+    return true;
+}
+
+size_t CMFCNoteBookDoc::GetResidentBytes()
+{
+    // 超大文件的内容是映射的原文件，由系统按需换入换出
+    if (m_bLargeFile)
+        return 0;
+
+    size_t nBytes = static_cast<size_t>(m_strContent.GetLength()) * sizeof(TCHAR);
+    POSITION pos = GetFirstViewPosition();
+    while (pos != NULL)
+    {
+        CMFCNoteBookView* pNoteView = DYNAMIC_DOWNCAST(CMFCNoteBookView, GetNextView(pos));
+        if (pNoteView)
+        {
+            nBytes += pNoteView->GetResidentBytes();
+        }
+    }
+    return nBytes;
+}
+
+std::string CMFCNoteBookDoc::GetUndoJournalPath(LPCTSTR lpszPathName)
+{
+    if (lpszPathName == NULL || *lpszPathName == 0)
+        return std::string();
+
+    TCHAR szAppData[MAX_PATH];
+    if (FAILED(SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA | CSIDL_FLAG_CREATE, NULL, 0, szAppData)))
+        return std::string();
+
+    CString strDir(szAppData);
+    strDir += _T("\\") UNDO_JOURNAL_DIR;
+    int nResult = SHCreateDirectoryEx(NULL, strDir, NULL);
+    if (nResult != ERROR_SUCCESS && nResult != ERROR_ALREADY_EXISTS)
+        return std::string();
+
+    // 同一文件不论大小写只对应一个日志
+    CString strKey(lpszPathName);
+    strKey.MakeLower();
+    TestableLogic::TextFingerprint fp = TestableLogic::FingerprintText(strKey.GetString(), strKey.GetLength());
+
+    CString strPath;
+    strPath.Format(_T("%s\\%016llx.undo"), strDir.GetString(), static_cast<unsigned long long>(fp.hash));
+    return std::string(CT2A(strPath, CP_UTF8));
+}
+
+void CMFCNoteBookDoc::MakeUndoJournalCipher(TestableLogic::UndoJournalCipher& cipher)
+{
+    // 校验值与 MAC 密钥都由 HMAC-SHA256 派生，与搜索索引的盐互不相关；每条记录带 MAC，
+    // 撤销日志、崩溃恢复快照和休眠的临时文件被改动时都不会解密
+    std::string key(CT2A(CConfigManager::GetInstance().GetSecretKey(), CP_UTF8));
+    if (!TestableLogic::MakeSecretCipher(key, cipher))
+    {
+        cipher.encrypt = nullptr;
+        cipher.decrypt = nullptr;
+        cipher.keyCheck = 0;
+    }
+}
+
 void CMFCNoteBookDoc::SetPathName(LPCTSTR lpszPathName, BOOL bAddToMRU)
 {
     CDocument::SetPathName(lpszPathName, bAddToMRU);
@@ -3,6 +3,12 @@
 
 #pragma once
 
+#include "LineEnding.h"
+#include "TextBuffer.h"
+#include "MappedFile.h"
+#include "UndoJournal.h"
+#include "Hibernation.h"
+
 // *.mynote 文件格式常量
 #define MYNOTE_MAGIC        "MYNOTE01"
 #define MYNOTE_MAGIC_SIZE   8
@@ -11,6 +17,21 @@
 #define MYNOTE_HASH_SIZE    20
 #define MYNOTE_ENCRYPTED_SIZE 32  // AES 加密后的 SHA1 (20字节 + 填充)
 
+// 达到此大小的 UTF-8/ASCII 文件改为内存映射，由自绘编辑器直接显示，不再整篇转换为 UTF-16
+#define LARGE_FILE_THRESHOLD (64 * 1024 * 1024)
+// 较小的文件中只要有一行达到此长度也由自绘编辑器显示（编辑控件排版超长行时会卡住）
+#define LONG_LINE_FILE_THRESHOLD (1024 * 1024)
+
+// UpdateAllViews 提示：超大文件保存后已重新映射（内容相同，片段需要重新绑定）
+#define HINT_LARGE_FILE_RELOADED 1
+// UpdateAllViews 提示：会话恢复时后台载入的内容已交给文档，视图替换占位内容
+#define HINT_DOCUMENT_LOADED 2
+// UpdateAllViews 提示：文档休眠（视图释放全文的副本）和取回全文
+#define HINT_DOCUMENT_HIBERNATED 3
+#define HINT_DOCUMENT_REHYDRATED 4
+// UpdateAllViews 提示：超大文件即将解除映射并换成保存后的文件，视图先改写撤销快照
+#define HINT_LARGE_FILE_SAVING 5
+
 // 文件类型枚举
 enum class FileFormat
 {
@@ -19,6 +40,14 @@ enum class FileFormat
     MyNote      // *.mynote
 };
 
+// MyNote 摘要校验结果
+enum class MyNoteDigest
+{
+    Ok,
+    Mismatch,       // 内容与摘要不符，可能被篡改
+    DecryptFailed   // 无法解密摘要，可能密钥不匹配
+};
+
 class CMFCNoteBookDoc : public CDocument
 {
 protected:
@@ -29,18 +58,103 @@ protected:
 public:
     CString m_strContent;  // 存储文本内容
     FileFormat m_fileFormat;  // 当前文件格式
+    TestableLogic::LineEnding m_lineEnding;  // 文件原来的换行约定，保存时按它写回
+    bool m_bMixedLineEndings;  // 载入的文件混用了多种换行（保存时统一为 m_lineEnding）
+
+    // 超大文件：m_strContent 保持为空，内容由映射的原文件和编辑片段组成，换行原样保留
+    bool m_bLargeFile;
+    MappedFile m_mappedFile;
+    TestableLogic::TextBuffer m_textBuffer;
 
     // 操作
 public:
     void UpdateDocumentTitle();
 
     // 文件格式相关
-    FileFormat DetectFileFormat(LPCTSTR lpszPathName);
+    static FileFormat DetectFileFormat(LPCTSTR lpszPathName);
     BOOL SaveAsPlainText(LPCTSTR lpszPathName);
     BOOL SaveAsMyNote(LPCTSTR lpszPathName);
     BOOL LoadPlainText(LPCTSTR lpszPathName);
     BOOL LoadMyNote(LPCTSTR lpszPathName);
 
+    // 将 UTF-8 字节直接转码到 strContent（SIMD 单趟校验+转码）
+    static void DecodeUTF8Content(const char* pData, size_t nLen, CString& strContent);
+    // 将读入 strBuffer 的 UTF-16 字节原地转为本机字节序并直接作为 strContent 的存储
+    static void AdoptUTF16Buffer(CString& strBuffer, size_t nOffset, size_t nLen, bool bBigEndian,
+        CString& strContent);
+    static void DecodeMultiByteContent(UINT nCodePage, const char* pData, size_t nLen, CString& strContent);
+
+    // 载入后检测换行约定，并把内容统一转换为编辑控件使用的 CRLF
+    void NormalizeLineEndingsForEdit();
+    static void NormalizeLineEndings(CString& strContent, TestableLogic::LineEnding& lineEnding, bool& bMixed);
+    // 按 m_lineEnding 转换后的内容（CRLF 文件直接共享 m_strContent）
+    CString GetContentForSave() const;
+    // 只复制 [nStart, nEnd) 这一段（越界部分截去）：普通文档按 UTF-16 单元偏移，与编辑控件一致；
+    // 超大文件按缓冲区的字节偏移，换行原样保留
+    CString GetTextRange(size_t nStart, size_t nEnd) const;
+
+    // 超大文件的打开与保存
+    bool IsLargeFile() const { return m_bLargeFile; }
+    BOOL TryLoadLargeText(LPCTSTR lpszPathName);
+    BOOL SaveLargeText(LPCTSTR lpszPathName);
+    void ReleaseLargeFile();
+    // 映射文件并作为缓冲区的原始内容；不是 UTF-8/ASCII，或文件小于 nMinSize
+    // 且没有长度达到 nMinLineLength 的行（为 0 时不检查）时返回 false
+    bool MapLargeText(const std::string& utf8Path, size_t nMinSize, size_t nMinLineLength = 0);
+    // 保存后映射新文件，作为缓冲区的原始内容（内容须与当前文档相同，添加缓冲区保留）
+    bool RemapSavedText(const std::string& utf8Path);
+
+    // 撤销日志：%LOCALAPPDATA%\MFCNoteBook\Undo\<路径哈希>.undo（UTF-8 路径），
+    // 无标题文档或无法创建目录时返回空串（只在内存中记录）
+    static std::string GetUndoJournalPath(LPCTSTR lpszPathName);
+    // *.mynote 的撤销日志用配置中的密钥加密，每条记录使用随机 IV
+    static void MakeUndoJournalCipher(TestableLogic::UndoJournalCipher& cipher);
+
+    // 崩溃恢复快照中标识本文档的编号（本次运行内唯一）
+    UINT GetRecoveryId() const { return m_nRecoveryId; }
+
+    // ========== 会话恢复：后台载入 ==========
+    // 读入、解码并统一换行后的内容，尚未交给文档
+    struct LoadedText
+    {
+        FileFormat format = FileFormat::PlainText;
+        CString strContent;
+        TestableLogic::LineEnding lineEnding = TestableLogic::LineEnding::CrLf;
+        bool bMixedLineEndings = false;
+        // MyNote：文件中的学号及是否与配置一致、摘要校验结果（提示留给界面线程）
+        CString strFileStudentID;
+        bool bStudentIDMatches = true;
+        MyNoteDigest digest = MyNoteDigest::Ok;
+    };
+
+    // 不涉及界面的读入，可以在后台线程中调用；失败时抛出异常
+    static void ReadPlainTextFile(LPCTSTR lpszPathName, CString& strContent);
+    static void ReadMyNoteFile(LPCTSTR lpszPathName, LoadedText& loaded);
+    // 按格式读入并统一换行；失败时返回 false，strError 为原因
+    static bool ReadDocumentFile(LPCTSTR lpszPathName, LoadedText& loaded, CString& strError);
+
+    // 窗口先以占位内容显示，内容在后台载入；完成后在界面线程中调用 CompletePendingLoad，
+    // pLoaded 为 NULL 时按 OnOpenDocument 的流程同步打开（超大文件）
+    void BeginPendingLoad(LPCTSTR lpszPathName);
+    BOOL CompletePendingLoad(LPCTSTR lpszPathName, LoadedText* pLoaded);
+    bool IsLoading() const { return m_bLoading; }
+
+    // ========== 休眠 ==========
+    bool CanHibernate() const { return !m_bLargeFile && !m_bLoading && !m_hibernated.IsStored(); }
+    bool IsHibernated() const { return m_hibernated.IsStored(); }
+    // 同步视图后压缩保存全文，视图释放各自的副本并显示占位内容
+    bool Hibernate();
+    // 休眠的数据加密写入临时文件，释放内存
+    bool SpillHibernated();
+    // 取回全文并通知视图恢复；失败时保持休眠
+    bool Rehydrate();
+    // 窗口激活或失去激活时记下时间，空闲时间从这里算起
+    void TouchActivity() { m_dwLastActivity = GetTickCount(); }
+    DWORD GetLastActivity() const { return m_dwLastActivity; }
+    // 常驻内存的估计：文档和各视图中的全文副本及撤销历史
+    size_t GetResidentBytes();
+    const TestableLogic::HibernatedText& GetHibernatedText() const { return m_hibernated; }
+
     // 重写
 public:
     virtual BOOL OnNewDocument();
@@ -48,6 +162,7 @@ public:
     virtual void SetModifiedFlag(BOOL bModified = TRUE);
     virtual BOOL OnSaveDocument(LPCTSTR lpszPathName);
     virtual BOOL OnOpenDocument(LPCTSTR lpszPathName);
+    virtual void OnCloseDocument();
     virtual void SetPathName(LPCTSTR lpszPathName, BOOL bAddToMRU = TRUE);
 
 #ifdef SHARED_HANDLERS
@@ -66,6 +181,14 @@ public:
 protected:
     static int s_nUntitledCount;
     int m_nUntitledNumber;
+    static UINT s_nRecoveryCount;
+    UINT m_nRecoveryId;
+    bool m_bLoading;
+    TestableLogic::HibernatedText m_hibernated;
+    DWORD m_dwLastActivity;
+
+    // 学号不符时询问是否继续（选否时抛出异常），摘要校验失败时给出警告
+    static void ConfirmMyNote(const LoadedText& loaded);
 
     DECLARE_MESSAGE_MAP()
 
@@ -17,6 +17,20 @@
 #endif
 
 #define IDC_EDIT_CONTROL 1001
+#define IDC_TEXT_EDITOR 1002
+#define EDITOR_FONT_FACE _T("Consolas")
+#define ID_TIMER_FRAME 1
+#define ID_TIMER_UNDO_COMPRESS 2
+// 停止输入这么久之后再压缩较早的撤销记录，每次最多压缩这么多个节点
+#define UNDO_COMPRESS_DELAY 500
+#define UNDO_COMPRESS_BATCH 16
+#define ID_TIMER_AUTOSAVE 3
+// 已修改的文档每隔这么久（毫秒）写一次崩溃恢复快照
+#define AUTOSAVE_INTERVAL (30 * 1000)
+// 会话恢复时文档内容载入前显示的占位内容
+#define LOADING_PLACEHOLDER_TEXT _T("正在载入……")
+// 休眠的文档显示的占位内容（激活窗口时恢复）
+#define HIBERNATED_PLACEHOLDER_TEXT _T("文档已休眠，激活窗口后恢复内容")
 
 IMPLEMENT_DYNCREATE(CMFCNoteBookView, CView)
 
@@ -30,11 +44,17 @@ BEGIN_MESSAGE_MAP(CMFCNoteBookView, CView)
     ON_WM_CTLCOLOR()
     ON_EN_CHANGE(IDC_EDIT_CONTROL, &CMFCNoteBookView::OnEditChange)
     ON_EN_VSCROLL(IDC_EDIT_CONTROL, &CMFCNoteBookView::OnEditScroll)
+    ON_EN_CHANGE(IDC_TEXT_EDITOR, &CMFCNoteBookView::OnTextEditorChange)
+    ON_EN_VSCROLL(IDC_TEXT_EDITOR, &CMFCNoteBookView::OnEditScroll)
 
     ON_COMMAND(ID_EDIT_UNDO, &CMFCNoteBookView::OnEditUndo)
     ON_COMMAND(ID_EDIT_REDO, &CMFCNoteBookView::OnEditRedo)
     ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO, &CMFCNoteBookView::OnUpdateEditUndo)
     ON_UPDATE_COMMAND_UI(ID_EDIT_REDO, &CMFCNoteBookView::OnUpdateEditRedo)
+    ON_COMMAND(ID_EDIT_UNDO_OLDER, &CMFCNoteBookView::OnEditUndoOlder)
+    ON_COMMAND(ID_EDIT_UNDO_NEWER, &CMFCNoteBookView::OnEditUndoNewer)
+    ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO_OLDER, &CMFCNoteBookView::OnUpdateEditUndoOlder)
+    ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO_NEWER, &CMFCNoteBookView::OnUpdateEditUndoNewer)
 
     ON_COMMAND(ID_EDIT_CUT, &CMFCNoteBookView::OnEditCut)
     ON_COMMAND(ID_EDIT_COPY, &CMFCNoteBookView::OnEditCopy)
@@ -42,6 +62,7 @@ BEGIN_MESSAGE_MAP(CMFCNoteBookView, CView)
     ON_UPDATE_COMMAND_UI(ID_EDIT_CUT, &CMFCNoteBookView::OnUpdateEditCut)
     ON_UPDATE_COMMAND_UI(ID_EDIT_COPY, &CMFCNoteBookView::OnUpdateEditCopy)
     ON_UPDATE_COMMAND_UI(ID_EDIT_PASTE, &CMFCNoteBookView::OnUpdateEditPaste)
+    ON_MESSAGE(WM_PASTE_PREPARED, &CMFCNoteBookView::OnPastePrepared)
 
     ON_COMMAND(ID_EDIT_FIND, &CMFCNoteBookView::OnEditFind)
     ON_COMMAND(ID_EDIT_REPLACE, &CMFCNoteBookView::OnEditReplace)
@@ -50,15 +71,26 @@ BEGIN_MESSAGE_MAP(CMFCNoteBookView, CView)
     ON_COMMAND(ID_VIEW_ZOOM_OUT, &CMFCNoteBookView::OnViewZoomOut)
     ON_COMMAND(ID_VIEW_ZOOM_RESET, &CMFCNoteBookView::OnViewZoomReset)
     ON_WM_MOUSEWHEEL()
+    ON_WM_TIMER()
 END_MESSAGE_MAP()
 
 // CMFCNoteBookView 构造/析构
 
 CMFCNoteBookView::CMFCNoteBookView() noexcept
     : m_nLineNumWidth(50)
+    , m_bLargeFile(false)
+    , m_bWordWrap(false)
+    , m_nWrapAnchorChar(-1)
+    , m_nWrapAnchorLine(1)
     , m_bInternalChange(false)
+    , m_bPasteLargeFile(false)
     , m_pFindReplaceDlg(nullptr)
+    , m_pFontEntry(nullptr)
+    , m_pThemeResources(nullptr)
     , m_nFontSize(FONT_SIZE_DEFAULT)
+    , m_nHibernatedSelStart(0)
+    , m_nHibernatedSelEnd(0)
+    , m_nHibernatedFirstLine(0)
 {
 }
 
@@ -85,57 +117,112 @@ void CMFCNoteBookView::OnDraw(CDC* pDC)
     if (!pDoc)
         return;
 
-    // 获取当前主题颜色
-    const ThemeColors& theme = theApp.GetThemeColors();
+    // 行号缓存的位图与屏幕 DC 兼容，打印时不使用
+    if (pDC->IsPrinting())
+        return;
 
-    CRect clientRect;
-    GetClientRect(&clientRect);
+    PaintLineNumbers(pDC, true);
+}
 
-    // 1. 绘制行号区域背景（使用主题颜色）
-    CRect lineNumRect = clientRect;
+// 行号区由 m_gutter 从离屏位图复制，滚动时只补画新露出的行；
+// bWholeGutter 为 false 时只把变化的行复制到屏幕
+void CMFCNoteBookView::PaintLineNumbers(CDC* pDC, bool bWholeGutter)
+{
+    CRect lineNumRect;
+    GetClientRect(&lineNumRect);
     lineNumRect.right = m_nLineNumWidth;
-    pDC->FillSolidRect(lineNumRect, theme.clrLineNumBg);
 
-    // 2. 绘制分隔线（使用主题颜色）
-    pDC->FillSolidRect(m_nLineNumWidth - 1, 0, 1, clientRect.Height(), theme.clrLineNumBorder);
+    // 自动换行时按可视行绘制，续行不显示行号
+    if (m_bWordWrap && GetActiveEditor().GetSafeHwnd())
+    {
+        int nLineHeight = m_gutter.GetLineHeight();
+        size_t rows = static_cast<size_t>((lineNumRect.Height() + nLineHeight - 1) / nLineHeight);
+        ULONGLONG firstRow;
+        if (m_bLargeFile)
+        {
+            firstRow = m_TextEditor.GetFirstVisibleRow();
+            m_TextEditor.GetVisibleRowLines(rows, m_rowLabels);
+        }
+        else
+        {
+            firstRow = m_Edit.GetFirstVisibleLine();
+            GetEditRowLabels(rows, m_rowLabels);
+        }
 
-    // 3. 绘制行号
-    if (!m_Edit.GetSafeHwnd())
+        if (bWholeGutter)
+            m_gutter.PaintLabels(pDC, lineNumRect, firstRow, m_rowLabels);
+        else
+            m_gutter.UpdateLabels(pDC, lineNumRect, firstRow, m_rowLabels);
         return;
+    }
 
-    CFont* pOldFont = pDC->SelectObject(&m_Font);
-
-    TEXTMETRIC tm;
-    pDC->GetTextMetrics(&tm);
-    int lineHeight = tm.tmHeight;
+    ULONGLONG firstVisibleLine = 0;
+    if (GetActiveEditor().GetSafeHwnd())
+    {
+        firstVisibleLine = m_bLargeFile ? m_TextEditor.GetFirstVisibleLine() : m_Edit.GetFirstVisibleLine();
+    }
 
-    int firstVisibleLine = m_Edit.GetFirstVisibleLine();
-    int lineCount = m_Edit.GetLineCount();
+    // 行数来自 m_lineTracker，绘制时不再向编辑控件查询
+    if (bWholeGutter)
+        m_gutter.Paint(pDC, lineNumRect, firstVisibleLine, m_lineTracker.GetLineCount());
+    else
+        m_gutter.Update(pDC, lineNumRect, firstVisibleLine, m_lineTracker.GetLineCount());
+}
 
-    int visibleLines = clientRect.Height() / lineHeight + 2;
+// 自动换行时 CEdit 的行是可视行：可视行起始字符前是换行符时才是逻辑行的开头。
+// 逻辑行号从上次数到的位置开始数换行得到，滚动时只数滚过的部分
+void CMFCNoteBookView::GetEditRowLabels(size_t rows, std::vector<uint64_t>& labels)
+{
+    labels.assign(rows, 0);
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (!pDoc)
+        return;
 
-    pDC->SetBkMode(TRANSPARENT);
-    pDC->SetTextColor(theme.clrLineNumText);  // 使用主题颜色
+    LPCTSTR pText = pDoc->m_strContent;
+    int nLength = pDoc->m_strContent.GetLength();
+    int nFirstRow = m_Edit.GetFirstVisibleLine();
+    int nRowCount = m_Edit.GetLineCount();
 
-    for (int i = 0; i < visibleLines; i++)
+    if (m_nWrapAnchorChar < 0 || m_nWrapAnchorChar > nLength)
     {
-        int lineNum = firstVisibleLine + i + 1;
-        if (lineNum > lineCount)
-            break;
-
-        CString strLineNum;
-        strLineNum.Format(_T("%4d"), lineNum);
+        m_nWrapAnchorChar = 0;
+        m_nWrapAnchorLine = 1;
+    }
 
-        CRect numRect;
-        numRect.left = 5;
-        numRect.right = m_nLineNumWidth - 8;
-        numRect.top = i * lineHeight;
-        numRect.bottom = numRect.top + lineHeight;
+    int nChar = m_nWrapAnchorChar;
+    uint64_t line = m_nWrapAnchorLine;
+    for (size_t row = 0; row < rows && nFirstRow + static_cast<int>(row) < nRowCount; row++)
+    {
+        int nRowStart = min(m_Edit.LineIndex(nFirstRow + static_cast<int>(row)), nLength);
+        for (; nChar < nRowStart; nChar++)
+        {
+            if (pText[nChar] == _T('\n'))
+                line++;
+        }
+        for (; nChar > nRowStart; nChar--)
+        {
+            if (pText[nChar - 1] == _T('\n'))
+                line--;
+        }
 
-        pDC->DrawText(strLineNum, numRect, DT_RIGHT | DT_VCENTER | DT_SINGLELINE);
+        if (row == 0)
+        {
+            m_nWrapAnchorChar = nChar;
+            m_nWrapAnchorLine = line;
+        }
+        if (nRowStart == 0 || pText[nRowStart - 1] == _T('\n'))
+            labels[row] = line;
     }
+}
+
+// 直接画到窗口上，不经过 WM_PAINT（滚动和输入时避免整块失效再重画）
+void CMFCNoteBookView::RepaintLineNumbers()
+{
+    if (!GetSafeHwnd())
+        return;
 
-    pDC->SelectObject(pOldFont);
+    CClientDC dc(this);
+    PaintLineNumbers(&dc, false);
 }
 
 // 打印相关
@@ -176,19 +263,25 @@ int CMFCNoteBookView::OnCreate(LPCREATESTRUCT lpCreateStruct)
     if (CView::OnCreate(lpCreateStruct) == -1)
         return -1;
 
-    CRect rect(m_nLineNumWidth, 0, 100, 100);
-    DWORD dwStyle = WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL |
-        ES_MULTILINE | ES_AUTOVSCROLL | ES_AUTOHSCROLL | ES_WANTRETURN;
+    m_bWordWrap = theApp.GetWordWrap();
 
-    if (!m_Edit.Create(dwStyle, rect, this, IDC_EDIT_CONTROL))
+    CRect rect(m_nLineNumWidth, 0, 100, 100);
+    if (!m_Edit.Create(GetEditStyle() | WS_VISIBLE, rect, this, IDC_EDIT_CONTROL))
     {
         TRACE0("未能创建编辑控件\n");
         return -1;
     }
 
+    // 自绘编辑器先隐藏，打开超大文件时再替换编辑控件
+    if (!m_TextEditor.Create(WS_CHILD | WS_VSCROLL | WS_HSCROLL, rect, this, IDC_TEXT_EDITOR))
+    {
+        TRACE0("未能创建自绘编辑器\n");
+        return -1;
+    }
+    m_TextEditor.SetWordWrap(m_bWordWrap);
+
     // 创建默认字体
-    m_Font.CreatePointFont(m_nFontSize * 10, _T("Consolas"));
-    m_Edit.SetFont(&m_Font);
+    CreateEditFont();
 
     // 初始化时应用主题
     ApplyTheme();
@@ -204,15 +297,101 @@ void CMFCNoteBookView::OnSize(UINT nType, int cx, int cy)
     {
         m_Edit.MoveWindow(m_nLineNumWidth, 0, cx - m_nLineNumWidth, cy);
     }
+    if (m_TextEditor.GetSafeHwnd())
+    {
+        m_TextEditor.MoveWindow(m_nLineNumWidth, 0, cx - m_nLineNumWidth, cy);
+    }
 }
 
-void CMFCNoteBookView::OnSetFocus(CWnd* pOldWnd)
+// 当前显示的编辑器：超大文件用自绘编辑器，其余用 CEdit
+CWnd& CMFCNoteBookView::GetActiveEditor()
 {
-    CView::OnSetFocus(pOldWnd);
+    if (m_bLargeFile)
+        return m_TextEditor;
+    return m_Edit;
+}
 
+// 编辑控件的自动换行由是否带 ES_AUTOHSCROLL 决定，只能在创建时指定
+DWORD CMFCNoteBookView::GetEditStyle() const
+{
+    DWORD dwStyle = WS_CHILD | WS_VSCROLL | ES_MULTILINE | ES_AUTOVSCROLL | ES_WANTRETURN;
+    if (!m_bWordWrap)
+        dwStyle |= WS_HSCROLL | ES_AUTOHSCROLL;
+    return dwStyle;
+}
+
+void CMFCNoteBookView::SetWordWrap(bool bWrap)
+{
+    if (bWrap == m_bWordWrap)
+        return;
+
+    FlushFrameWork();
+    m_bWordWrap = bWrap;
+    m_nWrapAnchorChar = -1;
+    m_TextEditor.SetWordWrap(bWrap);
     if (m_Edit.GetSafeHwnd())
+        RecreateEditControl();
+
+    UpdateLineNumberWidth();
+    RepaintLineNumbers();
+}
+
+// 重建编辑控件，保留内容、选区、滚动位置和焦点
+void CMFCNoteBookView::RecreateEditControl()
+{
+    CString strText;
+    m_Edit.GetWindowText(strText);
+    int nStart = 0, nEnd = 0;
+    m_Edit.GetSel(nStart, nEnd);
+    int nFirstChar = m_Edit.LineIndex(m_Edit.GetFirstVisibleLine());
+    bool bVisible = m_Edit.IsWindowVisible() != FALSE;
+    bool bReadOnly = (m_Edit.GetStyle() & ES_READONLY) != 0;
+    bool bFocus = ::GetFocus() == m_Edit.GetSafeHwnd();
+
+    CRect rect;
+    m_Edit.GetWindowRect(&rect);
+    ScreenToClient(&rect);
+    m_Edit.DestroyWindow();
+
+    if (!m_Edit.Create(GetEditStyle() | (bVisible ? WS_VISIBLE : 0), rect, this, IDC_EDIT_CONTROL))
     {
+        TRACE0("未能重新创建编辑控件\n");
+        return;
+    }
+    if (m_pFontEntry)
+        m_Edit.SetFont(const_cast<CFont*>(&m_pFontEntry->font));
+
+    m_bInternalChange = true;
+    m_Edit.SetWindowText(strText);
+    m_bInternalChange = false;
+    m_Edit.SetReadOnly(bReadOnly ? TRUE : FALSE);
+
+    m_Edit.SetSel(nStart, nEnd, TRUE);
+    m_Edit.LineScroll(m_Edit.LineFromChar(nFirstChar));
+    if (bFocus)
         m_Edit.SetFocus();
+}
+
+// 逻辑行数：自动换行时 CEdit 的行数是可视行数，改为数换行
+int CMFCNoteBookView::GetEditLineCount()
+{
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (m_bWordWrap && pDoc)
+    {
+        TestableLogic::LineEndingStats stats = TestableLogic::CountLineEndings(
+            static_cast<LPCWSTR>(pDoc->m_strContent), pDoc->m_strContent.GetLength());
+        return 1 + static_cast<int>(TestableLogic::GetLineBreakCount(stats));
+    }
+    return m_Edit.GetLineCount();
+}
+
+void CMFCNoteBookView::OnSetFocus(CWnd* pOldWnd)
+{
+    CView::OnSetFocus(pOldWnd);
+
+    if (GetActiveEditor().GetSafeHwnd())
+    {
+        GetActiveEditor().SetFocus();
     }
 }
 
@@ -229,83 +408,329 @@ void CMFCNoteBookView::OnInitialUpdate()
     ApplyTheme();
 
     // 4. 加载文档内容
+    LoadFromDocument();
+}
+
+// 按文档当前的内容重新加载编辑器；文档仍在后台载入时显示只读的占位内容，
+// 载入完成后（HINT_DOCUMENT_LOADED）再调用一次
+void CMFCNoteBookView::LoadFromDocument()
+{
+    // 超大文件由自绘编辑器直接显示文档的缓冲区
     CMFCNoteBookDoc* pDoc = GetDocument();
-    if (pDoc && m_Edit.GetSafeHwnd())
+    bool bLoading = pDoc && pDoc->IsLoading();
+    m_bLargeFile = pDoc && pDoc->IsLargeFile();
+    if (bLoading && m_Edit.GetSafeHwnd())
     {
+        m_Edit.ShowWindow(SW_SHOW);
+        m_TextEditor.ShowWindow(SW_HIDE);
+
+        m_bInternalChange = true;
+        m_Edit.SetWindowText(LOADING_PLACEHOLDER_TEXT);
+        m_bInternalChange = false;
+        m_Edit.SetReadOnly(TRUE);
+
+        // 占位内容不进入撤销历史和崩溃恢复快照
+        m_strLastText.Empty();
+        m_undoJournal.Close();
+        m_undoTree.Clear();
+    }
+    else if (m_bLargeFile && m_TextEditor.GetSafeHwnd())
+    {
+        m_TextEditor.SetBuffer(&pDoc->m_textBuffer, pDoc->m_lineEnding);
+        m_TextEditor.ShowWindow(SW_SHOW);
+        m_Edit.ShowWindow(SW_HIDE);
+        m_Edit.SetWindowText(_T(""));
+        m_strLastText.Empty();
+
+        // 超大文件的编辑由自绘编辑器的片段表撤销，不写撤销日志
+        m_undoJournal.Close();
+        m_undoTree.Clear();
+    }
+    else if (pDoc && m_Edit.GetSafeHwnd())
+    {
+        m_Edit.ShowWindow(SW_SHOW);
+        m_TextEditor.ShowWindow(SW_HIDE);
+
         m_bInternalChange = true;
         m_Edit.SetWindowText(pDoc->m_strContent);
         m_bInternalChange = false;
+        m_Edit.SetReadOnly(FALSE);
 
         m_Edit.GetWindowText(m_strLastText);
-        m_UndoStack.clear();
-        m_RedoStack.clear();
+        OpenUndoJournal(pDoc->GetPathName());
+        m_undoTree.Clear();
+    }
+    m_nWrapAnchorChar = -1;
+
+    // 加载内容之前的通知不再需要处理
+    m_frameScheduler.Cancel();
+    KillTimer(ID_TIMER_FRAME);
+    KillTimer(ID_TIMER_UNDO_COMPRESS);
+
+    // 崩溃恢复快照从载入的内容重新开始；超大文件不写快照
+    if (pDoc)
+    {
+        theApp.GetRecovery().Invalidate(pDoc->GetRecoveryId());
     }
+    if (m_bLargeFile || bLoading)
+        KillTimer(ID_TIMER_AUTOSAVE);
+    else
+        SetTimer(ID_TIMER_AUTOSAVE, AUTOSAVE_INTERVAL, NULL);
 
-    // 5. 更新行号宽度
+    // 更新行号宽度
     UpdateLineNumberWidth();
 }
 
+void CMFCNoteBookView::OnUpdate(CView* pSender, LPARAM lHint, CObject* pHint)
+{
+    // 超大文件保存：解除映射前改写撤销快照，重新映射后内容不变，保留光标、滚动位置和撤销记录
+    if (lHint == HINT_LARGE_FILE_SAVING)
+    {
+        if (m_bLargeFile)
+        {
+            m_TextEditor.PrepareReload();
+        }
+        return;
+    }
+    if (lHint == HINT_LARGE_FILE_RELOADED)
+    {
+        if (m_bLargeFile)
+        {
+            m_TextEditor.ReloadBuffer();
+        }
+        return;
+    }
+
+    // 会话恢复：后台载入的内容已交给文档，替换占位内容
+    if (lHint == HINT_DOCUMENT_LOADED)
+    {
+        LoadFromDocument();
+        Invalidate();
+        return;
+    }
+
+    // 休眠：写一次快照后释放编辑控件和 m_strLastText 中的全文，撤销历史保留
+    if (lHint == HINT_DOCUMENT_HIBERNATED)
+    {
+        if (m_Edit.GetSafeHwnd())
+        {
+            m_Edit.GetSel(m_nHibernatedSelStart, m_nHibernatedSelEnd);
+            m_nHibernatedFirstLine = m_Edit.GetFirstVisibleLine();
+            Autosave();
+
+            m_bInternalChange = true;
+            m_Edit.SetWindowText(HIBERNATED_PLACEHOLDER_TEXT);
+            m_bInternalChange = false;
+            m_Edit.SetReadOnly(TRUE);
+            m_Edit.EmptyUndoBuffer();
+        }
+        m_strLastText.Empty();
+        m_nWrapAnchorChar = -1;
+        return;
+    }
+
+    // 取回全文：内容与休眠前相同，撤销历史和日志继续使用
+    if (lHint == HINT_DOCUMENT_REHYDRATED)
+    {
+        CMFCNoteBookDoc* pDoc = GetDocument();
+        if (pDoc && m_Edit.GetSafeHwnd())
+        {
+            m_bInternalChange = true;
+            m_Edit.SetWindowText(pDoc->m_strContent);
+            m_bInternalChange = false;
+            m_Edit.SetReadOnly(FALSE);
+            m_Edit.GetWindowText(m_strLastText);
+
+            m_nWrapAnchorChar = -1;
+            RestoreViewState(m_nHibernatedSelStart, m_nHibernatedSelEnd, m_nHibernatedFirstLine);
+            UpdateLineNumberWidth();
+        }
+        return;
+    }
+
+    CView::OnUpdate(pSender, lHint, pHint);
+}
+
+void CMFCNoteBookView::OnActivateView(BOOL bActivate, CView* pActivateView, CView* pDeactiveView)
+{
+    CView::OnActivateView(bActivate, pActivateView, pDeactiveView);
+
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (!pDoc)
+        return;
+
+    // 休眠的空闲时间从失去激活时算起
+    pDoc->TouchActivity();
+    if (!bActivate || pActivateView != this)
+        return;
+
+    // 切换到仍在等待载入的文档时让它先载入；休眠的文档取回全文
+    if (pDoc->IsLoading())
+    {
+        theApp.GetSessionManager().Promote(pDoc);
+    }
+    else if (pDoc->IsHibernated())
+    {
+        pDoc->Rehydrate();
+    }
+}
+
+void CMFCNoteBookView::GetViewState(int& nSelStart, int& nSelEnd, int& nFirstVisibleLine)
+{
+    nSelStart = nSelEnd = nFirstVisibleLine = 0;
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (m_bLargeFile || !m_Edit.GetSafeHwnd() || (pDoc && pDoc->IsLoading()))
+        return;
+    if (pDoc && pDoc->IsHibernated())
+    {
+        nSelStart = m_nHibernatedSelStart;
+        nSelEnd = m_nHibernatedSelEnd;
+        nFirstVisibleLine = m_nHibernatedFirstLine;
+        return;
+    }
+
+    m_Edit.GetSel(nSelStart, nSelEnd);
+    nFirstVisibleLine = m_Edit.GetFirstVisibleLine();
+}
+
+void CMFCNoteBookView::RestoreViewState(int nSelStart, int nSelEnd, int nFirstVisibleLine)
+{
+    if (m_bLargeFile || !m_Edit.GetSafeHwnd())
+        return;
+
+    int nLength = m_Edit.GetWindowTextLength();
+    m_Edit.SetSel(min(nSelStart, nLength), min(nSelEnd, nLength), TRUE);
+    m_Edit.LineScroll(nFirstVisibleLine - m_Edit.GetFirstVisibleLine());
+    RepaintLineNumbers();
+}
+
 void CMFCNoteBookView::SyncToDocument()
 {
+    // 先处理尚未刷新的编辑通知（撤销记录等）
+    FlushFrameWork();
+
+    // 超大文件的编辑直接作用于文档的缓冲区，无需同步；载入中和休眠的文档显示的是占位内容
     CMFCNoteBookDoc* pDoc = GetDocument();
-    if (pDoc && m_Edit.GetSafeHwnd())
+    if (pDoc && !m_bLargeFile && !pDoc->IsLoading() && !pDoc->IsHibernated() && m_Edit.GetSafeHwnd())
     {
         m_Edit.GetWindowText(pDoc->m_strContent);
     }
 }
 
+// ========== 编辑和滚动通知：每帧合并处理一次 ==========
+
 void CMFCNoteBookView::OnEditChange()
 {
+    // 修改标记立即设置（关闭文档时据此提示保存），其余工作留到下一帧
     CMFCNoteBookDoc* pDoc = GetDocument();
-    if (pDoc && m_Edit.GetSafeHwnd())
+    if (pDoc && !pDoc->IsModified())
     {
-        m_Edit.GetWindowText(pDoc->m_strContent);
         pDoc->SetModifiedFlag(TRUE);
     }
 
-    if (!m_bInternalChange)
+    PostFrameWork(FRAME_WORK_CONTENT);
+}
+
+void CMFCNoteBookView::OnTextEditorChange()
+{
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (pDoc && !pDoc->IsModified())
     {
-        SaveUndoState();
+        pDoc->SetModifiedFlag(TRUE);
     }
 
-    UpdateLineNumberWidth();
-
-    CRect lineNumRect;
-    GetClientRect(&lineNumRect);
-    lineNumRect.right = m_nLineNumWidth;
-    InvalidateRect(&lineNumRect, FALSE);
+    PostFrameWork(FRAME_WORK_LARGE_TEXT);
 }
 
 void CMFCNoteBookView::OnEditScroll()
 {
-    CRect lineNumRect;
-    GetClientRect(&lineNumRect);
-    lineNumRect.right = m_nLineNumWidth;
-    InvalidateRect(&lineNumRect, FALSE);
+    PostFrameWork(FRAME_WORK_SCROLL);
 }
 
-void CMFCNoteBookView::UpdateLineNumberWidth()
+void CMFCNoteBookView::PostFrameWork(unsigned work)
 {
-    if (!m_Edit.GetSafeHwnd())
+    if (m_frameScheduler.Post(work))
+    {
+        // 第一个通知：安排在下一帧刷新（不足 USER_TIMER_MINIMUM 的间隔由系统调整）
+        SetTimer(ID_TIMER_FRAME, m_frameScheduler.GetDelay(::GetTickCount64()), NULL);
+    }
+}
+
+void CMFCNoteBookView::OnTimer(UINT_PTR nIDEvent)
+{
+    if (nIDEvent == ID_TIMER_FRAME)
+    {
+        FlushFrameWork();
         return;
+    }
+    if (nIDEvent == ID_TIMER_UNDO_COMPRESS)
+    {
+        CompressUndoHistory();
+        return;
+    }
+    if (nIDEvent == ID_TIMER_AUTOSAVE)
+    {
+        Autosave();
+        return;
+    }
 
-    int lineCount = m_Edit.GetLineCount();
+    CView::OnTimer(nIDEvent);
+}
+
+void CMFCNoteBookView::FlushFrameWork()
+{
+    unsigned work = m_frameScheduler.TakePending(::GetTickCount64());
+    if (!work)
+        return;
+
+    KillTimer(ID_TIMER_FRAME);
 
-    int digits = 1;
-    int temp = lineCount;
-    while (temp >= 10)
+    bool bDigitsChanged = false;
+    if ((work & FRAME_WORK_CONTENT) && !m_bLargeFile)
+    {
+        bDigitsChanged = ProcessEditChange();
+    }
+    if ((work & FRAME_WORK_LARGE_TEXT) && m_bLargeFile)
     {
-        temp /= 10;
-        digits++;
+        // 自绘编辑器的行数直接来自缓冲区的换行索引
+        bDigitsChanged = m_lineTracker.SetLineCount(m_TextEditor.GetLineCount());
     }
-    digits = max(digits, 4);
 
-    CClientDC dc(this);
-    CFont* pOldFont = dc.SelectObject(&m_Font);
-    CSize charSize = dc.GetTextExtent(_T("0"));
-    dc.SelectObject(pOldFont);
+    if (bDigitsChanged)
+        UpdateLineNumberWidth();
+    else
+        RepaintLineNumbers();
+}
+
+// 一帧内的全部输入合并为一次：同步文档、记录撤销、推算行数变化；返回行号位数是否变化
+bool CMFCNoteBookView::ProcessEditChange()
+{
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (pDoc && m_Edit.GetSafeHwnd())
+    {
+        m_Edit.GetWindowText(pDoc->m_strContent);
+    }
+    m_nWrapAnchorChar = -1;
+
+    // 全文只取一次、比较一次：同一个替换区间既记入撤销历史，也用来推算行数变化，
+    // 不再每次按键都重新取行数、测量并移动编辑控件
+    if (!m_bInternalChange && pDoc && m_Edit.GetSafeHwnd())
+    {
+        return m_lineTracker.ApplyEdit(SaveUndoState(pDoc->m_strContent));
+    }
+    return m_lineTracker.SetLineCount(GetEditLineCount());
+}
+
+void CMFCNoteBookView::UpdateLineNumberWidth()
+{
+    if (!GetActiveEditor().GetSafeHwnd() || !m_pFontEntry)
+        return;
+
+    // 重新取得行数，同时校正按编辑增减维护的行数
+    m_lineTracker.Reset(m_bLargeFile ? m_TextEditor.GetLineCount() : GetEditLineCount());
+    int digits = static_cast<int>(m_lineTracker.GetDigits());
 
-    int newWidth = charSize.cx * digits + 20;
+    int newWidth = m_pFontEntry->metrics.digitWidth * digits + 20;
 
     if (newWidth != m_nLineNumWidth)
     {
@@ -315,6 +740,8 @@ void CMFCNoteBookView::UpdateLineNumberWidth()
         GetClientRect(&rect);
         m_Edit.MoveWindow(m_nLineNumWidth, 0,
             rect.Width() - m_nLineNumWidth, rect.Height());
+        m_TextEditor.MoveWindow(m_nLineNumWidth, 0,
+            rect.Width() - m_nLineNumWidth, rect.Height());
 
         Invalidate();
     }
@@ -331,84 +758,226 @@ HBRUSH CMFCNoteBookView::OnCtlColor(CDC* pDC, CWnd* pWnd, UINT nCtlColor)
         pDC->SetTextColor(theme.clrEditText);
         pDC->SetBkColor(theme.clrEditBg);
 
-        // 确保画刷已创建
-        if (!m_brEditBg.GetSafeHandle())
-        {
-            m_brEditBg.CreateSolidBrush(theme.clrEditBg);
-        }
+        // 画刷由所有视图共用，每个主题只创建一次
+        if (!m_pThemeResources)
+            m_pThemeResources = &theApp.GetThemeResources();
 
-        return (HBRUSH)m_brEditBg.GetSafeHandle();
+        return (HBRUSH)m_pThemeResources->brEditBg.GetSafeHandle();
     }
 
     return CView::OnCtlColor(pDC, pWnd, nCtlColor);
 }
 
 // ========== 应用主题 ==========
+// 只换用颜色和共用画刷并标记需要重绘，不同步重绘：
+// 切换主题时由应用对主窗口统一失效一次
 void CMFCNoteBookView::ApplyTheme()
 {
     const ThemeColors& theme = theApp.GetThemeColors();
+    m_pThemeResources = &theApp.GetThemeResources();
 
-    // 删除旧画刷，创建新画刷
-    if (m_brEditBg.GetSafeHandle())
+    if (m_TextEditor.GetSafeHwnd())
     {
-        m_brEditBg.DeleteObject();
+        m_TextEditor.SetColors(theme.clrEditBg, theme.clrEditText);
     }
-    m_brEditBg.CreateSolidBrush(theme.clrEditBg);
 
-    // 强制重绘编辑控件
-    if (m_Edit.GetSafeHwnd())
-    {
-        m_Edit.Invalidate(TRUE);
-        m_Edit.UpdateWindow();
-
-        Invalidate(TRUE);
-        UpdateWindow();
-    }
+    m_gutter.SetColors(theme.clrLineNumBg, theme.clrLineNumText, theme.clrLineNumBorder);
 }
 
 // ========== 撤销/重做实现 ==========
 
-void CMFCNoteBookView::SaveUndoState()
+void CMFCNoteBookView::OpenUndoJournal(LPCTSTR lpszPathName)
 {
-    if (!m_Edit.GetSafeHwnd())
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (!pDoc)
         return;
 
-    CString strCurrentText;
-    m_Edit.GetWindowText(strCurrentText);
+    // 日志中与载入的文本一致的检查点之前的编辑都可以撤销；不一致（文件在别处被修改）时从头记录
+    TestableLogic::UndoJournalCipher cipher;
+    bool bEncrypted = (pDoc->m_fileFormat == FileFormat::MyNote);
+    if (bEncrypted)
+    {
+        CMFCNoteBookDoc::MakeUndoJournalCipher(cipher);
+    }
 
-    if (strCurrentText == m_strLastText)
+    if (!m_undoJournal.Open(CMFCNoteBookDoc::GetUndoJournalPath(lpszPathName),
+        TestableLogic::FingerprintText(m_strLastText.GetString(), m_strLastText.GetLength()),
+        bEncrypted ? &cipher : nullptr))
+    {
+        TRACE(_T("无法写入撤销日志，撤销历史只保存在内存中\n"));
+    }
+}
+
+void CMFCNoteBookView::OnDocumentSaved(LPCTSTR lpszPathName)
+{
+    if (m_bLargeFile)
         return;
 
-    m_UndoStack.push_back(m_strLastText);
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    TestableLogic::TextFingerprint text = TestableLogic::FingerprintText(
+        m_strLastText.GetString(), m_strLastText.GetLength());
 
-    while (m_UndoStack.size() > MAX_UNDO)
+    std::string strJournalPath = CMFCNoteBookDoc::GetUndoJournalPath(lpszPathName);
+    if (strJournalPath == m_undoJournal.GetPath())
+    {
+        m_undoJournal.Checkpoint(text);
+    }
+    else if (pDoc && (pDoc->m_fileFormat == FileFormat::MyNote) != m_undoJournal.IsEncrypted())
+    {
+        // 另存为改变了是否加密：历史不能原样带过去，在新位置从头记录
+        OpenUndoJournal(lpszPathName);
+    }
+    else
     {
-        m_UndoStack.erase(m_UndoStack.begin());
+        // 另存为：带着历史重写到新文件对应的日志
+        m_undoJournal.Compact(text, strJournalPath);
     }
+}
 
-    m_RedoStack.clear();
+// 只记录这一帧内的编辑替换掉的区间；文本没有变化时增量为空，不记录
+TestableLogic::EditLineDelta CMFCNoteBookView::SaveUndoState(const CString& strCurrentText)
+{
+    int nStart = 0, nEnd = 0;
+    m_Edit.GetSel(nStart, nEnd);
+    TestableLogic::TextDelta delta = TestableLogic::MakeTextDelta(
+        m_strLastText.GetString(), m_strLastText.GetLength(),
+        strCurrentText.GetString(), strCurrentText.GetLength(), nEnd);
+    TestableLogic::EditLineDelta lines = TestableLogic::CountDeltaLines(delta);
+    if (!delta.IsEmpty())
+    {
+        RecordUndoDelta(std::move(delta), strCurrentText);
+        m_strLastText = strCurrentText;
+    }
+    return lines;
+}
 
-    m_strLastText = strCurrentText;
+void CMFCNoteBookView::RecordUndoDelta(TestableLogic::TextDelta&& delta, const CString& strCurrentText)
+{
+    m_undoJournal.Record(delta);
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (pDoc)
+        theApp.GetRecovery().RecordEdit(pDoc->GetRecoveryId(), delta);
+    m_undoTree.Record(std::move(delta));
+
+    // 移出最近范围的较大记录等输入停下来再压缩；每次输入都重新计时
+    if (m_undoTree.HasColdNodes())
+        SetTimer(ID_TIMER_UNDO_COMPRESS, UNDO_COMPRESS_DELAY, NULL);
+
+    if (m_undoJournal.NeedsCheckpoint() || m_undoJournal.NeedsCompaction())
+    {
+        TestableLogic::TextFingerprint text = TestableLogic::FingerprintText(
+            strCurrentText.GetString(), strCurrentText.GetLength());
+        if (m_undoJournal.NeedsCompaction())
+            m_undoJournal.Compact(text);
+        else
+            m_undoJournal.Checkpoint(text);
+    }
 }
 
-void CMFCNoteBookView::OnEditUndo()
+// 空闲时分批压缩较早的撤销记录，每批只压缩几个节点，不影响输入
+void CMFCNoteBookView::CompressUndoHistory()
 {
-    if (m_UndoStack.empty() || !m_Edit.GetSafeHwnd())
+    m_undoTree.CompressColdNodes(UNDO_COMPRESS_BATCH);
+    if (m_undoTree.HasColdNodes())
         return;
 
-    CString strCurrentText;
-    m_Edit.GetWindowText(strCurrentText);
-    m_RedoStack.push_back(strCurrentText);
+    KillTimer(ID_TIMER_UNDO_COMPRESS);
 
-    CString strPrevText = m_UndoStack.back();
-    m_UndoStack.pop_back();
+    const TestableLogic::UndoTreeMemory& memory = m_undoTree.GetMemory();
+    TRACE(_T("撤销历史：原样 %u 个（%u 字节），压缩 %u 个（%u 字节，原 %u 字节）\n"),
+        static_cast<unsigned>(memory.hotNodes), static_cast<unsigned>(memory.hotBytes),
+        static_cast<unsigned>(memory.coldNodes), static_cast<unsigned>(memory.coldBytes),
+        static_cast<unsigned>(memory.coldRawBytes));
+}
 
+// 定时写崩溃恢复快照：界面线程只交出上次以来的增量和全文的写时复制副本，编码和写盘都在后台线程
+void CMFCNoteBookView::Autosave()
+{
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (m_bLargeFile || !pDoc || !pDoc->IsModified() || pDoc->IsHibernated())
+        return;
+
+    // 尚未处理的输入先记入增量
+    FlushFrameWork();
+
+    TestableLogic::UndoJournalCipher cipher;
+    bool bEncrypted = (pDoc->m_fileFormat == FileFormat::MyNote);
+    if (bEncrypted)
+    {
+        CMFCNoteBookDoc::MakeUndoJournalCipher(cipher);
+    }
+
+    // 复制 CString 只增加引用计数，之后的编辑会另外分配缓冲区，副本不受影响
+    CString strSnapshot = m_strLastText;
+    theApp.GetRecovery().Autosave(pDoc->GetRecoveryId(), std::string(CT2A(pDoc->GetPathName(), CP_UTF8)),
+        static_cast<size_t>(strSnapshot.GetLength()),
+        [strSnapshot](std::u16string& text)
+        {
+            text.assign(reinterpret_cast<const char16_t*>(strSnapshot.GetString()), strSnapshot.GetLength());
+        },
+        bEncrypted ? &cipher : nullptr);
+}
+
+size_t CMFCNoteBookView::GetResidentBytes()
+{
+    const TestableLogic::UndoTreeMemory& memory = m_undoTree.GetMemory();
+    size_t nTextBytes = static_cast<size_t>(m_strLastText.GetLength()) * sizeof(TCHAR);
+    size_t nEditBytes = m_Edit.GetSafeHwnd() ? static_cast<size_t>(m_Edit.GetWindowTextLength()) * sizeof(TCHAR) : 0;
+    return nTextBytes + nEditBytes + memory.hotBytes + memory.coldBytes;
+}
+
+bool CMFCNoteBookView::RestoreRecoveredText(const CString& strText)
+{
+    if (m_bLargeFile || !m_Edit.GetSafeHwnd())
+        return false;
+
+    // 与用户的编辑一样经过编辑通知：文档标记为已修改，记入撤销历史
+    m_Edit.SetSel(0, -1);
+    m_Edit.ReplaceSel(strText, TRUE);
+    FlushFrameWork();
+    m_Edit.SetSel(0, 0);
+    return true;
+}
+
+// 依次应用撤销树给出的增量，不进入撤销记录；bFollowJournal 时日志跟随同一条路径
+void CMFCNoteBookView::ApplyUndoSteps(const std::vector<TestableLogic::UndoStep>& steps, bool bFollowJournal)
+{
+    if (steps.empty())
+        return;
+
+    bool bJournalInSync = bFollowJournal;
+    int nCaret = 0;
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    TestableLogic::RecoveryService& recovery = theApp.GetRecovery();
     m_bInternalChange = true;
-    m_Edit.SetWindowText(strPrevText);
-    m_strLastText = strPrevText;
+    for (const TestableLogic::UndoStep& step : steps)
+    {
+        const TestableLogic::TextDelta& delta = *step.pDelta;
+        const std::u16string& strOld = step.bForward ? delta.removed : delta.inserted;
+        const std::u16string& strNew = step.bForward ? delta.inserted : delta.removed;
+
+        int nStart = static_cast<int>(delta.pos);
+        m_Edit.SetSel(nStart, nStart + static_cast<int>(strOld.size()), TRUE);
+        m_Edit.ReplaceSel(CString(reinterpret_cast<LPCWSTR>(strNew.data()), static_cast<int>(strNew.size())), FALSE);
+        nCaret = nStart + static_cast<int>(strNew.size());
+
+        if (bJournalInSync)
+            bJournalInSync = m_undoJournal.Follow(delta, step.bForward);
+        if (pDoc)
+            recovery.RecordEdit(pDoc->GetRecoveryId(), step.bForward ? delta : TestableLogic::InvertTextDelta(delta));
+    }
     m_bInternalChange = false;
 
-    m_Edit.SetSel(-1, -1);
+    m_Edit.GetWindowText(m_strLastText);
+    m_Edit.SetSel(nCaret, nCaret);
+
+    // 日志与树对不上（例如日志压缩后丢掉了更早的编辑）：按当前文本重新打开日志
+    if (bFollowJournal && !bJournalInSync)
+    {
+        TRACE(_T("撤销日志与撤销树不一致，重新开始记录\n"));
+        if (pDoc)
+            OpenUndoJournal(pDoc->GetPathName());
+    }
 
     SyncToDocument();
 
@@ -416,70 +985,269 @@ void CMFCNoteBookView::OnEditUndo()
     Invalidate();
 }
 
+void CMFCNoteBookView::OnEditUndo()
+{
+    // 尚未记录的输入先记入撤销历史
+    FlushFrameWork();
+
+    if (m_bLargeFile)
+    {
+        m_TextEditor.Undo();
+        return;
+    }
+    if (!m_Edit.GetSafeHwnd())
+        return;
+
+    std::vector<TestableLogic::UndoStep> steps(1);
+    if (m_undoTree.Undo(steps[0]))
+    {
+        ApplyUndoSteps(steps);
+        return;
+    }
+
+    // 撤销到本次打开时的状态之前：从日志读出上次的编辑接到树根上方
+    TestableLogic::TextDelta delta;
+    if (!m_undoJournal.Undo(delta))
+        return;
+    m_undoTree.ExtendRoot(std::move(delta));
+    m_undoTree.Undo(steps[0]);
+    ApplyUndoSteps(steps, false);
+}
+
 void CMFCNoteBookView::OnEditRedo()
 {
-    if (m_RedoStack.empty() || !m_Edit.GetSafeHwnd())
+    // 尚未记录的输入先记入撤销历史
+    FlushFrameWork();
+
+    if (m_bLargeFile)
+    {
+        m_TextEditor.Redo();
+        return;
+    }
+    if (!m_Edit.GetSafeHwnd())
         return;
 
-    CString strCurrentText;
-    m_Edit.GetWindowText(strCurrentText);
-    m_UndoStack.push_back(strCurrentText);
+    std::vector<TestableLogic::UndoStep> steps(1);
+    if (m_undoTree.Redo(steps[0]))
+    {
+        ApplyUndoSteps(steps);
+        return;
+    }
 
-    CString strNextText = m_RedoStack.back();
-    m_RedoStack.pop_back();
+    // 上次关闭前撤销掉的编辑：从日志读出，作为当前状态的子节点
+    TestableLogic::TextDelta delta;
+    if (!m_undoJournal.Redo(delta))
+        return;
+    TestableLogic::UndoNodeId node = m_undoTree.Record(std::move(delta));
+    steps[0].pDelta = &m_undoTree.GetDelta(node);
+    steps[0].bForward = true;
+    ApplyUndoSteps(steps, false);
+}
 
-    m_bInternalChange = true;
-    m_Edit.SetWindowText(strNextText);
-    m_strLastText = strNextText;
-    m_bInternalChange = false;
+// 按编辑的先后在各分支的状态之间移动（撤销后又编辑过时，较早的状态可能在另一个分支上）
+void CMFCNoteBookView::OnEditUndoOlder()
+{
+    FlushFrameWork();
+
+    TestableLogic::UndoNodeId target;
+    if (m_bLargeFile || !m_undoTree.GetOlderState(target))
+    {
+        // 已在最早的状态（树根），与撤销相同
+        OnEditUndo();
+        return;
+    }
 
-    m_Edit.SetSel(-1, -1);
+    std::vector<TestableLogic::UndoStep> steps;
+    if (m_undoTree.JumpTo(target, steps))
+        ApplyUndoSteps(steps);
+}
 
-    SyncToDocument();
+void CMFCNoteBookView::OnEditUndoNewer()
+{
+    FlushFrameWork();
 
-    UpdateLineNumberWidth();
-    Invalidate();
+    TestableLogic::UndoNodeId target;
+    if (m_bLargeFile || !m_undoTree.GetNewerState(target))
+    {
+        OnEditRedo();
+        return;
+    }
+
+    std::vector<TestableLogic::UndoStep> steps;
+    if (m_undoTree.JumpTo(target, steps))
+        ApplyUndoSteps(steps);
 }
 
 void CMFCNoteBookView::OnUpdateEditUndo(CCmdUI* pCmdUI)
 {
-    pCmdUI->Enable(!m_UndoStack.empty());
+    pCmdUI->Enable(m_bLargeFile ? m_TextEditor.CanUndo() : (m_undoTree.CanUndo() || m_undoJournal.CanUndo()));
 }
 
 void CMFCNoteBookView::OnUpdateEditRedo(CCmdUI* pCmdUI)
 {
-    pCmdUI->Enable(!m_RedoStack.empty());
+    pCmdUI->Enable(m_bLargeFile ? m_TextEditor.CanRedo() : (m_undoTree.CanRedo() || m_undoJournal.CanRedo()));
+}
+
+void CMFCNoteBookView::OnUpdateEditUndoOlder(CCmdUI* pCmdUI)
+{
+    TestableLogic::UndoNodeId node;
+    pCmdUI->Enable(m_bLargeFile ? m_TextEditor.CanUndo() : (m_undoTree.GetOlderState(node) || m_undoJournal.CanUndo()));
+}
+
+void CMFCNoteBookView::OnUpdateEditUndoNewer(CCmdUI* pCmdUI)
+{
+    TestableLogic::UndoNodeId node;
+    pCmdUI->Enable(m_bLargeFile ? m_TextEditor.CanRedo() : (m_undoTree.GetNewerState(node) || m_undoJournal.CanRedo()));
 }
 
 // ========== 剪切/复制/粘贴实现 ==========
 
+// 编辑控件的剪切、复制只取选中的一段；剪切作为一次编辑直接记入撤销历史
 void CMFCNoteBookView::OnEditCut()
 {
-    if (m_Edit.GetSafeHwnd())
+    if (m_bLargeFile)
     {
-        m_Edit.Cut();
+        m_TextEditor.Cut();
+    }
+    else if (m_Edit.GetSafeHwnd() && !(m_Edit.GetStyle() & ES_READONLY))
+    {
+        OnEditCopy();
+        ReplaceEditSelection(std::u16string());
     }
 }
 
 void CMFCNoteBookView::OnEditCopy()
 {
-    if (m_Edit.GetSafeHwnd())
+    if (m_bLargeFile)
     {
-        m_Edit.Copy();
+        m_TextEditor.Copy();
+    }
+    else if (m_Edit.GetSafeHwnd())
+    {
+        int nStart = 0, nEnd = 0;
+        m_Edit.GetSel(nStart, nEnd);
+        if (nStart == nEnd)
+            return;
+
+        CString strText = GetTextRange(nStart, nEnd);
+        CTextEditorCtrl::WriteClipboardText(GetSafeHwnd(),
+            reinterpret_cast<const char16_t*>(strText.GetString()), strText.GetLength());
     }
 }
 
+// 剪贴板按块复制出来后立即关闭；内容较多时换行转换、编码和换行索引在后台线程完成，
+// 完成后作为一次编辑插入（粘贴到那时的选区）
 void CMFCNoteBookView::OnEditPaste()
 {
-    if (m_Edit.GetSafeHwnd())
+    // ReplaceSel 不受只读限制，载入中和休眠时显示的占位内容要自己挡住
+    if (m_pasteJob.IsBusy() ||
+        (!m_bLargeFile && (!m_Edit.GetSafeHwnd() || (m_Edit.GetStyle() & ES_READONLY))))
+        return;
+
+    std::u16string text;
+    if (!CTextEditorCtrl::ReadClipboardText(GetSafeHwnd(), text))
+        return;
+
+    // 编辑控件只认 CRLF；自绘编辑器按文档的换行约定
+    TestableLogic::LineEnding ending = m_bLargeFile ? m_TextEditor.GetLineBreak() : TestableLogic::LineEnding::CrLf;
+    TestableLogic::PasteTarget target = m_bLargeFile ? TestableLogic::PasteTarget::Utf8 : TestableLogic::PasteTarget::Utf16;
+    if (text.size() < PASTE_BACKGROUND_THRESHOLD)
     {
-        m_Edit.Paste();
+        TestableLogic::PreparedPaste paste;
+        TestableLogic::PreparePaste(text.data(), text.size(), ending, target, paste);
+        ApplyPaste(paste);
+        return;
     }
+
+    HWND hWnd = GetSafeHwnd();
+    m_bPasteLargeFile = m_bLargeFile;
+    m_pasteJob.Start(std::move(text), ending, target,
+        [hWnd]() { ::PostMessage(hWnd, WM_PASTE_PREPARED, 0, 0); });
+}
+
+LRESULT CMFCNoteBookView::OnPastePrepared(WPARAM /*wParam*/, LPARAM /*lParam*/)
+{
+    TestableLogic::PreparedPaste paste;
+    if (!m_pasteJob.TakeResult(paste))
+        return 0;
+
+    // 准备期间换了编辑器（如重新载入为超大文件），或文档正在载入、已休眠时放弃
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    if (m_bPasteLargeFile != m_bLargeFile || (pDoc && (pDoc->IsLoading() || pDoc->IsHibernated())))
+    {
+        TRACE(_T("粘贴的内容准备好时编辑器已改变，放弃粘贴\n"));
+        return 0;
+    }
+
+    ApplyPaste(paste);
+    return 0;
+}
+
+void CMFCNoteBookView::ApplyPaste(TestableLogic::PreparedPaste& paste)
+{
+    if (m_bLargeFile)
+    {
+        // 片段表只追加一次，撤销只多一条记录
+        m_TextEditor.InsertPrepared(paste);
+        return;
+    }
+
+    TRACE(_T("粘贴 %u 个字符（%u 个换行）\n"), static_cast<unsigned>(paste.text.size()),
+        static_cast<unsigned>(paste.lineBreaks));
+    ReplaceEditSelection(std::move(paste.text));
+}
+
+void CMFCNoteBookView::ReplaceEditSelection(std::u16string&& strInserted)
+{
+    // 之前的输入先记入撤销历史，此后 m_strLastText 和文档都与编辑控件的内容一致
+    FlushFrameWork();
+
+    int nStart = 0, nEnd = 0;
+    m_Edit.GetSel(nStart, nEnd);
+    CString strRemoved = GetTextRange(nStart, nEnd);
+    TestableLogic::TextDelta delta;
+    delta.pos = static_cast<size_t>(nStart);
+    delta.removed.assign(reinterpret_cast<const char16_t*>(strRemoved.GetString()), strRemoved.GetLength());
+    delta.inserted.swap(strInserted);
+    if (delta.IsEmpty())
+        return;
+
+    UINT nNewLength = static_cast<UINT>(m_strLastText.GetLength() - delta.removed.size() + delta.inserted.size());
+    if (m_Edit.GetLimitText() < nNewLength)
+        m_Edit.SetLimitText(0);
+
+    // 编辑通知安排的工作立即按内部修改处理：只把全文交给文档并按控件取行数
+    m_bInternalChange = true;
+    m_Edit.ReplaceSel(reinterpret_cast<LPCWSTR>(delta.inserted.c_str()), FALSE);
+    FlushFrameWork();
+    m_bInternalChange = false;
+
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    CString strCurrentText;
+    if (pDoc)
+        strCurrentText = pDoc->m_strContent;    // 共享文档的缓冲区，不复制
+    else
+        m_Edit.GetWindowText(strCurrentText);
+
+    RecordUndoDelta(std::move(delta), strCurrentText);
+    m_strLastText = strCurrentText;
+}
+
+CString CMFCNoteBookView::GetTextRange(size_t nStart, size_t nEnd)
+{
+    // 编辑控件的内容每帧同步到文档一次
+    FlushFrameWork();
+    CMFCNoteBookDoc* pDoc = GetDocument();
+    return pDoc ? pDoc->GetTextRange(nStart, nEnd) : CString();
 }
 
 void CMFCNoteBookView::OnUpdateEditCut(CCmdUI* pCmdUI)
 {
-    if (m_Edit.GetSafeHwnd())
+    if (m_bLargeFile)
+    {
+        pCmdUI->Enable(m_TextEditor.HasSelection());
+    }
+    else if (m_Edit.GetSafeHwnd())
     {
         int nStart, nEnd;
         m_Edit.GetSel(nStart, nEnd);
@@ -493,7 +1261,11 @@ void CMFCNoteBookView::OnUpdateEditCut(CCmdUI* pCmdUI)
 
 void CMFCNoteBookView::OnUpdateEditCopy(CCmdUI* pCmdUI)
 {
-    if (m_Edit.GetSafeHwnd())
+    if (m_bLargeFile)
+    {
+        pCmdUI->Enable(m_TextEditor.HasSelection());
+    }
+    else if (m_Edit.GetSafeHwnd())
     {
         int nStart, nEnd;
         m_Edit.GetSel(nStart, nEnd);
@@ -509,6 +1281,19 @@ void CMFCNoteBookView::OnUpdateEditPaste(CCmdUI* pCmdUI)
 {
     BOOL bCanPaste = FALSE;
 
+    // 上一次粘贴还在后台准备
+    if (m_pasteJob.IsBusy())
+    {
+        pCmdUI->Enable(FALSE);
+        return;
+    }
+
+    if (m_bLargeFile)
+    {
+        pCmdUI->Enable(::IsClipboardFormatAvailable(CF_UNICODETEXT));
+        return;
+    }
+
     if (m_Edit.GetSafeHwnd() && ::IsClipboardFormatAvailable(CF_TEXT))
     {
         bCanPaste = TRUE;
@@ -526,6 +1311,7 @@ void CMFCNoteBookView::OnUpdateEditPaste(CCmdUI* pCmdUI)
 
 void CMFCNoteBookView::OnEditFind()
 {
+    // 超大文件只支持普通查找（对话框转给自绘编辑器），不支持正则和替换
     if (!m_pFindReplaceDlg)
     {
         m_pFindReplaceDlg = new CFindReplaceDlg(this);
@@ -538,9 +1324,7 @@ void CMFCNoteBookView::OnEditFind()
         m_Edit.GetSel(nStart, nEnd);
         if (nStart != nEnd)
         {
-            CString strText;
-            m_Edit.GetWindowText(strText);
-            m_pFindReplaceDlg->m_Options.strFind = strText.Mid(nStart, nEnd - nStart);
+            m_pFindReplaceDlg->m_Options.strFind = GetTextRange(nStart, nEnd);
             m_pFindReplaceDlg->m_editFind.SetWindowText(m_pFindReplaceDlg->m_Options.strFind);
         }
     }
@@ -558,29 +1342,21 @@ void CMFCNoteBookView::OnEditReplace()
 
 void CMFCNoteBookView::CreateEditFont()
 {
-    // 删除旧字体
-    if (m_EditFont.GetSafeHandle())
-    {
-        m_EditFont.DeleteObject();
-    }
-    if (m_LineNumFont.GetSafeHandle())
-    {
-        m_LineNumFont.DeleteObject();
-    }
-    if (m_Font.GetSafeHandle())
-    {
-        m_Font.DeleteObject();
-    }
+    // 字体和度量由应用的字体缓存共享，缩放时只切换缓存项
+    m_pFontEntry = &theApp.GetFont(EDITOR_FONT_FACE, m_nFontSize);
+    CFont* pFont = const_cast<CFont*>(&m_pFontEntry->font);
+    const TestableLogic::FontMetrics& metrics = m_pFontEntry->metrics;
 
-    // 创建新字体
-    m_EditFont.CreatePointFont(m_nFontSize * 10, _T("Consolas"));
-    m_LineNumFont.CreatePointFont(m_nFontSize * 10, _T("Consolas"));
-    m_Font.CreatePointFont(m_nFontSize * 10, _T("Consolas"));
+    m_gutter.SetFont(pFont, metrics.digitWidth, metrics.lineHeight);
 
     // 应用到编辑控件
     if (m_Edit.GetSafeHwnd())
     {
-        m_Edit.SetFont(&m_EditFont);
+        m_Edit.SetFont(pFont);
+    }
+    if (m_TextEditor.GetSafeHwnd())
+    {
+        m_TextEditor.SetFontMetrics(pFont, metrics.aveCharWidth, metrics.lineHeight);
     }
 }
 
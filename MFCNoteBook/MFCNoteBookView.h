@@ -6,8 +6,20 @@
 #include <vector>
 #include <memory>
 
+#include "TextEditorCtrl.h"
+#include "PastePipeline.h"
+#include "GutterRenderer.h"
+#include "FontCache.h"
+#include "FrameScheduler.h"
+#include "UndoJournal.h"
+#include "UndoTree.h"
+
+// 后台线程准备好大段粘贴的内容后通知视图
+#define WM_PASTE_PREPARED (WM_APP + 2)
+
 class CMFCNoteBookDoc;
 class CFindReplaceDlg;
+struct ThemeResources;
 
 class CMFCNoteBookView : public CView
 {
@@ -20,25 +32,42 @@ public:
 
 protected:
     CEdit m_Edit;
-    CFont m_Font;
+    CTextEditorCtrl m_TextEditor;   // 超大文件使用的自绘编辑器（与 m_Edit 二选一显示）
+    bool m_bLargeFile;
     int m_nLineNumWidth;
+    CGutterRenderer m_gutter;       // 行号区离屏缓存
+    TestableLogic::FrameScheduler m_frameScheduler;    // 合并编辑和滚动通知，每帧处理一次
+    TestableLogic::GutterLineTracker m_lineTracker;    // 按编辑增减维护的行数，位数变化时才调整行号区宽度
+
+    // ========== 自动换行 ==========
+    bool m_bWordWrap;
+    std::vector<uint64_t> m_rowLabels;  // 每个可视行显示的行号（续行为 0）
+    int m_nWrapAnchorChar;              // 上次数到的可视行起始字符，-1 表示需要从头数
+    uint64_t m_nWrapAnchorLine;         // 该字符所在的逻辑行（从 1 开始）
 
     // ========== 撤销/重做相关 ==========
-    std::vector<CString> m_UndoStack;
-    std::vector<CString> m_RedoStack;
+    TestableLogic::UndoTree m_undoTree;         // 本次打开以来的全部分支，撤销后再编辑不丢弃原来的编辑
+    TestableLogic::UndoJournal m_undoJournal;   // 当前状态所在路径上的增量，写入文档对应的日志，重新打开后仍可撤销
     CString m_strLastText;
     bool m_bInternalChange;
-    static const size_t MAX_UNDO = 50;
+
+    // ========== 大段粘贴 ==========
+    TestableLogic::PasteJob m_pasteJob;     // 在后台线程转换换行、编码并建立换行索引
+    bool m_bPasteLargeFile;                 // 准备的内容是给自绘编辑器的（UTF-8）
+
+    // ========== 休眠 ==========
+    int m_nHibernatedSelStart;          // 休眠前的选区和首个可见行，取回全文后恢复
+    int m_nHibernatedSelEnd;
+    int m_nHibernatedFirstLine;
 
     // ========== 查找替换对话框 ==========
     CFindReplaceDlg* m_pFindReplaceDlg;
 
     // ========== 主题相关 ==========
-    CBrush m_brEditBg;  // 编辑区背景画刷
+    const ThemeResources* m_pThemeResources;    // 编辑区背景画刷等，由应用的主题资源缓存持有
 
     // ========== 字体相关 ==========
-    CFont m_EditFont;           // 编辑区字体
-    CFont m_LineNumFont;        // 行号区字体
+    const TestableLogic::FontCache<CFont>::Entry* m_pFontEntry;    // 编辑区和行号区共用，由应用的字体缓存持有
     int m_nFontSize;            // 当前字号（单位：点）
     static const int FONT_SIZE_MIN = 8;
     static const int FONT_SIZE_MAX = 72;
@@ -46,13 +75,20 @@ protected:
 
 public:
     CEdit& GetEditCtrl() { return m_Edit; }
+    CTextEditorCtrl& GetTextEditor() { return m_TextEditor; }
+    bool IsLargeFileMode() const { return m_bLargeFile; }
+    const TestableLogic::FrameScheduler& GetFrameScheduler() const { return m_frameScheduler; }
+    const TestableLogic::UndoTreeMemory& GetUndoMemory() const { return m_undoTree.GetMemory(); }
     void UpdateLineNumberWidth();
     void ApplyTheme();
+    void SetWordWrap(bool bWrap);
 
 public:
     virtual void OnDraw(CDC* pDC);
     virtual BOOL PreCreateWindow(CREATESTRUCT& cs);
     virtual void OnInitialUpdate();
+    virtual void OnUpdate(CView* pSender, LPARAM lHint, CObject* pHint);
+    virtual void OnActivateView(BOOL bActivate, CView* pActivateView, CView* pDeactiveView);
 
 protected:
     virtual BOOL OnPreparePrinting(CPrintInfo* pInfo);
@@ -72,6 +108,8 @@ protected:
     afx_msg void OnSetFocus(CWnd* pOldWnd);
     afx_msg void OnEditChange();
     afx_msg void OnEditScroll();
+    afx_msg void OnTextEditorChange();
+    afx_msg void OnTimer(UINT_PTR nIDEvent);
     afx_msg HBRUSH OnCtlColor(CDC* pDC, CWnd* pWnd, UINT nCtlColor);
 
     // 撤销/重做消息处理
@@ -79,6 +117,10 @@ protected:
     afx_msg void OnEditRedo();
     afx_msg void OnUpdateEditUndo(CCmdUI* pCmdUI);
     afx_msg void OnUpdateEditRedo(CCmdUI* pCmdUI);
+    afx_msg void OnEditUndoOlder();
+    afx_msg void OnEditUndoNewer();
+    afx_msg void OnUpdateEditUndoOlder(CCmdUI* pCmdUI);
+    afx_msg void OnUpdateEditUndoNewer(CCmdUI* pCmdUI);
 
     // 剪切/复制/粘贴消息处理
     afx_msg void OnEditCut();
@@ -87,6 +129,7 @@ protected:
     afx_msg void OnUpdateEditCut(CCmdUI* pCmdUI);
     afx_msg void OnUpdateEditCopy(CCmdUI* pCmdUI);
     afx_msg void OnUpdateEditPaste(CCmdUI* pCmdUI);
+    afx_msg LRESULT OnPastePrepared(WPARAM wParam, LPARAM lParam);
 
     // 查找替换消息处理
     afx_msg void OnEditFind();
@@ -102,10 +145,44 @@ protected:
 
 public:
     void SyncToDocument();
+    // 文档保存成功后由文档调用：撤销日志记下保存时的状态
+    void OnDocumentSaved(LPCTSTR lpszPathName);
+    // 启动时恢复快照：用 strText 替换全文（可以撤销），超大文件模式下返回 false
+    bool RestoreRecoveredText(const CString& strText);
+    // 会话记录和恢复的选区与首个可见行（超大文件和尚未载入的文档不记录）
+    void GetViewState(int& nSelStart, int& nSelEnd, int& nFirstVisibleLine);
+    void RestoreViewState(int nSelStart, int nSelEnd, int nFirstVisibleLine);
+    // 只复制 [nStart, nEnd) 这一段，偏移与当前编辑器的选区一致（超大文件为字节偏移）；
+    // 尚未处理的输入先同步到文档
+    CString GetTextRange(size_t nStart, size_t nEnd);
+    // 视图持有的全文副本（编辑控件、m_strLastText）和撤销历史占用的字节数
+    size_t GetResidentBytes();
 
 private:
-    void SaveUndoState();
+    void LoadFromDocument();
+    // 把编辑后的全文与上一次的比较一次，记入撤销历史，返回这次编辑增减的行数
+    TestableLogic::EditLineDelta SaveUndoState(const CString& strCurrentText);
+    // 把一次编辑记入撤销日志、崩溃恢复和撤销树；strCurrentText 为编辑后的全文
+    void RecordUndoDelta(TestableLogic::TextDelta&& delta, const CString& strCurrentText);
+    // 用准备好的内容替换选区，作为一次编辑记入撤销历史
+    void ApplyPaste(TestableLogic::PreparedPaste& paste);
+    // 编辑控件的选区替换为 strInserted：增量由选区直接得出，不再比较编辑前后的全文
+    void ReplaceEditSelection(std::u16string&& strInserted);
+    void OpenUndoJournal(LPCTSTR lpszPathName);
+    void CompressUndoHistory();
+    void Autosave();
+    void ApplyUndoSteps(const std::vector<TestableLogic::UndoStep>& steps, bool bFollowJournal = true);
     void CreateEditFont();
+    void PaintLineNumbers(CDC* pDC, bool bWholeGutter);
+    void RepaintLineNumbers();
+    void PostFrameWork(unsigned work);
+    void FlushFrameWork();
+    bool ProcessEditChange();
+    CWnd& GetActiveEditor();
+    DWORD GetEditStyle() const;
+    void RecreateEditControl();
+    int GetEditLineCount();
+    void GetEditRowLabels(size_t rows, std::vector<uint64_t>& labels);
 };
 
 #ifndef _DEBUG
@@ -7,22 +7,32 @@
 #include "MFCNoteBook.h"
 
 #include "MainFrm.h"
+#include "SessionManager.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+// 每隔这么久（毫秒）检查一次空闲的文档并更新内存统计
+#define ID_TIMER_HIBERNATE 1
+#define HIBERNATE_CHECK_INTERVAL (10 * 1000)
+
 // CMainFrame
 
 IMPLEMENT_DYNAMIC(CMainFrame, CMDIFrameWnd)
 
 BEGIN_MESSAGE_MAP(CMainFrame, CMDIFrameWnd)
 	ON_WM_CREATE()
+	ON_WM_CLOSE()
+	ON_WM_TIMER()
+	ON_UPDATE_COMMAND_UI(ID_INDICATOR_MEMORY, &CMainFrame::OnUpdateIndicatorMemory)
+	ON_MESSAGE(WM_SESSION_DOC_LOADED, &CMainFrame::OnSessionDocLoaded)
 END_MESSAGE_MAP()
 
 static UINT indicators[] =
 {
 	ID_SEPARATOR,           // 状态行指示器
+	ID_INDICATOR_MEMORY,    // 常驻/休眠的文档内存
 	ID_INDICATOR_CAPS,
 	ID_INDICATOR_NUM,
 	ID_INDICATOR_SCRL,
@@ -63,7 +73,39 @@ int CMainFrame::OnCreate(LPCREATESTRUCT lpCreateStruct)
 	EnableDocking(CBRS_ALIGN_ANY);
 	DockControlBar(&m_wndToolBar);
 
+	SetTimer(ID_TIMER_HIBERNATE, HIBERNATE_CHECK_INTERVAL, NULL);
+
+	return 0;
+}
+
+void CMainFrame::OnClose()
+{
+	// 文档关闭之前记下会话，下次启动时按同样的窗口次序和位置恢复
+	theApp.GetSessionManager().Save(this);
+
+	CMDIFrameWnd::OnClose();
+}
+
+void CMainFrame::OnTimer(UINT_PTR nIDEvent)
+{
+	if (nIDEvent == ID_TIMER_HIBERNATE)
+	{
+		theApp.GetHibernation().Check(this);
+		return;
+	}
+
+	CMDIFrameWnd::OnTimer(nIDEvent);
+}
 
+void CMainFrame::OnUpdateIndicatorMemory(CCmdUI* pCmdUI)
+{
+	pCmdUI->Enable();
+	pCmdUI->SetText(theApp.GetHibernation().GetStatusText());
+}
+
+LRESULT CMainFrame::OnSessionDocLoaded(WPARAM wParam, LPARAM lParam)
+{
+	theApp.GetSessionManager().OnDocumentsLoaded();
 	return 0;
 }
 
@@ -35,6 +35,10 @@ protected:  // 控件条嵌入成员
 // 生成的消息映射函数
 protected:
 	afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
+	afx_msg void OnClose();
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
+	afx_msg void OnUpdateIndicatorMemory(CCmdUI* pCmdUI);
+	afx_msg LRESULT OnSessionDocLoaded(WPARAM wParam, LPARAM lParam);
 	DECLARE_MESSAGE_MAP()
 
 };
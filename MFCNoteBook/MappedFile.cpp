@@ -0,0 +1,160 @@
+﻿// MappedFile.cpp - 只读内存映射文件实现
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        m_pData = other.m_pData;
+        m_nSize = other.m_nSize;
+        m_bOpen = other.m_bOpen;
+#ifdef _WIN32
+        m_hFile = other.m_hFile;
+        m_hMapping = other.m_hMapping;
+        other.m_hFile = nullptr;
+        other.m_hMapping = nullptr;
+#else
+        m_fd = other.m_fd;
+        other.m_fd = -1;
+#endif
+        other.m_pData = nullptr;
+        other.m_nSize = 0;
+        other.m_bOpen = false;
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& utf8Path)
+{
+    Close();
+
+    int nWideLen = MultiByteToWideChar(CP_UTF8, 0, utf8Path.c_str(), -1, NULL, 0);
+    if (nWideLen <= 0)
+        return false;
+    std::wstring widePath(nWideLen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, utf8Path.c_str(), -1, &widePath[0], nWideLen);
+
+    HANDLE hFile = CreateFileW(widePath.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(hFile, &size))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    m_hFile = hFile;
+    m_bOpen = true;
+
+    // 空文件无法创建映射，直接视为打开成功
+    if (size.QuadPart == 0)
+        return true;
+
+    HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL)
+    {
+        Close();
+        return false;
+    }
+    m_hMapping = hMapping;
+
+    void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (pView == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<const uint8_t*>(pView);
+    m_nSize = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping)
+        CloseHandle(m_hMapping);
+    if (m_hFile)
+        CloseHandle(m_hFile);
+
+    m_pData = nullptr;
+    m_nSize = 0;
+    m_hMapping = nullptr;
+    m_hFile = nullptr;
+    m_bOpen = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& utf8Path)
+{
+    Close();
+
+    int fd = ::open(utf8Path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st = {};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_bOpen = true;
+
+    if (st.st_size == 0)
+        return true;
+
+    void* pView = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (pView == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<const uint8_t*>(pView);
+    m_nSize = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData)
+        ::munmap(const_cast<uint8_t*>(m_pData), m_nSize);
+    if (m_fd >= 0)
+        ::close(m_fd);
+
+    m_pData = nullptr;
+    m_nSize = 0;
+    m_fd = -1;
+    m_bOpen = false;
+}
+
+#endif
@@ -0,0 +1,42 @@
+﻿// MappedFile.h - 只读内存映射文件（跨平台，不依赖MFC）
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    // 禁止拷贝
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 允许移动
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // 以只读方式映射整个文件（路径为 UTF-8）
+    // 空文件同样返回 true，此时 Data() 为 nullptr
+    bool Open(const std::string& utf8Path);
+    void Close();
+
+    bool IsOpen() const { return m_bOpen; }
+    const uint8_t* Data() const { return m_pData; }
+    size_t Size() const { return m_nSize; }
+
+private:
+    const uint8_t* m_pData = nullptr;
+    size_t m_nSize = 0;
+    bool m_bOpen = false;
+
+#ifdef _WIN32
+    void* m_hFile = nullptr;
+    void* m_hMapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
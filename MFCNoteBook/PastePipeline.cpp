@@ -0,0 +1,172 @@
+﻿// PastePipeline.cpp - 大段文本粘贴的实现
+#include "PastePipeline.h"
+#include "TextCodec.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        inline bool IsHighSurrogate(char16_t ch)
+        {
+            return (ch & 0xFC00) == 0xD800;
+        }
+
+        bool IsCancelled(const std::atomic<bool>* pCancel)
+        {
+            return pCancel && pCancel->load(std::memory_order_relaxed);
+        }
+
+        bool PrepareUtf16(const char16_t* src, size_t len, LineEnding ending,
+            PreparedPaste& out, const std::atomic<bool>* pCancel)
+        {
+            LineEndingStats stats = CountLineEndings(src, len);
+            out.lineBreaks = GetLineBreakCount(stats);
+            out.text.resize(GetConvertedLength(stats, len, ending));
+
+            // 按输出分块：ConvertLineEndings 不会拆开 CRLF
+            size_t consumed = 0;
+            size_t written = 0;
+            while (consumed < len)
+            {
+                if (IsCancelled(pCancel))
+                    return false;
+                size_t capacity = (std::min)(out.text.size() - written, static_cast<size_t>(PASTE_CHUNK_UNITS));
+                LineEndingConvertResult result = ConvertLineEndings(src + consumed, len - consumed, ending,
+                    &out.text[written], capacity);
+                consumed += result.consumed;
+                written += result.outputLength;
+            }
+            return true;
+        }
+
+        bool PrepareUtf8(const char16_t* src, size_t len, LineEnding ending,
+            PreparedPaste& out, const std::atomic<bool>* pCancel)
+        {
+            // 每块先转换换行再编码；块末尾的高代理项留到下一块，与低代理项一起编码
+            std::u16string chunk(PASTE_CHUNK_UNITS + 1, u'\0');
+            size_t carry = 0;
+            size_t consumed = 0;
+            out.utf8.reserve(len);
+            while (consumed < len)
+            {
+                if (IsCancelled(pCancel))
+                    return false;
+                LineEndingConvertResult result = ConvertLineEndings(src + consumed, len - consumed, ending,
+                    &chunk[carry], PASTE_CHUNK_UNITS);
+                consumed += result.consumed;
+                size_t units = carry + result.outputLength;
+                carry = 0;
+                if (consumed < len && units > 0 && IsHighSurrogate(chunk[units - 1]))
+                {
+                    carry = 1;
+                    units--;
+                }
+
+                size_t base = out.utf8.size();
+                out.utf8.resize(base + Utf16ToUtf8MaxLength(units));
+                Utf16EncodeResult encoded = Utf16ToUtf8(chunk.data(), units, &out.utf8[base], out.utf8.size() - base);
+                out.utf8.resize(base + encoded.outputLength);
+                out.index.Extend(out.utf8.data(), out.utf8.size());
+
+                if (carry)
+                    chunk[0] = chunk[units];
+            }
+            out.lineBreaks = out.index.GetTotal();
+            return true;
+        }
+    }
+
+    size_t ReadTerminatedText(const char16_t* src, size_t capacity, std::u16string& out)
+    {
+        out.clear();
+        size_t pos = 0;
+        while (src && pos < capacity)
+        {
+            size_t n = (std::min)(capacity - pos, static_cast<size_t>(PASTE_CHUNK_UNITS));
+            const char16_t* nul = std::char_traits<char16_t>::find(src + pos, n, u'\0');
+            size_t take = nul ? static_cast<size_t>(nul - (src + pos)) : n;
+            out.append(src + pos, take);
+            pos += take;
+            if (nul)
+                break;
+        }
+        return out.size();
+    }
+
+    bool PreparePaste(const char16_t* src, size_t len, LineEnding ending, PasteTarget target,
+        PreparedPaste& out, const std::atomic<bool>* pCancel)
+    {
+        out = PreparedPaste();
+        if (!src || len == 0)
+            return true;
+        if (target == PasteTarget::Utf8)
+            return PrepareUtf8(src, len, ending, out, pCancel);
+        return PrepareUtf16(src, len, ending, out, pCancel);
+    }
+
+    // ============ PasteJob ============
+
+    PasteJob::PasteJob()
+        : m_bCancel(false)
+        , m_bDone(false)
+    {
+    }
+
+    PasteJob::~PasteJob()
+    {
+        Cancel();
+    }
+
+    bool PasteJob::Start(std::u16string&& text, LineEnding ending, PasteTarget target, DoneCallback onDone)
+    {
+        if (IsBusy())
+            return false;
+
+        m_bCancel = false;
+        m_bDone = false;
+        m_result = PreparedPaste();
+        m_thread = std::thread([this, source = std::move(text), ending, target, onDone]() mutable
+        {
+            PreparedPaste result;
+            bool bOk = PreparePaste(source.data(), source.size(), ending, target, result, &m_bCancel);
+            std::u16string().swap(source);
+            if (!bOk)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_result = std::move(result);
+                m_bDone = true;
+            }
+            if (onDone)
+                onDone();
+        });
+        return true;
+    }
+
+    bool PasteJob::TakeResult(PreparedPaste& result)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_bDone)
+                return false;
+            result = std::move(m_result);
+            m_result = PreparedPaste();
+            m_bDone = false;
+        }
+        m_thread.join();
+        return true;
+    }
+
+    void PasteJob::Cancel()
+    {
+        m_bCancel = true;
+        if (m_thread.joinable())
+            m_thread.join();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result = PreparedPaste();
+        m_bDone = false;
+    }
+}
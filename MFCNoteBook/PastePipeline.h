@@ -0,0 +1,77 @@
+﻿// PastePipeline.h - 大段文本的粘贴（不依赖MFC）
+//
+// 剪贴板中的文本按块复制出来：只在剪贴板数据的大小范围内逐块查找结尾的 NUL，不对整块做 wcslen。
+// 换行转换、UTF-8 编码和换行索引同样按块进行；数据量大时这些工作放到后台线程，
+// 完成后界面线程把结果作为一次编辑插入：片段表只 Insert 一次，撤销历史只多一条记录。
+#pragma once
+
+#include "LineEnding.h"
+#include "TextBuffer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 复制和转换时每块的 UTF-16 单元数
+#define PASTE_CHUNK_UNITS               (64 * 1024)
+// 不少于这么多 UTF-16 单元时在后台线程准备
+#define PASTE_BACKGROUND_THRESHOLD      (1024 * 1024)
+
+namespace TestableLogic
+{
+    // 从最多 capacity 个单元的缓冲区按块复制到第一个 NUL 为止（没有 NUL 时复制全部），返回复制的单元数
+    size_t ReadTerminatedText(const char16_t* src, size_t capacity, std::u16string& out);
+
+    enum class PasteTarget
+    {
+        Utf16,      // 编辑控件：换行转换后的 UTF-16
+        Utf8        // 片段表：UTF-8 加换行索引
+    };
+
+    struct PreparedPaste
+    {
+        std::u16string text;        // PasteTarget::Utf16 时的结果
+        std::string utf8;           // PasteTarget::Utf8 时的结果
+        SparseLineIndex index;      // utf8 的换行索引，偏移相对 utf8 开头
+        size_t lineBreaks;          // 插入的换行数
+
+        PreparedPaste() : lineBreaks(0) {}
+    };
+
+    // 换行统一转换为 ending，按 target 生成结果；pCancel 置位时中途放弃并返回 false
+    bool PreparePaste(const char16_t* src, size_t len, LineEnding ending, PasteTarget target,
+        PreparedPaste& out, const std::atomic<bool>* pCancel = nullptr);
+
+    // 在后台线程准备一次粘贴；同一时间只准备一份
+    class PasteJob
+    {
+    public:
+        typedef std::function<void()> DoneCallback;
+
+        PasteJob();
+        // 取消并等待后台线程结束
+        ~PasteJob();
+
+        PasteJob(const PasteJob&) = delete;
+        PasteJob& operator=(const PasteJob&) = delete;
+
+        // 接管 text 并开始准备；完成后在后台线程调用 onDone（例如通知界面线程）。正在准备时返回 false
+        bool Start(std::u16string&& text, LineEnding ending, PasteTarget target, DoneCallback onDone);
+        // 已开始、结果尚未取走
+        bool IsBusy() const { return m_thread.joinable(); }
+        // 取出结果；尚未完成时返回 false
+        bool TakeResult(PreparedPaste& result);
+        // 放弃正在准备的粘贴，等待后台线程结束
+        void Cancel();
+
+    private:
+        std::thread m_thread;
+        std::atomic<bool> m_bCancel;
+        mutable std::mutex m_mutex;
+        bool m_bDone;
+        PreparedPaste m_result;
+    };
+}
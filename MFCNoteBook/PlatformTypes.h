@@ -0,0 +1,21 @@
+﻿// PlatformTypes.h - 核心逻辑使用的 Windows 基本类型（不依赖MFC）
+//
+// Windows 下直接使用 <windows.h> 的定义；其他平台按相同宽度定义 BYTE/DWORD/UINT32/COLORREF
+// 和 RGB 等颜色宏，核心逻辑和测试不必区分平台。COLORREF 的布局同为 0x00BBGGRR。
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdint>
+
+typedef uint8_t BYTE;
+typedef uint32_t DWORD;
+typedef uint32_t UINT32;
+typedef uint32_t COLORREF;
+
+#define RGB(r, g, b)        ((COLORREF)(((BYTE)(r)) | ((COLORREF)((BYTE)(g)) << 8) | ((COLORREF)((BYTE)(b)) << 16)))
+#define GetRValue(rgb)      ((BYTE)(rgb))
+#define GetGValue(rgb)      ((BYTE)(((rgb) >> 8) & 0xFF))
+#define GetBValue(rgb)      ((BYTE)(((rgb) >> 16) & 0xFF))
+#endif
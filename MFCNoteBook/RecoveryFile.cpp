@@ -0,0 +1,226 @@
+﻿// RecoveryFile.cpp - 崩溃恢复快照文件实现
+#include "RecoveryFile.h"
+#include "FileUtil.h"
+#include "LzCodec.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        const uint32_t RECORD_MAGIC = 0x56434552;  // "RECV"
+
+        uint32_t Fnv1a(const void* pData, size_t len)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(pData);
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < len; i++)
+            {
+                h ^= p[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        bool AppendRecord(uint32_t kind, const std::vector<uint8_t>& payload, const UndoJournalCipher* pCipher,
+            std::vector<uint8_t>& out)
+        {
+            std::vector<uint8_t> encrypted;
+            const std::vector<uint8_t>* pStored = &payload;
+            if (pCipher)
+            {
+                if (!pCipher->encrypt || !pCipher->encrypt(payload, encrypted))
+                    return false;
+                pStored = &encrypted;
+            }
+
+            RecoveryRecordHeader header = {};
+            header.magic = RECORD_MAGIC;
+            header.kind = kind;
+            header.payloadLength = static_cast<uint32_t>(pStored->size());
+            header.checksum = Fnv1a(pStored->data(), pStored->size());
+
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&header);
+            out.insert(out.end(), p, p + sizeof(header));
+            out.insert(out.end(), pStored->begin(), pStored->end());
+            return true;
+        }
+
+        bool ReadBase(const std::vector<uint8_t>& payload, std::u16string& text)
+        {
+            size_t pos = 0;
+            uint64_t length = 0;
+            if (!ReadVarint(payload.data(), payload.size(), pos, length) || pos >= payload.size() ||
+                length > payload.size() * 256)
+                return false;
+            bool bPacked = payload[pos++] != 0;
+
+            const uint8_t* pBytes = payload.data() + pos;
+            size_t nBytes = payload.size() - pos;
+            std::vector<uint8_t> raw;
+            if (bPacked)
+            {
+                if (!LzDecompress(pBytes, nBytes, static_cast<size_t>(length) * 2, raw))
+                    return false;
+                pBytes = raw.data();
+                nBytes = raw.size();
+            }
+            if (nBytes != length * 2)
+                return false;
+
+            text.resize(static_cast<size_t>(length));
+            for (size_t i = 0; i < text.size(); i++)
+                text[i] = static_cast<char16_t>(pBytes[i * 2] | (pBytes[i * 2 + 1] << 8));
+            return true;
+        }
+
+        bool ReplayEdits(const std::vector<uint8_t>& payload, std::u16string& text, size_t& editCount)
+        {
+            size_t pos = 0;
+            uint64_t count = 0;
+            if (!ReadVarint(payload.data(), payload.size(), pos, count))
+                return false;
+
+            // 整条记录先全部解码，一条记录要么全部重放，要么都不重放
+            std::vector<TextDelta> edits;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                TextDelta delta;
+                size_t used = 0;
+                if (!DecodeTextDelta(payload.data() + pos, payload.size() - pos, delta, &used))
+                    return false;
+                pos += used;
+                edits.push_back(std::move(delta));
+            }
+
+            std::u16string result = text;
+            for (const TextDelta& delta : edits)
+            {
+                if (!ApplyTextDelta(result, delta))
+                    return false;
+            }
+            text.swap(result);
+            editCount += edits.size();
+            return true;
+        }
+    }
+
+    // ============ 写入 ============
+
+    void BuildRecoveryHeader(const std::string& docPath, const UndoJournalCipher* pCipher, std::vector<uint8_t>& out)
+    {
+        RecoveryFileHeader header = {};
+        memcpy(header.magic, RECOVERY_FILE_MAGIC, RECOVERY_FILE_MAGIC_SIZE);
+        header.version = RECOVERY_FILE_VERSION;
+        header.flags = pCipher ? RecoveryFile_Encrypted : RecoveryFile_None;
+        header.keyCheck = pCipher ? pCipher->keyCheck : 0;
+        header.pathLength = static_cast<uint32_t>(docPath.size());
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&header);
+        out.insert(out.end(), p, p + sizeof(header));
+        out.insert(out.end(), docPath.begin(), docPath.end());
+    }
+
+    bool AppendRecoveryBase(const char16_t* text, size_t len, const UndoJournalCipher* pCipher,
+        std::vector<uint8_t>& out)
+    {
+        std::vector<uint8_t> raw(len * 2);
+        for (size_t i = 0; i < len; i++)
+        {
+            raw[i * 2] = static_cast<uint8_t>(text[i]);
+            raw[i * 2 + 1] = static_cast<uint8_t>(text[i] >> 8);
+        }
+
+        std::vector<uint8_t> payload;
+        AppendVarint(payload, len);
+        payload.push_back(1);
+        size_t header = payload.size();
+        LzCompress(raw.data(), raw.size(), payload);
+
+        // 压缩不到原来的 3/4 就保存原样的文本
+        if ((payload.size() - header) * 4 > raw.size() * 3)
+        {
+            payload.resize(header);
+            payload[header - 1] = 0;
+            payload.insert(payload.end(), raw.begin(), raw.end());
+        }
+        return AppendRecord(RecoveryRecord_Base, payload, pCipher, out);
+    }
+
+    bool AppendRecoveryEdits(const std::vector<TextDelta>& edits, const UndoJournalCipher* pCipher,
+        std::vector<uint8_t>& out)
+    {
+        std::vector<uint8_t> payload;
+        AppendVarint(payload, edits.size());
+        for (const TextDelta& delta : edits)
+            EncodeTextDelta(delta, payload);
+        return AppendRecord(RecoveryRecord_Edits, payload, pCipher, out);
+    }
+
+    // ============ 载入 ============
+
+    bool ParseRecoveryFile(const uint8_t* data, size_t len, const UndoJournalCipher* pCipher, RecoveredDocument& doc)
+    {
+        RecoveryFileHeader header;
+        if (len < sizeof(header))
+            return false;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, RECOVERY_FILE_MAGIC, RECOVERY_FILE_MAGIC_SIZE) != 0 ||
+            header.version != RECOVERY_FILE_VERSION || header.pathLength > len - sizeof(header))
+            return false;
+
+        doc.bEncrypted = (header.flags & RecoveryFile_Encrypted) != 0;
+        if (doc.bEncrypted && (!pCipher || !pCipher->decrypt || header.keyCheck != pCipher->keyCheck))
+            return false;
+        doc.docPath.assign(reinterpret_cast<const char*>(data + sizeof(header)), header.pathLength);
+        doc.text.clear();
+        doc.editCount = 0;
+        doc.bTruncated = false;
+
+        size_t pos = sizeof(header) + header.pathLength;
+        bool bHasBase = false;
+        while (pos < len)
+        {
+            RecoveryRecordHeader record;
+            if (len - pos < sizeof(record))
+                break;
+            memcpy(&record, data + pos, sizeof(record));
+            if (record.magic != RECORD_MAGIC || record.payloadLength > len - pos - sizeof(record))
+                break;
+
+            const uint8_t* pStored = data + pos + sizeof(record);
+            if (Fnv1a(pStored, record.payloadLength) != record.checksum)
+                break;
+
+            std::vector<uint8_t> payload(pStored, pStored + record.payloadLength);
+            if (doc.bEncrypted)
+            {
+                std::vector<uint8_t> stored;
+                stored.swap(payload);
+                if (!pCipher->decrypt(stored, payload))
+                    break;
+            }
+
+            // 基准只在开头，之后都是编辑记录
+            bool bOk = bHasBase
+                ? record.kind == RecoveryRecord_Edits && ReplayEdits(payload, doc.text, doc.editCount)
+                : record.kind == RecoveryRecord_Base && ReadBase(payload, doc.text);
+            if (!bOk)
+                break;
+            bHasBase = true;
+            pos += sizeof(record) + record.payloadLength;
+        }
+
+        doc.bTruncated = (pos < len);
+        return bHasBase;
+    }
+
+    bool LoadRecoveryFile(const std::string& path, const UndoJournalCipher* pCipher, RecoveredDocument& doc)
+    {
+        std::vector<uint8_t> data;
+        if (!FileUtil::ReadAll(path, data))
+            return false;
+        return ParseRecoveryFile(data.data(), data.size(), pCipher, doc);
+    }
+}
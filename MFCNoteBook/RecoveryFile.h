@@ -0,0 +1,86 @@
+﻿// RecoveryFile.h - 崩溃恢复快照文件（不依赖MFC）
+//
+// 每个未保存的文档一个只追加的快照文件，程序异常退出后据此找回上次手动保存之后的编辑：
+//   基准记录  某一时刻的全文（UTF-16 小端，可压缩时用 LZ 压缩）；
+//   编辑记录  基准之后一次自动保存期间的全部 TextDelta，按编辑顺序排列。
+// 自动保存只追加上次以来的编辑记录，写入量与编辑量成正比；编辑量超过全文时由调用方改写一个新的基准。
+// 载入时从基准起依次重放编辑记录，遇到不完整或校验不符的尾部记录就停在那里（崩溃时正在写的那条）。
+// 加密文档的快照用与撤销日志相同的加解密函数处理每条记录的负载。
+#pragma once
+
+#include "TextDelta.h"
+#include "UndoJournal.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============ 快照文件格式常量 ============
+#define RECOVERY_FILE_MAGIC         "MNRECOV1"
+#define RECOVERY_FILE_MAGIC_SIZE    8
+#define RECOVERY_FILE_VERSION       1
+#define RECOVERY_FILE_EXT           ".recover"
+
+namespace TestableLogic
+{
+    enum RecoveryFileFlags : uint32_t
+    {
+        RecoveryFile_None = 0,
+        RecoveryFile_Encrypted = 1
+    };
+
+    enum RecoveryRecordKind : uint32_t
+    {
+        RecoveryRecord_Base = 1,
+        RecoveryRecord_Edits = 2
+    };
+
+    // ============ 磁盘布局（小端） ============
+    // [Header][原文档的 UTF-8 路径][记录...]，记录为 [RecordHeader][负载]
+    //   基准负载  变长整数的字符数、1 字节是否压缩、（压缩的）UTF-16 小端文本
+    //   编辑负载  变长整数的条数，后跟各条 EncodeTextDelta
+#pragma pack(push, 4)
+    struct RecoveryFileHeader
+    {
+        char magic[RECOVERY_FILE_MAGIC_SIZE];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t keyCheck;              // 加密时的密钥校验值
+        uint32_t pathLength;            // 原文档路径的字节数，无标题文档为 0
+        uint32_t reserved;
+    };
+
+    struct RecoveryRecordHeader
+    {
+        uint32_t magic;
+        uint32_t kind;
+        uint32_t payloadLength;
+        uint32_t checksum;              // 对（加密后的）负载的 FNV-1a
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(RecoveryFileHeader) == 32, "RecoveryFileHeader layout changed");
+    static_assert(sizeof(RecoveryRecordHeader) == 16, "RecoveryRecordHeader layout changed");
+
+    struct RecoveredDocument
+    {
+        std::string docPath;        // 原文档的 UTF-8 路径，无标题文档为空
+        bool bEncrypted;
+        std::u16string text;        // 基准加上能完整读出的编辑之后的文本
+        size_t editCount;           // 重放的编辑条数
+        bool bTruncated;            // 尾部有不完整或损坏的记录被忽略
+    };
+
+    // 文件头（含原文档路径），追加到 out；pCipher 非空时文件是加密的
+    void BuildRecoveryHeader(const std::string& docPath, const UndoJournalCipher* pCipher, std::vector<uint8_t>& out);
+    // 基准记录与编辑记录，追加到 out；加密失败时返回 false
+    bool AppendRecoveryBase(const char16_t* text, size_t len, const UndoJournalCipher* pCipher,
+        std::vector<uint8_t>& out);
+    bool AppendRecoveryEdits(const std::vector<TextDelta>& edits, const UndoJournalCipher* pCipher,
+        std::vector<uint8_t>& out);
+
+    // 从 [data, data + len) 或文件载入；文件头、基准无效或无法解密（pCipher 为空、密钥不符）时返回 false
+    bool ParseRecoveryFile(const uint8_t* data, size_t len, const UndoJournalCipher* pCipher, RecoveredDocument& doc);
+    bool LoadRecoveryFile(const std::string& path, const UndoJournalCipher* pCipher, RecoveredDocument& doc);
+}
@@ -0,0 +1,247 @@
+﻿// RecoveryService.cpp - 后台自动保存实现
+#include "RecoveryService.h"
+#include "FileUtil.h"
+
+#include <cstdio>
+#include <utility>
+
+namespace TestableLogic
+{
+    RecoveryService::RecoveryService()
+        : m_bBusy(false)
+        , m_bStopping(false)
+        , m_stats()
+    {
+    }
+
+    RecoveryService::~RecoveryService()
+    {
+        Stop();
+    }
+
+    void RecoveryService::Start(const std::string& dir, const std::string& sessionId)
+    {
+        Stop();
+        m_dir = dir;
+        m_sessionId = sessionId;
+        m_bStopping = false;
+        m_worker = std::thread(&RecoveryService::WorkerLoop, this);
+    }
+
+    void RecoveryService::Stop()
+    {
+        if (!m_worker.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStopping = true;
+        }
+        m_wake.notify_one();
+        m_worker.join();
+        m_docs.clear();
+    }
+
+    std::string RecoveryService::GetFilePath(uint32_t docId) const
+    {
+        char szName[32];
+        snprintf(szName, sizeof(szName), "-%u" RECOVERY_FILE_EXT, docId);
+#ifdef _WIN32
+        const char* pSeparator = "\\";
+#else
+        const char* pSeparator = "/";
+#endif
+        return m_dir + pSeparator + m_sessionId + szName;
+    }
+
+    // ============ 界面线程调用 ============
+
+    void RecoveryService::RecordEdit(uint32_t docId, const TextDelta& delta)
+    {
+        if (!IsRunning() || delta.IsEmpty())
+            return;
+
+        // 还没有基准（或要改写基准）时，下次自动保存写全文，不必记下增量
+        DocState& state = m_docs[docId];
+        if (state.bHasBase && !state.bInvalid)
+            state.pending.push_back(delta);
+    }
+
+    void RecoveryService::Invalidate(uint32_t docId)
+    {
+        if (!IsRunning())
+            return;
+        DocState& state = m_docs[docId];
+        state.pending.clear();
+        state.bInvalid = true;
+    }
+
+    void RecoveryService::Autosave(uint32_t docId, const std::string& docPath, size_t textLength,
+        RecoveryTextSource source, const UndoJournalCipher* pCipher)
+    {
+        if (!IsRunning())
+            return;
+
+        DocState& state = m_docs[docId];
+        bool bFailed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            bFailed = m_failed.erase(docId) != 0;
+        }
+
+        // 与全文比较的是要写入的文本量，不计增量在内存中的固定开销
+        size_t pendingBytes = 0;
+        for (const TextDelta& delta : state.pending)
+            pendingBytes += (delta.removed.size() + delta.inserted.size()) * sizeof(char16_t);
+
+        bool bEncrypted = (pCipher != nullptr);
+        bool bRebase = !state.bHasBase || state.bInvalid || bFailed || docPath != state.docPath ||
+            bEncrypted != (state.cipher != nullptr) ||
+            (bEncrypted && pCipher->keyCheck != state.cipher->keyCheck) ||
+            state.sinceBaseBytes + pendingBytes > textLength * sizeof(char16_t);
+
+        Job job;
+        job.docId = docId;
+        if (bRebase)
+        {
+            state.docPath = docPath;
+            state.cipher = bEncrypted ? std::make_shared<UndoJournalCipher>(*pCipher) : nullptr;
+            state.bHasBase = true;
+            state.bInvalid = false;
+            state.sinceBaseBytes = 0;
+            state.pending.clear();
+
+            job.kind = Job_Base;
+            job.docPath = docPath;
+            job.source = std::move(source);
+        }
+        else
+        {
+            if (state.pending.empty())
+                return;
+            state.sinceBaseBytes += pendingBytes;
+
+            job.kind = Job_Append;
+            job.edits.swap(state.pending);
+        }
+        job.cipher = state.cipher;
+        Submit(std::move(job));
+    }
+
+    void RecoveryService::Discard(uint32_t docId)
+    {
+        if (!IsRunning())
+            return;
+
+        std::map<uint32_t, DocState>::iterator it = m_docs.find(docId);
+        if (it == m_docs.end())
+            return;
+        bool bHasFile = it->second.bHasBase;
+        m_docs.erase(it);
+        if (!bHasFile)
+            return;
+
+        Job job;
+        job.kind = Job_Remove;
+        job.docId = docId;
+        Submit(std::move(job));
+    }
+
+    void RecoveryService::Flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && !m_bBusy; });
+    }
+
+    RecoveryStats RecoveryService::GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void RecoveryService::Submit(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(job));
+        }
+        m_wake.notify_one();
+    }
+
+    // ============ 后台线程 ============
+
+    void RecoveryService::WorkerLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_wake.wait(lock, [this] { return m_bStopping || !m_queue.empty(); });
+            if (m_queue.empty())
+                break;
+
+            Job job = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_bBusy = true;
+            lock.unlock();
+
+            bool bOk = RunJob(job);
+            JobKind kind = job.kind;
+            uint32_t docId = job.docId;
+
+            // 释放文本副本等也在锁外进行
+            job = Job();
+            lock.lock();
+            if (!bOk)
+            {
+                m_stats.failureCount++;
+                if (kind != Job_Remove)
+                    m_failed.insert(docId);
+            }
+            m_bBusy = false;
+            if (m_queue.empty())
+                m_idle.notify_all();
+        }
+        m_idle.notify_all();
+    }
+
+    bool RecoveryService::RunJob(Job& job)
+    {
+        std::string path = GetFilePath(job.docId);
+        if (job.kind == Job_Remove)
+            return FileUtil::Remove(path);
+
+        std::vector<uint8_t> data;
+        if (job.kind == Job_Base)
+        {
+            std::u16string text;
+            if (job.source)
+                job.source(text);
+            BuildRecoveryHeader(job.docPath, job.cipher.get(), data);
+            if (!AppendRecoveryBase(text.data(), text.size(), job.cipher.get(), data) ||
+                !FileUtil::WriteAllAtomic(path, data.data(), data.size()))
+                return false;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.baseCount++;
+            m_stats.bytesWritten += data.size();
+            return true;
+        }
+
+        // 一次写入整条记录，崩溃时最多留下一条不完整的尾部记录（载入时忽略）
+        if (!AppendRecoveryEdits(job.edits, job.cipher.get(), data))
+            return false;
+        FILE* fp = FileUtil::Open(path, "ab");
+        if (!fp)
+            return false;
+        bool bOk = fwrite(data.data(), 1, data.size(), fp) == data.size() && fflush(fp) == 0;
+        fclose(fp);
+        if (!bOk)
+            return false;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.appendCount++;
+        m_stats.editCount += job.edits.size();
+        m_stats.bytesWritten += data.size();
+        return true;
+    }
+}
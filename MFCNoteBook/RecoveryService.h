@@ -0,0 +1,125 @@
+﻿// RecoveryService.h - 后台自动保存崩溃恢复快照（不依赖MFC）
+//
+// 界面线程只做不涉及磁盘的轻量工作：每次编辑把增量记到文档的待写列表（与编辑量成正比），
+// 定时自动保存时把待写的增量整体移交给后台线程；需要全文时只交出一个取文本的函数，
+// 由调用方捕获写时复制的文本副本（如 CString），复制和编码都在后台线程进行。
+// 后台线程按提交的顺序执行：改写基准（先写临时文件再替换）、追加编辑记录（一次写入整条）、删除快照。
+// 界面线程从不等待磁盘，只有 Flush 和 Stop 会等后台线程把队列写完。
+//
+// 快照文件名为 <会话>-<文档编号>.recover，会话标识由调用方提供，用来区分同时运行的多个实例。
+#pragma once
+
+#include "RecoveryFile.h"
+#include "TextDelta.h"
+#include "UndoJournal.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TestableLogic
+{
+    // 在后台线程中调用，填入要写作基准的全文
+    typedef std::function<void(std::u16string&)> RecoveryTextSource;
+
+    struct RecoveryStats
+    {
+        uint64_t baseCount;         // 写入的基准记录数
+        uint64_t appendCount;       // 追加的编辑记录数
+        uint64_t editCount;         // 追加的增量条数
+        uint64_t bytesWritten;
+        uint64_t failureCount;
+    };
+
+    class RecoveryService
+    {
+    public:
+        RecoveryService();
+        ~RecoveryService();
+
+        RecoveryService(const RecoveryService&) = delete;
+        RecoveryService& operator=(const RecoveryService&) = delete;
+
+        // 在 dir（UTF-8，已存在）中为会话 sessionId 写快照，启动后台线程
+        void Start(const std::string& dir, const std::string& sessionId);
+        // 写完队列中的全部工作后结束后台线程
+        void Stop();
+        bool IsRunning() const { return m_worker.joinable(); }
+
+        // 文档 docId 的快照文件路径
+        std::string GetFilePath(uint32_t docId) const;
+
+        // ============ 界面线程调用 ============
+
+        // 记下一次编辑（不写盘）
+        void RecordEdit(uint32_t docId, const TextDelta& delta);
+        // 文本整体换掉（重新载入等），之前记下的增量作废，下次自动保存改写基准
+        void Invalidate(uint32_t docId);
+        // 自动保存：还没有基准、原文档路径或加密方式变了、或上次基准以来的增量超过全文时改写基准，
+        // 否则只追加待写的增量。textLength 为当前全文的字符数，source 只在改写基准时调用
+        void Autosave(uint32_t docId, const std::string& docPath, size_t textLength,
+            RecoveryTextSource source, const UndoJournalCipher* pCipher);
+        // 文档已保存或关闭：删除快照，之后的编辑重新开始
+        void Discard(uint32_t docId);
+        // 等待后台线程写完已提交的工作
+        void Flush();
+
+        RecoveryStats GetStats() const;
+
+    private:
+        enum JobKind
+        {
+            Job_Base,
+            Job_Append,
+            Job_Remove
+        };
+
+        struct Job
+        {
+            JobKind kind;
+            uint32_t docId;
+            std::string docPath;
+            RecoveryTextSource source;
+            std::vector<TextDelta> edits;
+            std::shared_ptr<UndoJournalCipher> cipher;
+        };
+
+        // 界面线程维护的每个文档的状态
+        struct DocState
+        {
+            std::vector<TextDelta> pending;     // 上次自动保存以来的增量
+            size_t sinceBaseBytes;              // 上次基准以来提交的增量字节数
+            bool bHasBase;
+            bool bInvalid;
+            std::string docPath;
+            std::shared_ptr<UndoJournalCipher> cipher;
+        };
+
+        void Submit(Job job);
+        void WorkerLoop();
+        bool RunJob(Job& job);
+
+        std::string m_dir;
+        std::string m_sessionId;
+        std::map<uint32_t, DocState> m_docs;
+
+        std::thread m_worker;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_idle;
+        std::deque<Job> m_queue;
+        bool m_bBusy;
+        bool m_bStopping;
+        std::set<uint32_t> m_failed;        // 写入失败的文档，下次自动保存改写基准
+        RecoveryStats m_stats;
+    };
+}
@@ -0,0 +1,182 @@
+﻿// SearchIndexManager.cpp - 笔记目录搜索索引的实现
+
+#include "pch.h"
+#include "framework.h"
+#include "SearchIndexManager.h"
+#include "ConfigManager.h"
+#include "MFCNoteBookDoc.h"
+
+#include <string>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+CSearchIndexManager::CSearchIndexManager()
+    : m_bLoadAttempted(false)
+{
+}
+
+bool CSearchIndexManager::EnsureLoaded()
+{
+    if (m_bLoadAttempted)
+        return m_pIndex != nullptr;
+    m_bLoadAttempted = true;
+
+    CConfigManager& config = CConfigManager::GetInstance();
+    CString strNotesDir = config.GetNotesDirectory();
+    if (strNotesDir.IsEmpty())
+        return false;
+    m_strNotesDir = strNotesDir + _T("\\");
+
+    // *.mynote 使用由密钥派生的带密钥哈希，索引中不留下可直接比对的内容
+    CT2A asciiSecretKey(config.GetSecretKey(), CP_UTF8);
+    uint64_t keySalt = TestableLogic::TrigramIndex::DeriveKeySalt(
+        (const char*)asciiSecretKey, strlen(asciiSecretKey));
+
+    CString strIndexPath = m_strNotesDir + CString(TRIGRAM_INDEX_FILE_NAME);
+    std::unique_ptr<TestableLogic::TrigramIndex> pIndex(new TestableLogic::TrigramIndex(keySalt));
+    if (!pIndex->Load(std::string(CT2A(strIndexPath, CP_UTF8))))
+    {
+        TRACE(_T("加载搜索索引失败: %s\n"), strIndexPath.GetString());
+        return false;
+    }
+    m_pIndex = std::move(pIndex);
+    return true;
+}
+
+bool CSearchIndexManager::IsInNotesDirectory(const CString& strPath) const
+{
+    return strPath.GetLength() > m_strNotesDir.GetLength() &&
+        strPath.Left(m_strNotesDir.GetLength()).CompareNoCase(m_strNotesDir) == 0;
+}
+
+uint64_t CSearchIndexManager::GetFileStamp(LPCTSTR lpszPathName)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(lpszPathName, GetFileExInfoStandard, &data))
+        return 0;
+    return (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+void CSearchIndexManager::UpdateFile(LPCTSTR lpszPathName, const CString& strContent, bool bKeyedHash)
+{
+    if (!EnsureLoaded() || !IsInNotesDirectory(lpszPathName))
+        return;
+
+    // 时间戳取文件保存后的修改时间
+    if (!m_pIndex->UpdateFile(std::string(CT2A(lpszPathName, CP_UTF8)), strContent.GetString(),
+        strContent.GetLength(), GetFileStamp(lpszPathName), bKeyedHash))
+    {
+        TRACE(_T("更新搜索索引失败: %s\n"), lpszPathName);
+        return;
+    }
+
+    if (m_pIndex->NeedsCompaction())
+    {
+        m_pIndex->Compact();
+    }
+}
+
+// 只收录编辑器能打开的笔记（*.txt、*.mynote），超大文件与保存时一样不建立索引
+void CSearchIndexManager::ScanDirectory(const CString& strDir,
+    std::vector<TestableLogic::TrigramSourceFile>& files) const
+{
+    CFileFind finder;
+    BOOL bFound = finder.FindFile(strDir + _T("*"));
+    while (bFound)
+    {
+        bFound = finder.FindNextFile();
+        if (finder.IsDots() || finder.IsHidden() || finder.IsSystem())
+            continue;
+        if (finder.IsDirectory())
+        {
+            ScanDirectory(finder.GetFilePath() + _T("\\"), files);
+            continue;
+        }
+
+        CString strName = finder.GetFileName();
+        strName.MakeLower();
+        bool bMyNote = strName.Right(7) == _T(".mynote");
+        if ((!bMyNote && strName.Right(4) != _T(".txt")) || finder.GetLength() >= LARGE_FILE_THRESHOLD)
+            continue;
+
+        FILETIME ftWrite;
+        finder.GetLastWriteTime(&ftWrite);
+        TestableLogic::TrigramSourceFile file;
+        file.path = std::string(CT2A(finder.GetFilePath(), CP_UTF8));
+        file.stamp = (static_cast<uint64_t>(ftWrite.dwHighDateTime) << 32) | ftWrite.dwLowDateTime;
+        file.bKeyedHash = bMyNote;
+        files.push_back(std::move(file));
+    }
+    finder.Close();
+}
+
+// 与打开文档相同的解码和换行处理，保存时建立的索引与扫描时的一致；不弹出任何提示
+bool CSearchIndexManager::ReadNoteText(LPCTSTR lpszPathName, CString& strContent)
+{
+    CMFCNoteBookDoc::LoadedText loaded;
+    CString strError;
+    if (!CMFCNoteBookDoc::ReadDocumentFile(lpszPathName, loaded, strError))
+    {
+        TRACE(_T("搜索索引无法读入 %s: %s\n"), lpszPathName, strError.GetString());
+        return false;
+    }
+    strContent = loaded.strContent;
+    return true;
+}
+
+size_t CSearchIndexManager::Refresh()
+{
+    if (!EnsureLoaded())
+        return 0;
+
+    std::vector<TestableLogic::TrigramSourceFile> files;
+    ScanDirectory(m_strNotesDir, files);
+    size_t nLoaded = m_pIndex->Refresh(files, [](const std::string& path, std::wstring& text)
+    {
+        CString strContent;
+        if (!ReadNoteText(CString(CA2T(path.c_str(), CP_UTF8)), strContent))
+            return false;
+        text.assign(strContent.GetString(), strContent.GetLength());
+        return true;
+    });
+
+    if (m_pIndex->NeedsCompaction())
+    {
+        m_pIndex->Compact();
+    }
+    TRACE(_T("搜索索引: %Iu 篇，重新读入 %Iu 篇\n"), m_pIndex->FileCount(), nLoaded);
+    return nLoaded;
+}
+
+bool CSearchIndexManager::Find(const CString& strNeedle, bool bMatchCase, FindResult& result)
+{
+    result = FindResult();
+    if (!EnsureLoaded() || strNeedle.IsEmpty())
+        return false;
+
+    Refresh();
+    result.total = m_pIndex->FileCount();
+
+    // 索引的三元组不区分大小写，候选总是包含区分大小写时的全部结果
+    CString strFind(strNeedle);
+    if (!bMatchCase)
+        strFind.MakeLower();
+    std::vector<std::string> matches = m_pIndex->Search(strNeedle.GetString(), strNeedle.GetLength(),
+        [&](const std::string& path)
+    {
+        result.candidates++;
+        CString strContent;
+        if (!ReadNoteText(CString(CA2T(path.c_str(), CP_UTF8)), strContent))
+            return false;
+        if (!bMatchCase)
+            strContent.MakeLower();
+        return strContent.Find(strFind) >= 0;
+    });
+    for (const std::string& path : matches)
+    {
+        result.matches.push_back(CString(CA2T(path.c_str(), CP_UTF8)));
+    }
+    return true;
+}
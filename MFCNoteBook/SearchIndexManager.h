@@ -0,0 +1,51 @@
+﻿// SearchIndexManager.h - 笔记目录的搜索索引，程序运行期间只载入一次
+//
+// 配置了笔记目录（config.ini 的 [Search] NotesDirectory）时，目录及其子目录中的文件共用一个三元组索引。
+// 索引在第一次使用时载入（映射基础索引并重放增量日志），之后保存文档只向增量日志追加一条记录，
+// 增量大到一定程度时再合并进基础索引。“在笔记中查找”先扫描目录，只重新读入新增和修改过的文件，
+// 再由索引选出可能包含查找内容的文件，只对这些文件做完整匹配。
+#pragma once
+
+#include "TrigramIndex.h"
+
+#include <memory>
+#include <vector>
+
+class CSearchIndexManager
+{
+public:
+    CSearchIndexManager();
+
+    // 笔记目录中的文件保存后调用：追加这一篇的三元组；不在笔记目录中的文件忽略，失败不影响保存
+    void UpdateFile(LPCTSTR lpszPathName, const CString& strContent, bool bKeyedHash);
+
+    // 是否配置了笔记目录（第一次调用时载入索引）
+    bool IsAvailable() { return EnsureLoaded(); }
+    const CString& GetNotesDirectory() const { return m_strNotesDir; }
+
+    // 扫描笔记目录：新增和修改过的文件重新读入，已不存在的文件从索引中删除；返回重新读入的篇数
+    size_t Refresh();
+
+    struct FindResult
+    {
+        std::vector<CString> matches;   // 包含查找内容的文件（完整路径）
+        size_t candidates = 0;          // 索引选出、做了完整匹配的篇数
+        size_t total = 0;               // 索引中的篇数
+    };
+    // 先刷新索引，再用索引缩小范围并逐篇完整匹配；未配置笔记目录时返回 false
+    bool Find(const CString& strNeedle, bool bMatchCase, FindResult& result);
+
+    // 文件的修改时间，作为索引中的时间戳；取不到时返回 0
+    static uint64_t GetFileStamp(LPCTSTR lpszPathName);
+
+private:
+    // 第一次调用时读取配置并载入索引；未配置笔记目录或载入失败时返回 false（之后不再重试）
+    bool EnsureLoaded();
+    bool IsInNotesDirectory(const CString& strPath) const;
+    void ScanDirectory(const CString& strDir, std::vector<TestableLogic::TrigramSourceFile>& files) const;
+    static bool ReadNoteText(LPCTSTR lpszPathName, CString& strContent);
+
+    std::unique_ptr<TestableLogic::TrigramIndex> m_pIndex;
+    CString m_strNotesDir;      // 带末尾的反斜杠
+    bool m_bLoadAttempted;
+};
@@ -0,0 +1,398 @@
+﻿// SessionManager.cpp - 会话恢复实现
+
+#include "pch.h"
+#include "framework.h"
+#include "SessionManager.h"
+#include "MFCNoteBookView.h"
+
+#include <climits>
+#include <set>
+#include <shlobj.h>
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+// 会话文件（%LOCALAPPDATA% 下）
+#define SESSION_DIR _T("MFCNoteBook")
+#define SESSION_FILE_NAME _T("session.dat")
+// 载入失败的提示中最多列出的文档数
+#define SESSION_FAILURE_LIST_MAX 10
+// 用户切换到的文档排在所有等待的文档之前
+#define SESSION_PRIORITY_ACTIVATED (-1)
+
+CSessionManager::CSessionManager()
+    : m_hNotifyWnd(NULL)
+    , m_bDispatching(false)
+    , m_pStatusFrame(NULL)
+    , m_pActiveDoc(NULL)
+    , m_dwStartTick(0)
+    , m_dwWindowsShown(0)
+    , m_dwActiveLoaded(0)
+    , m_nRestored(0)
+    , m_nLoaded(0)
+    , m_nFailures(0)
+{
+}
+
+CSessionManager::~CSessionManager()
+{
+    Shutdown();
+}
+
+CString CSessionManager::GetSessionPath()
+{
+    TCHAR szAppData[MAX_PATH];
+    if (FAILED(SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA | CSIDL_FLAG_CREATE, NULL, 0, szAppData)))
+        return CString();
+
+    CString strDir(szAppData);
+    strDir += _T("\\") SESSION_DIR;
+    int nResult = SHCreateDirectoryEx(NULL, strDir, NULL);
+    if (nResult != ERROR_SUCCESS && nResult != ERROR_ALREADY_EXISTS)
+        return CString();
+    return strDir + _T("\\") SESSION_FILE_NAME;
+}
+
+bool CSessionManager::GetFileStamp(LPCTSTR lpszPathName, uint64_t& fileSize, uint64_t& modifiedTime)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(lpszPathName, GetFileExInfoStandard, &data))
+        return false;
+
+    fileSize = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    modifiedTime = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+        data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+bool CSessionManager::Load()
+{
+    m_strPath = GetSessionPath();
+    m_documents.clear();
+    if (m_strPath.IsEmpty())
+        return false;
+
+    // 没有会话文件或已损坏时当作没有会话
+    TestableLogic::LoadSession(std::string(CT2A(m_strPath, CP_UTF8)), m_documents);
+    return !m_documents.empty();
+}
+
+bool CSessionManager::Save(CMDIFrameWnd* pMainFrame)
+{
+    if (m_strPath.IsEmpty())
+        m_strPath = GetSessionPath();
+    if (m_strPath.IsEmpty() || !pMainFrame)
+        return false;
+
+    // 从活动窗口开始按 Z 序遍历子窗口；同一文档的多个窗口只记第一个
+    std::vector<TestableLogic::SessionDocument> docs;
+    std::set<CMFCNoteBookDoc*> recorded;
+    BOOL bMaximized = FALSE;
+    CMDIChildWnd* pActive = pMainFrame->MDIGetActive(&bMaximized);
+    for (CWnd* pWnd = pActive; pWnd != NULL; pWnd = pWnd->GetWindow(GW_HWNDNEXT))
+    {
+        CMDIChildWnd* pChild = DYNAMIC_DOWNCAST(CMDIChildWnd, pWnd);
+        CMFCNoteBookView* pView = pChild ? DYNAMIC_DOWNCAST(CMFCNoteBookView, pChild->GetActiveView()) : NULL;
+        CMFCNoteBookDoc* pDoc = pView ? pView->GetDocument() : NULL;
+        if (!pDoc || pDoc->GetPathName().IsEmpty() || !recorded.insert(pDoc).second)
+            continue;
+
+        TestableLogic::SessionDocument doc = TestableLogic::SessionDocument();
+        std::map<CMFCNoteBookDoc*, PendingDocument>::iterator it = m_pending.find(pDoc);
+        if (it != m_pending.end())
+        {
+            // 仍在载入：保留上次记下的位置
+            doc = it->second.saved;
+        }
+        else
+        {
+            doc.path = std::string(CT2A(pDoc->GetPathName(), CP_UTF8));
+            GetFileStamp(pDoc->GetPathName(), doc.fileSize, doc.modifiedTime);
+
+            int nSelStart, nSelEnd, nFirstLine;
+            pView->GetViewState(nSelStart, nSelEnd, nFirstLine);
+            doc.selStart = static_cast<uint64_t>(nSelStart);
+            doc.selEnd = static_cast<uint64_t>(nSelEnd);
+            doc.firstVisibleLine = static_cast<uint64_t>(nFirstLine);
+        }
+
+        doc.flags = TestableLogic::SessionDocument_None;
+        if (pChild == pActive)
+            doc.flags |= TestableLogic::SessionDocument_Active;
+        if (pChild == pActive && bMaximized)
+            doc.flags |= TestableLogic::SessionDocument_Maximized;
+        if (pChild->IsIconic())
+            doc.flags |= TestableLogic::SessionDocument_Minimized;
+        docs.push_back(std::move(doc));
+    }
+
+    return TestableLogic::SaveSession(std::string(CT2A(m_strPath, CP_UTF8)), docs);
+}
+
+void CSessionManager::Restore(CDocTemplate* pDocTemplate, CMDIFrameWnd* pMainFrame, DWORD dwStartTick)
+{
+    if (!pDocTemplate || !pMainFrame || m_documents.empty())
+        return;
+
+    // 命令行或崩溃恢复已经打开的文件不再重复打开
+    std::set<CString> opened;
+    POSITION posDoc = pDocTemplate->GetFirstDocPosition();
+    while (posDoc)
+    {
+        CString strOpened = pDocTemplate->GetNextDoc(posDoc)->GetPathName();
+        strOpened.MakeLower();
+        opened.insert(strOpened);
+    }
+
+    m_hNotifyWnd = pMainFrame->GetSafeHwnd();
+    m_pStatusFrame = pMainFrame;
+    m_dwStartTick = dwStartTick;
+    m_pActiveDoc = NULL;
+    m_dwActiveLoaded = 0;
+    m_nRestored = m_nLoaded = m_nFailures = 0;
+    m_strFailures.Empty();
+    if (!m_pool.IsRunning())
+        m_pool.Start();
+
+    CMDIChildWnd* pPrevActive = pMainFrame->MDIGetActive();
+    std::vector<int> priorities = TestableLogic::GetSessionLoadPriorities(m_documents);
+    CFrameWnd* pMaximize = NULL;
+
+    // 从最后面的窗口开始创建，最后创建的活动窗口在最前面，Z 序与退出时相同
+    for (size_t i = m_documents.size(); i-- > 0;)
+    {
+        const TestableLogic::SessionDocument& saved = m_documents[i];
+        CString strPath(CA2T(saved.path.c_str(), CP_UTF8));
+        CString strKey(strPath);
+        strKey.MakeLower();
+        if (strPath.IsEmpty() || !opened.insert(strKey).second)
+            continue;
+
+        CMFCNoteBookDoc* pDoc = DYNAMIC_DOWNCAST(CMFCNoteBookDoc, pDocTemplate->CreateNewDocument());
+        if (!pDoc)
+            continue;
+        pDoc->BeginPendingLoad(strPath);
+
+        // 与 CMultiDocTemplate::OpenDocumentFile 相同：创建窗口失败时由这里删除文档
+        BOOL bAutoDelete = pDoc->m_bAutoDelete;
+        pDoc->m_bAutoDelete = FALSE;
+        CFrameWnd* pFrame = pDocTemplate->CreateNewFrame(pDoc, NULL);
+        pDoc->m_bAutoDelete = bAutoDelete;
+        if (!pFrame)
+        {
+            pDocTemplate->RemoveDocument(pDoc);
+            delete pDoc;
+            continue;
+        }
+        pDocTemplate->InitialUpdateFrame(pFrame, pDoc, TRUE);
+        if (saved.flags & TestableLogic::SessionDocument_Minimized)
+            pFrame->ShowWindow(SW_MINIMIZE);
+        if (saved.flags & TestableLogic::SessionDocument_Active)
+        {
+            m_pActiveDoc = pDoc;
+            if (saved.flags & TestableLogic::SessionDocument_Maximized)
+                pMaximize = pFrame;
+        }
+
+        PendingDocument pending;
+        pending.strPath = strPath;
+        pending.saved = saved;
+        pending.taskId = m_pool.Post(priorities[i], [this, pDoc, strPath, saved]()
+            {
+                LoadInBackground(pDoc, strPath, saved);
+            });
+        m_pending[pDoc] = pending;
+        m_nRestored++;
+    }
+    m_documents.clear();
+
+    if (pMaximize)
+        pMainFrame->MDIMaximize(pMaximize);
+    // 命令行指定的文件仍在最前面
+    if (pPrevActive)
+        pMainFrame->MDIActivate(pPrevActive);
+
+    m_dwWindowsShown = GetTickCount() - m_dwStartTick;
+    ReportProgress();
+}
+
+// 线程池中执行：读入、解码、校验，结果放入队列后通知界面线程
+void CSessionManager::LoadInBackground(CMFCNoteBookDoc* pDoc, const CString& strPath,
+    const TestableLogic::SessionDocument& saved)
+{
+    std::unique_ptr<LoadResult> result(new LoadResult());
+    result->pDoc = pDoc;
+    result->bOk = false;
+    result->bSynchronous = false;
+
+    uint64_t fileSize = 0, modifiedTime = 0;
+    bool bExists = GetFileStamp(strPath, fileSize, modifiedTime);
+    result->bUnchanged = bExists && fileSize == saved.fileSize && modifiedTime == saved.modifiedTime;
+
+    // 较大的纯文本可能要映射给自绘编辑器，映射和文档状态都在界面线程中处理
+    if (bExists && fileSize >= LONG_LINE_FILE_THRESHOLD &&
+        CMFCNoteBookDoc::DetectFileFormat(strPath) != FileFormat::MyNote)
+    {
+        result->bSynchronous = true;
+    }
+    else
+    {
+        result->bOk = CMFCNoteBookDoc::ReadDocumentFile(strPath, result->loaded, result->strError);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.push_back(std::move(result));
+    }
+    ::PostMessage(m_hNotifyWnd, WM_SESSION_DOC_LOADED, 0, 0);
+}
+
+void CSessionManager::OnDocumentsLoaded()
+{
+    if (m_bDispatching)
+        return;
+    m_bDispatching = true;
+
+    for (;;)
+    {
+        std::unique_ptr<LoadResult> result;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_results.empty())
+                break;
+            result = std::move(m_results.front());
+            m_results.pop_front();
+        }
+
+        // 等待期间已关闭的文档不在 m_pending 中
+        std::map<CMFCNoteBookDoc*, PendingDocument>::iterator it = m_pending.find(result->pDoc);
+        if (it == m_pending.end())
+            continue;
+        PendingDocument pending = it->second;
+        m_pending.erase(it);
+
+        CMFCNoteBookDoc* pDoc = result->pDoc;
+        BOOL bLoaded = FALSE;
+        if (result->bSynchronous)
+        {
+            bLoaded = pDoc->CompletePendingLoad(pending.strPath, NULL);
+        }
+        else if (result->bOk)
+        {
+            bLoaded = pDoc->CompletePendingLoad(pending.strPath, &result->loaded);
+        }
+        else
+        {
+            TRACE(_T("会话恢复：无法载入 %s\n%s\n"), pending.strPath.GetString(), result->strError.GetString());
+            if (m_nFailures < SESSION_FAILURE_LIST_MAX)
+            {
+                m_strFailures += _T("    ") + pending.strPath + _T("\n");
+            }
+            else if (m_nFailures == SESSION_FAILURE_LIST_MAX)
+            {
+                m_strFailures += _T("    ……\n");
+            }
+            m_nFailures++;
+        }
+
+        if (bLoaded)
+        {
+            // 文件在别处修改过时原来的位置已经没有意义
+            if (result->bUnchanged)
+                RestoreViewState(pDoc, pending.saved);
+            m_nLoaded++;
+        }
+        else
+        {
+            pDoc->OnCloseDocument();
+        }
+
+        if (pDoc == m_pActiveDoc)
+        {
+            m_pActiveDoc = NULL;
+            m_dwActiveLoaded = GetTickCount() - m_dwStartTick;
+        }
+        ReportProgress();
+    }
+
+    m_bDispatching = false;
+}
+
+void CSessionManager::RestoreViewState(CMFCNoteBookDoc* pDoc, const TestableLogic::SessionDocument& saved)
+{
+    POSITION pos = pDoc->GetFirstViewPosition();
+    CMFCNoteBookView* pView = pos ? DYNAMIC_DOWNCAST(CMFCNoteBookView, pDoc->GetNextView(pos)) : NULL;
+    if (!pView)
+        return;
+
+    pView->RestoreViewState(static_cast<int>((std::min)(saved.selStart, static_cast<uint64_t>(INT_MAX))),
+        static_cast<int>((std::min)(saved.selEnd, static_cast<uint64_t>(INT_MAX))),
+        static_cast<int>((std::min)(saved.firstVisibleLine, static_cast<uint64_t>(INT_MAX))));
+}
+
+void CSessionManager::Promote(CMFCNoteBookDoc* pDoc)
+{
+    std::map<CMFCNoteBookDoc*, PendingDocument>::iterator it = m_pending.find(pDoc);
+    if (it != m_pending.end())
+        m_pool.Promote(it->second.taskId, SESSION_PRIORITY_ACTIVATED);
+}
+
+void CSessionManager::Cancel(CMFCNoteBookDoc* pDoc)
+{
+    std::map<CMFCNoteBookDoc*, PendingDocument>::iterator it = m_pending.find(pDoc);
+    if (it == m_pending.end())
+        return;
+
+    m_pool.Cancel(it->second.taskId);
+    m_pending.erase(it);
+    if (pDoc == m_pActiveDoc)
+        m_pActiveDoc = NULL;
+    if (!m_bDispatching)
+        ReportProgress();
+}
+
+void CSessionManager::Shutdown()
+{
+    m_pool.Stop();
+    m_pending.clear();
+    m_pActiveDoc = NULL;
+    m_nRestored = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_results.clear();
+}
+
+// 状态栏显示进度；全部载入后给出从启动到可以交互的时间，并一次列出载入失败的文档
+void CSessionManager::ReportProgress()
+{
+    if (m_nRestored == 0)
+        return;
+
+    CString strMsg;
+    if (!m_pending.empty())
+    {
+        strMsg.Format(_T("正在恢复会话：%d/%d 个文档已载入"), m_nLoaded, m_nRestored);
+    }
+    else
+    {
+        strMsg.Format(_T("会话已恢复 %d 个文档：窗口显示 %lu 毫秒，活动文档可编辑 %lu 毫秒，全部载入 %lu 毫秒"),
+            m_nLoaded, m_dwWindowsShown, m_dwActiveLoaded, GetTickCount() - m_dwStartTick);
+        TRACE(_T("%s\n"), strMsg.GetString());
+    }
+    if (m_pStatusFrame && m_pStatusFrame->GetSafeHwnd())
+        m_pStatusFrame->SetMessageText(strMsg);
+
+    if (m_pending.empty())
+    {
+        m_nRestored = 0;
+        if (m_nFailures > 0)
+        {
+            CString strPrompt;
+            strPrompt.Format(_T("上次会话中有 %d 个文档无法载入，已关闭：\n\n%s"), m_nFailures, m_strFailures.GetString());
+            m_nFailures = 0;
+            m_strFailures.Empty();
+            AfxMessageBox(strPrompt, MB_ICONWARNING);
+        }
+    }
+}
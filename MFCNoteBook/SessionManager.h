@@ -0,0 +1,91 @@
+﻿// SessionManager.h - 会话恢复：退出时记下打开的文档，启动时先显示窗口再在后台载入内容
+//
+// 启动时为上次的每个文档立即创建子窗口，显示只读的占位内容；读入、解码和 MyNote 摘要校验
+// 由线程池并行完成，可见的文档先载入，切换到还在等待的文档时它会插到队首。
+// 载入的结果通过 WM_SESSION_DOC_LOADED 交回界面线程，由文档接管并替换占位内容。
+// 从启动到窗口显示、活动文档可编辑、全部载入完成的时间写入 TRACE 和状态栏。
+#pragma once
+
+#include "MFCNoteBookDoc.h"
+#include "SessionState.h"
+#include "TaskPool.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 后台载入完成后发给主窗口的通知（结果在队列中，由 OnDocumentsLoaded 取出）
+#define WM_SESSION_DOC_LOADED (WM_APP + 1)
+
+class CSessionManager
+{
+public:
+    CSessionManager();
+    ~CSessionManager();
+
+    // 读入上次的会话（%LOCALAPPDATA%\MFCNoteBook\session.dat），有文档时返回 true
+    bool Load();
+    // 主窗口关闭、文档关闭之前调用：按窗口次序记下有路径的文档和位置
+    bool Save(CMDIFrameWnd* pMainFrame);
+
+    // 为 Load 读到的文档创建窗口并开始后台载入；已经打开的文件跳过。
+    // dwStartTick 为程序启动时的 GetTickCount()，用于统计可以交互的时间
+    void Restore(CDocTemplate* pDocTemplate, CMDIFrameWnd* pMainFrame, DWORD dwStartTick);
+
+    // 主窗口收到 WM_SESSION_DOC_LOADED 时调用：把载入完成的内容交给文档
+    void OnDocumentsLoaded();
+    // 用户切换到仍在等待的文档：让它先载入
+    void Promote(CMFCNoteBookDoc* pDoc);
+    // 文档关闭：取消尚未开始的载入，已在进行的结果交回时丢弃
+    void Cancel(CMFCNoteBookDoc* pDoc);
+    // 程序退出：丢弃尚未开始的载入，等待进行中的载入结束
+    void Shutdown();
+
+private:
+    struct PendingDocument
+    {
+        CString strPath;
+        TestableLogic::SessionDocument saved;
+        TestableLogic::TaskId taskId;
+    };
+
+    struct LoadResult
+    {
+        CMFCNoteBookDoc* pDoc;          // 只作为标识，后台线程不访问文档
+        bool bOk;
+        bool bSynchronous;              // 可能是超大文件，由界面线程按原流程打开
+        bool bUnchanged;                // 文件大小和修改时间与会话记录一致，可以恢复位置
+        CMFCNoteBookDoc::LoadedText loaded;
+        CString strError;
+    };
+
+    static CString GetSessionPath();
+    static bool GetFileStamp(LPCTSTR lpszPathName, uint64_t& fileSize, uint64_t& modifiedTime);
+
+    void LoadInBackground(CMFCNoteBookDoc* pDoc, const CString& strPath, const TestableLogic::SessionDocument& saved);
+    void RestoreViewState(CMFCNoteBookDoc* pDoc, const TestableLogic::SessionDocument& saved);
+    void ReportProgress();
+
+    CString m_strPath;
+    std::vector<TestableLogic::SessionDocument> m_documents;
+
+    TestableLogic::TaskPool m_pool;
+    std::map<CMFCNoteBookDoc*, PendingDocument> m_pending;     // 只在界面线程访问
+    std::mutex m_mutex;
+    std::deque<std::unique_ptr<LoadResult>> m_results;         // 后台线程交回的结果
+    HWND m_hNotifyWnd;
+    bool m_bDispatching;        // 交回结果时可能弹出 MyNote 的提示，期间不重入
+
+    // 可以交互的时间统计（毫秒，从程序启动算起）
+    CFrameWnd* m_pStatusFrame;
+    CMFCNoteBookDoc* m_pActiveDoc;
+    DWORD m_dwStartTick;
+    DWORD m_dwWindowsShown;
+    DWORD m_dwActiveLoaded;
+    int m_nRestored;
+    int m_nLoaded;
+    CString m_strFailures;
+    int m_nFailures;
+};
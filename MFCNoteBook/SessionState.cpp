@@ -0,0 +1,134 @@
+﻿// SessionState.cpp - 会话文件实现
+#include "SessionState.h"
+#include "FileUtil.h"
+#include "TextDelta.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        uint32_t Fnv1a(const void* pData, size_t len)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(pData);
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < len; i++)
+            {
+                h ^= p[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+    }
+
+    void EncodeSession(const std::vector<SessionDocument>& docs, std::vector<uint8_t>& out)
+    {
+        size_t count = docs.size() < SESSION_MAX_DOCUMENTS ? docs.size() : SESSION_MAX_DOCUMENTS;
+        std::vector<uint8_t> payload;
+        for (size_t i = 0; i < count; i++)
+        {
+            const SessionDocument& doc = docs[i];
+            AppendVarint(payload, doc.path.size());
+            payload.insert(payload.end(), doc.path.begin(), doc.path.end());
+            AppendVarint(payload, doc.fileSize);
+            AppendVarint(payload, doc.modifiedTime);
+            AppendVarint(payload, doc.selStart);
+            AppendVarint(payload, doc.selEnd);
+            AppendVarint(payload, doc.firstVisibleLine);
+            AppendVarint(payload, doc.flags);
+        }
+
+        SessionFileHeader header = {};
+        memcpy(header.magic, SESSION_FILE_MAGIC, SESSION_FILE_MAGIC_SIZE);
+        header.version = SESSION_FILE_VERSION;
+        header.count = static_cast<uint32_t>(count);
+        header.payloadLength = static_cast<uint32_t>(payload.size());
+        header.checksum = Fnv1a(payload.data(), payload.size());
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&header);
+        out.insert(out.end(), p, p + sizeof(header));
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+
+    bool DecodeSession(const uint8_t* data, size_t len, std::vector<SessionDocument>& docs)
+    {
+        docs.clear();
+        SessionFileHeader header;
+        if (len < sizeof(header))
+            return false;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, SESSION_FILE_MAGIC, SESSION_FILE_MAGIC_SIZE) != 0 ||
+            header.version != SESSION_FILE_VERSION || header.count > SESSION_MAX_DOCUMENTS ||
+            header.payloadLength != len - sizeof(header))
+            return false;
+
+        const uint8_t* payload = data + sizeof(header);
+        size_t size = header.payloadLength;
+        if (Fnv1a(payload, size) != header.checksum)
+            return false;
+
+        size_t pos = 0;
+        for (uint32_t i = 0; i < header.count; i++)
+        {
+            SessionDocument doc;
+            uint64_t pathLength = 0, flags = 0;
+            if (!ReadVarint(payload, size, pos, pathLength) || pathLength > size - pos)
+                return false;
+            doc.path.assign(reinterpret_cast<const char*>(payload + pos), static_cast<size_t>(pathLength));
+            pos += static_cast<size_t>(pathLength);
+
+            if (!ReadVarint(payload, size, pos, doc.fileSize) || !ReadVarint(payload, size, pos, doc.modifiedTime) ||
+                !ReadVarint(payload, size, pos, doc.selStart) || !ReadVarint(payload, size, pos, doc.selEnd) ||
+                !ReadVarint(payload, size, pos, doc.firstVisibleLine) || !ReadVarint(payload, size, pos, flags))
+                return false;
+            doc.flags = static_cast<uint32_t>(flags);
+            docs.push_back(std::move(doc));
+        }
+        if (pos == size)
+            return true;
+
+        docs.clear();
+        return false;
+    }
+
+    bool SaveSession(const std::string& path, const std::vector<SessionDocument>& docs)
+    {
+        std::vector<uint8_t> data;
+        EncodeSession(docs, data);
+        return FileUtil::WriteAllAtomic(path, data.data(), data.size());
+    }
+
+    bool LoadSession(const std::string& path, std::vector<SessionDocument>& docs)
+    {
+        std::vector<uint8_t> data;
+        if (!FileUtil::ReadAll(path, data))
+        {
+            docs.clear();
+            return false;
+        }
+        return DecodeSession(data.data(), data.size(), docs);
+    }
+
+    std::vector<int> GetSessionLoadPriorities(const std::vector<SessionDocument>& docs)
+    {
+        bool bMaximized = false;
+        for (const SessionDocument& doc : docs)
+        {
+            if (doc.flags & SessionDocument_Maximized)
+                bMaximized = true;
+        }
+
+        // 可见的文档优先级为窗口次序，其余的排在所有可见文档之后
+        std::vector<int> priorities(docs.size());
+        int nHidden = static_cast<int>(docs.size());
+        for (size_t i = 0; i < docs.size(); i++)
+        {
+            uint32_t flags = docs[i].flags;
+            bool bVisible = (flags & SessionDocument_Active) ||
+                (!bMaximized && !(flags & SessionDocument_Minimized));
+            priorities[i] = bVisible ? static_cast<int>(i) : nHidden + static_cast<int>(i);
+        }
+        return priorities;
+    }
+}
@@ -0,0 +1,73 @@
+﻿// SessionState.h - 会话：退出时打开的文档及其位置（不依赖MFC）
+//
+// 主窗口关闭前记下打开的每个文档的路径、选区、首个可见行和窗口状态，下次启动时按同样的顺序重新打开。
+// 同时记下文件的大小和修改时间：恢复时据此确认文件没有在别处修改过，改过的文件不再套用原来的位置。
+// 文件很小，整体编码后先写临时文件再替换；校验不符或版本不同时视为没有会话。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============ 会话文件格式常量 ============
+#define SESSION_FILE_MAGIC          "MNSESS01"
+#define SESSION_FILE_MAGIC_SIZE     8
+#define SESSION_FILE_VERSION        1
+// 最多记下的文档数
+#define SESSION_MAX_DOCUMENTS       512
+
+namespace TestableLogic
+{
+    enum SessionDocumentFlags : uint32_t
+    {
+        SessionDocument_None = 0,
+        SessionDocument_Active = 1,         // 退出时的活动窗口
+        SessionDocument_Maximized = 2,      // 子窗口最大化
+        SessionDocument_Minimized = 4
+    };
+
+    struct SessionDocument
+    {
+        std::string path;           // UTF-8
+        uint64_t fileSize;
+        uint64_t modifiedTime;      // 文件的修改时间（平台相关的计时单位，只比较是否相等）
+        uint64_t selStart;          // 选区（UTF-16 单元偏移）
+        uint64_t selEnd;
+        uint64_t firstVisibleLine;
+        uint32_t flags;
+
+        bool operator==(const SessionDocument& other) const
+        {
+            return path == other.path && fileSize == other.fileSize && modifiedTime == other.modifiedTime &&
+                selStart == other.selStart && selEnd == other.selEnd &&
+                firstVisibleLine == other.firstVisibleLine && flags == other.flags;
+        }
+    };
+
+    // ============ 磁盘布局（小端） ============
+    // [Header][负载]，负载为各文档的变长整数字段和路径
+#pragma pack(push, 4)
+    struct SessionFileHeader
+    {
+        char magic[SESSION_FILE_MAGIC_SIZE];
+        uint32_t version;
+        uint32_t count;
+        uint32_t payloadLength;
+        uint32_t checksum;              // 对负载的 FNV-1a
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(SessionFileHeader) == 24, "SessionFileHeader layout changed");
+
+    // docs 按窗口的前后次序排列（第一个在最前面）；超出 SESSION_MAX_DOCUMENTS 的部分不保存
+    void EncodeSession(const std::vector<SessionDocument>& docs, std::vector<uint8_t>& out);
+    bool DecodeSession(const uint8_t* data, size_t len, std::vector<SessionDocument>& docs);
+
+    bool SaveSession(const std::string& path, const std::vector<SessionDocument>& docs);
+    bool LoadSession(const std::string& path, std::vector<SessionDocument>& docs);
+
+    // 载入顺序的优先级（数值小的先载入）：可见的文档（活动窗口，子窗口未最大化时还有其他未最小化的窗口）
+    // 按窗口次序排在前面，其余的随后；结果与 docs 一一对应
+    std::vector<int> GetSessionLoadPriorities(const std::vector<SessionDocument>& docs);
+}
@@ -0,0 +1,89 @@
+﻿// SimdSupport.cpp - SIMD 指令集检测实现
+#include "SimdSupport.h"
+
+#include <atomic>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        std::atomic<int> g_nOverride(-1);
+
+        SimdLevel DetectSimdLevel()
+        {
+#if SIMD_X86
+#if defined(_MSC_VER)
+            int info[4] = { 0 };
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+
+            __cpuid(info, 1);
+            bool bSSE2 = (info[3] & (1 << 26)) != 0;
+            bool bSSSE3 = (info[2] & (1 << 9)) != 0;
+            bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+            bool bAVX = (info[2] & (1 << 28)) != 0;
+
+            bool bAVX2 = false;
+            if (maxLeaf >= 7 && bOSXSAVE && bAVX)
+            {
+                // 还需确认操作系统保存 YMM 寄存器
+                unsigned long long xcr0 = _xgetbv(0);
+                if ((xcr0 & 0x6) == 0x6)
+                {
+                    __cpuidex(info, 7, 0);
+                    bAVX2 = (info[1] & (1 << 5)) != 0;
+                }
+            }
+#else
+            __builtin_cpu_init();
+            bool bSSE2 = __builtin_cpu_supports("sse2");
+            bool bSSSE3 = __builtin_cpu_supports("ssse3");
+            bool bAVX2 = __builtin_cpu_supports("avx2");
+#endif
+            if (bAVX2 && bSSSE3)
+                return SimdLevel::AVX2;
+            if (bSSSE3)
+                return SimdLevel::SSSE3;
+            if (bSSE2)
+                return SimdLevel::SSE2;
+#endif
+            return SimdLevel::Scalar;
+        }
+    }
+
+    SimdLevel GetDetectedSimdLevel()
+    {
+        static const SimdLevel s_level = DetectSimdLevel();
+        return s_level;
+    }
+
+    SimdLevel GetSimdLevel()
+    {
+        SimdLevel detected = GetDetectedSimdLevel();
+        int nOverride = g_nOverride.load(std::memory_order_relaxed);
+        if (nOverride >= 0 && nOverride < static_cast<int>(detected))
+            return static_cast<SimdLevel>(nOverride);
+        return detected;
+    }
+
+    void SetSimdLevelOverride(SimdLevel level)
+    {
+        g_nOverride.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    void ClearSimdLevelOverride()
+    {
+        g_nOverride.store(-1, std::memory_order_relaxed);
+    }
+
+    const char* GetSimdLevelName(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::SSE2:  return "SSE2";
+        case SimdLevel::SSSE3: return "SSSE3";
+        case SimdLevel::AVX2:  return "AVX2";
+        default:               return "Scalar";
+        }
+    }
+}
@@ -0,0 +1,67 @@
+﻿// SimdSupport.h - SIMD 指令集检测与分派（不依赖MFC）
+#pragma once
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+// GCC/Clang 需要为单个函数开启指令集，MSVC 可直接使用内建函数
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SIMD_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_SSSE3
+#define SIMD_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace TestableLogic
+{
+    // 最低位 1 之前的 0 的个数，value 不能为 0
+    inline int CountTrailingZeros(unsigned int value)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    inline int PopCount32(uint32_t value)
+    {
+        value = value - ((value >> 1) & 0x55555555u);
+        value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+        return static_cast<int>((((value + (value >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+    }
+
+    // 按能力从低到高排列
+    enum class SimdLevel
+    {
+        Scalar = 0,
+        SSE2 = 1,
+        SSSE3 = 2,
+        AVX2 = 3
+    };
+
+    // 当前 CPU 支持的最高级别（受 SetSimdLevelOverride 限制）
+    SimdLevel GetSimdLevel();
+
+    // CPU 实际支持的最高级别
+    SimdLevel GetDetectedSimdLevel();
+
+    // 限制可使用的最高级别（测试和基准用于覆盖各条路径），Scalar 即禁用 SIMD
+    void SetSimdLevelOverride(SimdLevel level);
+    void ClearSimdLevelOverride();
+
+    const char* GetSimdLevelName(SimdLevel level);
+}
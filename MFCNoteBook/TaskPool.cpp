@@ -0,0 +1,144 @@
+﻿// TaskPool.cpp - 按优先级执行的后台任务线程池实现
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        // 提交的任务从中间向后编号，提前的任务从中间向前编号
+        const uint64_t kFirstSequence = 0x8000000000000000ULL;
+    }
+
+    TaskPool::TaskPool()
+        : m_sequence(kFirstSequence)
+        , m_frontSequence(kFirstSequence)
+        , m_nextId(1)
+        , m_running(0)
+        , m_bStopping(false)
+    {
+    }
+
+    TaskPool::~TaskPool()
+    {
+        Stop();
+    }
+
+    void TaskPool::Start(size_t threadCount)
+    {
+        Stop();
+        if (threadCount == 0)
+            threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+        threadCount = (std::min)(threadCount, static_cast<size_t>(TASK_POOL_MAX_THREADS));
+
+        m_bStopping = false;
+        for (size_t i = 0; i < threadCount; i++)
+            m_threads.emplace_back(&TaskPool::WorkerLoop, this);
+    }
+
+    void TaskPool::Stop()
+    {
+        if (m_threads.empty())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStopping = true;
+            m_order.clear();
+            m_pending.clear();
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads)
+            thread.join();
+        m_threads.clear();
+    }
+
+    TaskId TaskPool::Post(int priority, Task task)
+    {
+        TaskId id;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            id = m_nextId++;
+            Pending pending;
+            pending.key.priority = priority;
+            pending.key.sequence = m_sequence++;
+            pending.task = std::move(task);
+            m_order[pending.key] = id;
+            m_pending[id] = std::move(pending);
+        }
+        m_wake.notify_one();
+        return id;
+    }
+
+    bool TaskPool::Promote(TaskId id, int priority)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<TaskId, Pending>::iterator it = m_pending.find(id);
+        if (it == m_pending.end())
+            return false;
+        if (priority >= it->second.key.priority)
+            return true;
+
+        // 提前的任务排在同一优先级中已有任务的前面
+        m_order.erase(it->second.key);
+        it->second.key.priority = priority;
+        it->second.key.sequence = --m_frontSequence;
+        m_order[it->second.key] = id;
+        return true;
+    }
+
+    bool TaskPool::Cancel(TaskId id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<TaskId, Pending>::iterator it = m_pending.find(id);
+        if (it == m_pending.end())
+            return false;
+        m_order.erase(it->second.key);
+        m_pending.erase(it);
+        if (m_pending.empty() && m_running == 0)
+            m_idle.notify_all();
+        return true;
+    }
+
+    size_t TaskPool::GetPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending.size();
+    }
+
+    void TaskPool::WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_pending.empty() && m_running == 0; });
+    }
+
+    void TaskPool::WorkerLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_wake.wait(lock, [this] { return m_bStopping || !m_order.empty(); });
+            if (m_bStopping)
+                break;
+
+            std::map<Key, TaskId>::iterator first = m_order.begin();
+            std::map<TaskId, Pending>::iterator it = m_pending.find(first->second);
+            Task task = std::move(it->second.task);
+            m_order.erase(first);
+            m_pending.erase(it);
+            m_running++;
+            lock.unlock();
+
+            task();
+            task = Task();
+
+            lock.lock();
+            m_running--;
+            if (m_pending.empty() && m_running == 0)
+                m_idle.notify_all();
+        }
+        m_idle.notify_all();
+    }
+}
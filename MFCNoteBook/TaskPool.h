@@ -0,0 +1,86 @@
+﻿// TaskPool.h - 按优先级执行的后台任务线程池（不依赖MFC）
+//
+// 用于启动时并行载入会话中的文档：每个文档一个任务，优先级数值小的先执行，相同优先级按提交顺序。
+// 尚未开始的任务可以提高优先级（用户切换到还在等待的文档时让它插到队首）或取消。
+// 任务在线程池的线程中执行，结果由任务自己交回调用方（例如放入队列后通知界面线程）。
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// 线程数上限（磁盘读取和解码并行到几个线程后就不再变快）
+#define TASK_POOL_MAX_THREADS   4
+
+namespace TestableLogic
+{
+    typedef uint32_t TaskId;
+
+    class TaskPool
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        TaskPool();
+        ~TaskPool();
+
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator=(const TaskPool&) = delete;
+
+        // threadCount 为 0 时按处理器数，不超过 TASK_POOL_MAX_THREADS
+        void Start(size_t threadCount = 0);
+        // 丢弃尚未开始的任务，等待正在执行的任务结束
+        void Stop();
+        bool IsRunning() const { return !m_threads.empty(); }
+        size_t GetThreadCount() const { return m_threads.size(); }
+
+        // 提交任务，返回的标识用于提高优先级或取消
+        TaskId Post(int priority, Task task);
+        // 尚未开始的任务改用 priority（只会提前，不会推后）；已开始、已完成或不存在时返回 false
+        bool Promote(TaskId id, int priority);
+        // 取消尚未开始的任务
+        bool Cancel(TaskId id);
+
+        size_t GetPendingCount() const;
+        // 等待已提交的任务全部执行完
+        void WaitIdle();
+
+    private:
+        struct Key
+        {
+            int priority;
+            uint64_t sequence;
+
+            bool operator<(const Key& other) const
+            {
+                return priority != other.priority ? priority < other.priority : sequence < other.sequence;
+            }
+        };
+
+        struct Pending
+        {
+            Key key;
+            Task task;
+        };
+
+        void WorkerLoop();
+
+        std::vector<std::thread> m_threads;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_idle;
+        std::map<Key, TaskId> m_order;          // 执行顺序
+        std::map<TaskId, Pending> m_pending;
+        uint64_t m_sequence;
+        uint64_t m_frontSequence;
+        TaskId m_nextId;
+        size_t m_running;
+        bool m_bStopping;
+    };
+}
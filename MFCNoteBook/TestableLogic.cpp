@@ -1,53 +1,85 @@
 // TestableLogic.cpp - ɲ߼ʵ
-#include "pch.h"
 #include "TestableLogic.h"
-#include <wincrypt.h>
+#include "CryptoUtil.h"
+#include "TextCodec.h"
+#include "LineEnding.h"
+#include "ThemeRegistry.h"
 #include <algorithm>
 #include <cstring>
-
-#pragma comment(lib, "Crypt32.lib")
-#pragma comment(lib, "Advapi32.lib")
+#include <cwchar>
+#include <cwctype>
 
 namespace TestableLogic
 {
-    // ============ ʵ ============
-
-    TestableThemeColors GetThemeColors(TestableTheme theme)
+#ifndef _WIN32
+    namespace
     {
-        TestableThemeColors colors = {};
-
-        if (theme == TestableTheme::Dark)
+        // wchar_t Ϊ UTF-32 ƽ̨תΪ UTF-16 ٸ TextCodec㳬Χڴʱ滻Ϊ U+FFFD
+        std::u16string WideToUtf16(const wchar_t* src, size_t len)
         {
-            colors.clrEditBg = RGB(30, 30, 30);
-            colors.clrEditText = RGB(220, 220, 220);
-            colors.clrLineNumBg = RGB(45, 45, 45);
-            colors.clrLineNumText = RGB(140, 140, 140);
-            colors.clrLineNumBorder = RGB(60, 60, 60);
+            std::u16string result;
+            result.reserve(len);
+            for (size_t i = 0; i < len; i++)
+            {
+                uint32_t cp = static_cast<uint32_t>(src[i]);
+                if (cp >= 0x10000 && cp <= 0x10FFFF)
+                {
+                    cp -= 0x10000;
+                    result.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+                    result.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+                }
+                else if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+                {
+                    result.push_back(u'\xFFFD');
+                }
+                else
+                {
+                    result.push_back(static_cast<char16_t>(cp));
+                }
+            }
+            return result;
         }
-        else // Light
+
+        // TextCodec ǺϷ UTF-16滻ԺϲΪһ
+        std::wstring Utf16ToWide(const char16_t* src, size_t len)
         {
-            colors.clrEditBg = RGB(255, 255, 255);
-            colors.clrEditText = RGB(0, 0, 0);
-            colors.clrLineNumBg = RGB(240, 240, 240);
-            colors.clrLineNumText = RGB(128, 128, 128);
-            colors.clrLineNumBorder = RGB(200, 200, 200);
+            std::wstring result;
+            result.reserve(len);
+            for (size_t i = 0; i < len; i++)
+            {
+                uint32_t cp = src[i];
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < len && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+                    i++;
+                }
+                result.push_back(static_cast<wchar_t>(cp));
+            }
+            return result;
         }
+    }
+#endif
+
+    // ============ ʵ ============
 
+    TestableThemeColors GetThemeColors(TestableTheme theme)
+    {
+        // ɫӦù ThemeRegistry 
+        const ThemePalette& palette = GetBuiltInThemePalette(static_cast<size_t>(theme));
+
+        TestableThemeColors colors = {};
+        colors.clrEditBg = palette.editBg;
+        colors.clrEditText = palette.editText;
+        colors.clrLineNumBg = palette.lineNumBg;
+        colors.clrLineNumText = palette.lineNumText;
+        colors.clrLineNumBorder = palette.lineNumBorder;
         return colors;
     }
 
     bool ValidateThemeContrast(const TestableThemeColors& colors)
     {
-        // : Y = 0.299*R + 0.587*G + 0.114*B
-        auto getLuminance = [](COLORREF c) -> double {
-            return 0.299 * GetRValue(c) + 0.587 * GetGValue(c) + 0.114 * GetBValue(c);
-            };
-
-        double bgLum = getLuminance(colors.clrEditBg);
-        double textLum = getLuminance(colors.clrEditText);
-
-        // ԱȶҪ 50 Ĳֵ
-        return std::abs(bgLum - textLum) >= 50.0;
+        // WCAG Աȶȣ 4.5:1
+        return GetContrastRatio100(colors.clrEditText, colors.clrEditBg) >= THEME_MIN_TEXT_CONTRAST;
     }
 
     // ============ ļʽʵ ============
@@ -107,8 +139,8 @@ namespace TestableLogic
 
         // дѧţ̶20ֽڣ㲹0
         char sid[MYNOTE_STUDENTID_SIZE] = { 0 };
-        if (studentId)
-            strncpy_s(sid, studentId, _TRUNCATE);
+        for (int i = 0; studentId && i < MYNOTE_STUDENTID_SIZE - 1 && studentId[i]; i++)
+            sid[i] = studentId[i];
 
         for (int i = 0; i < MYNOTE_STUDENTID_SIZE; i++)
             header.push_back(sid[i]);
@@ -123,18 +155,21 @@ namespace TestableLogic
         if (utf8Str == nullptr)
             return L"";
 
-        int wideLen = MultiByteToWideChar(CP_UTF8, 0, utf8Str, len, nullptr, 0);
-        if (wideLen <= 0)
+        size_t srcLen = (len < 0) ? strlen(utf8Str) : static_cast<size_t>(len);
+        if (srcLen == 0)
             return L"";
 
-        std::wstring result(wideLen, L'\0');
-        MultiByteToWideChar(CP_UTF8, 0, utf8Str, len, &result[0], wideLen);
-
-        //  len == -1 null terminatorҪȥ
-        if (len == -1 && !result.empty() && result.back() == L'\0')
-            result.pop_back();
+#ifdef _WIN32
+        // У+ת룬ֱдǷ滻Ϊ U+FFFD
+        std::wstring result(Utf8ToUtf16MaxLength(srcLen), L'\0');
+        Utf8DecodeResult decoded = Utf8ToUtf16(utf8Str, srcLen, &result[0]);
+        result.resize(decoded.outputLength);
 
         return result;
+#else
+        std::u16string utf16 = Utf8ToUtf16String(utf8Str, srcLen);
+        return Utf16ToWide(utf16.data(), utf16.size());
+#endif
     }
 
     std::string UnicodeToUTF8(const wchar_t* unicodeStr, int len)
@@ -142,18 +177,20 @@ namespace TestableLogic
         if (unicodeStr == nullptr)
             return "";
 
-        int utf8Len = WideCharToMultiByte(CP_UTF8, 0, unicodeStr, len, nullptr, 0, nullptr, nullptr);
-        if (utf8Len <= 0)
+        size_t srcLen = (len < 0) ? wcslen(unicodeStr) : static_cast<size_t>(len);
+        if (srcLen == 0)
             return "";
 
-        std::string result(utf8Len, '\0');
-        WideCharToMultiByte(CP_UTF8, 0, unicodeStr, len, &result[0], utf8Len, nullptr, nullptr);
-
-        //  len == -1 null terminatorҪȥ
-        if (len == -1 && !result.empty() && result.back() == '\0')
-            result.pop_back();
+#ifdef _WIN32
+        // õȷȣһηֱӱ룬Ϊ U+FFFD
+        std::string result(Utf16ToUtf8Length(unicodeStr, srcLen), '\0');
+        Utf16ToUtf8(unicodeStr, srcLen, &result[0], result.size());
 
         return result;
+#else
+        std::u16string utf16 = WideToUtf16(unicodeStr, srcLen);
+        return Utf16ToUtf8String(utf16.data(), utf16.size());
+#endif
     }
 
     int DetectBOM(const BYTE* pData, size_t dataLen)
@@ -183,17 +220,19 @@ namespace TestableLogic
         if (pText == nullptr || *pText == L'\0')
             return 1;  // ı1
 
-        int count = 1;
-        const wchar_t* p = pText;
-
-        while (*p)
+#ifdef _WIN32
+        // CRLFLFCR һУSIMD ɨ裩
+        LineEndingStats stats = CountLineEndings(pText, wcslen(pText));
+        return 1 + static_cast<int>(GetLineBreakCount(stats));
+#else
+        int lines = 1;
+        for (const wchar_t* p = pText; *p; p++)
         {
-            if (*p == L'\n')
-                count++;
-            p++;
+            if (*p == L'\n' || (*p == L'\r' && p[1] != L'\n'))
+                lines++;
         }
-
-        return count;
+        return lines;
+#endif
     }
 
     int CalculateLineNumberWidth(int lineCount, int charWidth)
@@ -266,34 +305,9 @@ namespace TestableLogic
 
     bool ComputeSHA1(const BYTE* pData, DWORD dwDataLen, BYTE* pHash, DWORD dwHashLen)
     {
-        if (dwHashLen < 20)
-            return false;
-
-        HCRYPTPROV hProv = 0;
-        HCRYPTHASH hHash = 0;
-        bool bResult = false;
-
-        if (!CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
-            return false;
-
-        if (!CryptCreateHash(hProv, CALG_SHA1, 0, 0, &hHash))
-        {
-            CryptReleaseContext(hProv, 0);
+        if (dwHashLen < CRYPTO_SHA1_SIZE)
             return false;
-        }
-
-        if (CryptHashData(hHash, pData, dwDataLen, 0))
-        {
-            DWORD dwHashSize = 20;
-            if (CryptGetHashParam(hHash, HP_HASHVAL, pHash, &dwHashSize, 0))
-            {
-                bResult = true;
-            }
-        }
-
-        CryptDestroyHash(hHash);
-        CryptReleaseContext(hProv, 0);
-        return bResult;
+        return CryptoUtil::Sha1(pData, dwDataLen, pHash);
     }
 
     bool AESEncrypt(const BYTE* pPlainText, DWORD dwPlainLen,
@@ -301,50 +315,12 @@ namespace TestableLogic
         const BYTE* pIV,
         BYTE* pCipherText, DWORD& dwCipherLen)
     {
-        HCRYPTPROV hProv = 0;
-        HCRYPTHASH hHash = 0;
-        HCRYPTKEY hKey = 0;
-        bool bResult = false;
-
-        if (!CryptAcquireContext(&hProv, NULL, MS_ENH_RSA_AES_PROV, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
+        //  SHA-256  AES-128 ԿCBC ģʽPKCS#7 
+        size_t cipherLen = 0;
+        if (!CryptoUtil::AesEncrypt(pKey, dwKeyLen, pIV, pPlainText, dwPlainLen, pCipherText, cipherLen))
             return false;
-
-        if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash))
-        {
-            CryptReleaseContext(hProv, 0);
-            return false;
-        }
-
-        if (!CryptHashData(hHash, pKey, dwKeyLen, 0))
-        {
-            CryptDestroyHash(hHash);
-            CryptReleaseContext(hProv, 0);
-            return false;
-        }
-
-        if (!CryptDeriveKey(hProv, CALG_AES_128, hHash, 0, &hKey))
-        {
-            CryptDestroyHash(hHash);
-            CryptReleaseContext(hProv, 0);
-            return false;
-        }
-
-        DWORD dwMode = CRYPT_MODE_CBC;
-        CryptSetKeyParam(hKey, KP_MODE, (BYTE*)&dwMode, 0);
-        CryptSetKeyParam(hKey, KP_IV, (BYTE*)pIV, 0);
-
-        memcpy(pCipherText, pPlainText, dwPlainLen);
-        dwCipherLen = dwPlainLen;
-
-        if (CryptEncrypt(hKey, 0, TRUE, 0, pCipherText, &dwCipherLen, dwPlainLen + 16))
-        {
-            bResult = true;
-        }
-
-        CryptDestroyKey(hKey);
-        CryptDestroyHash(hHash);
-        CryptReleaseContext(hProv, 0);
-        return bResult;
+        dwCipherLen = static_cast<DWORD>(cipherLen);
+        return true;
     }
 
     bool AESDecrypt(const BYTE* pCipherText, DWORD dwCipherLen,
@@ -352,61 +328,16 @@ namespace TestableLogic
         const BYTE* pIV,
         BYTE* pPlainText, DWORD& dwPlainLen)
     {
-        HCRYPTPROV hProv = 0;
-        HCRYPTHASH hHash = 0;
-        HCRYPTKEY hKey = 0;
-        bool bResult = false;
-
-        if (!CryptAcquireContext(&hProv, NULL, MS_ENH_RSA_AES_PROV, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
-            return false;
-
-        if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash))
-        {
-            CryptReleaseContext(hProv, 0);
-            return false;
-        }
-
-        if (!CryptHashData(hHash, pKey, dwKeyLen, 0))
-        {
-            CryptDestroyHash(hHash);
-            CryptReleaseContext(hProv, 0);
-            return false;
-        }
-
-        if (!CryptDeriveKey(hProv, CALG_AES_128, hHash, 0, &hKey))
-        {
-            CryptDestroyHash(hHash);
-            CryptReleaseContext(hProv, 0);
+        size_t plainLen = 0;
+        if (!CryptoUtil::AesDecrypt(pKey, dwKeyLen, pIV, pCipherText, dwCipherLen, pPlainText, plainLen))
             return false;
-        }
-
-        DWORD dwMode = CRYPT_MODE_CBC;
-        CryptSetKeyParam(hKey, KP_MODE, (BYTE*)&dwMode, 0);
-        CryptSetKeyParam(hKey, KP_IV, (BYTE*)pIV, 0);
-
-        memcpy(pPlainText, pCipherText, dwCipherLen);
-        dwPlainLen = dwCipherLen;
-
-        if (CryptDecrypt(hKey, 0, TRUE, 0, pPlainText, &dwPlainLen))
-        {
-            bResult = true;
-        }
-
-        CryptDestroyKey(hKey);
-        CryptDestroyHash(hHash);
-        CryptReleaseContext(hProv, 0);
-        return bResult;
+        dwPlainLen = static_cast<DWORD>(plainLen);
+        return true;
     }
 
     bool GenerateRandomIV(BYTE* pIV, DWORD dwLen)
     {
-        HCRYPTPROV hProv = 0;
-        if (!CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
-            return false;
-
-        BOOL bResult = CryptGenRandom(hProv, dwLen, pIV);
-        CryptReleaseContext(hProv, 0);
-        return bResult != FALSE;
+        return CryptoUtil::Random(pIV, dwLen);
     }
 
     bool VerifyIntegrity(const BYTE* pHash1, const BYTE* pHash2, size_t hashLen)
@@ -1,7 +1,10 @@
 // TestableLogic.h - ɲԵĺ߼MFC
+//
+// ֻ PlatformTypes.h Ļͺ CryptoUtil ļܺWindows ƽ̨ͬһݴ롣
+// ַӿڵ wchar_t  Windows Ϊ UTF-16ƽ̨Ϊ UTF-32
 #pragma once
 
-#include <windows.h>
+#include "PlatformTypes.h"
 #include <string>
 #include <vector>
 
@@ -44,7 +47,7 @@ namespace TestableLogic
     // ȡɫ
     TestableThemeColors GetThemeColors(TestableTheme theme);
 
-    // ֤ɫǷЧԱȶȣ
+    // ֤༭뱳 WCAG ԱȶǷﵽ THEME_MIN_TEXT_CONTRAST
     bool ValidateThemeContrast(const TestableThemeColors& colors);
 
     // -------- ļʽ --------
@@ -71,7 +74,7 @@ namespace TestableLogic
     int DetectBOM(const BYTE* pData, size_t dataLen);
 
     // -------- кż --------
-    // ı
+    // ıCRLFLFCR ΪУ
     int CountLines(const wchar_t* pText);
 
     // кҪĿȣأ
@@ -0,0 +1,654 @@
+﻿// TextBuffer.cpp - 片段表文本缓冲区实现
+#include "TextBuffer.h"
+#include "SimdSupport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <utility>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        // 稀疏索引扫描时每次计数的块大小
+        const size_t INDEX_SCAN_BLOCK = 4096;
+
+        size_t CountNewlinesScalar(const char* p, size_t len)
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < len; i++)
+                count += (p[i] == '\n') ? 1 : 0;
+            return count;
+        }
+
+#if SIMD_X86
+        // 8 位通道累加，每 255 个块用 SAD 归约一次
+        size_t CountNewlinesSSE2(const char* p, size_t len)
+        {
+            const __m128i lf = _mm_set1_epi8('\n');
+            const __m128i zero = _mm_setzero_si128();
+            size_t count = 0;
+            size_t i = 0;
+            while (len - i >= 16)
+            {
+                __m128i acc = _mm_setzero_si128();
+                for (int n = 0; n < 255 && len - i >= 16; n++, i += 16)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                    acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, lf));
+                }
+                __m128i sum = _mm_sad_epu8(acc, zero);
+                count += static_cast<size_t>(_mm_cvtsi128_si32(sum)) +
+                    static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+            }
+            return count + CountNewlinesScalar(p + i, len - i);
+        }
+
+        SIMD_TARGET_AVX2 size_t CountNewlinesAVX2(const char* p, size_t len)
+        {
+            const __m256i lf = _mm256_set1_epi8('\n');
+            const __m256i zero = _mm256_setzero_si256();
+            size_t count = 0;
+            size_t i = 0;
+            while (len - i >= 32)
+            {
+                __m256i acc = _mm256_setzero_si256();
+                for (int n = 0; n < 255 && len - i >= 32; n++, i += 32)
+                {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                    acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, lf));
+                }
+                __m256i sum = _mm256_sad_epu8(acc, zero);
+                __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+                count += static_cast<size_t>(_mm_cvtsi128_si32(half)) +
+                    static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+            }
+            return count + CountNewlinesScalar(p + i, len - i);
+        }
+#endif
+
+        // 从 p 开始的第 n 个 LF（从 0 开始），调用方保证存在
+        const char* FindNthNewline(const char* p, const char* end, size_t n)
+        {
+            for (;;)
+            {
+                const char* lf = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+                if (!lf || n == 0)
+                    return lf;
+                n--;
+                p = lf + 1;
+            }
+        }
+
+        inline size_t Utf8SequenceLength(unsigned char lead)
+        {
+            if (lead < 0xC0)
+                return 1;
+            if (lead < 0xE0)
+                return 2;
+            if (lead < 0xF0)
+                return 3;
+            return 4;
+        }
+    }
+
+    size_t CountNewlines(const char* data, size_t len)
+    {
+        if (!data || len == 0)
+            return 0;
+#if SIMD_X86
+        SimdLevel level = GetSimdLevel();
+        if (level == SimdLevel::AVX2)
+            return CountNewlinesAVX2(data, len);
+        if (level != SimdLevel::Scalar)
+            return CountNewlinesSSE2(data, len);
+#endif
+        return CountNewlinesScalar(data, len);
+    }
+
+    size_t GetLongestLineLength(const char* data, size_t len)
+    {
+        size_t longest = 0;
+        const char* p = data;
+        const char* end = data + len;
+        while (p < end)
+        {
+            const char* lf = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+            const char* lineEnd = lf ? lf : end;
+            longest = (std::max)(longest, static_cast<size_t>(lineEnd - p));
+            p = lineEnd + 1;
+        }
+        return longest;
+    }
+
+    // ============ SparseLineIndex ============
+
+    SparseLineIndex::SparseLineIndex()
+    {
+        Clear();
+    }
+
+    void SparseLineIndex::Clear()
+    {
+        m_checkpoints.assign(1, Checkpoint{ 0, 0 });
+        m_total = 0;
+        m_scanned = 0;
+    }
+
+    void SparseLineIndex::Extend(const char* data, size_t len)
+    {
+        size_t pos = m_scanned;
+        while (pos < len)
+        {
+            const Checkpoint last = m_checkpoints.back();
+            size_t byteLimit = last.offset + TEXTBUFFER_INDEX_BYTE_STRIDE;
+            size_t blockEnd = (std::min)((std::min)(len, byteLimit), pos + INDEX_SCAN_BLOCK);
+            size_t count = CountNewlines(data + pos, blockEnd - pos);
+            size_t sinceLast = m_total - last.lines;
+
+            if (sinceLast + count >= TEXTBUFFER_INDEX_LINE_STRIDE)
+            {
+                // 本块内凑满一个行步长：检查点放在那个 LF 之后
+                size_t need = TEXTBUFFER_INDEX_LINE_STRIDE - sinceLast;
+                const char* lf = FindNthNewline(data + pos, data + blockEnd, need - 1);
+                pos = static_cast<size_t>(lf - data) + 1;
+                m_total += need;
+                m_checkpoints.push_back(Checkpoint{ pos, m_total });
+                continue;
+            }
+
+            m_total += count;
+            pos = blockEnd;
+            if (pos == byteLimit)
+                m_checkpoints.push_back(Checkpoint{ pos, m_total });
+        }
+        m_scanned = (std::max)(m_scanned, len);
+    }
+
+    void SparseLineIndex::Append(const SparseLineIndex& chunk)
+    {
+        // 检查点平移到当前末尾；与末尾重合的起点检查点已经存在
+        size_t baseOffset = m_scanned;
+        size_t baseLines = m_total;
+        for (const Checkpoint& cp : chunk.m_checkpoints)
+        {
+            Checkpoint shifted = { baseOffset + cp.offset, baseLines + cp.lines };
+            if (shifted.offset > m_checkpoints.back().offset)
+                m_checkpoints.push_back(shifted);
+        }
+        m_total += chunk.m_total;
+        m_scanned += chunk.m_scanned;
+    }
+
+    size_t SparseLineIndex::CountBefore(const char* data, size_t pos) const
+    {
+        // 最后一个 offset <= pos 的检查点
+        auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), pos,
+            [](size_t value, const Checkpoint& cp) { return value < cp.offset; });
+        const Checkpoint& cp = *(it - 1);
+        return cp.lines + CountNewlines(data + cp.offset, pos - cp.offset);
+    }
+
+    size_t SparseLineIndex::FindNth(const char* data, size_t n) const
+    {
+        // 最后一个 lines <= n 的检查点，第 n 个 LF 一定在它之后
+        auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), n,
+            [](size_t value, const Checkpoint& cp) { return value < cp.lines; });
+        const Checkpoint& cp = *(it - 1);
+        const char* lf = FindNthNewline(data + cp.offset, data + m_scanned, n - cp.lines);
+        return lf ? static_cast<size_t>(lf - data) : m_scanned;
+    }
+
+    // ============ TextBuffer ============
+
+    TextBuffer::TextBuffer()
+        : m_pOriginal(nullptr)
+        , m_nOriginalLength(0)
+        , m_length(0)
+        , m_lineBreaks(0)
+        , m_cachedLine(0)
+        , m_cachedLineStart(0)
+    {
+        RebuildPrefix();
+    }
+
+    void TextBuffer::Clear()
+    {
+        m_pOriginal = nullptr;
+        m_nOriginalLength = 0;
+        m_ownedOriginal.clear();
+        m_add.clear();
+        m_originalIndex.Clear();
+        m_addIndex.Clear();
+        m_pieces.clear();
+        RebuildPrefix();
+    }
+
+    void TextBuffer::AttachOriginal(const char* data, size_t len)
+    {
+        Clear();
+        m_pOriginal = data;
+        m_nOriginalLength = data ? len : 0;
+        m_originalIndex.Extend(m_pOriginal, m_nOriginalLength);
+        if (m_nOriginalLength > 0)
+            m_pieces.push_back(MakePiece(false, 0, m_nOriginalLength));
+        RebuildPrefix();
+    }
+
+    void TextBuffer::SetText(const char* data, size_t len)
+    {
+        std::string owned(data ? data : "", data ? len : 0);
+        Clear();
+        m_ownedOriginal.swap(owned);
+        m_pOriginal = m_ownedOriginal.data();
+        m_nOriginalLength = m_ownedOriginal.size();
+        m_originalIndex.Extend(m_pOriginal, m_nOriginalLength);
+        if (m_nOriginalLength > 0)
+            m_pieces.push_back(MakePiece(false, 0, m_nOriginalLength));
+        RebuildPrefix();
+    }
+
+    const SparseLineIndex& TextBuffer::GetIndex(bool bAdd) const
+    {
+        return bAdd ? m_addIndex : m_originalIndex;
+    }
+
+    const char* TextBuffer::GetPieceData(const Piece& piece) const
+    {
+        return (piece.bAdd ? m_add.data() : m_pOriginal) + piece.start;
+    }
+
+    size_t TextBuffer::CountLineBreaks(bool bAdd, size_t start, size_t len) const
+    {
+        const char* data = bAdd ? m_add.data() : m_pOriginal;
+        const SparseLineIndex& index = GetIndex(bAdd);
+        return index.CountBefore(data, start + len) - index.CountBefore(data, start);
+    }
+
+    TextBuffer::Piece TextBuffer::MakePiece(bool bAdd, size_t start, size_t len) const
+    {
+        Piece piece;
+        piece.bAdd = bAdd;
+        piece.start = start;
+        piece.length = len;
+        piece.lineBreaks = CountLineBreaks(bAdd, start, len);
+        return piece;
+    }
+
+    void TextBuffer::RebuildPrefix()
+    {
+        m_pieceOffsets.resize(m_pieces.size());
+        m_pieceLines.resize(m_pieces.size());
+        size_t offset = 0;
+        size_t lines = 0;
+        for (size_t i = 0; i < m_pieces.size(); i++)
+        {
+            m_pieceOffsets[i] = offset;
+            m_pieceLines[i] = lines;
+            offset += m_pieces[i].length;
+            lines += m_pieces[i].lineBreaks;
+        }
+        m_length = offset;
+        m_lineBreaks = lines;
+        m_cachedLine = 0;
+        m_cachedLineStart = 0;
+    }
+
+    size_t TextBuffer::FindPiece(size_t offset) const
+    {
+        if (offset >= m_length)
+            return m_pieces.size();
+        auto it = std::upper_bound(m_pieceOffsets.begin(), m_pieceOffsets.end(), offset);
+        return static_cast<size_t>(it - m_pieceOffsets.begin()) - 1;
+    }
+
+    size_t TextBuffer::GetLineStart(size_t line) const
+    {
+        if (line == 0)
+            return 0;
+        size_t n = line - 1;        // 第 n 个 LF 之后即为行首
+        if (n >= m_lineBreaks)
+            return m_length;
+
+        // 绘制时按顺序取相邻的行：从上一行的行首向后找一个 LF 即可
+        if (line == m_cachedLine)
+            return m_cachedLineStart;
+        if (line == m_cachedLine + 1)
+        {
+            m_cachedLineStart = FindNextLineFeed(m_cachedLineStart) + 1;
+            m_cachedLine = line;
+            return m_cachedLineStart;
+        }
+
+        // 第一个之前换行数大于 n 的片段的前一个片段包含第 n 个 LF
+        auto it = std::upper_bound(m_pieceLines.begin(), m_pieceLines.end(), n);
+        size_t i = static_cast<size_t>(it - m_pieceLines.begin()) - 1;
+        const Piece& piece = m_pieces[i];
+        const char* data = piece.bAdd ? m_add.data() : m_pOriginal;
+        const SparseLineIndex& index = GetIndex(piece.bAdd);
+
+        size_t nth = index.CountBefore(data, piece.start) + (n - m_pieceLines[i]);
+        size_t lf = index.FindNth(data, nth);
+        m_cachedLine = line;
+        m_cachedLineStart = m_pieceOffsets[i] + (lf - piece.start) + 1;
+        return m_cachedLineStart;
+    }
+
+    size_t TextBuffer::GetLineEnd(size_t line) const
+    {
+        if (line >= m_lineBreaks)
+            return m_length;
+        size_t start = GetLineStart(line);
+        size_t end = FindNextLineFeed(start);
+        if (end > start && GetByteAt(end - 1) == '\r')
+            end--;
+        return end;
+    }
+
+    size_t TextBuffer::FindNextLineFeed(size_t offset) const
+    {
+        // 行通常很短，从行首直接向后查找比再查一次稀疏索引快
+        for (size_t i = FindPiece(offset); i < m_pieces.size(); i++)
+        {
+            const Piece& piece = m_pieces[i];
+            size_t skip = (offset > m_pieceOffsets[i]) ? offset - m_pieceOffsets[i] : 0;
+            const char* data = GetPieceData(piece);
+            const void* pLf = memchr(data + skip, '\n', piece.length - skip);
+            if (pLf)
+                return m_pieceOffsets[i] + static_cast<size_t>(static_cast<const char*>(pLf) - data);
+        }
+        return m_length;
+    }
+
+    size_t TextBuffer::GetLineFromOffset(size_t offset) const
+    {
+        size_t i = FindPiece(offset);
+        if (i >= m_pieces.size())
+            return m_lineBreaks;
+        const Piece& piece = m_pieces[i];
+        return m_pieceLines[i] + CountLineBreaks(piece.bAdd, piece.start, offset - m_pieceOffsets[i]);
+    }
+
+    unsigned char TextBuffer::GetByteAt(size_t offset) const
+    {
+        size_t i = FindPiece(offset);
+        if (i >= m_pieces.size())
+            return 0;
+        return static_cast<unsigned char>(GetPieceData(m_pieces[i])[offset - m_pieceOffsets[i]]);
+    }
+
+    std::string TextBuffer::GetText(size_t start, size_t end) const
+    {
+        end = (std::min)(end, m_length);
+        std::string text;
+        if (start >= end)
+            return text;
+
+        text.reserve(end - start);
+        for (size_t i = FindPiece(start); i < m_pieces.size() && m_pieceOffsets[i] < end; i++)
+        {
+            const Piece& piece = m_pieces[i];
+            size_t from = (std::max)(start, m_pieceOffsets[i]) - m_pieceOffsets[i];
+            size_t to = (std::min)(end, m_pieceOffsets[i] + piece.length) - m_pieceOffsets[i];
+            text.append(GetPieceData(piece) + from, to - from);
+        }
+        return text;
+    }
+
+    bool TextBuffer::Find(const std::string& pattern, size_t from, bool bMatchCase, size_t& found) const
+    {
+        if (pattern.empty() || pattern.size() > m_length)
+            return false;
+
+        // 按窗口取出文本，不把整篇复制出来；窗口之间重叠，跨窗口的匹配不会漏掉
+        auto foldEqual = [](char a, char b)
+        {
+            unsigned char ua = static_cast<unsigned char>(a);
+            unsigned char ub = static_cast<unsigned char>(b);
+            if (ua >= 'A' && ua <= 'Z')
+                ua = static_cast<unsigned char>(ua + ('a' - 'A'));
+            if (ub >= 'A' && ub <= 'Z')
+                ub = static_cast<unsigned char>(ub + ('a' - 'A'));
+            return ua == ub;
+        };
+        for (size_t pos = from; pos + pattern.size() <= m_length; pos += TEXTBUFFER_SEARCH_WINDOW)
+        {
+            std::string window = GetText(pos, pos + TEXTBUFFER_SEARCH_WINDOW + pattern.size() - 1);
+            std::string::const_iterator it = bMatchCase ?
+                std::search(window.begin(), window.end(), pattern.begin(), pattern.end()) :
+                std::search(window.begin(), window.end(), pattern.begin(), pattern.end(), foldEqual);
+            if (it != window.end())
+            {
+                found = pos + static_cast<size_t>(it - window.begin());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t TextBuffer::PrevCharBoundary(size_t offset) const
+    {
+        if (offset == 0)
+            return 0;
+        offset = (std::min)(offset, m_length);
+        size_t pos = offset - 1;
+        if (GetByteAt(pos) == '\n' && pos > 0 && GetByteAt(pos - 1) == '\r')
+            return pos - 1;
+        // 跳过至多 3 个续字节
+        for (int i = 0; i < 3 && pos > 0 && (GetByteAt(pos) & 0xC0) == 0x80; i++)
+            pos--;
+        return pos;
+    }
+
+    size_t TextBuffer::NextCharBoundary(size_t offset) const
+    {
+        if (offset >= m_length)
+            return m_length;
+        unsigned char lead = GetByteAt(offset);
+        if (lead == '\r' && offset + 1 < m_length && GetByteAt(offset + 1) == '\n')
+            return offset + 2;
+
+        size_t len = Utf8SequenceLength(lead);
+        size_t pos = offset + 1;
+        // 只跳过确实是续字节的部分，非法序列逐字节前进
+        while (pos < offset + len && pos < m_length && (GetByteAt(pos) & 0xC0) == 0x80)
+            pos++;
+        return pos;
+    }
+
+    // ============ 编辑 ============
+
+    void TextBuffer::Insert(size_t offset, const char* data, size_t len)
+    {
+        InsertIndexed(offset, data, len, nullptr);
+    }
+
+    void TextBuffer::Insert(size_t offset, const char* data, size_t len, const SparseLineIndex& index)
+    {
+        InsertIndexed(offset, data, len, index.GetScanned() == len ? &index : nullptr);
+    }
+
+    void TextBuffer::InsertIndexed(size_t offset, const char* data, size_t len, const SparseLineIndex* pIndex)
+    {
+        if (!data || len == 0)
+            return;
+        offset = (std::min)(offset, m_length);
+
+        size_t addStart = m_add.size();
+        m_add.append(data, len);
+        if (pIndex)
+            m_addIndex.Append(*pIndex);
+        else
+            m_addIndex.Extend(m_add.data(), m_add.size());
+
+        // 连续输入：紧接在上一次追加的片段之后时直接延长该片段
+        if (offset > 0)
+        {
+            size_t prev = FindPiece(offset - 1);
+            Piece& piece = m_pieces[prev];
+            if (piece.bAdd && piece.start + piece.length == addStart &&
+                m_pieceOffsets[prev] + piece.length == offset)
+            {
+                piece.length += len;
+                piece.lineBreaks += CountLineBreaks(true, addStart, len);
+                RebuildPrefix();
+                return;
+            }
+        }
+
+        Piece inserted = MakePiece(true, addStart, len);
+        size_t i = FindPiece(offset);
+        if (i >= m_pieces.size())
+        {
+            m_pieces.push_back(inserted);
+        }
+        else if (offset == m_pieceOffsets[i])
+        {
+            m_pieces.insert(m_pieces.begin() + i, inserted);
+        }
+        else
+        {
+            // 拆分片段：左半部分、新内容、右半部分
+            Piece piece = m_pieces[i];
+            size_t split = offset - m_pieceOffsets[i];
+            Piece left = MakePiece(piece.bAdd, piece.start, split);
+            Piece right = { piece.bAdd, piece.start + split, piece.length - split, piece.lineBreaks - left.lineBreaks };
+            m_pieces[i] = left;
+            Piece tail[2] = { inserted, right };
+            m_pieces.insert(m_pieces.begin() + i + 1, tail, tail + 2);
+        }
+        RebuildPrefix();
+    }
+
+    void TextBuffer::Erase(size_t offset, size_t len)
+    {
+        if (offset >= m_length || len == 0)
+            return;
+        size_t end = (std::min)(offset + len, m_length);
+
+        PieceList pieces;
+        pieces.reserve(m_pieces.size() + 1);
+        for (size_t i = 0; i < m_pieces.size(); i++)
+        {
+            const Piece& piece = m_pieces[i];
+            size_t pieceStart = m_pieceOffsets[i];
+            size_t pieceEnd = pieceStart + piece.length;
+            if (pieceEnd <= offset || pieceStart >= end)
+            {
+                pieces.push_back(piece);
+                continue;
+            }
+            if (pieceStart < offset)
+                pieces.push_back(MakePiece(piece.bAdd, piece.start, offset - pieceStart));
+            if (pieceEnd > end)
+                pieces.push_back(MakePiece(piece.bAdd, piece.start + (end - pieceStart), pieceEnd - end));
+        }
+        m_pieces.swap(pieces);
+        RebuildPrefix();
+    }
+
+    void TextBuffer::RestorePieces(const PieceList& pieces)
+    {
+        m_pieces = pieces;
+        RebuildPrefix();
+    }
+
+    // ============ 保存后重新绑定 ============
+
+    void TextBuffer::RebasePieces(const std::vector<PieceList*>& lists)
+    {
+        // 当前文档引用的原始内容区间（编辑只会拆分和截短片段，区间互不重叠）及其在新原始内容中的位置
+        struct Span
+        {
+            size_t start;
+            size_t length;
+            size_t target;
+        };
+        std::vector<Span> spans;
+        for (size_t i = 0; i < m_pieces.size(); i++)
+        {
+            if (!m_pieces[i].bAdd)
+                spans.push_back({ m_pieces[i].start, m_pieces[i].length, m_pieceOffsets[i] });
+        }
+        std::sort(spans.begin(), spans.end(),
+            [](const Span& a, const Span& b) { return a.start < b.start; });
+
+        // 同一段被删掉的内容可能出现在多个快照中，只复制一次
+        std::map<std::pair<size_t, size_t>, size_t> copied;
+        auto copyToAdd = [&](size_t start, size_t len)
+        {
+            auto it = copied.find(std::make_pair(start, len));
+            if (it != copied.end())
+                return MakePiece(true, it->second, len);
+
+            size_t addStart = m_add.size();
+            m_add.append(m_pOriginal + start, len);
+            m_addIndex.Extend(m_add.data(), m_add.size());
+            copied[std::make_pair(start, len)] = addStart;
+            return MakePiece(true, addStart, len);
+        };
+
+        for (PieceList* pList : lists)
+        {
+            PieceList rebased;
+            rebased.reserve(pList->size());
+            for (const Piece& piece : *pList)
+            {
+                if (piece.bAdd)
+                {
+                    rebased.push_back(piece);
+                    continue;
+                }
+
+                // 逐段拆分：落在当前文档中的部分指向新原始内容，其余复制出来
+                size_t pos = piece.start;
+                size_t end = piece.start + piece.length;
+                auto it = std::upper_bound(spans.begin(), spans.end(), pos,
+                    [](size_t value, const Span& span) { return value < span.start; });
+                if (it != spans.begin() && (it - 1)->start + (it - 1)->length > pos)
+                    --it;
+                while (pos < end)
+                {
+                    if (it == spans.end() || it->start >= end)
+                    {
+                        rebased.push_back(copyToAdd(pos, end - pos));
+                        break;
+                    }
+                    if (it->start > pos)
+                    {
+                        rebased.push_back(copyToAdd(pos, it->start - pos));
+                        pos = it->start;
+                    }
+                    size_t spanEnd = (std::min)(end, it->start + it->length);
+                    Piece mapped;
+                    mapped.bAdd = false;
+                    mapped.start = it->target + (pos - it->start);
+                    mapped.length = spanEnd - pos;
+                    mapped.lineBreaks = CountLineBreaks(false, pos, spanEnd - pos);
+                    rebased.push_back(mapped);
+                    pos = spanEnd;
+                    ++it;
+                }
+            }
+            pList->swap(rebased);
+        }
+    }
+
+    bool TextBuffer::ReplaceOriginal(const char* data, size_t len)
+    {
+        if (len != m_length)
+            return false;
+
+        m_pOriginal = data;
+        m_nOriginalLength = data ? len : 0;
+        m_ownedOriginal.clear();
+        m_originalIndex.Clear();
+        m_originalIndex.Extend(m_pOriginal, m_nOriginalLength);
+        m_pieces.clear();
+        if (m_nOriginalLength > 0)
+            m_pieces.push_back(MakePiece(false, 0, m_nOriginalLength));
+        RebuildPrefix();
+        return true;
+    }
+}
@@ -0,0 +1,163 @@
+﻿// TextBuffer.h - 片段表文本缓冲区（UTF-8，不依赖MFC）
+//
+// 原始内容可以直接引用内存映射的文件（只读、不复制），编辑内容只追加到添加缓冲区，
+// 文档由按顺序排列的片段描述。旧的片段列表始终有效，撤销只需恢复片段列表。
+// 换行位置只保留稀疏索引（每 1024 个换行或每 1 MB 记一个检查点），
+// 1 GB 的文件额外只占几百 KB；行号以 LF 为准，CRLF 中的 CR 视为行尾的一部分。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============ 稀疏行索引参数 ============
+#define TEXTBUFFER_INDEX_LINE_STRIDE    1024
+#define TEXTBUFFER_INDEX_BYTE_STRIDE    (1024 * 1024)
+
+// 查找时每次取出的字节数（相邻两段重叠 模式长度-1 字节）
+#define TEXTBUFFER_SEARCH_WINDOW        (1024 * 1024)
+
+namespace TestableLogic
+{
+    // 统计 LF 个数（SSE2/AVX2）
+    size_t CountNewlines(const char* data, size_t len);
+
+    // 最长一行的字节数（不含 LF），用于发现需要按超长行处理的文件
+    size_t GetLongestLineLength(const char* data, size_t len);
+
+    // 一块只增不减的字节区中 LF 的稀疏索引；数据指针由调用方传入（添加缓冲区可能重新分配）
+    class SparseLineIndex
+    {
+    public:
+        SparseLineIndex();
+
+        void Clear();
+
+        // 扫描新追加的 data[已扫描长度, len)
+        void Extend(const char* data, size_t len);
+
+        // 追加一段已单独建立索引的数据（chunk 的偏移相对这段数据开头），之前的数据必须已全部扫描
+        void Append(const SparseLineIndex& chunk);
+
+        size_t GetTotal() const { return m_total; }
+        size_t GetScanned() const { return m_scanned; }
+
+        // [0, pos) 中的 LF 个数
+        size_t CountBefore(const char* data, size_t pos) const;
+
+        // 第 n 个 LF（从 0 开始）的偏移，n 必须小于 GetTotal()
+        size_t FindNth(const char* data, size_t n) const;
+
+    private:
+        struct Checkpoint
+        {
+            size_t offset;
+            size_t lines;       // [0, offset) 中的 LF 个数
+        };
+
+        std::vector<Checkpoint> m_checkpoints;
+        size_t m_total;
+        size_t m_scanned;
+    };
+
+    class TextBuffer
+    {
+    public:
+        struct Piece
+        {
+            bool bAdd;          // true：添加缓冲区；false：原始内容
+            size_t start;
+            size_t length;
+            size_t lineBreaks;  // 片段内的 LF 个数
+        };
+        typedef std::vector<Piece> PieceList;
+
+        TextBuffer();
+
+        // 直接引用外部内存（如内存映射文件），不复制；调用方保证其在下一次 Attach/SetText/Clear 之前有效
+        void AttachOriginal(const char* data, size_t len);
+
+        // 复制一份作为原始内容
+        void SetText(const char* data, size_t len);
+
+        void Clear();
+
+        size_t GetLength() const { return m_length; }
+        size_t GetLineCount() const { return m_lineBreaks + 1; }
+
+        // 行首偏移；行号超出范围时返回文档长度
+        size_t GetLineStart(size_t line) const;
+
+        // 行尾偏移（不含 LF/CRLF）
+        size_t GetLineEnd(size_t line) const;
+
+        size_t GetLineFromOffset(size_t offset) const;
+
+        unsigned char GetByteAt(size_t offset) const;
+
+        std::string GetText(size_t start, size_t end) const;
+
+        // 从 from 开始查找字节串，找到时 found 为起始偏移；不区分大小写时只折叠 ASCII 字母
+        bool Find(const std::string& pattern, size_t from, bool bMatchCase, size_t& found) const;
+
+        // 相邻字符边界：按 UTF-8 首字节跳过整个码点，CRLF 作为一个整体
+        size_t PrevCharBoundary(size_t offset) const;
+        size_t NextCharBoundary(size_t offset) const;
+
+        // ============ 编辑 ============
+
+        void Insert(size_t offset, const char* data, size_t len);
+        // 同上，换行索引已由调用方建立（如在后台线程），不再扫描 data
+        void Insert(size_t offset, const char* data, size_t len, const SparseLineIndex& index);
+        void Erase(size_t offset, size_t len);
+
+        // 片段列表即文档的完整快照（添加缓冲区只追加，旧片段不会失效）
+        const PieceList& GetPieces() const { return m_pieces; }
+        void RestorePieces(const PieceList& pieces);
+
+        const char* GetPieceData(const Piece& piece) const;
+
+        size_t GetAddBufferSize() const { return m_add.size(); }
+
+        // ============ 保存后重新绑定 ============
+
+        // 原始内容即将换成与当前文档逐字节相同的新内容（如保存后重新映射的文件）时，
+        // 在旧内容仍有效时把要保留的片段列表（撤销快照）改写为以新原始内容为准；
+        // 旧原始内容中当前文档已删掉、只有快照还引用的部分复制到添加缓冲区
+        void RebasePieces(const std::vector<PieceList*>& lists);
+
+        // 换上新的原始内容，文档变为一整段原始片段；添加缓冲区保留。长度与当前文档不同时返回 false
+        bool ReplaceOriginal(const char* data, size_t len);
+
+    private:
+        // 返回包含 offset 的片段下标（offset 等于文档长度时返回片段数）
+        size_t FindPiece(size_t offset) const;
+        // pIndex 为空时扫描追加的数据建立换行索引
+        void InsertIndexed(size_t offset, const char* data, size_t len, const SparseLineIndex* pIndex);
+        void RebuildPrefix();
+        // offset 之后第一个 LF 的位置，没有时返回文档长度
+        size_t FindNextLineFeed(size_t offset) const;
+
+        const SparseLineIndex& GetIndex(bool bAdd) const;
+        size_t CountLineBreaks(bool bAdd, size_t start, size_t len) const;
+        Piece MakePiece(bool bAdd, size_t start, size_t len) const;
+
+        const char* m_pOriginal;
+        size_t m_nOriginalLength;
+        std::string m_ownedOriginal;
+        std::string m_add;
+        SparseLineIndex m_originalIndex;
+        SparseLineIndex m_addIndex;
+
+        PieceList m_pieces;
+        std::vector<size_t> m_pieceOffsets;     // 各片段起始偏移（前缀和），用于二分查找
+        std::vector<size_t> m_pieceLines;       // 各片段之前的 LF 总数
+        size_t m_length;
+        size_t m_lineBreaks;
+
+        // 最近一次查询的行首，顺序访问相邻行时不必再查稀疏索引
+        mutable size_t m_cachedLine;
+        mutable size_t m_cachedLineStart;
+    };
+}
@@ -0,0 +1,1167 @@
+﻿// TextCodec.cpp - UTF-8/UTF-16 转码实现
+#include "TextCodec.h"
+#include "SimdSupport.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        // ============ 标量辅助 ============
+
+        const uint64_t ASCII_MASK_64 = 0x8080808080808080ULL;
+
+        struct ErrorSink
+        {
+            Utf8DecodeResult* pResult;
+            std::vector<size_t>* pOffsets;
+
+            void Record(size_t offset)
+            {
+                if (pResult->invalidCount == 0)
+                    pResult->firstErrorOffset = offset;
+                pResult->invalidCount++;
+                if (pOffsets)
+                    pOffsets->push_back(offset);
+            }
+        };
+
+        // 检查 p 处的一个序列，返回消耗的字节数；非法时 bError 为 true，
+        // 消耗的是最大合法前缀（至少 1 字节），与 Unicode 推荐的替换规则一致
+        inline size_t CheckOne(const uint8_t* p, const uint8_t* end, uint32_t& cp, bool& bError)
+        {
+            uint32_t b0 = p[0];
+            if (b0 < 0x80)
+            {
+                cp = b0;
+                bError = false;
+                return 1;
+            }
+
+            size_t need;
+            uint8_t lo = 0x80, hi = 0xBF;
+            if (b0 >= 0xC2 && b0 <= 0xDF)
+            {
+                need = 1;
+                cp = b0 & 0x1F;
+            }
+            else if (b0 >= 0xE0 && b0 <= 0xEF)
+            {
+                need = 2;
+                cp = b0 & 0x0F;
+                if (b0 == 0xE0)
+                    lo = 0xA0;      // 超长编码
+                else if (b0 == 0xED)
+                    hi = 0x9F;      // 代理区
+            }
+            else if (b0 >= 0xF0 && b0 <= 0xF4)
+            {
+                need = 3;
+                cp = b0 & 0x07;
+                if (b0 == 0xF0)
+                    lo = 0x90;      // 超长编码
+                else if (b0 == 0xF4)
+                    hi = 0x8F;      // 超过 U+10FFFF
+            }
+            else
+            {
+                bError = true;
+                return 1;
+            }
+
+            size_t i = 1;
+            for (; i <= need; i++)
+            {
+                if (p + i >= end || p[i] < lo || p[i] > hi)
+                {
+                    bError = true;
+                    return i;
+                }
+                lo = 0x80;
+                hi = 0xBF;
+                cp = (cp << 6) | (p[i] & 0x3F);
+            }
+            bError = false;
+            return i;
+        }
+
+        inline void PutCodePoint(uint32_t cp, char16_t*& out)
+        {
+            if (cp >= 0x10000)
+            {
+                cp -= 0x10000;
+                *out++ = static_cast<char16_t>(0xD800 + (cp >> 10));
+                *out++ = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+            }
+            else
+            {
+                *out++ = static_cast<char16_t>(cp);
+            }
+        }
+
+        // 逐字节检查解码，直到 p >= stop（最后一个序列可能越过 stop）
+        inline const uint8_t* DecodeChecked(const uint8_t* begin, const uint8_t* p, const uint8_t* stop,
+            const uint8_t* end, char16_t*& out, ErrorSink& sink)
+        {
+            while (p < stop)
+            {
+                if (*p < 0x80)
+                {
+                    *out++ = *p++;
+                    continue;
+                }
+                uint32_t cp = 0;
+                bool bError = false;
+                size_t n = CheckOne(p, end, cp, bError);
+                if (bError)
+                {
+                    sink.Record(static_cast<size_t>(p - begin));
+                    *out++ = static_cast<char16_t>(UTF16_REPLACEMENT_CHAR);
+                }
+                else
+                {
+                    PutCodePoint(cp, out);
+                }
+                p += n;
+            }
+            return p;
+        }
+
+        // 解码已校验的数据，只处理完整落在 [p, stop) 内的序列，返回停止位置
+        inline const uint8_t* DecodeValidated(const uint8_t* p, const uint8_t* stop, char16_t*& out)
+        {
+            while (p < stop)
+            {
+                uint32_t b0 = *p;
+                if (b0 < 0x80)
+                {
+                    *out++ = static_cast<char16_t>(b0);
+                    p++;
+                }
+                else if (b0 < 0xE0)
+                {
+                    if (stop - p < 2)
+                        break;
+                    *out++ = static_cast<char16_t>(((b0 & 0x1F) << 6) | (p[1] & 0x3F));
+                    p += 2;
+                }
+                else if (b0 < 0xF0)
+                {
+                    if (stop - p < 3)
+                        break;
+                    *out++ = static_cast<char16_t>(((b0 & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F));
+                    p += 3;
+                }
+                else
+                {
+                    if (stop - p < 4)
+                        break;
+                    uint32_t cp = ((b0 & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+                    PutCodePoint(cp, out);
+                    p += 4;
+                }
+            }
+            return p;
+        }
+
+        // 标量 ASCII 快速路径：一次检查 8 字节
+        inline bool IsAscii8(const uint8_t* p)
+        {
+            uint64_t word;
+            memcpy(&word, p, sizeof(word));
+            return (word & ASCII_MASK_64) == 0;
+        }
+
+        Utf8DecodeResult DecodeScalar(const uint8_t* src, size_t len, char16_t* dst, ErrorSink& sink)
+        {
+            const uint8_t* p = src;
+            const uint8_t* end = src + len;
+            char16_t* out = dst;
+            while (p < end)
+            {
+                if (end - p >= 8 && IsAscii8(p))
+                {
+                    for (int i = 0; i < 8; i++)
+                        out[i] = p[i];
+                    p += 8;
+                    out += 8;
+                    continue;
+                }
+                p = DecodeChecked(src, p, (std::min)(p + 8, end), end, out, sink);
+            }
+            sink.pResult->outputLength = static_cast<size_t>(out - dst);
+            return *sink.pResult;
+        }
+
+        // 从 p 开始逐序列检查，返回第一个非法序列的偏移，全部合法时返回 len
+        size_t FindFirstErrorScalar(const uint8_t* src, const uint8_t* p, size_t len)
+        {
+            const uint8_t* end = src + len;
+            while (p < end)
+            {
+                if (end - p >= 8 && IsAscii8(p))
+                {
+                    p += 8;
+                    continue;
+                }
+                uint32_t cp = 0;
+                bool bError = false;
+                size_t n = CheckOne(p, end, cp, bError);
+                if (bError)
+                    return static_cast<size_t>(p - src);
+                p += n;
+            }
+            return len;
+        }
+
+        // SIMD 块校验报错后，回退到跨块序列的起点再精确定位
+        size_t LocateErrorFrom(const uint8_t* src, const uint8_t* blockStart, size_t len)
+        {
+            const uint8_t* q = blockStart;
+            for (int k = 1; k <= 3 && blockStart - k >= src; k++)
+            {
+                uint8_t b = blockStart[-k];
+                if (b < 0x80)
+                    break;
+                if (b >= 0xC0)
+                {
+                    q = blockStart - k;
+                    break;
+                }
+            }
+            return FindFirstErrorScalar(src, q, len);
+        }
+
+#if SIMD_X86
+        // ============ 查表校验（Keiser & Lemire） ============
+        // 用前一字节的高/低半字节和当前字节的高半字节各查一次表，三者相与即得错误类型；
+        // 再用前 2/3 字节判断当前位置是否必须是第 3/4 个字节。
+
+        const uint8_t TOO_SHORT = 1 << 0;
+        const uint8_t TOO_LONG = 1 << 1;
+        const uint8_t OVERLONG_3 = 1 << 2;
+        const uint8_t TOO_LARGE = 1 << 3;
+        const uint8_t SURROGATE = 1 << 4;
+        const uint8_t OVERLONG_2 = 1 << 5;
+        const uint8_t TOO_LARGE_1000 = 1 << 6;
+        const uint8_t OVERLONG_4 = 1 << 6;
+        const uint8_t TWO_CONTS = 1 << 7;
+        const uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+        alignas(16) const uint8_t BYTE_1_HIGH[16] = {
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+            TOO_SHORT | OVERLONG_2,
+            TOO_SHORT,
+            TOO_SHORT | OVERLONG_3 | SURROGATE,
+            TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+        };
+
+        alignas(16) const uint8_t BYTE_1_LOW[16] = {
+            CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+            CARRY | OVERLONG_2,
+            CARRY,
+            CARRY,
+            CARRY | TOO_LARGE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000
+        };
+
+        alignas(16) const uint8_t BYTE_2_HIGH[16] = {
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+        };
+
+        // 最后 3 字节若是未完成序列的首字节，则超出对应阈值
+        alignas(32) const uint8_t INCOMPLETE_MAX[32] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+        };
+
+        // ============ SSE2：仅 ASCII 快速路径 ============
+
+        inline void WidenAscii16SSE2(const __m128i v, char16_t* out)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(v, zero));
+        }
+
+        Utf8DecodeResult DecodeSSE2(const uint8_t* src, size_t len, char16_t* dst, ErrorSink& sink)
+        {
+            const uint8_t* p = src;
+            const uint8_t* end = src + len;
+            char16_t* out = dst;
+            while (end - p >= 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                if (_mm_movemask_epi8(v) == 0)
+                {
+                    WidenAscii16SSE2(v, out);
+                    p += 16;
+                    out += 16;
+                    continue;
+                }
+                p = DecodeChecked(src, p, p + 16, end, out, sink);
+            }
+            p = DecodeChecked(src, p, end, end, out, sink);
+            sink.pResult->outputLength = static_cast<size_t>(out - dst);
+            return *sink.pResult;
+        }
+
+        // ============ SSSE3 ============
+
+        SIMD_TARGET_SSSE3 inline __m128i Lookup16SSSE3(const uint8_t* table, __m128i idx)
+        {
+            return _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(table)), idx);
+        }
+
+        // 返回非零字节表示 input 中存在非法序列（prev 为前 16 字节）
+        SIMD_TARGET_SSSE3 inline __m128i CheckBlockSSSE3(__m128i input, __m128i prev)
+        {
+            const __m128i lowNibble = _mm_set1_epi8(0x0F);
+            __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+            __m128i b1High = Lookup16SSSE3(BYTE_1_HIGH, _mm_and_si128(_mm_srli_epi16(prev1, 4), lowNibble));
+            __m128i b1Low = Lookup16SSSE3(BYTE_1_LOW, _mm_and_si128(prev1, lowNibble));
+            __m128i b2High = Lookup16SSSE3(BYTE_2_HIGH, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+            __m128i special = _mm_and_si128(_mm_and_si128(b1High, b1Low), b2High);
+
+            __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+            __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+            __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+            return _mm_xor_si128(must23, special);
+        }
+
+        SIMD_TARGET_SSSE3 inline __m128i IsIncompleteSSSE3(__m128i input)
+        {
+            return _mm_subs_epu8(input, _mm_loadu_si128(reinterpret_cast<const __m128i*>(INCOMPLETE_MAX + 16)));
+        }
+
+        SIMD_TARGET_SSSE3 inline bool AnyNonZeroSSSE3(__m128i v)
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+        }
+
+        SIMD_TARGET_SSSE3 Utf8DecodeResult DecodeSSSE3(const uint8_t* src, size_t len, char16_t* dst, ErrorSink& sink)
+        {
+            const uint8_t* p = src;
+            const uint8_t* end = src + len;
+            char16_t* out = dst;
+            const __m128i zero = _mm_setzero_si128();
+            while (end - p >= 64)
+            {
+                __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+                __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+                __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+                __m128i any = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+                if (_mm_movemask_epi8(any) == 0)
+                {
+                    WidenAscii16SSE2(v0, out);
+                    WidenAscii16SSE2(v1, out + 16);
+                    WidenAscii16SSE2(v2, out + 32);
+                    WidenAscii16SSE2(v3, out + 48);
+                    p += 64;
+                    out += 64;
+                    continue;
+                }
+
+                // p 总是序列边界，因此块前状态可视为全零
+                __m128i error = CheckBlockSSSE3(v0, zero);
+                error = _mm_or_si128(error, CheckBlockSSSE3(v1, v0));
+                error = _mm_or_si128(error, CheckBlockSSSE3(v2, v1));
+                error = _mm_or_si128(error, CheckBlockSSSE3(v3, v2));
+                if (!AnyNonZeroSSSE3(error))
+                    p = DecodeValidated(p, p + 64, out);
+                else
+                    p = DecodeChecked(src, p, p + 64, end, out, sink);
+            }
+            p = DecodeChecked(src, p, end, end, out, sink);
+            sink.pResult->outputLength = static_cast<size_t>(out - dst);
+            return *sink.pResult;
+        }
+
+        SIMD_TARGET_SSSE3 Utf8ValidationResult ValidateSSSE3(const uint8_t* src, size_t len)
+        {
+            __m128i prev = _mm_setzero_si128();
+            __m128i prevIncomplete = _mm_setzero_si128();
+            size_t pos = 0;
+            while (pos < len)
+            {
+                // 最后不足 64 字节的部分补零后按同样方式检查
+                alignas(16) uint8_t tail[64];
+                const uint8_t* block = src + pos;
+                if (len - pos < 64)
+                {
+                    memset(tail, 0, sizeof(tail));
+                    memcpy(tail, block, len - pos);
+                    block = tail;
+                }
+
+                __m128i v[4];
+                for (int i = 0; i < 4; i++)
+                    v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+                __m128i any = _mm_or_si128(_mm_or_si128(v[0], v[1]), _mm_or_si128(v[2], v[3]));
+
+                __m128i error;
+                if (_mm_movemask_epi8(any) == 0)
+                {
+                    error = prevIncomplete;
+                }
+                else
+                {
+                    error = CheckBlockSSSE3(v[0], prev);
+                    for (int i = 1; i < 4; i++)
+                        error = _mm_or_si128(error, CheckBlockSSSE3(v[i], v[i - 1]));
+                    prevIncomplete = IsIncompleteSSSE3(v[3]);
+                    prev = v[3];
+                }
+                if (AnyNonZeroSSSE3(error))
+                {
+                    size_t offset = LocateErrorFrom(src, src + pos, len);
+                    return { false, offset };
+                }
+                pos += 64;
+            }
+            if (AnyNonZeroSSSE3(prevIncomplete))
+                return { false, LocateErrorFrom(src, src + len, len) };
+            return { true, len };
+        }
+
+        // ============ AVX2 ============
+
+        SIMD_TARGET_AVX2 inline __m256i Lookup16AVX2(const uint8_t* table, __m256i idx)
+        {
+            __m256i t = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+            return _mm256_shuffle_epi8(t, idx);
+        }
+
+        // 取 input 前移 N 字节的结果（跨越 128 位通道）
+        template <int N>
+        SIMD_TARGET_AVX2 inline __m256i PrevAVX2(__m256i input, __m256i prev)
+        {
+            return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+        }
+
+        SIMD_TARGET_AVX2 inline __m256i CheckBlockAVX2(__m256i input, __m256i prev)
+        {
+            const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+            __m256i prev1 = PrevAVX2<1>(input, prev);
+            __m256i b1High = Lookup16AVX2(BYTE_1_HIGH, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lowNibble));
+            __m256i b1Low = Lookup16AVX2(BYTE_1_LOW, _mm256_and_si256(prev1, lowNibble));
+            __m256i b2High = Lookup16AVX2(BYTE_2_HIGH, _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+            __m256i special = _mm256_and_si256(_mm256_and_si256(b1High, b1Low), b2High);
+
+            __m256i prev2 = PrevAVX2<2>(input, prev);
+            __m256i prev3 = PrevAVX2<3>(input, prev);
+            __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+            return _mm256_xor_si256(must23, special);
+        }
+
+        SIMD_TARGET_AVX2 inline __m256i IsIncompleteAVX2(__m256i input)
+        {
+            return _mm256_subs_epu8(input, _mm256_load_si256(reinterpret_cast<const __m256i*>(INCOMPLETE_MAX)));
+        }
+
+        SIMD_TARGET_AVX2 inline void WidenAscii32AVX2(__m256i v, char16_t* out)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+        }
+
+        SIMD_TARGET_AVX2 Utf8DecodeResult DecodeAVX2(const uint8_t* src, size_t len, char16_t* dst, ErrorSink& sink)
+        {
+            const uint8_t* p = src;
+            const uint8_t* end = src + len;
+            char16_t* out = dst;
+            const __m256i zero = _mm256_setzero_si256();
+            while (end - p >= 64)
+            {
+                __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+                uint32_t mask0 = static_cast<uint32_t>(_mm256_movemask_epi8(v0));
+                if (mask0 == 0)
+                {
+                    // 前半块是 ASCII 时先行扩展，混合文本也能受益
+                    WidenAscii32AVX2(v0, out);
+                    out += 32;
+                    if (_mm256_movemask_epi8(v1) == 0)
+                    {
+                        WidenAscii32AVX2(v1, out);
+                        out += 32;
+                        p += 64;
+                    }
+                    else
+                    {
+                        p += 32;
+                    }
+                    continue;
+                }
+
+                __m256i error = _mm256_or_si256(CheckBlockAVX2(v0, zero), CheckBlockAVX2(v1, v0));
+                if (_mm256_testz_si256(error, error))
+                    p = DecodeValidated(p, p + 64, out);
+                else
+                    p = DecodeChecked(src, p, p + 64, end, out, sink);
+            }
+            p = DecodeChecked(src, p, end, end, out, sink);
+            sink.pResult->outputLength = static_cast<size_t>(out - dst);
+            return *sink.pResult;
+        }
+
+        SIMD_TARGET_AVX2 Utf8ValidationResult ValidateAVX2(const uint8_t* src, size_t len)
+        {
+            __m256i prev = _mm256_setzero_si256();
+            __m256i prevIncomplete = _mm256_setzero_si256();
+            size_t pos = 0;
+            while (pos < len)
+            {
+                alignas(32) uint8_t tail[64];
+                const uint8_t* block = src + pos;
+                if (len - pos < 64)
+                {
+                    memset(tail, 0, sizeof(tail));
+                    memcpy(tail, block, len - pos);
+                    block = tail;
+                }
+
+                __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+                __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+                __m256i error;
+                if (_mm256_movemask_epi8(_mm256_or_si256(v0, v1)) == 0)
+                {
+                    error = prevIncomplete;
+                }
+                else
+                {
+                    error = _mm256_or_si256(CheckBlockAVX2(v0, prev), CheckBlockAVX2(v1, v0));
+                    prevIncomplete = IsIncompleteAVX2(v1);
+                    prev = v1;
+                }
+                if (!_mm256_testz_si256(error, error))
+                {
+                    size_t offset = LocateErrorFrom(src, src + pos, len);
+                    return { false, offset };
+                }
+                pos += 64;
+            }
+            if (!_mm256_testz_si256(prevIncomplete, prevIncomplete))
+                return { false, LocateErrorFrom(src, src + len, len) };
+            return { true, len };
+        }
+#endif
+    }
+
+    // ============ UTF-16 → UTF-8 编码 ============
+
+    namespace
+    {
+        // 编码 p 处的一个码点，返回消耗的单元数；dst 放不下时返回 0
+        inline size_t EncodeOne(const char16_t* p, const char16_t* end, char*& out, const char* outEnd, size_t& lone)
+        {
+            uint32_t u = *p;
+            if (u < 0x80)
+            {
+                if (out >= outEnd)
+                    return 0;
+                *out++ = static_cast<char>(u);
+                return 1;
+            }
+            if (u < 0x800)
+            {
+                if (outEnd - out < 2)
+                    return 0;
+                *out++ = static_cast<char>(0xC0 | (u >> 6));
+                *out++ = static_cast<char>(0x80 | (u & 0x3F));
+                return 1;
+            }
+            if ((u & 0xF800) == 0xD800)
+            {
+                if (u < 0xDC00 && p + 1 < end && (p[1] & 0xFC00) == 0xDC00)
+                {
+                    if (outEnd - out < 4)
+                        return 0;
+                    uint32_t cp = 0x10000 + ((u - 0xD800) << 10) + (p[1] - 0xDC00);
+                    *out++ = static_cast<char>(0xF0 | (cp >> 18));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+                    return 2;
+                }
+                // 孤立代理项
+                if (outEnd - out < 3)
+                    return 0;
+                u = UTF16_REPLACEMENT_CHAR;
+                lone++;
+            }
+            else if (outEnd - out < 3)
+            {
+                return 0;
+            }
+            *out++ = static_cast<char>(0xE0 | (u >> 12));
+            *out++ = static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (u & 0x3F));
+            return 1;
+        }
+
+        // 逐码点编码 [p, stop)，最后一个代理对可能越过 stop；dst 不足时提前返回
+        inline const char16_t* EncodeScalar(const char16_t* p, const char16_t* stop, const char16_t* end,
+            char*& out, const char* outEnd, size_t& lone)
+        {
+            while (p < stop)
+            {
+                size_t n = EncodeOne(p, end, out, outEnd, lone);
+                if (n == 0)
+                    break;
+                p += n;
+            }
+            return p;
+        }
+
+        // p 处码点编码后的字节数，返回消耗的单元数
+        inline size_t LengthOne(const char16_t* p, const char16_t* end, size_t& bytes)
+        {
+            uint32_t u = *p;
+            if (u < 0x80)
+            {
+                bytes += 1;
+            }
+            else if (u < 0x800)
+            {
+                bytes += 2;
+            }
+            else if (u >= 0xD800 && u < 0xDC00 && p + 1 < end && (p[1] & 0xFC00) == 0xDC00)
+            {
+                bytes += 4;
+                return 2;
+            }
+            else
+            {
+                bytes += 3;     // 包括孤立代理项（U+FFFD）
+            }
+            return 1;
+        }
+
+        inline const char16_t* LengthScalar(const char16_t* p, const char16_t* stop, const char16_t* end, size_t& bytes)
+        {
+            while (p < stop)
+                p += LengthOne(p, end, bytes);
+            return p;
+        }
+
+        Utf16EncodeResult MakeEncodeResult(const char16_t* src, const char16_t* p, const char* dst, const char* out, size_t lone)
+        {
+            Utf16EncodeResult result;
+            result.consumed = static_cast<size_t>(p - src);
+            result.outputLength = static_cast<size_t>(out - dst);
+            result.loneSurrogateCount = lone;
+            return result;
+        }
+
+#if SIMD_X86
+        // ============ SSE2：长度计数与 ASCII 快速路径 ============
+
+        // 16 位累加器每轮最多减 2，定期归约以免溢出
+        const int LENGTH_FLUSH_ROUNDS = 16000;
+
+        inline size_t HorizontalSumNegSSE2(__m128i acc)
+        {
+            __m128i sum32 = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+            sum32 = _mm_add_epi32(sum32, _mm_shuffle_epi32(sum32, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum32 = _mm_add_epi32(sum32, _mm_shuffle_epi32(sum32, _MM_SHUFFLE(2, 3, 0, 1)));
+            return static_cast<size_t>(-_mm_cvtsi128_si32(sum32));
+        }
+
+        // 每个单元按 3 字节计，ASCII 和 <0x800 的单元各减 1；含代理项的块交给标量处理
+        size_t LengthSSE2(const char16_t* src, size_t len)
+        {
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            const __m128i maskAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            const __m128i maskHigh = _mm_set1_epi16(static_cast<short>(0xF800));
+            const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+            const __m128i zero = _mm_setzero_si128();
+
+            size_t bytes = 0;
+            size_t saved = 0;
+            __m128i acc = zero;
+            int rounds = 0;
+            while (end - p >= 8)
+            {
+                __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i high = _mm_and_si128(u, maskHigh);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, surrogate)) != 0)
+                {
+                    p = LengthScalar(p, p + 8, end, bytes);
+                    continue;
+                }
+                __m128i isAscii = _mm_cmpeq_epi16(_mm_and_si128(u, maskAscii), zero);
+                __m128i isShort = _mm_cmpeq_epi16(high, zero);
+                acc = _mm_add_epi16(acc, _mm_add_epi16(isAscii, isShort));
+                bytes += 24;
+                p += 8;
+                if (++rounds == LENGTH_FLUSH_ROUNDS)
+                {
+                    saved += HorizontalSumNegSSE2(acc);
+                    acc = zero;
+                    rounds = 0;
+                }
+            }
+            saved += HorizontalSumNegSSE2(acc);
+            LengthScalar(p, end, end, bytes);
+            return bytes - saved;
+        }
+
+        // 8 个单元中不全是 ASCII 时：开头的 ASCII 串打包写出，否则标量编码开头的非 ASCII 串
+        inline const char16_t* EncodeRun8SSE2(__m128i u, const char16_t* p, const char16_t* end,
+            char*& out, const char* outEnd, size_t& lone)
+        {
+            const __m128i maskAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            unsigned int asciiBits = static_cast<unsigned int>(
+                _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(u, maskAscii), _mm_setzero_si128())));
+            if (asciiBits & 1)
+            {
+                int run = CountTrailingZeros(~asciiBits) / 2;
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(u, u));
+                out += run;
+                return p + run;
+            }
+            int run = asciiBits ? CountTrailingZeros(asciiBits) / 2 : 8;
+            return EncodeScalar(p, p + run, end, out, outEnd, lone);
+        }
+
+        inline bool IsAscii8x16SSE2(__m128i u)
+        {
+            const __m128i maskAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(u, maskAscii), _mm_setzero_si128())) == 0xFFFF;
+        }
+
+        Utf16EncodeResult EncodeSSE2(const char16_t* src, size_t len, char* dst, size_t cap)
+        {
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            char* out = dst;
+            const char* outEnd = dst + cap;
+            size_t lone = 0;
+            while (end - p >= 16 && outEnd - out >= 48)
+            {
+                __m128i u0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i u1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+                if (IsAscii8x16SSE2(_mm_or_si128(u0, u1)))
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(u0, u1));
+                    p += 16;
+                    out += 16;
+                    continue;
+                }
+                p = EncodeRun8SSE2(u0, p, end, out, outEnd, lone);
+            }
+            p = EncodeScalar(p, end, end, out, outEnd, lone);
+            return MakeEncodeResult(src, p, dst, out, lone);
+        }
+
+        // ============ SSSE3：增加全 3 字节块（CJK）路径 ============
+
+        // 8 个单元的 t0/t1 交错字节和 t2 字节，重排为 24 字节输出
+        alignas(16) const uint8_t ENC3_A_LO[16] = { 0, 1, 0x80, 2, 3, 0x80, 4, 5, 0x80, 6, 7, 0x80, 8, 9, 0x80, 10 };
+        alignas(16) const uint8_t ENC3_C_LO[16] = { 0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80 };
+        alignas(16) const uint8_t ENC3_A_HI[16] = { 11, 0x80, 12, 13, 0x80, 14, 15, 0x80,
+            0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+        alignas(16) const uint8_t ENC3_C_HI[16] = { 0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7,
+            0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+
+        // 8 个单元都 >= 0x800 且都不是代理项
+        inline bool IsThreeByte8SSE2(__m128i u)
+        {
+            __m128i high = _mm_and_si128(u, _mm_set1_epi16(static_cast<short>(0xF800)));
+            __m128i bad = _mm_or_si128(_mm_cmpeq_epi16(high, _mm_setzero_si128()),
+                _mm_cmpeq_epi16(high, _mm_set1_epi16(static_cast<short>(0xD800))));
+            return _mm_movemask_epi8(bad) == 0;
+        }
+
+        SIMD_TARGET_SSSE3 inline void EncodeThreeByte8SSSE3(__m128i u, char* out)
+        {
+            const __m128i low6 = _mm_set1_epi16(0x3F);
+            const __m128i cont = _mm_set1_epi16(0x80);
+            __m128i t0 = _mm_or_si128(_mm_srli_epi16(u, 12), _mm_set1_epi16(0xE0));
+            __m128i t1 = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(u, 6), low6), cont);
+            __m128i t2 = _mm_or_si128(_mm_and_si128(u, low6), cont);
+            __m128i a = _mm_or_si128(t0, _mm_slli_epi16(t1, 8));
+            __m128i c = _mm_packus_epi16(t2, t2);
+
+            __m128i lo = _mm_or_si128(
+                _mm_shuffle_epi8(a, _mm_load_si128(reinterpret_cast<const __m128i*>(ENC3_A_LO))),
+                _mm_shuffle_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i*>(ENC3_C_LO))));
+            __m128i hi = _mm_or_si128(
+                _mm_shuffle_epi8(a, _mm_load_si128(reinterpret_cast<const __m128i*>(ENC3_A_HI))),
+                _mm_shuffle_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i*>(ENC3_C_HI))));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), hi);
+        }
+
+        SIMD_TARGET_SSSE3 Utf16EncodeResult EncodeSSSE3(const char16_t* src, size_t len, char* dst, size_t cap)
+        {
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            char* out = dst;
+            const char* outEnd = dst + cap;
+            size_t lone = 0;
+            while (end - p >= 16 && outEnd - out >= 48)
+            {
+                __m128i u0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i u1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+                if (IsAscii8x16SSE2(_mm_or_si128(u0, u1)))
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(u0, u1));
+                    p += 16;
+                    out += 16;
+                    continue;
+                }
+                if (IsThreeByte8SSE2(u0))
+                {
+                    EncodeThreeByte8SSSE3(u0, out);
+                    p += 8;
+                    out += 24;
+                    continue;
+                }
+                p = EncodeRun8SSE2(u0, p, end, out, outEnd, lone);
+            }
+            p = EncodeScalar(p, end, end, out, outEnd, lone);
+            return MakeEncodeResult(src, p, dst, out, lone);
+        }
+
+        // ============ AVX2 ============
+
+        SIMD_TARGET_AVX2 inline size_t HorizontalSumNegAVX2(__m256i acc)
+        {
+            __m256i sum32 = _mm256_madd_epi16(acc, _mm256_set1_epi16(1));
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum32), _mm256_extracti128_si256(sum32, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+            return static_cast<size_t>(-_mm_cvtsi128_si32(s));
+        }
+
+        SIMD_TARGET_AVX2 size_t LengthAVX2(const char16_t* src, size_t len)
+        {
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            const __m256i maskAscii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+            const __m256i maskHigh = _mm256_set1_epi16(static_cast<short>(0xF800));
+            const __m256i surrogate = _mm256_set1_epi16(static_cast<short>(0xD800));
+            const __m256i zero = _mm256_setzero_si256();
+
+            size_t bytes = 0;
+            size_t saved = 0;
+            __m256i acc = zero;
+            int rounds = 0;
+            while (end - p >= 16)
+            {
+                __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i high = _mm256_and_si256(u, maskHigh);
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(high, surrogate)) != 0)
+                {
+                    p = LengthScalar(p, p + 16, end, bytes);
+                    continue;
+                }
+                __m256i isAscii = _mm256_cmpeq_epi16(_mm256_and_si256(u, maskAscii), zero);
+                __m256i isShort = _mm256_cmpeq_epi16(high, zero);
+                acc = _mm256_add_epi16(acc, _mm256_add_epi16(isAscii, isShort));
+                bytes += 48;
+                p += 16;
+                if (++rounds == LENGTH_FLUSH_ROUNDS)
+                {
+                    saved += HorizontalSumNegAVX2(acc);
+                    acc = zero;
+                    rounds = 0;
+                }
+            }
+            saved += HorizontalSumNegAVX2(acc);
+            LengthScalar(p, end, end, bytes);
+            return bytes - saved;
+        }
+
+        SIMD_TARGET_AVX2 Utf16EncodeResult EncodeAVX2(const char16_t* src, size_t len, char* dst, size_t cap)
+        {
+            const char16_t* p = src;
+            const char16_t* end = src + len;
+            char* out = dst;
+            const char* outEnd = dst + cap;
+            size_t lone = 0;
+            const __m256i maskAscii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+            while (end - p >= 32 && outEnd - out >= 96)
+            {
+                __m256i u0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i u1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 16));
+                if (_mm256_testz_si256(_mm256_or_si256(u0, u1), maskAscii))
+                {
+                    // packus 在 128 位通道内交错，重排 64 位块恢复顺序
+                    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(u0, u1), _MM_SHUFFLE(3, 1, 2, 0));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                    p += 32;
+                    out += 32;
+                    continue;
+                }
+                __m128i lo = _mm256_castsi256_si128(u0);
+                __m128i hi = _mm256_extracti128_si256(u0, 1);
+                if (IsThreeByte8SSE2(lo))
+                {
+                    EncodeThreeByte8SSSE3(lo, out);
+                    p += 8;
+                    out += 24;
+                    if (IsThreeByte8SSE2(hi))
+                    {
+                        EncodeThreeByte8SSSE3(hi, out);
+                        p += 8;
+                        out += 24;
+                    }
+                    continue;
+                }
+                p = EncodeRun8SSE2(lo, p, end, out, outEnd, lone);
+            }
+            p = EncodeScalar(p, end, end, out, outEnd, lone);
+            return MakeEncodeResult(src, p, dst, out, lone);
+        }
+#endif
+    }
+
+    // ============ 对外接口 ============
+
+    Utf8ValidationResult ValidateUtf8(const void* src, size_t len)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(src);
+        if (!p || len == 0)
+            return { true, 0 };
+
+#if SIMD_X86
+        switch (GetSimdLevel())
+        {
+        case SimdLevel::AVX2:
+            return ValidateAVX2(p, len);
+        case SimdLevel::SSSE3:
+            return ValidateSSSE3(p, len);
+        default:
+            break;
+        }
+#endif
+        size_t offset = FindFirstErrorScalar(p, p, len);
+        return { offset == len, offset };
+    }
+
+    Utf8DecodeResult Utf8ToUtf16(const void* src, size_t len, char16_t* dst, std::vector<size_t>* pErrorOffsets)
+    {
+        Utf8DecodeResult result = { 0, 0, len };
+        const uint8_t* p = static_cast<const uint8_t*>(src);
+        if (!p || !dst || len == 0)
+            return result;
+
+        ErrorSink sink = { &result, pErrorOffsets };
+#if SIMD_X86
+        switch (GetSimdLevel())
+        {
+        case SimdLevel::AVX2:
+            return DecodeAVX2(p, len, dst, sink);
+        case SimdLevel::SSSE3:
+            return DecodeSSSE3(p, len, dst, sink);
+        case SimdLevel::SSE2:
+            return DecodeSSE2(p, len, dst, sink);
+        default:
+            break;
+        }
+#endif
+        return DecodeScalar(p, len, dst, sink);
+    }
+
+    std::u16string Utf8ToUtf16String(const void* src, size_t len, Utf8DecodeResult* pResult)
+    {
+        std::u16string text(Utf8ToUtf16MaxLength(len), u'\0');
+        Utf8DecodeResult result = Utf8ToUtf16(src, len, text.empty() ? nullptr : &text[0]);
+        text.resize(result.outputLength);
+        if (pResult)
+            *pResult = result;
+        return text;
+    }
+
+    size_t Utf16ToUtf8Length(const char16_t* src, size_t len)
+    {
+        if (!src || len == 0)
+            return 0;
+
+#if SIMD_X86
+        SimdLevel level = GetSimdLevel();
+        if (level == SimdLevel::AVX2)
+            return LengthAVX2(src, len);
+        if (level != SimdLevel::Scalar)
+            return LengthSSE2(src, len);
+#endif
+        size_t bytes = 0;
+        LengthScalar(src, src + len, src + len, bytes);
+        return bytes;
+    }
+
+    Utf16EncodeResult Utf16ToUtf8(const char16_t* src, size_t len, char* dst, size_t dstCapacity)
+    {
+        if (!src || !dst || len == 0 || dstCapacity == 0)
+            return { 0, 0, 0 };
+
+#if SIMD_X86
+        switch (GetSimdLevel())
+        {
+        case SimdLevel::AVX2:
+            return EncodeAVX2(src, len, dst, dstCapacity);
+        case SimdLevel::SSSE3:
+            return EncodeSSSE3(src, len, dst, dstCapacity);
+        case SimdLevel::SSE2:
+            return EncodeSSE2(src, len, dst, dstCapacity);
+        default:
+            break;
+        }
+#endif
+        char* out = dst;
+        size_t lone = 0;
+        const char16_t* p = EncodeScalar(src, src + len, src + len, out, dst + dstCapacity, lone);
+        return MakeEncodeResult(src, p, dst, out, lone);
+    }
+
+    std::string Utf16ToUtf8String(const char16_t* src, size_t len, Utf16EncodeResult* pResult)
+    {
+        std::string text(Utf16ToUtf8Length(src, len), '\0');
+        Utf16EncodeResult result = Utf16ToUtf8(src, len, text.empty() ? nullptr : &text[0], text.size());
+        if (pResult)
+            *pResult = result;
+        return text;
+    }
+
+    // ============ UTF-16 字节序 ============
+
+    namespace
+    {
+        void SwapCopyScalar(const uint8_t* src, size_t units, char16_t* dst)
+        {
+            for (size_t i = 0; i < units; i++)
+            {
+                // 先读出两个字节再写，src 与 dst 重叠时同样正确
+                uint8_t hi = src[i * 2];
+                uint8_t lo = src[i * 2 + 1];
+                dst[i] = static_cast<char16_t>((hi << 8) | lo);
+            }
+        }
+
+#if SIMD_X86
+        // SSE2 没有字节洗牌指令，用移位 + 或完成 16 位内的字节交换
+        size_t SwapCopySSE2(const uint8_t* src, size_t units, char16_t* dst)
+        {
+            size_t i = 0;
+            for (; i + 8 <= units; i += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+            }
+            return i;
+        }
+
+        SIMD_TARGET_SSSE3 size_t SwapCopySSSE3(const uint8_t* src, size_t units, char16_t* dst)
+        {
+            const __m128i shuffle = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            size_t i = 0;
+            for (; i + 8 <= units; i += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, shuffle));
+            }
+            return i;
+        }
+
+        SIMD_TARGET_AVX2 size_t SwapCopyAVX2(const uint8_t* src, size_t units, char16_t* dst)
+        {
+            const __m256i shuffle = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            size_t i = 0;
+            for (; i + 16 <= units; i += 16)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(v, shuffle));
+            }
+            return i;
+        }
+#endif
+
+        // 交换 units 个单元的字节序；按地址递增、每个块先读后写，dst 不在 src 之后即可原地进行
+        void SwapCopy(const uint8_t* src, size_t units, char16_t* dst)
+        {
+            size_t done = 0;
+#if SIMD_X86
+            switch (GetSimdLevel())
+            {
+            case SimdLevel::AVX2:
+                done = SwapCopyAVX2(src, units, dst);
+                break;
+            case SimdLevel::SSSE3:
+                done = SwapCopySSSE3(src, units, dst);
+                break;
+            case SimdLevel::SSE2:
+                done = SwapCopySSE2(src, units, dst);
+                break;
+            default:
+                break;
+            }
+#endif
+            SwapCopyScalar(src + done * 2, units - done, dst + done);
+        }
+    }
+
+    size_t Utf16BytesToUnits(const void* src, size_t byteLen, bool bBigEndian, char16_t* dst)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(src);
+        if (!p || !dst || byteLen == 0)
+            return 0;
+
+        size_t units = byteLen / 2;
+        if (bBigEndian)
+            SwapCopy(p, units, dst);
+        else if (reinterpret_cast<const uint8_t*>(dst) != p)
+            memmove(dst, p, units * sizeof(char16_t));
+
+        // 奇数长度：最后一个孤立字节无法组成单元
+        if (byteLen & 1)
+            dst[units++] = static_cast<char16_t>(UTF16_REPLACEMENT_CHAR);
+        return units;
+    }
+
+    void SwapUtf16ByteOrder(char16_t* data, size_t len)
+    {
+        if (data && len > 0)
+            SwapCopy(reinterpret_cast<const uint8_t*>(data), len, data);
+    }
+
+    std::u16string Utf16BytesToString(const void* src, size_t byteLen, bool bBigEndian)
+    {
+        std::u16string text(Utf16BytesToUnitsLength(byteLen), u'\0');
+        text.resize(Utf16BytesToUnits(src, byteLen, bBigEndian, text.empty() ? nullptr : &text[0]));
+        return text;
+    }
+}
@@ -0,0 +1,122 @@
+﻿// TextCodec.h - UTF-8 与 UTF-16 互相转码（SIMD 加速，不依赖MFC）
+//
+// UTF-8→UTF-16：单趟完成校验和转码：纯 ASCII 块用 SSE2/AVX2 直接扩展为 UTF-16，
+// 含多字节字符的块先用 SSSE3/AVX2 查表校验，合法时走无分支检查的快速解码，
+// 只有真正含非法序列的块才退回逐字节检查。
+// 非法序列按"最大子部分"规则替换为 U+FFFD，并报告其字节偏移。
+//
+// UTF-16→UTF-8：可先用向量计数快速得到精确输出长度，一次分配到位；
+// 也可按调用方提供的固定大小缓冲区分块编码（不拆分码点），适合边编码边写文件。
+// ASCII 块和全部为 3 字节字符（CJK）的块走 SIMD 路径，孤立代理项一律编码为 U+FFFD。
+//
+// UTF-16 字节流（文件内容）：LE 直接复制，BE 用 SIMD 字节洗牌交换字节序，均可原地进行。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 非法序列的替换字符
+#define UTF16_REPLACEMENT_CHAR  0xFFFD
+
+namespace TestableLogic
+{
+    struct Utf8ValidationResult
+    {
+        bool bValid;
+        size_t errorOffset;         // 第一个非法序列的字节偏移，合法时等于输入长度
+    };
+
+    struct Utf8DecodeResult
+    {
+        size_t outputLength;        // 写出的 UTF-16 单元数
+        size_t invalidCount;        // 被替换为 U+FFFD 的非法序列数
+        size_t firstErrorOffset;    // 第一个非法序列的字节偏移，无错误时等于输入长度
+    };
+
+    // 校验 UTF-8（拒绝超长编码、代理区码点和大于 U+10FFFF 的码点）
+    Utf8ValidationResult ValidateUtf8(const void* src, size_t len);
+
+    // 转码所需的最大 UTF-16 单元数（每个输入字节至多产生一个单元）
+    inline size_t Utf8ToUtf16MaxLength(size_t len)
+    {
+        return len;
+    }
+
+    // 转码到调用方提供的缓冲区，dst 至少容纳 Utf8ToUtf16MaxLength(len) 个单元
+    // pErrorOffsets 非空时追加每个非法序列的字节偏移
+    Utf8DecodeResult Utf8ToUtf16(const void* src, size_t len, char16_t* dst,
+        std::vector<size_t>* pErrorOffsets = nullptr);
+
+    std::u16string Utf8ToUtf16String(const void* src, size_t len, Utf8DecodeResult* pResult = nullptr);
+
+    // ============ UTF-16 → UTF-8 ============
+
+    struct Utf16EncodeResult
+    {
+        size_t consumed;            // 已消耗的 UTF-16 单元数
+        size_t outputLength;        // 写出的 UTF-8 字节数
+        size_t loneSurrogateCount;  // 被替换为 U+FFFD 的孤立代理项数
+    };
+
+    // 编码后的精确字节数（与 Utf16ToUtf8 的输出一致）
+    size_t Utf16ToUtf8Length(const char16_t* src, size_t len);
+
+    // 最坏情况字节数（每个单元至多 3 字节）
+    inline size_t Utf16ToUtf8MaxLength(size_t len)
+    {
+        return len * 3;
+    }
+
+    // 编码到 dst，直到源数据耗尽或 dst 放不下下一个码点为止；
+    // 未耗尽时从 src + consumed 继续调用即可，代理对不会被拆开；分块时 dstCapacity 至少为 4
+    Utf16EncodeResult Utf16ToUtf8(const char16_t* src, size_t len, char* dst, size_t dstCapacity);
+
+    std::string Utf16ToUtf8String(const char16_t* src, size_t len, Utf16EncodeResult* pResult = nullptr);
+
+    // ============ UTF-16 字节流 → 本机 UTF-16 ============
+    // 本机字节序按小端处理（Windows 支持的平台均为小端）
+
+    // 转换后的单元数：奇数长度时末尾的孤立字节记为一个 U+FFFD
+    inline size_t Utf16BytesToUnitsLength(size_t byteLen)
+    {
+        return (byteLen + 1) / 2;
+    }
+
+    // 按显式长度转换，嵌入的 NUL 原样保留；BE 用 SIMD 字节洗牌交换字节序，LE 直接复制。
+    // dst 至少容纳 Utf16BytesToUnitsLength(byteLen) 个单元；dst 可以与 src 相同或位于 src 之前
+    // （原地转换并去掉前面的 BOM），但不能位于 src 之后。返回写出的单元数
+    size_t Utf16BytesToUnits(const void* src, size_t byteLen, bool bBigEndian, char16_t* dst);
+
+    // 原地交换字节序
+    void SwapUtf16ByteOrder(char16_t* data, size_t len);
+
+    std::u16string Utf16BytesToString(const void* src, size_t byteLen, bool bBigEndian);
+
+#ifdef _WIN32
+    // Windows 下 wchar_t 即 UTF-16，可直接读写 CString/std::wstring 的缓冲区
+    static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be UTF-16");
+
+    inline Utf8DecodeResult Utf8ToUtf16(const void* src, size_t len, wchar_t* dst,
+        std::vector<size_t>* pErrorOffsets = nullptr)
+    {
+        return Utf8ToUtf16(src, len, reinterpret_cast<char16_t*>(dst), pErrorOffsets);
+    }
+
+    inline size_t Utf16ToUtf8Length(const wchar_t* src, size_t len)
+    {
+        return Utf16ToUtf8Length(reinterpret_cast<const char16_t*>(src), len);
+    }
+
+    inline Utf16EncodeResult Utf16ToUtf8(const wchar_t* src, size_t len, char* dst, size_t dstCapacity)
+    {
+        return Utf16ToUtf8(reinterpret_cast<const char16_t*>(src), len, dst, dstCapacity);
+    }
+
+    inline size_t Utf16BytesToUnits(const void* src, size_t byteLen, bool bBigEndian, wchar_t* dst)
+    {
+        return Utf16BytesToUnits(src, byteLen, bBigEndian, reinterpret_cast<char16_t*>(dst));
+    }
+#endif
+}
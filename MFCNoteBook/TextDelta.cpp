@@ -0,0 +1,162 @@
+﻿// TextDelta.cpp - 文本增量实现
+#include "TextDelta.h"
+
+#include <algorithm>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        bool SameRange(const char16_t* a, const char16_t* b, size_t len)
+        {
+            return std::equal(a, a + len, b);
+        }
+
+        void AppendUnits(std::vector<uint8_t>& out, const std::u16string& text)
+        {
+            AppendVarint(out, text.size());
+            for (char16_t ch : text)
+            {
+                out.push_back(static_cast<uint8_t>(ch & 0xFF));
+                out.push_back(static_cast<uint8_t>(ch >> 8));
+            }
+        }
+
+        bool ReadUnits(const uint8_t* data, size_t len, size_t& pos, std::u16string& text)
+        {
+            uint64_t count = 0;
+            if (!ReadVarint(data, len, pos, count) || count > (len - pos) / 2)
+                return false;
+            text.resize(static_cast<size_t>(count));
+            for (size_t i = 0; i < text.size(); i++, pos += 2)
+                text[i] = static_cast<char16_t>(data[pos] | (data[pos + 1] << 8));
+            return true;
+        }
+    }
+
+    TextDelta MakeTextDelta(const char16_t* before, size_t beforeLen,
+        const char16_t* after, size_t afterLen, size_t caret)
+    {
+        TextDelta delta = { 0, std::u16string(), std::u16string() };
+        caret = (std::min)(caret, afterLen);
+
+        size_t prefix = 0;
+        size_t suffix = 0;
+        bool bFound = false;
+
+        // 输入：光标在插入内容之后
+        if (afterLen >= beforeLen && caret >= afterLen - beforeLen)
+        {
+            size_t start = caret - (afterLen - beforeLen);
+            if (SameRange(before, after, start) &&
+                SameRange(before + start, after + caret, beforeLen - start))
+            {
+                prefix = start;
+                suffix = beforeLen - start;
+                bFound = true;
+            }
+        }
+
+        // 删除：光标在删除处
+        if (!bFound && afterLen < beforeLen)
+        {
+            if (SameRange(before, after, caret) &&
+                SameRange(before + caret + (beforeLen - afterLen), after + caret, afterLen - caret))
+            {
+                prefix = caret;
+                suffix = afterLen - caret;
+                bFound = true;
+            }
+        }
+
+        if (!bFound)
+        {
+            size_t maxPrefix = (std::min)(beforeLen, afterLen);
+            while (prefix < maxPrefix && before[prefix] == after[prefix])
+                prefix++;
+            while (suffix < maxPrefix - prefix &&
+                before[beforeLen - 1 - suffix] == after[afterLen - 1 - suffix])
+                suffix++;
+        }
+
+        delta.pos = prefix;
+        delta.removed.assign(before + prefix, beforeLen - prefix - suffix);
+        delta.inserted.assign(after + prefix, afterLen - prefix - suffix);
+        return delta;
+    }
+
+    bool ApplyTextDelta(std::u16string& text, const TextDelta& delta)
+    {
+        if (delta.pos > text.size() || delta.removed.size() > text.size() - delta.pos)
+            return false;
+        text.replace(delta.pos, delta.removed.size(), delta.inserted);
+        return true;
+    }
+
+    bool RevertTextDelta(std::u16string& text, const TextDelta& delta)
+    {
+        if (delta.pos > text.size() || delta.inserted.size() > text.size() - delta.pos)
+            return false;
+        text.replace(delta.pos, delta.inserted.size(), delta.removed);
+        return true;
+    }
+
+    TextDelta InvertTextDelta(const TextDelta& delta)
+    {
+        TextDelta inverse;
+        inverse.pos = delta.pos;
+        inverse.removed = delta.inserted;
+        inverse.inserted = delta.removed;
+        return inverse;
+    }
+
+    size_t GetTextDeltaBytes(const TextDelta& delta)
+    {
+        return sizeof(TextDelta) + (delta.removed.size() + delta.inserted.size()) * sizeof(char16_t);
+    }
+
+    void EncodeTextDelta(const TextDelta& delta, std::vector<uint8_t>& out)
+    {
+        AppendVarint(out, delta.pos);
+        AppendUnits(out, delta.removed);
+        AppendUnits(out, delta.inserted);
+    }
+
+    bool DecodeTextDelta(const uint8_t* data, size_t len, TextDelta& delta, size_t* pUsed)
+    {
+        size_t pos = 0;
+        uint64_t start = 0;
+        if (!ReadVarint(data, len, pos, start) ||
+            !ReadUnits(data, len, pos, delta.removed) ||
+            !ReadUnits(data, len, pos, delta.inserted))
+            return false;
+
+        delta.pos = static_cast<size_t>(start);
+        if (pUsed)
+            *pUsed = pos;
+        return true;
+    }
+
+    void AppendVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool ReadVarint(const uint8_t* data, size_t len, size_t& pos, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && pos < len; shift += 7)
+        {
+            uint8_t byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,62 @@
+﻿// TextDelta.h - 编辑前后文本的增量（不依赖MFC）
+//
+// 撤销记录不再保存整篇文本的快照，只保存一次编辑替换掉的区间：位置、删去的文本和插入的文本。
+// 同一条增量正向应用即重做，反向应用即撤销；编码为紧凑的二进制后写入撤销日志。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace TestableLogic
+{
+    struct TextDelta
+    {
+        size_t pos;                 // UTF-16 单元偏移
+        std::u16string removed;     // 编辑前 [pos, pos + removed.size()) 的内容
+        std::u16string inserted;    // 编辑后 [pos, pos + inserted.size()) 的内容
+
+        bool IsEmpty() const { return removed.empty() && inserted.empty(); }
+
+        bool operator==(const TextDelta& other) const
+        {
+            return pos == other.pos && removed == other.removed && inserted == other.inserted;
+        }
+    };
+
+    // 比较编辑前后的文本，得到替换的区间。caret 为编辑后的光标位置，
+    // 与 CountEditLineDelta 一样先按输入、删除两种情况定位（重复字符时位置才正确），否则取公共前后缀之间的部分
+    TextDelta MakeTextDelta(const char16_t* before, size_t beforeLen,
+        const char16_t* after, size_t afterLen, size_t caret);
+
+    // 正向应用（重做）与反向应用（撤销）；位置越界时返回 false，文本不变
+    bool ApplyTextDelta(std::u16string& text, const TextDelta& delta);
+    bool RevertTextDelta(std::u16string& text, const TextDelta& delta);
+    // 反向的增量：正向应用它等于反向应用 delta
+    TextDelta InvertTextDelta(const TextDelta& delta);
+
+    // 内存占用估计（两段文本加固定开销），用于撤销历史的内存统计
+    size_t GetTextDeltaBytes(const TextDelta& delta);
+
+    // 二进制编码：变长整数的位置和长度，后跟小端 UTF-16；追加到 out 末尾
+    void EncodeTextDelta(const TextDelta& delta, std::vector<uint8_t>& out);
+    // 从 [data, data + len) 解码一条增量，pUsed 返回用掉的字节数；数据不完整时返回 false
+    bool DecodeTextDelta(const uint8_t* data, size_t len, TextDelta& delta, size_t* pUsed = nullptr);
+
+    // 变长整数（每字节 7 位，小端），供其他日志格式复用
+    void AppendVarint(std::vector<uint8_t>& out, uint64_t value);
+    bool ReadVarint(const uint8_t* data, size_t len, size_t& pos, uint64_t& value);
+
+#ifdef _WIN32
+    // Windows 下 wchar_t 即 UTF-16，可直接比较 CString 的缓冲区
+    static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be UTF-16");
+
+    inline TextDelta MakeTextDelta(const wchar_t* before, size_t beforeLen,
+        const wchar_t* after, size_t afterLen, size_t caret)
+    {
+        return MakeTextDelta(reinterpret_cast<const char16_t*>(before), beforeLen,
+            reinterpret_cast<const char16_t*>(after), afterLen, caret);
+    }
+#endif
+}
@@ -0,0 +1,816 @@
+﻿// TextEditorCtrl.cpp - 虚拟化自绘编辑控件实现
+
+#include "pch.h"
+#include "framework.h"
+#include "TextEditorCtrl.h"
+#include "TextLayout.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#endif
+
+using namespace TestableLogic;
+
+BEGIN_MESSAGE_MAP(CTextEditorCtrl, CWnd)
+    ON_WM_PAINT()
+    ON_WM_ERASEBKGND()
+    ON_WM_SIZE()
+    ON_WM_TIMER()
+    ON_WM_VSCROLL()
+    ON_WM_HSCROLL()
+    ON_WM_MOUSEWHEEL()
+    ON_WM_LBUTTONDOWN()
+    ON_WM_LBUTTONUP()
+    ON_WM_MOUSEMOVE()
+    ON_WM_KEYDOWN()
+    ON_WM_CHAR()
+    ON_WM_SETFOCUS()
+    ON_WM_KILLFOCUS()
+    ON_WM_GETDLGCODE()
+    ON_MESSAGE(WM_SETFONT, &CTextEditorCtrl::OnSetFont)
+    ON_MESSAGE(WM_GETFONT, &CTextEditorCtrl::OnGetFont)
+END_MESSAGE_MAP()
+
+CTextEditorCtrl::CTextEditorCtrl()
+    : m_hFont(NULL)
+    , m_nCharWidth(8)
+    , m_nLineHeight(16)
+    , m_nMaxColumns(0)
+    , m_clrBg(RGB(255, 255, 255))
+    , m_clrText(RGB(0, 0, 0))
+    , m_chPendingHigh(0)
+    , m_bSelecting(false)
+{
+}
+
+CTextEditorCtrl::~CTextEditorCtrl()
+{
+}
+
+BOOL CTextEditorCtrl::Create(DWORD dwStyle, const RECT& rect, CWnd* pParentWnd, UINT nID)
+{
+    HINSTANCE hInst = AfxGetInstanceHandle();
+    WNDCLASS wc = { 0 };
+    if (!::GetClassInfo(hInst, TEXTEDITOR_CLASSNAME, &wc))
+    {
+        wc.style = CS_DBLCLKS;
+        wc.lpfnWndProc = ::DefWindowProc;
+        wc.hInstance = hInst;
+        wc.hCursor = ::LoadCursor(NULL, IDC_IBEAM);
+        wc.hbrBackground = NULL;
+        wc.lpszClassName = TEXTEDITOR_CLASSNAME;
+        if (!AfxRegisterClass(&wc))
+            return FALSE;
+    }
+
+    return CWnd::Create(TEXTEDITOR_CLASSNAME, NULL, dwStyle, rect, pParentWnd, nID);
+}
+
+// ============ 缓冲区与外观 ============
+
+void CTextEditorCtrl::SetBuffer(TextBuffer* pBuffer, LineEnding lineBreak)
+{
+    m_model.SetBuffer(pBuffer);
+    m_model.SetLineBreak(lineBreak);
+    m_nMaxColumns = 0;
+    UpdateViewport();
+    UpdateScrollBars();
+    if (GetSafeHwnd())
+    {
+        Invalidate();
+        UpdateCaretPos();
+    }
+}
+
+void CTextEditorCtrl::ReloadBuffer()
+{
+    m_model.ReloadBuffer();
+
+    UpdateScrollBars();
+    Invalidate();
+    UpdateCaretPos();
+}
+
+void CTextEditorCtrl::SetColors(COLORREF clrBg, COLORREF clrText)
+{
+    m_clrBg = clrBg;
+    m_clrText = clrText;
+    if (GetSafeHwnd())
+        Invalidate();
+}
+
+void CTextEditorCtrl::SetWordWrap(bool bWrap)
+{
+    if (bWrap == m_model.IsWordWrap())
+        return;
+
+    m_model.SetWordWrap(bWrap);
+    if (!GetSafeHwnd())
+        return;
+
+    // 自动换行时没有水平滚动；滚动条显隐会改变客户区宽度，随后重新取视口
+    ShowScrollBar(SB_HORZ, bWrap ? FALSE : TRUE);
+    UpdateViewport();
+    UpdateScrollBars();
+    Invalidate(FALSE);
+    UpdateCaretPos();
+    NotifyParent(EN_VSCROLL);
+}
+
+size_t CTextEditorCtrl::GetLineCount() const
+{
+    TextBuffer* pBuffer = m_model.GetBuffer();
+    return pBuffer ? pBuffer->GetLineCount() : 1;
+}
+
+LRESULT CTextEditorCtrl::OnSetFont(WPARAM wParam, LPARAM lParam)
+{
+    m_hFont = reinterpret_cast<HFONT>(wParam);
+    UpdateMetrics();
+    if (LOWORD(lParam))
+        Invalidate();
+    return 0;
+}
+
+LRESULT CTextEditorCtrl::OnGetFont(WPARAM /*wParam*/, LPARAM /*lParam*/)
+{
+    return reinterpret_cast<LRESULT>(m_hFont);
+}
+
+void CTextEditorCtrl::UpdateMetrics()
+{
+    if (!GetSafeHwnd())
+        return;
+
+    CClientDC dc(this);
+    HGDIOBJ hOldFont = m_hFont ? dc.SelectObject(m_hFont) : NULL;
+    TEXTMETRIC tm;
+    dc.GetTextMetrics(&tm);
+    if (hOldFont)
+        dc.SelectObject(hOldFont);
+
+    m_nCharWidth = max(1, (int)tm.tmAveCharWidth);
+    m_nLineHeight = max(1, (int)tm.tmHeight);
+    ApplyMetrics();
+}
+
+void CTextEditorCtrl::SetFontMetrics(CFont* pFont, int nCharWidth, int nLineHeight)
+{
+    m_hFont = static_cast<HFONT>(pFont->GetSafeHandle());
+    m_nCharWidth = max(1, nCharWidth);
+    m_nLineHeight = max(1, nLineHeight);
+    if (!GetSafeHwnd())
+        return;
+
+    ApplyMetrics();
+    Invalidate();
+}
+
+void CTextEditorCtrl::ApplyMetrics()
+{
+    UpdateViewport();
+    UpdateScrollBars();
+
+    if (GetFocus() == this)
+    {
+        ::DestroyCaret();
+        CreateSolidCaret(2, m_nLineHeight);
+        ShowCaret();
+        UpdateCaretPos();
+    }
+}
+
+void CTextEditorCtrl::UpdateViewport()
+{
+    if (!GetSafeHwnd())
+        return;
+
+    CRect rc;
+    GetClientRect(&rc);
+    m_model.SetViewport(static_cast<size_t>(max(1, rc.Height() / m_nLineHeight)),
+        static_cast<size_t>(max(1, rc.Width() / m_nCharWidth)));
+}
+
+void CTextEditorCtrl::UpdateScrollBars()
+{
+    if (!GetSafeHwnd())
+        return;
+
+    // 滚动条只有 32 位，超过范围时按比例缩放（1 GB 的文件行数通常仍在范围内）
+    // 自动换行时按可视行滚动，尚未折行的行按一行估计
+    SCROLLINFO si = { sizeof(SCROLLINFO) };
+    si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS | SIF_DISABLENOSCROLL;
+    si.nMin = 0;
+    si.nMax = static_cast<int>(min(m_model.GetTotalRows() - 1, static_cast<uint64_t>(INT_MAX - 1)));
+    si.nPage = static_cast<UINT>(m_model.GetVisibleRows());
+    si.nPos = static_cast<int>(min(m_model.GetFirstVisibleRow(), static_cast<uint64_t>(INT_MAX - 1)));
+    SetScrollInfo(SB_VERT, &si, TRUE);
+
+    if (m_model.IsWordWrap())
+        return;
+
+    size_t columns = max(m_nMaxColumns, m_model.GetFirstVisibleColumn() + m_model.GetVisibleColumns());
+    si.nMax = static_cast<int>(min(columns, static_cast<size_t>(INT_MAX - 1)));
+    si.nPage = static_cast<UINT>(m_model.GetVisibleColumns());
+    si.nPos = static_cast<int>(m_model.GetFirstVisibleColumn());
+    SetScrollInfo(SB_HORZ, &si, TRUE);
+}
+
+void CTextEditorCtrl::UpdateCaretPos()
+{
+    if (GetFocus() != this)
+        return;
+
+    uint64_t row = m_model.GetCaretRow();
+    size_t column = m_model.GetCaretRowColumn();
+    uint64_t firstRow = m_model.GetFirstVisibleRow();
+    size_t firstColumn = m_model.GetFirstVisibleColumn();
+
+    if (row < firstRow || row > firstRow + m_model.GetVisibleRows() || column < firstColumn)
+    {
+        SetCaretPos(CPoint(-m_nCharWidth * 4, -m_nLineHeight * 4));
+        return;
+    }
+    SetCaretPos(CPoint(static_cast<int>(column - firstColumn) * m_nCharWidth,
+        static_cast<int>(row - firstRow) * m_nLineHeight));
+}
+
+void CTextEditorCtrl::NotifyParent(UINT nCode)
+{
+    CWnd* pParent = GetParent();
+    if (pParent)
+    {
+        pParent->SendMessage(WM_COMMAND, MAKEWPARAM(GetDlgCtrlID(), nCode),
+            reinterpret_cast<LPARAM>(m_hWnd));
+    }
+}
+
+void CTextEditorCtrl::OnCaretChanged(bool bContentChanged)
+{
+    // 可视行编号会随后台折行变化，是否滚动按第一可见的逻辑行和其中的可视行判断
+    size_t oldFirstLine = m_model.GetFirstVisibleLine();
+    size_t oldSubRow = m_model.GetFirstVisibleSubRow();
+    m_model.EnsureCaretVisible();
+
+    UpdateScrollBars();
+    Invalidate(FALSE);
+    UpdateCaretPos();
+
+    if (bContentChanged)
+        NotifyParent(EN_CHANGE);
+    if (m_model.GetFirstVisibleLine() != oldFirstLine || m_model.GetFirstVisibleSubRow() != oldSubRow)
+        NotifyParent(EN_VSCROLL);
+}
+
+void CTextEditorCtrl::ScrollToRow(uint64_t row)
+{
+    size_t oldFirstLine = m_model.GetFirstVisibleLine();
+    size_t oldSubRow = m_model.GetFirstVisibleSubRow();
+    m_model.SetFirstVisibleRow(row);
+    if (m_model.GetFirstVisibleLine() == oldFirstLine && m_model.GetFirstVisibleSubRow() == oldSubRow)
+        return;
+
+    UpdateScrollBars();
+    Invalidate(FALSE);
+    UpdateCaretPos();
+    NotifyParent(EN_VSCROLL);
+}
+
+// ============ 编辑命令 ============
+
+void CTextEditorCtrl::Undo()
+{
+    if (m_model.Undo())
+        OnCaretChanged(true);
+}
+
+void CTextEditorCtrl::Redo()
+{
+    if (m_model.Redo())
+        OnCaretChanged(true);
+}
+
+bool CTextEditorCtrl::FindNext(const std::string& utf8, bool bMatchCase, bool bWholeWord, bool* pWrapped)
+{
+    if (!m_model.FindNext(utf8, bMatchCase, bWholeWord, pWrapped))
+        return false;
+    OnCaretChanged(false);
+    return true;
+}
+
+void CTextEditorCtrl::Cut()
+{
+    if (!HasSelection())
+        return;
+    Copy();
+    m_model.DeleteSelection();
+    OnCaretChanged(true);
+}
+
+void CTextEditorCtrl::GetSel(size_t& nStart, size_t& nEnd) const
+{
+    nStart = m_model.GetSelection().Start();
+    nEnd = m_model.GetSelection().End();
+}
+
+void CTextEditorCtrl::Copy()
+{
+    if (!HasSelection())
+        return;
+
+    std::u16string text = m_model.GetSelectedText();
+    WriteClipboardText(GetSafeHwnd(), text.data(), text.size());
+}
+
+bool CTextEditorCtrl::WriteClipboardText(HWND hOwner, const char16_t* pText, size_t nLen)
+{
+    if (!::OpenClipboard(hOwner))
+        return false;
+
+    // 剪贴板文本约定使用 CRLF，直接转换到剪贴板的内存中
+    LineEndingStats stats = CountLineEndings(pText, nLen);
+    size_t nConverted = GetConvertedLength(stats, nLen, LineEnding::CrLf);
+
+    ::EmptyClipboard();
+    bool bOk = false;
+    HGLOBAL hMem = ::GlobalAlloc(GMEM_MOVEABLE, (nConverted + 1) * sizeof(char16_t));
+    if (hMem)
+    {
+        char16_t* pDst = static_cast<char16_t*>(::GlobalLock(hMem));
+        if (nConverted > 0)
+            ConvertLineEndings(pText, nLen, LineEnding::CrLf, pDst, nConverted);
+        pDst[nConverted] = u'\0';
+        ::GlobalUnlock(hMem);
+        bOk = ::SetClipboardData(CF_UNICODETEXT, hMem) != NULL;
+        if (!bOk)
+            ::GlobalFree(hMem);
+    }
+    ::CloseClipboard();
+    return bOk;
+}
+
+void CTextEditorCtrl::Paste()
+{
+    std::u16string text;
+    if (!ReadClipboardText(GetSafeHwnd(), text))
+        return;
+
+    PreparedPaste paste;
+    PreparePaste(text.data(), text.size(), m_model.GetLineBreak(), PasteTarget::Utf8, paste);
+    InsertPrepared(paste);
+}
+
+void CTextEditorCtrl::InsertPrepared(const PreparedPaste& paste)
+{
+    m_model.InsertPrepared(paste.utf8, paste.index);
+    OnCaretChanged(true);
+}
+
+bool CTextEditorCtrl::ReadClipboardText(HWND hOwner, std::u16string& text)
+{
+    text.clear();
+    if (!::IsClipboardFormatAvailable(CF_UNICODETEXT) || !::OpenClipboard(hOwner))
+        return false;
+
+    // 只在数据块的大小范围内查找结尾的 NUL（数据不一定以 NUL 结尾）
+    HANDLE hData = ::GetClipboardData(CF_UNICODETEXT);
+    const char16_t* pText = hData ? static_cast<const char16_t*>(::GlobalLock(hData)) : nullptr;
+    if (pText)
+    {
+        ReadTerminatedText(pText, ::GlobalSize(hData) / sizeof(char16_t), text);
+        ::GlobalUnlock(hData);
+    }
+    ::CloseClipboard();
+    return pText != nullptr;
+}
+
+// ============ 绘制 ============
+
+BOOL CTextEditorCtrl::OnEraseBkgnd(CDC* /*pDC*/)
+{
+    return TRUE;
+}
+
+void CTextEditorCtrl::OnPaint()
+{
+    CPaintDC dc(this);
+
+    CRect rcClient;
+    GetClientRect(&rcClient);
+
+    HGDIOBJ hOldFont = m_hFont ? dc.SelectObject(m_hFont) : NULL;
+    dc.SetBkMode(TRANSPARENT);
+
+    // 只解码并绘制可见行（最后一行可能只露出一部分）
+    uint64_t totalRowsBefore = m_model.GetTotalRows();
+    m_model.LayoutVisibleLines();
+    size_t lineCount = GetLineCount();
+    size_t maxColumnsBefore = m_nMaxColumns;
+    int y = 0;
+    size_t subRow = m_model.GetFirstVisibleSubRow();
+    for (size_t line = m_model.GetFirstVisibleLine(); line < lineCount && y < rcClient.bottom; line++, subRow = 0)
+    {
+        DrawLine(&dc, line, subRow, y, rcClient);
+    }
+    if (y < rcClient.bottom)
+    {
+        dc.FillSolidRect(0, y, rcClient.Width(), rcClient.bottom - y, m_clrBg);
+    }
+
+    if (hOldFont)
+        dc.SelectObject(hOldFont);
+
+    if (m_nMaxColumns != maxColumnsBefore || m_model.GetTotalRows() != totalRowsBefore)
+        UpdateScrollBars();
+    ScheduleReflow();
+}
+
+void CTextEditorCtrl::DrawLine(CDC* pDC, size_t line, size_t subRow, int& y, const CRect& rcClient)
+{
+    // 超长行只解码要绘制的块，不换行时一次取出覆盖可见列的几块
+    if (m_model.GetLongLineSlice(line, subRow, m_slice))
+    {
+        m_nMaxColumns = max(m_nMaxColumns, m_slice.lineColumns + 1);
+        if (!m_model.IsWordWrap())
+        {
+            DrawRow(pDC, m_slice.text.data(), m_slice.offsets.data(), m_slice.cells.data(), m_slice.text.size(),
+                m_slice.startColumn, m_slice.bLineEnd, y, rcClient);
+            y += m_nLineHeight;
+            return;
+        }
+
+        // 自动换行：画完一块的可视行后再取下一块
+        while (y < rcClient.bottom)
+        {
+            size_t k = subRow - m_slice.firstSubRow;
+            if (k >= m_slice.points.size())
+            {
+                if (m_slice.bLineEnd || !m_model.GetLongLineSlice(line, subRow, m_slice))
+                    break;
+                continue;
+            }
+            bool bLast = (k + 1 == m_slice.points.size());
+            size_t rowBegin = m_slice.points[k];
+            size_t rowEnd = bLast ? m_slice.text.size() : m_slice.points[k + 1];
+            GetCellColumns(m_slice.text.data() + rowBegin, rowEnd - rowBegin, m_cellColumns);
+            DrawRow(pDC, m_slice.text.data() + rowBegin, m_slice.offsets.data() + rowBegin, m_cellColumns.data(),
+                rowEnd - rowBegin, 0, bLast && m_slice.bLineEnd, y, rcClient);
+            subRow++;
+            y += m_nLineHeight;
+        }
+        return;
+    }
+
+    std::u16string text = m_model.GetLineText(line, &m_unitOffsets);
+    m_model.GetWrapPoints(line, text, m_wrapPoints);
+    for (; subRow < m_wrapPoints.size() && y < rcClient.bottom; subRow++, y += m_nLineHeight)
+    {
+        // 制表位按可视行计算，与折行时一致
+        bool bLast = (subRow + 1 == m_wrapPoints.size());
+        size_t rowBegin = m_wrapPoints[subRow];
+        size_t rowEnd = bLast ? text.size() : m_wrapPoints[subRow + 1];
+        GetCellColumns(text.data() + rowBegin, rowEnd - rowBegin, m_cellColumns);
+        DrawRow(pDC, text.data() + rowBegin, m_unitOffsets.data() + rowBegin, m_cellColumns.data(),
+            rowEnd - rowBegin, 0, bLast, y, rcClient);
+    }
+}
+
+void CTextEditorCtrl::DrawRow(CDC* pDC, const char16_t* pText, const size_t* pOffsets, const int* pCells, size_t length,
+    size_t startColumn, bool bLineEnd, int y, const CRect& rcClient)
+{
+    CRect rcLine(0, y, rcClient.right, y + m_nLineHeight);
+    pDC->FillSolidRect(rcLine, m_clrBg);
+
+    size_t lineColumns = startColumn;
+    for (size_t i = 0; i < length; i++)
+        lineColumns += static_cast<size_t>(pCells[i]);
+    m_nMaxColumns = max(m_nMaxColumns, lineColumns + 1);
+
+    // 跳过水平滚动位置之前的字符
+    size_t firstColumn = m_model.GetFirstVisibleColumn();
+    size_t lastColumn = firstColumn + m_model.GetVisibleColumns() + 1;
+    size_t column = startColumn;
+    size_t begin = 0;
+    while (begin < length && column + static_cast<size_t>(pCells[begin]) <= firstColumn)
+        column += static_cast<size_t>(pCells[begin++]);
+    while (begin < length && pCells[begin] == 0)
+        begin++;
+
+    size_t end = begin;
+    size_t endColumn = column;
+    while (end < length && endColumn < lastColumn)
+        endColumn += static_cast<size_t>(pCells[end++]);
+    while (end < length && pCells[end] == 0)
+        end++;
+
+    m_dx.resize(end - begin);
+    for (size_t i = begin; i < end; i++)
+        m_dx[i - begin] = pCells[i] * m_nCharWidth;
+
+    const TextSelection& selection = m_model.GetSelection();
+    size_t selStart = selection.Start();
+    size_t selEnd = selection.End();
+    COLORREF clrSelBg = ::GetSysColor(COLOR_HIGHLIGHT);
+    COLORREF clrSelText = ::GetSysColor(COLOR_HIGHLIGHTTEXT);
+
+    // 按选中状态分段绘制
+    int x = (static_cast<int>(column) - static_cast<int>(firstColumn)) * m_nCharWidth;
+    size_t i = begin;
+    while (i < end)
+    {
+        bool bSelected = pOffsets[i] >= selStart && pOffsets[i] < selEnd;
+        size_t runEnd = i;
+        int runWidth = 0;
+        while (runEnd < end && (pOffsets[runEnd] >= selStart && pOffsets[runEnd] < selEnd) == bSelected)
+            runWidth += m_dx[runEnd++ - begin];
+
+        if (bSelected)
+            pDC->FillSolidRect(x, y, runWidth, m_nLineHeight, clrSelBg);
+        pDC->SetTextColor(bSelected ? clrSelText : m_clrText);
+        pDC->ExtTextOut(x, y, ETO_CLIPPED, &rcLine, reinterpret_cast<LPCWSTR>(pText + i),
+            static_cast<UINT>(runEnd - i), &m_dx[i - begin]);
+
+        x += runWidth;
+        i = runEnd;
+    }
+
+    // 选区跨过行尾时，在行尾画一格表示换行也被选中
+    size_t lineEnd = pOffsets[length];
+    if (bLineEnd && end == length && selStart <= lineEnd && selEnd > lineEnd)
+    {
+        int xEnd = (static_cast<int>(lineColumns) - static_cast<int>(firstColumn)) * m_nCharWidth;
+        if (xEnd >= 0)
+            pDC->FillSolidRect(xEnd, y, m_nCharWidth, m_nLineHeight, clrSelBg);
+    }
+}
+
+void CTextEditorCtrl::OnSize(UINT nType, int cx, int cy)
+{
+    CWnd::OnSize(nType, cx, cy);
+    UpdateViewport();
+    UpdateScrollBars();
+    UpdateCaretPos();
+}
+
+// ============ 后台折行 ============
+
+void CTextEditorCtrl::ScheduleReflow()
+{
+    if (m_model.GetPendingLayoutCount() != 0)
+        SetTimer(TEXTEDITOR_REFLOW_TIMER, 0, NULL);
+}
+
+// 可见行在绘制时已经折好，这里只补算其余各行，修正滚动条范围
+void CTextEditorCtrl::OnTimer(UINT_PTR nIDEvent)
+{
+    if (nIDEvent != TEXTEDITOR_REFLOW_TIMER)
+    {
+        CWnd::OnTimer(nIDEvent);
+        return;
+    }
+
+    if (m_model.ReflowPending(TEXTEDITOR_REFLOW_LINES) == 0)
+        KillTimer(TEXTEDITOR_REFLOW_TIMER);
+    UpdateScrollBars();
+}
+
+// ============ 滚动 ============
+
+void CTextEditorCtrl::OnVScroll(UINT nSBCode, UINT /*nPos*/, CScrollBar* /*pScrollBar*/)
+{
+    uint64_t firstRow = m_model.GetFirstVisibleRow();
+    uint64_t page = max(static_cast<size_t>(1), m_model.GetVisibleRows() - 1);
+
+    switch (nSBCode)
+    {
+    case SB_LINEUP:
+        ScrollToRow(firstRow > 0 ? firstRow - 1 : 0);
+        break;
+    case SB_LINEDOWN:
+        ScrollToRow(firstRow + 1);
+        break;
+    case SB_PAGEUP:
+        ScrollToRow(firstRow > page ? firstRow - page : 0);
+        break;
+    case SB_PAGEDOWN:
+        ScrollToRow(firstRow + page);
+        break;
+    case SB_TOP:
+        ScrollToRow(0);
+        break;
+    case SB_BOTTOM:
+        ScrollToRow(m_model.GetMaxFirstVisibleRow());
+        break;
+    case SB_THUMBTRACK:
+    case SB_THUMBPOSITION:
+    {
+        // nPos 只有 16 位，改用 32 位的跟踪位置
+        SCROLLINFO si = { sizeof(SCROLLINFO) };
+        si.fMask = SIF_TRACKPOS;
+        GetScrollInfo(SB_VERT, &si);
+        ScrollToRow(static_cast<uint64_t>(si.nTrackPos));
+        break;
+    }
+    }
+}
+
+void CTextEditorCtrl::OnHScroll(UINT nSBCode, UINT /*nPos*/, CScrollBar* /*pScrollBar*/)
+{
+    size_t firstColumn = m_model.GetFirstVisibleColumn();
+    size_t page = max(static_cast<size_t>(1), m_model.GetVisibleColumns() - 1);
+    size_t newColumn = firstColumn;
+
+    switch (nSBCode)
+    {
+    case SB_LINELEFT:
+        newColumn = firstColumn > 0 ? firstColumn - 1 : 0;
+        break;
+    case SB_LINERIGHT:
+        newColumn = firstColumn + 1;
+        break;
+    case SB_PAGELEFT:
+        newColumn = firstColumn > page ? firstColumn - page : 0;
+        break;
+    case SB_PAGERIGHT:
+        newColumn = firstColumn + page;
+        break;
+    case SB_LEFT:
+        newColumn = 0;
+        break;
+    case SB_THUMBTRACK:
+    case SB_THUMBPOSITION:
+    {
+        SCROLLINFO si = { sizeof(SCROLLINFO) };
+        si.fMask = SIF_TRACKPOS;
+        GetScrollInfo(SB_HORZ, &si);
+        newColumn = static_cast<size_t>(si.nTrackPos);
+        break;
+    }
+    }
+
+    if (newColumn != firstColumn)
+    {
+        m_model.SetFirstVisibleColumn(newColumn);
+        UpdateScrollBars();
+        Invalidate(FALSE);
+        UpdateCaretPos();
+    }
+}
+
+BOOL CTextEditorCtrl::OnMouseWheel(UINT nFlags, short zDelta, CPoint pt)
+{
+    // Ctrl + 滚轮交给父窗口缩放
+    if (nFlags & MK_CONTROL)
+        return CWnd::OnMouseWheel(nFlags, zDelta, pt);
+
+    long long delta = -static_cast<long long>(zDelta) * TEXTEDITOR_WHEEL_LINES / WHEEL_DELTA;
+    long long target = static_cast<long long>(m_model.GetFirstVisibleRow()) + delta;
+    ScrollToRow(target > 0 ? static_cast<uint64_t>(target) : 0);
+    return TRUE;
+}
+
+// ============ 鼠标 ============
+
+void CTextEditorCtrl::SetCaretFromPoint(CPoint point, bool bExtend)
+{
+    uint64_t firstRow = m_model.GetFirstVisibleRow();
+    uint64_t row = firstRow;
+    if (point.y < 0)
+        row = firstRow > 0 ? firstRow - 1 : 0;
+    else
+        row = firstRow + static_cast<uint64_t>(point.y / m_nLineHeight);
+
+    // 点击在字符右半边时光标落在字符之后
+    int x = max(0, (int)point.x + m_nCharWidth / 2);
+    size_t column = m_model.GetFirstVisibleColumn() + static_cast<size_t>(x / m_nCharWidth);
+
+    m_model.SetCaretFromRowCell(row, column, bExtend);
+    OnCaretChanged(false);
+}
+
+void CTextEditorCtrl::OnLButtonDown(UINT nFlags, CPoint point)
+{
+    SetFocus();
+    SetCapture();
+    m_bSelecting = true;
+    SetCaretFromPoint(point, (nFlags & MK_SHIFT) != 0);
+}
+
+void CTextEditorCtrl::OnLButtonUp(UINT /*nFlags*/, CPoint /*point*/)
+{
+    if (m_bSelecting)
+    {
+        m_bSelecting = false;
+        ReleaseCapture();
+    }
+}
+
+void CTextEditorCtrl::OnMouseMove(UINT nFlags, CPoint point)
+{
+    if (m_bSelecting && (nFlags & MK_LBUTTON))
+        SetCaretFromPoint(point, true);
+}
+
+// ============ 键盘 ============
+
+UINT CTextEditorCtrl::OnGetDlgCode()
+{
+    return DLGC_WANTALLKEYS | DLGC_WANTARROWS | DLGC_WANTCHARS;
+}
+
+void CTextEditorCtrl::OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags)
+{
+    bool bShift = ::GetKeyState(VK_SHIFT) < 0;
+    bool bCtrl = ::GetKeyState(VK_CONTROL) < 0;
+
+    switch (nChar)
+    {
+    case VK_LEFT:
+        m_model.MoveCaret(CaretMove::Left, bShift);
+        break;
+    case VK_RIGHT:
+        m_model.MoveCaret(CaretMove::Right, bShift);
+        break;
+    case VK_UP:
+        m_model.MoveCaret(CaretMove::Up, bShift);
+        break;
+    case VK_DOWN:
+        m_model.MoveCaret(CaretMove::Down, bShift);
+        break;
+    case VK_PRIOR:
+        m_model.MoveCaret(CaretMove::PageUp, bShift);
+        break;
+    case VK_NEXT:
+        m_model.MoveCaret(CaretMove::PageDown, bShift);
+        break;
+    case VK_HOME:
+        m_model.MoveCaret(bCtrl ? CaretMove::DocStart : CaretMove::LineStart, bShift);
+        break;
+    case VK_END:
+        m_model.MoveCaret(bCtrl ? CaretMove::DocEnd : CaretMove::LineEnd, bShift);
+        break;
+    case VK_DELETE:
+        if (m_model.DeleteForward())
+            OnCaretChanged(true);
+        return;
+    case 'A':
+        if (!bCtrl)
+            return;
+        m_model.SelectAll();
+        break;
+    default:
+        CWnd::OnKeyDown(nChar, nRepCnt, nFlags);
+        return;
+    }
+    OnCaretChanged(false);
+}
+
+void CTextEditorCtrl::OnChar(UINT nChar, UINT /*nRepCnt*/, UINT /*nFlags*/)
+{
+    wchar_t ch = static_cast<wchar_t>(nChar);
+    if (ch == VK_BACK)
+    {
+        if (m_model.DeleteBackward())
+            OnCaretChanged(true);
+        return;
+    }
+    if (ch == L'\r')
+    {
+        m_model.InsertLineBreak();
+        OnCaretChanged(true);
+        return;
+    }
+    // Ctrl 组合键产生的控制字符不插入
+    if (ch < 0x20 && ch != L'\t')
+        return;
+
+    if (IS_HIGH_SURROGATE(ch))
+    {
+        m_chPendingHigh = ch;
+        return;
+    }
+
+    char16_t units[2];
+    size_t nUnits = 0;
+    if (IS_LOW_SURROGATE(ch) && m_chPendingHigh)
+        units[nUnits++] = static_cast<char16_t>(m_chPendingHigh);
+    units[nUnits++] = static_cast<char16_t>(ch);
+    m_chPendingHigh = 0;
+
+    m_model.InsertText(units, nUnits);
+    OnCaretChanged(true);
+}
+
+void CTextEditorCtrl::OnSetFocus(CWnd* pOldWnd)
+{
+    CWnd::OnSetFocus(pOldWnd);
+    CreateSolidCaret(2, m_nLineHeight);
+    ShowCaret();
+    UpdateCaretPos();
+}
+
+void CTextEditorCtrl::OnKillFocus(CWnd* pNewWnd)
+{
+    CWnd::OnKillFocus(pNewWnd);
+    ::DestroyCaret();
+}
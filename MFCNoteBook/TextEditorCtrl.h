@@ -0,0 +1,128 @@
+﻿// TextEditorCtrl.h - 超大文件使用的虚拟化自绘编辑控件
+//
+// 直接显示文档的片段表缓冲区：每次只解码并绘制可见的几十行，光标和选区都是字节偏移，
+// 打开 1 GB 的文件也不会生成整篇文本的副本。向父窗口发送 EN_CHANGE/EN_VSCROLL，
+// 与 CEdit 的通知方式一致，视图可以用同样的方式刷新行号区。
+// 自动换行时只立即折行可见的几行，其余各行在空闲时由定时器分批补算。
+// 超长行按块排版，只解码可见列所在的几块。
+#pragma once
+
+#include "PastePipeline.h"
+#include "TextEditorModel.h"
+
+#include <vector>
+
+#define TEXTEDITOR_CLASSNAME        _T("MFCNoteBookTextEditor")
+#define TEXTEDITOR_WHEEL_LINES      3
+#define TEXTEDITOR_REFLOW_TIMER     1
+#define TEXTEDITOR_REFLOW_LINES     2000    // 每次定时器补算的行数
+
+class CTextEditorCtrl : public CWnd
+{
+public:
+    CTextEditorCtrl();
+    virtual ~CTextEditorCtrl();
+
+    BOOL Create(DWORD dwStyle, const RECT& rect, CWnd* pParentWnd, UINT nID);
+
+    // 绑定文档的缓冲区（重置光标、滚动位置和撤销记录）
+    void SetBuffer(TestableLogic::TextBuffer* pBuffer, TestableLogic::LineEnding lineBreak);
+    // 缓冲区的原始内容将被整体替换为相同内容（如保存后重新映射）：替换前调用 PrepareReload
+    // 改写撤销快照，替换后调用 ReloadBuffer；光标、滚动位置和撤销记录都保留
+    void PrepareReload() { m_model.PrepareReload(); }
+    void ReloadBuffer();
+
+    void SetColors(COLORREF clrBg, COLORREF clrText);
+
+    // 使用已知度量的字体（来自字体缓存），不再测量；WM_SETFONT 仍会自行测量
+    void SetFontMetrics(CFont* pFont, int nCharWidth, int nLineHeight);
+
+    void SetWordWrap(bool bWrap);
+    bool IsWordWrap() const { return m_model.IsWordWrap(); }
+
+    size_t GetFirstVisibleLine() const { return m_model.GetFirstVisibleLine(); }
+    uint64_t GetFirstVisibleRow() const { return m_model.GetFirstVisibleRow(); }
+    // 从第一可见行开始每个可视行的行号（从 1 开始，续行为 0）
+    void GetVisibleRowLines(size_t rows, std::vector<uint64_t>& lines) const { m_model.GetVisibleRowLines(rows, lines); }
+    size_t GetLineCount() const;
+    bool HasSelection() const { return !m_model.GetSelection().IsEmpty(); }
+    // 选区的字节偏移
+    void GetSel(size_t& nStart, size_t& nEnd) const;
+
+    bool CanUndo() const { return m_model.CanUndo(); }
+    bool CanRedo() const { return m_model.CanRedo(); }
+    void Undo();
+    void Redo();
+
+    void Cut();
+    void Copy();
+    void Paste();
+    // 插入已在别处（如后台线程）准备好的粘贴内容，换行须已按 GetLineBreak 转换
+    void InsertPrepared(const TestableLogic::PreparedPaste& paste);
+    TestableLogic::LineEnding GetLineBreak() const { return m_model.GetLineBreak(); }
+
+    // 按块读取剪贴板中的 Unicode 文本；剪贴板中没有文本时返回 false
+    static bool ReadClipboardText(HWND hOwner, std::u16string& text);
+    // 写入剪贴板，换行按约定转换为 CRLF
+    static bool WriteClipboardText(HWND hOwner, const char16_t* pText, size_t nLen);
+
+    // 查找下一个（UTF-8 字节串，不支持正则），找到时选中并滚动到该处
+    bool FindNext(const std::string& utf8, bool bMatchCase, bool bWholeWord, bool* pWrapped);
+
+protected:
+    TestableLogic::TextEditorModel m_model;
+    HFONT m_hFont;
+    int m_nCharWidth;
+    int m_nLineHeight;
+    size_t m_nMaxColumns;       // 已绘制过的最长行的列数，用作水平滚动范围
+    COLORREF m_clrBg;
+    COLORREF m_clrText;
+    wchar_t m_chPendingHigh;    // WM_CHAR 分两次送来的代理对的高位
+    bool m_bSelecting;
+
+    // 绘制时复用的缓冲区
+    std::vector<size_t> m_unitOffsets;
+    std::vector<int> m_cellColumns;
+    std::vector<int> m_dx;
+    std::vector<size_t> m_wrapPoints;
+    TestableLogic::LineSlice m_slice;
+
+    void UpdateMetrics();
+    void ApplyMetrics();
+    void UpdateViewport();
+    void UpdateScrollBars();
+    void UpdateCaretPos();
+    void NotifyParent(UINT nCode);
+
+    // 光标移动或内容修改之后：滚动到光标、刷新并通知父窗口
+    void OnCaretChanged(bool bContentChanged);
+    void ScrollToRow(uint64_t row);
+    void SetCaretFromPoint(CPoint point, bool bExtend);
+    void ScheduleReflow();
+
+    // 从第 subRow 个可视行开始绘制一个逻辑行，y 前进到下一行
+    void DrawLine(CDC* pDC, size_t line, size_t subRow, int& y, const CRect& rcClient);
+    // 绘制一个可视行：pCells 为每个单元的列宽，startColumn 为 pText[0] 所在的列
+    void DrawRow(CDC* pDC, const char16_t* pText, const size_t* pOffsets, const int* pCells, size_t length,
+        size_t startColumn, bool bLineEnd, int y, const CRect& rcClient);
+
+    afx_msg void OnPaint();
+    afx_msg BOOL OnEraseBkgnd(CDC* pDC);
+    afx_msg void OnSize(UINT nType, int cx, int cy);
+    afx_msg void OnTimer(UINT_PTR nIDEvent);
+    afx_msg void OnVScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar);
+    afx_msg void OnHScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar);
+    afx_msg BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
+    afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
+    afx_msg void OnLButtonUp(UINT nFlags, CPoint point);
+    afx_msg void OnMouseMove(UINT nFlags, CPoint point);
+    afx_msg void OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags);
+    afx_msg void OnChar(UINT nChar, UINT nRepCnt, UINT nFlags);
+    afx_msg void OnSetFocus(CWnd* pOldWnd);
+    afx_msg void OnKillFocus(CWnd* pNewWnd);
+    afx_msg UINT OnGetDlgCode();
+    afx_msg LRESULT OnSetFont(WPARAM wParam, LPARAM lParam);
+    afx_msg LRESULT OnGetFont(WPARAM wParam, LPARAM lParam);
+
+    DECLARE_MESSAGE_MAP()
+};
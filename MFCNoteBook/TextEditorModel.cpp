@@ -0,0 +1,1065 @@
+﻿// TextEditorModel.cpp - 自绘编辑器模型实现
+#include "TextEditorModel.h"
+#include "TextLayout.h"
+#include "TextCodec.h"
+
+#include <algorithm>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        // 与 TextBuffer::NextCharBoundary 的划分一致地解码一行：
+        // 不完整或非法的序列（首字节加上紧随的续字节）整体记为一个 U+FFFD
+        void DecodeLine(const char* bytes, size_t len, size_t baseOffset, std::u16string& text,
+            std::vector<size_t>* pUnitOffsets)
+        {
+            text.clear();
+            text.reserve(len);
+            if (pUnitOffsets)
+            {
+                pUnitOffsets->clear();
+                pUnitOffsets->reserve(len + 1);
+            }
+
+            size_t i = 0;
+            while (i < len)
+            {
+                unsigned char lead = static_cast<unsigned char>(bytes[i]);
+                size_t need = (lead < 0xC0) ? 0 : (lead < 0xE0) ? 1 : (lead < 0xF0) ? 2 : 3;
+                size_t have = 0;
+                while (have < need && i + 1 + have < len &&
+                    (static_cast<unsigned char>(bytes[i + 1 + have]) & 0xC0) == 0x80)
+                    have++;
+
+                uint32_t cp;
+                if (lead >= 0x80 && (lead < 0xC0 || have < need))
+                {
+                    cp = UTF16_REPLACEMENT_CHAR;
+                }
+                else
+                {
+                    static const unsigned char leadMask[] = { 0x7F, 0x1F, 0x0F, 0x07 };
+                    cp = lead & leadMask[need];
+                    for (size_t k = 0; k < need; k++)
+                        cp = (cp << 6) | (static_cast<unsigned char>(bytes[i + 1 + k]) & 0x3F);
+                }
+
+                if (cp >= 0x10000)
+                {
+                    cp -= 0x10000;
+                    text += static_cast<char16_t>(0xD800 + (cp >> 10));
+                    text += static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+                    if (pUnitOffsets)
+                        pUnitOffsets->insert(pUnitOffsets->end(), 2, baseOffset + i);
+                }
+                else
+                {
+                    text += static_cast<char16_t>(cp);
+                    if (pUnitOffsets)
+                        pUnitOffsets->push_back(baseOffset + i);
+                }
+                i += 1 + have;
+            }
+
+            if (pUnitOffsets)
+                pUnitOffsets->push_back(baseOffset + len);
+        }
+
+        const char* LineBreakBytes(LineEnding ending)
+        {
+            switch (ending)
+            {
+            case LineEnding::Lf:    return "\n";
+            case LineEnding::Cr:    return "\r";
+            default:                return "\r\n";
+            }
+        }
+    }
+
+    TextEditorModel::TextEditorModel()
+        : m_pBuffer(nullptr)
+        , m_lineBreak(LineEnding::CrLf)
+        , m_desiredColumn(0)
+        , m_visibleRows(1)
+        , m_visibleColumns(1)
+        , m_firstLine(0)
+        , m_firstSubRow(0)
+        , m_firstColumn(0)
+        , m_bWordWrap(false)
+        , m_reflowCursor(0)
+        , m_longLineClock(0)
+        , m_changeCount(0)
+    {
+        m_selection.anchor = 0;
+        m_selection.caret = 0;
+    }
+
+    void TextEditorModel::SetBuffer(TextBuffer* pBuffer)
+    {
+        m_pBuffer = pBuffer;
+        m_selection.anchor = 0;
+        m_selection.caret = 0;
+        m_desiredColumn = 0;
+        m_firstLine = 0;
+        m_firstSubRow = 0;
+        m_firstColumn = 0;
+        m_undo.clear();
+        m_redo.clear();
+        m_changeCount++;
+        m_longLines.clear();
+        ResetWrapLayout();
+    }
+
+    void TextEditorModel::PrepareReload()
+    {
+        if (!m_pBuffer)
+            return;
+
+        std::vector<TextBuffer::PieceList*> lists;
+        lists.reserve(m_undo.size() + m_redo.size());
+        for (UndoState& state : m_undo)
+            lists.push_back(&state.pieces);
+        for (UndoState& state : m_redo)
+            lists.push_back(&state.pieces);
+        m_pBuffer->RebasePieces(lists);
+    }
+
+    void TextEditorModel::ReloadBuffer()
+    {
+        // 片段换了，超长行的分块索引按需重建；折行结果只取决于内容，仍然有效
+        m_longLines.clear();
+        SetSelection(m_selection.anchor, m_selection.caret);
+    }
+
+    // ============ 视口 ============
+
+    void TextEditorModel::SetViewport(size_t rows, size_t columns)
+    {
+        m_visibleRows = (std::max)(rows, static_cast<size_t>(1));
+        m_visibleColumns = (std::max)(columns, static_cast<size_t>(1));
+        if (!m_bWordWrap)
+        {
+            SetFirstVisibleLine(m_firstLine);
+            return;
+        }
+
+        // 宽度变化时折行全部失效，之后按需重新计算
+        if (m_wrap.GetWrapColumns() != m_visibleColumns)
+        {
+            m_wrap.SetWrapColumns(m_visibleColumns);
+            m_reflowCursor = 0;
+        }
+        ClampFirstRow();
+    }
+
+    size_t TextEditorModel::GetMaxFirstVisibleLine() const
+    {
+        if (m_bWordWrap)
+            return m_wrap.GetLineFromRow(GetMaxFirstVisibleRow());
+
+        size_t lines = m_pBuffer ? m_pBuffer->GetLineCount() : 1;
+        return (lines > m_visibleRows) ? lines - m_visibleRows : 0;
+    }
+
+    void TextEditorModel::SetFirstVisibleLine(size_t line)
+    {
+        if (m_bWordWrap)
+        {
+            SetFirstVisibleRow(m_wrap.GetRowFromLine((std::min)(line, m_wrap.GetLineCount() - 1)));
+            return;
+        }
+        m_firstLine = (std::min)(line, GetMaxFirstVisibleLine());
+    }
+
+    bool TextEditorModel::EnsureCaretVisible()
+    {
+        if (!m_pBuffer)
+            return false;
+
+        if (m_bWordWrap)
+        {
+            size_t oldLine = m_firstLine;
+            size_t oldSubRow = m_firstSubRow;
+            uint64_t caretRow = GetCaretRow();
+            uint64_t firstRow = GetFirstVisibleRow();
+            if (caretRow < firstRow)
+                SetFirstVisibleRow(caretRow);
+            else if (caretRow >= firstRow + m_visibleRows)
+                SetFirstVisibleRow(caretRow - m_visibleRows + 1);
+            return m_firstLine != oldLine || m_firstSubRow != oldSubRow;
+        }
+
+        size_t oldLine = m_firstLine;
+        size_t oldColumn = m_firstColumn;
+
+        size_t line = GetCaretLine();
+        if (line < m_firstLine)
+            m_firstLine = line;
+        else if (line >= m_firstLine + m_visibleRows)
+            m_firstLine = line - m_visibleRows + 1;
+
+        size_t column = GetCaretColumn();
+        if (column < m_firstColumn)
+            m_firstColumn = column;
+        else if (column >= m_firstColumn + m_visibleColumns)
+            m_firstColumn = column - m_visibleColumns + 1;
+
+        return m_firstLine != oldLine || m_firstColumn != oldColumn;
+    }
+
+    // ============ 自动换行 ============
+
+    void TextEditorModel::SetWordWrap(bool bWrap)
+    {
+        if (bWrap == m_bWordWrap)
+            return;
+
+        // 保持第一可见的逻辑行不变
+        m_bWordWrap = bWrap;
+        m_firstSubRow = 0;
+        m_firstColumn = 0;
+        ResetWrapLayout();
+        SetFirstVisibleLine(m_firstLine);
+        UpdateDesiredColumn();
+    }
+
+    void TextEditorModel::ResetWrapLayout()
+    {
+        m_reflowCursor = 0;
+        if (m_bWordWrap)
+            m_wrap.Reset(m_pBuffer ? m_pBuffer->GetLineCount() : 1, m_visibleColumns);
+    }
+
+    uint64_t TextEditorModel::GetTotalRows() const
+    {
+        if (m_bWordWrap)
+            return m_wrap.GetTotalRows();
+        return m_pBuffer ? m_pBuffer->GetLineCount() : 1;
+    }
+
+    uint64_t TextEditorModel::GetFirstVisibleRow() const
+    {
+        if (m_bWordWrap)
+            return m_wrap.GetRowFromLine(m_firstLine) + m_firstSubRow;
+        return m_firstLine;
+    }
+
+    uint64_t TextEditorModel::GetMaxFirstVisibleRow() const
+    {
+        uint64_t rows = GetTotalRows();
+        return (rows > m_visibleRows) ? rows - m_visibleRows : 0;
+    }
+
+    void TextEditorModel::SetFirstVisibleRow(uint64_t row)
+    {
+        if (!m_bWordWrap)
+        {
+            SetFirstVisibleLine(static_cast<size_t>(row));
+            return;
+        }
+        row = (std::min)(row, GetMaxFirstVisibleRow());
+        m_firstLine = m_wrap.GetLineFromRow(row, &m_firstSubRow);
+        m_firstColumn = 0;
+    }
+
+    // 编辑或重新折行之后，第一可见行仍需落在文档和该行的可视行范围内
+    void TextEditorModel::ClampFirstRow()
+    {
+        size_t lastLine = m_wrap.GetLineCount() - 1;
+        if (m_firstLine > lastLine)
+        {
+            m_firstLine = lastLine;
+            m_firstSubRow = 0;
+        }
+        m_firstSubRow = (std::min)(m_firstSubRow, LayoutLine(m_firstLine) - 1);
+        if (GetFirstVisibleRow() > GetMaxFirstVisibleRow())
+            SetFirstVisibleRow(GetMaxFirstVisibleRow());
+    }
+
+    size_t TextEditorModel::LayoutLine(size_t line) const
+    {
+        if (m_wrap.IsLineValid(line))
+            return m_wrap.GetLineRows(line);
+
+        // 超长行的可视行数在建立分块索引时已逐块算好
+        if (const LineChunkIndex* pIndex = GetLongLineIndex(line))
+        {
+            m_wrap.SetLineRows(line, pIndex->GetRows());
+            return pIndex->GetRows();
+        }
+
+        std::u16string text = GetLineText(line);
+        std::vector<size_t> points;
+        GetWrapPoints(line, text, points);
+        return points.size();
+    }
+
+    void TextEditorModel::GetWrapPoints(size_t line, const std::u16string& text, std::vector<size_t>& points) const
+    {
+        if (!m_bWordWrap)
+        {
+            points.assign(1, 0);
+            return;
+        }
+        points = ComputeWrapPoints(text.data(), text.size(), m_wrap.GetWrapColumns());
+        if (line < m_wrap.GetLineCount())
+            m_wrap.SetLineRows(line, points.size());
+    }
+
+    void TextEditorModel::LayoutVisibleLines()
+    {
+        if (!m_bWordWrap)
+            return;
+
+        size_t lineCount = m_wrap.GetLineCount();
+        size_t needed = m_firstSubRow + m_visibleRows + 1;
+        size_t rows = 0;
+        for (size_t line = m_firstLine; line < lineCount && rows < needed; line++)
+            rows += LayoutLine(line);
+    }
+
+    size_t TextEditorModel::ReflowPending(size_t maxLines)
+    {
+        if (!m_bWordWrap)
+            return 0;
+
+        size_t lineCount = m_wrap.GetLineCount();
+        for (size_t i = 0; i < maxLines; i++)
+        {
+            size_t line = m_wrap.FindInvalidLine(m_reflowCursor);
+            if (line >= lineCount)
+                break;
+            LayoutLine(line);
+            m_reflowCursor = line + 1;
+        }
+        return m_wrap.GetInvalidCount();
+    }
+
+    void TextEditorModel::GetVisibleRowLines(size_t rows, std::vector<uint64_t>& lines) const
+    {
+        lines.assign(rows, 0);
+        size_t lineCount = m_pBuffer ? m_pBuffer->GetLineCount() : 1;
+        size_t line = m_firstLine;
+        size_t subRow = m_bWordWrap ? m_firstSubRow : 0;
+        for (size_t r = 0; r < rows && line < lineCount; r++)
+        {
+            if (subRow == 0)
+                lines[r] = static_cast<uint64_t>(line) + 1;
+            if (!m_bWordWrap || ++subRow >= LayoutLine(line))
+            {
+                line++;
+                subRow = 0;
+            }
+        }
+    }
+
+    void TextEditorModel::LocateOffset(size_t offset, size_t& line, size_t& subRow, size_t& column) const
+    {
+        line = m_pBuffer->GetLineFromOffset(offset);
+        subRow = 0;
+        if (!m_bWordWrap)
+        {
+            column = ColumnFromOffset(offset);
+            return;
+        }
+
+        // 超长行只解码偏移所在的块，块内的可视行接在前面各块之后
+        std::vector<size_t> offsets;
+        std::u16string text;
+        std::vector<size_t> points;
+        size_t rowBase = 0;
+        size_t lineStart;
+        if (const LineChunkIndex* pIndex = GetLongLineIndex(line, &lineStart))
+        {
+            size_t chunk = pIndex->FindChunkByByte(offset - lineStart);
+            DecodeChunks(lineStart, *pIndex, chunk, chunk, text, offsets);
+            points = ComputeWrapPoints(text.data(), text.size(), pIndex->GetWrapColumns());
+            rowBase = pIndex->GetRowStart(chunk);
+        }
+        else
+        {
+            text = GetLineText(line, &offsets);
+            GetWrapPoints(line, text, points);
+        }
+
+        size_t index = static_cast<size_t>(std::lower_bound(offsets.begin(), offsets.end(), offset) - offsets.begin());
+        index = (std::min)(index, text.size());
+        size_t k = static_cast<size_t>(std::upper_bound(points.begin(), points.end(), index) - points.begin()) - 1;
+        size_t begin = points[k];
+        subRow = rowBase + k;
+        column = ColumnFromIndex(text.data() + begin, text.size() - begin, index - begin);
+    }
+
+    size_t TextEditorModel::OffsetFromRowCell(size_t line, size_t subRow, size_t column) const
+    {
+        if (!m_bWordWrap)
+            return OffsetFromCell(line, column);
+
+        std::vector<size_t> offsets;
+        std::u16string text;
+        std::vector<size_t> points;
+        bool bLineEnd = true;
+        size_t lineStart;
+        if (const LineChunkIndex* pIndex = GetLongLineIndex(line, &lineStart))
+        {
+            size_t chunk = pIndex->FindChunkByRow(subRow);
+            DecodeChunks(lineStart, *pIndex, chunk, chunk, text, offsets);
+            points = ComputeWrapPoints(text.data(), text.size(), pIndex->GetWrapColumns());
+            subRow = (subRow > pIndex->GetRowStart(chunk)) ? subRow - pIndex->GetRowStart(chunk) : 0;
+            bLineEnd = (chunk + 1 == pIndex->GetChunkCount());
+        }
+        else
+        {
+            text = GetLineText(line, &offsets);
+            GetWrapPoints(line, text, points);
+        }
+        subRow = (std::min)(subRow, points.size() - 1);
+
+        bool bLastRow = bLineEnd && subRow + 1 == points.size();
+        size_t begin = points[subRow];
+        size_t end = (subRow + 1 < points.size()) ? points[subRow + 1] : text.size();
+        size_t index = begin + IndexFromColumn(text.data() + begin, end - begin, column);
+
+        // 非最后一个可视行的行尾就是下一可视行的开头，光标停在该行最后一个字符之前
+        if (!bLastRow && index >= end && end > begin)
+        {
+            index = end - 1;
+            if (index > begin && (text[index] & 0xFC00) == 0xDC00)
+                index--;
+        }
+        return offsets[index];
+    }
+
+    uint64_t TextEditorModel::GetCaretRow() const
+    {
+        if (!m_bWordWrap || !m_pBuffer)
+            return GetCaretLine();
+
+        size_t line, subRow, column;
+        LocateOffset(m_selection.caret, line, subRow, column);
+        return m_wrap.GetRowFromLine(line) + subRow;
+    }
+
+    size_t TextEditorModel::GetCaretRowColumn() const
+    {
+        if (!m_bWordWrap || !m_pBuffer)
+            return GetCaretColumn();
+
+        size_t line, subRow, column;
+        LocateOffset(m_selection.caret, line, subRow, column);
+        return column;
+    }
+
+    // ============ 光标与选区 ============
+
+    void TextEditorModel::SetCaret(size_t offset, bool bExtend)
+    {
+        m_selection.caret = offset;
+        if (!bExtend)
+            m_selection.anchor = offset;
+    }
+
+    void TextEditorModel::SetSelection(size_t anchor, size_t caret)
+    {
+        size_t len = m_pBuffer ? m_pBuffer->GetLength() : 0;
+        m_selection.anchor = (std::min)(anchor, len);
+        m_selection.caret = (std::min)(caret, len);
+        UpdateDesiredColumn();
+    }
+
+    void TextEditorModel::SelectAll()
+    {
+        SetSelection(0, m_pBuffer ? m_pBuffer->GetLength() : 0);
+    }
+
+    size_t TextEditorModel::GetCaretLine() const
+    {
+        return m_pBuffer ? m_pBuffer->GetLineFromOffset(m_selection.caret) : 0;
+    }
+
+    size_t TextEditorModel::GetCaretColumn() const
+    {
+        return ColumnFromOffset(m_selection.caret);
+    }
+
+    void TextEditorModel::UpdateDesiredColumn()
+    {
+        m_desiredColumn = GetCaretRowColumn();
+    }
+
+    // 自动换行时上下移动按可视行
+    void TextEditorModel::MoveVerticalRows(long long rows, bool bExtend)
+    {
+        size_t line, subRow, column;
+        LocateOffset(m_selection.caret, line, subRow, column);
+        size_t lastLine = m_pBuffer->GetLineCount() - 1;
+
+        for (; rows > 0; rows--)
+        {
+            if (subRow + 1 < LayoutLine(line))
+            {
+                subRow++;
+            }
+            else if (line < lastLine)
+            {
+                line++;
+                subRow = 0;
+            }
+            else
+            {
+                SetCaret(m_pBuffer->GetLength(), bExtend);
+                return;
+            }
+        }
+        for (; rows < 0; rows++)
+        {
+            if (subRow > 0)
+            {
+                subRow--;
+            }
+            else if (line > 0)
+            {
+                line--;
+                subRow = LayoutLine(line) - 1;
+            }
+            else
+            {
+                SetCaret(0, bExtend);
+                return;
+            }
+        }
+        SetCaret(OffsetFromRowCell(line, subRow, m_desiredColumn), bExtend);
+    }
+
+    void TextEditorModel::MoveVertical(long long lines, bool bExtend)
+    {
+        if (m_bWordWrap)
+        {
+            MoveVerticalRows(lines, bExtend);
+            return;
+        }
+
+        size_t line = GetCaretLine();
+        size_t lastLine = m_pBuffer->GetLineCount() - 1;
+        long long target = static_cast<long long>(line) + lines;
+
+        if (target < 0)
+            SetCaret(0, bExtend);
+        else if (static_cast<size_t>(target) > lastLine)
+            SetCaret(m_pBuffer->GetLength(), bExtend);
+        else
+            SetCaret(OffsetFromCell(static_cast<size_t>(target), m_desiredColumn), bExtend);
+    }
+
+    void TextEditorModel::MoveCaret(CaretMove move, bool bExtend)
+    {
+        if (!m_pBuffer)
+            return;
+
+        size_t caret = m_selection.caret;
+        long long page = static_cast<long long>(m_visibleRows > 1 ? m_visibleRows - 1 : 1);
+        switch (move)
+        {
+        case CaretMove::Left:
+            if (!bExtend && !m_selection.IsEmpty())
+                SetCaret(m_selection.Start(), false);
+            else
+                SetCaret(m_pBuffer->PrevCharBoundary(caret), bExtend);
+            break;
+        case CaretMove::Right:
+            if (!bExtend && !m_selection.IsEmpty())
+                SetCaret(m_selection.End(), false);
+            else
+                SetCaret(m_pBuffer->NextCharBoundary(caret), bExtend);
+            break;
+        case CaretMove::Up:
+            MoveVertical(-1, bExtend);
+            return;
+        case CaretMove::Down:
+            MoveVertical(1, bExtend);
+            return;
+        case CaretMove::PageUp:
+        {
+            uint64_t firstRow = GetFirstVisibleRow();
+            SetFirstVisibleRow(firstRow > static_cast<uint64_t>(page) ? firstRow - static_cast<uint64_t>(page) : 0);
+            MoveVertical(-page, bExtend);
+            return;
+        }
+        case CaretMove::PageDown:
+            SetFirstVisibleRow(GetFirstVisibleRow() + static_cast<uint64_t>(page));
+            MoveVertical(page, bExtend);
+            return;
+        case CaretMove::LineStart:
+            SetCaret(m_pBuffer->GetLineStart(GetCaretLine()), bExtend);
+            break;
+        case CaretMove::LineEnd:
+            SetCaret(m_pBuffer->GetLineEnd(GetCaretLine()), bExtend);
+            break;
+        case CaretMove::DocStart:
+            SetCaret(0, bExtend);
+            break;
+        case CaretMove::DocEnd:
+            SetCaret(m_pBuffer->GetLength(), bExtend);
+            break;
+        }
+        UpdateDesiredColumn();
+    }
+
+    void TextEditorModel::SetCaretFromCell(size_t line, size_t column, bool bExtend)
+    {
+        if (!m_pBuffer)
+            return;
+        line = (std::min)(line, m_pBuffer->GetLineCount() - 1);
+        SetCaret(OffsetFromCell(line, column), bExtend);
+        UpdateDesiredColumn();
+    }
+
+    void TextEditorModel::SetCaretFromRowCell(uint64_t row, size_t column, bool bExtend)
+    {
+        if (!m_pBuffer)
+            return;
+        if (!m_bWordWrap)
+        {
+            SetCaretFromCell(static_cast<size_t>((std::min)(row, static_cast<uint64_t>(SIZE_MAX))), column, bExtend);
+            return;
+        }
+
+        size_t subRow = 0;
+        size_t line = m_wrap.GetLineFromRow(row, &subRow);
+        SetCaret(OffsetFromRowCell(line, subRow, column), bExtend);
+        UpdateDesiredColumn();
+    }
+
+    // ============ 编辑 ============
+
+    void TextEditorModel::PushUndo()
+    {
+        UndoState state;
+        state.pieces = m_pBuffer->GetPieces();
+        state.selection = m_selection;
+        m_undo.push_back(state);
+        if (m_undo.size() > TEXTEDITOR_MAX_UNDO)
+            m_undo.erase(m_undo.begin());
+        m_redo.clear();
+    }
+
+    void TextEditorModel::ReplaceSelection(const std::string& utf8, const SparseLineIndex* pIndex)
+    {
+        if (!m_pBuffer || (utf8.empty() && m_selection.IsEmpty()))
+            return;
+
+        PushUndo();
+        size_t start = m_selection.Start();
+        size_t oldLen = m_selection.End() - start;
+        size_t startLine = 0;
+        size_t endLine = 0;
+        bool bTrackLines = m_bWordWrap || !m_longLines.empty();
+        if (bTrackLines)
+        {
+            startLine = m_pBuffer->GetLineFromOffset(start);
+            endLine = m_pBuffer->GetLineFromOffset(m_selection.End());
+        }
+
+        m_pBuffer->Erase(start, oldLen);
+        if (pIndex)
+            m_pBuffer->Insert(start, utf8.data(), utf8.size(), *pIndex);
+        else
+            m_pBuffer->Insert(start, utf8.data(), utf8.size());
+
+        size_t newEndLine = bTrackLines ? m_pBuffer->GetLineFromOffset(start + utf8.size()) : 0;
+        if (!m_longLines.empty())
+            UpdateLongLines(startLine, endLine, newEndLine, start, oldLen, utf8.size());
+
+        // 只有改动涉及的行需要重新折行
+        if (m_bWordWrap)
+        {
+            m_wrap.ReplaceLines(startLine, endLine - startLine + 1, newEndLine - startLine + 1);
+            if (m_firstLine > endLine)
+                m_firstLine = m_firstLine - endLine + newEndLine;
+            ClampFirstRow();
+        }
+        SetCaret(start + utf8.size(), false);
+        UpdateDesiredColumn();
+        m_changeCount++;
+    }
+
+    void TextEditorModel::InsertText(const char16_t* text, size_t len)
+    {
+        std::u16string converted = ConvertLineEndingsString(text, len, m_lineBreak);
+        ReplaceSelection(Utf16ToUtf8String(converted.data(), converted.size()));
+    }
+
+    void TextEditorModel::InsertPrepared(const std::string& utf8, const SparseLineIndex& index)
+    {
+        ReplaceSelection(utf8, &index);
+    }
+
+    void TextEditorModel::InsertLineBreak()
+    {
+        ReplaceSelection(LineBreakBytes(m_lineBreak));
+    }
+
+    bool TextEditorModel::DeleteSelection()
+    {
+        if (!m_pBuffer || m_selection.IsEmpty())
+            return false;
+        ReplaceSelection(std::string());
+        return true;
+    }
+
+    bool TextEditorModel::DeleteBackward()
+    {
+        if (!m_pBuffer)
+            return false;
+        if (!m_selection.IsEmpty())
+            return DeleteSelection();
+        if (m_selection.caret == 0)
+            return false;
+        m_selection.anchor = m_pBuffer->PrevCharBoundary(m_selection.caret);
+        return DeleteSelection();
+    }
+
+    bool TextEditorModel::DeleteForward()
+    {
+        if (!m_pBuffer)
+            return false;
+        if (!m_selection.IsEmpty())
+            return DeleteSelection();
+        if (m_selection.caret >= m_pBuffer->GetLength())
+            return false;
+        m_selection.anchor = m_pBuffer->NextCharBoundary(m_selection.caret);
+        return DeleteSelection();
+    }
+
+    std::u16string TextEditorModel::GetSelectedText() const
+    {
+        if (!m_pBuffer || m_selection.IsEmpty())
+            return std::u16string();
+        std::string bytes = m_pBuffer->GetText(m_selection.Start(), m_selection.End());
+        return Utf8ToUtf16String(bytes.data(), bytes.size());
+    }
+
+    bool TextEditorModel::FindNext(const std::string& pattern, bool bMatchCase, bool bWholeWord, bool* pWrapped)
+    {
+        if (pWrapped)
+            *pWrapped = false;
+        if (!m_pBuffer || pattern.empty())
+            return false;
+
+        auto isWordByte = [this](size_t offset)
+        {
+            unsigned char c = m_pBuffer->GetByteAt(offset);
+            return c >= 0x80 || c == '_' || (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+        };
+
+        // 第一遍从选区末尾找到文档末尾，第二遍从头找到选区末尾
+        size_t start = m_selection.End();
+        for (int pass = 0; pass < 2; pass++)
+        {
+            size_t pos = (pass == 0) ? start : 0;
+            size_t found;
+            while (m_pBuffer->Find(pattern, pos, bMatchCase, found) && (pass == 0 || found < start))
+            {
+                size_t end = found + pattern.size();
+                if (!bWholeWord || ((found == 0 || !isWordByte(found - 1)) &&
+                    (end >= m_pBuffer->GetLength() || !isWordByte(end))))
+                {
+                    SetSelection(found, end);
+                    if (pWrapped)
+                        *pWrapped = (pass == 1);
+                    return true;
+                }
+                pos = found + 1;
+            }
+            if (start == 0)
+                break;
+        }
+        return false;
+    }
+
+    bool TextEditorModel::Undo()
+    {
+        if (!m_pBuffer || m_undo.empty())
+            return false;
+        UndoState current = { m_pBuffer->GetPieces(), m_selection };
+        m_redo.push_back(current);
+        m_pBuffer->RestorePieces(m_undo.back().pieces);
+        m_selection = m_undo.back().selection;
+        m_undo.pop_back();
+        m_longLines.clear();
+        if (m_bWordWrap)
+        {
+            ResetWrapLayout();
+            ClampFirstRow();
+        }
+        UpdateDesiredColumn();
+        m_changeCount++;
+        return true;
+    }
+
+    bool TextEditorModel::Redo()
+    {
+        if (!m_pBuffer || m_redo.empty())
+            return false;
+        UndoState current = { m_pBuffer->GetPieces(), m_selection };
+        m_undo.push_back(current);
+        m_pBuffer->RestorePieces(m_redo.back().pieces);
+        m_selection = m_redo.back().selection;
+        m_redo.pop_back();
+        m_longLines.clear();
+        if (m_bWordWrap)
+        {
+            ResetWrapLayout();
+            ClampFirstRow();
+        }
+        UpdateDesiredColumn();
+        m_changeCount++;
+        return true;
+    }
+
+    // ============ 行的显示 ============
+
+    std::u16string TextEditorModel::GetLineText(size_t line, std::vector<size_t>* pUnitOffsets) const
+    {
+        std::u16string text;
+        if (!m_pBuffer)
+        {
+            if (pUnitOffsets)
+                pUnitOffsets->assign(1, 0);
+            return text;
+        }
+        size_t start = m_pBuffer->GetLineStart(line);
+        size_t end = m_pBuffer->GetLineEnd(line);
+        std::string bytes = m_pBuffer->GetText(start, end);
+        DecodeLine(bytes.data(), bytes.size(), start, text, pUnitOffsets);
+        return text;
+    }
+
+    size_t TextEditorModel::ColumnFromOffset(size_t offset) const
+    {
+        if (!m_pBuffer)
+            return 0;
+        size_t line = m_pBuffer->GetLineFromOffset(offset);
+        std::vector<size_t> offsets;
+        std::u16string text;
+        size_t baseColumn = 0;
+        size_t lineStart;
+        if (const LineChunkIndex* pIndex = GetLongLineIndex(line, &lineStart))
+        {
+            size_t chunk = pIndex->FindChunkByByte(offset - lineStart);
+            DecodeChunks(lineStart, *pIndex, chunk, chunk, text, offsets);
+            baseColumn = pIndex->GetColumnStart(chunk);
+        }
+        else
+        {
+            text = GetLineText(line, &offsets);
+        }
+        size_t index = static_cast<size_t>(std::lower_bound(offsets.begin(), offsets.end(), offset) - offsets.begin());
+        return baseColumn + ColumnFromIndex(text.data(), text.size(), (std::min)(index, text.size()), baseColumn);
+    }
+
+    size_t TextEditorModel::OffsetFromCell(size_t line, size_t column) const
+    {
+        if (!m_pBuffer)
+            return 0;
+        std::vector<size_t> offsets;
+        std::u16string text;
+        size_t baseColumn = 0;
+        size_t lineStart;
+        if (const LineChunkIndex* pIndex = GetLongLineIndex(line, &lineStart))
+        {
+            size_t chunk = pIndex->FindChunkByColumn(column);
+            DecodeChunks(lineStart, *pIndex, chunk, chunk, text, offsets);
+            baseColumn = pIndex->GetColumnStart(chunk);
+            column -= (std::min)(column, baseColumn);
+        }
+        else
+        {
+            text = GetLineText(line, &offsets);
+        }
+        return offsets[IndexFromColumn(text.data(), text.size(), column, baseColumn)];
+    }
+
+    bool TextEditorModel::GetLongLineSlice(size_t line, size_t subRow, LineSlice& slice) const
+    {
+        size_t lineStart;
+        const LineChunkIndex* pIndex = GetLongLineIndex(line, &lineStart);
+        if (!pIndex)
+            return false;
+
+        size_t first, last;
+        if (m_bWordWrap)
+        {
+            first = last = pIndex->FindChunkByRow(subRow);
+            DecodeChunks(lineStart, *pIndex, first, last, slice.text, slice.offsets);
+            slice.points = ComputeWrapPoints(slice.text.data(), slice.text.size(), pIndex->GetWrapColumns());
+            slice.firstSubRow = pIndex->GetRowStart(first);
+            slice.startColumn = 0;
+            slice.cells.clear();
+        }
+        else
+        {
+            // 覆盖可见列的几块；制表位按各块的起始列对齐
+            first = pIndex->FindChunkByColumn(m_firstColumn);
+            last = pIndex->FindChunkByColumn(m_firstColumn + m_visibleColumns);
+            DecodeChunks(lineStart, *pIndex, first, last, slice.text, slice.offsets);
+            slice.points.assign(1, 0);
+            slice.firstSubRow = 0;
+            slice.startColumn = pIndex->GetColumnStart(first);
+            slice.cells.resize(slice.text.size());
+            std::vector<int> cells;
+            for (size_t chunk = first; chunk <= last; chunk++)
+            {
+                size_t begin = pIndex->GetUnitStart(chunk) - pIndex->GetUnitStart(first);
+                size_t units = pIndex->GetUnitEnd(chunk) - pIndex->GetUnitStart(chunk);
+                GetCellColumns(slice.text.data() + begin, units, cells, pIndex->GetColumnStart(chunk));
+                std::copy(cells.begin(), cells.end(), slice.cells.begin() + begin);
+            }
+        }
+        slice.lineColumns = pIndex->GetColumns();
+        slice.bLineEnd = (last + 1 == pIndex->GetChunkCount());
+        return true;
+    }
+
+    // ============ 超长行 ============
+
+    const LineChunkIndex* TextEditorModel::GetLongLineIndex(size_t line, size_t* pLineStart) const
+    {
+        if (!m_pBuffer)
+            return nullptr;
+
+        size_t start = m_pBuffer->GetLineStart(line);
+        size_t end = m_pBuffer->GetLineEnd(line);
+        if (pLineStart)
+            *pLineStart = start;
+
+        auto it = std::find_if(m_longLines.begin(), m_longLines.end(),
+            [line](const LongLine& entry) { return entry.line == line; });
+        if (end - start < LONG_LINE_BYTES)
+        {
+            if (it != m_longLines.end())
+                m_longLines.erase(it);
+            return nullptr;
+        }
+
+        size_t wrapColumns = m_bWordWrap ? m_wrap.GetWrapColumns() : 0;
+        if (it != m_longLines.end() && it->index.GetWrapColumns() == wrapColumns &&
+            it->index.GetByteLength() == end - start)
+        {
+            it->lastUse = ++m_longLineClock;
+            return &it->index;
+        }
+
+        if (it == m_longLines.end())
+        {
+            if (m_longLines.size() >= TEXTEDITOR_LONG_LINE_CACHE)
+            {
+                m_longLines.erase(std::min_element(m_longLines.begin(), m_longLines.end(),
+                    [](const LongLine& a, const LongLine& b) { return a.lastUse < b.lastUse; }));
+            }
+            m_longLines.push_back(LongLine());
+            it = m_longLines.end() - 1;
+            it->line = line;
+        }
+
+        // 第一次访问（或折行宽度变化）时扫描整行，之后只按块更新
+        std::string bytes = m_pBuffer->GetText(start, end);
+        std::vector<size_t> ends;
+        LineChunkIndex::Split(bytes.data(), bytes.size(), ends);
+        std::vector<LineChunkIndex::ChunkInfo> chunks;
+        MeasureChunks(bytes, ends, wrapColumns, chunks);
+
+        it->index.Clear();
+        it->index.SetWrapColumns(wrapColumns);
+        it->index.ReplaceChunks(0, 0, chunks);
+        it->lastUse = ++m_longLineClock;
+        return &it->index;
+    }
+
+    void TextEditorModel::MeasureChunks(const std::string& bytes, const std::vector<size_t>& ends, size_t wrapColumns,
+        std::vector<LineChunkIndex::ChunkInfo>& chunks) const
+    {
+        chunks.resize(ends.size());
+        std::u16string text;
+        size_t begin = 0;
+        for (size_t i = 0; i < ends.size(); i++)
+        {
+            DecodeLine(bytes.data() + begin, ends[i] - begin, 0, text, nullptr);
+            chunks[i].bytes = ends[i] - begin;
+            chunks[i].units = text.size();
+            size_t tab = text.find(u'\t');
+            chunks[i].bTab = (tab != std::u16string::npos);
+            if (chunks[i].bTab)
+            {
+                chunks[i].headColumns = ColumnFromIndex(text.data(), tab, tab);
+                chunks[i].tailColumns = ColumnFromIndex(text.data() + tab + 1, text.size() - tab - 1, text.size() - tab - 1);
+            }
+            else
+            {
+                chunks[i].headColumns = ColumnFromIndex(text.data(), text.size(), text.size());
+                chunks[i].tailColumns = 0;
+            }
+            chunks[i].rows = wrapColumns ? ComputeWrapPoints(text.data(), text.size(), wrapColumns).size() : 1;
+            begin = ends[i];
+        }
+    }
+
+    void TextEditorModel::DecodeChunks(size_t lineStart, const LineChunkIndex& index, size_t first, size_t last,
+        std::u16string& text, std::vector<size_t>& offsets) const
+    {
+        size_t begin = lineStart + index.GetByteStart(first);
+        std::string bytes = m_pBuffer->GetText(begin, lineStart + index.GetByteEnd(last));
+        DecodeLine(bytes.data(), bytes.size(), begin, text, &offsets);
+    }
+
+    void TextEditorModel::UpdateLongLines(size_t startLine, size_t endLine, size_t newEndLine,
+        size_t start, size_t oldLen, size_t newLen)
+    {
+        for (size_t i = 0; i < m_longLines.size(); )
+        {
+            LongLine& entry = m_longLines[i];
+            if (entry.line < startLine)
+            {
+                i++;
+                continue;
+            }
+            if (entry.line > endLine)
+            {
+                entry.line = entry.line - endLine + newEndLine;
+                i++;
+                continue;
+            }
+
+            // 不跨行的行内编辑：只重新度量编辑点所在的几块
+            LineChunkIndex& index = entry.index;
+            bool bUpdated = false;
+            if (startLine == endLine && endLine == newEndLine)
+            {
+                size_t lineStart = m_pBuffer->GetLineStart(entry.line);
+                size_t lineLength = m_pBuffer->GetLineEnd(entry.line) - lineStart;
+                size_t rel = start - lineStart;
+                if (rel + oldLen <= index.GetByteLength() &&
+                    lineLength == index.GetByteLength() - oldLen + newLen && lineLength >= LONG_LINE_BYTES)
+                {
+                    size_t first, count;
+                    index.GetEditRange(rel, oldLen, first, count);
+                    size_t begin = lineStart + index.GetByteStart(first);
+                    size_t end = lineStart + index.GetByteEnd(first + count - 1) - oldLen + newLen;
+                    std::string bytes = m_pBuffer->GetText(begin, end);
+                    std::vector<size_t> ends;
+                    LineChunkIndex::Split(bytes.data(), bytes.size(), ends);
+                    std::vector<LineChunkIndex::ChunkInfo> chunks;
+                    MeasureChunks(bytes, ends, index.GetWrapColumns(), chunks);
+                    index.ReplaceChunks(first, count, chunks);
+                    bUpdated = true;
+                }
+            }
+
+            if (bUpdated)
+                i++;
+            else
+                m_longLines.erase(m_longLines.begin() + i);
+        }
+    }
+}
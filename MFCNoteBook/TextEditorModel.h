@@ -0,0 +1,233 @@
+﻿// TextEditorModel.h - 自绘编辑器的光标、选区、视口与编辑模型（不依赖MFC）
+//
+// 光标和选区都是 TextBuffer 中的字节偏移，只在需要时解码可见行或光标所在行，
+// 不会复制整篇文本。撤销保存的是片段列表快照（添加缓冲区只追加，快照始终有效）。
+#pragma once
+
+#include "TextBuffer.h"
+#include "LineEnding.h"
+#include "WrapLayoutCache.h"
+#include "LineChunkIndex.h"
+
+#include <string>
+#include <vector>
+
+// 撤销快照上限（每个快照只是片段列表，开销很小）
+#define TEXTEDITOR_MAX_UNDO     1000
+// 保留分块索引的超长行数（按最近使用淘汰）
+#define TEXTEDITOR_LONG_LINE_CACHE  4
+
+namespace TestableLogic
+{
+    struct TextSelection
+    {
+        size_t anchor;          // 选区起点（扩展选区时固定不动的一端）
+        size_t caret;           // 光标位置
+
+        size_t Start() const { return anchor < caret ? anchor : caret; }
+        size_t End() const { return anchor < caret ? caret : anchor; }
+        bool IsEmpty() const { return anchor == caret; }
+    };
+
+    enum class CaretMove
+    {
+        Left,
+        Right,
+        Up,
+        Down,
+        LineStart,
+        LineEnd,
+        PageUp,
+        PageDown,
+        DocStart,
+        DocEnd
+    };
+
+    // 超长行绘制用的一段文本（只含需要绘制的几块）
+    struct LineSlice
+    {
+        std::u16string text;
+        std::vector<size_t> offsets;    // 每个 UTF-16 单元的字节偏移（另加末尾）
+        std::vector<int> cells;         // 不换行时每个单元的列宽
+        std::vector<size_t> points;     // 自动换行时各可视行在 text 中的起始下标
+        size_t firstSubRow;             // points[0] 是该行的第几个可视行
+        size_t startColumn;             // 不换行时 text[0] 所在的列
+        size_t lineColumns;             // 整行的列数
+        bool bLineEnd;                  // text 是否到行尾
+    };
+
+    class TextEditorModel
+    {
+    public:
+        TextEditorModel();
+
+        // 更换缓冲区时重置光标、滚动位置和撤销记录
+        void SetBuffer(TextBuffer* pBuffer);
+        TextBuffer* GetBuffer() const { return m_pBuffer; }
+
+        // 缓冲区的原始内容即将换成当前文档（保存后重新映射）：在旧内容仍有效时调用，
+        // 撤销和重做快照改写为以新原始内容为准
+        void PrepareReload();
+        // 换好之后调用：内容不变，保留光标、滚动位置和撤销记录
+        void ReloadBuffer();
+
+        // 回车和粘贴时插入的换行约定
+        void SetLineBreak(LineEnding ending) { m_lineBreak = ending; }
+        LineEnding GetLineBreak() const { return m_lineBreak; }
+
+        // ============ 视口（以行、列为单位） ============
+
+        void SetViewport(size_t rows, size_t columns);
+        size_t GetVisibleRows() const { return m_visibleRows; }
+        size_t GetVisibleColumns() const { return m_visibleColumns; }
+
+        size_t GetFirstVisibleLine() const { return m_firstLine; }
+        void SetFirstVisibleLine(size_t line);
+        size_t GetMaxFirstVisibleLine() const;
+
+        size_t GetFirstVisibleColumn() const { return m_firstColumn; }
+        void SetFirstVisibleColumn(size_t column) { m_firstColumn = column; }
+
+        // 滚动使光标可见，发生滚动时返回 true
+        bool EnsureCaretVisible();
+
+        // ============ 自动换行 ============
+
+        // 打开后按可见列数折行，水平滚动固定在 0
+        void SetWordWrap(bool bWrap);
+        bool IsWordWrap() const { return m_bWordWrap; }
+
+        // 可视行（不换行时与逻辑行相同）。滚动位置记为逻辑行 + 行内第几个可视行，
+        // 其他行重新折行时不会移动
+        uint64_t GetTotalRows() const;
+        uint64_t GetFirstVisibleRow() const;
+        void SetFirstVisibleRow(uint64_t row);
+        uint64_t GetMaxFirstVisibleRow() const;
+        size_t GetFirstVisibleSubRow() const { return m_firstSubRow; }
+
+        // 行的折行位置（每个可视行起始的 UTF-16 下标），同时记入排版缓存
+        void GetWrapPoints(size_t line, const std::u16string& text, std::vector<size_t>& points) const;
+
+        // 先计算可见区域的折行
+        void LayoutVisibleLines();
+        // 空闲时补算其余行的折行，最多 maxLines 行；返回还剩多少行未计算
+        size_t ReflowPending(size_t maxLines);
+        size_t GetPendingLayoutCount() const { return m_bWordWrap ? m_wrap.GetInvalidCount() : 0; }
+
+        // 从第一可见行开始每个可视行的行号（从 1 开始），续行为 0
+        void GetVisibleRowLines(size_t rows, std::vector<uint64_t>& lines) const;
+
+        // ============ 光标与选区 ============
+
+        const TextSelection& GetSelection() const { return m_selection; }
+        void SetSelection(size_t anchor, size_t caret);
+        void MoveCaret(CaretMove move, bool bExtend);
+        void SelectAll();
+
+        // 鼠标定位：行号 + 列（已加上水平滚动）
+        void SetCaretFromCell(size_t line, size_t column, bool bExtend);
+        // 鼠标定位：可视行 + 可视行内的列
+        void SetCaretFromRowCell(uint64_t row, size_t column, bool bExtend);
+
+        size_t GetCaretLine() const;
+        size_t GetCaretColumn() const;
+
+        // 光标所在的可视行和可视行内的列（不换行时即逻辑行和列）
+        uint64_t GetCaretRow() const;
+        size_t GetCaretRowColumn() const;
+
+        // ============ 编辑 ============
+
+        // 替换选区；文本中的换行统一转换为 SetLineBreak 指定的约定
+        void InsertText(const char16_t* text, size_t len);
+        // 替换选区为已转换换行、编码为 UTF-8 并建立了换行索引的文本（大段粘贴），只记一条撤销
+        void InsertPrepared(const std::string& utf8, const SparseLineIndex& index);
+        void InsertLineBreak();
+        bool DeleteBackward();
+        bool DeleteForward();
+        bool DeleteSelection();
+
+        std::u16string GetSelectedText() const;
+
+        // 从选区末尾向后查找（到末尾后从头再找一遍），找到时选中；
+        // 全字匹配时前后不能紧接字母、数字、下划线或非 ASCII 字符。pWrapped 返回是否从头找到
+        bool FindNext(const std::string& pattern, bool bMatchCase, bool bWholeWord, bool* pWrapped = nullptr);
+
+        bool CanUndo() const { return !m_undo.empty(); }
+        bool CanRedo() const { return !m_redo.empty(); }
+        bool Undo();
+        bool Redo();
+
+        // 每次修改内容加一，视图据此判断是否需要通知文档
+        uint64_t GetChangeCount() const { return m_changeCount; }
+
+        // ============ 行的显示 ============
+
+        // 行文本（不含换行符）；pUnitOffsets 非空时给出每个 UTF-16 单元对应的字节偏移（另加行尾）
+        std::u16string GetLineText(size_t line, std::vector<size_t>* pUnitOffsets = nullptr) const;
+
+        size_t ColumnFromOffset(size_t offset) const;
+        size_t OffsetFromCell(size_t line, size_t column) const;
+
+        // 超长行（不少于 LONG_LINE_BYTES）只解码要绘制的块：不换行时为覆盖可见列的几块，
+        // 自动换行时为第 subRow 个可视行所在的块；普通行返回 false，由调用方整行解码
+        bool GetLongLineSlice(size_t line, size_t subRow, LineSlice& slice) const;
+
+    private:
+        struct UndoState
+        {
+            TextBuffer::PieceList pieces;
+            TextSelection selection;
+        };
+
+        void PushUndo();
+        void ReplaceSelection(const std::string& utf8, const SparseLineIndex* pIndex = nullptr);
+        void SetCaret(size_t offset, bool bExtend);
+        void MoveVertical(long long lines, bool bExtend);
+        void MoveVerticalRows(long long rows, bool bExtend);
+        void UpdateDesiredColumn();
+
+        // 折行：行的可视行数（未计算时计算并记入缓存）、偏移所在的可视行、可视行内的列对应的偏移
+        size_t LayoutLine(size_t line) const;
+        void LocateOffset(size_t offset, size_t& line, size_t& subRow, size_t& column) const;
+        size_t OffsetFromRowCell(size_t line, size_t subRow, size_t column) const;
+        void ResetWrapLayout();
+        void ClampFirstRow();
+
+        // 超长行的分块索引：普通行返回 nullptr；缓存中没有或折行宽度变了时扫描整行建立
+        const LineChunkIndex* GetLongLineIndex(size_t line, size_t* pLineStart = nullptr) const;
+        void MeasureChunks(const std::string& bytes, const std::vector<size_t>& ends, size_t wrapColumns,
+            std::vector<LineChunkIndex::ChunkInfo>& chunks) const;
+        // 解码 [first, last] 块
+        void DecodeChunks(size_t lineStart, const LineChunkIndex& index, size_t first, size_t last,
+            std::u16string& text, std::vector<size_t>& offsets) const;
+        // 编辑后平移或更新缓存的索引：单行内的编辑只重新度量涉及的块
+        void UpdateLongLines(size_t startLine, size_t endLine, size_t newEndLine,
+            size_t start, size_t oldLen, size_t newLen);
+
+        struct LongLine
+        {
+            size_t line;
+            uint64_t lastUse;
+            LineChunkIndex index;
+        };
+
+        TextBuffer* m_pBuffer;
+        LineEnding m_lineBreak;
+        TextSelection m_selection;
+        size_t m_desiredColumn;         // 上下移动时保持的列
+        size_t m_visibleRows;
+        size_t m_visibleColumns;
+        size_t m_firstLine;
+        size_t m_firstSubRow;           // 自动换行时第一可见行是 m_firstLine 的第几个可视行
+        size_t m_firstColumn;
+        bool m_bWordWrap;
+        mutable WrapLayoutCache m_wrap; // 绘制时顺便记录折行结果
+        size_t m_reflowCursor;          // 后台补算的位置
+        mutable std::vector<LongLine> m_longLines;
+        mutable uint64_t m_longLineClock;
+        std::vector<UndoState> m_undo;
+        std::vector<UndoState> m_redo;
+        uint64_t m_changeCount;
+    };
+}
@@ -0,0 +1,152 @@
+﻿// TextLayout.cpp - 等宽网格排版实现
+#include "TextLayout.h"
+
+namespace TestableLogic
+{
+    namespace
+    {
+        inline bool IsHighSurrogate(char16_t c)
+        {
+            return c >= 0xD800 && c <= 0xDBFF;
+        }
+
+        inline bool IsLowSurrogate(char16_t c)
+        {
+            return c >= 0xDC00 && c <= 0xDFFF;
+        }
+
+        // 读取 line[i] 处的码点，返回占用的单元数
+        inline size_t ReadCodePoint(const char16_t* line, size_t len, size_t i, uint32_t& cp)
+        {
+            char16_t c = line[i];
+            if (IsHighSurrogate(c) && i + 1 < len && IsLowSurrogate(line[i + 1]))
+            {
+                cp = 0x10000 + ((static_cast<uint32_t>(c) - 0xD800) << 10) + (line[i + 1] - 0xDC00);
+                return 2;
+            }
+            cp = c;
+            return 1;
+        }
+
+        inline size_t CharColumns(uint32_t cp, size_t column, int tabSize)
+        {
+            if (cp == '\t')
+                return static_cast<size_t>(tabSize) - column % static_cast<size_t>(tabSize);
+            return static_cast<size_t>(GetCodePointColumns(cp));
+        }
+    }
+
+    int GetCodePointColumns(uint32_t cp)
+    {
+        // 组合附加符号、零宽字符
+        if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x200B && cp <= 0x200F) ||
+            (cp >= 0xFE00 && cp <= 0xFE0F))
+            return 0;
+
+        // 东亚宽字符与 emoji
+        if ((cp >= 0x1100 && cp <= 0x115F) ||
+            (cp >= 0x2E80 && cp <= 0x303E) ||
+            (cp >= 0x3041 && cp <= 0x33FF) ||
+            (cp >= 0x3400 && cp <= 0x4DBF) ||
+            (cp >= 0x4E00 && cp <= 0x9FFF) ||
+            (cp >= 0xA000 && cp <= 0xA4CF) ||
+            (cp >= 0xAC00 && cp <= 0xD7A3) ||
+            (cp >= 0xF900 && cp <= 0xFAFF) ||
+            (cp >= 0xFE30 && cp <= 0xFE4F) ||
+            (cp >= 0xFF00 && cp <= 0xFF60) ||
+            (cp >= 0xFFE0 && cp <= 0xFFE6) ||
+            (cp >= 0x1F300 && cp <= 0x1F64F) ||
+            (cp >= 0x1F900 && cp <= 0x1F9FF) ||
+            (cp >= 0x20000 && cp <= 0x3FFFD))
+            return 2;
+
+        return 1;
+    }
+
+    size_t ColumnFromIndex(const char16_t* line, size_t len, size_t index, size_t startColumn, int tabSize)
+    {
+        size_t column = startColumn;
+        size_t i = 0;
+        if (index > len)
+            index = len;
+        while (i < index)
+        {
+            uint32_t cp;
+            size_t units = ReadCodePoint(line, len, i, cp);
+            column += CharColumns(cp, column, tabSize);
+            i += units;
+        }
+        return column - startColumn;
+    }
+
+    size_t IndexFromColumn(const char16_t* line, size_t len, size_t column, size_t startColumn, int tabSize)
+    {
+        size_t col = startColumn;
+        size_t i = 0;
+        column += startColumn;
+        while (i < len)
+        {
+            uint32_t cp;
+            size_t units = ReadCodePoint(line, len, i, cp);
+            size_t width = CharColumns(cp, col, tabSize);
+            if (column < col + (width + 1) / 2)
+                return i;
+            col += width;
+            i += units;
+        }
+        return len;
+    }
+
+    void GetCellColumns(const char16_t* line, size_t len, std::vector<int>& columns, size_t startColumn, int tabSize)
+    {
+        columns.resize(len);
+        size_t col = startColumn;
+        size_t i = 0;
+        while (i < len)
+        {
+            uint32_t cp;
+            size_t units = ReadCodePoint(line, len, i, cp);
+            size_t width = CharColumns(cp, col, tabSize);
+            columns[i] = static_cast<int>(width);
+            if (units == 2)
+                columns[i + 1] = 0;
+            col += width;
+            i += units;
+        }
+    }
+
+    std::vector<size_t> ComputeWrapPoints(const char16_t* line, size_t len, size_t wrapColumns, int tabSize)
+    {
+        std::vector<size_t> points(1, 0);
+        if (wrapColumns == 0)
+            return points;
+
+        size_t rowStart = 0;
+        size_t col = 0;             // 相对当前可视行的列，制表位也按可视行计算
+        size_t lastBreak = 0;       // 当前可视行内最后一个空白之后的位置
+        size_t i = 0;
+        while (i < len)
+        {
+            uint32_t cp;
+            size_t units = ReadCodePoint(line, len, i, cp);
+            size_t width = CharColumns(cp, col, tabSize);
+
+            // 在最后一个空白之后断开后，剩余部分仍可能放不下，此时再按字符断开
+            while (col + width > wrapColumns && i > rowStart)
+            {
+                size_t breakAt = (lastBreak > rowStart) ? lastBreak : i;
+                points.push_back(breakAt);
+                rowStart = breakAt;
+                lastBreak = rowStart;
+                col = ColumnFromIndex(line + rowStart, i - rowStart, i - rowStart, 0, tabSize);
+                width = CharColumns(cp, col, tabSize);
+            }
+
+            col += width;
+            i += units;
+            if (cp == ' ' || cp == '\t')
+                lastBreak = i;
+        }
+        return points;
+    }
+}
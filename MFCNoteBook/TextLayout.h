@@ -0,0 +1,37 @@
+﻿// TextLayout.h - 等宽网格排版：字符列宽、列与下标换算、软换行（不依赖MFC）
+//
+// 自绘编辑器把每个字符放在固定宽度的格子里：ASCII 占 1 列，CJK/全角/emoji 占 2 列，
+// 制表符对齐到下一个制表位。绘制时按列宽给出每个字符的步进，屏幕坐标 = 列 × 字符宽度。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define TEXTLAYOUT_TAB_SIZE     4
+
+namespace TestableLogic
+{
+    // 码点占用的列数：组合字符为 0，东亚宽字符为 2，其余为 1
+    int GetCodePointColumns(uint32_t cp);
+
+    // 以下换算的列都从 line 开头算起；startColumn 为 line 开头所在的列，只影响制表位的对齐
+    // （超长行分块解码时传入块的起始列，整行解码时为 0）
+
+    // 行内第 index 个 UTF-16 单元之前的列数
+    size_t ColumnFromIndex(const char16_t* line, size_t len, size_t index, size_t startColumn = 0,
+        int tabSize = TEXTLAYOUT_TAB_SIZE);
+
+    // 最接近 column 的字符边界（落在宽字符右半格时取其后的边界）
+    size_t IndexFromColumn(const char16_t* line, size_t len, size_t column, size_t startColumn = 0,
+        int tabSize = TEXTLAYOUT_TAB_SIZE);
+
+    // 每个 UTF-16 单元的列宽（代理对的低位单元为 0），用于绘制时逐字符指定步进
+    void GetCellColumns(const char16_t* line, size_t len, std::vector<int>& columns, size_t startColumn = 0,
+        int tabSize = TEXTLAYOUT_TAB_SIZE);
+
+    // 软换行：按 wrapColumns 列宽折行，优先在空白之后断开，放不下时按字符断开；
+    // 返回每个可视行起始的单元下标（第一个总是 0），不会拆开代理对
+    std::vector<size_t> ComputeWrapPoints(const char16_t* line, size_t len, size_t wrapColumns,
+        int tabSize = TEXTLAYOUT_TAB_SIZE);
+}
@@ -0,0 +1,169 @@
+﻿// ThemeRegistry.cpp - 主题注册表实现
+#include "ThemeRegistry.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        constexpr ThemePalette kBuiltInPalettes[THEME_BUILTIN_COUNT] =
+        {
+            // 亮色：白底黑字，浅灰行号区
+            { MakeThemeColor(255, 255, 255), MakeThemeColor(0, 0, 0),
+              MakeThemeColor(240, 240, 240), MakeThemeColor(128, 128, 128), MakeThemeColor(200, 200, 200) },
+            // 暗色：深灰底浅色字
+            { MakeThemeColor(30, 30, 30), MakeThemeColor(220, 220, 220),
+              MakeThemeColor(45, 45, 45), MakeThemeColor(140, 140, 140), MakeThemeColor(60, 60, 60) },
+        };
+
+        const char* const kBuiltInNames[THEME_BUILTIN_COUNT] = { "Light", "Dark" };
+
+        // 内置主题在编译期校验，运行时不再计算
+        static_assert(ValidateThemePalette(kBuiltInPalettes[0]) == ThemeStatus::Ok, "亮色主题对比度不足");
+        static_assert(ValidateThemePalette(kBuiltInPalettes[1]) == ThemeStatus::Ok, "暗色主题对比度不足");
+
+        bool IsSpace(char ch)
+        {
+            return ch == ' ' || ch == '\t' || ch == '\r';
+        }
+
+        int HexValue(char ch)
+        {
+            if (ch >= '0' && ch <= '9')
+                return ch - '0';
+            if (ch >= 'a' && ch <= 'f')
+                return ch - 'a' + 10;
+            if (ch >= 'A' && ch <= 'F')
+                return ch - 'A' + 10;
+            return -1;
+        }
+
+        // "#RRGGBB"
+        bool ParseColor(const char* p, size_t len, ThemeColor& color)
+        {
+            if (len != 7 || p[0] != '#')
+                return false;
+            unsigned rgb[3];
+            for (int i = 0; i < 3; i++)
+            {
+                int hi = HexValue(p[1 + i * 2]);
+                int lo = HexValue(p[2 + i * 2]);
+                if (hi < 0 || lo < 0)
+                    return false;
+                rgb[i] = static_cast<unsigned>(hi * 16 + lo);
+            }
+            color = MakeThemeColor(rgb[0], rgb[1], rgb[2]);
+            return true;
+        }
+    }
+
+    const ThemePalette& GetBuiltInThemePalette(size_t id)
+    {
+        return kBuiltInPalettes[id < THEME_BUILTIN_COUNT ? id : 0];
+    }
+
+    ThemeRegistry::ThemeRegistry()
+    {
+        Reset();
+    }
+
+    void ThemeRegistry::Reset()
+    {
+        m_themes.clear();
+        m_errors.clear();
+        for (size_t i = 0; i < THEME_BUILTIN_COUNT; i++)
+            m_themes.push_back({ kBuiltInNames[i], kBuiltInPalettes[i], true });
+    }
+
+    ThemeStatus ThemeRegistry::ParseLine(const char* line, size_t len, std::string& name, ThemePalette& palette)
+    {
+        // 从行尾向前取五个颜色
+        ThemeColor colors[5];
+        size_t end = len;
+        for (int i = 4; i >= 0; i--)
+        {
+            while (end > 0 && IsSpace(line[end - 1]))
+                end--;
+            size_t start = end;
+            while (start > 0 && !IsSpace(line[start - 1]))
+                start--;
+            if (start == end)
+                return ThemeStatus::BadFormat;
+            if (!ParseColor(line + start, end - start, colors[i]))
+                return (line[start] == '#') ? ThemeStatus::BadColor : ThemeStatus::BadFormat;
+            end = start;
+        }
+
+        // 剩下的是名称（去掉首尾空白）
+        size_t start = 0;
+        while (start < end && IsSpace(line[start]))
+            start++;
+        while (end > start && IsSpace(line[end - 1]))
+            end--;
+        if (start == end)
+            return ThemeStatus::BadFormat;
+
+        name.assign(line + start, end - start);
+        palette = { colors[0], colors[1], colors[2], colors[3], colors[4] };
+        return ThemeStatus::Ok;
+    }
+
+    size_t ThemeRegistry::LoadUserThemes(const char* data, size_t len)
+    {
+        // 跳过 UTF-8 BOM
+        if (len >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        {
+            data += 3;
+            len -= 3;
+        }
+
+        size_t added = 0;
+        size_t lineNo = 0;
+        size_t pos = 0;
+        while (pos < len)
+        {
+            const char* eol = static_cast<const char*>(memchr(data + pos, '\n', len - pos));
+            size_t lineEnd = eol ? static_cast<size_t>(eol - data) : len;
+            const char* line = data + pos;
+            size_t lineLen = lineEnd - pos;
+            pos = lineEnd + 1;
+            lineNo++;
+
+            size_t first = 0;
+            while (first < lineLen && IsSpace(line[first]))
+                first++;
+            if (first == lineLen || line[first] == '#' || line[first] == ';')
+                continue;
+
+            ThemeDefinition theme;
+            theme.bBuiltIn = false;
+            ThemeStatus status = ParseLine(line, lineLen, theme.name, theme.palette);
+            if (status == ThemeStatus::Ok)
+                status = ValidateThemePalette(theme.palette);
+            if (status == ThemeStatus::Ok && FindByName(theme.name) >= 0)
+                status = ThemeStatus::DuplicateName;
+            if (status == ThemeStatus::Ok && m_themes.size() >= THEME_MAX_COUNT)
+                status = ThemeStatus::TooMany;
+
+            if (status != ThemeStatus::Ok)
+            {
+                m_errors.push_back({ lineNo, status });
+                continue;
+            }
+            m_themes.push_back(theme);
+            added++;
+        }
+        return added;
+    }
+
+    int ThemeRegistry::FindByName(const std::string& name) const
+    {
+        for (size_t i = 0; i < m_themes.size(); i++)
+        {
+            if (m_themes[i].name == name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+}
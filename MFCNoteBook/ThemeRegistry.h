@@ -0,0 +1,155 @@
+﻿// ThemeRegistry.h - 主题注册表：内置与用户主题的配色及对比度校验（不依赖MFC）
+//
+// 内置主题的配色是 constexpr 表，WCAG 对比度在编译期用 static_assert 检查；
+// 用户主题从程序目录下的主题文件读入，每行一个主题，载入时校验一次，不合格的整行丢弃。
+// 全部主题按 ID（内置在前，用户主题依次在后）存放在连续数组中，取配色只是一次下标访问。
+//
+// 主题文件格式（UTF-8），# 或 ; 开头的行是注释：
+//     名称  编辑区背景  编辑区文字  行号区背景  行号文字  行号分隔线
+//     Solarized Light  #FDF6E3 #586E75 #EEE8D5 #93A1A1 #D6CFB8
+// 名称可以含空格，行尾的五个 #RRGGBB 依次是各部分的颜色。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 主题文件名（与程序同目录）
+#define THEME_FILE_NAME             L"themes.txt"
+// 内置主题数（亮色、暗色），用户主题的 ID 从这里开始
+#define THEME_BUILTIN_COUNT         2
+// 最多登记的主题数（内置 + 用户），菜单命令 ID 按用户主题数预留
+#define THEME_MAX_COUNT             32
+// WCAG 对比度下限（×100）：正文按 AA 级 4.5:1，行号按非正文的 3:1
+#define THEME_MIN_TEXT_CONTRAST     450
+#define THEME_MIN_LINENUM_CONTRAST  300
+
+namespace TestableLogic
+{
+    // 0x00BBGGRR，与 Win32 的 COLORREF 布局相同，可直接转换
+    typedef uint32_t ThemeColor;
+
+    constexpr ThemeColor MakeThemeColor(unsigned r, unsigned g, unsigned b)
+    {
+        return static_cast<ThemeColor>((r & 0xFF) | ((g & 0xFF) << 8) | ((b & 0xFF) << 16));
+    }
+
+    struct ThemePalette
+    {
+        ThemeColor editBg;          // 编辑区背景
+        ThemeColor editText;        // 编辑区文字
+        ThemeColor lineNumBg;       // 行号区背景
+        ThemeColor lineNumText;     // 行号文字
+        ThemeColor lineNumBorder;   // 行号分隔线
+    };
+
+    // sRGB 通道值线性化后的亮度（×1000000），WCAG 2.x 的相对亮度公式查表代替 pow
+    constexpr uint32_t kThemeLinearChannel[256] =
+    {
+        0, 304, 607, 911, 1214, 1518, 1821, 2125, 2428, 2732, 3035, 3347,
+        3677, 4025, 4391, 4777, 5182, 5605, 6049, 6512, 6995, 7499, 8023, 8568,
+        9134, 9721, 10330, 10960, 11612, 12286, 12983, 13702, 14444, 15209, 15996, 16807,
+        17642, 18500, 19382, 20289, 21219, 22174, 23153, 24158, 25187, 26241, 27321, 28426,
+        29557, 30713, 31896, 33105, 34340, 35601, 36889, 38204, 39546, 40915, 42311, 43735,
+        45186, 46665, 48172, 49707, 51269, 52861, 54480, 56128, 57805, 59511, 61246, 63010,
+        64803, 66626, 68478, 70360, 72272, 74214, 76185, 78187, 80220, 82283, 84376, 86500,
+        88656, 90842, 93059, 95307, 97587, 99899, 102242, 104616, 107023, 109462, 111932, 114435,
+        116971, 119538, 122139, 124772, 127438, 130136, 132868, 135633, 138432, 141263, 144128, 147027,
+        149960, 152926, 155926, 158961, 162029, 165132, 168269, 171441, 174647, 177888, 181164, 184475,
+        187821, 191202, 194618, 198069, 201556, 205079, 208637, 212231, 215861, 219526, 223228, 226966,
+        230740, 234551, 238398, 242281, 246201, 250158, 254152, 258183, 262251, 266356, 270498, 274677,
+        278894, 283149, 287441, 291771, 296138, 300544, 304987, 309469, 313989, 318547, 323143, 327778,
+        332452, 337164, 341914, 346704, 351533, 356400, 361307, 366253, 371238, 376262, 381326, 386429,
+        391572, 396755, 401978, 407240, 412543, 417885, 423268, 428690, 434154, 439657, 445201, 450786,
+        456411, 462077, 467784, 473531, 479320, 485150, 491021, 496933, 502886, 508881, 514918, 520996,
+        527115, 533276, 539479, 545724, 552011, 558340, 564712, 571125, 577580, 584078, 590619, 597202,
+        603827, 610496, 617207, 623960, 630757, 637597, 644480, 651406, 658375, 665387, 672443, 679542,
+        686685, 693872, 701102, 708376, 715694, 723055, 730461, 737910, 745404, 752942, 760525, 768151,
+        775822, 783538, 791298, 799103, 806952, 814847, 822786, 830770, 838799, 846873, 854993, 863157,
+        871367, 879622, 887923, 896269, 904661, 913099, 921582, 930111, 938686, 947307, 955973, 964686,
+        973445, 982251, 991102, 1000000
+    };
+
+    // 相对亮度（×1000000）：0.2126 R + 0.7152 G + 0.0722 B
+    constexpr uint32_t GetRelativeLuminance(ThemeColor color)
+    {
+        return static_cast<uint32_t>((2126ull * kThemeLinearChannel[color & 0xFF]
+            + 7152ull * kThemeLinearChannel[(color >> 8) & 0xFF]
+            + 722ull * kThemeLinearChannel[(color >> 16) & 0xFF]) / 10000);
+    }
+
+    // 对比度 (L亮 + 0.05) / (L暗 + 0.05)，×100 取整，范围 100..2100
+    constexpr uint32_t GetContrastRatio100(ThemeColor a, ThemeColor b)
+    {
+        uint64_t la = GetRelativeLuminance(a);
+        uint64_t lb = GetRelativeLuminance(b);
+        uint64_t lighter = la > lb ? la : lb;
+        uint64_t darker = la > lb ? lb : la;
+        return static_cast<uint32_t>((lighter + 50000) * 100 / (darker + 50000));
+    }
+
+    // 校验与载入的结果
+    enum class ThemeStatus
+    {
+        Ok,
+        BadFormat,              // 不足一个名称加五个颜色
+        BadColor,               // 颜色不是 #RRGGBB
+        LowTextContrast,        // 编辑区文字与背景对比度不足
+        LowLineNumberContrast,  // 行号与行号区背景对比度不足
+        DuplicateName,          // 与已有主题同名
+        TooMany                 // 超过 THEME_MAX_COUNT
+    };
+
+    constexpr ThemeStatus ValidateThemePalette(const ThemePalette& palette)
+    {
+        if (GetContrastRatio100(palette.editText, palette.editBg) < THEME_MIN_TEXT_CONTRAST)
+            return ThemeStatus::LowTextContrast;
+        if (GetContrastRatio100(palette.lineNumText, palette.lineNumBg) < THEME_MIN_LINENUM_CONTRAST)
+            return ThemeStatus::LowLineNumberContrast;
+        return ThemeStatus::Ok;
+    }
+
+    // 内置主题（ID 0 亮色，1 暗色）
+    const ThemePalette& GetBuiltInThemePalette(size_t id);
+
+    struct ThemeDefinition
+    {
+        std::string name;       // UTF-8
+        ThemePalette palette;
+        bool bBuiltIn;
+    };
+
+    // 被丢弃的用户主题行
+    struct ThemeLoadError
+    {
+        size_t line;            // 从 1 开始
+        ThemeStatus status;
+    };
+
+    class ThemeRegistry
+    {
+    public:
+        ThemeRegistry();
+
+        // 只保留内置主题
+        void Reset();
+
+        // 解析主题文件内容，校验通过的主题依次追加；返回追加的个数，丢弃的行记入 GetErrors()
+        size_t LoadUserThemes(const char* data, size_t len);
+        const std::vector<ThemeLoadError>& GetErrors() const { return m_errors; }
+
+        size_t GetCount() const { return m_themes.size(); }
+        // ID 越界时返回亮色主题
+        const ThemeDefinition& Get(size_t id) const { return m_themes[id < m_themes.size() ? id : 0]; }
+        // 按名称查找（区分大小写），找不到返回 -1
+        int FindByName(const std::string& name) const;
+
+        // 解析一行（不含换行符）；成功时填写名称和配色
+        static ThemeStatus ParseLine(const char* line, size_t len, std::string& name, ThemePalette& palette);
+
+    private:
+        std::vector<ThemeDefinition> m_themes;
+        std::vector<ThemeLoadError> m_errors;
+    };
+}
@@ -0,0 +1,52 @@
+﻿// ThemeResourceCache.h - 按主题缓存画刷等 GDI 资源（不依赖MFC）
+//
+// 所有视图共用同一套主题资源：每个主题的画刷只在第一次使用时创建，
+// 切换主题只是换成另一项，不再逐个视图删除、重建画刷；切回原主题时直接复用。
+// TResources 是实际的资源集合（应用中为若干 CBrush），创建由调用方提供的函数完成。
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+namespace TestableLogic
+{
+    template <class TResources>
+    class ThemeResourceCache
+    {
+    public:
+        ThemeResourceCache() : m_nCreated(0), m_nHits(0) {}
+
+        // 查找主题的资源，不存在时调用 create(theme, resources) 创建；
+        // 返回的引用在 Clear() 之前一直有效
+        template <class CreateFunc>
+        const TResources& Get(int theme, CreateFunc create)
+        {
+            auto it = m_entries.find(theme);
+            if (it != m_entries.end())
+            {
+                m_nHits++;
+                return *it->second;
+            }
+
+            std::unique_ptr<TResources> entry(new TResources());
+            create(theme, *entry);
+            m_nCreated++;
+            const TResources& result = *entry;
+            m_entries[theme] = std::move(entry);
+            return result;
+        }
+
+        // 释放全部资源；调用方需要重新获取
+        void Clear() { m_entries.clear(); }
+
+        size_t GetSize() const { return m_entries.size(); }
+        uint64_t GetCreateCount() const { return m_nCreated; }
+        uint64_t GetHitCount() const { return m_nHits; }
+
+    private:
+        std::map<int, std::unique_ptr<TResources>> m_entries;
+        uint64_t m_nCreated;
+        uint64_t m_nHits;
+    };
+}
@@ -0,0 +1,752 @@
+﻿// TrigramIndex.cpp - 三元组索引实现
+#include "TrigramIndex.h"
+#include "CryptoUtil.h"
+#include "FileUtil.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <unordered_set>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        const uint32_t DELTA_RECORD_MAGIC = 0x544C4454;  // "TDLT"
+        const uint32_t DELTA_KIND_UPDATE = 1;
+        const uint32_t DELTA_KIND_REMOVE = 2;
+        const size_t COMPACT_MIN_RECORDS = 64;
+        const size_t COMPACT_MIN_BYTES = 1024 * 1024;
+
+        // 盐和校验值用不同的标签派生，互相推不出对方
+        const char SALT_LABEL[] = "MFCNoteBook trigram salt";
+        const char CHECK_LABEL[] = "MFCNoteBook trigram check";
+
+        // 增量日志记录头，后跟路径字节（补齐到 4 字节）和 keyCount 个 uint32 哈希
+#pragma pack(push, 4)
+        struct DeltaRecordHeader
+        {
+            uint32_t magic;
+            uint32_t kind;
+            uint64_t stamp;
+            uint64_t keyCheck;
+            uint32_t flags;
+            uint32_t pathLength;
+            uint32_t keyCount;
+            uint32_t checksum;          // 对路径和哈希的 FNV-1a，用于丢弃写了一半的尾部记录
+        };
+#pragma pack(pop)
+
+        inline uint64_t Fmix64(uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 33;
+            h *= 0xC4CEB9FE1A85EC53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        uint32_t Fnv1a(const void* pData, size_t len, uint32_t h = 2166136261u)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(pData);
+            for (size_t i = 0; i < len; i++)
+            {
+                h ^= p[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        // 简单大小写折叠，覆盖 ASCII、Latin-1、希腊文、西里尔文和全角字母，
+        // 与查找对话框中 MakeLower 的不区分大小写匹配保持一致（只会多出候选，不会漏掉）
+        inline uint32_t FoldCase(uint32_t c)
+        {
+            if (c < 0x80)
+                return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+            if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+                return c + 0x20;
+            if (c >= 0x391 && c <= 0x3A9)
+                return c + 0x20;
+            if (c >= 0x410 && c <= 0x42F)
+                return c + 0x20;
+            if (c >= 0x400 && c <= 0x40F)
+                return c + 0x50;
+            if (c >= 0xFF21 && c <= 0xFF3A)
+                return c + 0x20;
+            return c;
+        }
+
+        inline uint32_t TrigramKey(uint32_t a, uint32_t b, uint32_t c, uint64_t salt)
+        {
+            uint64_t h = (static_cast<uint64_t>(a) << 42) ^ (static_cast<uint64_t>(b) << 21) ^ c;
+            h = Fmix64(h ^ salt);
+            return static_cast<uint32_t>(h ^ (h >> 32));
+        }
+
+        // [offset, offset + count * elemSize) 是否落在 nSize 字节之内，且起点 4 字节对齐（不会溢出）
+        inline bool TableFits(uint64_t offset, uint64_t count, size_t elemSize, size_t nSize)
+        {
+            return offset % 4 == 0 && offset <= nSize && count <= (nSize - offset) / elemSize;
+        }
+
+        // 逐项检查映射的基础索引：表的范围、路径范围、三元组严格递增（二分查找），
+        // 倒排表在范围内且文件ID严格递增（求交集）并小于文件数。任何一项不符都按空索引处理
+        bool BaseIndexValid(const uint8_t* pData, size_t nSize)
+        {
+            const TrigramIndexHeader* pHeader = reinterpret_cast<const TrigramIndexHeader*>(pData);
+            if (memcmp(pHeader->magic, TRIGRAM_INDEX_MAGIC, TRIGRAM_INDEX_MAGIC_SIZE) != 0 ||
+                pHeader->version != TRIGRAM_INDEX_VERSION ||
+                pHeader->headerSize != sizeof(TrigramIndexHeader) ||
+                pHeader->totalSize != nSize ||
+                !TableFits(pHeader->fileTableOffset, pHeader->fileCount, sizeof(TrigramFileEntry), nSize) ||
+                !TableFits(pHeader->trigramTableOffset, pHeader->trigramCount, sizeof(TrigramEntry), nSize) ||
+                !TableFits(pHeader->postingOffset, pHeader->postingCount, sizeof(uint32_t), nSize) ||
+                pHeader->stringPoolOffset > pHeader->trigramTableOffset)
+                return false;
+
+            const TrigramFileEntry* pFiles = reinterpret_cast<const TrigramFileEntry*>(pData + pHeader->fileTableOffset);
+            uint64_t poolSize = pHeader->trigramTableOffset - pHeader->stringPoolOffset;
+            for (uint32_t i = 0; i < pHeader->fileCount; i++)
+            {
+                if (uint64_t(pFiles[i].pathOffset) + pFiles[i].pathLength > poolSize)
+                    return false;
+            }
+
+            const TrigramEntry* pTrigrams = reinterpret_cast<const TrigramEntry*>(pData + pHeader->trigramTableOffset);
+            const uint32_t* pPostings = reinterpret_cast<const uint32_t*>(pData + pHeader->postingOffset);
+            for (uint32_t t = 0; t < pHeader->trigramCount; t++)
+            {
+                const TrigramEntry& entry = pTrigrams[t];
+                if ((t > 0 && entry.key <= pTrigrams[t - 1].key) ||
+                    uint64_t(entry.postingStart) + entry.postingCount > pHeader->postingCount)
+                    return false;
+
+                const uint32_t* pList = pPostings + entry.postingStart;
+                for (uint32_t p = 0; p < entry.postingCount; p++)
+                {
+                    if (pList[p] >= pHeader->fileCount || (p > 0 && pList[p] <= pList[p - 1]))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        // SHA-256(标签 + '\0' + 数据) 的前 8 字节（小端）
+        bool LabeledHash64(const char* pLabel, const void* pData, size_t len, uint64_t& value)
+        {
+            std::vector<uint8_t> message(pLabel, pLabel + strlen(pLabel) + 1);
+            const uint8_t* p = static_cast<const uint8_t*>(pData);
+            message.insert(message.end(), p, p + len);
+
+            uint8_t hash[CRYPTO_SHA256_SIZE];
+            if (!CryptoUtil::Sha256(message.data(), message.size(), hash))
+                return false;
+
+            value = 0;
+            for (int i = 7; i >= 0; i--)
+                value = (value << 8) | hash[i];
+            return true;
+        }
+
+        // 校验值是盐的单向摘要：写进索引头和增量日志也无法还原出盐
+        uint64_t ComputeKeyCheck(uint64_t salt)
+        {
+            if (salt == 0)
+                return 0;
+
+            uint8_t bytes[8];
+            for (int i = 0; i < 8; i++)
+                bytes[i] = static_cast<uint8_t>(salt >> (i * 8));
+            uint64_t check = 0;
+            if (!LabeledHash64(CHECK_LABEL, bytes, sizeof(bytes), check))
+                return 0;
+            return check == 0 ? 1 : check;
+        }
+
+        // 两个已排序集合，判断 needle 是否为 haystack 的子集
+        bool IsSubset(const std::vector<uint32_t>& needle, const std::vector<uint32_t>& haystack)
+        {
+            return std::includes(haystack.begin(), haystack.end(), needle.begin(), needle.end());
+        }
+
+        size_t Align4(size_t n)
+        {
+            return (n + 3) & ~static_cast<size_t>(3);
+        }
+    }
+
+    // ============ 构造与哈希 ============
+
+    TrigramIndex::TrigramIndex(uint64_t keySalt)
+        : m_keySalt(keySalt)
+        , m_keyCheck(ComputeKeyCheck(keySalt))
+        , m_nDeltaBytes(0)
+        , m_pHeader(nullptr)
+        , m_pFiles(nullptr)
+        , m_pStrings(nullptr)
+        , m_pTrigrams(nullptr)
+        , m_pPostings(nullptr)
+    {
+    }
+
+    std::vector<uint32_t> TrigramIndex::ExtractTrigramKeys(const wchar_t* pText, size_t len,
+        uint64_t salt)
+    {
+        std::vector<uint32_t> keys;
+        if (pText == nullptr || len < 3)
+            return keys;
+
+        keys.reserve(len - 2);
+        uint32_t a = FoldCase(static_cast<uint32_t>(pText[0]));
+        uint32_t b = FoldCase(static_cast<uint32_t>(pText[1]));
+        for (size_t i = 2; i < len; i++)
+        {
+            uint32_t c = FoldCase(static_cast<uint32_t>(pText[i]));
+            keys.push_back(TrigramKey(a, b, c, salt));
+            a = b;
+            b = c;
+        }
+
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    uint64_t TrigramIndex::DeriveKeySalt(const void* pKey, size_t keyLen)
+    {
+        if (pKey == nullptr || keyLen == 0)
+            return 0;
+
+        // 摘要失败时按未配置密钥处理，加密文档不进索引
+        uint64_t salt = 0;
+        if (!LabeledHash64(SALT_LABEL, pKey, keyLen, salt))
+            return 0;
+        return salt == 0 ? 1 : salt;
+    }
+
+    // ============ 加载 ============
+
+    bool TrigramIndex::Load(const std::string& indexPath)
+    {
+        m_indexPath = indexPath;
+        m_overlay.clear();
+        m_nDeltaBytes = 0;
+
+        if (!MapBase(indexPath))
+            return false;
+
+        return ReplayDelta(indexPath + TRIGRAM_DELTA_SUFFIX);
+    }
+
+    bool TrigramIndex::MapBase(const std::string& indexPath)
+    {
+        m_base.Close();
+        m_pHeader = nullptr;
+        m_pFiles = nullptr;
+        m_pStrings = nullptr;
+        m_pTrigrams = nullptr;
+        m_pPostings = nullptr;
+        m_basePathToId.clear();
+
+        if (!FileUtil::Exists(indexPath))
+            return true;
+
+        if (!m_base.Open(indexPath))
+            return false;
+
+        // 版本不匹配、截断或损坏时视为空索引，下次合并时会整体重建
+        const uint8_t* pData = m_base.Data();
+        size_t nSize = m_base.Size();
+        if (pData == nullptr || nSize < sizeof(TrigramIndexHeader) || !BaseIndexValid(pData, nSize))
+        {
+            m_base.Close();
+            return true;
+        }
+
+        const TrigramIndexHeader* pHeader = reinterpret_cast<const TrigramIndexHeader*>(pData);
+        m_pHeader = pHeader;
+        m_pFiles = reinterpret_cast<const TrigramFileEntry*>(pData + pHeader->fileTableOffset);
+        m_pStrings = reinterpret_cast<const char*>(pData + pHeader->stringPoolOffset);
+        m_pTrigrams = reinterpret_cast<const TrigramEntry*>(pData + pHeader->trigramTableOffset);
+        m_pPostings = reinterpret_cast<const uint32_t*>(pData + pHeader->postingOffset);
+
+        m_basePathToId.reserve(pHeader->fileCount);
+        for (uint32_t i = 0; i < pHeader->fileCount; i++)
+            m_basePathToId[BasePath(i)] = i;
+
+        return true;
+    }
+
+    bool TrigramIndex::ReplayDelta(const std::string& deltaPath)
+    {
+        std::vector<uint8_t> data;
+        if (!FileUtil::Exists(deltaPath))
+            return true;
+        if (!FileUtil::ReadAll(deltaPath, data))
+            return false;
+
+        size_t offset = 0;
+        while (offset + sizeof(DeltaRecordHeader) <= data.size())
+        {
+            DeltaRecordHeader header;
+            memcpy(&header, data.data() + offset, sizeof(header));
+            if (header.magic != DELTA_RECORD_MAGIC)
+                break;
+
+            size_t pathBytes = Align4(header.pathLength);
+            size_t keyBytes = size_t(header.keyCount) * sizeof(uint32_t);
+            size_t recordSize = sizeof(header) + pathBytes + keyBytes;
+            if (offset + recordSize > data.size())
+                break;  // 尾部记录未写完整
+
+            const uint8_t* pPayload = data.data() + offset + sizeof(header);
+            uint32_t checksum = Fnv1a(pPayload, header.pathLength);
+            checksum = Fnv1a(pPayload + pathBytes, keyBytes, checksum);
+            if (checksum != header.checksum)
+                break;
+
+            std::string path(reinterpret_cast<const char*>(pPayload), header.pathLength);
+            FileRecord& record = m_overlay[path];
+            record.stamp = header.stamp;
+            record.flags = header.flags;
+            record.removed = (header.kind == DELTA_KIND_REMOVE) ||
+                ((header.flags & TrigramFile_KeyedHash) && header.keyCheck != m_keyCheck);
+            record.keys.resize(header.keyCount);
+            if (keyBytes > 0)
+                memcpy(record.keys.data(), pPayload + pathBytes, keyBytes);
+
+            offset += recordSize;
+        }
+
+        m_nDeltaBytes = offset;
+        return true;
+    }
+
+    // ============ 增量更新 ============
+
+    bool TrigramIndex::UpdateFile(const std::string& filePath, const wchar_t* pText, size_t len,
+        uint64_t stamp, bool bKeyedHash)
+    {
+        // 没有密钥时不能为加密文档生成哈希，否则索引里留下的就是明文三元组的哈希
+        if (bKeyedHash && m_keySalt == 0)
+            return RemoveFile(filePath);
+
+        FileRecord record;
+        record.stamp = stamp;
+        record.flags = bKeyedHash ? TrigramFile_KeyedHash : TrigramFile_None;
+        record.keys = ExtractTrigramKeys(pText, len, bKeyedHash ? m_keySalt : 0);
+
+        bool bOk = m_indexPath.empty() || AppendDelta(filePath, record);
+        m_overlay[filePath] = std::move(record);
+        return bOk;
+    }
+
+    bool TrigramIndex::RemoveFile(const std::string& filePath)
+    {
+        FileRecord record;
+        record.removed = true;
+
+        bool bOk = m_indexPath.empty() || AppendDelta(filePath, record);
+        m_overlay[filePath] = std::move(record);
+        return bOk;
+    }
+
+    size_t TrigramIndex::Refresh(const std::vector<TrigramSourceFile>& files,
+        const std::function<bool(const std::string&, std::wstring&)>& loadText)
+    {
+        std::unordered_set<std::string> present;
+        present.reserve(files.size());
+        size_t nLoaded = 0;
+        std::wstring text;
+        for (const TrigramSourceFile& file : files)
+        {
+            present.insert(file.path);
+            if (GetStamp(file.path) == file.stamp && file.stamp != 0)
+                continue;
+
+            // 没有密钥时加密文档不进索引，不必读入
+            if (file.bKeyedHash && m_keySalt == 0)
+            {
+                if (Contains(file.path))
+                    RemoveFile(file.path);
+                continue;
+            }
+
+            text.clear();
+            if (loadText(file.path, text))
+            {
+                UpdateFile(file.path, text.data(), text.size(), file.stamp, file.bKeyedHash);
+                nLoaded++;
+            }
+            else if (Contains(file.path))
+            {
+                RemoveFile(file.path);
+            }
+        }
+
+        for (const std::string& path : Query(nullptr, 0))
+        {
+            if (!present.count(path))
+                RemoveFile(path);
+        }
+        return nLoaded;
+    }
+
+    bool TrigramIndex::AppendDelta(const std::string& filePath, const FileRecord& record)
+    {
+        DeltaRecordHeader header = {};
+        header.magic = DELTA_RECORD_MAGIC;
+        header.kind = record.removed ? DELTA_KIND_REMOVE : DELTA_KIND_UPDATE;
+        header.stamp = record.stamp;
+        header.keyCheck = m_keyCheck;
+        header.flags = record.flags;
+        header.pathLength = static_cast<uint32_t>(filePath.size());
+        header.keyCount = static_cast<uint32_t>(record.keys.size());
+
+        // 一次写入整条记录，崩溃时最多留下一条不完整的尾部记录
+        std::vector<uint8_t> buffer(sizeof(header) + Align4(filePath.size()) +
+            record.keys.size() * sizeof(uint32_t), 0);
+        uint8_t* pPath = buffer.data() + sizeof(header);
+        uint8_t* pKeys = pPath + Align4(filePath.size());
+        memcpy(pPath, filePath.data(), filePath.size());
+        if (!record.keys.empty())
+            memcpy(pKeys, record.keys.data(), record.keys.size() * sizeof(uint32_t));
+
+        header.checksum = Fnv1a(pPath, filePath.size());
+        header.checksum = Fnv1a(pKeys, record.keys.size() * sizeof(uint32_t), header.checksum);
+        memcpy(buffer.data(), &header, sizeof(header));
+
+        FILE* fp = FileUtil::Open(m_indexPath + TRIGRAM_DELTA_SUFFIX, "ab");
+        if (!fp)
+            return false;
+        bool bOk = fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+        bOk = (fflush(fp) == 0) && bOk;
+        fclose(fp);
+
+        if (bOk)
+            m_nDeltaBytes += buffer.size();
+        return bOk;
+    }
+
+    bool TrigramIndex::NeedsCompaction() const
+    {
+        if (m_overlay.size() < COMPACT_MIN_RECORDS && m_nDeltaBytes < COMPACT_MIN_BYTES)
+            return false;
+
+        size_t nBaseSize = m_base.Size();
+        return m_nDeltaBytes * 4 > nBaseSize || m_overlay.size() >= COMPACT_MIN_RECORDS;
+    }
+
+    // ============ 合并写回 ============
+
+    bool TrigramIndex::Compact()
+    {
+        if (m_indexPath.empty())
+            return false;
+        return SaveAs(m_indexPath);
+    }
+
+    bool TrigramIndex::SaveAs(const std::string& indexPath)
+    {
+        // 1. 收集所有有效文件（基础索引中未被覆盖的 + 增量中未删除的）
+        struct MergedFile
+        {
+            std::string path;
+            uint64_t stamp;
+            uint32_t flags;
+            std::vector<uint32_t> keys;
+        };
+        std::vector<MergedFile> files;
+
+        if (m_pHeader)
+        {
+            // 基础索引只存倒排表，需要按三元组反向还原出每个文件的哈希集合
+            std::vector<std::vector<uint32_t>> baseKeys(m_pHeader->fileCount);
+            for (uint32_t t = 0; t < m_pHeader->trigramCount; t++)
+            {
+                const TrigramEntry& entry = m_pTrigrams[t];
+                for (uint32_t p = 0; p < entry.postingCount; p++)
+                {
+                    uint32_t fileId = m_pPostings[entry.postingStart + p];
+                    if (fileId < m_pHeader->fileCount)
+                        baseKeys[fileId].push_back(entry.key);
+                }
+            }
+
+            for (uint32_t i = 0; i < m_pHeader->fileCount; i++)
+            {
+                if (!BaseFileValid(i))
+                    continue;
+                std::string path = BasePath(i);
+                if (m_overlay.count(path))
+                    continue;
+                files.push_back({ path, m_pFiles[i].stamp, m_pFiles[i].flags, std::move(baseKeys[i]) });
+            }
+        }
+
+        for (const auto& item : m_overlay)
+        {
+            if (!item.second.removed)
+                files.push_back({ item.first, item.second.stamp, item.second.flags, item.second.keys });
+        }
+
+        std::sort(files.begin(), files.end(),
+            [](const MergedFile& a, const MergedFile& b) { return a.path < b.path; });
+
+        // 2. 构建倒排表：哈希 -> 文件ID列表（文件ID递增，天然有序）
+        std::map<uint32_t, std::vector<uint32_t>> postings;
+        for (uint32_t id = 0; id < files.size(); id++)
+        {
+            for (uint32_t key : files[id].keys)
+                postings[key].push_back(id);
+        }
+
+        // 3. 计算布局
+        size_t stringPoolSize = 0;
+        for (const auto& f : files)
+            stringPoolSize += f.path.size();
+
+        uint64_t postingCount = 0;
+        for (const auto& item : postings)
+            postingCount += item.second.size();
+
+        TrigramIndexHeader header = {};
+        memcpy(header.magic, TRIGRAM_INDEX_MAGIC, TRIGRAM_INDEX_MAGIC_SIZE);
+        header.version = TRIGRAM_INDEX_VERSION;
+        header.headerSize = sizeof(TrigramIndexHeader);
+        header.fileCount = static_cast<uint32_t>(files.size());
+        header.trigramCount = static_cast<uint32_t>(postings.size());
+        header.postingCount = postingCount;
+        header.keyCheck = m_keyCheck;
+        header.fileTableOffset = sizeof(TrigramIndexHeader);
+        header.stringPoolOffset = header.fileTableOffset + files.size() * sizeof(TrigramFileEntry);
+        header.trigramTableOffset = Align4(static_cast<size_t>(header.stringPoolOffset + stringPoolSize));
+        header.postingOffset = header.trigramTableOffset + postings.size() * sizeof(TrigramEntry);
+        header.totalSize = header.postingOffset + postingCount * sizeof(uint32_t);
+
+        // 4. 序列化
+        std::vector<uint8_t> out(static_cast<size_t>(header.totalSize), 0);
+        memcpy(out.data(), &header, sizeof(header));
+
+        TrigramFileEntry* pFiles = reinterpret_cast<TrigramFileEntry*>(out.data() + header.fileTableOffset);
+        char* pStrings = reinterpret_cast<char*>(out.data() + header.stringPoolOffset);
+        uint32_t stringOffset = 0;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            pFiles[i].stamp = files[i].stamp;
+            pFiles[i].pathOffset = stringOffset;
+            pFiles[i].pathLength = static_cast<uint32_t>(files[i].path.size());
+            pFiles[i].flags = files[i].flags;
+            pFiles[i].trigramCount = static_cast<uint32_t>(files[i].keys.size());
+            memcpy(pStrings + stringOffset, files[i].path.data(), files[i].path.size());
+            stringOffset += pFiles[i].pathLength;
+        }
+
+        TrigramEntry* pTrigrams = reinterpret_cast<TrigramEntry*>(out.data() + header.trigramTableOffset);
+        uint32_t* pPostings = reinterpret_cast<uint32_t*>(out.data() + header.postingOffset);
+        uint32_t postingStart = 0;
+        size_t t = 0;
+        for (const auto& item : postings)
+        {
+            pTrigrams[t].key = item.first;
+            pTrigrams[t].postingStart = postingStart;
+            pTrigrams[t].postingCount = static_cast<uint32_t>(item.second.size());
+            memcpy(pPostings + postingStart, item.second.data(), item.second.size() * sizeof(uint32_t));
+            postingStart += pTrigrams[t].postingCount;
+            t++;
+        }
+
+        // 5. 释放旧映射后再替换文件（Windows 下无法替换仍被映射的文件）
+        m_base.Close();
+        m_pHeader = nullptr;
+
+        if (!FileUtil::WriteAllAtomic(indexPath, out.data(), out.size()))
+        {
+            MapBase(m_indexPath.empty() ? indexPath : m_indexPath);
+            return false;
+        }
+
+        FileUtil::Remove(indexPath + TRIGRAM_DELTA_SUFFIX);
+        m_indexPath = indexPath;
+        m_overlay.clear();
+        m_nDeltaBytes = 0;
+        return MapBase(indexPath);
+    }
+
+    // ============ 查询 ============
+
+    bool TrigramIndex::BaseFileValid(uint32_t fileId) const
+    {
+        // 密钥变化后，旧的带密钥哈希已无法匹配，视为失效
+        if ((m_pFiles[fileId].flags & TrigramFile_KeyedHash) && m_pHeader->keyCheck != m_keyCheck)
+            return false;
+        return true;
+    }
+
+    std::string TrigramIndex::BasePath(uint32_t fileId) const
+    {
+        const TrigramFileEntry& entry = m_pFiles[fileId];
+        uint64_t end = m_pHeader->stringPoolOffset + entry.pathOffset + entry.pathLength;
+        if (end > m_pHeader->trigramTableOffset)
+            return std::string();
+        return std::string(m_pStrings + entry.pathOffset, entry.pathLength);
+    }
+
+    const TrigramEntry* TrigramIndex::FindBaseTrigram(uint32_t key) const
+    {
+        const TrigramEntry* pBegin = m_pTrigrams;
+        const TrigramEntry* pEnd = m_pTrigrams + m_pHeader->trigramCount;
+        const TrigramEntry* pFound = std::lower_bound(pBegin, pEnd, key,
+            [](const TrigramEntry& e, uint32_t k) { return e.key < k; });
+        if (pFound == pEnd || pFound->key != key)
+            return nullptr;
+        return pFound;
+    }
+
+    void TrigramIndex::QueryBase(const std::vector<uint32_t>& keys, uint32_t flags,
+        std::vector<std::string>& out) const
+    {
+        if (!m_pHeader)
+            return;
+
+        // 按倒排表长度从短到长求交集
+        std::vector<const TrigramEntry*> entries;
+        entries.reserve(keys.size());
+        for (uint32_t key : keys)
+        {
+            const TrigramEntry* pEntry = FindBaseTrigram(key);
+            if (!pEntry)
+                return;
+            entries.push_back(pEntry);
+        }
+        std::sort(entries.begin(), entries.end(),
+            [](const TrigramEntry* a, const TrigramEntry* b) { return a->postingCount < b->postingCount; });
+
+        const uint32_t* pFirst = m_pPostings + entries[0]->postingStart;
+        std::vector<uint32_t> candidates(pFirst, pFirst + entries[0]->postingCount);
+        std::vector<uint32_t> next;
+        for (size_t i = 1; i < entries.size() && !candidates.empty(); i++)
+        {
+            const uint32_t* pList = m_pPostings + entries[i]->postingStart;
+            next.clear();
+            std::set_intersection(candidates.begin(), candidates.end(),
+                pList, pList + entries[i]->postingCount, std::back_inserter(next));
+            candidates.swap(next);
+        }
+
+        for (uint32_t fileId : candidates)
+        {
+            if (fileId >= m_pHeader->fileCount || m_pFiles[fileId].flags != flags || !BaseFileValid(fileId))
+                continue;
+            std::string path = BasePath(fileId);
+            if (!m_overlay.count(path))
+                out.push_back(std::move(path));
+        }
+    }
+
+    std::vector<std::string> TrigramIndex::Query(const wchar_t* pNeedle, size_t len) const
+    {
+        std::vector<std::string> result;
+
+        if (pNeedle == nullptr || len < 3)
+        {
+            // 无法用三元组缩小范围
+            if (m_pHeader)
+            {
+                for (uint32_t i = 0; i < m_pHeader->fileCount; i++)
+                {
+                    std::string path = BasePath(i);
+                    if (BaseFileValid(i) && !m_overlay.count(path))
+                        result.push_back(std::move(path));
+                }
+            }
+            for (const auto& item : m_overlay)
+            {
+                if (!item.second.removed)
+                    result.push_back(item.first);
+            }
+        }
+        else
+        {
+            std::vector<uint32_t> plainKeys = ExtractTrigramKeys(pNeedle, len, 0);
+            QueryBase(plainKeys, TrigramFile_None, result);
+
+            std::vector<uint32_t> keyedKeys;
+            if (m_keySalt != 0)
+            {
+                keyedKeys = ExtractTrigramKeys(pNeedle, len, m_keySalt);
+                QueryBase(keyedKeys, TrigramFile_KeyedHash, result);
+            }
+
+            for (const auto& item : m_overlay)
+            {
+                const FileRecord& record = item.second;
+                if (record.removed)
+                    continue;
+                bool bKeyed = (record.flags & TrigramFile_KeyedHash) != 0;
+                if (bKeyed && m_keySalt == 0)
+                    continue;
+                if (IsSubset(bKeyed ? keyedKeys : plainKeys, record.keys))
+                    result.push_back(item.first);
+            }
+        }
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<std::string> TrigramIndex::Search(const wchar_t* pNeedle, size_t len,
+        const std::function<bool(const std::string&)>& fullMatcher) const
+    {
+        std::vector<std::string> matches;
+        for (std::string& path : Query(pNeedle, len))
+        {
+            if (fullMatcher(path))
+                matches.push_back(std::move(path));
+        }
+        return matches;
+    }
+
+    size_t TrigramIndex::FileCount() const
+    {
+        size_t count = 0;
+        if (m_pHeader)
+        {
+            for (uint32_t i = 0; i < m_pHeader->fileCount; i++)
+            {
+                if (BaseFileValid(i) && !m_overlay.count(BasePath(i)))
+                    count++;
+            }
+        }
+        for (const auto& item : m_overlay)
+        {
+            if (!item.second.removed)
+                count++;
+        }
+        return count;
+    }
+
+    bool TrigramIndex::Contains(const std::string& filePath) const
+    {
+        auto it = m_overlay.find(filePath);
+        if (it != m_overlay.end())
+            return !it->second.removed;
+
+        auto itBase = m_basePathToId.find(filePath);
+        return itBase != m_basePathToId.end() && BaseFileValid(itBase->second);
+    }
+
+    uint64_t TrigramIndex::GetStamp(const std::string& filePath) const
+    {
+        auto it = m_overlay.find(filePath);
+        if (it != m_overlay.end())
+            return it->second.removed ? 0 : it->second.stamp;
+
+        auto itBase = m_basePathToId.find(filePath);
+        if (itBase == m_basePathToId.end() || !BaseFileValid(itBase->second))
+            return 0;
+        return m_pFiles[itBase->second].stamp;
+    }
+}
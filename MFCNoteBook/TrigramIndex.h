@@ -0,0 +1,162 @@
+﻿// TrigramIndex.h - 笔记目录的持久化三元组（trigram）索引（不依赖MFC）
+//
+// 索引由两部分组成：
+//   1. 基础索引文件（可直接内存映射、带版本号），查询时按需二分查找，无需整体加载；
+//   2. 增量日志（<索引>.delta），每次保存文档只追加一条记录，达到阈值后再合并进基础索引。
+// 索引中只保存三元组的 32 位哈希，不保存任何正文；*.mynote 文件使用带密钥的哈希。
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============ 索引文件格式常量 ============
+#define TRIGRAM_INDEX_MAGIC         "MNTRIGR1"
+#define TRIGRAM_INDEX_MAGIC_SIZE    8
+#define TRIGRAM_INDEX_VERSION       1
+#define TRIGRAM_INDEX_FILE_NAME     ".mynote.idx"
+#define TRIGRAM_DELTA_SUFFIX        ".delta"
+
+namespace TestableLogic
+{
+    // 索引中单个文件的标志位
+    enum TrigramFileFlags : uint32_t
+    {
+        TrigramFile_None = 0,
+        TrigramFile_KeyedHash = 1   // 使用带密钥的哈希（加密文档）
+    };
+
+    // ============ 磁盘布局（小端，4 字节对齐，可直接映射） ============
+    // [Header][FileEntry * fileCount][路径字符串池][TrigramEntry * trigramCount][文件ID * postingCount]
+#pragma pack(push, 4)
+    struct TrigramIndexHeader
+    {
+        char magic[TRIGRAM_INDEX_MAGIC_SIZE];
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t fileCount;
+        uint32_t trigramCount;
+        uint64_t postingCount;
+        uint64_t keyCheck;              // 盐的 SHA-256 校验值，密钥变化后加密条目作废；不能反推出盐
+        uint64_t fileTableOffset;
+        uint64_t stringPoolOffset;
+        uint64_t trigramTableOffset;
+        uint64_t postingOffset;
+        uint64_t totalSize;
+    };
+
+    struct TrigramFileEntry
+    {
+        uint64_t stamp;                 // 调用方提供的时间戳/版本
+        uint32_t pathOffset;            // 相对字符串池的偏移
+        uint32_t pathLength;            // UTF-8 字节数
+        uint32_t flags;
+        uint32_t trigramCount;
+    };
+
+    struct TrigramEntry
+    {
+        uint32_t key;
+        uint32_t postingStart;
+        uint32_t postingCount;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(TrigramIndexHeader) == 80, "TrigramIndexHeader layout changed");
+    static_assert(sizeof(TrigramFileEntry) == 24, "TrigramFileEntry layout changed");
+    static_assert(sizeof(TrigramEntry) == 12, "TrigramEntry layout changed");
+
+    // 扫描目录得到的一个文件
+    struct TrigramSourceFile
+    {
+        std::string path;
+        uint64_t stamp;                 // 修改时间等，与索引中的时间戳相同时不重新读入
+        bool bKeyedHash;
+    };
+
+    class TrigramIndex
+    {
+    public:
+        // keySalt 用于加密文档的带密钥哈希（由调用方从密钥派生），0 表示未配置
+        explicit TrigramIndex(uint64_t keySalt = 0);
+
+        // 映射基础索引并重放增量日志；文件不存在时得到空索引并返回 true
+        bool Load(const std::string& indexPath);
+
+        // 更新/删除单个文件（已 Load 时同时追加到增量日志）
+        bool UpdateFile(const std::string& filePath, const wchar_t* pText, size_t len,
+            uint64_t stamp, bool bKeyedHash);
+        bool RemoveFile(const std::string& filePath);
+
+        // 按目录扫描的结果刷新索引：时间戳未变的文件跳过，列表中没有的文件删除，
+        // 其余调用 loadText 读入全文后更新（读入失败的删除）。返回重新读入的文件数
+        size_t Refresh(const std::vector<TrigramSourceFile>& files,
+            const std::function<bool(const std::string&, std::wstring&)>& loadText);
+
+        // 将基础索引与增量合并写回磁盘，并清空增量日志
+        bool Compact();
+        bool SaveAs(const std::string& indexPath);
+
+        // 增量是否已大到值得合并
+        bool NeedsCompaction() const;
+
+        // 返回可能包含 needle 的候选文件（保证无漏报，可能有误报）
+        // needle 少于 3 个字符时无法缩小范围，返回全部文件
+        std::vector<std::string> Query(const wchar_t* pNeedle, size_t len) const;
+
+        // 先用索引缩小范围，再对候选文件执行完整匹配
+        std::vector<std::string> Search(const wchar_t* pNeedle, size_t len,
+            const std::function<bool(const std::string&)>& fullMatcher) const;
+
+        size_t FileCount() const;
+        bool Contains(const std::string& filePath) const;
+        uint64_t GetStamp(const std::string& filePath) const;
+
+        // 提取文本的三元组哈希（已排序、去重）
+        static std::vector<uint32_t> ExtractTrigramKeys(const wchar_t* pText, size_t len,
+            uint64_t salt);
+
+        // 由密钥派生 keySalt：带标签的 SHA-256 取前 8 字节；密钥为空或摘要失败时返回 0
+        static uint64_t DeriveKeySalt(const void* pKey, size_t keyLen);
+
+    private:
+        struct FileRecord
+        {
+            uint64_t stamp = 0;
+            uint32_t flags = 0;
+            bool removed = false;
+            std::vector<uint32_t> keys;
+        };
+
+        bool MapBase(const std::string& indexPath);
+        bool ReplayDelta(const std::string& deltaPath);
+        bool AppendDelta(const std::string& filePath, const FileRecord& record);
+        bool BaseFileValid(uint32_t fileId) const;
+        std::string BasePath(uint32_t fileId) const;
+        const TrigramEntry* FindBaseTrigram(uint32_t key) const;
+        void QueryBase(const std::vector<uint32_t>& keys, uint32_t flags,
+            std::vector<std::string>& out) const;
+
+        uint64_t m_keySalt;
+        uint64_t m_keyCheck;
+        std::string m_indexPath;
+        size_t m_nDeltaBytes;
+
+        // 基础索引（内存映射）
+        MappedFile m_base;
+        const TrigramIndexHeader* m_pHeader;
+        const TrigramFileEntry* m_pFiles;
+        const char* m_pStrings;
+        const TrigramEntry* m_pTrigrams;
+        const uint32_t* m_pPostings;
+        std::unordered_map<std::string, uint32_t> m_basePathToId;
+
+        // 增量（覆盖基础索引中的同名文件）
+        std::unordered_map<std::string, FileRecord> m_overlay;
+    };
+}
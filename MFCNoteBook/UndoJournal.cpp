@@ -0,0 +1,546 @@
+﻿// UndoJournal.cpp - 持久化撤销日志实现
+#include "UndoJournal.h"
+#include "CryptoUtil.h"
+#include "FileUtil.h"
+
+#include <cstring>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        const uint32_t RECORD_MAGIC = 0x4A444E55;  // "UNDJ"
+        const size_t TRAILER_SIZE = sizeof(uint32_t);
+
+        // MakeSecretCipher 从口令派生 MAC 密钥和校验值所用的标签
+        const char CIPHER_MAC_LABEL[] = "MFCNoteBook undo journal mac";
+        const char CIPHER_CHECK_LABEL[] = "MFCNoteBook undo journal key check";
+
+        uint32_t Fnv1a(const void* pData, size_t len)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(pData);
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < len; i++)
+            {
+                h ^= p[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        void AppendU64(std::vector<uint8_t>& out, uint64_t value)
+        {
+            for (int i = 0; i < 8; i++)
+                out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+
+        bool ReadU64(const std::vector<uint8_t>& data, size_t& pos, uint64_t& value)
+        {
+            if (pos > data.size() || data.size() - pos < 8)
+                return false;
+            value = 0;
+            for (int i = 0; i < 8; i++)
+                value |= static_cast<uint64_t>(data[pos + i]) << (i * 8);
+            pos += 8;
+            return true;
+        }
+    }
+
+    TextFingerprint FingerprintText(const char16_t* text, size_t len)
+    {
+        // 64 位 FNV-1a，逐个 UTF-16 单元
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < len; i++)
+        {
+            h ^= static_cast<uint64_t>(text[i]);
+            h *= 1099511628211ULL;
+        }
+        TextFingerprint fingerprint = { len, h };
+        return fingerprint;
+    }
+
+    bool MakeSecretCipher(const std::string& secret, UndoJournalCipher& cipher)
+    {
+        if (secret.empty())
+            return false;
+
+        uint8_t macKey[CRYPTO_SHA256_SIZE];
+        uint8_t check[CRYPTO_SHA256_SIZE];
+        if (!CryptoUtil::HmacSha256(secret.data(), secret.size(), CIPHER_MAC_LABEL, strlen(CIPHER_MAC_LABEL), macKey) ||
+            !CryptoUtil::HmacSha256(secret.data(), secret.size(), CIPHER_CHECK_LABEL, strlen(CIPHER_CHECK_LABEL), check))
+            return false;
+
+        cipher.keyCheck = 0;
+        for (int i = 7; i >= 0; i--)
+            cipher.keyCheck = (cipher.keyCheck << 8) | check[i];
+
+        std::vector<uint8_t> mac(macKey, macKey + sizeof(macKey));
+        cipher.encrypt = [secret, mac](const std::vector<uint8_t>& plain, std::vector<uint8_t>& out)
+        {
+            uint8_t iv[CRYPTO_AES_BLOCK_SIZE];
+            if (!CryptoUtil::Random(iv, sizeof(iv)))
+                return false;
+
+            // AES 补齐最多多出一个分组
+            out.assign(iv, iv + sizeof(iv));
+            out.resize(sizeof(iv) + plain.size() + CRYPTO_AES_BLOCK_SIZE);
+            size_t nCipher = 0;
+            if (!CryptoUtil::AesEncrypt(secret.data(), secret.size(), iv, plain.data(), plain.size(),
+                out.data() + sizeof(iv), nCipher))
+                return false;
+            out.resize(sizeof(iv) + nCipher);
+
+            uint8_t tag[CRYPTO_SHA256_SIZE];
+            if (!CryptoUtil::HmacSha256(mac.data(), mac.size(), out.data(), out.size(), tag))
+                return false;
+            out.insert(out.end(), tag, tag + sizeof(tag));
+            return true;
+        };
+        cipher.decrypt = [secret, mac](const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+        {
+            if (in.size() < 2 * CRYPTO_AES_BLOCK_SIZE + CRYPTO_SHA256_SIZE)
+                return false;
+
+            size_t nSigned = in.size() - CRYPTO_SHA256_SIZE;
+            uint8_t tag[CRYPTO_SHA256_SIZE];
+            if (!CryptoUtil::HmacSha256(mac.data(), mac.size(), in.data(), nSigned, tag) ||
+                !CryptoUtil::ConstantTimeEqual(tag, in.data() + nSigned, sizeof(tag)))
+                return false;
+
+            out.resize(nSigned - CRYPTO_AES_BLOCK_SIZE);
+            size_t nPlain = 0;
+            if (!CryptoUtil::AesDecrypt(secret.data(), secret.size(), in.data(),
+                in.data() + CRYPTO_AES_BLOCK_SIZE, out.size(), out.data(), nPlain))
+                return false;
+            out.resize(nPlain);
+            return true;
+        };
+        return true;
+    }
+
+    UndoJournal::UndoJournal()
+        : m_fp(nullptr)
+        , m_bEncrypted(false)
+        , m_bRestored(false)
+        , m_size(0)
+        , m_current(0)
+        , m_lastCheckpoint(0)
+        , m_nSinceCheckpoint(0)
+        , m_bytesRead(0)
+    {
+        m_cipher.keyCheck = 0;
+    }
+
+    UndoJournal::~UndoJournal()
+    {
+        Close();
+    }
+
+    void UndoJournal::Close()
+    {
+        if (m_fp)
+        {
+            fclose(m_fp);
+            m_fp = nullptr;
+        }
+        m_memory.clear();
+        m_path.clear();
+        m_bRestored = false;
+        m_size = 0;
+        m_current = 0;
+        m_redo.clear();
+        m_lastCheckpoint = 0;
+        m_nSinceCheckpoint = 0;
+        m_bytesRead = 0;
+    }
+
+    // ============ 打开 ============
+
+    bool UndoJournal::Open(const std::string& path, const TextFingerprint& text, const UndoJournalCipher* pCipher)
+    {
+        Close();
+        m_path = path;
+        m_bEncrypted = (pCipher != nullptr);
+        if (pCipher)
+            m_cipher = *pCipher;
+
+        if (!path.empty() && FileUtil::Exists(path))
+        {
+            m_fp = FileUtil::Open(path, "r+b");
+            if (m_fp && fseek(m_fp, 0, SEEK_END) == 0)
+            {
+                long nSize = ftell(m_fp);
+                m_size = nSize > 0 ? static_cast<uint64_t>(nSize) : 0;
+                if (Restore(text))
+                {
+                    m_bRestored = true;
+                    return true;
+                }
+            }
+            if (m_fp)
+            {
+                fclose(m_fp);
+                m_fp = nullptr;
+            }
+        }
+
+        if (StartFresh(text))
+            return true;
+
+        // 无法写日志文件：退回只在内存中记录
+        m_path.clear();
+        StartFresh(text);
+        return false;
+    }
+
+    bool UndoJournal::StartFresh(const TextFingerprint& text)
+    {
+        if (m_fp)
+        {
+            fclose(m_fp);
+            m_fp = nullptr;
+        }
+        m_memory.clear();
+        m_size = 0;
+        m_current = 0;
+        m_redo.clear();
+        m_lastCheckpoint = 0;
+        m_nSinceCheckpoint = 0;
+
+        if (!m_path.empty())
+        {
+            m_fp = FileUtil::Open(m_path, "w+b");
+            if (!m_fp)
+                return false;
+        }
+
+        UndoJournalHeader header = {};
+        memcpy(header.magic, UNDO_JOURNAL_MAGIC, UNDO_JOURNAL_MAGIC_SIZE);
+        header.version = UNDO_JOURNAL_VERSION;
+        header.flags = m_bEncrypted ? UndoJournal_Encrypted : UndoJournal_None;
+        header.keyCheck = m_bEncrypted ? m_cipher.keyCheck : 0;
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&header);
+        if (!AppendBytes(std::vector<uint8_t>(p, p + sizeof(header))))
+            return false;
+
+        // 最初的状态也是一个检查点：没有保存就关闭时，重新打开仍能对上
+        return Checkpoint(text);
+    }
+
+    bool UndoJournal::Restore(const TextFingerprint& text)
+    {
+        UndoJournalHeader header;
+        if (m_size < sizeof(header) + sizeof(UndoRecordHeader) + TRAILER_SIZE || !ReadAt(0, &header, sizeof(header)))
+            return false;
+        if (memcmp(header.magic, UNDO_JOURNAL_MAGIC, UNDO_JOURNAL_MAGIC_SIZE) != 0 ||
+            header.version != UNDO_JOURNAL_VERSION)
+            return false;
+        bool bEncrypted = (header.flags & UndoJournal_Encrypted) != 0;
+        if (bEncrypted != m_bEncrypted || (bEncrypted && header.keyCheck != m_cipher.keyCheck))
+            return false;
+
+        // 最后一条记录：由末尾的长度找到记录头，记录头中是最近的检查点
+        uint32_t lastSize = 0;
+        if (!ReadAt(m_size - TRAILER_SIZE, &lastSize, sizeof(lastSize)) ||
+            lastSize < sizeof(UndoRecordHeader) + TRAILER_SIZE || lastSize > m_size - sizeof(header))
+            return false;
+        uint64_t lastOffset = m_size - lastSize;
+        UndoRecordHeader last;
+        if (!ReadAt(lastOffset, &last, sizeof(last)) || last.magic != RECORD_MAGIC ||
+            sizeof(last) + last.payloadLength + TRAILER_SIZE != lastSize)
+            return false;
+        m_lastCheckpoint = (last.kind == UndoRecord_Checkpoint) ? lastOffset : last.lastCheckpoint;
+
+        // 从最近的检查点向前找与载入的文本一致的一个
+        uint64_t checkpoint = m_lastCheckpoint;
+        for (int i = 0; i < UNDO_JOURNAL_CHECKPOINT_WALK && checkpoint != 0; i++)
+        {
+            uint32_t kind = 0;
+            std::vector<uint8_t> payload;
+            if (!ReadRecord(checkpoint, kind, payload) || kind != UndoRecord_Checkpoint)
+                return false;
+
+            size_t pos = 0;
+            uint64_t current = 0, length = 0, hash = 0, previous = 0, redoCount = 0;
+            if (!ReadU64(payload, pos, current) || !ReadU64(payload, pos, length) ||
+                !ReadU64(payload, pos, hash) || !ReadU64(payload, pos, previous) ||
+                !ReadU64(payload, pos, redoCount) || redoCount > (payload.size() - pos) / 8)
+                return false;
+
+            if (length == text.length && hash == text.hash)
+            {
+                m_current = current;
+                m_redo.resize(static_cast<size_t>(redoCount));
+                for (uint64_t& node : m_redo)
+                    ReadU64(payload, pos, node);
+                return true;
+            }
+            checkpoint = previous;
+        }
+        return false;
+    }
+
+    // ============ 读写记录 ============
+
+    bool UndoJournal::ReadAt(uint64_t offset, void* pData, size_t len)
+    {
+        if (offset > m_size || len > m_size - offset)
+            return false;
+
+        if (!m_fp)
+        {
+            memcpy(pData, m_memory.data() + offset, len);
+            return true;
+        }
+
+        if (fseek(m_fp, static_cast<long>(offset), SEEK_SET) != 0 || fread(pData, 1, len, m_fp) != len)
+            return false;
+        m_bytesRead += len;
+        return true;
+    }
+
+    bool UndoJournal::AppendBytes(const std::vector<uint8_t>& data)
+    {
+        if (!m_fp)
+        {
+            m_memory.insert(m_memory.end(), data.begin(), data.end());
+            m_size += data.size();
+            return true;
+        }
+
+        // 一次写入整条记录，崩溃时最多留下一条不完整的尾部记录（重新打开时整个日志作废）
+        if (fseek(m_fp, 0, SEEK_END) != 0 || fwrite(data.data(), 1, data.size(), m_fp) != data.size() ||
+            fflush(m_fp) != 0)
+            return false;
+        m_size += data.size();
+        return true;
+    }
+
+    bool UndoJournal::AppendRecord(uint32_t kind, const std::vector<uint8_t>& payload, uint64_t* pOffset)
+    {
+        std::vector<uint8_t> stored;
+        if (m_bEncrypted)
+        {
+            if (!m_cipher.encrypt || !m_cipher.encrypt(payload, stored))
+                return false;
+        }
+        else
+        {
+            stored = payload;
+        }
+
+        UndoRecordHeader header = {};
+        header.magic = RECORD_MAGIC;
+        header.kind = kind;
+        header.payloadLength = static_cast<uint32_t>(stored.size());
+        header.checksum = Fnv1a(stored.data(), stored.size());
+        header.lastCheckpoint = m_lastCheckpoint;
+        uint32_t recordSize = static_cast<uint32_t>(sizeof(header) + stored.size() + TRAILER_SIZE);
+
+        std::vector<uint8_t> buffer(recordSize);
+        memcpy(buffer.data(), &header, sizeof(header));
+        if (!stored.empty())
+            memcpy(buffer.data() + sizeof(header), stored.data(), stored.size());
+        memcpy(buffer.data() + sizeof(header) + stored.size(), &recordSize, TRAILER_SIZE);
+
+        uint64_t offset = m_size;
+        if (!AppendBytes(buffer))
+            return false;
+        if (pOffset)
+            *pOffset = offset;
+        m_nSinceCheckpoint++;
+        return true;
+    }
+
+    bool UndoJournal::ReadRecord(uint64_t offset, uint32_t& kind, std::vector<uint8_t>& payload)
+    {
+        UndoRecordHeader header;
+        if (!ReadAt(offset, &header, sizeof(header)) || header.magic != RECORD_MAGIC)
+            return false;
+
+        std::vector<uint8_t> stored(header.payloadLength);
+        if (!stored.empty() && !ReadAt(offset + sizeof(header), stored.data(), stored.size()))
+            return false;
+        if (Fnv1a(stored.data(), stored.size()) != header.checksum)
+            return false;
+
+        kind = header.kind;
+        if (!m_bEncrypted)
+        {
+            payload.swap(stored);
+            return true;
+        }
+        return m_cipher.decrypt && m_cipher.decrypt(stored, payload);
+    }
+
+    bool UndoJournal::ReadEdit(uint64_t node, uint64_t& parent, TextDelta& delta)
+    {
+        uint32_t kind = 0;
+        std::vector<uint8_t> payload;
+        size_t pos = 0;
+        if (!ReadRecord(node, kind, payload) || kind != UndoRecord_Edit || !ReadU64(payload, pos, parent))
+            return false;
+        return DecodeTextDelta(payload.data() + pos, payload.size() - pos, delta);
+    }
+
+    bool UndoJournal::AppendMove()
+    {
+        std::vector<uint8_t> payload;
+        AppendU64(payload, m_current);
+        return AppendRecord(UndoRecord_Move, payload);
+    }
+
+    // ============ 编辑历史 ============
+
+    bool UndoJournal::Record(const TextDelta& delta)
+    {
+        if (delta.IsEmpty())
+            return true;
+
+        std::vector<uint8_t> payload;
+        AppendU64(payload, m_current);
+        EncodeTextDelta(delta, payload);
+
+        uint64_t node = 0;
+        if (!AppendRecord(UndoRecord_Edit, payload, &node))
+            return false;
+        m_current = node;
+        m_redo.clear();
+        return true;
+    }
+
+    bool UndoJournal::Undo(TextDelta& delta)
+    {
+        uint64_t parent = 0;
+        if (m_current == 0 || !ReadEdit(m_current, parent, delta))
+            return false;
+
+        m_redo.push_back(m_current);
+        m_current = parent;
+        return AppendMove();
+    }
+
+    bool UndoJournal::Redo(TextDelta& delta)
+    {
+        uint64_t parent = 0;
+        if (m_redo.empty() || !ReadEdit(m_redo.back(), parent, delta))
+            return false;
+
+        m_current = m_redo.back();
+        m_redo.pop_back();
+        return AppendMove();
+    }
+
+    bool UndoJournal::Follow(const TextDelta& delta, bool bForward)
+    {
+        TextDelta stored;
+        if (!bForward)
+            return Undo(stored) && stored == delta;
+
+        uint64_t parent = 0;
+        if (!m_redo.empty() && ReadEdit(m_redo.back(), parent, stored) && stored == delta)
+        {
+            m_current = m_redo.back();
+            m_redo.pop_back();
+            return AppendMove();
+        }
+        return Record(delta);
+    }
+
+    // ============ 检查点与压缩 ============
+
+    bool UndoJournal::Checkpoint(const TextFingerprint& text)
+    {
+        std::vector<uint8_t> payload;
+        AppendU64(payload, m_current);
+        AppendU64(payload, text.length);
+        AppendU64(payload, text.hash);
+        AppendU64(payload, m_lastCheckpoint);
+        AppendU64(payload, m_redo.size());
+        for (uint64_t node : m_redo)
+            AppendU64(payload, node);
+
+        uint64_t offset = 0;
+        if (!AppendRecord(UndoRecord_Checkpoint, payload, &offset))
+            return false;
+        m_lastCheckpoint = offset;
+        m_nSinceCheckpoint = 0;
+        return true;
+    }
+
+    bool UndoJournal::Compact(const TextFingerprint& text, const std::string& newPath)
+    {
+        // 1. 读出要保留的编辑：当前状态往前（不超过 UNDO_JOURNAL_KEEP_BYTES）和全部可重做的
+        std::vector<TextDelta> history;    // 由新到旧
+        size_t nKeptBytes = 0;
+        uint64_t node = m_current;
+        while (node != 0 && nKeptBytes < UNDO_JOURNAL_KEEP_BYTES)
+        {
+            TextDelta delta;
+            uint64_t parent = 0;
+            if (!ReadEdit(node, parent, delta))
+                break;
+            nKeptBytes += GetTextDeltaBytes(delta);
+            history.push_back(std::move(delta));
+            node = parent;
+        }
+
+        std::vector<TextDelta> redo;       // 下一个要重做的在前
+        for (auto it = m_redo.rbegin(); it != m_redo.rend(); ++it)
+        {
+            TextDelta delta;
+            uint64_t parent = 0;
+            if (!ReadEdit(*it, parent, delta))
+                break;
+            redo.push_back(std::move(delta));
+        }
+
+        // 2. 在内存中按同样的格式重新生成：依次记录，再撤销回当前状态，得到同样的可重做链
+        UndoJournal compacted;
+        compacted.m_bEncrypted = m_bEncrypted;
+        compacted.m_cipher = m_cipher;
+        if (!compacted.StartFresh(text))
+            return false;
+        for (auto it = history.rbegin(); it != history.rend(); ++it)
+            compacted.Record(*it);
+        for (const TextDelta& delta : redo)
+            compacted.Record(delta);
+        for (size_t i = 0; i < redo.size(); i++)
+        {
+            TextDelta ignored;
+            compacted.Undo(ignored);
+        }
+        if (!compacted.Checkpoint(text))
+            return false;
+
+        // 3. 替换原日志（先写临时文件再替换）
+        std::string path = newPath.empty() ? m_path : newPath;
+        if (!path.empty())
+        {
+            if (m_fp)
+            {
+                fclose(m_fp);
+                m_fp = nullptr;
+            }
+            if (!FileUtil::WriteAllAtomic(path, compacted.m_memory.data(), compacted.m_memory.size()))
+                return false;
+            m_fp = FileUtil::Open(path, "r+b");
+            if (!m_fp)
+                return false;
+            m_memory.clear();
+        }
+        else
+        {
+            m_memory.swap(compacted.m_memory);
+        }
+
+        m_path = path;
+        m_size = compacted.m_size;
+        m_current = compacted.m_current;
+        m_redo = compacted.m_redo;
+        m_lastCheckpoint = compacted.m_lastCheckpoint;
+        m_nSinceCheckpoint = 0;
+        return true;
+    }
+}
@@ -0,0 +1,188 @@
+﻿// UndoJournal.h - 持久化的撤销日志（不依赖MFC）
+//
+// 每个文档一个只追加的日志文件，关闭后重新打开仍能撤销上次的编辑：
+//   编辑记录  保存一条 TextDelta 和它的父节点（上一个状态）的记录偏移，记录偏移即节点标识；
+//   移动记录  撤销、重做后的当前节点；
+//   检查点    当前节点、此时文本的长度和哈希、可重做的节点，以及上一个检查点的偏移。
+// 每条记录末尾是整条记录的长度，记录头中是最近一个检查点的偏移，
+// 重新打开时只读文件尾部和一条检查点记录，就得到与载入的文本一致的状态，不重放整个日志；
+// 撤销到更早时再按父节点偏移逐条读出。文件超过上限后只保留最近的编辑重写（压缩）。
+// 加密文档的日志由调用方提供的加解密函数处理每条记录的负载（MakeSecretCipher 带 MAC 校验）。
+#pragma once
+
+#include "TextDelta.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============ 日志文件格式常量 ============
+#define UNDO_JOURNAL_MAGIC              "MNUNDO01"
+#define UNDO_JOURNAL_MAGIC_SIZE         8
+#define UNDO_JOURNAL_VERSION            1
+// 每追加这么多条记录写一个检查点
+#define UNDO_JOURNAL_CHECKPOINT_INTERVAL 64
+// 重新打开时最多向前查找的检查点数
+#define UNDO_JOURNAL_CHECKPOINT_WALK    16
+// 日志超过此大小时压缩，只保留当前状态之前约 UNDO_JOURNAL_KEEP_BYTES 的编辑
+#define UNDO_JOURNAL_MAX_BYTES          (8 * 1024 * 1024)
+#define UNDO_JOURNAL_KEEP_BYTES         (UNDO_JOURNAL_MAX_BYTES / 2)
+
+namespace TestableLogic
+{
+    enum UndoJournalFlags : uint32_t
+    {
+        UndoJournal_None = 0,
+        UndoJournal_Encrypted = 1
+    };
+
+    enum UndoRecordKind : uint32_t
+    {
+        UndoRecord_Edit = 1,
+        UndoRecord_Move = 2,
+        UndoRecord_Checkpoint = 3
+    };
+
+    // ============ 磁盘布局（小端） ============
+    // [Header][记录...]，记录为 [RecordHeader][负载][uint32 整条记录长度]
+#pragma pack(push, 4)
+    struct UndoJournalHeader
+    {
+        char magic[UNDO_JOURNAL_MAGIC_SIZE];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t keyCheck;              // 密钥校验值，密钥变化后日志作废
+    };
+
+    struct UndoRecordHeader
+    {
+        uint32_t magic;
+        uint32_t kind;
+        uint32_t payloadLength;
+        uint32_t checksum;              // 对（加密后的）负载的 FNV-1a，只用于发现写了一半的记录
+        uint64_t lastCheckpoint;        // 此前最近一个检查点的偏移，0 表示没有
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(UndoJournalHeader) == 24, "UndoJournalHeader layout changed");
+    static_assert(sizeof(UndoRecordHeader) == 24, "UndoRecordHeader layout changed");
+
+    // 文本的长度和 64 位哈希，用来确认载入的文档就是日志中某个检查点的状态
+    struct TextFingerprint
+    {
+        uint64_t length;
+        uint64_t hash;
+
+        bool operator==(const TextFingerprint& other) const
+        {
+            return length == other.length && hash == other.hash;
+        }
+    };
+
+    TextFingerprint FingerprintText(const char16_t* text, size_t len);
+
+#ifdef _WIN32
+    inline TextFingerprint FingerprintText(const wchar_t* text, size_t len)
+    {
+        return FingerprintText(reinterpret_cast<const char16_t*>(text), len);
+    }
+#endif
+
+    // 记录负载的加解密；返回 false 表示失败（日志随之作废）
+    struct UndoJournalCipher
+    {
+        std::function<bool(const std::vector<uint8_t>& plain, std::vector<uint8_t>& cipher)> encrypt;
+        std::function<bool(const std::vector<uint8_t>& cipher, std::vector<uint8_t>& plain)> decrypt;
+        uint64_t keyCheck;              // 由密钥派生，不能由它反推出密钥
+    };
+
+    // 由口令构造加解密：AES-128-CBC（与 .mynote 相同的密钥派生），每段负载为
+    // [IV][密文][HMAC-SHA256(IV + 密文)]，解密前先校验 MAC，被改动的记录不会被解密。
+    // MAC 密钥和 keyCheck 分别以不同标签对口令做 HMAC-SHA256 得到。口令为空或摘要失败时返回 false
+    bool MakeSecretCipher(const std::string& secret, UndoJournalCipher& cipher);
+
+    class UndoJournal
+    {
+    public:
+        UndoJournal();
+        ~UndoJournal();
+
+        UndoJournal(const UndoJournal&) = delete;
+        UndoJournal& operator=(const UndoJournal&) = delete;
+
+        // 打开 path 的日志（空路径表示只记录在内存中），text 为刚载入的文本。
+        // 日志中有与 text 一致的检查点时从它恢复撤销历史，否则（文档在别处被修改、
+        // 密钥不同、文件损坏）清空日志重新开始。pCipher 为空表示不加密。
+        // 只有无法创建日志文件时返回 false，此时退回只在内存中记录
+        bool Open(const std::string& path, const TextFingerprint& text, const UndoJournalCipher* pCipher = nullptr);
+        void Close();
+
+        // Open 是否恢复了已有的历史
+        bool IsRestored() const { return m_bRestored; }
+        const std::string& GetPath() const { return m_path; }
+        bool IsEncrypted() const { return m_bEncrypted; }
+
+        // ============ 编辑历史 ============
+
+        // 记录一次新的编辑，可重做的编辑随之丢弃
+        bool Record(const TextDelta& delta);
+
+        bool CanUndo() const { return m_current != 0; }
+        bool CanRedo() const { return !m_redo.empty(); }
+        size_t GetRedoCount() const { return m_redo.size(); }
+
+        // 取出要撤销的编辑（调用方反向应用）或要重做的编辑（正向应用）
+        bool Undo(TextDelta& delta);
+        bool Redo(TextDelta& delta);
+
+        // 跟随撤销树（UndoTree）的一步移动，日志只保存当前状态所在的那条路径：
+        // 反向即撤销，日志当前的编辑应与 delta 相同；正向时与下一个可重做的编辑相同就重做，
+        // 否则（切换到另一个分支）作为新的编辑记录。返回 false 表示日志与树已不一致
+        bool Follow(const TextDelta& delta, bool bForward);
+
+        // ============ 检查点与压缩 ============
+
+        // 距上一个检查点已追加 UNDO_JOURNAL_CHECKPOINT_INTERVAL 条记录
+        bool NeedsCheckpoint() const { return m_nSinceCheckpoint >= UNDO_JOURNAL_CHECKPOINT_INTERVAL; }
+        // 记录当前状态；保存文档后调用，text 为保存的文本
+        bool Checkpoint(const TextFingerprint& text);
+
+        bool NeedsCompaction() const { return m_size > UNDO_JOURNAL_MAX_BYTES; }
+        // 只保留当前状态之前约 UNDO_JOURNAL_KEEP_BYTES 的编辑和全部可重做的编辑重写日志；
+        // newPath 非空时写到新位置（文档另存为），此后的记录都追加到新位置
+        bool Compact(const TextFingerprint& text, const std::string& newPath = std::string());
+
+        // ============ 统计 ============
+
+        uint64_t GetSize() const { return m_size; }
+        // 打开以来从日志中读取的字节数
+        uint64_t GetBytesRead() const { return m_bytesRead; }
+
+    private:
+        bool StartFresh(const TextFingerprint& text);
+        bool Restore(const TextFingerprint& text);
+        bool ReadAt(uint64_t offset, void* pData, size_t len);
+        bool AppendBytes(const std::vector<uint8_t>& data);
+        bool AppendRecord(uint32_t kind, const std::vector<uint8_t>& payload, uint64_t* pOffset = nullptr);
+        bool ReadRecord(uint64_t offset, uint32_t& kind, std::vector<uint8_t>& payload);
+        bool ReadEdit(uint64_t node, uint64_t& parent, TextDelta& delta);
+        bool AppendMove();
+
+        std::string m_path;
+        FILE* m_fp;                     // 空路径时为 nullptr，记录保存在 m_memory 中
+        std::vector<uint8_t> m_memory;
+        bool m_bEncrypted;
+        UndoJournalCipher m_cipher;
+        bool m_bRestored;
+
+        uint64_t m_size;
+        uint64_t m_current;             // 当前节点（编辑记录的偏移），0 表示最初的状态
+        std::vector<uint64_t> m_redo;   // 可重做的节点，末尾是下一个要重做的
+        uint64_t m_lastCheckpoint;
+        size_t m_nSinceCheckpoint;
+        uint64_t m_bytesRead;
+    };
+}
@@ -0,0 +1,327 @@
+﻿// UndoTree.cpp - 分支撤销树实现
+#include "UndoTree.h"
+#include "LzCodec.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace TestableLogic
+{
+    namespace
+    {
+        // 根的 order 从中间开始，向上延伸时向前递减
+        const uint32_t kFirstOrder = 0x80000000u;
+    }
+
+    UndoTree::UndoTree()
+    {
+        Clear();
+    }
+
+    void UndoTree::Clear()
+    {
+        m_nodes.clear();
+        m_branches.clear();
+        m_chrono.clear();
+        m_recent.clear();
+        m_pending.clear();
+        m_clock = 0;
+        m_memory = UndoTreeMemory();
+
+        Node root;
+        root.delta.pos = 0;
+        root.parent = UNDO_NODE_NONE;
+        root.activeChild = UNDO_NODE_NONE;
+        root.depth = 0;
+        root.branch = 0;
+        root.order = kFirstOrder;
+        root.bytes = 0;
+        root.rawSize = 0;
+        root.lastUse = 0;
+        m_nodes.push_back(std::move(root));
+        m_branches.push_back({ 0, 0, 1, 0 });
+        m_chrono.push_back(0);
+        m_chronoBase = kFirstOrder;
+
+        m_root = 0;
+        m_current = 0;
+        m_totalBytes = 0;
+    }
+
+    // ============ 编辑与撤销/重做 ============
+
+    UndoNodeId UndoTree::Record(TextDelta delta)
+    {
+        UndoNodeId id = static_cast<UndoNodeId>(m_nodes.size());
+        size_t bytes = GetTextDeltaBytes(delta);
+
+        Node& parent = m_nodes[m_current];
+        Node node;
+        node.rawSize = 0;
+        node.lastUse = 0;
+        SetDelta(node, std::move(delta));
+        node.parent = m_current;
+        node.activeChild = UNDO_NODE_NONE;
+        node.depth = parent.depth + 1;
+        node.order = m_chronoBase + static_cast<uint32_t>(m_chrono.size());
+
+        // 父节点的第一个子节点延续父节点的分支，之后的每个子节点开一个新分支
+        if (parent.children.empty())
+        {
+            node.branch = parent.branch;
+            UndoBranchInfo& branch = m_branches[node.branch];
+            branch.tip = id;
+            branch.nodeCount++;
+            branch.bytes += bytes;
+        }
+        else
+        {
+            node.branch = static_cast<uint32_t>(m_branches.size());
+            m_branches.push_back({ id, id, 1, bytes });
+        }
+
+        parent.children.push_back(id);
+        parent.activeChild = id;
+        m_nodes.push_back(std::move(node));
+        m_chrono.push_back(id);
+        m_totalBytes += bytes;
+        m_current = id;
+        Touch(id);
+        return id;
+    }
+
+    bool UndoTree::Undo(UndoStep& step)
+    {
+        if (!CanUndo())
+            return false;
+
+        Thaw(m_current);
+        const Node& node = m_nodes[m_current];
+        step.pDelta = &node.delta;
+        step.bForward = false;
+        m_nodes[node.parent].activeChild = m_current;
+        m_current = node.parent;
+        return true;
+    }
+
+    bool UndoTree::Redo(UndoStep& step)
+    {
+        if (!CanRedo())
+            return false;
+
+        m_current = m_nodes[m_current].activeChild;
+        Thaw(m_current);
+        step.pDelta = &m_nodes[m_current].delta;
+        step.bForward = true;
+        return true;
+    }
+
+    // ============ 任意状态之间跳转 ============
+
+    UndoNodeId UndoTree::FindCommonAncestor(UndoNodeId a, UndoNodeId b) const
+    {
+        if (!IsValid(a) || !IsValid(b))
+            return UNDO_NODE_NONE;
+
+        while (m_nodes[a].depth > m_nodes[b].depth)
+            a = m_nodes[a].parent;
+        while (m_nodes[b].depth > m_nodes[a].depth)
+            b = m_nodes[b].parent;
+        while (a != b)
+        {
+            a = m_nodes[a].parent;
+            b = m_nodes[b].parent;
+        }
+        return a;
+    }
+
+    bool UndoTree::GetPath(UndoNodeId from, UndoNodeId to, std::vector<UndoStep>& steps)
+    {
+        steps.clear();
+        UndoNodeId ancestor = FindCommonAncestor(from, to);
+        if (ancestor == UNDO_NODE_NONE)
+            return false;
+
+        // 解压不会移动节点，指向增量的指针一直有效
+        for (UndoNodeId node = from; node != ancestor; node = m_nodes[node].parent)
+        {
+            Thaw(node);
+            steps.push_back({ &m_nodes[node].delta, false });
+        }
+
+        size_t down = steps.size();
+        for (UndoNodeId node = to; node != ancestor; node = m_nodes[node].parent)
+        {
+            Thaw(node);
+            steps.push_back({ &m_nodes[node].delta, true });
+        }
+        std::reverse(steps.begin() + down, steps.end());
+        return true;
+    }
+
+    bool UndoTree::JumpTo(UndoNodeId target, std::vector<UndoStep>& steps)
+    {
+        if (!GetPath(m_current, target, steps))
+            return false;
+
+        // 向上的一段让父节点记住来处，向下的一段让父节点指向去处，都可以再撤销、重做回来
+        UndoNodeId ancestor = FindCommonAncestor(m_current, target);
+        for (UndoNodeId node = m_current; node != ancestor; node = m_nodes[node].parent)
+            m_nodes[m_nodes[node].parent].activeChild = node;
+        for (UndoNodeId node = target; node != ancestor; node = m_nodes[node].parent)
+            m_nodes[m_nodes[node].parent].activeChild = node;
+
+        m_current = target;
+        return true;
+    }
+
+    size_t UndoTree::GetOrderIndex(UndoNodeId node) const
+    {
+        return m_nodes[node].order - m_chronoBase;
+    }
+
+    bool UndoTree::GetOlderState(UndoNodeId& node) const
+    {
+        size_t index = GetOrderIndex(m_current);
+        if (index == 0)
+            return false;
+        node = m_chrono[index - 1];
+        return true;
+    }
+
+    bool UndoTree::GetNewerState(UndoNodeId& node) const
+    {
+        size_t index = GetOrderIndex(m_current);
+        if (index + 1 >= m_chrono.size())
+            return false;
+        node = m_chrono[index + 1];
+        return true;
+    }
+
+    UndoNodeId UndoTree::ExtendRoot(TextDelta delta)
+    {
+        UndoNodeId id = static_cast<UndoNodeId>(m_nodes.size());
+        size_t bytes = GetTextDeltaBytes(delta);
+
+        // 原来的根得到从新根出发的增量，新根与它在同一分支上
+        Node& oldRoot = m_nodes[m_root];
+        SetDelta(oldRoot, std::move(delta));
+        oldRoot.parent = id;
+
+        Node root;
+        root.delta.pos = 0;
+        root.parent = UNDO_NODE_NONE;
+        root.activeChild = m_root;
+        root.children.push_back(m_root);
+        root.depth = oldRoot.depth - 1;
+        root.branch = oldRoot.branch;
+        root.order = --m_chronoBase;
+        root.bytes = 0;
+        root.rawSize = 0;
+        root.lastUse = 0;
+
+        UndoBranchInfo& branch = m_branches[root.branch];
+        branch.first = id;
+        branch.nodeCount++;
+        branch.bytes += bytes;
+        m_totalBytes += bytes;
+
+        Touch(m_root);
+        m_nodes.push_back(std::move(root));
+        m_chrono.push_front(id);
+        m_root = id;
+        return id;
+    }
+
+    const TextDelta& UndoTree::GetDelta(UndoNodeId node)
+    {
+        Thaw(node);
+        return m_nodes[node].delta;
+    }
+
+    // ============ 分层存储 ============
+
+    void UndoTree::SetDelta(Node& node, TextDelta delta)
+    {
+        node.delta = std::move(delta);
+        node.bytes = static_cast<uint32_t>(GetTextDeltaBytes(node.delta));
+        m_memory.hotNodes++;
+        m_memory.hotBytes += node.bytes;
+    }
+
+    void UndoTree::Touch(UndoNodeId node)
+    {
+        m_nodes[node].lastUse = ++m_clock;
+        m_recent.push_back({ node, m_clock });
+
+        // 移出最近用到的范围、此后没有再用到的较大节点排队压缩
+        while (m_recent.size() > UNDO_TREE_HOT_COUNT)
+        {
+            std::pair<UndoNodeId, uint64_t> entry = m_recent.front();
+            m_recent.pop_front();
+            const Node& old = m_nodes[entry.first];
+            if (old.lastUse == entry.second && old.packed.empty() && old.bytes >= UNDO_TREE_MIN_COMPRESS_BYTES)
+                m_pending.push_back(entry);
+        }
+    }
+
+    void UndoTree::Thaw(UndoNodeId node)
+    {
+        Node& n = m_nodes[node];
+        if (!n.packed.empty())
+        {
+            std::vector<uint8_t> raw;
+            bool bOk = LzDecompress(n.packed.data(), n.packed.size(), n.rawSize, raw)
+                && DecodeTextDelta(raw.data(), raw.size(), n.delta);
+            (void)bOk;      // 压缩的数据只在内存中，不会损坏
+
+            m_memory.coldNodes--;
+            m_memory.coldBytes -= n.packed.size();
+            m_memory.coldRawBytes -= n.bytes;
+            m_memory.hotNodes++;
+            m_memory.hotBytes += n.bytes;
+            m_memory.decompressCount++;
+            std::vector<uint8_t>().swap(n.packed);
+        }
+        Touch(node);
+    }
+
+    size_t UndoTree::CompressColdNodes(size_t maxNodes)
+    {
+        size_t compressed = 0;
+        std::vector<uint8_t> raw;
+        while (compressed < maxNodes && !m_pending.empty())
+        {
+            std::pair<UndoNodeId, uint64_t> entry = m_pending.back();
+            m_pending.pop_back();
+
+            // 排队之后又用到过（已回到最近用到的范围）
+            Node& n = m_nodes[entry.first];
+            if (n.lastUse != entry.second || !n.packed.empty())
+                continue;
+
+            raw.clear();
+            EncodeTextDelta(n.delta, raw);
+            std::vector<uint8_t> packed;
+            LzCompress(raw.data(), raw.size(), packed);
+            // 压缩不到原来的 3/4 就保持原样
+            if (packed.size() * 4 > raw.size() * 3)
+                continue;
+
+            packed.shrink_to_fit();
+            n.packed.swap(packed);
+            n.rawSize = static_cast<uint32_t>(raw.size());
+            std::u16string().swap(n.delta.removed);
+            std::u16string().swap(n.delta.inserted);
+
+            m_memory.hotNodes--;
+            m_memory.hotBytes -= n.bytes;
+            m_memory.coldNodes++;
+            m_memory.coldBytes += n.packed.size();
+            m_memory.coldRawBytes += n.bytes;
+            m_memory.compressCount++;
+            compressed++;
+        }
+        return compressed;
+    }
+}
@@ -0,0 +1,161 @@
+﻿// UndoTree.h - 分支撤销树（不依赖MFC）
+//
+// 撤销后再编辑不再丢弃可重做的编辑：新的编辑作为当前状态的又一个子节点，原来的分支仍然保留。
+// 每个节点只保存从父状态到它的一条 TextDelta，分支之间共享公共祖先上的增量，不重复保存文本。
+// 任意两个状态之间的切换沿“当前 → 公共祖先 → 目标”的路径依次反向、正向应用增量，
+// 路径长度就是两者到公共祖先的深度差之和，与文本长度和历史总数无关。
+//
+// 分支：从某个节点第一次长出的子节点开始，沿每个节点的第一个子节点向下的一串节点；
+// 根所在的一串是 0 号分支。每个分支统计节点数和增量占用的字节数。
+//
+// 分层存储：最近用到的约 UNDO_TREE_HOT_COUNT 个节点保持原样，更早的较大增量排队，
+// 由调用方在空闲时分批调用 CompressColdNodes 用 LZ 压缩；撤销走到压缩过的节点时才解压，
+// 解压后的节点重新算作最近用到的。
+#pragma once
+
+#include "TextDelta.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// 保持不压缩的最近用到的节点数
+#define UNDO_TREE_HOT_COUNT             256
+// 小于此字节数（GetTextDeltaBytes）的增量不值得压缩
+#define UNDO_TREE_MIN_COMPRESS_BYTES    256
+
+namespace TestableLogic
+{
+    typedef uint32_t UndoNodeId;
+
+    // 不存在的节点
+    const UndoNodeId UNDO_NODE_NONE = 0xFFFFFFFFu;
+
+    // 路径上的一步：bForward 为 true 时正向应用（父 → 子），否则反向应用（子 → 父）。
+    // pDelta 指向树中节点保存的增量，树再次修改之前有效
+    struct UndoStep
+    {
+        const TextDelta* pDelta;
+        bool bForward;
+    };
+
+    struct UndoBranchInfo
+    {
+        UndoNodeId first;           // 分支上最早的节点
+        UndoNodeId tip;             // 分支末端的节点
+        size_t nodeCount;
+        size_t bytes;               // 分支上各节点增量的 GetTextDeltaBytes 之和
+    };
+
+    // 增量的内存占用：原样保存的按 GetTextDeltaBytes 计，压缩的按压缩后的字节数计
+    struct UndoTreeMemory
+    {
+        size_t hotNodes;
+        size_t coldNodes;
+        size_t hotBytes;
+        size_t coldBytes;
+        size_t coldRawBytes;        // 压缩的节点原来的 GetTextDeltaBytes 之和
+        uint64_t compressCount;     // 累计压缩、解压的次数
+        uint64_t decompressCount;
+    };
+
+    class UndoTree
+    {
+    public:
+        UndoTree();
+
+        // 只剩一个根节点（当前状态），历史全部丢弃
+        void Clear();
+
+        // ============ 编辑与撤销/重做 ============
+
+        // 在当前状态下记录一次编辑，新节点成为当前状态；原有的子分支保留
+        UndoNodeId Record(TextDelta delta);
+
+        UndoNodeId GetCurrent() const { return m_current; }
+        UndoNodeId GetRoot() const { return m_root; }
+
+        bool CanUndo() const { return m_current != m_root; }
+        // 重做沿最近一次经过的子节点向下
+        bool CanRedo() const { return m_nodes[m_current].activeChild != UNDO_NODE_NONE; }
+
+        bool Undo(UndoStep& step);
+        bool Redo(UndoStep& step);
+
+        // ============ 任意状态之间跳转 ============
+
+        UndoNodeId FindCommonAncestor(UndoNodeId a, UndoNodeId b) const;
+        // from 到 to 的路径，按顺序应用（路径上压缩过的节点随之解压）
+        bool GetPath(UndoNodeId from, UndoNodeId to, std::vector<UndoStep>& steps);
+        // 跳到 target 并返回要应用的路径；沿途的父节点记住经过的子节点，之后的重做沿这条路径
+        bool JumpTo(UndoNodeId target, std::vector<UndoStep>& steps);
+
+        // 按记录的先后：比当前状态早一步、晚一步的状态（可能在另一个分支上）
+        bool GetOlderState(UndoNodeId& node) const;
+        bool GetNewerState(UndoNodeId& node) const;
+
+        // 根不是最初的状态时（从撤销日志恢复），把从更早的状态到根的增量接在根上方，新节点成为根
+        UndoNodeId ExtendRoot(TextDelta delta);
+
+        // ============ 节点与内存统计 ============
+
+        size_t GetNodeCount() const { return m_nodes.size(); }
+        bool IsValid(UndoNodeId node) const { return node < m_nodes.size(); }
+        UndoNodeId GetParent(UndoNodeId node) const { return m_nodes[node].parent; }
+        const std::vector<UndoNodeId>& GetChildren(UndoNodeId node) const { return m_nodes[node].children; }
+        // 从父状态到 node 的增量（根为空增量），压缩过的先解压
+        const TextDelta& GetDelta(UndoNodeId node);
+        size_t GetDeltaBytes(UndoNodeId node) const { return m_nodes[node].bytes; }
+        bool IsCompressed(UndoNodeId node) const { return !m_nodes[node].packed.empty(); }
+
+        size_t GetBranchCount() const { return m_branches.size(); }
+        const UndoBranchInfo& GetBranch(size_t branch) const { return m_branches[branch]; }
+        size_t GetBranchOf(UndoNodeId node) const { return m_nodes[node].branch; }
+        size_t GetTotalBytes() const { return m_totalBytes; }
+
+        // ============ 分层存储 ============
+
+        // 有等待压缩的节点
+        bool HasColdNodes() const { return !m_pending.empty(); }
+        // 最多压缩 maxNodes 个等待压缩的节点，返回实际压缩的个数
+        size_t CompressColdNodes(size_t maxNodes);
+        const UndoTreeMemory& GetMemory() const { return m_memory; }
+
+    private:
+        struct Node
+        {
+            TextDelta delta;
+            UndoNodeId parent;
+            UndoNodeId activeChild;     // 重做的方向
+            std::vector<UndoNodeId> children;
+            int64_t depth;              // 相对最初的根，向上延伸后可以为负
+            uint32_t branch;
+            uint32_t order;             // 在 m_chrono 中的位置（相对 m_chronoBase）
+            uint32_t bytes;             // GetTextDeltaBytes(delta)，压缩后不变
+            uint32_t rawSize;           // 压缩前 EncodeTextDelta 的字节数
+            std::vector<uint8_t> packed;    // 非空时 delta 已清空，内容在这里
+            uint64_t lastUse;
+        };
+
+        size_t GetOrderIndex(UndoNodeId node) const;
+        void Touch(UndoNodeId node);
+        void Thaw(UndoNodeId node);
+        void SetDelta(Node& node, TextDelta delta);
+
+        std::vector<Node> m_nodes;
+        std::vector<UndoBranchInfo> m_branches;
+        std::deque<UndoNodeId> m_chrono;    // 按记录先后排列的节点，向上延伸的根插在前面
+        uint32_t m_chronoBase;              // m_chrono[0] 的 order
+        UndoNodeId m_root;
+        UndoNodeId m_current;
+        size_t m_totalBytes;
+
+        // 最近用到的节点（节点、用到时的 lastUse），超出 UNDO_TREE_HOT_COUNT 的移入 m_pending
+        std::deque<std::pair<UndoNodeId, uint64_t>> m_recent;
+        std::vector<std::pair<UndoNodeId, uint64_t>> m_pending;
+        uint64_t m_clock;
+        UndoTreeMemory m_memory;
+    };
+}
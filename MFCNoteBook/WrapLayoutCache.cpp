@@ -0,0 +1,158 @@
+﻿// WrapLayoutCache.cpp - 自动换行排版缓存实现
+#include "WrapLayoutCache.h"
+
+#include <algorithm>
+
+namespace TestableLogic
+{
+    WrapLayoutCache::WrapLayoutCache()
+        : m_wrapColumns(0)
+        , m_totalRows(0)
+        , m_invalidCount(0)
+    {
+        Reset(1, 0);
+    }
+
+    void WrapLayoutCache::Reset(size_t lineCount, size_t wrapColumns)
+    {
+        m_wrapColumns = wrapColumns;
+        m_rows.assign((std::max)(lineCount, static_cast<size_t>(1)), 0);
+        m_invalidCount = m_rows.size();
+        RebuildBlocks(0);
+    }
+
+    void WrapLayoutCache::SetWrapColumns(size_t wrapColumns)
+    {
+        if (wrapColumns != m_wrapColumns)
+            Reset(m_rows.size(), wrapColumns);
+    }
+
+    void WrapLayoutCache::RebuildBlocks(size_t firstBlock)
+    {
+        size_t blocks = (m_rows.size() + WRAP_BLOCK_LINES - 1) / WRAP_BLOCK_LINES;
+        m_blockRows.resize(blocks);
+        for (size_t b = firstBlock; b < blocks; b++)
+        {
+            size_t begin = b * WRAP_BLOCK_LINES;
+            size_t end = (std::min)(begin + WRAP_BLOCK_LINES, m_rows.size());
+            uint64_t sum = 0;
+            for (size_t i = begin; i < end; i++)
+                sum += m_rows[i] ? m_rows[i] : 1;
+            m_blockRows[b] = sum;
+        }
+
+        m_totalRows = 0;
+        for (uint64_t rows : m_blockRows)
+            m_totalRows += rows;
+    }
+
+    void WrapLayoutCache::ReplaceLines(size_t firstLine, size_t oldLines, size_t newLines)
+    {
+        firstLine = (std::min)(firstLine, m_rows.size());
+        oldLines = (std::min)(oldLines, m_rows.size() - firstLine);
+
+        for (size_t i = firstLine; i < firstLine + oldLines; i++)
+        {
+            if (m_rows[i] == 0)
+                m_invalidCount--;
+        }
+
+        if (oldLines == newLines)
+        {
+            // 行数不变（行内编辑）：只更新所在的块
+            std::fill(m_rows.begin() + firstLine, m_rows.begin() + firstLine + newLines, 0u);
+            m_invalidCount += newLines;
+            size_t firstBlock = firstLine / WRAP_BLOCK_LINES;
+            size_t lastBlock = (firstLine + newLines + WRAP_BLOCK_LINES - 1) / WRAP_BLOCK_LINES;
+            for (size_t b = firstBlock; b < lastBlock && b < m_blockRows.size(); b++)
+            {
+                uint64_t before = m_blockRows[b];
+                size_t begin = b * WRAP_BLOCK_LINES;
+                size_t end = (std::min)(begin + WRAP_BLOCK_LINES, m_rows.size());
+                uint64_t sum = 0;
+                for (size_t i = begin; i < end; i++)
+                    sum += m_rows[i] ? m_rows[i] : 1;
+                m_blockRows[b] = sum;
+                m_totalRows = m_totalRows - before + sum;
+            }
+            return;
+        }
+
+        // 行数变化：其后各行的位置都变了，从这一块开始重新累加
+        m_rows.erase(m_rows.begin() + firstLine, m_rows.begin() + firstLine + oldLines);
+        m_rows.insert(m_rows.begin() + firstLine, newLines, 0u);
+        m_invalidCount += newLines;
+        if (m_rows.empty())
+        {
+            m_rows.push_back(0);
+            m_invalidCount++;
+        }
+        RebuildBlocks(firstLine / WRAP_BLOCK_LINES);
+    }
+
+    void WrapLayoutCache::SetLineRows(size_t line, size_t rows)
+    {
+        uint32_t value = static_cast<uint32_t>((std::min)((std::max)(rows, static_cast<size_t>(1)),
+            static_cast<size_t>(UINT32_MAX)));
+        uint64_t oldValue = m_rows[line] ? m_rows[line] : 1;
+        if (m_rows[line] == 0)
+            m_invalidCount--;
+        m_rows[line] = value;
+
+        m_blockRows[line / WRAP_BLOCK_LINES] += static_cast<uint64_t>(value) - oldValue;
+        m_totalRows += static_cast<uint64_t>(value) - oldValue;
+    }
+
+    uint64_t WrapLayoutCache::GetRowFromLine(size_t line) const
+    {
+        line = (std::min)(line, m_rows.size());
+        size_t block = line / WRAP_BLOCK_LINES;
+        uint64_t row = 0;
+        for (size_t b = 0; b < block; b++)
+            row += m_blockRows[b];
+        for (size_t i = block * WRAP_BLOCK_LINES; i < line; i++)
+            row += GetLineRows(i);
+        return row;
+    }
+
+    size_t WrapLayoutCache::GetLineFromRow(uint64_t row, size_t* pSubRow) const
+    {
+        if (row >= m_totalRows)
+        {
+            // 超出末尾：停在最后一行的最后一个可视行
+            size_t last = m_rows.size() - 1;
+            if (pSubRow)
+                *pSubRow = GetLineRows(last) - 1;
+            return last;
+        }
+
+        size_t b = 0;
+        while (row >= m_blockRows[b])
+            row -= m_blockRows[b++];
+
+        size_t line = b * WRAP_BLOCK_LINES;
+        while (row >= GetLineRows(line))
+            row -= GetLineRows(line++);
+
+        if (pSubRow)
+            *pSubRow = static_cast<size_t>(row);
+        return line;
+    }
+
+    size_t WrapLayoutCache::FindInvalidLine(size_t from) const
+    {
+        if (m_invalidCount == 0)
+            return m_rows.size();
+        for (size_t i = from; i < m_rows.size(); i++)
+        {
+            if (m_rows[i] == 0)
+                return i;
+        }
+        for (size_t i = 0; i < from && i < m_rows.size(); i++)
+        {
+            if (m_rows[i] == 0)
+                return i;
+        }
+        return m_rows.size();
+    }
+}
@@ -0,0 +1,57 @@
+﻿// WrapLayoutCache.h - 自动换行的排版缓存：每个逻辑行折成几个可视行（不依赖MFC）
+//
+// 折行结果（每行的可视行数）按逻辑行缓存，编辑时只让改动的几行失效；
+// 折行宽度变化时全部标记为未计算，未计算的行按 1 个可视行估计，
+// 由调用方先计算可见区域，其余在空闲时分批补算。
+// 行按 WRAP_BLOCK_LINES 分块并记录每块的可视行数之和，可视行和逻辑行互相换算时不必逐行累加。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define WRAP_BLOCK_LINES        1024
+
+namespace TestableLogic
+{
+    class WrapLayoutCache
+    {
+    public:
+        WrapLayoutCache();
+
+        // 行数或折行宽度整体变化：全部标记为未计算
+        void Reset(size_t lineCount, size_t wrapColumns);
+        void SetWrapColumns(size_t wrapColumns);
+        size_t GetWrapColumns() const { return m_wrapColumns; }
+        size_t GetLineCount() const { return m_rows.size(); }
+
+        // 编辑：从 firstLine 开始的 oldLines 行被替换为 newLines 行，这些行需要重新计算
+        void ReplaceLines(size_t firstLine, size_t oldLines, size_t newLines);
+
+        bool IsLineValid(size_t line) const { return m_rows[line] != 0; }
+        // 记录一行的可视行数（至少为 1）
+        void SetLineRows(size_t line, size_t rows);
+        // 未计算的行按 1 个可视行估计
+        size_t GetLineRows(size_t line) const { return m_rows[line] ? m_rows[line] : 1; }
+
+        uint64_t GetTotalRows() const { return m_totalRows; }
+
+        // 逻辑行的第一个可视行
+        uint64_t GetRowFromLine(size_t line) const;
+        // 可视行所在的逻辑行，pSubRow 返回它是该行的第几个可视行
+        size_t GetLineFromRow(uint64_t row, size_t* pSubRow = nullptr) const;
+
+        // 从 from 开始（到末尾后从头）的第一个未计算的行，没有时返回 GetLineCount()
+        size_t FindInvalidLine(size_t from) const;
+        size_t GetInvalidCount() const { return m_invalidCount; }
+
+    private:
+        void RebuildBlocks(size_t firstBlock);
+
+        size_t m_wrapColumns;
+        std::vector<uint32_t> m_rows;       // 每行的可视行数，0 表示未计算
+        std::vector<uint64_t> m_blockRows;  // 每块的可视行数之和（未计算的行按 1 计）
+        uint64_t m_totalRows;
+        size_t m_invalidCount;
+    };
+}
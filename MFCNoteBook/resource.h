@@ -8,6 +8,7 @@
 #define IDR_MFCNoteBookTYPE             130
 #define ID_WINDOW_MANAGER               131
 #define IDD_FIND_REPLACE                310
+#define IDD_FIND_IN_NOTES               312
 #define IDC_EDIT_FIND                   1000
 #define IDC_EDIT_REPLACE                1001
 #define IDC_CHECK_CASE                  1002
@@ -17,6 +18,10 @@
 #define IDC_BTN_REPLACE                 1006
 #define IDC_BTN_REPLACE_ALL             1007
 #define IDC_STATIC_STATUS               1009
+#define IDC_EDIT_NOTES_FIND             1010
+#define IDC_CHECK_NOTES_CASE            1011
+#define IDC_LIST_NOTES_RESULTS          1012
+#define IDC_STATIC_NOTES_STATUS         1013
 #define ID_Menu                         32771
 #define ID_32775                        32775
 #define ID_ACCELERATOR32778             32778
@@ -26,14 +31,21 @@
 #define ID_VIEW_ZOOM_IN                 32793
 #define ID_VIEW_ZOOM_OUT                32794
 #define ID_VIEW_ZOOM_RESET              32795
+#define ID_VIEW_WORD_WRAP               32796
+#define ID_EDIT_UNDO_OLDER              32797
+#define ID_EDIT_UNDO_NEWER              32798
+#define ID_VIEW_THEME_USER_FIRST        32800
+#define ID_VIEW_THEME_USER_LAST         32829
+#define ID_INDICATOR_MEMORY             32830
+#define ID_EDIT_FIND_IN_NOTES           32831
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        312
+#define _APS_NEXT_RESOURCE_VALUE        313
 #define _APS_NEXT_COMMAND_VALUE         32785
-#define _APS_NEXT_CONTROL_VALUE         1010
+#define _APS_NEXT_CONTROL_VALUE         1014
 #define _APS_NEXT_SYMED_VALUE           310
 #endif
 #endif
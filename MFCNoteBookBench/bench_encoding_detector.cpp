@@ -0,0 +1,71 @@
+﻿// bench_encoding_detector.cpp - 编码检测耗时基准（采样，耗时与文件大小基本无关）
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/EncodingDetector.h"
+#include "../MFCNoteBook/TextCodec.h"
+
+#include <string>
+#include <vector>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 0: UTF-8 中文  1: GBK 中文（UTF-8 校验失败后走 GB18030 统计）  2: UTF-16LE
+    std::vector<uint8_t> MakeDocument(int kind, size_t bytes)
+    {
+        static const char16_t sentence[] = u"会议纪要：记事本的编码检测模块已完成初稿，下周进行代码评审。Review notes 2025.\r\n";
+        std::u16string unit(sentence);
+        std::vector<uint8_t> piece;
+        if (kind == 0)
+        {
+            std::string utf8 = Utf16ToUtf8String(unit.data(), unit.size());
+            piece.assign(utf8.begin(), utf8.end());
+        }
+        else if (kind == 1)
+        {
+            // 构造符合 GB2312 汉字区结构的双字节序列
+            for (char16_t c : unit)
+            {
+                if (c < 0x80)
+                {
+                    piece.push_back(static_cast<uint8_t>(c));
+                }
+                else
+                {
+                    piece.push_back(static_cast<uint8_t>(0xB0 + c % 0x40));
+                    piece.push_back(static_cast<uint8_t>(0xA1 + c % 0x5E));
+                }
+            }
+        }
+        else
+        {
+            for (char16_t c : unit)
+            {
+                piece.push_back(static_cast<uint8_t>(c & 0xFF));
+                piece.push_back(static_cast<uint8_t>(c >> 8));
+            }
+        }
+
+        std::vector<uint8_t> doc;
+        doc.reserve(bytes + piece.size());
+        while (doc.size() < bytes)
+            doc.insert(doc.end(), piece.begin(), piece.end());
+        return doc;
+    }
+}
+
+static void BM_DetectTextEncoding(benchmark::State& state)
+{
+    std::vector<uint8_t> doc = MakeDocument(static_cast<int>(state.range(0)), static_cast<size_t>(state.range(1)));
+    EncodingDetectResult result = {};
+    for (auto _ : state)
+    {
+        result = DetectTextEncoding(doc.data(), doc.size());
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetLabel(GetTextEncodingName(result.encoding));
+}
+BENCHMARK(BM_DetectTextEncoding)
+    ->ArgsProduct({ { 0, 1, 2 }, { int64_t(16) << 10, int64_t(1) << 20, int64_t(256) << 20 } })
+    ->Unit(benchmark::kMicrosecond);
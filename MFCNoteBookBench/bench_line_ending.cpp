@@ -0,0 +1,113 @@
+﻿// bench_line_ending.cpp - 换行符检测与转换吞吐基准（与 memcpy 的内存带宽对照）
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/LineEnding.h"
+#include "../MFCNoteBook/SimdSupport.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 约 len 个单元的文本，平均行长 avgLine，换行统一为 ending
+    std::u16string MakeText(size_t len, size_t avgLine, LineEnding ending)
+    {
+        const char16_t* breaks[] = { u"\r\n", u"\n", u"\r" };
+        std::mt19937 rng(42);
+        std::u16string text;
+        text.reserve(len + avgLine * 2);
+        while (text.size() < len)
+        {
+            size_t lineLen = rng() % (avgLine * 2);
+            for (size_t i = 0; i < lineLen; i++)
+                text += static_cast<char16_t>((rng() % 3 == 0) ? 0x4E00 + rng() % 0x5200 : 'a' + rng() % 26);
+            text += breaks[static_cast<int>(ending)];
+        }
+        return text;
+    }
+
+    void SetLevelOrSkip(benchmark::State& state, int level)
+    {
+        if (level > static_cast<int>(GetDetectedSimdLevel()))
+            state.SkipWithError("SIMD level not supported on this CPU");
+        SetSimdLevelOverride(static_cast<SimdLevel>(level));
+        state.SetLabel(GetSimdLevelName(GetSimdLevel()));
+    }
+
+    // SIMD 级别（Scalar/SSE2/AVX2）x 平均行长 x 大小
+    void LineArgs(benchmark::internal::Benchmark* b)
+    {
+        for (int64_t size : { int64_t(1) << 20, int64_t(64) << 20 })
+            for (int64_t avgLine : { 40, 400 })
+                for (int level : { 0, 1, 3 })
+                    b->Args({ level, avgLine, size });
+    }
+}
+
+// 对照：同样大小的 memcpy
+static void BM_LineEnding_MemcpyBaseline(benchmark::State& state)
+{
+    std::u16string src = MakeText(static_cast<size_t>(state.range(2)), static_cast<size_t>(state.range(1)), LineEnding::Lf);
+    std::u16string dst(src.size(), u'\0');
+    for (auto _ : state)
+    {
+        memcpy(&dst[0], src.data(), src.size() * sizeof(char16_t));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(src.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_LineEnding_MemcpyBaseline)->Args({ 0, 40, int64_t(1) << 20 })->Args({ 0, 40, int64_t(64) << 20 })
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_CountLineEndings(benchmark::State& state)
+{
+    std::u16string text = MakeText(static_cast<size_t>(state.range(2)), static_cast<size_t>(state.range(1)), LineEnding::Lf);
+    SetLevelOrSkip(state, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(CountLineEndings(text.data(), text.size()));
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(text.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_CountLineEndings)->Apply(LineArgs)->Unit(benchmark::kMicrosecond);
+
+// 载入：LF → CRLF（输出变长）
+static void BM_ConvertLfToCrLf(benchmark::State& state)
+{
+    std::u16string text = MakeText(static_cast<size_t>(state.range(2)), static_cast<size_t>(state.range(1)), LineEnding::Lf);
+    LineEndingStats stats = CountLineEndings(text.data(), text.size());
+    std::u16string out(GetConvertedLength(stats, text.size(), LineEnding::CrLf), u'\0');
+    SetLevelOrSkip(state, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ConvertLineEndings(text.data(), text.size(), LineEnding::CrLf, &out[0], out.size()));
+        benchmark::ClobberMemory();
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(text.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_ConvertLfToCrLf)->Apply(LineArgs)->Unit(benchmark::kMicrosecond);
+
+// 保存：CRLF → LF，64 KB 分块（对应 SaveAsPlainText）
+static void BM_ConvertCrLfToLf_Chunked(benchmark::State& state)
+{
+    std::u16string text = MakeText(static_cast<size_t>(state.range(2)), static_cast<size_t>(state.range(1)), LineEnding::CrLf);
+    std::u16string chunk(64 * 1024, u'\0');
+    SetLevelOrSkip(state, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            LineEndingConvertResult r = ConvertLineEndings(text.data() + pos, text.size() - pos, LineEnding::Lf,
+                &chunk[0], chunk.size());
+            benchmark::DoNotOptimize(chunk.data());
+            pos += r.consumed;
+        }
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(text.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_ConvertCrLfToLf_Chunked)->Apply(LineArgs)->Unit(benchmark::kMicrosecond);
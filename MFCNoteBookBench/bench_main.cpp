@@ -0,0 +1,4 @@
+﻿// bench_main.cpp - 性能基准测试入口（Google Benchmark）
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
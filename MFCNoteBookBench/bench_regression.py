@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+# bench_regression.py - 运行基准并与保存的基线比较，任一基准变慢超过阈值时返回非零
+#
+# 用法：
+#   bench_regression.py --benchmark <MFCNoteBookBench> --baseline <基线.json> --output <本次.json> [--filter 正则]
+#   bench_regression.py --baseline <基线.json> --current <本次.json>      只比较两份已有的结果
+#   加 --update 时把本次结果写为新的基线，不做比较
+#
+# 每个基准取多次重复中最小的 CPU 时间比较（没有 min 聚合时依次退回中位数、各次平均值）。
+# 超过阈值的基准会单独再跑一次，两次都超过才算变慢，避免偶发的干扰让构建失败。
+# 基线与机器相关，换机器后应在同一台机器上重新生成。写基线时只保留比较用到的字段，
+# 去掉主机名、可执行文件路径、时间和负载等本机信息。
+import argparse
+import json
+import re
+import subprocess
+import sys
+
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+# 写入基线的字段：机器概况只留 CPU 数和主频，用来提示基线来自不同的机器
+BASELINE_CONTEXT_KEYS = ("num_cpus", "mhz_per_cpu", "library_build_type")
+BASELINE_BENCHMARK_KEYS = ("name", "run_name", "run_type", "aggregate_name", "repetitions", "iterations",
+                           "real_time", "cpu_time", "time_unit", "label", "error_occurred")
+
+
+def load_times(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+
+    aggregates = {"median": {}, "min": {}}
+    runs = {}
+    errors = []
+    for bench in data.get("benchmarks", []):
+        name = bench.get("run_name", bench["name"])
+        if bench.get("error_occurred"):
+            errors.append(name)
+            continue
+        ns = bench["cpu_time"] * TIME_UNITS[bench.get("time_unit", "ns")]
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") in aggregates:
+                aggregates[bench["aggregate_name"]][name] = ns
+        else:
+            runs.setdefault(name, []).append(ns)
+
+    times = {name: sum(values) / len(values) for name, values in runs.items()}
+    times.update(aggregates["median"])
+    times.update(aggregates["min"])
+    return data.get("context", {}), times, sorted(set(errors))
+
+
+def write_baseline(current, baseline):
+    with open(current, encoding="utf-8") as f:
+        data = json.load(f)
+    context = data.get("context", {})
+    out = {
+        "context": {key: context[key] for key in BASELINE_CONTEXT_KEYS if key in context},
+        "benchmarks": [{key: bench[key] for key in BASELINE_BENCHMARK_KEYS if key in bench}
+                       for bench in data.get("benchmarks", [])],
+    }
+    with open(baseline, "w", encoding="utf-8", newline="\n") as f:
+        json.dump(out, f, indent=2)
+        f.write("\n")
+
+
+def format_ns(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.2f %s" % (ns / scale, unit)
+    return "%.0f ns" % ns
+
+
+def find_regressions(base, cur, threshold):
+    return sorted(name for name in cur if name in base and cur[name] / base[name] - 1.0 > threshold)
+
+
+def report(base_context, base, cur_context, cur, errors, threshold):
+    for key in ("num_cpus", "mhz_per_cpu"):
+        if base_context.get(key) != cur_context.get(key):
+            print("warning: baseline was recorded on a different machine (%s: %s vs %s)"
+                  % (key, base_context.get(key), cur_context.get(key)))
+            break
+
+    regressions = find_regressions(base, cur, threshold)
+    width = max([len(name) for name in cur] + [9])
+    print("%-*s %12s %12s %8s" % (width, "benchmark", "baseline", "current", "change"))
+    for name in sorted(cur):
+        if name not in base:
+            print("%-*s %12s %12s %8s" % (width, name, "-", format_ns(cur[name]), "new"))
+            continue
+        change = cur[name] / base[name] - 1.0
+        mark = "  REGRESSION" if name in regressions else ""
+        print("%-*s %12s %12s %+7.1f%%%s" % (width, name, format_ns(base[name]), format_ns(cur[name]), change * 100, mark))
+
+    for name in sorted(set(base) - set(cur)):
+        print("missing from current run: %s" % name)
+    for name in errors:
+        print("error in current run: %s" % name)
+
+    if regressions or errors:
+        print("%d regression(s) over %.0f%%, %d error(s)" % (len(regressions), threshold * 100, len(errors)))
+        return 1
+    print("no regressions over %.0f%%" % (threshold * 100))
+    return 0
+
+
+def run_benchmark(exe, output, bench_filter, repetitions):
+    command = [exe,
+               "--benchmark_out=" + output,
+               "--benchmark_out_format=json",
+               "--benchmark_repetitions=%d" % repetitions,
+               "--benchmark_report_aggregates_only=true"]
+    if bench_filter:
+        command.append("--benchmark_filter=" + bench_filter)
+    print(" ".join(command))
+    sys.stdout.flush()
+    return subprocess.call(command)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare Google Benchmark JSON output against a stored baseline.")
+    parser.add_argument("--benchmark", help="benchmark executable to run")
+    parser.add_argument("--output", help="JSON file written by the benchmark run")
+    parser.add_argument("--current", help="existing JSON result to compare instead of running")
+    parser.add_argument("--baseline", required=True, help="stored baseline JSON")
+    parser.add_argument("--filter", default="", help="--benchmark_filter regular expression")
+    parser.add_argument("--repetitions", type=int, default=5)
+    parser.add_argument("--threshold", type=float, default=0.25, help="allowed slowdown, 0.25 = 25%%")
+    parser.add_argument("--update", action="store_true", help="write the result as the new baseline")
+    args = parser.parse_args()
+
+    current = args.current
+    if args.benchmark:
+        if not args.output:
+            parser.error("--benchmark requires --output")
+        status = run_benchmark(args.benchmark, args.output, args.filter, args.repetitions)
+        if status != 0:
+            return status
+        current = args.output
+    if not current:
+        parser.error("either --benchmark or --current is required")
+
+    if args.update:
+        write_baseline(current, args.baseline)
+        print("baseline updated: %s" % args.baseline)
+        return 0
+
+    base_context, base, _ = load_times(args.baseline)
+    cur_context, cur, errors = load_times(current)
+
+    # 超过阈值的基准再跑一次，取两次中较快的结果
+    suspects = find_regressions(base, cur, args.threshold)
+    if args.benchmark and suspects:
+        confirm_output = args.output + ".confirm.json"
+        confirm_filter = "^(%s)$" % "|".join(re.escape(name) for name in suspects)
+        status = run_benchmark(args.benchmark, confirm_output, confirm_filter, args.repetitions)
+        if status != 0:
+            return status
+        _, confirmed, _ = load_times(confirm_output)
+        for name, ns in confirmed.items():
+            cur[name] = min(cur.get(name, ns), ns)
+
+    return report(base_context, base, cur_context, cur, errors, args.threshold)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
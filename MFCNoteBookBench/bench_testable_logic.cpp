@@ -0,0 +1,258 @@
+﻿// bench_testable_logic.cpp - TestableLogic 热点函数基准（行号、编码转换、摘要/加密、.mynote 读写）
+//
+// 参数为 内容类型 x 输入大小：大小按 32 倍从 1 KB 递增到 1 GB，默认只跑到 BENCH_DEFAULT_MAX_BYTES，
+// 设置环境变量 MFCNOTEBOOK_BENCH_MAX_BYTES（字节数）可跑更大的输入。大小指 UTF-8 语料的字节数，
+// 宽字符函数的输入由同一份语料转换得到（Linux 下 wchar_t 为 4 字节，1 GB 语料需要数 GB 内存）。
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/TestableLogic.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// 未设置 MFCNOTEBOOK_BENCH_MAX_BYTES 时的最大输入，与基线文件使用的范围一致
+#define BENCH_DEFAULT_MAX_BYTES     (int64_t(1) << 20)
+#define BENCH_LIMIT_MAX_BYTES       (int64_t(1) << 30)
+
+using namespace TestableLogic;
+
+namespace
+{
+    enum ContentMix
+    {
+        Mix_Ascii = 0,
+        Mix_Cjk = 1,
+        Mix_Emoji = 2
+    };
+
+    const char* const MIX_NAMES[] = { "ascii", "cjk", "emoji" };
+    const char* const SECRET_KEY = "BIGC_AI_2025_KEY";
+    const char* const STUDENT_ID = "20250313017Z";
+
+    void AppendCodePoint(std::string& s, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            s += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            s += static_cast<char>(0xC0 | (cp >> 6));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            s += static_cast<char>(0xE0 | (cp >> 12));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            s += static_cast<char>(0xF0 | (cp >> 18));
+            s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // 约 bytes 字节的 UTF-8 文本，CRLF 换行，平均每行约 60 个字符
+    std::string MakeContent(ContentMix mix, size_t bytes)
+    {
+        std::mt19937 rng(42);
+        std::string s;
+        s.reserve(bytes + 8);
+        while (s.size() < bytes)
+        {
+            uint32_t r = rng() % 120;
+            if (r < 2)
+            {
+                s += "\r\n";
+                continue;
+            }
+            uint32_t cp;
+            if (mix == Mix_Ascii)
+                cp = (r < 20) ? ' ' : 'a' + rng() % 26;
+            else if (mix == Mix_Cjk)
+                cp = (r < 100) ? 0x4E00 + rng() % 0x5200 : (r < 110 ? 0xFF0C : 'a' + rng() % 26);
+            else
+                cp = (r < 80) ? 0x1F600 + rng() % 0x50 : (r < 100 ? ' ' : 'a' + rng() % 26);
+            AppendCodePoint(s, cp);
+        }
+        return s;
+    }
+
+    // 同一组参数下的各个基准共用语料；只保留最近一份，避免大输入时同时占用多份内存
+    struct Corpus
+    {
+        int mix = -1;
+        size_t bytes = 0;
+        std::string utf8;
+        std::wstring wide;
+    };
+
+    const Corpus& GetCorpus(benchmark::State& state, bool bWide)
+    {
+        static Corpus corpus;
+        int mix = static_cast<int>(state.range(0));
+        size_t bytes = static_cast<size_t>(state.range(1));
+        if (corpus.mix != mix || corpus.bytes != bytes)
+        {
+            corpus = Corpus();
+            corpus.utf8 = MakeContent(static_cast<ContentMix>(mix), bytes);
+            corpus.mix = mix;
+            corpus.bytes = bytes;
+        }
+        if (bWide && corpus.wide.empty())
+            corpus.wide = UTF8ToUnicode(corpus.utf8.data(), static_cast<int>(corpus.utf8.size()));
+        state.SetLabel(MIX_NAMES[mix]);
+        return corpus;
+    }
+
+    int64_t GetMaxBytes()
+    {
+        const char* value = getenv("MFCNOTEBOOK_BENCH_MAX_BYTES");
+        int64_t maxBytes = value ? strtoll(value, nullptr, 10) : 0;
+        if (maxBytes <= 0)
+            return BENCH_DEFAULT_MAX_BYTES;
+        return (maxBytes < BENCH_LIMIT_MAX_BYTES) ? maxBytes : BENCH_LIMIT_MAX_BYTES;
+    }
+
+    // 重复运行时的最小值：受其他进程干扰最小，基线比较用它
+    double MinOf(const std::vector<double>& values)
+    {
+        return *std::min_element(values.begin(), values.end());
+    }
+
+    // 内容类型 x 大小（1 KB、32 KB、1 MB、32 MB、1 GB）
+    void ContentArgs(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "mix", "bytes" });
+        b->ComputeStatistics("min", MinOf);
+        int64_t maxBytes = GetMaxBytes();
+        for (int64_t bytes = 1024; bytes <= maxBytes; bytes *= 32)
+            for (int mix = Mix_Ascii; mix <= Mix_Emoji; mix++)
+                b->Args({ mix, bytes });
+    }
+
+    void SetWideBytesProcessed(benchmark::State& state, const std::wstring& text)
+    {
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(text.size() * sizeof(wchar_t)));
+    }
+
+    void SetBytesProcessed(benchmark::State& state, size_t bytes)
+    {
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+    }
+}
+
+// ============ 行号计算 ============
+
+static void BM_CountLines(benchmark::State& state)
+{
+    const std::wstring& text = GetCorpus(state, true).wide;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(CountLines(text.c_str()));
+    SetWideBytesProcessed(state, text);
+}
+BENCHMARK(BM_CountLines)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+// 定位最后一行，扫描整段文本
+static void BM_GetLineStartPosition(benchmark::State& state)
+{
+    const std::wstring& text = GetCorpus(state, true).wide;
+    int lastLine = CountLines(text.c_str()) - 1;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GetLineStartPosition(text.c_str(), lastLine));
+    SetWideBytesProcessed(state, text);
+}
+BENCHMARK(BM_GetLineStartPosition)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_GetLineFromCharPosition(benchmark::State& state)
+{
+    const std::wstring& text = GetCorpus(state, true).wide;
+    int endPos = static_cast<int>(text.size());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GetLineFromCharPosition(text.c_str(), endPos));
+    SetWideBytesProcessed(state, text);
+}
+BENCHMARK(BM_GetLineFromCharPosition)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+// ============ 编码转换 ============
+
+static void BM_UTF8ToUnicode(benchmark::State& state)
+{
+    const std::string& text = GetCorpus(state, false).utf8;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(UTF8ToUnicode(text.data(), static_cast<int>(text.size())));
+    SetBytesProcessed(state, text.size());
+}
+BENCHMARK(BM_UTF8ToUnicode)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_UnicodeToUTF8(benchmark::State& state)
+{
+    const std::wstring& text = GetCorpus(state, true).wide;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(UnicodeToUTF8(text.data(), static_cast<int>(text.size())));
+    SetWideBytesProcessed(state, text);
+}
+BENCHMARK(BM_UnicodeToUTF8)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+// ============ 摘要与加密 ============
+
+static void BM_ComputeSHA1(benchmark::State& state)
+{
+    const std::string& text = GetCorpus(state, false).utf8;
+    BYTE hash[MYNOTE_HASH_SIZE];
+    for (auto _ : state)
+    {
+        ComputeSHA1(reinterpret_cast<const BYTE*>(text.data()), static_cast<DWORD>(text.size()), hash, MYNOTE_HASH_SIZE);
+        benchmark::DoNotOptimize(hash);
+    }
+    SetBytesProcessed(state, text.size());
+}
+BENCHMARK(BM_ComputeSHA1)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+// 含每次调用的密钥派生；.mynote 只加密 20 字节摘要，这里按输入大小衡量 CBC 吞吐
+static void BM_AESEncrypt(benchmark::State& state)
+{
+    const std::string& text = GetCorpus(state, false).utf8;
+    const BYTE iv[MYNOTE_IV_SIZE] = { 0 };
+    std::vector<BYTE> cipher(text.size() + MYNOTE_IV_SIZE);
+    for (auto _ : state)
+    {
+        DWORD dwCipherLen = static_cast<DWORD>(cipher.size());
+        AESEncrypt(reinterpret_cast<const BYTE*>(text.data()), static_cast<DWORD>(text.size()),
+            reinterpret_cast<const BYTE*>(SECRET_KEY), static_cast<DWORD>(strlen(SECRET_KEY)),
+            iv, cipher.data(), dwCipherLen);
+        benchmark::DoNotOptimize(cipher.data());
+    }
+    SetBytesProcessed(state, text.size());
+}
+BENCHMARK(BM_AESEncrypt)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+// ============ .mynote 读写 ============
+
+static void BM_CreateMyNoteContent(benchmark::State& state)
+{
+    const std::string& text = GetCorpus(state, false).utf8;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(CreateMyNoteContent(text, STUDENT_ID, SECRET_KEY));
+    SetBytesProcessed(state, text.size());
+}
+BENCHMARK(BM_CreateMyNoteContent)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_ParseMyNoteContent(benchmark::State& state)
+{
+    const std::string& text = GetCorpus(state, false).utf8;
+    std::vector<BYTE> file = CreateMyNoteContent(text, STUDENT_ID, SECRET_KEY);
+    if (!ParseMyNoteContent(file.data(), file.size(), SECRET_KEY).integrityValid)
+        state.SkipWithError("integrity check failed");
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ParseMyNoteContent(file.data(), file.size(), SECRET_KEY));
+    SetBytesProcessed(state, file.size());
+}
+BENCHMARK(BM_ParseMyNoteContent)->Apply(ContentArgs)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,100 @@
+﻿// bench_text_buffer.cpp - 片段表缓冲区基准：建立行索引、随机跳转到某行、绘制一屏可见行
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/TextBuffer.h"
+#include "../MFCNoteBook/TextEditorModel.h"
+#include "../MFCNoteBook/SimdSupport.h"
+
+#include <random>
+#include <string>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 约 len 字节的 UTF-8 文本，平均行长 avgLine 字节
+    std::string MakeText(size_t len, size_t avgLine)
+    {
+        std::mt19937 rng(42);
+        std::string text;
+        text.reserve(len + avgLine * 2);
+        while (text.size() < len)
+        {
+            size_t lineLen = rng() % (avgLine * 2);
+            for (size_t i = 0; i < lineLen; i++)
+            {
+                if (rng() % 4 == 0)
+                    text += "\xE4\xB8\xAD";
+                else
+                    text += static_cast<char>('a' + rng() % 26);
+            }
+            text += "\r\n";
+        }
+        return text;
+    }
+
+    void SetLevelOrSkip(benchmark::State& state, int level)
+    {
+        if (level > static_cast<int>(GetDetectedSimdLevel()))
+            state.SkipWithError("SIMD level not supported on this CPU");
+        SetSimdLevelOverride(static_cast<SimdLevel>(level));
+        state.SetLabel(GetSimdLevelName(GetSimdLevel()));
+    }
+}
+
+// 打开文件时建立稀疏行索引（一次全文扫描）
+static void BM_TextBuffer_AttachOriginal(benchmark::State& state)
+{
+    SetLevelOrSkip(state, static_cast<int>(state.range(0)));
+    std::string text = MakeText(static_cast<size_t>(state.range(1)), 60);
+    for (auto _ : state)
+    {
+        TextBuffer buffer;
+        buffer.AttachOriginal(text.data(), text.size());
+        benchmark::DoNotOptimize(buffer.GetLineCount());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(text.size()));
+    ClearSimdLevelOverride();
+}
+BENCHMARK(BM_TextBuffer_AttachOriginal)
+    ->ArgsProduct({ { 0, 1, 3 }, { int64_t(64) << 20 } })
+    ->Unit(benchmark::kMillisecond);
+
+// 拖动滚动条：随机跳到某一行（检查点 + 至多一个步长内的扫描）
+static void BM_TextBuffer_RandomLineStart(benchmark::State& state)
+{
+    std::string text = MakeText(static_cast<size_t>(state.range(0)), 60);
+    TextBuffer buffer;
+    buffer.AttachOriginal(text.data(), text.size());
+    // 在中间插入一些编辑，覆盖多片段的情况
+    for (size_t i = 1; i <= 16; i++)
+        buffer.Insert(text.size() * i / 17, "edit\n", 5);
+
+    std::mt19937 rng(7);
+    for (auto _ : state)
+    {
+        size_t line = rng() % buffer.GetLineCount();
+        benchmark::DoNotOptimize(buffer.GetLineStart(line));
+    }
+}
+BENCHMARK(BM_TextBuffer_RandomLineStart)->Arg(int64_t(64) << 20);
+
+// 绘制一屏：取 50 行文本并解码为 UTF-16
+static void BM_TextEditor_VisibleLines(benchmark::State& state)
+{
+    std::string text = MakeText(static_cast<size_t>(state.range(0)), 60);
+    TextBuffer buffer;
+    buffer.AttachOriginal(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+
+    std::mt19937 rng(7);
+    std::vector<size_t> offsets;
+    for (auto _ : state)
+    {
+        size_t first = rng() % (buffer.GetLineCount() - 50);
+        for (size_t line = first; line < first + 50; line++)
+            benchmark::DoNotOptimize(model.GetLineText(line, &offsets));
+    }
+}
+BENCHMARK(BM_TextEditor_VisibleLines)->Arg(int64_t(64) << 20);
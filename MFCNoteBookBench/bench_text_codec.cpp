@@ -0,0 +1,224 @@
+﻿// bench_text_codec.cpp - UTF-8 校验/转码吞吐基准
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/TextCodec.h"
+#include "../MFCNoteBook/SimdSupport.h"
+
+#include <random>
+#include <string>
+
+using namespace TestableLogic;
+
+namespace
+{
+    enum CorpusKind
+    {
+        Corpus_Ascii = 0,
+        Corpus_Cjk = 1,
+        Corpus_Mixed = 2
+    };
+
+    void AppendCodePoint(std::string& s, uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            s += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            s += static_cast<char>(0xC0 | (cp >> 6));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            s += static_cast<char>(0xE0 | (cp >> 12));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            s += static_cast<char>(0xF0 | (cp >> 18));
+            s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // 生成约 bytes 字节的语料：纯英文、以中文为主（夹杂标点换行）、中英文和 emoji 混合
+    std::string MakeCorpus(CorpusKind kind, size_t bytes)
+    {
+        std::mt19937 rng(1234);
+        std::string s;
+        s.reserve(bytes + 8);
+        while (s.size() < bytes)
+        {
+            uint32_t r = rng() % 100;
+            uint32_t cp;
+            if (kind == Corpus_Ascii)
+                cp = (r < 15) ? ' ' : (r < 17 ? '\n' : 'a' + rng() % 26);
+            else if (kind == Corpus_Cjk)
+                cp = (r < 90) ? 0x4E00 + rng() % 0x5200 : (r < 97 ? 0x3002 : '\n');
+            else
+                cp = (r < 60) ? 'a' + rng() % 26 : (r < 90 ? 0x4E00 + rng() % 0x5200 : (r < 95 ? 0x1F600 + rng() % 0x50 : ' '));
+            AppendCodePoint(s, cp);
+        }
+        return s;
+    }
+
+    void SetLevelOrSkip(benchmark::State& state, int level)
+    {
+        if (level > static_cast<int>(GetDetectedSimdLevel()))
+            state.SkipWithError("SIMD level not supported on this CPU");
+        SetSimdLevelOverride(static_cast<SimdLevel>(level));
+        state.SetLabel(GetSimdLevelName(GetSimdLevel()));
+    }
+
+    void CodecArgs(benchmark::internal::Benchmark* b)
+    {
+        for (int kind = Corpus_Ascii; kind <= Corpus_Mixed; kind++)
+            for (int level = 0; level <= static_cast<int>(SimdLevel::AVX2); level++)
+                b->Args({ kind, level });
+    }
+}
+
+static void BM_Utf8Validate(benchmark::State& state)
+{
+    std::string corpus = MakeCorpus(static_cast<CorpusKind>(state.range(0)), 1 << 20);
+    SetLevelOrSkip(state, static_cast<int>(state.range(1)));
+    for (auto _ : state)
+    {
+        Utf8ValidationResult result = ValidateUtf8(corpus.data(), corpus.size());
+        benchmark::DoNotOptimize(result);
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size()));
+}
+BENCHMARK(BM_Utf8Validate)->Apply(CodecArgs);
+
+static void BM_Utf8ToUtf16(benchmark::State& state)
+{
+    std::string corpus = MakeCorpus(static_cast<CorpusKind>(state.range(0)), 1 << 20);
+    std::u16string out(Utf8ToUtf16MaxLength(corpus.size()), u'\0');
+    SetLevelOrSkip(state, static_cast<int>(state.range(1)));
+    for (auto _ : state)
+    {
+        Utf8DecodeResult result = Utf8ToUtf16(corpus.data(), corpus.size(), &out[0]);
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size()));
+}
+BENCHMARK(BM_Utf8ToUtf16)->Apply(CodecArgs);
+
+// ============ UTF-16 → UTF-8 ============
+
+namespace
+{
+    // 大文档参数：语料种类 x SIMD 级别 x 大小（1 MB / 256 MB 的 UTF-8 源数据）
+    void EncodeArgs(benchmark::internal::Benchmark* b)
+    {
+        for (int64_t size : { int64_t(1) << 20, int64_t(256) << 20 })
+            for (int kind = Corpus_Ascii; kind <= Corpus_Mixed; kind++)
+                for (int level = 0; level <= static_cast<int>(SimdLevel::AVX2); level++)
+                    b->Args({ kind, level, size });
+    }
+
+    std::u16string MakeUtf16Corpus(CorpusKind kind, size_t bytes)
+    {
+        std::string utf8 = MakeCorpus(kind, bytes);
+        return Utf8ToUtf16String(utf8.data(), utf8.size());
+    }
+}
+
+// 第一趟：精确长度
+static void BM_Utf16ToUtf8Length(benchmark::State& state)
+{
+    std::u16string corpus = MakeUtf16Corpus(static_cast<CorpusKind>(state.range(0)), static_cast<size_t>(state.range(2)));
+    SetLevelOrSkip(state, static_cast<int>(state.range(1)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Utf16ToUtf8Length(corpus.data(), corpus.size()));
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_Utf16ToUtf8Length)->Apply(EncodeArgs)->Unit(benchmark::kMicrosecond);
+
+// 精确长度 + 一次性编码（对应 SaveAsMyNote）
+static void BM_Utf16ToUtf8_Exact(benchmark::State& state)
+{
+    std::u16string corpus = MakeUtf16Corpus(static_cast<CorpusKind>(state.range(0)), static_cast<size_t>(state.range(2)));
+    SetLevelOrSkip(state, static_cast<int>(state.range(1)));
+    for (auto _ : state)
+    {
+        std::string out = Utf16ToUtf8String(corpus.data(), corpus.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_Utf16ToUtf8_Exact)->Apply(EncodeArgs)->Unit(benchmark::kMicrosecond);
+
+// 64 KB 固定缓冲区分块编码（对应 SaveAsPlainText 边编码边写）
+static void BM_Utf16ToUtf8_Chunked(benchmark::State& state)
+{
+    std::u16string corpus = MakeUtf16Corpus(static_cast<CorpusKind>(state.range(0)), static_cast<size_t>(state.range(2)));
+    std::vector<char> buffer(64 * 1024);
+    SetLevelOrSkip(state, static_cast<int>(state.range(1)));
+    for (auto _ : state)
+    {
+        size_t pos = 0;
+        while (pos < corpus.size())
+        {
+            Utf16EncodeResult result = Utf16ToUtf8(corpus.data() + pos, corpus.size() - pos, buffer.data(), buffer.size());
+            benchmark::DoNotOptimize(buffer.data());
+            pos += result.consumed;
+        }
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_Utf16ToUtf8_Chunked)->Apply(EncodeArgs)->Unit(benchmark::kMicrosecond);
+
+// ============ UTF-16 字节流 ============
+
+// 大端文件载入：原地字节交换（对应 LoadPlainText 的 UTF-16BE 路径）
+static void BM_Utf16BytesToUnits_BE(benchmark::State& state)
+{
+    std::u16string corpus = MakeUtf16Corpus(Corpus_Cjk, static_cast<size_t>(state.range(1)));
+    SetLevelOrSkip(state, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        size_t units = Utf16BytesToUnits(corpus.data(), corpus.size() * sizeof(char16_t), true, &corpus[0]);
+        benchmark::DoNotOptimize(units);
+        benchmark::ClobberMemory();
+    }
+    ClearSimdLevelOverride();
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_Utf16BytesToUnits_BE)
+    ->ArgsProduct({ { 0, 1, 2, 3 }, { int64_t(1) << 20, int64_t(256) << 20 } })
+    ->Unit(benchmark::kMicrosecond);
+
+#ifdef _WIN32
+#include <windows.h>
+
+// 对照：原实现（WideCharToMultiByte 两次调用 + 中间缓冲区）
+static void BM_Utf16ToUtf8_WideCharToMultiByte(benchmark::State& state)
+{
+    std::u16string corpus = MakeUtf16Corpus(static_cast<CorpusKind>(state.range(0)), static_cast<size_t>(state.range(2)));
+    const wchar_t* src = reinterpret_cast<const wchar_t*>(corpus.c_str());
+    for (auto _ : state)
+    {
+        int nLen = WideCharToMultiByte(CP_UTF8, 0, src, -1, NULL, 0, NULL, NULL);
+        std::vector<char> buffer(nLen);
+        WideCharToMultiByte(CP_UTF8, 0, src, -1, buffer.data(), nLen, NULL, NULL);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(corpus.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_Utf16ToUtf8_WideCharToMultiByte)
+    ->Args({ Corpus_Ascii, 0, int64_t(256) << 20 })
+    ->Args({ Corpus_Cjk, 0, int64_t(256) << 20 })
+    ->Args({ Corpus_Mixed, 0, int64_t(256) << 20 })
+    ->Unit(benchmark::kMicrosecond);
+#endif
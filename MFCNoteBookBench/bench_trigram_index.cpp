@@ -0,0 +1,138 @@
+﻿// bench_trigram_index.cpp - 三元组索引构建/查询基准
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/TrigramIndex.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 生成 count 篇笔记，每篇约 noteChars 个字符，词表混合英文和中文
+    std::vector<std::wstring> MakeCorpus(size_t count, size_t noteChars)
+    {
+        static const wchar_t* words[] = {
+            L"meeting", L"project", L"deadline", L"budget", L"review", L"design",
+            L"release", L"bug", L"report", L"customer", L"笔记", L"会议", L"计划",
+            L"预算", L"发布", L"测试", L"需求", L"总结"
+        };
+        const size_t wordCount = sizeof(words) / sizeof(words[0]);
+
+        std::mt19937 rng(42);
+        std::vector<std::wstring> corpus(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::wstring& note = corpus[i];
+            note.reserve(noteChars + 16);
+            while (note.size() < noteChars)
+            {
+                note += words[rng() % wordCount];
+                note += (rng() % 12 == 0) ? L"\r\n" : L" ";
+            }
+            // 每篇带一个唯一标记，便于测试高选择性查询
+            note += L" tag" + std::to_wstring(i);
+        }
+        return corpus;
+    }
+
+    std::string BenchIndexPath()
+    {
+        std::string path = "bench_trigram.idx";
+        FileUtil::Remove(path);
+        FileUtil::Remove(path + TRIGRAM_DELTA_SUFFIX);
+        return path;
+    }
+}
+
+// 全量构建：逐篇加入后合并为可映射的基础索引
+static void BM_TrigramIndex_Build(benchmark::State& state)
+{
+    auto corpus = MakeCorpus(static_cast<size_t>(state.range(0)), 2000);
+    size_t totalChars = 0;
+    for (const auto& note : corpus)
+        totalChars += note.size();
+
+    for (auto _ : state)
+    {
+        TrigramIndex index;
+        for (size_t i = 0; i < corpus.size(); i++)
+            index.UpdateFile("note" + std::to_string(i) + ".txt", corpus[i].data(), corpus[i].size(), 1, false);
+        benchmark::DoNotOptimize(index.FileCount());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(totalChars * sizeof(wchar_t)));
+}
+BENCHMARK(BM_TrigramIndex_Build)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// 增量更新：保存单篇文档（追加一条增量日志）
+static void BM_TrigramIndex_IncrementalSave(benchmark::State& state)
+{
+    auto corpus = MakeCorpus(1000, 2000);
+    std::string path = BenchIndexPath();
+    {
+        TrigramIndex index;
+        index.Load(path);
+        for (size_t i = 0; i < corpus.size(); i++)
+            index.UpdateFile("note" + std::to_string(i) + ".txt", corpus[i].data(), corpus[i].size(), 1, false);
+        index.Compact();
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        TrigramIndex index;
+        index.Load(path);
+        const std::wstring& note = corpus[i % corpus.size()];
+        index.UpdateFile("note" + std::to_string(i % corpus.size()) + ".txt", note.data(), note.size(), 2, false);
+        if (index.NeedsCompaction())
+            index.Compact();
+        i++;
+    }
+}
+BENCHMARK(BM_TrigramIndex_IncrementalSave)->Unit(benchmark::kMicrosecond);
+
+// 查询：在映射的基础索引上缩小候选集
+static void BM_TrigramIndex_Query(benchmark::State& state)
+{
+    auto corpus = MakeCorpus(static_cast<size_t>(state.range(0)), 2000);
+    std::string path = BenchIndexPath();
+    {
+        TrigramIndex index;
+        index.Load(path);
+        for (size_t i = 0; i < corpus.size(); i++)
+            index.UpdateFile("note" + std::to_string(i) + ".txt", corpus[i].data(), corpus[i].size(), 1, false);
+        index.Compact();
+    }
+
+    TrigramIndex index;
+    index.Load(path);
+    const std::wstring needle = L"tag" + std::to_wstring(corpus.size() / 2);
+    size_t candidates = 0;
+    for (auto _ : state)
+    {
+        auto result = index.Query(needle.data(), needle.size());
+        candidates = result.size();
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["candidates"] = static_cast<double>(candidates);
+    state.counters["files"] = static_cast<double>(corpus.size());
+}
+BENCHMARK(BM_TrigramIndex_Query)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// 对照：不使用索引，逐篇做完整匹配
+static void BM_TrigramIndex_FullScanBaseline(benchmark::State& state)
+{
+    auto corpus = MakeCorpus(static_cast<size_t>(state.range(0)), 2000);
+    const std::wstring needle = L"tag" + std::to_wstring(corpus.size() / 2);
+    for (auto _ : state)
+    {
+        size_t matches = 0;
+        for (const auto& note : corpus)
+            matches += note.find(needle) != std::wstring::npos;
+        benchmark::DoNotOptimize(matches);
+    }
+}
+BENCHMARK(BM_TrigramIndex_FullScanBaseline)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
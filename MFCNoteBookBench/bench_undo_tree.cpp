@@ -0,0 +1,87 @@
+﻿// bench_undo_tree.cpp - 分支撤销树基准：一万步编辑（其中夹有全部替换）后逐步撤销到最初
+#include <benchmark/benchmark.h>
+
+#include "../MFCNoteBook/UndoTree.h"
+
+#include <random>
+#include <string>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 一段重复较多、像正文的文本
+    std::u16string MakeParagraph(size_t chars)
+    {
+        std::u16string text;
+        while (text.size() < chars)
+            text += u"line 0 of some ordinary note text\r\n";
+        text.resize(chars);
+        return text;
+    }
+
+    // 逐字输入，每 100 步做一次全部替换（整篇文本中每行的 "line N" 换成新的数字），返回编辑后的文本
+    std::u16string RecordEdits(UndoTree& tree, std::u16string text, int steps)
+    {
+        const std::u16string typed = u"the quick brown fox jumps over the lazy dog. ";
+        std::mt19937 rng(7);
+        size_t caret = 0;
+        for (int i = 0; i < steps; i++)
+        {
+            std::u16string after = text;
+            if (i % 100 == 0)
+            {
+                for (size_t pos = after.find(u"line "); pos != std::u16string::npos; pos = after.find(u"line ", pos + 6))
+                    after[pos + 5] = static_cast<char16_t>(u'0' + i / 100 % 10);
+                caret = rng() % after.size();
+            }
+            else
+            {
+                after.insert(caret, 1, typed[i % typed.size()]);
+                caret++;
+            }
+            tree.Record(MakeTextDelta(text.data(), text.size(), after.data(), after.size(), 0));
+            text.swap(after);
+            if (tree.HasColdNodes())
+                tree.CompressColdNodes(16);
+        }
+        while (tree.CompressColdNodes(64) > 0)
+        {
+        }
+        return text;
+    }
+}
+
+// 撤销全部步骤：大段替换的记录压缩存放，走到时才解压；每轮结束后重做回去并重新压缩（不计时）
+static void BM_UndoTree_UndoAll(benchmark::State& state)
+{
+    const int steps = static_cast<int>(state.range(0));
+    UndoTree tree;
+    std::u16string text = RecordEdits(tree, MakeParagraph(64 * 1024), steps);
+    const UndoTreeMemory& memory = tree.GetMemory();
+    state.counters["logical_bytes"] = static_cast<double>(tree.GetTotalBytes());
+    state.counters["resident_bytes"] = static_cast<double>(memory.hotBytes + memory.coldBytes);
+
+    UndoStep step;
+    for (auto _ : state)
+    {
+        while (tree.Undo(step))
+        {
+            if (!RevertTextDelta(text, *step.pDelta))
+            {
+                state.SkipWithError("undo step did not apply");
+                break;
+            }
+        }
+
+        state.PauseTiming();
+        while (tree.Redo(step))
+            ApplyTextDelta(text, *step.pDelta);
+        while (tree.CompressColdNodes(64) > 0)
+        {
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * steps);
+}
+BENCHMARK(BM_UndoTree_UndoAll)->Arg(10000)->Unit(benchmark::kMillisecond);
@@ -1,6 +1,8 @@
 // pch.h - ĿԤͷ
 #pragma once
 
+// Windows  MFCɲҪ CConfigManagerƽ̨CMake ֻ߼Ĳ
+#ifdef _WIN32
 // ============ ǿƶ _AFXDLLʹ MFC  DLL============
 #ifndef _AFXDLL
 #define _AFXDLL
@@ -11,6 +13,7 @@
 #include <afxext.h>         // MFC չ
 #include <atlconv.h>        // CT2A, CA2T ת
 #include <atlstr.h>         // CString
+#endif
 
 // ============ Google Test ============
 #include "gtest/gtest.h"
@@ -22,14 +25,18 @@
 
 // ============ Ŀͷļ ============
 #include "../MFCNoteBook/TestableLogic.h"
+#ifdef _WIN32
 #include "../MFCNoteBook/ConfigManager.h"
+#endif
 
 // ============ Ը ============
 inline void InitTestConfig()
 {
+#ifdef _WIN32
     CConfigManager& config = CConfigManager::GetInstance();
     config.SetStudentID(_T("20250313017Z"));
     config.SetSecretKey(_T("BIGC_AI_2025_KEY"));
+#endif
 }
 
 // ȫֲԻ
@@ -0,0 +1,83 @@
+﻿// test_config_parser.cpp - config.ini 解析测试
+#include "pch.h"
+#include "../MFCNoteBook/ConfigParser.h"
+
+using namespace TestableLogic;
+
+namespace
+{
+    std::string Find(const std::string& text, const char* section, const char* key)
+    {
+        std::string value;
+        if (!FindIniValue(text, section, key, value))
+            return "<missing>";
+        return value;
+    }
+}
+
+// ============ 查找 ============
+
+TEST(ConfigParserTest, FindsValuesInSections)
+{
+    std::string text = "[User]\r\nStudentID=20250313017Z\r\n\r\n[Security]\r\nSecretKey=BIGC_AI_2025_KEY\r\n";
+    EXPECT_EQ("20250313017Z", Find(text, "User", "StudentID"));
+    EXPECT_EQ("BIGC_AI_2025_KEY", Find(text, "Security", "SecretKey"));
+    EXPECT_EQ("<missing>", Find(text, "User", "SecretKey"));
+    EXPECT_EQ("<missing>", Find(text, "Other", "StudentID"));
+}
+
+TEST(ConfigParserTest, MatchesProfileStringRules)
+{
+    std::string text =
+        "; comment\n"
+        "StudentID=outside\n"
+        "  [ user ]  \n"
+        "not a pair\n"
+        "; StudentID=commented\n"
+        "  studentid  =  '  quoted  '  \n"
+        "StudentID=second\n"
+        "Empty=\n"
+        "[Security]\n"
+        "SecretKey=\"k=v\"";
+    EXPECT_EQ("  quoted  ", Find(text, "User", "StudentID"));
+    EXPECT_EQ("", Find(text, "USER", "empty"));
+    EXPECT_EQ("k=v", Find(text, "security", "SECRETKEY"));
+}
+
+// ============ 编码 ============
+
+TEST(ConfigParserTest, DecodesBomsAndUtf8)
+{
+    std::string utf8;
+    const uint8_t withBom[] = { 0xEF, 0xBB, 0xBF, 'a', '=', '1' };
+    ASSERT_TRUE(DecodeIniText(withBom, sizeof(withBom), utf8));
+    EXPECT_EQ("a=1", utf8);
+
+    const uint8_t utf16le[] = { 0xFF, 0xFE, 'a', 0, '=', 0, 0x2D, 0x4E };
+    ASSERT_TRUE(DecodeIniText(utf16le, sizeof(utf16le), utf8));
+    EXPECT_EQ("a=\xE4\xB8\xAD", utf8);
+
+    const uint8_t utf16be[] = { 0xFE, 0xFF, 0, 'a', 0, '=', 0x4E, 0x2D };
+    ASSERT_TRUE(DecodeIniText(utf16be, sizeof(utf16be), utf8));
+    EXPECT_EQ("a=\xE4\xB8\xAD", utf8);
+
+    // 无 BOM 的 GBK 交给调用方按本地代码页解码
+    const uint8_t gbk[] = { 'a', '=', 0xD6, 0xD0 };
+    EXPECT_FALSE(DecodeIniText(gbk, sizeof(gbk), utf8));
+    EXPECT_TRUE(DecodeIniText(nullptr, 0, utf8));
+    EXPECT_TRUE(utf8.empty());
+}
+
+// ============ 学号 ============
+
+TEST(ConfigParserTest, ValidatesStudentId)
+{
+    EXPECT_EQ(StudentIdError::None, ValidateStudentId("20250313017Z"));
+    EXPECT_EQ(StudentIdError::None, ValidateStudentId("abcde"));
+    EXPECT_EQ(StudentIdError::TooShort, ValidateStudentId("abcd"));
+    EXPECT_EQ(StudentIdError::TooShort, ValidateStudentId(""));
+    EXPECT_EQ(StudentIdError::TooLong, ValidateStudentId(std::string(21, '1')));
+    EXPECT_EQ(StudentIdError::InvalidChar, ValidateStudentId("2025-0313"));
+    // 长度按字符计：5 个汉字不算过短，但不是字母数字
+    EXPECT_EQ(StudentIdError::InvalidChar, ValidateStudentId("\xE4\xB8\xAD\xE4\xB8\xAD\xE4\xB8\xAD\xE4\xB8\xAD\xE4\xB8\xAD"));
+}
@@ -0,0 +1,140 @@
+﻿// test_crypto_util.cpp - 跨平台加密函数的已知答案测试
+#include "pch.h"
+#include "../MFCNoteBook/CryptoUtil.h"
+
+namespace
+{
+    std::string ToHex(const uint8_t* data, size_t len)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (size_t i = 0; i < len; i++)
+        {
+            hex.push_back(digits[data[i] >> 4]);
+            hex.push_back(digits[data[i] & 0x0F]);
+        }
+        return hex;
+    }
+
+    std::string Sha1Hex(const std::string& text)
+    {
+        uint8_t hash[CRYPTO_SHA1_SIZE];
+        EXPECT_TRUE(CryptoUtil::Sha1(text.data(), text.size(), hash));
+        return ToHex(hash, sizeof(hash));
+    }
+
+    std::string Sha256Hex(const std::string& text)
+    {
+        uint8_t hash[CRYPTO_SHA256_SIZE];
+        EXPECT_TRUE(CryptoUtil::Sha256(text.data(), text.size(), hash));
+        return ToHex(hash, sizeof(hash));
+    }
+
+    const char* const SECRET = "BIGC_AI_2025_KEY";
+    const uint8_t IV[CRYPTO_AES_BLOCK_SIZE] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+}
+
+// ============ 摘要 ============
+
+TEST(CryptoUtilTest, Sha1KnownAnswers)
+{
+    EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", Sha1Hex(""));
+    EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", Sha1Hex("abc"));
+    // 56 字节：填充需要额外一块
+    EXPECT_EQ("84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+        Sha1Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+    EXPECT_EQ("34aa973cd4c4daa4f61eeb2bdbad27316534016f", Sha1Hex(std::string(1000000, 'a')));
+}
+
+TEST(CryptoUtilTest, Sha256KnownAnswers)
+{
+    EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", Sha256Hex(""));
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", Sha256Hex("abc"));
+    EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+        Sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+}
+
+TEST(CryptoUtilTest, HmacSha256KnownAnswers)
+{
+    // RFC 4231 测试用例 1、2、6
+    uint8_t mac[CRYPTO_SHA256_SIZE];
+    std::string key1(20, '\x0b');
+    ASSERT_TRUE(CryptoUtil::HmacSha256(key1.data(), key1.size(), "Hi There", 8, mac));
+    EXPECT_EQ("b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7", ToHex(mac, sizeof(mac)));
+
+    std::string data2 = "what do ya want for nothing?";
+    ASSERT_TRUE(CryptoUtil::HmacSha256("Jefe", 4, data2.data(), data2.size(), mac));
+    EXPECT_EQ("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", ToHex(mac, sizeof(mac)));
+
+    // 长于块大小的密钥先做摘要
+    std::string key6(131, '\xaa');
+    std::string data6 = "Test Using Larger Than Block-Size Key - Hash Key First";
+    ASSERT_TRUE(CryptoUtil::HmacSha256(key6.data(), key6.size(), data6.data(), data6.size(), mac));
+    EXPECT_EQ("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54", ToHex(mac, sizeof(mac)));
+}
+
+TEST(CryptoUtilTest, ConstantTimeEqual)
+{
+    EXPECT_TRUE(CryptoUtil::ConstantTimeEqual("abcd", "abcd", 4));
+    EXPECT_FALSE(CryptoUtil::ConstantTimeEqual("abcd", "abce", 4));
+    EXPECT_TRUE(CryptoUtil::ConstantTimeEqual("a", "b", 0));
+}
+
+// ============ AES ============
+
+TEST(CryptoUtilTest, AesMatchesCryptDeriveKeyOutput)
+{
+    // 密钥 = SHA-256(口令) 的前 16 字节，AES-128-CBC + PKCS#7，与 CryptoAPI 生成的 .mynote 文件一致
+    uint8_t cipher[64];
+    size_t cipherLen = 0;
+    ASSERT_TRUE(CryptoUtil::AesEncrypt(SECRET, strlen(SECRET), IV, "abc", 3, cipher, cipherLen));
+    EXPECT_EQ("2bc2f7cf34278de31523b1c1ec3ebf05", ToHex(cipher, cipherLen));
+
+    ASSERT_TRUE(CryptoUtil::AesEncrypt(SECRET, strlen(SECRET), IV, "", 0, cipher, cipherLen));
+    EXPECT_EQ("d58c9afdae75d8c24ffaf6201e9b934c", ToHex(cipher, cipherLen));
+
+    // 整块的明文补一整块填充
+    ASSERT_TRUE(CryptoUtil::AesEncrypt(SECRET, strlen(SECRET), IV, "0123456789abcdef", 16, cipher, cipherLen));
+    EXPECT_EQ("1521ddadf5373ebc196683e2cd9b013e17808e536daaaa873f6c9c75d7b7d2d4", ToHex(cipher, cipherLen));
+}
+
+TEST(CryptoUtilTest, AesRoundTripInPlace)
+{
+    std::string text = "Hello, 世界! multi-block plaintext for CBC chaining.";
+    std::vector<uint8_t> buffer(text.begin(), text.end());
+    buffer.resize(text.size() + CRYPTO_AES_BLOCK_SIZE);
+
+    size_t cipherLen = 0;
+    ASSERT_TRUE(CryptoUtil::AesEncrypt(SECRET, strlen(SECRET), IV, buffer.data(), text.size(), buffer.data(), cipherLen));
+    EXPECT_EQ(0u, cipherLen % CRYPTO_AES_BLOCK_SIZE);
+    EXPECT_GT(cipherLen, text.size());
+
+    size_t plainLen = 0;
+    ASSERT_TRUE(CryptoUtil::AesDecrypt(SECRET, strlen(SECRET), IV, buffer.data(), cipherLen, buffer.data(), plainLen));
+    EXPECT_EQ(text, std::string(buffer.begin(), buffer.begin() + plainLen));
+}
+
+TEST(CryptoUtilTest, AesDecryptRejectsBadInput)
+{
+    uint8_t cipher[32];
+    size_t cipherLen = 0;
+    ASSERT_TRUE(CryptoUtil::AesEncrypt(SECRET, strlen(SECRET), IV, "abc", 3, cipher, cipherLen));
+
+    uint8_t plain[32];
+    size_t plainLen = 0;
+    EXPECT_FALSE(CryptoUtil::AesDecrypt(SECRET, strlen(SECRET), IV, cipher, 0, plain, plainLen));
+    EXPECT_FALSE(CryptoUtil::AesDecrypt(SECRET, strlen(SECRET), IV, cipher, cipherLen - 1, plain, plainLen));
+    // 口令不对时填充几乎必然不合法
+    EXPECT_FALSE(CryptoUtil::AesDecrypt("WRONG_KEY", 9, IV, cipher, cipherLen, plain, plainLen));
+}
+
+// ============ 随机数 ============
+
+TEST(CryptoUtilTest, RandomFillsBuffer)
+{
+    uint8_t a[32] = { 0 };
+    uint8_t b[32] = { 0 };
+    ASSERT_TRUE(CryptoUtil::Random(a, sizeof(a)));
+    ASSERT_TRUE(CryptoUtil::Random(b, sizeof(b)));
+    EXPECT_NE(0, memcmp(a, b, sizeof(a)));
+}
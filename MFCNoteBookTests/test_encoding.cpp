@@ -1,9 +1,9 @@
-// test_encoding.cpp - ת
+﻿// test_encoding.cpp - 编码转换测试
 #include "pch.h"
 
 using namespace TestableLogic;
 
-// ============ UTF-8 ת Unicode  ============
+// ============ UTF-8 转 Unicode 测试 ============
 
 TEST(EncodingTest, UTF8ToUnicode_Empty)
 {
@@ -18,23 +18,23 @@ TEST(EncodingTest, UTF8ToUnicode_ASCII)
 
 TEST(EncodingTest, UTF8ToUnicode_Chinese)
 {
-    // UTF-8  ""
+    // UTF-8 编码的 "中文"
     const char* utf8 = "\xE4\xB8\xAD\xE6\x96\x87";
     std::wstring result = UTF8ToUnicode(utf8);
     EXPECT_EQ(result.length(), 2u);
-    EXPECT_EQ(result[0], L'');
-    EXPECT_EQ(result[1], L'');
+    EXPECT_EQ(result[0], L'中');
+    EXPECT_EQ(result[1], L'文');
 }
 
 TEST(EncodingTest, UTF8ToUnicode_Mixed)
 {
-    // "Hello"
+    // "Hello中文"
     const char* utf8 = "Hello\xE4\xB8\xAD\xE6\x96\x87";
     std::wstring result = UTF8ToUnicode(utf8);
-    EXPECT_EQ(result, L"Hello");
+    EXPECT_EQ(result, L"Hello中文");
 }
 
-// ============ Unicode ת UTF-8  ============
+// ============ Unicode 转 UTF-8 测试 ============
 
 TEST(EncodingTest, UnicodeToUTF8_Empty)
 {
@@ -49,12 +49,12 @@ TEST(EncodingTest, UnicodeToUTF8_ASCII)
 
 TEST(EncodingTest, UnicodeToUTF8_Chinese)
 {
-    std::string result = UnicodeToUTF8(L"");
-    // ÿַ UTF-8 ռ 3 ֽ
+    std::string result = UnicodeToUTF8(L"中文");
+    // 每个中文字符在 UTF-8 中占 3 字节
     EXPECT_EQ(result.length(), 6u);
 }
 
-// ============ ת ============
+// ============ 往返转换测试 ============
 
 TEST(EncodingTest, RoundTrip_ASCII)
 {
@@ -66,7 +66,7 @@ TEST(EncodingTest, RoundTrip_ASCII)
 
 TEST(EncodingTest, RoundTrip_Chinese)
 {
-    const wchar_t* original = L"Ĳ";
+    const wchar_t* original = L"中文测试内容";
     std::string utf8 = UnicodeToUTF8(original);
     std::wstring back = UTF8ToUnicode(utf8.c_str());
     EXPECT_EQ(back, original);
@@ -74,13 +74,13 @@ TEST(EncodingTest, RoundTrip_Chinese)
 
 TEST(EncodingTest, RoundTrip_Mixed)
 {
-    const wchar_t* original = L"Hello123ABC";
+    const wchar_t* original = L"Hello世界123测试ABC";
     std::string utf8 = UnicodeToUTF8(original);
     std::wstring back = UTF8ToUnicode(utf8.c_str());
     EXPECT_EQ(back, original);
 }
 
-// ============ BOM  ============
+// ============ BOM 检测测试 ============
 
 TEST(EncodingTest, DetectBOM_None)
 {
@@ -0,0 +1,164 @@
+﻿// test_encoding_detector.cpp - 编码检测测试（含带标注的样本语料）
+#include "pch.h"
+#include "../MFCNoteBook/EncodingDetector.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+#include <string>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 语料位于本文件旁的 EncodingCorpus/<编码>/ 目录下，目录名即标注
+    std::string CorpusPath(const char* relative)
+    {
+        std::string path = __FILE__;
+        size_t pos = path.find_last_of("/\\");
+        path = (pos == std::string::npos) ? std::string() : path.substr(0, pos + 1);
+        return path + "EncodingCorpus/" + relative;
+    }
+
+    struct LabeledSample
+    {
+        const char* path;
+        TextEncoding expected;
+    };
+
+    const LabeledSample g_corpus[] = {
+        { "ascii/english_notes.txt", TextEncoding::Ascii },
+        { "ascii/source_code.txt", TextEncoding::Ascii },
+        { "utf8/chinese_notes.txt", TextEncoding::Utf8 },
+        { "utf8/chinese_code.txt", TextEncoding::Utf8 },
+        { "utf8/short_greeting.txt", TextEncoding::Utf8 },
+        { "utf8/emoji_chat.txt", TextEncoding::Utf8 },
+        { "utf8/japanese.txt", TextEncoding::Utf8 },
+        { "utf8/french.txt", TextEncoding::Utf8 },
+        { "utf8/mixed_zh_en.txt", TextEncoding::Utf8 },
+        { "gb18030/chinese_notes.txt", TextEncoding::Gb18030 },
+        { "gb18030/chinese_code.txt", TextEncoding::Gb18030 },
+        { "gb18030/short_greeting.txt", TextEncoding::Gb18030 },
+        { "gb18030/mixed_zh_en.txt", TextEncoding::Gb18030 },
+        { "gb18030/four_byte_chars.txt", TextEncoding::Gb18030 },
+        { "utf16le/chinese_notes.txt", TextEncoding::Utf16LE },
+        { "utf16le/english_notes.txt", TextEncoding::Utf16LE },
+        { "utf16le/chinese_no_ascii.txt", TextEncoding::Utf16LE },
+        { "utf16be/chinese_notes.txt", TextEncoding::Utf16BE },
+        { "utf16be/english_notes.txt", TextEncoding::Utf16BE },
+        { "ansi/french_cp1252.txt", TextEncoding::Ansi },
+        { "ansi/german_cp1252.txt", TextEncoding::Ansi },
+    };
+
+    std::vector<uint8_t> ReadSample(const char* relative)
+    {
+        std::vector<uint8_t> data;
+        EXPECT_TRUE(FileUtil::ReadAll(CorpusPath(relative), data)) << relative;
+        return data;
+    }
+
+    TextEncoding Detect(const std::vector<uint8_t>& data)
+    {
+        return DetectTextEncoding(data.data(), data.size()).encoding;
+    }
+}
+
+// ============ 标注语料 ============
+
+TEST(EncodingDetectorTest, LabeledCorpus)
+{
+    for (const LabeledSample& sample : g_corpus)
+    {
+        std::vector<uint8_t> data = ReadSample(sample.path);
+        ASSERT_FALSE(data.empty()) << sample.path;
+        EncodingDetectResult result = DetectTextEncoding(data.data(), data.size());
+        EXPECT_EQ(result.encoding, sample.expected)
+            << sample.path << " detected as " << GetTextEncodingName(result.encoding);
+        EXPECT_EQ(result.bomLength, 0u);
+    }
+}
+
+// ============ BOM ============
+
+TEST(EncodingDetectorTest, BomTakesPrecedence)
+{
+    const uint8_t utf8[] = { 0xEF, 0xBB, 0xBF, 'a' };
+    const uint8_t utf16le[] = { 0xFF, 0xFE, 'a', 0 };
+    const uint8_t utf16be[] = { 0xFE, 0xFF, 0, 'a' };
+    const uint8_t gb18030[] = { 0x84, 0x31, 0x95, 0x33, 'a' };
+
+    EncodingDetectResult r = DetectTextEncoding(utf8, sizeof(utf8));
+    EXPECT_EQ(r.encoding, TextEncoding::Utf8);
+    EXPECT_EQ(r.bomLength, 3u);
+    EXPECT_EQ(r.confidence, 100);
+
+    r = DetectTextEncoding(utf16le, sizeof(utf16le));
+    EXPECT_EQ(r.encoding, TextEncoding::Utf16LE);
+    EXPECT_EQ(r.bomLength, 2u);
+
+    r = DetectTextEncoding(utf16be, sizeof(utf16be));
+    EXPECT_EQ(r.encoding, TextEncoding::Utf16BE);
+    EXPECT_EQ(r.bomLength, 2u);
+
+    r = DetectTextEncoding(gb18030, sizeof(gb18030));
+    EXPECT_EQ(r.encoding, TextEncoding::Gb18030);
+    EXPECT_EQ(r.bomLength, 4u);
+}
+
+TEST(EncodingDetectorTest, EmptyAndTiny)
+{
+    EXPECT_EQ(DetectTextEncoding(nullptr, 0).encoding, TextEncoding::Ascii);
+    const uint8_t one[] = { 'x' };
+    EXPECT_EQ(DetectTextEncoding(one, 1).encoding, TextEncoding::Ascii);
+    const uint8_t le[] = { 'x', 0 };
+    EXPECT_EQ(DetectTextEncoding(le, 2).encoding, TextEncoding::Utf16LE);
+}
+
+// ============ 大文件采样 ============
+
+namespace
+{
+    std::vector<uint8_t> Repeat(const std::vector<uint8_t>& unit, size_t minSize)
+    {
+        std::vector<uint8_t> out;
+        out.reserve(minSize + unit.size());
+        while (out.size() < minSize)
+            out.insert(out.end(), unit.begin(), unit.end());
+        return out;
+    }
+}
+
+TEST(EncodingDetectorTest, LargeFiles_StridedWindows)
+{
+    // 4 MB 以上：除文件头外的窗口会从多字节字符中间开始
+    const char* samples[] = { "utf8/chinese_notes.txt", "gb18030/chinese_notes.txt",
+        "utf16le/chinese_notes.txt", "utf16be/chinese_notes.txt" };
+    const TextEncoding expected[] = { TextEncoding::Utf8, TextEncoding::Gb18030,
+        TextEncoding::Utf16LE, TextEncoding::Utf16BE };
+    for (size_t i = 0; i < 4; i++)
+    {
+        std::vector<uint8_t> unit = ReadSample(samples[i]);
+        std::vector<uint8_t> big = Repeat(unit, 4 * 1024 * 1024 + 7);
+        EXPECT_EQ(Detect(big), expected[i]) << samples[i];
+    }
+}
+
+TEST(EncodingDetectorTest, LargeFiles_NonAsciiOnlyAfterHead)
+{
+    // 文件头 64 KB 全是 ASCII，中文只出现在后面：跨步窗口需要能发现它
+    std::vector<uint8_t> head(ENCODING_SAMPLE_HEAD_SIZE * 2, 'a');
+    std::vector<uint8_t> utf8 = Repeat(ReadSample("utf8/chinese_notes.txt"), 2 * 1024 * 1024);
+    std::vector<uint8_t> data = head;
+    data.insert(data.end(), utf8.begin(), utf8.end());
+    EXPECT_EQ(Detect(data), TextEncoding::Utf8);
+
+    std::vector<uint8_t> gbk = Repeat(ReadSample("gb18030/chinese_notes.txt"), 2 * 1024 * 1024);
+    data = head;
+    data.insert(data.end(), gbk.begin(), gbk.end());
+    EXPECT_EQ(Detect(data), TextEncoding::Gb18030);
+}
+
+TEST(EncodingDetectorTest, InvalidUtf8FallsBackToAnsi)
+{
+    // 非法 UTF-8、也不符合 GB18030 结构的字节
+    std::vector<uint8_t> data = { 'a', 0xFF, 'b', 0x80, 'c', 0xFF, ' ' };
+    EXPECT_EQ(Detect(data), TextEncoding::Ansi);
+}
@@ -0,0 +1,103 @@
+﻿// test_font_cache.cpp - 字体缓存测试
+#include "pch.h"
+#include "../MFCNoteBook/FontCache.h"
+
+using namespace TestableLogic;
+
+namespace
+{
+    struct FakeFont
+    {
+        int pointSize = 0;
+    };
+
+    typedef FontCache<FakeFont> FakeFontCache;
+
+    // 模拟创建字体和测量：记录调用次数
+    struct FakeFactory
+    {
+        int* pCalls;
+
+        void operator()(const FontKey& key, FakeFontCache::Entry& entry) const
+        {
+            (*pCalls)++;
+            entry.font.pointSize = key.pointSize;
+            entry.metrics.aveCharWidth = key.pointSize * 2 / 3;
+            entry.metrics.digitWidth = key.pointSize * 2 / 3;
+            entry.metrics.lineHeight = key.pointSize * 4 / 3;
+        }
+    };
+}
+
+TEST(FontCacheTest, SameKeyCreatesOnce)
+{
+    FakeFontCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    const FakeFontCache::Entry& first = cache.Get({ L"Consolas", 12 }, factory);
+    const FakeFontCache::Entry& second = cache.Get({ L"Consolas", 12 }, factory);
+    EXPECT_EQ(&first, &second);
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(16, first.metrics.lineHeight);
+    EXPECT_EQ(1u, cache.GetCreateCount());
+    EXPECT_EQ(1u, cache.GetHitCount());
+}
+
+TEST(FontCacheTest, FaceAndSizeAreBothPartOfKey)
+{
+    FakeFontCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    cache.Get({ L"Consolas", 12 }, factory);
+    cache.Get({ L"Consolas", 14 }, factory);
+    cache.Get({ L"Courier New", 12 }, factory);
+    EXPECT_EQ(3, calls);
+    EXPECT_EQ(3u, cache.GetSize());
+}
+
+TEST(FontCacheTest, ZoomCyclesMeasureEachSizeOnce)
+{
+    FakeFontCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    // 反复放大缩小：8 到 72 号，步长 2
+    for (int round = 0; round < 5; round++)
+    {
+        for (int size = 8; size <= 72; size += 2)
+            cache.Get({ L"Consolas", size }, factory);
+        for (int size = 72; size >= 8; size -= 2)
+            cache.Get({ L"Consolas", size }, factory);
+    }
+    EXPECT_EQ(33, calls);
+    EXPECT_EQ(33u, cache.GetSize());
+}
+
+TEST(FontCacheTest, EntriesStayValidWhileCacheGrows)
+{
+    FakeFontCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    const FakeFontCache::Entry* pEntry = &cache.Get({ L"Consolas", 11 }, factory);
+    for (int size = 20; size < 200; size++)
+        cache.Get({ L"Consolas", size }, factory);
+
+    EXPECT_EQ(pEntry, &cache.Get({ L"Consolas", 11 }, factory));
+    EXPECT_EQ(11, pEntry->font.pointSize);
+}
+
+TEST(FontCacheTest, ClearRecreates)
+{
+    FakeFontCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    cache.Get({ L"Consolas", 11 }, factory);
+    cache.Clear();
+    EXPECT_EQ(0u, cache.GetSize());
+    cache.Get({ L"Consolas", 11 }, factory);
+    EXPECT_EQ(2, calls);
+}
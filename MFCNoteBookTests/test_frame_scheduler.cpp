@@ -0,0 +1,88 @@
+﻿// test_frame_scheduler.cpp - 编辑和滚动通知合并测试
+#include "pch.h"
+#include "../MFCNoteBook/FrameScheduler.h"
+
+using namespace TestableLogic;
+
+TEST(FrameSchedulerTest, FirstPostRequestsFlush)
+{
+    FrameScheduler scheduler;
+    EXPECT_FALSE(scheduler.HasPending());
+    EXPECT_TRUE(scheduler.Post(FRAME_WORK_CONTENT));
+    EXPECT_FALSE(scheduler.Post(FRAME_WORK_CONTENT));
+    EXPECT_FALSE(scheduler.Post(FRAME_WORK_SCROLL));
+    EXPECT_EQ(static_cast<unsigned>(FRAME_WORK_CONTENT | FRAME_WORK_SCROLL), scheduler.GetPending());
+}
+
+TEST(FrameSchedulerTest, TakePendingClearsAndCounts)
+{
+    FrameScheduler scheduler;
+    scheduler.Post(FRAME_WORK_CONTENT);
+    scheduler.Post(FRAME_WORK_SCROLL);
+
+    EXPECT_EQ(static_cast<unsigned>(FRAME_WORK_CONTENT | FRAME_WORK_SCROLL), scheduler.TakePending(100));
+    EXPECT_FALSE(scheduler.HasPending());
+    EXPECT_EQ(0u, scheduler.TakePending(200));
+    EXPECT_EQ(1u, scheduler.GetExecutedCount());
+
+    // 刷新之后的第一个通知重新要求安排刷新
+    EXPECT_TRUE(scheduler.Post(FRAME_WORK_SCROLL));
+}
+
+TEST(FrameSchedulerTest, DelayKeepsOneFlushPerFrame)
+{
+    FrameScheduler scheduler(16);
+    EXPECT_EQ(0u, scheduler.GetDelay(1000));    // 从未刷新过
+
+    scheduler.Post(FRAME_WORK_CONTENT);
+    scheduler.TakePending(1000);
+    EXPECT_EQ(16u, scheduler.GetDelay(1000));
+    EXPECT_EQ(6u, scheduler.GetDelay(1010));
+    EXPECT_EQ(0u, scheduler.GetDelay(1016));
+    EXPECT_EQ(0u, scheduler.GetDelay(5000));
+}
+
+TEST(FrameSchedulerTest, Cancel)
+{
+    FrameScheduler scheduler;
+    scheduler.Post(FRAME_WORK_CONTENT);
+    scheduler.Cancel();
+    EXPECT_FALSE(scheduler.HasPending());
+    EXPECT_EQ(0u, scheduler.TakePending(0));
+    EXPECT_EQ(0u, scheduler.GetExecutedCount());
+}
+
+// 按键自动重复约 30 字符/秒，粘贴时一帧内可能有上千个通知：
+// 模拟 2 秒内每毫秒 5 个通知，每帧只执行一次
+TEST(FrameSchedulerTest, BurstCoalescesToOneUpdatePerFrame)
+{
+    FrameScheduler scheduler(16);
+    uint64_t nextFlush = 0;
+    bool bScheduled = false;
+
+    for (uint64_t now = 0; now < 2000; now++)
+    {
+        if (bScheduled && now >= nextFlush)
+        {
+            scheduler.TakePending(now);
+            bScheduled = false;
+        }
+        for (int i = 0; i < 5; i++)
+        {
+            if (scheduler.Post(i == 0 ? FRAME_WORK_CONTENT : FRAME_WORK_SCROLL))
+            {
+                nextFlush = now + scheduler.GetDelay(now);
+                bScheduled = true;
+            }
+        }
+    }
+
+    EXPECT_EQ(10000u, scheduler.GetPostedCount());
+    EXPECT_LE(scheduler.GetExecutedCount(), 2000u / 16 + 1);
+    EXPECT_GE(scheduler.GetExecutedCount(), 2000u / 17);
+    EXPECT_EQ(scheduler.GetPostedCount() - scheduler.GetCoalescedCount(),
+        scheduler.GetExecutedCount() + (scheduler.HasPending() ? 1 : 0));
+
+    scheduler.ResetCounters();
+    EXPECT_EQ(0u, scheduler.GetPostedCount());
+}
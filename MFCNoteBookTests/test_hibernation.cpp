@@ -0,0 +1,251 @@
+﻿// test_hibernation.cpp - 文档休眠测试
+#include "pch.h"
+#include "../MFCNoteBook/Hibernation.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+#include <algorithm>
+
+using namespace TestableLogic;
+
+namespace
+{
+    UndoJournalCipher MakeXorCipher(uint8_t key)
+    {
+        UndoJournalCipher cipher;
+        cipher.encrypt = [key](const std::vector<uint8_t>& plain, std::vector<uint8_t>& out)
+        {
+            out.clear();
+            for (uint8_t b : plain)
+                out.push_back(static_cast<uint8_t>(b ^ key));
+            return true;
+        };
+        cipher.decrypt = [key](const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+        {
+            out.clear();
+            for (uint8_t b : in)
+                out.push_back(static_cast<uint8_t>(b ^ key));
+            return true;
+        };
+        cipher.keyCheck = 0x3000 + key;
+        return cipher;
+    }
+
+    std::u16string MakeRepetitiveText(size_t lines)
+    {
+        std::u16string text;
+        for (size_t i = 0; i < lines; i++)
+            text += u"第 " + std::u16string(1, static_cast<char16_t>(u'0' + i % 10)) + u" 行 some text\r\n";
+        return text;
+    }
+
+    std::vector<uint32_t> Sorted(std::vector<uint32_t> ids)
+    {
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+}
+
+// ============ 保存与取回 ============
+
+TEST(HibernatedTextTest, CompressesRepetitiveText)
+{
+    std::u16string text = MakeRepetitiveText(2000);
+    HibernatedText hibernated;
+    hibernated.Store(text.data(), text.size());
+
+    EXPECT_TRUE(hibernated.IsStored());
+    EXPECT_FALSE(hibernated.IsSpilled());
+    EXPECT_EQ(text.size() * 2, hibernated.GetTextBytes());
+    EXPECT_LT(hibernated.GetMemoryBytes() * 4, hibernated.GetTextBytes());
+
+    std::u16string loaded;
+    ASSERT_TRUE(hibernated.Load(nullptr, loaded));
+    EXPECT_EQ(text, loaded);
+    EXPECT_FALSE(hibernated.IsStored());
+    EXPECT_EQ(0u, hibernated.GetMemoryBytes());
+}
+
+TEST(HibernatedTextTest, IncompressibleTextKeptAsIs)
+{
+    std::u16string text;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 4096; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        text.push_back(static_cast<char16_t>(0x4E00 + (seed >> 16) % 0x5000));
+    }
+
+    HibernatedText hibernated;
+    hibernated.Store(text.data(), text.size());
+    EXPECT_EQ(text.size() * 2, hibernated.GetMemoryBytes());
+
+    std::u16string loaded;
+    ASSERT_TRUE(hibernated.Load(nullptr, loaded));
+    EXPECT_EQ(text, loaded);
+}
+
+TEST(HibernatedTextTest, EmptyText)
+{
+    HibernatedText hibernated;
+    hibernated.Store(u"", 0);
+    EXPECT_TRUE(hibernated.IsStored());
+
+    std::u16string loaded = u"x";
+    ASSERT_TRUE(hibernated.Load(nullptr, loaded));
+    EXPECT_TRUE(loaded.empty());
+}
+
+// ============ 写入临时文件 ============
+
+TEST(HibernatedTextTest, SpillEncryptsAndReleasesMemory)
+{
+    std::string path = ::testing::TempDir() + "hibernate_spill.hib";
+    std::u16string text = MakeRepetitiveText(500);
+    UndoJournalCipher cipher = MakeXorCipher(0x5A);
+
+    HibernatedText hibernated;
+    hibernated.Store(text.data(), text.size());
+    ASSERT_TRUE(hibernated.Spill(path, cipher));
+    EXPECT_TRUE(hibernated.IsSpilled());
+    EXPECT_EQ(0u, hibernated.GetMemoryBytes());
+    EXPECT_TRUE(FileUtil::Exists(path));
+
+    // 文件中没有明文
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(FileUtil::ReadAll(path, data));
+    const char16_t needle[] = u"some text";
+    const uint8_t* pNeedle = reinterpret_cast<const uint8_t*>(needle);
+    EXPECT_EQ(data.end(), std::search(data.begin(), data.end(), pNeedle, pNeedle + 18));
+
+    std::u16string loaded;
+    ASSERT_TRUE(hibernated.Load(&cipher, loaded));
+    EXPECT_EQ(text, loaded);
+    EXPECT_FALSE(FileUtil::Exists(path));
+}
+
+TEST(HibernatedTextTest, WrongKeyOrCorruptFileKeepsData)
+{
+    std::string path = ::testing::TempDir() + "hibernate_corrupt.hib";
+    std::u16string text = MakeRepetitiveText(100);
+    UndoJournalCipher cipher = MakeXorCipher(0x11);
+    UndoJournalCipher other = MakeXorCipher(0x22);
+
+    HibernatedText hibernated;
+    hibernated.Store(text.data(), text.size());
+    ASSERT_TRUE(hibernated.Spill(path, cipher));
+
+    std::u16string loaded;
+    EXPECT_FALSE(hibernated.Load(&other, loaded));
+    EXPECT_FALSE(hibernated.Load(nullptr, loaded));
+    EXPECT_TRUE(hibernated.IsStored());
+
+    // 改动负载的一个字节：校验不符
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(FileUtil::ReadAll(path, data));
+    std::vector<uint8_t> corrupt = data;
+    corrupt.back() ^= 0xFF;
+    ASSERT_TRUE(FileUtil::WriteAllAtomic(path, corrupt.data(), corrupt.size()));
+    EXPECT_FALSE(hibernated.Load(&cipher, loaded));
+
+    ASSERT_TRUE(FileUtil::WriteAllAtomic(path, data.data(), data.size()));
+    ASSERT_TRUE(hibernated.Load(&cipher, loaded));
+    EXPECT_EQ(text, loaded);
+}
+
+TEST(HibernatedTextTest, ClearRemovesSpillFile)
+{
+    std::string path = ::testing::TempDir() + "hibernate_clear.hib";
+    {
+        HibernatedText hibernated;
+        std::u16string text = MakeRepetitiveText(10);
+        hibernated.Store(text.data(), text.size());
+        ASSERT_TRUE(hibernated.Spill(path, MakeXorCipher(1)));
+        EXPECT_TRUE(FileUtil::Exists(path));
+    }
+    EXPECT_FALSE(FileUtil::Exists(path));
+}
+
+// ============ 临时文件名 ============
+
+TEST(HibernationFileNameTest, RoundTripsProcessId)
+{
+    std::string name = MakeSpillFileName(0x1A2Bu, 7);
+    EXPECT_EQ("MFCNoteBook-00001a2b-7.hib", name);
+
+    uint32_t processId = 0;
+    ASSERT_TRUE(ParseSpillFileName(name, processId));
+    EXPECT_EQ(0x1A2Bu, processId);
+    ASSERT_TRUE(ParseSpillFileName(MakeSpillFileName(0xFFFFFFFFu, 4294967295u), processId));
+    EXPECT_EQ(0xFFFFFFFFu, processId);
+    ASSERT_TRUE(ParseSpillFileName("MFCNoteBook-0000ABCD-12.hib", processId));
+    EXPECT_EQ(0xABCDu, processId);
+}
+
+TEST(HibernationFileNameTest, RejectsOtherNames)
+{
+    uint32_t processId = 0;
+    EXPECT_FALSE(ParseSpillFileName("", processId));
+    EXPECT_FALSE(ParseSpillFileName("MFCNoteBook-00001a2b-.hib", processId));
+    EXPECT_FALSE(ParseSpillFileName("MFCNoteBook-1a2b-7.hib", processId));
+    EXPECT_FALSE(ParseSpillFileName("MFCNoteBook-00001a2g-7.hib", processId));
+    EXPECT_FALSE(ParseSpillFileName("MFCNoteBook-00001a2b-7x.hib", processId));
+    EXPECT_FALSE(ParseSpillFileName("MFCNoteBook-00001a2b-7.tmp", processId));
+    EXPECT_FALSE(ParseSpillFileName("Other-00001a2b-7.hib", processId));
+    EXPECT_EQ(0u, processId);
+}
+
+// ============ 休眠的选择 ============
+
+TEST(HibernationPolicyTest, IdleDocumentsSelected)
+{
+    std::vector<HibernationCandidate> docs = {
+        { 1, 10000, 100, true },
+        { 2, 500, 100, true },
+        { 3, 20000, 100, false },   // 活动文档
+        { 4, 60000, 100, true },
+    };
+    EXPECT_EQ(std::vector<uint32_t>({ 1, 4 }), Sorted(SelectForHibernation(docs, 5000, 0)));
+    EXPECT_TRUE(SelectForHibernation(docs, 0, 0).empty());
+}
+
+TEST(HibernationPolicyTest, BudgetHibernatesLongestIdleFirst)
+{
+    std::vector<HibernationCandidate> docs = {
+        { 1, 300, 400, true },
+        { 2, 100, 400, true },
+        { 3, 50, 400, false },
+        { 4, 200, 400, true },
+    };
+    // 总共 1600，预算 900：先休眠空闲最久的 1，再休眠 4
+    EXPECT_EQ(std::vector<uint32_t>({ 1, 4 }), SelectForHibernation(docs, 0, 900));
+    EXPECT_TRUE(SelectForHibernation(docs, 0, 1600).empty());
+
+    // 只剩不可休眠的文档时停止
+    EXPECT_EQ(std::vector<uint32_t>({ 1, 4, 2 }), SelectForHibernation(docs, 0, 100));
+}
+
+TEST(HibernationPolicyTest, BudgetCountsAfterIdleSelection)
+{
+    std::vector<HibernationCandidate> docs = {
+        { 1, 9000, 1000, true },
+        { 2, 100, 300, true },
+        { 3, 50, 300, true },
+    };
+    // 1 因空闲休眠后剩余 600，未超出预算
+    EXPECT_EQ(std::vector<uint32_t>({ 1 }), SelectForHibernation(docs, 5000, 700));
+}
+
+TEST(HibernationPolicyTest, SpillLargestUntilWithinBudget)
+{
+    std::vector<HibernatedEntry> hibernated = {
+        { 1, 100 },
+        { 2, 500 },
+        { 3, 0 },       // 已写入临时文件
+        { 4, 300 },
+    };
+    EXPECT_TRUE(SelectForSpill(hibernated, 200, 1100).empty());
+    EXPECT_EQ(std::vector<uint32_t>({ 2 }), SelectForSpill(hibernated, 200, 700));
+    EXPECT_EQ(std::vector<uint32_t>({ 2, 4 }), SelectForSpill(hibernated, 200, 300));
+    EXPECT_EQ(std::vector<uint32_t>({ 2, 4, 1 }), SelectForSpill(hibernated, 500, 100));
+    EXPECT_TRUE(SelectForSpill(hibernated, 5000, 0).empty());
+}
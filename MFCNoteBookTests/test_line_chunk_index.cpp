@@ -0,0 +1,305 @@
+﻿// test_line_chunk_index.cpp - 超长行分块排版测试
+#include "pch.h"
+#include "../MFCNoteBook/LineChunkIndex.h"
+#include "../MFCNoteBook/TextEditorModel.h"
+#include "../MFCNoteBook/TextLayout.h"
+#include "../MFCNoteBook/TextCodec.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 约 200 KB 的单行：ASCII、空格和中文混排（"中" 为 3 字节、2 列）
+    std::string MakeLongLine(size_t words)
+    {
+        std::string line;
+        for (size_t i = 0; i < words; i++)
+        {
+            line += (i % 7 == 3) ? "\xE4\xB8\xAD\xE6\x96\x87" : "word";
+            line += (i % 5 == 0) ? "," : " ";
+        }
+        return line;
+    }
+
+    LineChunkIndex::ChunkInfo Chunk(size_t bytes, size_t columns, size_t rows = 1)
+    {
+        LineChunkIndex::ChunkInfo info = { bytes, bytes, columns, 0, false, rows };
+        return info;
+    }
+}
+
+TEST(LineChunkIndexTest, SplitKeepsUtf8SequencesAndPrefersSpaces)
+{
+    std::string line = MakeLongLine(40000);
+    std::vector<size_t> ends;
+    LineChunkIndex::Split(line.data(), line.size(), ends);
+
+    ASSERT_FALSE(ends.empty());
+    EXPECT_EQ(line.size(), ends.back());
+    size_t begin = 0;
+    for (size_t i = 0; i < ends.size(); i++)
+    {
+        EXPECT_GT(ends[i], begin);
+        EXPECT_LE(ends[i] - begin, static_cast<size_t>(LINE_CHUNK_BYTES));
+        if (i + 1 < ends.size())
+        {
+            // 块边界不在续字节上，且这份文本里总能找到空格
+            EXPECT_NE(0x80, static_cast<unsigned char>(line[ends[i]]) & 0xC0);
+            EXPECT_EQ(' ', line[ends[i] - 1]);
+        }
+        begin = ends[i];
+    }
+}
+
+TEST(LineChunkIndexTest, SplitWithoutSpacesStillRespectsSequences)
+{
+    // 全部是 3 字节字符，块长度只能是 3 的倍数
+    std::string line;
+    for (int i = 0; i < 10000; i++)
+        line += "\xE4\xB8\xAD";
+    std::vector<size_t> ends;
+    LineChunkIndex::Split(line.data(), line.size(), ends);
+    for (size_t end : ends)
+        EXPECT_EQ(0u, end % 3);
+}
+
+TEST(LineChunkIndexTest, PrefixSumsAndLookups)
+{
+    LineChunkIndex index;
+    std::vector<LineChunkIndex::ChunkInfo> chunks = { Chunk(10, 10, 2), Chunk(20, 30, 3), Chunk(5, 5, 1) };
+    index.ReplaceChunks(0, 0, chunks);
+
+    EXPECT_EQ(3u, index.GetChunkCount());
+    EXPECT_EQ(35u, index.GetByteLength());
+    EXPECT_EQ(45u, index.GetColumns());
+    EXPECT_EQ(6u, index.GetRows());
+    EXPECT_EQ(10u, index.GetByteStart(1));
+    EXPECT_EQ(40u, index.GetColumnStart(2));
+
+    EXPECT_EQ(0u, index.FindChunkByByte(9));
+    EXPECT_EQ(1u, index.FindChunkByByte(10));       // 块边界归后一块
+    EXPECT_EQ(2u, index.FindChunkByByte(35));       // 行尾归最后一块
+    EXPECT_EQ(1u, index.FindChunkByColumn(39));
+    EXPECT_EQ(2u, index.FindChunkByColumn(1000));
+    EXPECT_EQ(1u, index.FindChunkByRow(4));
+    EXPECT_EQ(2u, index.FindChunkByRow(5));
+}
+
+TEST(LineChunkIndexTest, ReplaceChunksShiftsFollowingChunks)
+{
+    LineChunkIndex index;
+    std::vector<LineChunkIndex::ChunkInfo> chunks = { Chunk(10, 10), Chunk(10, 10), Chunk(10, 10) };
+    index.ReplaceChunks(0, 0, chunks);
+
+    // 中间一块变短并拆成两块
+    std::vector<LineChunkIndex::ChunkInfo> middle = { Chunk(3, 3), Chunk(4, 8) };
+    index.ReplaceChunks(1, 1, middle);
+    EXPECT_EQ(4u, index.GetChunkCount());
+    EXPECT_EQ(27u, index.GetByteLength());
+    EXPECT_EQ(31u, index.GetColumns());
+    EXPECT_EQ(17u, index.GetByteStart(3));
+    EXPECT_EQ(21u, index.GetColumnStart(3));
+
+    size_t first, count;
+    index.GetEditRange(13, 0, first, count);        // 块边界上的插入包含前一块
+    EXPECT_EQ(1u, first);
+    EXPECT_EQ(2u, count);
+    index.GetEditRange(5, 20, first, count);
+    EXPECT_EQ(0u, first);
+    EXPECT_EQ(4u, count);
+}
+
+TEST(LineChunkIndexTest, TabChunksFollowStartColumn)
+{
+    // "ab\tcd"：第一个制表符前 2 列，之后 2 列
+    LineChunkIndex::ChunkInfo tab = { 5, 5, 2, 2, true, 1 };
+    EXPECT_EQ(6u, LineChunkIndex::GetChunkColumns(tab, 0));
+    EXPECT_EQ(5u, LineChunkIndex::GetChunkColumns(tab, 1));
+    EXPECT_EQ(7u, LineChunkIndex::GetChunkColumns(tab, 3));     // 从第 3 列到第 10 列
+
+    // 前一块变宽后，含制表符的块按新的起始列重新累加
+    LineChunkIndex index;
+    std::vector<LineChunkIndex::ChunkInfo> chunks = { Chunk(4, 4), tab, Chunk(3, 3) };
+    index.ReplaceChunks(0, 0, chunks);
+    EXPECT_EQ(4u + 6u + 3u, index.GetColumns());
+    std::vector<LineChunkIndex::ChunkInfo> wider = { Chunk(6, 6) };
+    index.ReplaceChunks(0, 1, wider);
+    EXPECT_EQ(6u, index.GetColumnStart(1));
+    EXPECT_EQ(14u, index.GetColumnStart(2));        // 制表符从第 8 列跳到第 12 列
+    EXPECT_EQ(17u, index.GetColumns());
+}
+
+TEST(TextEditorModelTest, LongLine_ColumnsMatchWholeLineLayout)
+{
+    std::string line = MakeLongLine(40000);
+    std::string text = line + "\nshort\n";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(20, 80);
+
+    // 参照：整行解码后逐字符累加
+    std::u16string whole = model.GetLineText(0);
+    std::mt19937 rng(7);
+    for (int i = 0; i < 200; i++)
+    {
+        size_t column = rng() % (ColumnFromIndex(whole.data(), whole.size(), whole.size()) + 10);
+        size_t offset = model.OffsetFromCell(0, column);
+        size_t index = Utf8ToUtf16String(line.data(), offset).size();
+        EXPECT_EQ(IndexFromColumn(whole.data(), whole.size(), column), index);
+        EXPECT_EQ(ColumnFromIndex(whole.data(), whole.size(), index), model.ColumnFromOffset(offset));
+    }
+
+    // 行尾和下一行不受影响
+    model.MoveCaret(CaretMove::LineEnd, false);
+    EXPECT_EQ(line.size(), model.GetSelection().caret);
+    EXPECT_EQ(ColumnFromIndex(whole.data(), whole.size(), whole.size()), model.GetCaretColumn());
+    EXPECT_EQ(3u, model.OffsetFromCell(1, 3) - line.size() - 1);
+}
+
+TEST(TextEditorModelTest, LongLine_SliceCoversVisibleColumns)
+{
+    std::string line = MakeLongLine(40000);
+    TextBuffer buffer;
+    buffer.SetText(line.data(), line.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(20, 100);
+    model.SetFirstVisibleColumn(123456);
+
+    LineSlice slice;
+    ASSERT_TRUE(model.GetLongLineSlice(0, 0, slice));
+    EXPECT_LE(slice.startColumn, 123456u);
+    size_t columns = 0;
+    for (int w : slice.cells)
+        columns += static_cast<size_t>(w);
+    EXPECT_GE(slice.startColumn + columns, 123456u + 100u);
+    EXPECT_LT(slice.text.size(), 4u * LINE_CHUNK_BYTES);     // 只解码了可见的几块
+    EXPECT_EQ(slice.text.size() + 1, slice.offsets.size());
+    EXPECT_FALSE(slice.bLineEnd);
+
+    std::string shortText = "abc";
+    TextBuffer shortBuffer;
+    shortBuffer.SetText(shortText.data(), shortText.size());
+    model.SetBuffer(&shortBuffer);
+    EXPECT_FALSE(model.GetLongLineSlice(0, 0, slice));
+}
+
+TEST(TextEditorModelTest, LongLine_EditsMatchFreshLayout)
+{
+    std::string line = MakeLongLine(30000);
+    TextBuffer buffer;
+    buffer.SetText(line.data(), line.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(20, 80);
+    model.GetCaretColumn();
+
+    // 行内随机插入和删除，按块更新的索引与重新建立的结果一致
+    std::mt19937 rng(11);
+    for (int i = 0; i < 100; i++)
+    {
+        size_t offset = model.OffsetFromCell(0, rng() % model.ColumnFromOffset(buffer.GetLength()));
+        model.SetSelection(offset, offset);
+        if (rng() % 3 == 0)
+        {
+            model.DeleteForward();
+        }
+        else
+        {
+            std::u16string insert = (rng() % 2) ? u"中x" : u"\t ab";
+            model.InsertText(insert.data(), insert.size());
+        }
+    }
+
+    TextEditorModel fresh;
+    fresh.SetBuffer(&buffer);
+    fresh.SetViewport(20, 80);
+    for (size_t column = 0; column < fresh.ColumnFromOffset(buffer.GetLength()); column += 997)
+        EXPECT_EQ(fresh.OffsetFromCell(0, column), model.OffsetFromCell(0, column));
+    EXPECT_EQ(fresh.ColumnFromOffset(buffer.GetLength()), model.ColumnFromOffset(buffer.GetLength()));
+
+    // 插入换行后行被拆开，不再是超长行的部分退回整行排版
+    size_t breakAt = model.OffsetFromCell(0, 100);
+    model.SetSelection(breakAt, breakAt);
+    model.InsertLineBreak();
+    EXPECT_EQ(2u, buffer.GetLineCount());
+    EXPECT_EQ(100u, model.ColumnFromOffset(breakAt));
+    size_t end = buffer.GetLength();
+    EXPECT_EQ(fresh.ColumnFromOffset(end), model.ColumnFromOffset(end));
+}
+
+TEST(TextEditorModelTest, LongLine_WordWrapRowsAndCaret)
+{
+    std::string line = MakeLongLine(40000);
+    std::string text = line + "\nshort";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(20, 60);
+    model.SetWordWrap(true);
+    while (model.ReflowPending(64) != 0)
+    {
+    }
+
+    // 每块从新的可视行开始：总行数是各块分别折行之和
+    std::vector<size_t> ends;
+    LineChunkIndex::Split(line.data(), line.size(), ends);
+    size_t rows = 0;
+    size_t begin = 0;
+    for (size_t end : ends)
+    {
+        std::u16string chunk = Utf8ToUtf16String(line.data() + begin, end - begin);
+        rows += ComputeWrapPoints(chunk.data(), chunk.size(), 60).size();
+        begin = end;
+    }
+    EXPECT_EQ(rows + 1, model.GetTotalRows());
+
+    // 光标定位到中间某个可视行再移回来
+    uint64_t row = rows / 2;
+    model.SetCaretFromRowCell(row, 5, false);
+    EXPECT_EQ(row, model.GetCaretRow());
+    EXPECT_EQ(5u, model.GetCaretRowColumn());
+    model.MoveCaret(CaretMove::Down, false);
+    EXPECT_EQ(row + 1, model.GetCaretRow());
+
+    LineSlice slice;
+    ASSERT_TRUE(model.GetLongLineSlice(0, static_cast<size_t>(row), slice));
+    EXPECT_LE(slice.firstSubRow, row);
+    EXPECT_GT(slice.firstSubRow + slice.points.size(), row);
+
+    model.MoveCaret(CaretMove::DocEnd, false);
+    EXPECT_EQ(rows, model.GetCaretRow());
+}
+
+TEST(TextEditorModelTest, LongLine_FindNextScrollsToHit)
+{
+    std::string line = MakeLongLine(40000) + " target targets";
+    TextBuffer buffer;
+    buffer.SetText(line.data(), line.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(20, 80);
+
+    // 全字匹配跳过 "targets"，找到后水平滚动到匹配处
+    ASSERT_TRUE(model.FindNext("target", true, true));
+    EXPECT_EQ(line.size() - 14, model.GetSelection().Start());
+    EXPECT_EQ(line.size() - 8, model.GetSelection().End());
+    EXPECT_TRUE(model.EnsureCaretVisible());
+    size_t column = model.GetCaretColumn();
+    EXPECT_GE(column, model.GetFirstVisibleColumn());
+    EXPECT_LT(column, model.GetFirstVisibleColumn() + 80);
+
+    // 再找一次：后面只有 "targets"，从头找回同一处
+    bool bWrapped = false;
+    ASSERT_TRUE(model.FindNext("TARGET", false, true, &bWrapped));
+    EXPECT_TRUE(bWrapped);
+    EXPECT_EQ(line.size() - 14, model.GetSelection().Start());
+    EXPECT_FALSE(model.FindNext("missing", true, false));
+}
@@ -0,0 +1,212 @@
+﻿// test_line_ending.cpp - 换行符检测与转换测试
+#include "pch.h"
+#include "../MFCNoteBook/LineEnding.h"
+#include "../MFCNoteBook/SimdSupport.h"
+
+#include <random>
+
+using namespace TestableLogic;
+
+namespace
+{
+    template <class Fn>
+    void ForEachSimdLevel(Fn fn)
+    {
+        const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::SSSE3, SimdLevel::AVX2 };
+        for (SimdLevel level : levels)
+        {
+            if (level > GetDetectedSimdLevel())
+                break;
+            SetSimdLevelOverride(level);
+            SCOPED_TRACE(GetSimdLevelName(level));
+            fn();
+        }
+        ClearSimdLevelOverride();
+    }
+
+    LineEndingStats Count(const std::u16string& text)
+    {
+        return CountLineEndings(text.data(), text.size());
+    }
+
+    std::u16string Convert(const std::u16string& text, LineEnding target)
+    {
+        return ConvertLineEndingsString(text.data(), text.size(), target);
+    }
+
+    // 参考实现：逐单元判断
+    std::u16string ConvertReference(const std::u16string& text, LineEnding target)
+    {
+        const char16_t* breaks[] = { u"\r\n", u"\n", u"\r" };
+        std::u16string out;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (text[i] == u'\r' || text[i] == u'\n')
+            {
+                if (text[i] == u'\r' && i + 1 < text.size() && text[i + 1] == u'\n')
+                    i++;
+                out += breaks[static_cast<int>(target)];
+            }
+            else
+            {
+                out += text[i];
+            }
+        }
+        return out;
+    }
+
+    // 随机文本：行长从 0 到 80 不等，换行随机取 CRLF/LF/CR
+    std::u16string MakeMixedText(std::mt19937& rng, size_t lines)
+    {
+        const char16_t* breaks[] = { u"\r\n", u"\n", u"\r" };
+        std::u16string text;
+        for (size_t i = 0; i < lines; i++)
+        {
+            size_t len = rng() % 81;
+            for (size_t j = 0; j < len; j++)
+                text += static_cast<char16_t>((rng() % 4 == 0) ? 0x4E00 + rng() % 0x100 : 'a' + rng() % 26);
+            text += breaks[rng() % 3];
+        }
+        return text;
+    }
+}
+
+// ============ 检测 ============
+
+TEST(LineEndingTest, Detect_EachStyle)
+{
+    ForEachSimdLevel([]()
+        {
+            LineEndingStats s = Count(u"a\r\nb\r\nc");
+            EXPECT_EQ(s.crlf, 2u);
+            EXPECT_EQ(s.lf, 0u);
+            EXPECT_EQ(s.cr, 0u);
+            EXPECT_EQ(GetDominantLineEnding(s), LineEnding::CrLf);
+            EXPECT_FALSE(IsMixedLineEndings(s));
+
+            s = Count(u"a\nb\nc\n");
+            EXPECT_EQ(s.lf, 3u);
+            EXPECT_EQ(GetDominantLineEnding(s), LineEnding::Lf);
+
+            s = Count(u"a\rb\r");
+            EXPECT_EQ(s.cr, 2u);
+            EXPECT_EQ(GetDominantLineEnding(s), LineEnding::Cr);
+
+            s = Count(u"a\r\nb\nc\nd\r");
+            EXPECT_EQ(s.crlf, 1u);
+            EXPECT_EQ(s.lf, 2u);
+            EXPECT_EQ(s.cr, 1u);
+            EXPECT_TRUE(IsMixedLineEndings(s));
+            EXPECT_EQ(GetDominantLineEnding(s), LineEnding::Lf);
+        });
+}
+
+TEST(LineEndingTest, Detect_NoBreaksDefaultsToCrLf)
+{
+    LineEndingStats s = Count(u"");
+    EXPECT_EQ(GetLineBreakCount(s), 0u);
+    EXPECT_EQ(GetDominantLineEnding(s), LineEnding::CrLf);
+    EXPECT_FALSE(IsMixedLineEndings(Count(u"no line breaks here")));
+}
+
+TEST(LineEndingTest, Detect_CrLfAcrossBlockBoundaries)
+{
+    // CR 落在每个可能的块末尾，LF 在下一个块开头
+    ForEachSimdLevel([]()
+        {
+            for (size_t pos = 0; pos < 70; pos++)
+            {
+                std::u16string text(pos, u'x');
+                text += u"\r\n";
+                text += std::u16string(70, u'y');
+                LineEndingStats s = Count(text);
+                EXPECT_EQ(s.crlf, 1u) << pos;
+                EXPECT_EQ(s.lf, 0u) << pos;
+                EXPECT_EQ(s.cr, 0u) << pos;
+            }
+        });
+}
+
+TEST(LineEndingTest, Detect_RandomAgreesAcrossLevels)
+{
+    std::mt19937 rng(31);
+    std::u16string text = MakeMixedText(rng, 3000);
+    SetSimdLevelOverride(SimdLevel::Scalar);
+    LineEndingStats expected = Count(text);
+    ClearSimdLevelOverride();
+    EXPECT_TRUE(IsMixedLineEndings(expected));
+
+    ForEachSimdLevel([&]()
+        {
+            LineEndingStats s = Count(text);
+            EXPECT_EQ(s.crlf, expected.crlf);
+            EXPECT_EQ(s.lf, expected.lf);
+            EXPECT_EQ(s.cr, expected.cr);
+        });
+}
+
+// ============ 转换 ============
+
+TEST(LineEndingTest, Convert_MatchesReference)
+{
+    std::mt19937 rng(32);
+    std::u16string text = MakeMixedText(rng, 2000);
+    ForEachSimdLevel([&]()
+        {
+            for (LineEnding target : { LineEnding::CrLf, LineEnding::Lf, LineEnding::Cr })
+            {
+                std::u16string converted = Convert(text, target);
+                EXPECT_EQ(converted, ConvertReference(text, target)) << GetLineEndingName(target);
+                EXPECT_EQ(converted.size(), GetConvertedLength(Count(text), text.size(), target));
+            }
+        });
+}
+
+TEST(LineEndingTest, Convert_RoundTripThroughCrLf)
+{
+    // 载入时转为 CRLF，保存时转回原约定，内容不变
+    std::mt19937 rng(33);
+    for (LineEnding original : { LineEnding::Lf, LineEnding::Cr, LineEnding::CrLf })
+    {
+        std::u16string file = Convert(MakeMixedText(rng, 500), original);
+        std::u16string edit = Convert(file, LineEnding::CrLf);
+        EXPECT_EQ(GetDominantLineEnding(Count(edit)), LineEnding::CrLf);
+        EXPECT_FALSE(IsMixedLineEndings(Count(edit)));
+        EXPECT_EQ(Convert(edit, GetDominantLineEnding(Count(file))), file);
+    }
+}
+
+TEST(LineEndingTest, Convert_ChunkedNeverSplitsCrLf)
+{
+    std::mt19937 rng(34);
+    std::u16string text = MakeMixedText(rng, 400);
+    ForEachSimdLevel([&]()
+        {
+            for (LineEnding target : { LineEnding::CrLf, LineEnding::Lf })
+            {
+                std::u16string expected = Convert(text, target);
+                for (size_t chunk : { 2, 3, 7, 16, 17, 33, 4096 })
+                {
+                    std::u16string buffer(chunk, u'\0');
+                    std::u16string joined;
+                    size_t pos = 0;
+                    while (pos < text.size())
+                    {
+                        LineEndingConvertResult r = ConvertLineEndings(text.data() + pos, text.size() - pos,
+                            target, &buffer[0], chunk);
+                        ASSERT_GT(r.consumed, 0u);
+                        joined.append(buffer.data(), r.outputLength);
+                        pos += r.consumed;
+                    }
+                    EXPECT_EQ(joined, expected) << chunk;
+                }
+            }
+        });
+}
+
+TEST(LineEndingTest, Convert_LoneCrAtEnd)
+{
+    EXPECT_EQ(Convert(u"a\r", LineEnding::CrLf), u"a\r\n");
+    EXPECT_EQ(Convert(u"\r\r\n\n", LineEnding::Lf), u"\n\n\n");
+    EXPECT_EQ(Convert(u"", LineEnding::CrLf), u"");
+}
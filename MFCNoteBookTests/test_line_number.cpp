@@ -33,6 +33,13 @@ TEST(LineNumberTest, CountLines_WindowsLineEndings)
     EXPECT_EQ(CountLines(L"Line1\r\nLine2\r\nLine3"), 3);
 }
 
+TEST(LineNumberTest, CountLines_UnixAndMacLineEndings)
+{
+    EXPECT_EQ(CountLines(L"Line1\rLine2\rLine3"), 3);
+    EXPECT_EQ(CountLines(L"Line1\r\nLine2\nLine3\rLine4"), 4);  // ϻ
+    EXPECT_EQ(CountLines(L"\r\r\n\n"), 4);
+}
+
 // ============ кſȼ ============
 
 TEST(LineNumberTest, CalculateWidth_SmallFile)
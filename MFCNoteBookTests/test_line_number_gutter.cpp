@@ -0,0 +1,311 @@
+﻿// test_line_number_gutter.cpp - 行号区增量重画计划测试
+#include "pch.h"
+#include "../MFCNoteBook/LineNumberGutter.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace TestableLogic;
+
+namespace
+{
+    GutterFrame Frame(uint64_t firstLine, uint64_t lineCount, size_t rows = 40)
+    {
+        GutterFrame frame = { firstLine, lineCount, rows, 60, 16 };
+        return frame;
+    }
+}
+
+TEST(LineNumberGutterTest, FirstFrameIsFullRedraw)
+{
+    GutterUpdate update = PlanGutterUpdate(Frame(0, 100), false, Frame(0, 100));
+    EXPECT_TRUE(update.bFullRedraw);
+    EXPECT_EQ(0u, update.dirtyBegin);
+    EXPECT_EQ(40u, update.dirtyEnd);
+}
+
+TEST(LineNumberGutterTest, SizeChangeIsFullRedraw)
+{
+    GutterFrame next = Frame(0, 100);
+    next.width = 72;
+    EXPECT_TRUE(PlanGutterUpdate(Frame(0, 100), true, next).bFullRedraw);
+    EXPECT_TRUE(PlanGutterUpdate(Frame(0, 100), true, Frame(0, 100, 41)).bFullRedraw);
+}
+
+TEST(LineNumberGutterTest, UnchangedFrameRedrawsNothing)
+{
+    GutterUpdate update = PlanGutterUpdate(Frame(10, 1000), true, Frame(10, 1000));
+    EXPECT_FALSE(update.bFullRedraw);
+    EXPECT_EQ(0, update.shiftRows);
+    EXPECT_EQ(update.dirtyBegin, update.dirtyEnd);
+}
+
+TEST(LineNumberGutterTest, ScrollShiftsAndRedrawsExposedRows)
+{
+    GutterUpdate down = PlanGutterUpdate(Frame(10, 1000), true, Frame(13, 1000));
+    EXPECT_FALSE(down.bFullRedraw);
+    EXPECT_EQ(3, down.shiftRows);
+    EXPECT_EQ(37u, down.dirtyBegin);
+    EXPECT_EQ(40u, down.dirtyEnd);
+
+    GutterUpdate up = PlanGutterUpdate(Frame(10, 1000), true, Frame(8, 1000));
+    EXPECT_EQ(-2, up.shiftRows);
+    EXPECT_EQ(0u, up.dirtyBegin);
+    EXPECT_EQ(2u, up.dirtyEnd);
+
+    // 超过一屏时平移没有意义
+    EXPECT_TRUE(PlanGutterUpdate(Frame(10, 1000), true, Frame(50, 1000)).bFullRedraw);
+    EXPECT_TRUE(PlanGutterUpdate(Frame(50, 1000), true, Frame(10, 1000)).bFullRedraw);
+}
+
+TEST(LineNumberGutterTest, LineCountChangeRedrawsAffectedRowsOnly)
+{
+    // 文档末尾在可见范围内：新增的两行行号出现
+    GutterUpdate grow = PlanGutterUpdate(Frame(0, 20), true, Frame(0, 22));
+    EXPECT_FALSE(grow.bFullRedraw);
+    EXPECT_EQ(20u, grow.dirtyBegin);
+    EXPECT_EQ(22u, grow.dirtyEnd);
+
+    GutterUpdate shrink = PlanGutterUpdate(Frame(0, 22), true, Frame(0, 21));
+    EXPECT_EQ(21u, shrink.dirtyBegin);
+    EXPECT_EQ(22u, shrink.dirtyEnd);
+
+    // 文档末尾不可见：行数变化不影响可见的行号
+    GutterUpdate offscreen = PlanGutterUpdate(Frame(0, 1000), true, Frame(0, 1001));
+    EXPECT_EQ(offscreen.dirtyBegin, offscreen.dirtyEnd);
+}
+
+TEST(LineNumberGutterTest, LabelUpdate_WrappedRows)
+{
+    // 第 1 行折成 3 个可视行，第 2 行 1 个，第 3 行 2 个
+    std::vector<uint64_t> prev = { 1, 0, 0, 2, 3, 0 };
+    EXPECT_TRUE(PlanGutterLabelUpdate(prev, false, prev, 0).bFullRedraw);
+    EXPECT_TRUE(PlanGutterLabelUpdate(prev, true, std::vector<uint64_t>(7, 0), 0).bFullRedraw);
+
+    GutterUpdate same = PlanGutterLabelUpdate(prev, true, prev, 0);
+    EXPECT_FALSE(same.bFullRedraw);
+    EXPECT_EQ(same.dirtyBegin, same.dirtyEnd);
+
+    // 向下滚动一个可视行：平移后只有新露出的最后一行不同
+    std::vector<uint64_t> down = { 0, 0, 2, 3, 0, 4 };
+    GutterUpdate scroll = PlanGutterLabelUpdate(prev, true, down, 1);
+    EXPECT_EQ(1, scroll.shiftRows);
+    EXPECT_EQ(5u, scroll.dirtyBegin);
+    EXPECT_EQ(6u, scroll.dirtyEnd);
+
+    // 第 1 行变短（后台重新折行）：其后的行号上移，猜测的平移量不对也能逐行找出
+    std::vector<uint64_t> reflowed = { 1, 0, 2, 3, 0, 4 };
+    GutterUpdate edit = PlanGutterLabelUpdate(prev, true, reflowed, 0);
+    EXPECT_FALSE(edit.bFullRedraw);
+    EXPECT_EQ(2u, edit.dirtyBegin);
+    EXPECT_EQ(6u, edit.dirtyEnd);
+}
+
+TEST(LineNumberGutterTest, FormatDecimal)
+{
+    char buf[20];
+    EXPECT_EQ(1u, FormatDecimal(0, buf));
+    EXPECT_EQ('0', buf[0]);
+    EXPECT_EQ(5u, FormatDecimal(12345, buf));
+    EXPECT_EQ(std::string("12345"), std::string(buf, 5));
+    EXPECT_EQ(20u, GetDecimalDigitCount(UINT64_MAX));
+    EXPECT_EQ(3u, GetDecimalDigitCount(999));
+    EXPECT_EQ(4u, GetDecimalDigitCount(1000));
+}
+
+TEST(LineNumberGutterTest, PaintStats)
+{
+    PaintStats stats;
+    stats.AddFrame(100.0, true);
+    stats.AddFrame(20.0, false);
+    stats.AddFrame(30.0, false);
+    EXPECT_EQ(3u, stats.frames);
+    EXPECT_EQ(1u, stats.fullFrames);
+    EXPECT_DOUBLE_EQ(30.0, stats.lastMicros);
+    EXPECT_DOUBLE_EQ(100.0, stats.maxMicros);
+    EXPECT_DOUBLE_EQ(50.0, stats.GetAverageMicros());
+    stats.Reset();
+    EXPECT_EQ(0u, stats.frames);
+    EXPECT_DOUBLE_EQ(0.0, stats.GetAverageMicros());
+}
+
+// ============ 编辑引起的行数变化 ============
+
+namespace
+{
+    EditLineDelta Delta(const std::wstring& before, const std::wstring& after, size_t caret)
+    {
+        return CountEditLineDelta(before.data(), before.size(), after.data(), after.size(), caret);
+    }
+
+    uint64_t LineCountOf(const std::wstring& text)
+    {
+        return static_cast<uint64_t>(std::count(text.begin(), text.end(), L'\n')) + 1;
+    }
+}
+
+TEST(LineNumberGutterTest, EditLineDelta_InsertAndDelete)
+{
+    std::wstring before = L"one\r\ntwo\r\nthree";
+
+    // 输入回车：光标在插入内容之后
+    std::wstring typed = L"one\r\ntw\r\no\r\nthree";
+    EditLineDelta enter = Delta(before, typed, 9);
+    EXPECT_EQ(0u, enter.removedLines);
+    EXPECT_EQ(1u, enter.insertedLines);
+
+    // 退格删掉换行：光标在删除处
+    std::wstring joined = L"onetwo\r\nthree";
+    EditLineDelta join = Delta(before, joined, 3);
+    EXPECT_EQ(1u, join.removedLines);
+    EXPECT_EQ(0u, join.insertedLines);
+
+    // 普通字符
+    EditLineDelta plain = Delta(before, L"one\r\ntwo!\r\nthree", 9);
+    EXPECT_EQ(0u, plain.removedLines);
+    EXPECT_EQ(0u, plain.insertedLines);
+}
+
+TEST(LineNumberGutterTest, EditLineDelta_ReplaceSelectionFallsBackToDiff)
+{
+    // 选中 "two\r\nthree" 后粘贴两行：长度变短且光标不在删除处
+    std::wstring before = L"one\r\ntwo\r\nthree";
+    std::wstring after = L"one\r\nA\r\nB\r\n";
+    EditLineDelta delta = Delta(before, after, after.size());
+    EXPECT_EQ(LineCountOf(after), LineCountOf(before) + delta.insertedLines - delta.removedLines);
+
+    // 光标位置不可信时也不会算错
+    EditLineDelta wrongCaret = Delta(before, after, 0);
+    EXPECT_EQ(LineCountOf(after), LineCountOf(before) + wrongCaret.insertedLines - wrongCaret.removedLines);
+}
+
+TEST(LineNumberGutterTest, EditLineDelta_RandomEditsMatchLineCount)
+{
+    std::mt19937 rng(35);
+    std::wstring text = L"first\nsecond\n";
+    GutterLineTracker tracker;
+    tracker.Reset(LineCountOf(text));
+
+    for (int i = 0; i < 2000; i++)
+    {
+        size_t start = rng() % (text.size() + 1);
+        size_t removed = (std::min)(static_cast<size_t>(rng() % 6), text.size() - start);
+        std::wstring inserted;
+        size_t insertLen = rng() % 6;
+        for (size_t k = 0; k < insertLen; k++)
+            inserted += (rng() % 3 == 0) ? L'\n' : static_cast<wchar_t>(L'a' + rng() % 3);
+
+        std::wstring before = text;
+        text.replace(start, removed, inserted);
+        tracker.ApplyEdit(Delta(before, text, start + inserted.size()));
+        ASSERT_EQ(LineCountOf(text), tracker.GetLineCount()) << "edit " << i;
+    }
+}
+
+// 由撤销增量统计行数变化：与逐字比较得到的结果一致
+TEST(LineNumberGutterTest, EditLineDelta_FromTextDeltaMatchesLineCount)
+{
+    std::mt19937 rng(36);
+    std::u16string text = u"first\r\nsecond\r\n";
+    GutterLineTracker tracker;
+    tracker.Reset(static_cast<uint64_t>(std::count(text.begin(), text.end(), u'\n')) + 1);
+
+    for (int i = 0; i < 2000; i++)
+    {
+        size_t start = rng() % (text.size() + 1);
+        size_t removed = (std::min)(static_cast<size_t>(rng() % 6), text.size() - start);
+        std::u16string inserted;
+        size_t insertLen = rng() % 6;
+        for (size_t k = 0; k < insertLen; k++)
+            inserted += (rng() % 3 == 0) ? u'\n' : static_cast<char16_t>(u'a' + rng() % 3);
+
+        std::u16string before = text;
+        text.replace(start, removed, inserted);
+        TextDelta delta = MakeTextDelta(before.data(), before.size(), text.data(), text.size(),
+            start + inserted.size());
+        tracker.ApplyEdit(CountDeltaLines(delta));
+        ASSERT_EQ(static_cast<uint64_t>(std::count(text.begin(), text.end(), u'\n')) + 1,
+            tracker.GetLineCount()) << "edit " << i;
+    }
+}
+
+TEST(LineNumberGutterTest, LineTracker_ReportsDigitChangesOnly)
+{
+    GutterLineTracker tracker;
+    tracker.Reset(9998);
+    EXPECT_EQ(4u, tracker.GetDigits());
+
+    EXPECT_FALSE(tracker.ApplyEdit({ 0, 1 }));     // 9999
+    EXPECT_TRUE(tracker.ApplyEdit({ 0, 1 }));      // 10000
+    EXPECT_EQ(5u, tracker.GetDigits());
+    EXPECT_FALSE(tracker.ApplyEdit({ 0, 0 }));
+    EXPECT_TRUE(tracker.ApplyEdit({ 1, 0 }));      // 9999
+    EXPECT_EQ(2u, tracker.GetWidthChangeCount());
+    EXPECT_EQ(4u, tracker.GetEditCount());
+
+    // 少于 1000 行时仍按 4 位
+    EXPECT_FALSE(tracker.SetLineCount(1));
+    EXPECT_EQ(4u, tracker.GetDigits());
+}
+
+// 连续输入 10 万个字符（每 8 个字符一个回车，文档增长到 12500 行，越过 9999 行），
+// 光标始终在最后一行并自动滚动：统计行号区的重画情况
+TEST(LineNumberGutterTest, Stress_Typing100kCharacters)
+{
+    const size_t rows = 40;
+    const size_t typed = 100000;
+    const int digitWidth = 8;
+
+    GutterLineTracker tracker;
+    tracker.Reset(1);
+    GutterFrame frame = { 0, 1, rows, digitWidth * GUTTER_MIN_DIGITS + 20, 16 };
+    bool bFrameValid = false;
+
+    uint64_t fullRedraws = 0;
+    uint64_t idleFrames = 0;
+    uint64_t rowsRedrawn = 0;
+    uint64_t newlines = 0;
+
+    for (size_t i = 0; i < typed; i++)
+    {
+        bool bNewline = (i % 8 == 7);
+        newlines += bNewline ? 1 : 0;
+        EditLineDelta delta = { 0, bNewline ? 1u : 0u };
+        bool bDigitsChanged = tracker.ApplyEdit(delta);
+
+        uint64_t caretLine = tracker.GetLineCount() - 1;
+        GutterFrame next = frame;
+        next.lineCount = tracker.GetLineCount();
+        next.firstLine = caretLine >= rows ? caretLine - rows + 1 : 0;
+        if (bDigitsChanged)
+            next.width = digitWidth * static_cast<int>(tracker.GetDigits()) + 20;
+
+        GutterUpdate update = PlanGutterUpdate(frame, bFrameValid, next);
+        if (update.bFullRedraw)
+        {
+            fullRedraws++;
+            rowsRedrawn += rows;
+        }
+        else if (update.shiftRows == 0 && update.dirtyBegin == update.dirtyEnd)
+        {
+            idleFrames++;
+        }
+        else
+        {
+            // 每个回车只重画新出现的一行
+            ASSERT_EQ(1u, update.dirtyEnd - update.dirtyBegin) << "keystroke " << i;
+            rowsRedrawn += update.dirtyEnd - update.dirtyBegin;
+        }
+        frame = next;
+        bFrameValid = true;
+    }
+
+    EXPECT_EQ(12500u, newlines);
+    EXPECT_EQ(12501u, tracker.GetLineCount());
+    EXPECT_EQ(1u, tracker.GetWidthChangeCount());       // 9999 -> 10000 行
+    EXPECT_EQ(2u, fullRedraws);                         // 第一帧和宽度变化各一次
+    EXPECT_EQ(typed - newlines - 1, idleFrames);        // 普通字符不触发任何重画
+    EXPECT_LE(rowsRedrawn, newlines + 2 * rows);
+}
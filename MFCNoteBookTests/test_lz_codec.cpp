@@ -0,0 +1,99 @@
+﻿// test_lz_codec.cpp - LZ 压缩测试
+#include "pch.h"
+#include "../MFCNoteBook/LzCodec.h"
+
+#include <random>
+
+using namespace TestableLogic;
+
+namespace
+{
+    std::vector<uint8_t> RoundTrip(const std::vector<uint8_t>& raw, size_t* pPacked = nullptr)
+    {
+        std::vector<uint8_t> packed;
+        LzCompress(raw.data(), raw.size(), packed);
+        if (pPacked)
+            *pPacked = packed.size();
+        std::vector<uint8_t> out;
+        EXPECT_TRUE(LzDecompress(packed.data(), packed.size(), raw.size(), out));
+        return out;
+    }
+
+    std::vector<uint8_t> Bytes(const char* text)
+    {
+        return std::vector<uint8_t>(text, text + strlen(text));
+    }
+}
+
+TEST(LzCodecTest, EmptyAndShortInput)
+{
+    EXPECT_EQ(std::vector<uint8_t>(), RoundTrip(std::vector<uint8_t>()));
+    EXPECT_EQ(Bytes("a"), RoundTrip(Bytes("a")));
+    EXPECT_EQ(Bytes("abcdefghi"), RoundTrip(Bytes("abcdefghi")));
+}
+
+TEST(LzCodecTest, RepetitiveTextShrinks)
+{
+    std::vector<uint8_t> raw;
+    for (int i = 0; i < 1000; i++)
+    {
+        std::vector<uint8_t> line = Bytes("the quick brown fox jumps over the lazy dog\r\n");
+        raw.insert(raw.end(), line.begin(), line.end());
+    }
+    size_t packed = 0;
+    EXPECT_EQ(raw, RoundTrip(raw, &packed));
+    EXPECT_LT(packed, raw.size() / 20);
+}
+
+TEST(LzCodecTest, OverlappingMatchAndLongRuns)
+{
+    // 一长串相同字节：偏移 1、长度远超 15，需要扩展长度字节
+    std::vector<uint8_t> raw(100000, 'x');
+    raw[0] = 'y';
+    size_t packed = 0;
+    EXPECT_EQ(raw, RoundTrip(raw, &packed));
+    EXPECT_LT(packed, 1000u);
+}
+
+TEST(LzCodecTest, RandomDataRoundTrips)
+{
+    std::mt19937 rng(42);
+    for (size_t len : { 5u, 16u, 300u, 70000u, 200000u })
+    {
+        // 随机字节夹杂从前文复制的片段（包括超过 64KB 偏移的）
+        std::vector<uint8_t> raw;
+        while (raw.size() < len)
+        {
+            if (raw.size() > 8 && rng() % 3 == 0)
+            {
+                size_t from = rng() % raw.size();
+                size_t n = (std::min)(static_cast<size_t>(rng() % 300), raw.size() - from);
+                std::vector<uint8_t> copy(raw.begin() + from, raw.begin() + from + n);
+                raw.insert(raw.end(), copy.begin(), copy.end());
+            }
+            else
+            {
+                raw.push_back(static_cast<uint8_t>(rng()));
+            }
+        }
+        raw.resize(len);
+        size_t packed = 0;
+        EXPECT_EQ(raw, RoundTrip(raw, &packed)) << len;
+        EXPECT_LE(packed, len + len / 255 + 16) << len;
+    }
+}
+
+TEST(LzCodecTest, RejectsCorruptInput)
+{
+    std::vector<uint8_t> raw = Bytes("abcdabcdabcdabcdabcdabcdabcd");
+    std::vector<uint8_t> packed;
+    LzCompress(raw.data(), raw.size(), packed);
+
+    std::vector<uint8_t> out;
+    EXPECT_FALSE(LzDecompress(packed.data(), packed.size(), raw.size() + 1, out));
+    EXPECT_FALSE(LzDecompress(packed.data(), packed.size() - 1, raw.size(), out));
+
+    // 偏移超出已解出的数据
+    std::vector<uint8_t> bad = { 0x10, 'a', 0x09, 0x00 };
+    EXPECT_FALSE(LzDecompress(bad.data(), bad.size(), 100, out));
+}
@@ -0,0 +1,194 @@
+﻿// test_paste_pipeline.cpp - 大段粘贴测试
+#include "pch.h"
+#include "../MFCNoteBook/PastePipeline.h"
+#include "../MFCNoteBook/TextCodec.h"
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 混合换行、中文和代理对，长度超过若干个分块
+    std::u16string MakeMixedText(size_t lines)
+    {
+        static const char16_t* const endings[] = { u"\r\n", u"\n", u"\r" };
+        std::u16string text;
+        for (size_t i = 0; i < lines; i++)
+        {
+            text += u"第 ";
+            text.push_back(static_cast<char16_t>(u'0' + i % 10));
+            text += u" 行 \U0001F600 paste ";
+            text += endings[i % 3];
+        }
+        return text;
+    }
+
+    // 等后台线程的完成回调
+    struct DoneSignal
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool bDone = false;
+
+        void Set()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bDone = true;
+            cv.notify_all();
+        }
+
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return bDone; });
+        }
+    };
+}
+
+// ============ 读取剪贴板数据 ============
+
+TEST(PastePipelineTest, ReadStopsAtTerminator)
+{
+    std::u16string data = u"abc";
+    data.push_back(u'\0');
+    data += u"garbage";
+
+    std::u16string text;
+    EXPECT_EQ(3u, ReadTerminatedText(data.data(), data.size(), text));
+    EXPECT_EQ(u"abc", text);
+}
+
+TEST(PastePipelineTest, ReadUnterminatedStaysInBounds)
+{
+    // 没有 NUL 时复制到缓冲区末尾为止，跨越多个分块
+    std::u16string data(PASTE_CHUNK_UNITS * 2 + 17, u'x');
+    std::u16string text;
+    EXPECT_EQ(data.size(), ReadTerminatedText(data.data(), data.size(), text));
+    EXPECT_EQ(data, text);
+
+    EXPECT_EQ(0u, ReadTerminatedText(nullptr, 10, text));
+    EXPECT_TRUE(text.empty());
+}
+
+// ============ 准备 ============
+
+TEST(PastePipelineTest, Utf16MatchesWholeConversion)
+{
+    std::u16string text = MakeMixedText(20000);
+    ASSERT_GT(text.size(), static_cast<size_t>(PASTE_CHUNK_UNITS) * 3);
+
+    PreparedPaste paste;
+    ASSERT_TRUE(PreparePaste(text.data(), text.size(), LineEnding::CrLf, PasteTarget::Utf16, paste));
+    EXPECT_EQ(ConvertLineEndingsString(text.data(), text.size(), LineEnding::CrLf), paste.text);
+    EXPECT_EQ(20000u, paste.lineBreaks);
+    EXPECT_TRUE(paste.utf8.empty());
+}
+
+TEST(PastePipelineTest, Utf8MatchesWholeConversion)
+{
+    std::u16string text = MakeMixedText(20000);
+    std::u16string converted = ConvertLineEndingsString(text.data(), text.size(), LineEnding::Lf);
+
+    PreparedPaste paste;
+    ASSERT_TRUE(PreparePaste(text.data(), text.size(), LineEnding::Lf, PasteTarget::Utf8, paste));
+    EXPECT_EQ(Utf16ToUtf8String(converted.data(), converted.size()), paste.utf8);
+    EXPECT_EQ(20000u, paste.lineBreaks);
+    EXPECT_EQ(paste.utf8.size(), paste.index.GetScanned());
+    EXPECT_TRUE(paste.text.empty());
+}
+
+TEST(PastePipelineTest, SurrogatePairAcrossChunkBoundary)
+{
+    // 代理对正好跨在第一块的末尾
+    std::u16string text(PASTE_CHUNK_UNITS - 1, u'a');
+    text += u"\U0001F600tail";
+
+    PreparedPaste paste;
+    ASSERT_TRUE(PreparePaste(text.data(), text.size(), LineEnding::CrLf, PasteTarget::Utf8, paste));
+    EXPECT_EQ(Utf16ToUtf8String(text.data(), text.size()), paste.utf8);
+    EXPECT_EQ(std::string::npos, paste.utf8.find("\xEF\xBF\xBD"));
+}
+
+TEST(PastePipelineTest, CancelledPreparationFails)
+{
+    std::u16string text = MakeMixedText(100);
+    std::atomic<bool> bCancel(true);
+    PreparedPaste paste;
+    EXPECT_FALSE(PreparePaste(text.data(), text.size(), LineEnding::CrLf, PasteTarget::Utf16, paste, &bCancel));
+}
+
+// ============ 插入片段表 ============
+
+TEST(PastePipelineTest, PreparedIndexMatchesScannedInsert)
+{
+    std::u16string text = MakeMixedText(5000);
+    PreparedPaste paste;
+    ASSERT_TRUE(PreparePaste(text.data(), text.size(), LineEnding::Lf, PasteTarget::Utf8, paste));
+
+    std::string original = "first line\nsecond line\n";
+    TextBuffer scanned;
+    TextBuffer indexed;
+    scanned.SetText(original.data(), original.size());
+    indexed.SetText(original.data(), original.size());
+    scanned.Insert(11, paste.utf8.data(), paste.utf8.size());
+    indexed.Insert(11, paste.utf8.data(), paste.utf8.size(), paste.index);
+
+    ASSERT_EQ(scanned.GetLength(), indexed.GetLength());
+    ASSERT_EQ(scanned.GetLineCount(), indexed.GetLineCount());
+    EXPECT_EQ(original.size() + paste.utf8.size(), indexed.GetLength());
+    for (size_t line = 0; line < indexed.GetLineCount(); line += 97)
+    {
+        EXPECT_EQ(scanned.GetLineStart(line), indexed.GetLineStart(line));
+        EXPECT_EQ(scanned.GetLineEnd(line), indexed.GetLineEnd(line));
+    }
+    EXPECT_EQ(scanned.GetLineFromOffset(indexed.GetLength() / 2), indexed.GetLineFromOffset(indexed.GetLength() / 2));
+
+    // 之后的普通输入仍在同一个索引上扫描
+    indexed.Insert(indexed.GetLength(), "x\ny", 3);
+    scanned.Insert(scanned.GetLength(), "x\ny", 3);
+    EXPECT_EQ(scanned.GetLineCount(), indexed.GetLineCount());
+    EXPECT_EQ(scanned.GetLineStart(indexed.GetLineCount() - 1), indexed.GetLineStart(indexed.GetLineCount() - 1));
+}
+
+// ============ 后台准备 ============
+
+TEST(PasteJobTest, PreparesInBackground)
+{
+    std::u16string text = MakeMixedText(3000);
+    std::u16string expected = ConvertLineEndingsString(text.data(), text.size(), LineEnding::CrLf);
+
+    DoneSignal done;
+    PasteJob job;
+    PreparedPaste paste;
+    EXPECT_FALSE(job.TakeResult(paste));
+    ASSERT_TRUE(job.Start(std::move(text), LineEnding::CrLf, PasteTarget::Utf16, [&done] { done.Set(); }));
+    EXPECT_TRUE(job.IsBusy());
+    EXPECT_FALSE(job.Start(u"again", LineEnding::CrLf, PasteTarget::Utf16, nullptr));
+
+    done.Wait();
+    ASSERT_TRUE(job.TakeResult(paste));
+    EXPECT_EQ(expected, paste.text);
+    EXPECT_FALSE(job.IsBusy());
+    EXPECT_FALSE(job.TakeResult(paste));
+}
+
+TEST(PasteJobTest, CancelDiscardsResult)
+{
+    PasteJob job;
+    ASSERT_TRUE(job.Start(MakeMixedText(50000), LineEnding::Lf, PasteTarget::Utf8, nullptr));
+    job.Cancel();
+    EXPECT_FALSE(job.IsBusy());
+
+    PreparedPaste paste;
+    EXPECT_FALSE(job.TakeResult(paste));
+
+    // 取消后可以重新开始
+    DoneSignal done;
+    ASSERT_TRUE(job.Start(u"a\r\nb", LineEnding::Lf, PasteTarget::Utf8, [&done] { done.Set(); }));
+    done.Wait();
+    ASSERT_TRUE(job.TakeResult(paste));
+    EXPECT_EQ("a\nb", paste.utf8);
+    EXPECT_EQ(1u, paste.lineBreaks);
+}
@@ -0,0 +1,331 @@
+﻿// test_recovery.cpp - 崩溃恢复快照测试
+#include "pch.h"
+#include "../MFCNoteBook/RecoveryFile.h"
+#include "../MFCNoteBook/RecoveryService.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // TempDir 末尾带分隔符，服务自己加分隔符
+    std::string GetTempDir()
+    {
+        std::string dir = ::testing::TempDir();
+        if (!dir.empty() && (dir.back() == '/' || dir.back() == '\\'))
+            dir.pop_back();
+        return dir;
+    }
+
+    std::vector<uint8_t> ReadFile(const std::string& path)
+    {
+        std::vector<uint8_t> data;
+        FileUtil::ReadAll(path, data);
+        return data;
+    }
+
+    // 模拟编辑器：修改文本并把增量交给服务
+    struct Editor
+    {
+        std::u16string text;
+        RecoveryService* pService;
+        uint32_t docId;
+
+        void Type(size_t pos, const std::u16string& inserted, size_t removed = 0)
+        {
+            std::u16string before = text;
+            text.replace(pos, removed, inserted);
+            pService->RecordEdit(docId, MakeTextDelta(before.data(), before.size(), text.data(), text.size(),
+                pos + inserted.size()));
+        }
+
+        void Autosave(const std::string& docPath = "note.txt", const UndoJournalCipher* pCipher = nullptr)
+        {
+            std::u16string snapshot = text;
+            pService->Autosave(docId, docPath, text.size(),
+                [snapshot](std::u16string& out) { out = snapshot; }, pCipher);
+        }
+    };
+
+    UndoJournalCipher MakeXorCipher(uint8_t key)
+    {
+        UndoJournalCipher cipher;
+        cipher.encrypt = [key](const std::vector<uint8_t>& plain, std::vector<uint8_t>& out)
+        {
+            out.clear();
+            for (uint8_t b : plain)
+                out.push_back(static_cast<uint8_t>(b ^ key));
+            return true;
+        };
+        cipher.decrypt = [key](const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+        {
+            out.clear();
+            for (uint8_t b : in)
+                out.push_back(static_cast<uint8_t>(b ^ key));
+            return true;
+        };
+        cipher.keyCheck = 0x2000 + key;
+        return cipher;
+    }
+}
+
+// ============ 快照文件格式 ============
+
+TEST(RecoveryFileTest, BaseAndEditsReplay)
+{
+    std::u16string text = u"第一行\r\nsecond line\r\n";
+    std::vector<uint8_t> data;
+    BuildRecoveryHeader("C:\\notes\\a.txt", nullptr, data);
+    ASSERT_TRUE(AppendRecoveryBase(text.data(), text.size(), nullptr, data));
+
+    std::vector<TextDelta> edits;
+    edits.push_back({ 0, u"", u">> " });
+    edits.push_back({ 3, u"第一", u"首" });
+    ASSERT_TRUE(AppendRecoveryEdits(edits, nullptr, data));
+    edits.assign(1, { 0, u">> ", u"" });
+    ASSERT_TRUE(AppendRecoveryEdits(edits, nullptr, data));
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+    EXPECT_EQ("C:\\notes\\a.txt", doc.docPath);
+    EXPECT_FALSE(doc.bEncrypted);
+    EXPECT_EQ(u"首行\r\nsecond line\r\n", doc.text);
+    EXPECT_EQ(3u, doc.editCount);
+    EXPECT_FALSE(doc.bTruncated);
+}
+
+TEST(RecoveryFileTest, RepetitiveBaseIsCompressed)
+{
+    std::u16string text;
+    for (int i = 0; i < 2000; i++)
+        text += u"the same line again\r\n";
+
+    std::vector<uint8_t> data;
+    BuildRecoveryHeader("", nullptr, data);
+    ASSERT_TRUE(AppendRecoveryBase(text.data(), text.size(), nullptr, data));
+    EXPECT_LT(data.size(), text.size() * sizeof(char16_t) / 4);
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+    EXPECT_TRUE(doc.docPath.empty());
+    EXPECT_EQ(text, doc.text);
+}
+
+TEST(RecoveryFileTest, TornTailIsIgnored)
+{
+    std::u16string text = u"abc";
+    std::vector<uint8_t> data;
+    BuildRecoveryHeader("a.txt", nullptr, data);
+    ASSERT_TRUE(AppendRecoveryBase(text.data(), text.size(), nullptr, data));
+    std::vector<TextDelta> edits(1, TextDelta{ 3, u"", u"def" });
+    ASSERT_TRUE(AppendRecoveryEdits(edits, nullptr, data));
+    size_t complete = data.size();
+    edits.assign(1, TextDelta{ 6, u"", u"ghi" });
+    ASSERT_TRUE(AppendRecoveryEdits(edits, nullptr, data));
+
+    // 崩溃时最后一条只写了一部分
+    for (size_t cut = complete + 1; cut < data.size(); cut++)
+    {
+        RecoveredDocument doc;
+        ASSERT_TRUE(ParseRecoveryFile(data.data(), cut, nullptr, doc));
+        EXPECT_EQ(u"abcdef", doc.text);
+        EXPECT_TRUE(doc.bTruncated);
+    }
+
+    // 损坏的记录及其后的记录都不重放
+    data[complete + sizeof(RecoveryRecordHeader)] ^= 0xFF;
+    RecoveredDocument doc;
+    ASSERT_TRUE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+    EXPECT_EQ(u"abcdef", doc.text);
+    EXPECT_TRUE(doc.bTruncated);
+}
+
+TEST(RecoveryFileTest, MissingBaseIsInvalid)
+{
+    std::vector<uint8_t> data;
+    BuildRecoveryHeader("a.txt", nullptr, data);
+
+    RecoveredDocument doc;
+    EXPECT_FALSE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+    data.resize(10);
+    EXPECT_FALSE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+}
+
+TEST(RecoveryFileTest, EncryptedSnapshotNeedsSameKey)
+{
+    UndoJournalCipher cipher = MakeXorCipher(0x5A);
+    std::u16string text = u"secret text secret text";
+    std::vector<uint8_t> data;
+    BuildRecoveryHeader("a.mynote", &cipher, data);
+    ASSERT_TRUE(AppendRecoveryBase(text.data(), text.size(), &cipher, data));
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(ParseRecoveryFile(data.data(), data.size(), &cipher, doc));
+    EXPECT_TRUE(doc.bEncrypted);
+    EXPECT_EQ(text, doc.text);
+
+    UndoJournalCipher other = MakeXorCipher(0x33);
+    EXPECT_FALSE(ParseRecoveryFile(data.data(), data.size(), &other, doc));
+    EXPECT_FALSE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+}
+
+// ============ 后台自动保存 ============
+
+TEST(RecoveryServiceTest, AppendsOnlyEditsAfterBase)
+{
+    RecoveryService service;
+    service.Start(GetTempDir(), "append");
+    Editor ed = { u"", &service, 1 };
+    std::string path = service.GetFilePath(1);
+
+    ed.Type(0, u"hello world, this is a long enough first draft");
+    ed.Autosave();
+    service.Flush();
+    EXPECT_EQ(1u, service.GetStats().baseCount);
+    size_t baseSize = ReadFile(path).size();
+
+    ed.Type(5, u",");
+    ed.Type(ed.text.size(), u"!");
+    ed.Autosave();
+    service.Flush();
+    RecoveryStats stats = service.GetStats();
+    EXPECT_EQ(1u, stats.baseCount);
+    EXPECT_EQ(1u, stats.appendCount);
+    EXPECT_EQ(2u, stats.editCount);
+
+    // 追加的只是两条增量，与全文长度无关
+    size_t appended = ReadFile(path).size() - baseSize;
+    EXPECT_LT(appended, 64u);
+
+    // 没有新的编辑时不写
+    ed.Autosave();
+    service.Flush();
+    EXPECT_EQ(1u, service.GetStats().appendCount);
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(LoadRecoveryFile(path, nullptr, doc));
+    EXPECT_EQ("note.txt", doc.docPath);
+    EXPECT_EQ(ed.text, doc.text);
+
+    service.Discard(1);
+    service.Flush();
+    EXPECT_FALSE(FileUtil::Exists(path));
+}
+
+TEST(RecoveryServiceTest, RebasesWhenEditsOutgrowText)
+{
+    RecoveryService service;
+    service.Start(GetTempDir(), "rebase");
+    Editor ed = { u"", &service, 2 };
+
+    ed.Type(0, u"short");
+    ed.Autosave();
+
+    // 反复整段替换：增量累计超过全文后改写基准
+    for (int i = 0; i < 5; i++)
+    {
+        ed.Type(0, i % 2 ? u"short" : u"longer", ed.text.size());
+        ed.Autosave();
+    }
+    service.Flush();
+    RecoveryStats stats = service.GetStats();
+    EXPECT_GT(stats.baseCount, 1u);
+    EXPECT_EQ(6u, stats.baseCount + stats.appendCount);
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(LoadRecoveryFile(service.GetFilePath(2), nullptr, doc));
+    EXPECT_EQ(ed.text, doc.text);
+    service.Discard(2);
+}
+
+TEST(RecoveryServiceTest, PathChangeAndInvalidateRebase)
+{
+    RecoveryService service;
+    service.Start(GetTempDir(), "path");
+    Editor ed = { u"", &service, 3 };
+
+    ed.Type(0, u"some text that is not short");
+    ed.Autosave("a.txt");
+    ed.Type(0, u"x");
+    ed.Autosave("b.txt");
+    service.Flush();
+    EXPECT_EQ(2u, service.GetStats().baseCount);
+
+    // 文本整体换掉后之前的增量作废
+    service.Invalidate(3);
+    ed.text = u"reloaded from disk";
+    ed.Autosave("b.txt");
+    service.Flush();
+    EXPECT_EQ(3u, service.GetStats().baseCount);
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(LoadRecoveryFile(service.GetFilePath(3), nullptr, doc));
+    EXPECT_EQ("b.txt", doc.docPath);
+    EXPECT_EQ(u"reloaded from disk", doc.text);
+    service.Discard(3);
+}
+
+TEST(RecoveryServiceTest, EncryptedDocumentsAreWrittenEncrypted)
+{
+    UndoJournalCipher cipher = MakeXorCipher(0x42);
+    RecoveryService service;
+    service.Start(GetTempDir(), "cipher");
+    Editor ed = { u"", &service, 4 };
+
+    ed.Type(0, u"plain words here, plain words here");
+    ed.Autosave("a.mynote", &cipher);
+    ed.Type(0, u"more ");
+    ed.Autosave("a.mynote", &cipher);
+    service.Flush();
+
+    std::vector<uint8_t> data = ReadFile(service.GetFilePath(4));
+    RecoveredDocument doc;
+    EXPECT_FALSE(ParseRecoveryFile(data.data(), data.size(), nullptr, doc));
+    ASSERT_TRUE(ParseRecoveryFile(data.data(), data.size(), &cipher, doc));
+    EXPECT_EQ(ed.text, doc.text);
+    EXPECT_EQ(1u, doc.editCount);
+    service.Discard(4);
+}
+
+TEST(RecoveryServiceTest, TextSourceRunsOffCallerThread)
+{
+    RecoveryService service;
+    service.Start(GetTempDir(), "thread");
+
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> bOffThread(false);
+    service.Autosave(5, "", 3, [&](std::u16string& out)
+    {
+        bOffThread = (std::this_thread::get_id() != caller);
+        out = u"abc";
+    }, nullptr);
+    service.Flush();
+    EXPECT_TRUE(bOffThread);
+
+    service.Discard(5);
+    service.Stop();
+    EXPECT_FALSE(service.IsRunning());
+    EXPECT_FALSE(FileUtil::Exists(service.GetFilePath(5)));
+}
+
+TEST(RecoveryServiceTest, StopWritesQueuedWork)
+{
+    std::string path;
+    {
+        RecoveryService service;
+        service.Start(GetTempDir(), "stop");
+        Editor ed = { u"", &service, 6 };
+        ed.Type(0, u"written before exit");
+        ed.Autosave();
+        path = service.GetFilePath(6);
+        service.Stop();
+    }
+
+    RecoveredDocument doc;
+    ASSERT_TRUE(LoadRecoveryFile(path, nullptr, doc));
+    EXPECT_EQ(u"written before exit", doc.text);
+    FileUtil::Remove(path);
+}
@@ -0,0 +1,121 @@
+﻿// test_session_state.cpp - 会话文件测试
+#include "pch.h"
+#include "../MFCNoteBook/SessionState.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+using namespace TestableLogic;
+
+namespace
+{
+    SessionDocument MakeDoc(const std::string& path, uint32_t flags = SessionDocument_None)
+    {
+        SessionDocument doc;
+        doc.path = path;
+        doc.fileSize = 12345;
+        doc.modifiedTime = 133456789012345678ULL;
+        doc.selStart = 100;
+        doc.selEnd = 120;
+        doc.firstVisibleLine = 42;
+        doc.flags = flags;
+        return doc;
+    }
+}
+
+TEST(SessionStateTest, EncodeDecodeRoundTrip)
+{
+    std::vector<SessionDocument> docs;
+    docs.push_back(MakeDoc("C:\\笔记\\今天.txt", SessionDocument_Active));
+    docs.push_back(MakeDoc("C:\\notes\\b.mynote"));
+    docs.push_back(MakeDoc(""));
+
+    std::vector<uint8_t> data;
+    EncodeSession(docs, data);
+
+    std::vector<SessionDocument> decoded;
+    ASSERT_TRUE(DecodeSession(data.data(), data.size(), decoded));
+    EXPECT_EQ(docs, decoded);
+}
+
+TEST(SessionStateTest, EmptySession)
+{
+    std::vector<uint8_t> data;
+    EncodeSession(std::vector<SessionDocument>(), data);
+
+    std::vector<SessionDocument> decoded(1);
+    ASSERT_TRUE(DecodeSession(data.data(), data.size(), decoded));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST(SessionStateTest, CorruptOrTruncatedIsRejected)
+{
+    std::vector<SessionDocument> docs(1, MakeDoc("a.txt"));
+    std::vector<uint8_t> data;
+    EncodeSession(docs, data);
+
+    std::vector<SessionDocument> decoded;
+    for (size_t cut = 0; cut < data.size(); cut++)
+        EXPECT_FALSE(DecodeSession(data.data(), cut, decoded));
+
+    data.back() ^= 0x01;
+    EXPECT_FALSE(DecodeSession(data.data(), data.size(), decoded));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST(SessionStateTest, SaveAndLoadFile)
+{
+    std::string path = ::testing::TempDir() + "session_test.dat";
+    FileUtil::Remove(path);
+
+    std::vector<SessionDocument> docs;
+    EXPECT_FALSE(LoadSession(path, docs));
+
+    for (int i = 0; i < 80; i++)
+        docs.push_back(MakeDoc("note" + std::to_string(i) + ".txt", i == 0 ? SessionDocument_Active : SessionDocument_None));
+    ASSERT_TRUE(SaveSession(path, docs));
+
+    std::vector<SessionDocument> loaded;
+    ASSERT_TRUE(LoadSession(path, loaded));
+    EXPECT_EQ(docs, loaded);
+    FileUtil::Remove(path);
+}
+
+TEST(SessionStateTest, TooManyDocumentsAreCapped)
+{
+    std::vector<SessionDocument> docs(SESSION_MAX_DOCUMENTS + 10, MakeDoc("x.txt"));
+    std::vector<uint8_t> data;
+    EncodeSession(docs, data);
+
+    std::vector<SessionDocument> decoded;
+    ASSERT_TRUE(DecodeSession(data.data(), data.size(), decoded));
+    EXPECT_EQ(static_cast<size_t>(SESSION_MAX_DOCUMENTS), decoded.size());
+}
+
+// ============ 载入顺序 ============
+
+TEST(SessionStateTest, MaximizedLoadsActiveFirst)
+{
+    std::vector<SessionDocument> docs;
+    docs.push_back(MakeDoc("a", SessionDocument_Active | SessionDocument_Maximized));
+    docs.push_back(MakeDoc("b", SessionDocument_Maximized));
+    docs.push_back(MakeDoc("c", SessionDocument_Maximized));
+
+    std::vector<int> priorities = GetSessionLoadPriorities(docs);
+    ASSERT_EQ(3u, priorities.size());
+    EXPECT_LT(priorities[0], priorities[1]);
+    EXPECT_LT(priorities[1], priorities[2]);
+    EXPECT_GE(priorities[1], 3);
+}
+
+TEST(SessionStateTest, VisibleWindowsBeforeMinimized)
+{
+    std::vector<SessionDocument> docs;
+    docs.push_back(MakeDoc("a", SessionDocument_Active));
+    docs.push_back(MakeDoc("b", SessionDocument_Minimized));
+    docs.push_back(MakeDoc("c"));
+    docs.push_back(MakeDoc("d"));
+
+    std::vector<int> priorities = GetSessionLoadPriorities(docs);
+    EXPECT_LT(priorities[0], priorities[2]);
+    EXPECT_LT(priorities[2], priorities[3]);
+    EXPECT_LT(priorities[3], priorities[1]);
+}
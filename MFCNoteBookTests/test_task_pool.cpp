@@ -0,0 +1,154 @@
+﻿// test_task_pool.cpp - 优先级任务线程池测试
+#include "pch.h"
+#include "../MFCNoteBook/TaskPool.h"
+
+#include <atomic>
+#include <chrono>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 让单线程池的线程停在第一个任务上，之后提交的任务都在排队
+    struct Gate
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool bEntered = false;
+        bool bOpen = false;
+
+        // 在线程池的线程中调用
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            bEntered = true;
+            cv.notify_all();
+            cv.wait(lock, [this] { return bOpen; });
+        }
+
+        // 等线程停到 Wait 上
+        void WaitEntered()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return bEntered; });
+        }
+
+        void Open()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bOpen = true;
+            }
+            cv.notify_all();
+        }
+    };
+}
+
+TEST(TaskPoolTest, RunsByPriorityThenSubmissionOrder)
+{
+    TaskPool pool;
+    pool.Start(1);
+    Gate gate;
+    pool.Post(0, [&] { gate.Wait(); });
+    gate.WaitEntered();
+
+    std::mutex mutex;
+    std::vector<int> order;
+    auto record = [&](int n) { return [&, n] { std::lock_guard<std::mutex> lock(mutex); order.push_back(n); }; };
+    pool.Post(5, record(1));
+    pool.Post(1, record(2));
+    pool.Post(5, record(3));
+    pool.Post(0, record(4));
+
+    gate.Open();
+    pool.WaitIdle();
+    EXPECT_EQ((std::vector<int>{ 4, 2, 1, 3 }), order);
+}
+
+TEST(TaskPoolTest, PromoteMovesPendingTaskToFront)
+{
+    TaskPool pool;
+    pool.Start(1);
+    Gate gate;
+    pool.Post(0, [&] { gate.Wait(); });
+    gate.WaitEntered();
+
+    std::mutex mutex;
+    std::vector<int> order;
+    auto record = [&](int n) { return [&, n] { std::lock_guard<std::mutex> lock(mutex); order.push_back(n); }; };
+    pool.Post(1, record(1));
+    pool.Post(1, record(2));
+    TaskId last = pool.Post(3, record(3));
+
+    // 提前到与队首相同的优先级时排在它前面
+    EXPECT_TRUE(pool.Promote(last, 1));
+    EXPECT_EQ(3u, pool.GetPendingCount());
+
+    gate.Open();
+    pool.WaitIdle();
+    EXPECT_EQ((std::vector<int>{ 3, 1, 2 }), order);
+    EXPECT_FALSE(pool.Promote(last, 0));
+}
+
+TEST(TaskPoolTest, CancelSkipsPendingTask)
+{
+    TaskPool pool;
+    pool.Start(1);
+    Gate gate;
+    pool.Post(0, [&] { gate.Wait(); });
+    gate.WaitEntered();
+
+    std::atomic<int> ran(0);
+    TaskId id = pool.Post(1, [&] { ran += 1; });
+    pool.Post(1, [&] { ran += 10; });
+    EXPECT_TRUE(pool.Cancel(id));
+    EXPECT_FALSE(pool.Cancel(id));
+
+    gate.Open();
+    pool.WaitIdle();
+    EXPECT_EQ(10, ran);
+}
+
+TEST(TaskPoolTest, RunsTasksInParallel)
+{
+    TaskPool pool;
+    pool.Start(4);
+    ASSERT_EQ(4u, pool.GetThreadCount());
+
+    // 四个任务互相等待，只有同时执行才能全部结束
+    std::atomic<int> arrived(0);
+    std::atomic<int> done(0);
+    for (int i = 0; i < 4; i++)
+    {
+        pool.Post(0, [&]
+        {
+            arrived++;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (arrived < 4 && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+            if (arrived == 4)
+                done++;
+        });
+    }
+    pool.WaitIdle();
+    EXPECT_EQ(4, done);
+}
+
+TEST(TaskPoolTest, StopDropsPendingTasks)
+{
+    TaskPool pool;
+    pool.Start(1);
+    Gate gate;
+    pool.Post(0, [&] { gate.Wait(); });
+    gate.WaitEntered();
+
+    std::atomic<int> ran(0);
+    for (int i = 0; i < 10; i++)
+        pool.Post(1, [&] { ran++; });
+
+    std::thread opener([&] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); gate.Open(); });
+    pool.Stop();
+    opener.join();
+    EXPECT_FALSE(pool.IsRunning());
+    EXPECT_EQ(0, ran);
+}
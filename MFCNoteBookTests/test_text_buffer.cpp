@@ -0,0 +1,315 @@
+﻿// test_text_buffer.cpp - 片段表缓冲区与稀疏行索引测试
+#include "pch.h"
+#include "../MFCNoteBook/TextBuffer.h"
+#include "../MFCNoteBook/SimdSupport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+using namespace TestableLogic;
+
+namespace
+{
+    template <class Fn>
+    void ForEachSimdLevel(Fn fn)
+    {
+        const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::SSSE3, SimdLevel::AVX2 };
+        for (SimdLevel level : levels)
+        {
+            if (level > GetDetectedSimdLevel())
+                break;
+            SetSimdLevelOverride(level);
+            SCOPED_TRACE(GetSimdLevelName(level));
+            fn();
+        }
+        ClearSimdLevelOverride();
+    }
+
+    std::string AllText(const TextBuffer& buffer)
+    {
+        return buffer.GetText(0, buffer.GetLength());
+    }
+
+    // 参考实现：逐行切分
+    std::vector<size_t> ReferenceLineStarts(const std::string& text)
+    {
+        std::vector<size_t> starts(1, 0);
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (text[i] == '\n')
+                starts.push_back(i + 1);
+        }
+        return starts;
+    }
+
+    void ExpectLinesMatch(const TextBuffer& buffer, const std::string& text)
+    {
+        std::vector<size_t> starts = ReferenceLineStarts(text);
+        ASSERT_EQ(starts.size(), buffer.GetLineCount());
+        for (size_t line = 0; line < starts.size(); line++)
+        {
+            ASSERT_EQ(starts[line], buffer.GetLineStart(line)) << "line " << line;
+            size_t end = (line + 1 < starts.size()) ? starts[line + 1] - 1 : text.size();
+            if (end > starts[line] && line + 1 < starts.size() && text[end - 1] == '\r')
+                end--;
+            ASSERT_EQ(end, buffer.GetLineEnd(line)) << "line " << line;
+        }
+    }
+}
+
+// ============ 换行计数与稀疏索引 ============
+
+TEST(TextBufferTest, CountNewlines_MatchesScalar)
+{
+    std::mt19937 rng(7);
+    std::string text(100000, 'a');
+    for (char& c : text)
+    {
+        if (rng() % 13 == 0)
+            c = '\n';
+    }
+    size_t expected = std::count(text.begin(), text.end(), '\n');
+
+    ForEachSimdLevel([&]()
+    {
+        EXPECT_EQ(expected, CountNewlines(text.data(), text.size()));
+        // 非对齐的起点与长度
+        EXPECT_EQ(static_cast<size_t>(std::count(text.begin() + 3, text.end() - 5, '\n')),
+            CountNewlines(text.data() + 3, text.size() - 8));
+    });
+}
+
+TEST(TextBufferTest, CountNewlines_DenseNewlinesNoOverflow)
+{
+    // 全是换行：按字节累加的计数器必须及时归约
+    std::string text(70000, '\n');
+    ForEachSimdLevel([&]()
+    {
+        EXPECT_EQ(text.size(), CountNewlines(text.data(), text.size()));
+    });
+}
+
+TEST(TextBufferTest, GetLongestLineLength)
+{
+    EXPECT_EQ(0u, GetLongestLineLength("", 0));
+    EXPECT_EQ(0u, GetLongestLineLength("\n\n", 2));
+    std::string text = "ab\n" + std::string(5000, 'x') + "\ncd";
+    EXPECT_EQ(5000u, GetLongestLineLength(text.data(), text.size()));
+    // 最后一行没有换行
+    text += std::string(6000, 'y');
+    EXPECT_EQ(6002u, GetLongestLineLength(text.data(), text.size()));
+}
+
+TEST(TextBufferTest, Find_AcrossWindowsAndCase)
+{
+    // 第一处匹配跨过第一个查找窗口的边界
+    std::string text(3 * TEXTBUFFER_SEARCH_WINDOW, 'a');
+    size_t first = TEXTBUFFER_SEARCH_WINDOW - 3;
+    text.replace(first, 6, "Needle");
+    text.replace(text.size() - 6, 6, "NEEDLE");
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+
+    size_t found = 0;
+    ASSERT_TRUE(buffer.Find("Needle", 0, true, found));
+    EXPECT_EQ(first, found);
+    EXPECT_FALSE(buffer.Find("Needle", first + 1, true, found));
+    ASSERT_TRUE(buffer.Find("needle", first + 1, false, found));
+    EXPECT_EQ(text.size() - 6, found);
+    EXPECT_FALSE(buffer.Find("", 0, true, found));
+
+    // 编辑之后跨片段的匹配
+    buffer.Insert(10, "Nee", 3);
+    buffer.Insert(13 + 100, "dle", 3);
+    buffer.Erase(13, 100);
+    ASSERT_TRUE(buffer.Find("Needle", 0, true, found));
+    EXPECT_EQ(10u, found);
+}
+
+TEST(TextBufferTest, SparseLineIndex_FindNthAndCountBefore)
+{
+    std::string text;
+    for (int i = 0; i < 5000; i++)
+        text += "line " + std::to_string(i) + "\n";
+
+    SparseLineIndex index;
+    index.Extend(text.data(), text.size());
+    ASSERT_EQ(5000u, index.GetTotal());
+
+    std::vector<size_t> starts = ReferenceLineStarts(text);
+    for (size_t n = 0; n < 5000; n += 37)
+    {
+        EXPECT_EQ(starts[n + 1] - 1, index.FindNth(text.data(), n));
+        EXPECT_EQ(n, index.CountBefore(text.data(), starts[n]));
+    }
+    EXPECT_EQ(5000u, index.CountBefore(text.data(), text.size()));
+}
+
+// ============ 行查询 ============
+
+TEST(TextBufferTest, AttachOriginal_LineQueries)
+{
+    std::string text = "first\r\nsecond\nthird\r\n\nlast";
+    TextBuffer buffer;
+    buffer.AttachOriginal(text.data(), text.size());
+
+    EXPECT_EQ(text.size(), buffer.GetLength());
+    EXPECT_EQ(5u, buffer.GetLineCount());
+    ExpectLinesMatch(buffer, text);
+    EXPECT_EQ(0u, buffer.GetLineFromOffset(0));
+    EXPECT_EQ(0u, buffer.GetLineFromOffset(6));         // CRLF 中的 LF 仍属于第一行
+    EXPECT_EQ(1u, buffer.GetLineFromOffset(7));
+    EXPECT_EQ(4u, buffer.GetLineFromOffset(text.size()));
+    EXPECT_EQ("second", buffer.GetText(buffer.GetLineStart(1), buffer.GetLineEnd(1)));
+}
+
+TEST(TextBufferTest, EmptyBuffer)
+{
+    TextBuffer buffer;
+    EXPECT_EQ(0u, buffer.GetLength());
+    EXPECT_EQ(1u, buffer.GetLineCount());
+    EXPECT_EQ(0u, buffer.GetLineStart(0));
+    EXPECT_EQ(0u, buffer.GetLineEnd(0));
+    EXPECT_EQ("", AllText(buffer));
+}
+
+TEST(TextBufferTest, CharBoundaries_Utf8AndCrLf)
+{
+    // "a" + "中"(3 字节) + "\r\n" + "😀"(4 字节)
+    std::string text = "a\xE4\xB8\xAD\r\n\xF0\x9F\x98\x80";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+
+    EXPECT_EQ(1u, buffer.NextCharBoundary(0));
+    EXPECT_EQ(4u, buffer.NextCharBoundary(1));
+    EXPECT_EQ(6u, buffer.NextCharBoundary(4));          // CRLF 整体跳过
+    EXPECT_EQ(10u, buffer.NextCharBoundary(6));
+    EXPECT_EQ(10u, buffer.NextCharBoundary(10));
+
+    EXPECT_EQ(6u, buffer.PrevCharBoundary(10));
+    EXPECT_EQ(4u, buffer.PrevCharBoundary(6));
+    EXPECT_EQ(1u, buffer.PrevCharBoundary(4));
+    EXPECT_EQ(0u, buffer.PrevCharBoundary(1));
+    EXPECT_EQ(0u, buffer.PrevCharBoundary(0));
+}
+
+// ============ 编辑 ============
+
+TEST(TextBufferTest, InsertAndErase_AcrossPieces)
+{
+    std::string text = "hello\nworld\n";
+    TextBuffer buffer;
+    buffer.AttachOriginal(text.data(), text.size());
+
+    buffer.Insert(5, ", dear", 6);
+    EXPECT_EQ("hello, dear\nworld\n", AllText(buffer));
+    buffer.Insert(0, ">> ", 3);
+    buffer.Insert(buffer.GetLength(), "end", 3);
+    EXPECT_EQ(">> hello, dear\nworld\nend", AllText(buffer));
+    EXPECT_EQ(3u, buffer.GetLineCount());
+
+    // 跨越多个片段删除
+    buffer.Erase(1, 14);
+    EXPECT_EQ(">world\nend", AllText(buffer));
+    ExpectLinesMatch(buffer, AllText(buffer));
+
+    // 原始内容保持不变
+    EXPECT_EQ("hello\nworld\n", text);
+}
+
+TEST(TextBufferTest, Insert_TypingCoalescesIntoOnePiece)
+{
+    TextBuffer buffer;
+    buffer.SetText("abc", 3);
+    const char* typed = "hello world";
+    for (size_t i = 0; i < strlen(typed); i++)
+        buffer.Insert(1 + i, typed + i, 1);
+
+    EXPECT_EQ("ahello worldbc", AllText(buffer));
+    EXPECT_EQ(3u, buffer.GetPieces().size());
+}
+
+TEST(TextBufferTest, RestorePieces_RestoresSnapshot)
+{
+    TextBuffer buffer;
+    buffer.SetText("one\ntwo\n", 8);
+    TextBuffer::PieceList snapshot = buffer.GetPieces();
+
+    buffer.Erase(0, 4);
+    buffer.Insert(0, "zero\n", 5);
+    EXPECT_EQ("zero\ntwo\n", AllText(buffer));
+
+    buffer.RestorePieces(snapshot);
+    EXPECT_EQ("one\ntwo\n", AllText(buffer));
+    EXPECT_EQ(3u, buffer.GetLineCount());
+}
+
+TEST(TextBufferTest, SequentialLineCache_InvalidatedByEdits)
+{
+    std::string text = "a\nbb\nccc\ndddd\n";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    EXPECT_EQ(5u, buffer.GetLineStart(2));
+    EXPECT_EQ(9u, buffer.GetLineStart(3));
+
+    // 编辑后相邻行的缓存不能沿用旧的行首
+    buffer.Insert(0, "x\n", 2);
+    EXPECT_EQ(7u, buffer.GetLineStart(3));
+    EXPECT_EQ(11u, buffer.GetLineStart(4));
+    EXPECT_EQ(15u, buffer.GetLineEnd(4));
+}
+
+TEST(TextBufferTest, RandomEdits_MatchReference)
+{
+    std::mt19937 rng(2024);
+    std::string reference;
+    for (int i = 0; i < 3000; i++)
+        reference += (rng() % 9 == 0) ? '\n' : static_cast<char>('a' + rng() % 26);
+
+    TextBuffer buffer;
+    buffer.SetText(reference.data(), reference.size());
+
+    const char* samples[] = { "x", "\n", "ab\ncd", "\r\n", "long insert without breaks", "\n\n\n" };
+    for (int step = 0; step < 2000; step++)
+    {
+        size_t pos = rng() % (reference.size() + 1);
+        if (rng() % 3 == 0 && !reference.empty())
+        {
+            size_t len = (std::min)(static_cast<size_t>(rng() % 40), reference.size() - pos);
+            buffer.Erase(pos, len);
+            reference.erase(pos, len);
+        }
+        else
+        {
+            const char* s = samples[rng() % 6];
+            buffer.Insert(pos, s, strlen(s));
+            reference.insert(pos, s);
+        }
+    }
+
+    EXPECT_EQ(reference, AllText(buffer));
+    ExpectLinesMatch(buffer, reference);
+    for (size_t pos = 0; pos <= reference.size(); pos += 97)
+    {
+        size_t expected = std::count(reference.begin(), reference.begin() + pos, '\n');
+        EXPECT_EQ(expected, buffer.GetLineFromOffset(pos));
+    }
+}
+
+TEST(TextBufferTest, LargeDocument_IndexStaysSparse)
+{
+    // 1M 行：检查点数量只与行数/字节数的步长相关，查询结果与参考一致
+    std::string text;
+    text.reserve(16 * 1000000);
+    for (int i = 0; i < 1000000; i++)
+        text += "0123456789abcd\n";
+
+    TextBuffer buffer;
+    buffer.AttachOriginal(text.data(), text.size());
+    EXPECT_EQ(1000001u, buffer.GetLineCount());
+    EXPECT_EQ(15u * 777777, buffer.GetLineStart(777777));
+    EXPECT_EQ(15u * 777777 + 14, buffer.GetLineEnd(777777));
+    EXPECT_EQ(999999u, buffer.GetLineFromOffset(text.size() - 1));
+    EXPECT_EQ(0u, buffer.GetAddBufferSize());
+}
@@ -0,0 +1,524 @@
+﻿// test_text_codec.cpp - UTF-8 校验与转码测试
+#include "pch.h"
+#include "../MFCNoteBook/TextCodec.h"
+#include "../MFCNoteBook/SimdSupport.h"
+
+#include <cstring>
+#include <random>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 依次在每个可用的 SIMD 级别上运行，保证各条路径结果一致
+    template <class Fn>
+    void ForEachSimdLevel(Fn fn)
+    {
+        const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::SSSE3, SimdLevel::AVX2 };
+        for (SimdLevel level : levels)
+        {
+            if (level > GetDetectedSimdLevel())
+                break;
+            SetSimdLevelOverride(level);
+            SCOPED_TRACE(GetSimdLevelName(level));
+            fn();
+        }
+        ClearSimdLevelOverride();
+    }
+
+    std::u16string Decode(const std::string& bytes, Utf8DecodeResult* pResult = nullptr)
+    {
+        return Utf8ToUtf16String(bytes.data(), bytes.size(), pResult);
+    }
+
+    // 独立的参考实现：按码点编码为 UTF-8
+    std::string EncodeCodePoint(uint32_t cp)
+    {
+        std::string s;
+        if (cp < 0x80)
+        {
+            s += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            s += static_cast<char>(0xC0 | (cp >> 6));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            s += static_cast<char>(0xE0 | (cp >> 12));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            s += static_cast<char>(0xF0 | (cp >> 18));
+            s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        return s;
+    }
+
+    // 生成 ASCII/CJK/emoji 混合文本及对应的 UTF-16
+    void MakeMixedText(std::mt19937& rng, size_t count, std::string& utf8, std::u16string& utf16)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t cp;
+            switch (rng() % 6)
+            {
+            case 0: cp = 0x80 + rng() % 0x780; break;           // 2 字节
+            case 1: cp = 0x4E00 + rng() % 0x5200; break;        // CJK
+            case 2: cp = 0x1F300 + rng() % 0x300; break;        // emoji
+            default: cp = 0x20 + rng() % 0x5F; break;           // ASCII
+            }
+            utf8 += EncodeCodePoint(cp);
+            if (cp >= 0x10000)
+            {
+                utf16 += static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10));
+                utf16 += static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            }
+            else
+            {
+                utf16 += static_cast<char16_t>(cp);
+            }
+        }
+    }
+}
+
+// ============ 合法输入 ============
+
+TEST(TextCodecTest, Empty)
+{
+    Utf8DecodeResult result;
+    EXPECT_TRUE(Decode("", &result).empty());
+    EXPECT_EQ(result.invalidCount, 0u);
+    EXPECT_TRUE(ValidateUtf8(nullptr, 0).bValid);
+}
+
+TEST(TextCodecTest, AsciiAllLengths)
+{
+    // 覆盖 SIMD 块边界前后的所有长度
+    ForEachSimdLevel([]()
+        {
+            std::string text;
+            std::u16string expected;
+            for (size_t n = 0; n < 200; n++)
+            {
+                EXPECT_EQ(Decode(text), expected);
+                EXPECT_TRUE(ValidateUtf8(text.data(), text.size()).bValid);
+                char c = static_cast<char>('a' + n % 26);
+                text += c;
+                expected += static_cast<char16_t>(c);
+            }
+        });
+}
+
+TEST(TextCodecTest, MultiByteAndSurrogates)
+{
+    ForEachSimdLevel([]()
+        {
+            // "中文" + U+1F600 + "é"
+            std::string text = "\xE4\xB8\xAD\xE6\x96\x87\xF0\x9F\x98\x80\xC3\xA9";
+            std::u16string expected = u"中文\U0001F600é";
+            EXPECT_EQ(Decode(text), expected);
+            EXPECT_TRUE(ValidateUtf8(text.data(), text.size()).bValid);
+        });
+}
+
+TEST(TextCodecTest, RandomMixedTextMatchesReference)
+{
+    ForEachSimdLevel([]()
+        {
+            std::mt19937 rng(7);
+            for (int round = 0; round < 50; round++)
+            {
+                std::string utf8;
+                std::u16string utf16;
+                MakeMixedText(rng, rng() % 400, utf8, utf16);
+                Utf8DecodeResult result;
+                EXPECT_EQ(Decode(utf8, &result), utf16);
+                EXPECT_EQ(result.invalidCount, 0u);
+                EXPECT_EQ(result.firstErrorOffset, utf8.size());
+                EXPECT_TRUE(ValidateUtf8(utf8.data(), utf8.size()).bValid);
+            }
+        });
+}
+
+// ============ 非法输入 ============
+
+TEST(TextCodecTest, RejectsMalformedSequences)
+{
+    const char* cases[] = {
+        "\xC0\xAF",             // 超长编码
+        "\xE0\x80\xAF",         // 超长编码
+        "\xED\xA0\x80",         // 代理区
+        "\xF4\x90\x80\x80",     // 超过 U+10FFFF
+        "\xF5\x80\x80\x80",     // 非法首字节
+        "\x80",                 // 孤立的后续字节
+        "\xE4\xB8",             // 截断
+        "\xFF"
+    };
+    ForEachSimdLevel([&]()
+        {
+            for (const char* bad : cases)
+            {
+                std::string text = bad;
+                Utf8ValidationResult v = ValidateUtf8(text.data(), text.size());
+                EXPECT_FALSE(v.bValid) << text.size();
+                EXPECT_EQ(v.errorOffset, 0u);
+            }
+        });
+}
+
+TEST(TextCodecTest, ReplacementFollowsMaximalSubpart)
+{
+    // Unicode 标准 3.9 节的示例
+    std::string text = "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64";
+    std::u16string expected = u"a\uFFFD\uFFFD\uFFFDb\uFFFDc\uFFFD\uFFFDd";
+    ForEachSimdLevel([&]()
+        {
+            std::vector<size_t> offsets;
+            std::u16string out(Utf8ToUtf16MaxLength(text.size()), u'\0');
+            Utf8DecodeResult result = Utf8ToUtf16(text.data(), text.size(), &out[0], &offsets);
+            out.resize(result.outputLength);
+            EXPECT_EQ(out, expected);
+            EXPECT_EQ(result.invalidCount, 6u);
+            EXPECT_EQ(result.firstErrorOffset, 1u);
+            EXPECT_EQ(offsets, (std::vector<size_t>{ 1, 4, 6, 8, 10, 11 }));
+        });
+}
+
+TEST(TextCodecTest, ErrorOffsetAcrossBlockBoundaries)
+{
+    // 在 64 字节块边界附近的每个位置放置一个截断的 CJK 字符
+    ForEachSimdLevel([]()
+        {
+            for (size_t pos = 50; pos < 140; pos++)
+            {
+                std::string text(pos, 'x');
+                text += "\xE4\xB8";
+                text += std::string(100, 'y');
+                text += "\xE4\xB8\xAD";
+
+                Utf8ValidationResult v = ValidateUtf8(text.data(), text.size());
+                EXPECT_FALSE(v.bValid);
+                EXPECT_EQ(v.errorOffset, pos);
+
+                Utf8DecodeResult result;
+                std::u16string out = Decode(text, &result);
+                EXPECT_EQ(result.invalidCount, 1u);
+                EXPECT_EQ(result.firstErrorOffset, pos);
+                EXPECT_EQ(out.size(), pos + 1 + 100 + 1);
+                EXPECT_EQ(out[pos], static_cast<char16_t>(UTF16_REPLACEMENT_CHAR));
+                EXPECT_EQ(out.back(), u'中');
+            }
+        });
+}
+
+TEST(TextCodecTest, TruncatedAtEnd)
+{
+    ForEachSimdLevel([]()
+        {
+            for (size_t pos = 60; pos < 70; pos++)
+            {
+                std::string text(pos, 'a');
+                text += "\xF0\x9F\x98";
+                Utf8ValidationResult v = ValidateUtf8(text.data(), text.size());
+                EXPECT_FALSE(v.bValid);
+                EXPECT_EQ(v.errorOffset, pos);
+            }
+        });
+}
+
+TEST(TextCodecTest, RandomCorruptionAgreesAcrossLevels)
+{
+    std::mt19937 rng(11);
+    for (int round = 0; round < 100; round++)
+    {
+        std::string utf8;
+        std::u16string utf16;
+        MakeMixedText(rng, 200, utf8, utf16);
+        for (int k = 0; k < 3; k++)
+            utf8[rng() % utf8.size()] = static_cast<char>(rng());
+
+        SetSimdLevelOverride(SimdLevel::Scalar);
+        std::vector<size_t> refOffsets;
+        std::u16string ref(utf8.size(), u'\0');
+        Utf8DecodeResult refResult = Utf8ToUtf16(utf8.data(), utf8.size(), &ref[0], &refOffsets);
+        ref.resize(refResult.outputLength);
+        Utf8ValidationResult refValid = ValidateUtf8(utf8.data(), utf8.size());
+        EXPECT_EQ(refValid.bValid, refResult.invalidCount == 0);
+        EXPECT_EQ(refValid.errorOffset, refResult.firstErrorOffset);
+
+        ForEachSimdLevel([&]()
+            {
+                std::vector<size_t> offsets;
+                std::u16string out(utf8.size(), u'\0');
+                Utf8DecodeResult result = Utf8ToUtf16(utf8.data(), utf8.size(), &out[0], &offsets);
+                out.resize(result.outputLength);
+                EXPECT_EQ(out, ref);
+                EXPECT_EQ(offsets, refOffsets);
+
+                Utf8ValidationResult v = ValidateUtf8(utf8.data(), utf8.size());
+                EXPECT_EQ(v.bValid, refValid.bValid);
+                EXPECT_EQ(v.errorOffset, refValid.errorOffset);
+            });
+    }
+}
+
+// ============ UTF-16 → UTF-8 ============
+
+namespace
+{
+    std::string Encode(const std::u16string& text, Utf16EncodeResult* pResult = nullptr)
+    {
+        return Utf16ToUtf8String(text.data(), text.size(), pResult);
+    }
+}
+
+TEST(TextCodecTest, Encode_AsciiAllLengths)
+{
+    ForEachSimdLevel([]()
+        {
+            std::u16string text;
+            std::string expected;
+            for (size_t n = 0; n < 200; n++)
+            {
+                EXPECT_EQ(Utf16ToUtf8Length(text.data(), text.size()), expected.size());
+                EXPECT_EQ(Encode(text), expected);
+                char c = static_cast<char>('A' + n % 26);
+                text += static_cast<char16_t>(c);
+                expected += c;
+            }
+        });
+}
+
+TEST(TextCodecTest, Encode_RandomMixedTextMatchesReference)
+{
+    ForEachSimdLevel([]()
+        {
+            std::mt19937 rng(3);
+            for (int round = 0; round < 50; round++)
+            {
+                std::string utf8;
+                std::u16string utf16;
+                MakeMixedText(rng, rng() % 400, utf8, utf16);
+                Utf16EncodeResult result;
+                EXPECT_EQ(Utf16ToUtf8Length(utf16.data(), utf16.size()), utf8.size());
+                EXPECT_EQ(Encode(utf16, &result), utf8);
+                EXPECT_EQ(result.consumed, utf16.size());
+                EXPECT_EQ(result.loneSurrogateCount, 0u);
+            }
+        });
+}
+
+TEST(TextCodecTest, Encode_CjkBlocks)
+{
+    // 连续 CJK 走 3 字节 SIMD 路径，中间穿插 ASCII 和 emoji 打断
+    ForEachSimdLevel([]()
+        {
+            std::string utf8;
+            std::u16string utf16;
+            for (int i = 0; i < 300; i++)
+            {
+                uint32_t cp = (i % 37 == 0) ? 'x' : (i % 53 == 0 ? 0x1F680 : 0x4E00 + i);
+                utf8 += EncodeCodePoint(cp);
+                if (cp >= 0x10000)
+                {
+                    utf16 += static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10));
+                    utf16 += static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+                }
+                else
+                {
+                    utf16 += static_cast<char16_t>(cp);
+                }
+            }
+            EXPECT_EQ(Utf16ToUtf8Length(utf16.data(), utf16.size()), utf8.size());
+            EXPECT_EQ(Encode(utf16), utf8);
+        });
+}
+
+TEST(TextCodecTest, Encode_LoneSurrogatesBecomeReplacement)
+{
+    ForEachSimdLevel([]()
+        {
+            // 孤立高代理、孤立低代理、末尾高代理、颠倒的代理对
+            std::u16string text = u"a";
+            text += static_cast<char16_t>(0xD800);
+            text += u"b";
+            text += static_cast<char16_t>(0xDC00);
+            text += static_cast<char16_t>(0xDC00);
+            text += static_cast<char16_t>(0xD83D);
+            text += std::u16string(40, u'中');
+            text += static_cast<char16_t>(0xD83D);
+
+            const std::string fffd = "\xEF\xBF\xBD";
+            std::string expected = "a" + fffd + "b" + fffd + fffd + fffd;
+            for (int i = 0; i < 40; i++)
+                expected += "\xE4\xB8\xAD";
+            expected += fffd;
+
+            Utf16EncodeResult result;
+            EXPECT_EQ(Utf16ToUtf8Length(text.data(), text.size()), expected.size());
+            EXPECT_EQ(Encode(text, &result), expected);
+            EXPECT_EQ(result.loneSurrogateCount, 5u);
+        });
+}
+
+TEST(TextCodecTest, Encode_ChunkedNeverSplitsCodePoints)
+{
+    std::mt19937 rng(5);
+    std::string utf8;
+    std::u16string utf16;
+    MakeMixedText(rng, 2000, utf8, utf16);
+
+    ForEachSimdLevel([&]()
+        {
+            // 各种小缓冲区大小，拼接结果必须与整体编码一致
+            const size_t sizes[] = { 4, 5, 7, 64, 100, 1000 };
+            for (size_t chunk : sizes)
+            {
+                std::string joined;
+                std::vector<char> buffer(chunk);
+                size_t pos = 0;
+                while (pos < utf16.size())
+                {
+                    Utf16EncodeResult result = Utf16ToUtf8(utf16.data() + pos, utf16.size() - pos, buffer.data(), chunk);
+                    ASSERT_GT(result.consumed, 0u);
+                    joined.append(buffer.data(), result.outputLength);
+                    pos += result.consumed;
+                }
+                EXPECT_EQ(joined, utf8) << chunk;
+            }
+        });
+}
+
+TEST(TextCodecTest, Encode_DecodeRoundTrip)
+{
+    std::mt19937 rng(9);
+    std::string utf8;
+    std::u16string utf16;
+    MakeMixedText(rng, 5000, utf8, utf16);
+    EXPECT_EQ(Decode(Encode(utf16)), utf16);
+}
+
+TEST(TextCodecTest, Encode_LengthOfLargeInput)
+{
+    // 超过 SIMD 计数器的归约周期
+    std::u16string text(1 << 20, u'中');
+    text[12345] = u'a';
+    text[700000] = u'é';
+    ForEachSimdLevel([&]()
+        {
+            EXPECT_EQ(Utf16ToUtf8Length(text.data(), text.size()), ((size_t)1 << 20) * 3 - 2 - 1);
+        });
+}
+
+// ============ UTF-16 字节流 ============
+
+namespace
+{
+    // 参考实现：逐单元按字节序组装
+    std::vector<uint8_t> ToBytes(const std::u16string& text, bool bBigEndian)
+    {
+        std::vector<uint8_t> bytes;
+        for (char16_t c : text)
+        {
+            uint8_t hi = static_cast<uint8_t>(c >> 8);
+            uint8_t lo = static_cast<uint8_t>(c & 0xFF);
+            bytes.push_back(bBigEndian ? hi : lo);
+            bytes.push_back(bBigEndian ? lo : hi);
+        }
+        return bytes;
+    }
+}
+
+TEST(TextCodecTest, Utf16Bytes_AllLengthsBothOrders)
+{
+    // 覆盖 SIMD 块内的各种尾部长度，含嵌入的 NUL
+    std::mt19937 rng(21);
+    std::u16string text;
+    for (int i = 0; i < 100; i++)
+        text += static_cast<char16_t>((i % 7 == 0) ? 0 : rng() & 0xFFFF);
+
+    ForEachSimdLevel([&]()
+        {
+            for (size_t n = 0; n <= text.size(); n++)
+            {
+                std::u16string expected = text.substr(0, n);
+                for (int be = 0; be <= 1; be++)
+                {
+                    std::vector<uint8_t> bytes = ToBytes(expected, be != 0);
+                    EXPECT_EQ(Utf16BytesToString(bytes.data(), bytes.size(), be != 0), expected) << n;
+                }
+            }
+        });
+}
+
+TEST(TextCodecTest, Utf16Bytes_OddLengthEndsWithReplacement)
+{
+    const uint8_t le[] = { 'a', 0, 0, 0, 'b' };
+    const uint8_t be[] = { 0, 'a', 0, 0, 'b' };
+    std::u16string expected = u"a";
+    expected += u'\0';
+    expected += u'\uFFFD';
+
+    EXPECT_EQ(Utf16BytesToUnitsLength(sizeof(le)), 3u);
+    EXPECT_EQ(Utf16BytesToString(le, sizeof(le), false), expected);
+    EXPECT_EQ(Utf16BytesToString(be, sizeof(be), true), expected);
+
+    const uint8_t single[] = { 'x' };
+    EXPECT_EQ(Utf16BytesToString(single, 1, true), std::u16string(1, u'\uFFFD'));
+}
+
+TEST(TextCodecTest, Utf16Bytes_InPlaceLargeBuffer)
+{
+    // 8 MB + 3 字节：原地转换（文件直接读入文档缓冲区后的用法），末尾为奇数字节
+    std::mt19937 rng(22);
+    std::u16string text(4 * 1024 * 1024 + 1, u'\0');
+    for (char16_t& c : text)
+        c = static_cast<char16_t>(rng() & 0xFFFF);
+
+    ForEachSimdLevel([&]()
+        {
+            std::vector<uint8_t> bytes = ToBytes(text, true);
+            bytes.push_back(0x41);
+            std::u16string buffer(Utf16BytesToUnitsLength(bytes.size()), u'\0');
+            memcpy(&buffer[0], bytes.data(), bytes.size());
+
+            size_t units = Utf16BytesToUnits(buffer.data(), bytes.size(), true, &buffer[0]);
+            ASSERT_EQ(units, text.size() + 1);
+            EXPECT_EQ(buffer.compare(0, text.size(), text), 0);
+            EXPECT_EQ(buffer.back(), u'\uFFFD');
+
+            SwapUtf16ByteOrder(&buffer[0], text.size());
+            SwapUtf16ByteOrder(&buffer[0], text.size());
+            EXPECT_EQ(buffer.compare(0, text.size(), text), 0);
+        });
+}
+
+TEST(TextCodecTest, Utf16Bytes_InPlaceDropsBom)
+{
+    // 读入缓冲区的开头是 BOM：转换结果前移一个单元
+    std::mt19937 rng(23);
+    std::u16string text(1000, u'\0');
+    for (char16_t& c : text)
+        c = static_cast<char16_t>(rng() & 0xFFFF);
+
+    ForEachSimdLevel([&]()
+        {
+            for (int be = 0; be <= 1; be++)
+            {
+                std::vector<uint8_t> bytes = ToBytes(u"\uFEFF" + text, be != 0);
+                std::u16string buffer(bytes.size() / 2, u'\0');
+                memcpy(&buffer[0], bytes.data(), bytes.size());
+
+                size_t units = Utf16BytesToUnits(reinterpret_cast<const uint8_t*>(buffer.data()) + 2,
+                    bytes.size() - 2, be != 0, &buffer[0]);
+                ASSERT_EQ(units, text.size());
+                EXPECT_EQ(buffer.compare(0, units, text), 0) << be;
+            }
+        });
+}
@@ -0,0 +1,79 @@
+﻿// test_text_delta.cpp - 文本增量测试
+#include "pch.h"
+#include "../MFCNoteBook/TextDelta.h"
+
+using namespace TestableLogic;
+
+namespace
+{
+    TextDelta Diff(const std::u16string& before, const std::u16string& after, size_t caret)
+    {
+        return MakeTextDelta(before.data(), before.size(), after.data(), after.size(), caret);
+    }
+}
+
+TEST(TextDeltaTest, Typing)
+{
+    TextDelta delta = Diff(u"abc", u"abXc", 3);
+    EXPECT_EQ(2u, delta.pos);
+    EXPECT_EQ(u"", delta.removed);
+    EXPECT_EQ(u"X", delta.inserted);
+}
+
+TEST(TextDeltaTest, TypingRepeatedCharacterUsesCaret)
+{
+    // 在 "aa" 的开头再输入一个 a：按公共前缀会认为插在末尾，按光标才是开头
+    TextDelta delta = Diff(u"aa", u"aaa", 1);
+    EXPECT_EQ(0u, delta.pos);
+    EXPECT_EQ(u"a", delta.inserted);
+}
+
+TEST(TextDeltaTest, DeleteRepeatedCharacterUsesCaret)
+{
+    TextDelta delta = Diff(u"xaay", u"xay", 1);
+    EXPECT_EQ(1u, delta.pos);
+    EXPECT_EQ(u"a", delta.removed);
+    EXPECT_EQ(u"", delta.inserted);
+}
+
+TEST(TextDeltaTest, ReplaceSelection)
+{
+    TextDelta delta = Diff(u"hello world", u"hello there world", 6);
+    std::u16string text = u"hello world";
+    ASSERT_TRUE(ApplyTextDelta(text, delta));
+    EXPECT_EQ(u"hello there world", text);
+    ASSERT_TRUE(RevertTextDelta(text, delta));
+    EXPECT_EQ(u"hello world", text);
+
+    delta = Diff(u"one two three", u"one 2 three", 5);
+    EXPECT_EQ(4u, delta.pos);
+    EXPECT_EQ(u"two", delta.removed);
+    EXPECT_EQ(u"2", delta.inserted);
+}
+
+TEST(TextDeltaTest, ApplyRejectsOutOfRange)
+{
+    TextDelta delta = { 5, u"xyz", u"" };
+    std::u16string text = u"abcdef";
+    EXPECT_FALSE(ApplyTextDelta(text, delta));
+    EXPECT_EQ(u"abcdef", text);
+}
+
+TEST(TextDeltaTest, EncodeDecodeRoundTrip)
+{
+    TextDelta delta = { 300, u"中文\r\n", u"\xD83D\xDE00 ok" };
+    std::vector<uint8_t> bytes;
+    EncodeTextDelta(delta, bytes);
+    // 位置 300 占两字节，两段长度各一字节
+    EXPECT_EQ(2u + 1 + 8 + 1 + 10, bytes.size());
+
+    TextDelta decoded;
+    size_t used = 0;
+    ASSERT_TRUE(DecodeTextDelta(bytes.data(), bytes.size(), decoded, &used));
+    EXPECT_EQ(bytes.size(), used);
+    EXPECT_EQ(delta.pos, decoded.pos);
+    EXPECT_EQ(delta.removed, decoded.removed);
+    EXPECT_EQ(delta.inserted, decoded.inserted);
+
+    EXPECT_FALSE(DecodeTextDelta(bytes.data(), bytes.size() - 1, decoded));
+}
@@ -0,0 +1,273 @@
+﻿// test_text_layout.cpp - 等宽网格排版与自绘编辑器模型测试
+#include "pch.h"
+#include "../MFCNoteBook/TextLayout.h"
+#include "../MFCNoteBook/TextEditorModel.h"
+
+using namespace TestableLogic;
+
+namespace
+{
+    size_t Column(const std::u16string& line, size_t index)
+    {
+        return ColumnFromIndex(line.data(), line.size(), index);
+    }
+
+    size_t Index(const std::u16string& line, size_t column)
+    {
+        return IndexFromColumn(line.data(), line.size(), column);
+    }
+
+    std::string AllText(const TextBuffer& buffer)
+    {
+        return buffer.GetText(0, buffer.GetLength());
+    }
+}
+
+// ============ 列宽与列/下标换算 ============
+
+TEST(TextLayoutTest, CodePointColumns)
+{
+    EXPECT_EQ(1, GetCodePointColumns('a'));
+    EXPECT_EQ(2, GetCodePointColumns(0x4E2D));          // 中
+    EXPECT_EQ(2, GetCodePointColumns(0xAC00));          // 가
+    EXPECT_EQ(2, GetCodePointColumns(0xFF21));          // 全角 A
+    EXPECT_EQ(2, GetCodePointColumns(0x1F600));         // 😀
+    EXPECT_EQ(0, GetCodePointColumns(0x0301));          // 组合重音
+}
+
+TEST(TextLayoutTest, ColumnFromIndex_TabsAndWideChars)
+{
+    std::u16string line = u"a\tb中\U0001F600c";
+    EXPECT_EQ(0u, Column(line, 0));
+    EXPECT_EQ(1u, Column(line, 1));
+    EXPECT_EQ(4u, Column(line, 2));                     // 制表位
+    EXPECT_EQ(5u, Column(line, 3));
+    EXPECT_EQ(7u, Column(line, 4));
+    EXPECT_EQ(9u, Column(line, 6));                     // 代理对占 2 个单元、2 列
+    EXPECT_EQ(10u, Column(line, line.size()));
+}
+
+TEST(TextLayoutTest, IndexFromColumn_SnapsToNearestBoundary)
+{
+    std::u16string line = u"ab中\U0001F600";
+    EXPECT_EQ(0u, Index(line, 0));
+    EXPECT_EQ(1u, Index(line, 1));
+    EXPECT_EQ(2u, Index(line, 2));                      // 宽字符左半格
+    EXPECT_EQ(3u, Index(line, 3));                      // 右半格取其后
+    EXPECT_EQ(3u, Index(line, 4));
+    EXPECT_EQ(5u, Index(line, 5));                      // 不会落在代理对中间
+    EXPECT_EQ(line.size(), Index(line, 100));
+}
+
+TEST(TextLayoutTest, GetCellColumns)
+{
+    std::u16string line = u"a\t中\U0001F600";
+    std::vector<int> columns;
+    GetCellColumns(line.data(), line.size(), columns);
+    ASSERT_EQ(5u, columns.size());
+    EXPECT_EQ(1, columns[0]);
+    EXPECT_EQ(3, columns[1]);
+    EXPECT_EQ(2, columns[2]);
+    EXPECT_EQ(2, columns[3]);
+    EXPECT_EQ(0, columns[4]);
+}
+
+TEST(TextLayoutTest, ComputeWrapPoints)
+{
+    std::u16string line = u"hello world foo";
+    std::vector<size_t> points = ComputeWrapPoints(line.data(), line.size(), 8);
+    ASSERT_EQ(3u, points.size());
+    EXPECT_EQ(0u, points[0]);
+    EXPECT_EQ(6u, points[1]);                           // 空白之后断开
+    EXPECT_EQ(12u, points[2]);
+
+    // 没有空白时按字符断开，宽字符不会被拆到两行
+    std::u16string cjk = u"中文测试";
+    points = ComputeWrapPoints(cjk.data(), cjk.size(), 3);
+    ASSERT_EQ(4u, points.size());
+    EXPECT_EQ(3u, points[3]);
+
+    EXPECT_EQ(1u, ComputeWrapPoints(line.data(), line.size(), 0).size());
+}
+
+// ============ 编辑器模型 ============
+
+TEST(TextEditorModelTest, CaretMovement_Utf8AndVertical)
+{
+    std::string text = "ab\xE4\xB8\xAD\r\nx\r\nlonger line";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+
+    model.MoveCaret(CaretMove::LineEnd, false);
+    EXPECT_EQ(5u, model.GetSelection().caret);
+    EXPECT_EQ(4u, model.GetCaretColumn());
+
+    model.MoveCaret(CaretMove::Left, false);
+    EXPECT_EQ(2u, model.GetSelection().caret);          // 整个 "中" 一步跳过
+
+    // 上下移动保持期望列
+    model.MoveCaret(CaretMove::LineEnd, false);
+    model.MoveCaret(CaretMove::Down, false);
+    EXPECT_EQ(1u, model.GetCaretLine());
+    EXPECT_EQ(1u, model.GetCaretColumn());
+    model.MoveCaret(CaretMove::Down, false);
+    EXPECT_EQ(2u, model.GetCaretLine());
+    EXPECT_EQ(4u, model.GetCaretColumn());
+
+    model.MoveCaret(CaretMove::DocEnd, true);
+    EXPECT_EQ(u"er line", model.GetSelectedText());
+}
+
+TEST(TextEditorModelTest, InsertText_ConvertsLineBreaks)
+{
+    TextBuffer buffer;
+    buffer.SetText("start", 5);
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetLineBreak(LineEnding::Lf);
+
+    model.MoveCaret(CaretMove::DocEnd, false);
+    std::u16string pasted = u"\r\n中\rend";
+    model.InsertText(pasted.data(), pasted.size());
+    EXPECT_EQ("start\n\xE4\xB8\xAD\nend", AllText(buffer));
+    EXPECT_EQ(2u, model.GetCaretLine());
+    EXPECT_EQ(3u, model.GetCaretColumn());
+
+    model.InsertLineBreak();
+    EXPECT_EQ(4u, buffer.GetLineCount());
+}
+
+TEST(TextEditorModelTest, DeleteAndUndoRedo)
+{
+    TextBuffer buffer;
+    buffer.SetText("line1\r\nline2", 12);
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+
+    model.SetSelection(7, 7);
+    EXPECT_TRUE(model.DeleteBackward());                // CRLF 整体删除
+    EXPECT_EQ("line1line2", AllText(buffer));
+    EXPECT_EQ(5u, model.GetSelection().caret);
+
+    model.SelectAll();
+    std::u16string replacement = u"x";
+    model.InsertText(replacement.data(), replacement.size());
+    EXPECT_EQ("x", AllText(buffer));
+
+    EXPECT_TRUE(model.Undo());
+    EXPECT_EQ("line1line2", AllText(buffer));
+    EXPECT_EQ(0u, model.GetSelection().Start());
+    EXPECT_EQ(10u, model.GetSelection().End());
+    EXPECT_TRUE(model.Undo());
+    EXPECT_EQ("line1\r\nline2", AllText(buffer));
+    EXPECT_FALSE(model.CanUndo());
+
+    EXPECT_TRUE(model.Redo());
+    EXPECT_TRUE(model.Redo());
+    EXPECT_EQ("x", AllText(buffer));
+    EXPECT_FALSE(model.CanRedo());
+
+    model.MoveCaret(CaretMove::DocStart, false);
+    EXPECT_FALSE(model.DeleteBackward());
+    EXPECT_TRUE(model.DeleteForward());
+    EXPECT_EQ("", AllText(buffer));
+}
+
+TEST(TextEditorModelTest, SaveAndReloadKeepsUndoHistory)
+{
+    // 模拟超大文件保存：原始内容换成保存后的文件，旧内容随后失效
+    std::string original = "alpha\nbeta\ngamma\ndelta";
+    TextBuffer buffer;
+    buffer.AttachOriginal(original.data(), original.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+
+    model.SetSelection(6, 11);                          // 删除 "beta\n"
+    EXPECT_TRUE(model.DeleteSelection());
+    model.SetSelection(0, 0);
+    std::u16string inserted = u">> ";
+    model.InsertText(inserted.data(), inserted.size());
+    model.SetSelection(2, 5);
+    EXPECT_TRUE(model.Undo());                          // 撤销插入，留一条重做
+    model.SetSelection(1, 3);
+    ASSERT_EQ("alpha\ngamma\ndelta", AllText(buffer));
+
+    std::string saved = AllText(buffer);
+    model.PrepareReload();
+    std::fill(original.begin(), original.end(), '#');
+    ASSERT_TRUE(buffer.ReplaceOriginal(saved.data(), saved.size()));
+    model.ReloadBuffer();
+
+    EXPECT_EQ("alpha\ngamma\ndelta", AllText(buffer));
+    EXPECT_EQ(1u, model.GetSelection().anchor);
+    EXPECT_EQ(3u, model.GetSelection().caret);
+    ASSERT_TRUE(model.CanUndo());
+    ASSERT_TRUE(model.CanRedo());
+
+    EXPECT_TRUE(model.Redo());
+    EXPECT_EQ(">> alpha\ngamma\ndelta", AllText(buffer));
+    EXPECT_TRUE(model.Undo());
+    EXPECT_TRUE(model.Undo());
+    EXPECT_EQ("alpha\nbeta\ngamma\ndelta", AllText(buffer));
+    EXPECT_EQ(4u, buffer.GetLineCount());
+    EXPECT_EQ(6u, buffer.GetLineStart(1));
+    EXPECT_FALSE(model.CanUndo());
+
+    // 长度不同的内容不能作为新的原始内容
+    std::string other = "short";
+    EXPECT_FALSE(buffer.ReplaceOriginal(other.data(), other.size()));
+}
+
+TEST(TextEditorModelTest, ViewportFollowsCaret)
+{
+    std::string text;
+    for (int i = 0; i < 100; i++)
+        text += "0123456789012345678901234567890123456789\n";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(10, 20);
+
+    model.SetCaretFromCell(50, 30, false);
+    EXPECT_TRUE(model.EnsureCaretVisible());
+    EXPECT_EQ(41u, model.GetFirstVisibleLine());
+    EXPECT_EQ(11u, model.GetFirstVisibleColumn());
+    EXPECT_FALSE(model.EnsureCaretVisible());
+
+    model.MoveCaret(CaretMove::PageDown, false);
+    EXPECT_EQ(59u, model.GetCaretLine());
+    EXPECT_EQ(50u, model.GetFirstVisibleLine());
+
+    model.SetFirstVisibleLine(1000);
+    EXPECT_EQ(model.GetMaxFirstVisibleLine(), model.GetFirstVisibleLine());
+    EXPECT_EQ(91u, model.GetMaxFirstVisibleLine());
+}
+
+TEST(TextEditorModelTest, GetLineText_InvalidBytesAndOffsets)
+{
+    // 非法字节与截断序列各显示为一个替换字符，偏移映射与光标步进一致
+    std::string text = "a\xFF\xE4\xB8z\xF0\x9F\x98\x80";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+
+    std::vector<size_t> offsets;
+    std::u16string line = model.GetLineText(0, &offsets);
+    EXPECT_EQ(std::u16string(u"a\uFFFD\uFFFDz\U0001F600"), line);
+    std::vector<size_t> expected = { 0, 1, 2, 4, 5, 5, 9 };
+    EXPECT_EQ(expected, offsets);
+
+    size_t caret = 0;
+    for (size_t i = 0; i + 1 < offsets.size(); i++)
+    {
+        if (offsets[i] == caret && offsets[i + 1] != caret)
+        {
+            caret = buffer.NextCharBoundary(caret);
+            EXPECT_EQ(offsets[i + 1], caret);
+        }
+    }
+}
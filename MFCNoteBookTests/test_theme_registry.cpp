@@ -0,0 +1,167 @@
+﻿// test_theme_registry.cpp - 主题注册表与对比度校验测试
+#include "pch.h"
+#include "../MFCNoteBook/ThemeRegistry.h"
+
+#include <cstring>
+
+using namespace TestableLogic;
+
+namespace
+{
+    size_t Load(ThemeRegistry& registry, const char* text)
+    {
+        return registry.LoadUserThemes(text, strlen(text));
+    }
+}
+
+// ============ 对比度 ============
+
+TEST(ThemeRegistryTest, ContrastBlackOnWhiteIs21)
+{
+    EXPECT_EQ(2100u, GetContrastRatio100(MakeThemeColor(0, 0, 0), MakeThemeColor(255, 255, 255)));
+    EXPECT_EQ(2100u, GetContrastRatio100(MakeThemeColor(255, 255, 255), MakeThemeColor(0, 0, 0)));
+}
+
+TEST(ThemeRegistryTest, ContrastSameColorIs1)
+{
+    EXPECT_EQ(100u, GetContrastRatio100(MakeThemeColor(128, 128, 128), MakeThemeColor(128, 128, 128)));
+}
+
+TEST(ThemeRegistryTest, ContrastMatchesWcagReference)
+{
+    // #767676 白底是常用的 AA 临界灰，约 4.54:1
+    EXPECT_EQ(454u, GetContrastRatio100(MakeThemeColor(0x76, 0x76, 0x76), MakeThemeColor(255, 255, 255)));
+    // 纯红白底约 4.0:1
+    EXPECT_EQ(399u, GetContrastRatio100(MakeThemeColor(255, 0, 0), MakeThemeColor(255, 255, 255)));
+}
+
+TEST(ThemeRegistryTest, ContrastIsCompileTimeConstant)
+{
+    static_assert(GetContrastRatio100(MakeThemeColor(0, 0, 0), MakeThemeColor(255, 255, 255)) == 2100,
+        "对比度应能在编译期计算");
+    SUCCEED();
+}
+
+// ============ 内置主题 ============
+
+TEST(ThemeRegistryTest, BuiltInThemesPassValidation)
+{
+    for (size_t id = 0; id < THEME_BUILTIN_COUNT; id++)
+        EXPECT_EQ(ThemeStatus::Ok, ValidateThemePalette(GetBuiltInThemePalette(id)));
+}
+
+TEST(ThemeRegistryTest, BuiltInThemesHaveFixedIds)
+{
+    ThemeRegistry registry;
+    ASSERT_EQ(static_cast<size_t>(THEME_BUILTIN_COUNT), registry.GetCount());
+    EXPECT_EQ("Light", registry.Get(0).name);
+    EXPECT_EQ("Dark", registry.Get(1).name);
+    EXPECT_EQ(MakeThemeColor(255, 255, 255), registry.Get(0).palette.editBg);
+    EXPECT_EQ(MakeThemeColor(30, 30, 30), registry.Get(1).palette.editBg);
+    EXPECT_TRUE(registry.Get(1).bBuiltIn);
+}
+
+TEST(ThemeRegistryTest, OutOfRangeIdFallsBackToLight)
+{
+    ThemeRegistry registry;
+    EXPECT_EQ(&registry.Get(0), &registry.Get(100));
+}
+
+// ============ 用户主题文件 ============
+
+TEST(ThemeRegistryTest, ParseLine_NameWithSpaces)
+{
+    std::string name;
+    ThemePalette palette = {};
+    const char* line = "  Solarized Light  #FDF6E3 #586E75 #EEE8D5 #93a1a1 #D6CFB8\r";
+    ASSERT_EQ(ThemeStatus::Ok, ThemeRegistry::ParseLine(line, strlen(line), name, palette));
+    EXPECT_EQ("Solarized Light", name);
+    EXPECT_EQ(MakeThemeColor(0xFD, 0xF6, 0xE3), palette.editBg);
+    EXPECT_EQ(MakeThemeColor(0x93, 0xA1, 0xA1), palette.lineNumText);
+    EXPECT_EQ(MakeThemeColor(0xD6, 0xCF, 0xB8), palette.lineNumBorder);
+}
+
+TEST(ThemeRegistryTest, ParseLine_Errors)
+{
+    std::string name;
+    ThemePalette palette = {};
+    const char* noName = "#FFFFFF #000000 #F0F0F0 #808080 #C8C8C8";
+    const char* fourColors = "Mono #FFFFFF #000000 #F0F0F0 #808080";
+    const char* badHex = "Mono #FFFFFF #00000G #F0F0F0 #808080 #C8C8C8";
+    const char* shortHex = "Mono #FFF #000000 #F0F0F0 #808080 #C8C8C8";
+    EXPECT_EQ(ThemeStatus::BadFormat, ThemeRegistry::ParseLine(noName, strlen(noName), name, palette));
+    EXPECT_EQ(ThemeStatus::BadFormat, ThemeRegistry::ParseLine(fourColors, strlen(fourColors), name, palette));
+    EXPECT_EQ(ThemeStatus::BadColor, ThemeRegistry::ParseLine(badHex, strlen(badHex), name, palette));
+    EXPECT_EQ(ThemeStatus::BadColor, ThemeRegistry::ParseLine(shortHex, strlen(shortHex), name, palette));
+}
+
+TEST(ThemeRegistryTest, LoadAppendsValidThemesAfterBuiltIns)
+{
+    ThemeRegistry registry;
+    size_t added = Load(registry,
+        "\xEF\xBB\xBF# 用户主题\n"
+        "\n"
+        "Solarized Light #FDF6E3 #3B4B52 #EEE8D5 #5F6E70 #D6CFB8\n"
+        "; 注释\r\n"
+        "高对比 #000000 #FFFF00 #000000 #FFFFFF #808080");
+    EXPECT_EQ(2u, added);
+    EXPECT_TRUE(registry.GetErrors().empty());
+    ASSERT_EQ(4u, registry.GetCount());
+    EXPECT_EQ(2, registry.FindByName("Solarized Light"));
+    EXPECT_EQ(3, registry.FindByName("高对比"));
+    EXPECT_FALSE(registry.Get(3).bBuiltIn);
+    EXPECT_EQ(MakeThemeColor(255, 255, 0), registry.Get(3).palette.editText);
+}
+
+TEST(ThemeRegistryTest, LoadRejectsLowContrastAndReportsLine)
+{
+    ThemeRegistry registry;
+    size_t added = Load(registry,
+        "Washed #808080 #828282 #808080 #FFFFFF #808080\n"
+        "DimNumbers #FFFFFF #000000 #F0F0F0 #E0E0E0 #C8C8C8\n"
+        "Good #FFFFFF #000000 #F0F0F0 #707070 #C8C8C8\n");
+    EXPECT_EQ(1u, added);
+    ASSERT_EQ(2u, registry.GetErrors().size());
+    EXPECT_EQ(1u, registry.GetErrors()[0].line);
+    EXPECT_EQ(ThemeStatus::LowTextContrast, registry.GetErrors()[0].status);
+    EXPECT_EQ(2u, registry.GetErrors()[1].line);
+    EXPECT_EQ(ThemeStatus::LowLineNumberContrast, registry.GetErrors()[1].status);
+    EXPECT_EQ(-1, registry.FindByName("Washed"));
+    EXPECT_EQ(2, registry.FindByName("Good"));
+}
+
+TEST(ThemeRegistryTest, LoadRejectsDuplicateNames)
+{
+    ThemeRegistry registry;
+    Load(registry,
+        "Dark #000000 #FFFFFF #000000 #FFFFFF #808080\n"
+        "Paper #FFFFFF #000000 #F0F0F0 #707070 #C8C8C8\n"
+        "Paper #FFFFF0 #000000 #F0F0F0 #707070 #C8C8C8\n");
+    ASSERT_EQ(2u, registry.GetErrors().size());
+    EXPECT_EQ(ThemeStatus::DuplicateName, registry.GetErrors()[0].status);
+    EXPECT_EQ(ThemeStatus::DuplicateName, registry.GetErrors()[1].status);
+    EXPECT_EQ(3u, registry.GetCount());
+    EXPECT_EQ(MakeThemeColor(30, 30, 30), registry.Get(1).palette.editBg);
+}
+
+TEST(ThemeRegistryTest, LoadStopsAtMaxCount)
+{
+    ThemeRegistry registry;
+    std::string text;
+    for (int i = 0; i < THEME_MAX_COUNT; i++)
+        text += "Theme" + std::to_string(i) + " #FFFFFF #000000 #F0F0F0 #707070 #C8C8C8\n";
+    size_t added = registry.LoadUserThemes(text.data(), text.size());
+    EXPECT_EQ(static_cast<size_t>(THEME_MAX_COUNT - THEME_BUILTIN_COUNT), added);
+    EXPECT_EQ(static_cast<size_t>(THEME_MAX_COUNT), registry.GetCount());
+    ASSERT_EQ(static_cast<size_t>(THEME_BUILTIN_COUNT), registry.GetErrors().size());
+    EXPECT_EQ(ThemeStatus::TooMany, registry.GetErrors().back().status);
+}
+
+TEST(ThemeRegistryTest, ResetDropsUserThemes)
+{
+    ThemeRegistry registry;
+    Load(registry, "Paper #FFFFFF #000000 #F0F0F0 #707070 #C8C8C8\nbad line\n");
+    registry.Reset();
+    EXPECT_EQ(static_cast<size_t>(THEME_BUILTIN_COUNT), registry.GetCount());
+    EXPECT_TRUE(registry.GetErrors().empty());
+}
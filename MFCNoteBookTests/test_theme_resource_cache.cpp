@@ -0,0 +1,84 @@
+﻿// test_theme_resource_cache.cpp - 主题资源缓存测试
+#include "pch.h"
+#include "../MFCNoteBook/ThemeResourceCache.h"
+
+using namespace TestableLogic;
+
+namespace
+{
+    struct FakeResources
+    {
+        int theme = -1;
+    };
+
+    typedef ThemeResourceCache<FakeResources> FakeThemeCache;
+
+    // 模拟创建画刷：记录调用次数
+    struct FakeFactory
+    {
+        int* pCalls;
+
+        void operator()(int theme, FakeResources& res) const
+        {
+            (*pCalls)++;
+            res.theme = theme;
+        }
+    };
+}
+
+TEST(ThemeResourceCacheTest, SameThemeCreatesOnce)
+{
+    FakeThemeCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    const FakeResources& first = cache.Get(0, factory);
+    const FakeResources& second = cache.Get(0, factory);
+    EXPECT_EQ(&first, &second);
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(0, first.theme);
+    EXPECT_EQ(1u, cache.GetCreateCount());
+    EXPECT_EQ(1u, cache.GetHitCount());
+}
+
+TEST(ThemeResourceCacheTest, ToggleBackAndForthCreatesEachThemeOnce)
+{
+    FakeThemeCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    for (int i = 0; i < 100; i++)
+    {
+        const FakeResources& res = cache.Get(i % 2, factory);
+        EXPECT_EQ(i % 2, res.theme);
+    }
+    EXPECT_EQ(2, calls);
+    EXPECT_EQ(2u, cache.GetSize());
+    EXPECT_EQ(98u, cache.GetHitCount());
+}
+
+TEST(ThemeResourceCacheTest, ReferencesStayValidWhenOtherThemesAreAdded)
+{
+    FakeThemeCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    const FakeResources* pLight = &cache.Get(0, factory);
+    for (int theme = 1; theme < 20; theme++)
+        cache.Get(theme, factory);
+    EXPECT_EQ(pLight, &cache.Get(0, factory));
+    EXPECT_EQ(0, pLight->theme);
+}
+
+TEST(ThemeResourceCacheTest, ClearRecreatesOnNextUse)
+{
+    FakeThemeCache cache;
+    int calls = 0;
+    FakeFactory factory = { &calls };
+
+    cache.Get(1, factory);
+    cache.Clear();
+    EXPECT_EQ(0u, cache.GetSize());
+    cache.Get(1, factory);
+    EXPECT_EQ(2, calls);
+}
@@ -0,0 +1,451 @@
+﻿// test_trigram_index.cpp - 三元组索引测试
+#include "pch.h"
+#include "../MFCNoteBook/TrigramIndex.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <map>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 每个测试使用独立的索引文件，避免互相影响
+    std::string MakeIndexPath(const char* name)
+    {
+        std::string path = ::testing::TempDir() + name;
+        FileUtil::Remove(path);
+        FileUtil::Remove(path + TRIGRAM_DELTA_SUFFIX);
+        return path;
+    }
+
+    std::vector<std::string> QueryText(const TrigramIndex& index, const wchar_t* needle)
+    {
+        return index.Query(needle, wcslen(needle));
+    }
+
+    void AddText(TrigramIndex& index, const char* path, const wchar_t* text, bool bKeyed = false)
+    {
+        index.UpdateFile(path, text, wcslen(text), 1, bKeyed);
+    }
+
+    // 旧版校验值所用 Fmix64 的逆运算
+    uint64_t UnFmix64(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0x9CB4B2F8129337DBULL;
+        h ^= h >> 33;
+        h *= 0x4F74430C22A54005ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // 写出含两个文件的基础索引，返回其内容
+    std::vector<uint8_t> WriteBaseIndex(const std::string& path)
+    {
+        TrigramIndex index;
+        index.Load(path);
+        AddText(index, "a.txt", L"alpha beta gamma");
+        AddText(index, "b.txt", L"beta delta");
+        index.Compact();
+
+        std::vector<uint8_t> raw;
+        FileUtil::ReadAll(path, raw);
+        return raw;
+    }
+
+    // 改写基础索引后重新载入：应按空索引处理，查询不越界
+    void ExpectCorruptBaseIgnored(const std::string& path, const std::vector<uint8_t>& raw)
+    {
+        ASSERT_TRUE(FileUtil::WriteAllAtomic(path, raw.data(), raw.size()));
+        TrigramIndex reloaded;
+        ASSERT_TRUE(reloaded.Load(path));
+        EXPECT_EQ(reloaded.FileCount(), 0u);
+        EXPECT_TRUE(QueryText(reloaded, L"beta").empty());
+        EXPECT_TRUE(QueryText(reloaded, L"be").empty());
+
+        // 合并时整体重建
+        AddText(reloaded, "c.txt", L"beta again");
+        ASSERT_TRUE(reloaded.Compact());
+        EXPECT_EQ(QueryText(reloaded, L"beta").size(), 1u);
+    }
+
+    bool ContainsBytes(const std::vector<uint8_t>& data, uint64_t value)
+    {
+        uint8_t bytes[8];
+        memcpy(bytes, &value, sizeof(bytes));
+        return std::search(data.begin(), data.end(), bytes, bytes + sizeof(bytes)) != data.end();
+    }
+}
+
+// ============ 三元组提取测试 ============
+
+TEST(TrigramIndexTest, ExtractKeys_ShortText)
+{
+    EXPECT_TRUE(TrigramIndex::ExtractTrigramKeys(L"ab", 2, 0).empty());
+    EXPECT_TRUE(TrigramIndex::ExtractTrigramKeys(nullptr, 10, 0).empty());
+    EXPECT_EQ(TrigramIndex::ExtractTrigramKeys(L"abc", 3, 0).size(), 1u);
+}
+
+TEST(TrigramIndexTest, ExtractKeys_Deduplicated)
+{
+    // "aaaa" 只有一个不同的三元组
+    EXPECT_EQ(TrigramIndex::ExtractTrigramKeys(L"aaaa", 4, 0).size(), 1u);
+}
+
+TEST(TrigramIndexTest, ExtractKeys_CaseInsensitive)
+{
+    EXPECT_EQ(TrigramIndex::ExtractTrigramKeys(L"Hello", 5, 0),
+        TrigramIndex::ExtractTrigramKeys(L"hELLO", 5, 0));
+}
+
+TEST(TrigramIndexTest, ExtractKeys_SaltChangesKeys)
+{
+    EXPECT_NE(TrigramIndex::ExtractTrigramKeys(L"secret", 6, 0),
+        TrigramIndex::ExtractTrigramKeys(L"secret", 6, 12345));
+}
+
+// ============ 内存索引查询测试 ============
+
+TEST(TrigramIndexTest, Query_NarrowsCandidates)
+{
+    TrigramIndex index;
+    AddText(index, "a.txt", L"the quick brown fox");
+    AddText(index, "b.txt", L"lazy dog sleeps");
+    AddText(index, "c.txt", L"Quick thinking");
+
+    auto result = QueryText(index, L"quick");
+    ASSERT_EQ(result.size(), 2u);
+    EXPECT_EQ(result[0], "a.txt");
+    EXPECT_EQ(result[1], "c.txt");
+
+    EXPECT_TRUE(QueryText(index, L"elephant").empty());
+}
+
+TEST(TrigramIndexTest, Query_ShortNeedleReturnsAll)
+{
+    TrigramIndex index;
+    AddText(index, "a.txt", L"abc");
+    AddText(index, "b.txt", L"xyz");
+    EXPECT_EQ(QueryText(index, L"q").size(), 2u);
+}
+
+TEST(TrigramIndexTest, Query_ChineseText)
+{
+    TrigramIndex index;
+    AddText(index, "cn.txt", L"这是一个中文笔记");
+    AddText(index, "en.txt", L"an english note");
+
+    auto result = QueryText(index, L"中文笔记");
+    ASSERT_EQ(result.size(), 1u);
+    EXPECT_EQ(result[0], "cn.txt");
+}
+
+TEST(TrigramIndexTest, UpdateAndRemove)
+{
+    TrigramIndex index;
+    AddText(index, "a.txt", L"first version");
+    EXPECT_EQ(QueryText(index, L"first").size(), 1u);
+
+    AddText(index, "a.txt", L"second version");
+    EXPECT_TRUE(QueryText(index, L"first").empty());
+    EXPECT_EQ(QueryText(index, L"second").size(), 1u);
+
+    index.RemoveFile("a.txt");
+    EXPECT_TRUE(QueryText(index, L"second").empty());
+    EXPECT_EQ(index.FileCount(), 0u);
+}
+
+TEST(TrigramIndexTest, KeyedHash_RequiresKey)
+{
+    uint64_t salt = TrigramIndex::DeriveKeySalt("BIGC_AI_2025_KEY", 16);
+    TrigramIndex index(salt);
+    AddText(index, "secret.mynote", L"confidential plan", true);
+    AddText(index, "plain.txt", L"public plan", false);
+
+    auto result = QueryText(index, L"plan");
+    EXPECT_EQ(result.size(), 2u);
+    EXPECT_EQ(QueryText(index, L"confidential").size(), 1u);
+}
+
+TEST(TrigramIndexTest, KeyedHash_WithoutKeyNotIndexed)
+{
+    TrigramIndex index;
+    AddText(index, "secret.mynote", L"confidential plan", true);
+    EXPECT_FALSE(index.Contains("secret.mynote"));
+    EXPECT_TRUE(QueryText(index, L"plan").empty());
+}
+
+TEST(TrigramIndexTest, DeriveKeySalt_LabeledSha256)
+{
+    // SHA-256("MFCNoteBook trigram salt\0" + 密钥) 的前 8 字节
+    EXPECT_EQ(TrigramIndex::DeriveKeySalt("BIGC_AI_2025_KEY", 16), 0x926E6165082DD96FULL);
+    EXPECT_EQ(TrigramIndex::DeriveKeySalt("", 0), 0u);
+    EXPECT_NE(TrigramIndex::DeriveKeySalt("key-one", 7), TrigramIndex::DeriveKeySalt("key-two", 7));
+}
+
+TEST(TrigramIndexTest, Search_RunsFullMatcherOnCandidatesOnly)
+{
+    TrigramIndex index;
+    AddText(index, "a.txt", L"needle here");
+    AddText(index, "b.txt", L"nothing");
+
+    std::vector<std::string> visited;
+    auto matches = index.Search(L"needle", 6, [&](const std::string& path)
+        {
+            visited.push_back(path);
+            return true;
+        });
+
+    ASSERT_EQ(visited.size(), 1u);
+    EXPECT_EQ(visited[0], "a.txt");
+    EXPECT_EQ(matches, visited);
+}
+
+// ============ 持久化测试 ============
+
+// ============ 按目录刷新 ============
+
+TEST(TrigramIndexTest, Refresh_SkipsUnchangedAndRemovesMissing)
+{
+    std::string path = MakeIndexPath("trigram_refresh.idx");
+    std::map<std::string, std::wstring> disk = {
+        { "a.txt", L"alpha beta" }, { "b.txt", L"beta gamma" }, { "c.txt", L"gamma delta" } };
+    std::vector<std::string> loaded;
+    auto loadText = [&](const std::string& file, std::wstring& text)
+    {
+        loaded.push_back(file);
+        text = disk[file];
+        return true;
+    };
+
+    TrigramIndex index;
+    ASSERT_TRUE(index.Load(path));
+    std::vector<TrigramSourceFile> files = {
+        { "a.txt", 10, false }, { "b.txt", 10, false }, { "c.txt", 10, false } };
+    EXPECT_EQ(3u, index.Refresh(files, loadText));
+    EXPECT_EQ(2u, QueryText(index, L"gamma").size());
+
+    // 再次扫描：时间戳未变，一篇也不读
+    loaded.clear();
+    EXPECT_EQ(0u, index.Refresh(files, loadText));
+    EXPECT_TRUE(loaded.empty());
+
+    // b 被修改，c 被删除
+    disk["b.txt"] = L"epsilon";
+    files = { { "a.txt", 10, false }, { "b.txt", 11, false } };
+    EXPECT_EQ(1u, index.Refresh(files, loadText));
+    EXPECT_EQ(std::vector<std::string>{ "b.txt" }, loaded);
+    EXPECT_FALSE(index.Contains("c.txt"));
+    EXPECT_TRUE(QueryText(index, L"gamma").empty());
+    EXPECT_EQ(std::vector<std::string>{ "b.txt" }, QueryText(index, L"epsilon"));
+
+    // 合并并重新载入后，时间戳仍然用来跳过未变的文件
+    ASSERT_TRUE(index.Compact());
+    TrigramIndex reloaded;
+    ASSERT_TRUE(reloaded.Load(path));
+    loaded.clear();
+    EXPECT_EQ(0u, reloaded.Refresh(files, loadText));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_EQ(2u, reloaded.FileCount());
+}
+
+TEST(TrigramIndexTest, Refresh_UnreadableAndKeyedFiles)
+{
+    TrigramIndex index;
+    AddText(index, "gone.txt", L"stale text");
+    std::vector<TrigramSourceFile> files = { { "gone.txt", 5, false }, { "s.mynote", 5, true } };
+    size_t nCalls = 0;
+
+    // 读不出来的文件从索引中删除；没有密钥时加密文档不读入
+    EXPECT_EQ(0u, index.Refresh(files, [&](const std::string&, std::wstring&) { nCalls++; return false; }));
+    EXPECT_EQ(1u, nCalls);
+    EXPECT_EQ(0u, index.FileCount());
+
+    TrigramIndex keyed(TrigramIndex::DeriveKeySalt("key", 3));
+    EXPECT_EQ(1u, keyed.Refresh({ { "s.mynote", 5, true } },
+        [](const std::string&, std::wstring& text) { text = L"top secret"; return true; }));
+    EXPECT_EQ(1u, QueryText(keyed, L"secret").size());
+}
+
+TEST(TrigramIndexTest, Persist_DeltaReplayedOnLoad)
+{
+    std::string path = MakeIndexPath("trigram_delta.idx");
+    {
+        TrigramIndex index;
+        ASSERT_TRUE(index.Load(path));
+        AddText(index, "a.txt", L"persisted through delta");
+    }
+
+    EXPECT_TRUE(FileUtil::Exists(path + TRIGRAM_DELTA_SUFFIX));
+    EXPECT_FALSE(FileUtil::Exists(path));
+
+    TrigramIndex reloaded;
+    ASSERT_TRUE(reloaded.Load(path));
+    EXPECT_EQ(QueryText(reloaded, L"delta").size(), 1u);
+}
+
+TEST(TrigramIndexTest, Persist_CompactWritesMappableBase)
+{
+    std::string path = MakeIndexPath("trigram_compact.idx");
+    {
+        TrigramIndex index;
+        ASSERT_TRUE(index.Load(path));
+        AddText(index, "a.txt", L"alpha beta gamma");
+        AddText(index, "b.txt", L"beta delta");
+        ASSERT_TRUE(index.Compact());
+        EXPECT_FALSE(FileUtil::Exists(path + TRIGRAM_DELTA_SUFFIX));
+
+        // 合并后仍可继续增量更新
+        AddText(index, "c.txt", L"gamma ray");
+    }
+
+    std::vector<uint8_t> raw;
+    ASSERT_TRUE(FileUtil::ReadAll(path, raw));
+    ASSERT_GE(raw.size(), sizeof(TrigramIndexHeader));
+    const TrigramIndexHeader* pHeader = reinterpret_cast<const TrigramIndexHeader*>(raw.data());
+    EXPECT_EQ(memcmp(pHeader->magic, TRIGRAM_INDEX_MAGIC, TRIGRAM_INDEX_MAGIC_SIZE), 0);
+    EXPECT_EQ(pHeader->version, (uint32_t)TRIGRAM_INDEX_VERSION);
+    EXPECT_EQ(pHeader->fileCount, 2u);
+    EXPECT_EQ(pHeader->totalSize, raw.size());
+
+    TrigramIndex reloaded;
+    ASSERT_TRUE(reloaded.Load(path));
+    EXPECT_EQ(reloaded.FileCount(), 3u);
+    EXPECT_EQ(QueryText(reloaded, L"beta").size(), 2u);
+    EXPECT_EQ(QueryText(reloaded, L"gamma").size(), 2u);
+
+    // 增量中的删除覆盖基础索引
+    reloaded.RemoveFile("a.txt");
+    EXPECT_EQ(QueryText(reloaded, L"beta").size(), 1u);
+    ASSERT_TRUE(reloaded.Compact());
+    EXPECT_EQ(reloaded.FileCount(), 2u);
+    EXPECT_EQ(QueryText(reloaded, L"beta").size(), 1u);
+}
+
+TEST(TrigramIndexTest, Persist_KeyChangeInvalidatesKeyedEntries)
+{
+    std::string path = MakeIndexPath("trigram_keyed.idx");
+    {
+        TrigramIndex index(TrigramIndex::DeriveKeySalt("key-one", 7));
+        ASSERT_TRUE(index.Load(path));
+        AddText(index, "s.mynote", L"top secret", true);
+        AddText(index, "p.txt", L"top public", false);
+        ASSERT_TRUE(index.Compact());
+    }
+
+    TrigramIndex other(TrigramIndex::DeriveKeySalt("key-two", 7));
+    ASSERT_TRUE(other.Load(path));
+    EXPECT_FALSE(other.Contains("s.mynote"));
+    EXPECT_TRUE(other.Contains("p.txt"));
+    EXPECT_TRUE(QueryText(other, L"secret").empty());
+}
+
+TEST(TrigramIndexTest, Persist_HeaderDoesNotRevealSalt)
+{
+    std::string path = MakeIndexPath("trigram_salt.idx");
+    uint64_t salt = TrigramIndex::DeriveKeySalt("BIGC_AI_2025_KEY", 16);
+    {
+        TrigramIndex index(salt);
+        ASSERT_TRUE(index.Load(path));
+        AddText(index, "s.mynote", L"top secret", true);
+        ASSERT_TRUE(index.Compact());
+        AddText(index, "t.mynote", L"more secrets", true);
+    }
+
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> delta;
+    ASSERT_TRUE(FileUtil::ReadAll(path, raw));
+    ASSERT_TRUE(FileUtil::ReadAll(path + TRIGRAM_DELTA_SUFFIX, delta));
+    const TrigramIndexHeader* pHeader = reinterpret_cast<const TrigramIndexHeader*>(raw.data());
+
+    // 校验值是盐的 SHA-256，逆转旧版的混合函数得不到盐，文件中也不出现盐本身
+    EXPECT_EQ(pHeader->keyCheck, 0xACCF68D9F3D9D915ULL);
+    EXPECT_NE(UnFmix64(pHeader->keyCheck) ^ 0x6D796E6F7465ULL, salt);
+    EXPECT_NE(UnFmix64(pHeader->keyCheck), salt);
+    EXPECT_FALSE(ContainsBytes(raw, salt));
+    EXPECT_FALSE(ContainsBytes(delta, salt));
+
+    // 同一密钥仍能读回加密条目
+    TrigramIndex reloaded(salt);
+    ASSERT_TRUE(reloaded.Load(path));
+    EXPECT_EQ(QueryText(reloaded, L"secret").size(), 2u);
+}
+
+TEST(TrigramIndexTest, Persist_TornDeltaTailIgnored)
+{
+    std::string path = MakeIndexPath("trigram_torn.idx");
+    {
+        TrigramIndex index;
+        ASSERT_TRUE(index.Load(path));
+        AddText(index, "a.txt", L"complete record");
+    }
+
+    // 模拟崩溃：在日志尾部追加半条记录
+    FILE* fp = FileUtil::Open(path + TRIGRAM_DELTA_SUFFIX, "ab");
+    ASSERT_NE(fp, nullptr);
+    const uint32_t partial[2] = { 0x544C4454, 1 };
+    fwrite(partial, 1, sizeof(partial), fp);
+    fclose(fp);
+
+    TrigramIndex reloaded;
+    ASSERT_TRUE(reloaded.Load(path));
+    EXPECT_EQ(reloaded.FileCount(), 1u);
+    EXPECT_EQ(QueryText(reloaded, L"record").size(), 1u);
+}
+
+TEST(TrigramIndexTest, Persist_PostingRangeOutOfBoundsIgnored)
+{
+    std::string path = MakeIndexPath("trigram_bad_posting.idx");
+    std::vector<uint8_t> raw = WriteBaseIndex(path);
+    ASSERT_GE(raw.size(), sizeof(TrigramIndexHeader));
+    TrigramIndexHeader header;
+    memcpy(&header, raw.data(), sizeof(header));
+    ASSERT_GT(header.trigramCount, 1u);
+
+    TrigramEntry* pLast = reinterpret_cast<TrigramEntry*>(raw.data() + header.trigramTableOffset) +
+        (header.trigramCount - 1);
+    pLast->postingStart = 0xFFFFFFF0u;
+    ExpectCorruptBaseIgnored(path, raw);
+
+    raw = WriteBaseIndex(MakeIndexPath("trigram_bad_posting.idx"));
+    pLast = reinterpret_cast<TrigramEntry*>(raw.data() + header.trigramTableOffset) + (header.trigramCount - 1);
+    pLast->postingCount += 1;
+    ExpectCorruptBaseIgnored(path, raw);
+}
+
+TEST(TrigramIndexTest, Persist_UnsortedTablesIgnored)
+{
+    std::string path = MakeIndexPath("trigram_unsorted.idx");
+    std::vector<uint8_t> raw = WriteBaseIndex(path);
+    TrigramIndexHeader header;
+    memcpy(&header, raw.data(), sizeof(header));
+    TrigramEntry* pTrigrams = reinterpret_cast<TrigramEntry*>(raw.data() + header.trigramTableOffset);
+    std::swap(pTrigrams[0].key, pTrigrams[1].key);
+    ExpectCorruptBaseIgnored(path, raw);
+
+    // "beta" 出现在两个文件中，倒排表为 {0, 1}，倒过来就不能求交集
+    raw = WriteBaseIndex(MakeIndexPath("trigram_unsorted.idx"));
+    pTrigrams = reinterpret_cast<TrigramEntry*>(raw.data() + header.trigramTableOffset);
+    uint32_t* pPostings = reinterpret_cast<uint32_t*>(raw.data() + header.postingOffset);
+    for (uint32_t t = 0; t < header.trigramCount; t++)
+    {
+        if (pTrigrams[t].postingCount == 2)
+        {
+            std::swap(pPostings[pTrigrams[t].postingStart], pPostings[pTrigrams[t].postingStart + 1]);
+            break;
+        }
+    }
+    ExpectCorruptBaseIgnored(path, raw);
+}
+
+TEST(TrigramIndexTest, Persist_OverflowingOffsetsIgnored)
+{
+    std::string path = MakeIndexPath("trigram_overflow.idx");
+    std::vector<uint8_t> raw = WriteBaseIndex(path);
+    TrigramIndexHeader* pHeader = reinterpret_cast<TrigramIndexHeader*>(raw.data());
+    // postingOffset + postingCount * 4 回绕后小于文件大小
+    pHeader->postingCount = 0x4000000000000000ULL;
+    ExpectCorruptBaseIgnored(path, raw);
+}
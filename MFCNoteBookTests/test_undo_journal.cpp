@@ -0,0 +1,439 @@
+﻿// test_undo_journal.cpp - 持久化撤销日志测试
+#include "pch.h"
+#include "../MFCNoteBook/UndoJournal.h"
+#include "../MFCNoteBook/FileUtil.h"
+
+#include <algorithm>
+
+using namespace TestableLogic;
+
+namespace
+{
+    std::string MakeJournalPath(const char* name)
+    {
+        std::string path = ::testing::TempDir() + name;
+        FileUtil::Remove(path);
+        return path;
+    }
+
+    TextFingerprint Fingerprint(const std::u16string& text)
+    {
+        return FingerprintText(text.data(), text.size());
+    }
+
+    // 模拟编辑器：修改文本并记入日志
+    struct Editor
+    {
+        std::u16string text;
+        UndoJournal journal;
+
+        void Type(size_t pos, const std::u16string& inserted, size_t removed = 0)
+        {
+            std::u16string before = text;
+            text.replace(pos, removed, inserted);
+            journal.Record(MakeTextDelta(before.data(), before.size(), text.data(), text.size(),
+                pos + inserted.size()));
+        }
+
+        bool Undo()
+        {
+            TextDelta delta;
+            return journal.Undo(delta) && RevertTextDelta(text, delta);
+        }
+
+        bool Redo()
+        {
+            TextDelta delta;
+            return journal.Redo(delta) && ApplyTextDelta(text, delta);
+        }
+    };
+
+    // 测试用的可逆加密：按密钥异或，前面加一个字节的标记
+    UndoJournalCipher MakeXorCipher(uint8_t key)
+    {
+        UndoJournalCipher cipher;
+        cipher.encrypt = [key](const std::vector<uint8_t>& plain, std::vector<uint8_t>& out)
+        {
+            out.assign(1, 0xA5);
+            for (uint8_t b : plain)
+                out.push_back(static_cast<uint8_t>(b ^ key));
+            return true;
+        };
+        cipher.decrypt = [key](const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+        {
+            if (in.empty() || in[0] != 0xA5)
+                return false;
+            out.clear();
+            for (size_t i = 1; i < in.size(); i++)
+                out.push_back(static_cast<uint8_t>(in[i] ^ key));
+            return true;
+        };
+        cipher.keyCheck = 0x1000 + key;
+        return cipher;
+    }
+}
+
+// ============ 内存中的撤销/重做 ============
+
+TEST(UndoJournalTest, UndoRedoInMemory)
+{
+    Editor ed;
+    ed.journal.Open("", Fingerprint(ed.text));
+    ed.Type(0, u"hello");
+    ed.Type(5, u" world");
+    ed.Type(0, u"H", 1);
+    EXPECT_EQ(u"Hello world", ed.text);
+
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"hello world", ed.text);
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"hello", ed.text);
+    ASSERT_TRUE(ed.Redo());
+    EXPECT_EQ(u"hello world", ed.text);
+    ASSERT_TRUE(ed.Undo());
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"", ed.text);
+    EXPECT_FALSE(ed.journal.CanUndo());
+    EXPECT_FALSE(ed.Undo());
+    EXPECT_EQ(3u, ed.journal.GetRedoCount());
+}
+
+TEST(UndoJournalTest, NewEditDropsRedo)
+{
+    Editor ed;
+    ed.journal.Open("", Fingerprint(ed.text));
+    ed.Type(0, u"a");
+    ed.Type(1, u"b");
+    ed.Undo();
+    EXPECT_TRUE(ed.journal.CanRedo());
+    ed.Type(1, u"c");
+    EXPECT_FALSE(ed.journal.CanRedo());
+    EXPECT_EQ(u"ac", ed.text);
+}
+
+// ============ 关闭后重新打开 ============
+
+TEST(UndoJournalTest, ReopenRestoresHistoryAtSavedState)
+{
+    std::string path = MakeJournalPath("reopen.undo");
+    std::u16string saved;
+    {
+        Editor ed;
+        ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text)));
+        EXPECT_FALSE(ed.journal.IsRestored());
+        ed.Type(0, u"first line\r\n");
+        ed.Type(12, u"second line");
+        ed.Type(12, u"2nd", 6);
+        ed.Undo();      // 保存时有一个可重做的编辑
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+        saved = ed.text;
+    }
+
+    Editor ed;
+    ed.text = saved;
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text)));
+    EXPECT_TRUE(ed.journal.IsRestored());
+    EXPECT_TRUE(ed.journal.CanRedo());
+    ASSERT_TRUE(ed.Redo());
+    EXPECT_EQ(u"first line\r\n2nd line", ed.text);
+    ASSERT_TRUE(ed.Undo());
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"first line\r\n", ed.text);
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"", ed.text);
+    EXPECT_FALSE(ed.journal.CanUndo());
+}
+
+TEST(UndoJournalTest, ReopenWithoutSaveMatchesOriginalState)
+{
+    std::string path = MakeJournalPath("unsaved.undo");
+    {
+        Editor ed;
+        ed.text = u"original";
+        ed.journal.Open(path, Fingerprint(ed.text));
+        ed.Type(0, u"saved ");
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+        ed.Type(0, u"unsaved ");     // 没有保存就关闭
+    }
+
+    Editor ed;
+    ed.text = u"saved original";
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text)));
+    EXPECT_TRUE(ed.journal.IsRestored());
+    EXPECT_FALSE(ed.journal.CanRedo());
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"original", ed.text);
+}
+
+TEST(UndoJournalTest, ReopenAfterExternalChangeStartsFresh)
+{
+    std::string path = MakeJournalPath("external.undo");
+    {
+        Editor ed;
+        ed.journal.Open(path, Fingerprint(ed.text));
+        ed.Type(0, u"abc");
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+    }
+
+    Editor ed;
+    ed.text = u"changed elsewhere";
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text)));
+    EXPECT_FALSE(ed.journal.IsRestored());
+    EXPECT_FALSE(ed.journal.CanUndo());
+}
+
+TEST(UndoJournalTest, ReopenReadsOnlyTailAndCheckpoint)
+{
+    std::string path = MakeJournalPath("lazy.undo");
+    std::u16string saved;
+    {
+        Editor ed;
+        ed.journal.Open(path, Fingerprint(ed.text));
+        for (int i = 0; i < 2000; i++)
+        {
+            ed.Type(ed.text.size(), u"line of text\r\n");
+            if (ed.journal.NeedsCheckpoint())
+                ed.journal.Checkpoint(Fingerprint(ed.text));
+        }
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+        saved = ed.text;
+        EXPECT_GT(ed.journal.GetSize(), 100000u);
+    }
+
+    Editor ed;
+    ed.text = saved;
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text)));
+    EXPECT_TRUE(ed.journal.IsRestored());
+    // 文件头、末尾长度、最后一条记录头、检查点记录：与历史长短无关
+    EXPECT_LT(ed.journal.GetBytesRead(), 256u);
+
+    // 撤销时才逐条读出
+    ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(saved.size() - 14, ed.text.size());
+}
+
+TEST(UndoJournalTest, TornTailStartsFresh)
+{
+    std::string path = MakeJournalPath("torn.undo");
+    {
+        Editor ed;
+        ed.journal.Open(path, Fingerprint(ed.text));
+        ed.Type(0, u"abc");
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+    }
+
+    // 模拟写到一半崩溃：末尾多出半条记录
+    FILE* fp = FileUtil::Open(path, "ab");
+    ASSERT_NE(nullptr, fp);
+    fwrite("UNDJ\x01\x00", 1, 6, fp);
+    fclose(fp);
+
+    Editor ed;
+    ed.text = u"abc";
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text)));
+    EXPECT_FALSE(ed.journal.IsRestored());
+    EXPECT_FALSE(ed.journal.CanUndo());
+}
+
+// ============ 加密 ============
+
+TEST(UndoJournalTest, EncryptedJournalHidesTextAndNeedsSameKey)
+{
+    std::string path = MakeJournalPath("encrypted.undo");
+    UndoJournalCipher cipher = MakeXorCipher(0x5A);
+    {
+        Editor ed;
+        ed.journal.Open(path, Fingerprint(ed.text), &cipher);
+        ed.Type(0, u"SECRET");
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+    }
+
+    std::vector<uint8_t> raw;
+    ASSERT_TRUE(FileUtil::ReadAll(path, raw));
+    const char16_t secret[] = u"SECRET";
+    auto it = std::search(raw.begin(), raw.end(),
+        reinterpret_cast<const uint8_t*>(secret), reinterpret_cast<const uint8_t*>(secret) + 12);
+    EXPECT_TRUE(it == raw.end());
+
+    {
+        Editor ed;
+        ed.text = u"SECRET";
+        ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text), &cipher));
+        EXPECT_TRUE(ed.journal.IsRestored());
+        ASSERT_TRUE(ed.Undo());
+        EXPECT_EQ(u"", ed.text);
+        ed.Redo();
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+    }
+
+    // 密钥变了：日志作废
+    UndoJournalCipher otherKey = MakeXorCipher(0x33);
+    Editor ed;
+    ed.text = u"SECRET";
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text), &otherKey));
+    EXPECT_FALSE(ed.journal.IsRestored());
+    EXPECT_FALSE(ed.journal.CanUndo());
+}
+
+TEST(UndoJournalTest, SecretCipherAuthenticatesPayload)
+{
+    UndoJournalCipher cipher;
+    ASSERT_TRUE(MakeSecretCipher("BIGC_AI_2025_KEY", cipher));
+    // HMAC-SHA256(口令, "MFCNoteBook undo journal key check") 的前 8 字节
+    EXPECT_EQ(0xA6FB4594ED2A5183ULL, cipher.keyCheck);
+
+    std::vector<uint8_t> plain = { 'u', 'n', 'd', 'o', 0, 1, 2, 3 };
+    std::vector<uint8_t> sealed;
+    ASSERT_TRUE(cipher.encrypt(plain, sealed));
+    // IV + 一个分组的密文 + 32 字节 MAC
+    EXPECT_EQ(16u + 16u + 32u, sealed.size());
+
+    std::vector<uint8_t> opened;
+    ASSERT_TRUE(cipher.decrypt(sealed, opened));
+    EXPECT_EQ(plain, opened);
+
+    // IV、密文和 MAC 中任一字节被改动都不解密
+    for (size_t i : { size_t(0), size_t(20), sealed.size() - 1 })
+    {
+        std::vector<uint8_t> tampered = sealed;
+        tampered[i] ^= 0x01;
+        EXPECT_FALSE(cipher.decrypt(tampered, opened)) << "byte " << i;
+    }
+    std::vector<uint8_t> truncated(sealed.begin(), sealed.end() - 1);
+    EXPECT_FALSE(cipher.decrypt(truncated, opened));
+
+    UndoJournalCipher other;
+    ASSERT_TRUE(MakeSecretCipher("ANOTHER_KEY", other));
+    EXPECT_NE(cipher.keyCheck, other.keyCheck);
+    EXPECT_FALSE(other.decrypt(sealed, opened));
+
+    UndoJournalCipher empty;
+    EXPECT_FALSE(MakeSecretCipher("", empty));
+}
+
+TEST(UndoJournalTest, TamperedEncryptedRecordNotRestored)
+{
+    std::string path = MakeJournalPath("tampered.undo");
+    UndoJournalCipher cipher;
+    ASSERT_TRUE(MakeSecretCipher("BIGC_AI_2025_KEY", cipher));
+    {
+        Editor ed;
+        ed.journal.Open(path, Fingerprint(ed.text), &cipher);
+        ed.Type(0, u"SECRET");
+        ed.journal.Checkpoint(Fingerprint(ed.text));
+    }
+
+    // 改动最后一条记录（检查点）的密文，并重新计算 FNV 校验和，让它看起来是完整的记录
+    std::vector<uint8_t> raw;
+    ASSERT_TRUE(FileUtil::ReadAll(path, raw));
+    uint32_t lastSize = 0;
+    memcpy(&lastSize, raw.data() + raw.size() - sizeof(lastSize), sizeof(lastSize));
+    size_t recordOffset = raw.size() - lastSize;
+    UndoRecordHeader header;
+    memcpy(&header, raw.data() + recordOffset, sizeof(header));
+    uint8_t* pPayload = raw.data() + recordOffset + sizeof(header);
+    pPayload[20] ^= 0x01;
+    uint32_t checksum = 2166136261u;
+    for (uint32_t i = 0; i < header.payloadLength; i++)
+    {
+        checksum ^= pPayload[i];
+        checksum *= 16777619u;
+    }
+    header.checksum = checksum;
+    memcpy(raw.data() + recordOffset, &header, sizeof(header));
+    ASSERT_TRUE(FileUtil::WriteAllAtomic(path, raw.data(), raw.size()));
+
+    Editor ed;
+    ed.text = u"SECRET";
+    ASSERT_TRUE(ed.journal.Open(path, Fingerprint(ed.text), &cipher));
+    EXPECT_FALSE(ed.journal.IsRestored());
+    EXPECT_FALSE(ed.journal.CanUndo());
+}
+
+// ============ 压缩 ============
+
+TEST(UndoJournalTest, CompactionBoundsSizeAndKeepsRecentHistory)
+{
+    std::string path = MakeJournalPath("compact.undo");
+    Editor ed;
+    ed.journal.Open(path, Fingerprint(ed.text));
+
+    // 每次插入 64KB，很快超过上限
+    std::u16string block(32 * 1024, u'x');
+    for (int i = 0; i < 200; i++)
+    {
+        block[0] = static_cast<char16_t>(u'A' + i % 26);
+        ed.Type(0, block);
+        if (i == 199)
+            ed.Undo();      // 留一个可重做的编辑
+        if (ed.journal.NeedsCompaction())
+        {
+            ASSERT_TRUE(ed.journal.Compact(Fingerprint(ed.text)));
+        }
+    }
+    EXPECT_LE(ed.journal.GetSize(), static_cast<uint64_t>(UNDO_JOURNAL_MAX_BYTES + block.size() * 2 + 1024));
+    EXPECT_TRUE(ed.journal.CanUndo());
+    EXPECT_TRUE(ed.journal.CanRedo());
+}
+
+TEST(UndoJournalTest, CompactPreservesUndoRedoChain)
+{
+    Editor ed;
+    ed.journal.Open("", Fingerprint(ed.text));
+    for (int i = 0; i < 10; i++)
+        ed.Type(ed.text.size(), std::u16string(1, static_cast<char16_t>(u'0' + i)));
+    ed.Undo();
+    ed.Undo();
+    EXPECT_EQ(u"01234567", ed.text);
+
+    ASSERT_TRUE(ed.journal.Compact(Fingerprint(ed.text)));
+    ASSERT_TRUE(ed.Redo());
+    ASSERT_TRUE(ed.Redo());
+    EXPECT_EQ(u"0123456789", ed.text);
+    for (int i = 0; i < 10; i++)
+        ASSERT_TRUE(ed.Undo());
+    EXPECT_EQ(u"", ed.text);
+}
+
+TEST(UndoJournalTest, CompactToNewPathMovesJournal)
+{
+    std::string path = MakeJournalPath("saveas.undo");
+    Editor ed;
+    ed.journal.Open("", Fingerprint(ed.text));
+    ed.Type(0, u"untitled");
+    ASSERT_TRUE(ed.journal.Compact(Fingerprint(ed.text), path));
+    EXPECT_EQ(path, ed.journal.GetPath());
+    ed.journal.Close();
+
+    Editor reopened;
+    reopened.text = u"untitled";
+    ASSERT_TRUE(reopened.journal.Open(path, Fingerprint(reopened.text)));
+    EXPECT_TRUE(reopened.journal.IsRestored());
+    ASSERT_TRUE(reopened.Undo());
+    EXPECT_EQ(u"", reopened.text);
+}
+
+// ============ 跟随撤销树 ============
+
+TEST(UndoJournalTest, FollowKeepsCurrentPathAcrossBranchSwitch)
+{
+    std::string path = MakeJournalPath("follow.undo");
+    Editor ed;
+    ed.journal.Open(path, Fingerprint(ed.text));
+    ed.Type(0, u"abc");
+    TextDelta def = MakeTextDelta(u"abc", 3, u"abcdef", 6, 6);
+    TextDelta xyz = MakeTextDelta(u"abc", 3, u"abcxyz", 6, 6);
+    ed.journal.Record(def);
+
+    // 树上从 "abcdef" 经 "abc" 切到另一分支 "abcxyz"，再切回来
+    EXPECT_TRUE(ed.journal.Follow(def, false));
+    EXPECT_TRUE(ed.journal.Follow(xyz, true));
+    EXPECT_FALSE(ed.journal.CanRedo());
+    EXPECT_TRUE(ed.journal.Follow(xyz, false));
+    uint64_t sizeBefore = ed.journal.GetSize();
+    EXPECT_TRUE(ed.journal.Follow(xyz, true));      // 与可重做的编辑相同：只追加移动记录
+    EXPECT_LT(ed.journal.GetSize() - sizeBefore, 64u);
+
+    // 撤销方向与日志不一致时报告
+    EXPECT_FALSE(ed.journal.Follow(def, false));
+}
@@ -0,0 +1,396 @@
+﻿// test_undo_tree.cpp - 分支撤销树测试（与保存每个状态全文的朴素模型对照）
+#include "pch.h"
+#include "../MFCNoteBook/UndoTree.h"
+
+#include <map>
+#include <random>
+
+using namespace TestableLogic;
+
+namespace
+{
+    TextDelta Replace(const std::u16string& text, size_t pos, size_t len, const std::u16string& inserted)
+    {
+        std::u16string after = text;
+        after.replace(pos, len, inserted);
+        return MakeTextDelta(text.data(), text.size(), after.data(), after.size(), pos + inserted.size());
+    }
+
+    bool ApplySteps(std::u16string& text, const std::vector<UndoStep>& steps)
+    {
+        for (const UndoStep& step : steps)
+        {
+            if (!(step.bForward ? ApplyTextDelta(text, *step.pDelta) : RevertTextDelta(text, *step.pDelta)))
+                return false;
+        }
+        return true;
+    }
+
+    bool ApplyStep(std::u16string& text, const UndoStep& step)
+    {
+        return ApplySteps(text, std::vector<UndoStep>(1, step));
+    }
+
+    // 分支统计与逐个节点重新累计的结果一致
+    void ExpectAccountingConsistent(const UndoTree& tree)
+    {
+        std::vector<size_t> nodes(tree.GetBranchCount(), 0);
+        std::vector<size_t> bytes(tree.GetBranchCount(), 0);
+        size_t total = 0;
+        for (UndoNodeId id = 0; id < tree.GetNodeCount(); id++)
+        {
+            size_t b = tree.GetBranchOf(id);
+            ASSERT_LT(b, tree.GetBranchCount());
+            nodes[b]++;
+            size_t delta = tree.GetDeltaBytes(id);
+            bytes[b] += delta;
+            total += delta;
+        }
+        for (size_t b = 0; b < tree.GetBranchCount(); b++)
+        {
+            EXPECT_EQ(nodes[b], tree.GetBranch(b).nodeCount) << "branch " << b;
+            EXPECT_EQ(bytes[b], tree.GetBranch(b).bytes) << "branch " << b;
+            EXPECT_EQ(b, tree.GetBranchOf(tree.GetBranch(b).tip));
+            EXPECT_TRUE(tree.GetChildren(tree.GetBranch(b).tip).empty());
+        }
+        EXPECT_EQ(total, tree.GetTotalBytes());
+
+        const UndoTreeMemory& memory = tree.GetMemory();
+        EXPECT_EQ(total, memory.hotBytes + memory.coldRawBytes);
+    }
+
+    // 一段重复较多、像正文的文本
+    std::u16string MakeParagraph(size_t index, size_t chars)
+    {
+        std::u16string text;
+        while (text.size() < chars)
+        {
+            text += u"line ";
+            text += static_cast<char16_t>(u'0' + index % 10);
+            text += u" of some ordinary note text\r\n";
+        }
+        text.resize(chars);
+        return text;
+    }
+}
+
+TEST(UndoTreeTest, EditAfterUndoKeepsOldBranch)
+{
+    UndoTree tree;
+    std::u16string text;
+    UndoStep step;
+
+    TextDelta d = Replace(text, 0, 0, u"abc");
+    ApplyTextDelta(text, d);
+    UndoNodeId abc = tree.Record(d);
+    d = Replace(text, 3, 0, u"def");
+    ApplyTextDelta(text, d);
+    UndoNodeId abcdef = tree.Record(d);
+
+    ASSERT_TRUE(tree.Undo(step));
+    ASSERT_TRUE(ApplyStep(text, step));
+    EXPECT_EQ(u"abc", text);
+
+    // 撤销后的新编辑开出一个分支，原来的 "def" 仍在树中
+    d = Replace(text, 3, 0, u"XYZ");
+    ApplyTextDelta(text, d);
+    UndoNodeId abcxyz = tree.Record(d);
+    EXPECT_EQ(2u, tree.GetChildren(abc).size());
+    EXPECT_EQ(2u, tree.GetBranchCount());
+    EXPECT_NE(tree.GetBranchOf(abcdef), tree.GetBranchOf(abcxyz));
+    EXPECT_FALSE(tree.CanRedo());
+
+    std::vector<UndoStep> steps;
+    ASSERT_TRUE(tree.JumpTo(abcdef, steps));
+    ASSERT_EQ(2u, steps.size());
+    EXPECT_FALSE(steps[0].bForward);
+    EXPECT_TRUE(steps[1].bForward);
+    ASSERT_TRUE(ApplySteps(text, steps));
+    EXPECT_EQ(u"abcdef", text);
+
+    // 跳转后撤销、重做沿跳转过的路径
+    ASSERT_TRUE(tree.Undo(step));
+    ASSERT_TRUE(ApplyStep(text, step));
+    ASSERT_TRUE(tree.Redo(step));
+    ASSERT_TRUE(ApplyStep(text, step));
+    EXPECT_EQ(u"abcdef", text);
+    EXPECT_EQ(abcdef, tree.GetCurrent());
+}
+
+TEST(UndoTreeTest, ChronologicalNavigationCrossesBranches)
+{
+    UndoTree tree;
+    std::u16string text;
+    UndoStep step;
+
+    TextDelta d = Replace(text, 0, 0, u"1");
+    ApplyTextDelta(text, d);
+    tree.Record(d);
+    d = Replace(text, 1, 0, u"2");
+    ApplyTextDelta(text, d);
+    UndoNodeId two = tree.Record(d);
+    tree.Undo(step);
+    ApplyStep(text, step);
+    d = Replace(text, 1, 0, u"3");
+    ApplyTextDelta(text, d);
+    tree.Record(d);
+    EXPECT_EQ(u"13", text);
+
+    // 比 "13" 早一步的是另一分支上的 "12"
+    UndoNodeId older;
+    ASSERT_TRUE(tree.GetOlderState(older));
+    EXPECT_EQ(two, older);
+    std::vector<UndoStep> steps;
+    ASSERT_TRUE(tree.JumpTo(older, steps));
+    ASSERT_TRUE(ApplySteps(text, steps));
+    EXPECT_EQ(u"12", text);
+
+    UndoNodeId newer;
+    ASSERT_TRUE(tree.GetNewerState(newer));
+    ASSERT_TRUE(tree.JumpTo(newer, steps));
+    ASSERT_TRUE(ApplySteps(text, steps));
+    EXPECT_EQ(u"13", text);
+    EXPECT_FALSE(tree.GetNewerState(newer));
+}
+
+TEST(UndoTreeTest, BranchesShareAncestorDeltas)
+{
+    UndoTree tree;
+    std::u16string text;
+    std::u16string big(10000, u'x');
+
+    TextDelta d = Replace(text, 0, 0, big);
+    ApplyTextDelta(text, d);
+    UndoNodeId base = tree.Record(d);
+    size_t baseBytes = tree.GetTotalBytes();
+
+    // 在同一个状态上开出十个分支，公共的大段文本只保存一次
+    std::vector<UndoStep> steps;
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_TRUE(tree.JumpTo(base, steps));
+        ASSERT_TRUE(ApplySteps(text, steps));
+        d = Replace(text, 0, 0, std::u16string(1, static_cast<char16_t>(u'a' + i)));
+        ApplyTextDelta(text, d);
+        tree.Record(d);
+    }
+    EXPECT_EQ(12u, tree.GetNodeCount());    // 根、公共状态和十个分支
+    EXPECT_EQ(10u, tree.GetBranchCount());
+    EXPECT_LT(tree.GetTotalBytes() - baseBytes, 1000u);
+    EXPECT_EQ(1u, tree.GetBranch(9).nodeCount);
+    ExpectAccountingConsistent(tree);
+}
+
+TEST(UndoTreeTest, ExtendRootPrependsOlderHistory)
+{
+    // 恢复时的当前状态是 "abc"，更早的编辑逐条从日志读出再接到根上方
+    UndoTree tree;
+    std::u16string text = u"abc";
+    UndoStep step;
+
+    EXPECT_FALSE(tree.CanUndo());
+    tree.ExtendRoot(Replace(u"ab", 2, 0, u"c"));
+    tree.ExtendRoot(Replace(u"a", 1, 0, u"b"));
+    EXPECT_EQ(3u, tree.GetNodeCount());
+
+    ASSERT_TRUE(tree.Undo(step));
+    ASSERT_TRUE(ApplyStep(text, step));
+    ASSERT_TRUE(tree.Undo(step));
+    ASSERT_TRUE(ApplyStep(text, step));
+    EXPECT_EQ(u"a", text);
+    EXPECT_FALSE(tree.CanUndo());
+
+    UndoNodeId older;
+    EXPECT_FALSE(tree.GetOlderState(older));
+    UndoNodeId newer;
+    ASSERT_TRUE(tree.GetNewerState(newer));
+    std::vector<UndoStep> steps;
+    ASSERT_TRUE(tree.JumpTo(newer, steps));
+    ASSERT_TRUE(ApplySteps(text, steps));
+    EXPECT_EQ(u"ab", text);
+    ExpectAccountingConsistent(tree);
+}
+
+// 随机的编辑、撤销、重做、跳转与按时间前后移动：每一步之后的文本都应等于模型保存的该状态全文
+TEST(UndoTreeTest, MatchesSnapshotModel)
+{
+    for (unsigned seed = 1; seed <= 20; seed++)
+    {
+        std::mt19937 rng(seed);
+        UndoTree tree;
+        std::u16string text;
+        std::map<UndoNodeId, std::u16string> snapshots;
+        snapshots[tree.GetRoot()] = text;
+
+        for (int op = 0; op < 1200; op++)
+        {
+            // 随时把较早的节点压缩掉一些：之后的撤销、跳转要先解压
+            if (rng() % 8 == 0)
+                tree.CompressColdNodes(rng() % 16);
+
+            UndoStep step;
+            std::vector<UndoStep> steps;
+            UndoNodeId node;
+            switch (rng() % 8)
+            {
+            case 0:
+            case 1:
+            case 2:
+            {
+                size_t pos = text.empty() ? 0 : rng() % (text.size() + 1);
+                size_t len = (rng() % 3 == 0 && pos < text.size()) ? 1 + rng() % (text.size() - pos) : 0;
+                std::u16string inserted(rng() % 4, static_cast<char16_t>(u'a' + rng() % 3));
+                if (rng() % 4 == 0)
+                    inserted = MakeParagraph(rng(), 100 + rng() % 300);
+                TextDelta d = Replace(text, pos, len, inserted);
+                if (d.IsEmpty())
+                    break;
+                ASSERT_TRUE(ApplyTextDelta(text, d));
+                snapshots[tree.Record(d)] = text;
+                break;
+            }
+            case 3:
+                if (tree.Undo(step))
+                {
+                    ASSERT_TRUE(ApplyStep(text, step));
+                }
+                break;
+            case 4:
+                if (tree.Redo(step))
+                {
+                    ASSERT_TRUE(ApplyStep(text, step));
+                }
+                break;
+            case 5:
+                ASSERT_TRUE(tree.JumpTo(static_cast<UndoNodeId>(rng() % tree.GetNodeCount()), steps));
+                ASSERT_TRUE(ApplySteps(text, steps));
+                break;
+            case 6:
+                if (tree.GetOlderState(node))
+                {
+                    ASSERT_TRUE(tree.JumpTo(node, steps));
+                    ASSERT_TRUE(ApplySteps(text, steps));
+                }
+                break;
+            default:
+                if (tree.GetNewerState(node))
+                {
+                    ASSERT_TRUE(tree.JumpTo(node, steps));
+                    ASSERT_TRUE(ApplySteps(text, steps));
+                }
+                break;
+            }
+            ASSERT_EQ(snapshots[tree.GetCurrent()], text) << "seed " << seed << " op " << op;
+        }
+        EXPECT_GT(tree.GetMemory().compressCount, 0u) << "seed " << seed;
+
+        // 任意两个状态之间的路径把一个的全文变成另一个的全文
+        for (int i = 0; i < 50; i++)
+        {
+            UndoNodeId a = static_cast<UndoNodeId>(rng() % tree.GetNodeCount());
+            UndoNodeId b = static_cast<UndoNodeId>(rng() % tree.GetNodeCount());
+            std::vector<UndoStep> steps;
+            ASSERT_TRUE(tree.GetPath(a, b, steps));
+            std::u16string t = snapshots[a];
+            ASSERT_TRUE(ApplySteps(t, steps));
+            ASSERT_EQ(snapshots[b], t) << "seed " << seed;
+        }
+        ExpectAccountingConsistent(tree);
+    }
+}
+
+// ============ 分层存储 ============
+
+TEST(UndoTreeTest, OldLargeDeltasAreCompressedAndThawedOnUndo)
+{
+    UndoTree tree;
+    std::u16string text;
+    for (size_t i = 0; i < 1000; i++)
+    {
+        std::u16string after = text + MakeParagraph(i, 1024);
+        TextDelta d = MakeTextDelta(text.data(), text.size(), after.data(), after.size(), after.size());
+        tree.Record(d);
+        text.swap(after);
+    }
+
+    // 最近的节点不压缩
+    EXPECT_TRUE(tree.HasColdNodes());
+    while (tree.CompressColdNodes(64) > 0)
+    {
+    }
+    const UndoTreeMemory& memory = tree.GetMemory();
+    EXPECT_GE(memory.coldNodes, 1000u - UNDO_TREE_HOT_COUNT);
+    EXPECT_FALSE(tree.IsCompressed(tree.GetCurrent()));
+    EXPECT_LT(memory.coldBytes * 10, memory.coldRawBytes);
+    ExpectAccountingConsistent(tree);
+
+    UndoStep step;
+    while (tree.Undo(step))
+        ASSERT_TRUE(RevertTextDelta(text, *step.pDelta));
+    EXPECT_EQ(u"", text);
+    EXPECT_GE(memory.decompressCount, memory.compressCount - memory.coldNodes);
+    EXPECT_FALSE(tree.IsCompressed(tree.GetChildren(tree.GetRoot())[0]));
+    ExpectAccountingConsistent(tree);
+}
+
+TEST(UndoTreeTest, SmallDeltasStayUncompressed)
+{
+    UndoTree tree;
+    for (int i = 0; i < 1000; i++)
+        tree.Record(MakeTextDelta(u"", 0, u"x", 1, 1));
+    EXPECT_FALSE(tree.HasColdNodes());
+    EXPECT_EQ(0u, tree.CompressColdNodes(1000));
+}
+
+// 撤销到最初：其中大段替换（全部替换）的记录压缩存放，走到时才解压（计时见 bench_undo_tree.cpp）
+TEST(UndoTreeTest, UndoThroughCompressedReplaceAll)
+{
+    UndoTree tree;
+    std::u16string text = MakeParagraph(0, 64 * 1024);
+    std::u16string original = text;
+    const std::u16string typed = u"the quick brown fox jumps over the lazy dog. ";
+    std::mt19937 rng(7);
+    size_t caret = 0;
+
+    for (int i = 0; i < 3000; i++)
+    {
+        std::u16string after = text;
+        if (i % 100 == 0)
+        {
+            // 模拟全部替换：整篇文本中每行的 "line N" 都换成新的数字
+            for (size_t pos = after.find(u"line "); pos != std::u16string::npos; pos = after.find(u"line ", pos + 6))
+                after[pos + 5] = static_cast<char16_t>(u'0' + i / 100 % 10);
+            caret = rng() % after.size();
+        }
+        else
+        {
+            // 在光标处逐字输入
+            after.insert(caret, 1, typed[i % typed.size()]);
+            caret++;
+        }
+        TextDelta d = MakeTextDelta(text.data(), text.size(), after.data(), after.size(), 0);
+        tree.Record(std::move(d));
+        text.swap(after);
+        if (tree.HasColdNodes())
+            tree.CompressColdNodes(16);
+    }
+    while (tree.CompressColdNodes(64) > 0)
+    {
+    }
+
+    const UndoTreeMemory& memory = tree.GetMemory();
+    size_t residentBytes = memory.hotBytes + memory.coldBytes;
+    EXPECT_LT(residentBytes * 4, tree.GetTotalBytes());
+
+    UndoStep step;
+    int steps = 0;
+    while (tree.Undo(step))
+    {
+        ASSERT_TRUE(RevertTextDelta(text, *step.pDelta));
+        steps++;
+    }
+
+    EXPECT_EQ(3000, steps);
+    EXPECT_TRUE(text == original);
+    EXPECT_EQ(memory.coldNodes + memory.decompressCount, memory.compressCount);
+}
@@ -0,0 +1,220 @@
+﻿// test_wrap_layout.cpp - 自动换行排版缓存测试
+#include "pch.h"
+#include "../MFCNoteBook/WrapLayoutCache.h"
+#include "../MFCNoteBook/TextEditorModel.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace TestableLogic;
+
+namespace
+{
+    // 逐行累加的参照实现
+    uint64_t RowFromLineBrute(const std::vector<size_t>& rows, size_t line)
+    {
+        uint64_t row = 0;
+        for (size_t i = 0; i < line; i++)
+            row += rows[i];
+        return row;
+    }
+}
+
+TEST(WrapLayoutCacheTest, InvalidLinesCountAsOneRow)
+{
+    WrapLayoutCache cache;
+    cache.Reset(100, 80);
+    EXPECT_EQ(100u, cache.GetTotalRows());
+    EXPECT_EQ(100u, cache.GetInvalidCount());
+    EXPECT_FALSE(cache.IsLineValid(5));
+    EXPECT_EQ(1u, cache.GetLineRows(5));
+    EXPECT_EQ(42u, cache.GetRowFromLine(42));
+}
+
+TEST(WrapLayoutCacheTest, RowLineMapping)
+{
+    WrapLayoutCache cache;
+    cache.Reset(5, 80);
+    cache.SetLineRows(0, 1);
+    cache.SetLineRows(1, 3);
+    cache.SetLineRows(2, 1);
+    cache.SetLineRows(3, 2);
+    cache.SetLineRows(4, 1);
+    EXPECT_EQ(8u, cache.GetTotalRows());
+    EXPECT_EQ(0u, cache.GetInvalidCount());
+
+    EXPECT_EQ(1u, cache.GetRowFromLine(1));
+    EXPECT_EQ(4u, cache.GetRowFromLine(2));
+    EXPECT_EQ(5u, cache.GetRowFromLine(3));
+
+    size_t subRow = 0;
+    EXPECT_EQ(1u, cache.GetLineFromRow(3, &subRow));
+    EXPECT_EQ(2u, subRow);
+    EXPECT_EQ(3u, cache.GetLineFromRow(6, &subRow));
+    EXPECT_EQ(1u, subRow);
+
+    // 超出末尾时停在最后一个可视行
+    EXPECT_EQ(4u, cache.GetLineFromRow(100, &subRow));
+    EXPECT_EQ(0u, subRow);
+}
+
+TEST(WrapLayoutCacheTest, EditInvalidatesOnlyTouchedLines)
+{
+    WrapLayoutCache cache;
+    cache.Reset(10, 80);
+    for (size_t i = 0; i < 10; i++)
+        cache.SetLineRows(i, 2);
+
+    // 行内编辑
+    cache.ReplaceLines(4, 1, 1);
+    EXPECT_EQ(1u, cache.GetInvalidCount());
+    EXPECT_FALSE(cache.IsLineValid(4));
+    EXPECT_TRUE(cache.IsLineValid(3));
+    EXPECT_TRUE(cache.IsLineValid(5));
+    EXPECT_EQ(19u, cache.GetTotalRows());
+
+    // 第 6 行插入两个换行：1 行变成 3 行，其后的行保持已计算
+    cache.ReplaceLines(6, 1, 3);
+    EXPECT_EQ(12u, cache.GetLineCount());
+    EXPECT_EQ(4u, cache.GetInvalidCount());
+    EXPECT_TRUE(cache.IsLineValid(9));
+    EXPECT_EQ(2u, cache.GetLineRows(11));
+
+    // 跨 3 行的选区删除后合并为一行
+    cache.ReplaceLines(6, 3, 1);
+    EXPECT_EQ(10u, cache.GetLineCount());
+    EXPECT_EQ(2u, cache.GetInvalidCount());
+}
+
+TEST(WrapLayoutCacheTest, WrapWidthChangeInvalidatesAll)
+{
+    WrapLayoutCache cache;
+    cache.Reset(3, 80);
+    cache.SetLineRows(0, 4);
+    cache.SetWrapColumns(80);
+    EXPECT_TRUE(cache.IsLineValid(0));
+    cache.SetWrapColumns(40);
+    EXPECT_EQ(3u, cache.GetInvalidCount());
+    EXPECT_EQ(3u, cache.GetTotalRows());
+}
+
+TEST(WrapLayoutCacheTest, FindInvalidLineWrapsAround)
+{
+    WrapLayoutCache cache;
+    cache.Reset(4, 80);
+    cache.SetLineRows(1, 1);
+    cache.SetLineRows(2, 1);
+    cache.SetLineRows(3, 1);
+    EXPECT_EQ(0u, cache.FindInvalidLine(2));
+    cache.SetLineRows(0, 1);
+    EXPECT_EQ(4u, cache.FindInvalidLine(0));
+}
+
+TEST(WrapLayoutCacheTest, RandomEditsMatchBruteForce)
+{
+    std::mt19937 rng(37);
+    WrapLayoutCache cache;
+    std::vector<size_t> rows(5000, 1);
+    cache.Reset(rows.size(), 80);
+
+    for (int step = 0; step < 3000; step++)
+    {
+        size_t op = rng() % 4;
+        if (op < 2)
+        {
+            size_t line = rng() % rows.size();
+            size_t value = 1 + rng() % 5;
+            cache.SetLineRows(line, value);
+            rows[line] = value;
+        }
+        else
+        {
+            size_t first = rng() % rows.size();
+            size_t oldLines = 1 + rng() % (std::min)(static_cast<size_t>(4), rows.size() - first);
+            size_t newLines = 1 + rng() % 4;
+            cache.ReplaceLines(first, oldLines, newLines);
+            rows.erase(rows.begin() + first, rows.begin() + first + oldLines);
+            rows.insert(rows.begin() + first, newLines, 1);
+        }
+
+        ASSERT_EQ(rows.size(), cache.GetLineCount());
+        size_t probe = rng() % rows.size();
+        ASSERT_EQ(RowFromLineBrute(rows, probe), cache.GetRowFromLine(probe)) << "step " << step;
+        size_t subRow = 0;
+        uint64_t row = RowFromLineBrute(rows, probe) + rng() % rows[probe];
+        ASSERT_EQ(probe, cache.GetLineFromRow(row, &subRow));
+        ASSERT_EQ(row - RowFromLineBrute(rows, probe), subRow);
+    }
+    EXPECT_EQ(RowFromLineBrute(rows, rows.size()), cache.GetTotalRows());
+}
+
+TEST(TextEditorModelTest, WordWrap_RowsAndCaret)
+{
+    // 第 0 行 25 列，折行宽度 10 时占 3 个可视行
+    std::string text = "aaaaaaaaaabbbbbbbbbbccccc\nshort\n";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(2, 10);
+    model.SetWordWrap(true);
+    model.LayoutVisibleLines();
+    EXPECT_EQ(0u, model.ReflowPending(100));
+    EXPECT_EQ(5u, model.GetTotalRows());
+
+    std::vector<uint64_t> labels;
+    model.GetVisibleRowLines(2, labels);
+    EXPECT_EQ(1u, labels[0]);
+    EXPECT_EQ(0u, labels[1]);               // 续行没有行号
+
+    // 上下移动按可视行，行尾停在最后一个字符之前
+    model.MoveCaret(CaretMove::LineStart, false);
+    model.MoveCaret(CaretMove::Down, false);
+    EXPECT_EQ(10u, model.GetSelection().caret);
+    EXPECT_EQ(1u, model.GetCaretRow());
+    model.SetCaretFromRowCell(0, 50, false);
+    EXPECT_EQ(9u, model.GetSelection().caret);
+    model.SetCaretFromRowCell(3, 2, false);
+    EXPECT_EQ(28u, model.GetSelection().caret);
+    EXPECT_EQ(1u, model.GetCaretLine());
+
+    // 光标移到第 4 个可视行时视口跟随
+    EXPECT_TRUE(model.EnsureCaretVisible());
+    EXPECT_EQ(2u, model.GetFirstVisibleRow());
+    EXPECT_EQ(0u, model.GetFirstVisibleLine());
+    EXPECT_EQ(2u, model.GetFirstVisibleSubRow());
+}
+
+TEST(TextEditorModelTest, WordWrap_EditInvalidatesOnlyTouchedLines)
+{
+    std::string text;
+    for (int i = 0; i < 200; i++)
+        text += "0123456789\n";
+    TextBuffer buffer;
+    buffer.SetText(text.data(), text.size());       // 201 行，最后一行为空
+    TextEditorModel model;
+    model.SetBuffer(&buffer);
+    model.SetViewport(10, 8);
+    model.SetWordWrap(true);
+    while (model.ReflowPending(64) != 0)
+    {
+    }
+    EXPECT_EQ(401u, model.GetTotalRows());
+
+    // 在第 5 行插入一个换行：只有被拆开的两行失效，光标所在的那行定位光标时已经算过
+    model.SetCaretFromCell(5, 4, false);
+    std::u16string br = u"\n";
+    model.InsertText(br.data(), br.size());
+    EXPECT_EQ(1u, model.GetPendingLayoutCount());
+    EXPECT_EQ(0u, model.ReflowPending(100));
+    EXPECT_EQ(401u, model.GetTotalRows());
+
+    // 折行宽度变化后全部重新计算（第一可见行立即计算）
+    model.SetViewport(10, 20);
+    EXPECT_EQ(201u, model.GetPendingLayoutCount());
+    while (model.ReflowPending(64) != 0)
+    {
+    }
+    EXPECT_EQ(202u, model.GetTotalRows());
+}